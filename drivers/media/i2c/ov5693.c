@@ -39,6 +39,12 @@
 /* Yes, this is right. The datasheet for the OV5693 gives its ID as 0x5690 */
 #define OV5693_CHIP_ID				0x5690
 
+/* Group Hold */
+#define OV5693_GROUP_ACCESS_REG			0x3208
+#define OV5693_GROUP_ACCESS_HOLD_START		0x00
+#define OV5693_GROUP_ACCESS_HOLD_END		0x10
+#define OV5693_GROUP_ACCESS_LAUNCH		0xa0
+
 /* Exposure */
 #define OV5693_EXPOSURE_L_CTRL_HH_REG		0x3500
 #define OV5693_EXPOSURE_L_CTRL_H_REG		0x3501
@@ -612,15 +618,72 @@ static int ov5693_analog_gain_configure(struct ov5693_device *ov5693, u32 gain)
 	return ret;
 }
 
+/*
+ * While streaming, register writes are collected in group 0 and launched
+ * together so that the sensor applies them at a single frame boundary.
+ */
+static void ov5693_group_hold_start(struct ov5693_device *ov5693, int *error)
+{
+	if (!ov5693->streaming)
+		return;
+
+	ov5693_write_reg(ov5693, OV5693_GROUP_ACCESS_REG,
+			 OV5693_GROUP_ACCESS_HOLD_START, error);
+}
+
+static void ov5693_group_hold_launch(struct ov5693_device *ov5693, int *error)
+{
+	int ret = 0;
+
+	if (!ov5693->streaming)
+		return;
+
+	/*
+	 * The group is closed even when a write in it failed, or it would
+	 * hold every later write. The first error is the one reported.
+	 */
+	ov5693_write_reg(ov5693, OV5693_GROUP_ACCESS_REG,
+			 OV5693_GROUP_ACCESS_HOLD_END, &ret);
+	ov5693_write_reg(ov5693, OV5693_GROUP_ACCESS_REG,
+			 OV5693_GROUP_ACCESS_LAUNCH, &ret);
+	if (!*error)
+		*error = ret;
+}
+
+static int ov5693_exposure_gain_configure(struct ov5693_device *ov5693)
+{
+	struct ov5693_v4l2_ctrls *ctrls = &ov5693->ctrls;
+	int ret = 0;
+
+	/*
+	 * Exposure takes effect two frames after the group is launched and
+	 * analogue gain one frame after; userspace accounts for the delays.
+	 */
+	ov5693_group_hold_start(ov5693, &ret);
+
+	if (!ret && ctrls->exposure->is_new)
+		ret = ov5693_exposure_configure(ov5693, ctrls->exposure->val);
+
+	if (!ret && ctrls->analogue_gain->is_new)
+		ret = ov5693_analog_gain_configure(ov5693,
+						   ctrls->analogue_gain->val);
+
+	ov5693_group_hold_launch(ov5693, &ret);
+
+	return ret;
+}
+
 static int ov5693_vts_configure(struct ov5693_device *ov5693, u32 vblank)
 {
 	u16 vts = ov5693->mode.format.height + vblank;
 	int ret = 0;
 
+	ov5693_group_hold_start(ov5693, &ret);
 	ov5693_write_reg(ov5693, OV5693_TIMING_VTS_H_REG,
 			 OV5693_TIMING_VTS_H(vts), &ret);
 	ov5693_write_reg(ov5693, OV5693_TIMING_VTS_L_REG,
 			 OV5693_TIMING_VTS_L(vts), &ret);
+	ov5693_group_hold_launch(ov5693, &ret);
 
 	return ret;
 }
@@ -660,10 +723,8 @@ static int ov5693_s_ctrl(struct v4l2_ctrl *ctrl)
 
 	switch (ctrl->id) {
 	case V4L2_CID_EXPOSURE:
-		ret = ov5693_exposure_configure(ov5693, ctrl->val);
-		break;
-	case V4L2_CID_ANALOGUE_GAIN:
-		ret = ov5693_analog_gain_configure(ov5693, ctrl->val);
+		/* Cluster master for exposure and analogue gain */
+		ret = ov5693_exposure_gain_configure(ov5693);
 		break;
 	case V4L2_CID_DIGITAL_GAIN:
 		ret = ov5693_digital_gain_configure(ov5693, ctrl->val);
@@ -1360,6 +1421,9 @@ static int ov5693_init_controls(struct ov5693_device *ov5693)
 	if (ret)
 		goto err_free_handler;
 
+	/* Apply exposure and analogue gain updates together. */
+	v4l2_ctrl_cluster(2, &ov5693->ctrls.exposure);
+
 	/* Use same lock for controls as for everything else. */
 	ov5693->ctrls.handler.lock = &ov5693->lock;
 	ov5693->sd.ctrl_handler = &ov5693->ctrls.handler;
@@ -32,6 +32,13 @@
 #define OV7251_CHIP_ID_LOW		0x300b
 #define OV7251_CHIP_ID_LOW_BYTE		0x50
 #define OV7251_SC_GP_IO_IN1		0x3029
+#define OV7251_SC_LOW_POWER_CTRL	0x3030
+#define OV7251_SC_LOW_POWER_CTRL_FRAME_COUNT	BIT(2)
+#define OV7251_SC_FRAME_COUNT		0x303f
+#define OV7251_GROUP_ACCESS		0x3208
+#define OV7251_GROUP_ACCESS_HOLD_START	0x00
+#define OV7251_GROUP_ACCESS_HOLD_END	0x10
+#define OV7251_GROUP_ACCESS_LAUNCH	0xa0
 #define OV7251_AEC_EXPO_0		0x3500
 #define OV7251_AEC_EXPO_1		0x3501
 #define OV7251_AEC_EXPO_2		0x3502
@@ -62,6 +69,31 @@
 #define OV7251_VTS_REG_HIGH		0x380e
 #define OV7251_VTS_REG_LOW		0x380f
 
+/*
+ * Snapshot mode: while streaming, the sensor waits in software standby
+ * with the CSI-2 lanes in LP-11, and each write of the trigger button
+ * starts it. The sensor counts V4L2_CID_OV7251_SNAPSHOT_FRAMES frames
+ * itself and goes back to standby after the last one.
+ *
+ * The driver can't tell when a burst is over, so a trigger during a burst
+ * isn't refused: it ends the burst after the frame in progress and starts
+ * a new one of V4L2_CID_OV7251_SNAPSHOT_FRAMES frames. Userspace wanting
+ * exactly N frames per trigger has to dequeue them before triggering
+ * again.
+ *
+ * The frame count mode bit and the frame count register come from the
+ * register description and haven't been checked on a sensor yet.
+ */
+
+/*
+ * The base for the ov7251 driver controls.
+ * We reserve 16 controls for this driver.
+ */
+#define V4L2_CID_OV7251_BASE		(V4L2_CID_USER_BASE + 0x1310)
+#define V4L2_CID_OV7251_SNAPSHOT_FRAMES	(V4L2_CID_OV7251_BASE + 0)
+#define V4L2_CID_OV7251_SNAPSHOT_TRIGGER	(V4L2_CID_OV7251_BASE + 1)
+#define OV7251_SNAPSHOT_FRAMES_MAX	255
+
 struct reg_value {
 	u16 reg;
 	u8 val;
@@ -107,12 +139,17 @@ struct ov7251 {
 	struct v4l2_ctrl *gain;
 	struct v4l2_ctrl *hblank;
 	struct v4l2_ctrl *vblank;
+	struct v4l2_ctrl *snapshot_frames;
+
+	/* Snapshot mode, the sensor only runs for the frames of a trigger */
+	bool snapshot;
 
 	/* Cached register values */
 	u8 aec_pk_manual;
 	u8 pre_isp_00;
 	u8 timing_format1;
 	u8 timing_format2;
+	u8 sc_low_power;
 
 	struct mutex lock; /* lock to protect power state, ctrls and mode */
 	bool power_on;
@@ -800,6 +837,65 @@ static int ov7251_set_gain(struct ov7251 *ov7251, s32 gain)
 	return ov7251_write_seq_regs(ov7251, reg, val, 2);
 }
 
+static int ov7251_group_hold_start(struct ov7251 *ov7251)
+{
+	/*
+	 * In snapshot mode the sensor may be in standby, with no frame
+	 * boundary to launch the group at: the controls are set between
+	 * triggers.
+	 */
+	if (!ov7251->streaming || ov7251->snapshot)
+		return 0;
+
+	return ov7251_write_reg(ov7251, OV7251_GROUP_ACCESS,
+				OV7251_GROUP_ACCESS_HOLD_START);
+}
+
+static int ov7251_group_hold_launch(struct ov7251 *ov7251)
+{
+	int ret;
+
+	if (!ov7251->streaming || ov7251->snapshot)
+		return 0;
+
+	ret = ov7251_write_reg(ov7251, OV7251_GROUP_ACCESS,
+			       OV7251_GROUP_ACCESS_HOLD_END);
+	if (ret)
+		return ret;
+
+	return ov7251_write_reg(ov7251, OV7251_GROUP_ACCESS,
+				OV7251_GROUP_ACCESS_LAUNCH);
+}
+
+static int ov7251_set_exposure_gain(struct ov7251 *ov7251)
+{
+	int ret, launch_ret;
+
+	/*
+	 * Write the cluster as one register group while streaming so that
+	 * exposure and gain are applied at the same frame boundary. Exposure
+	 * then takes effect two frames later and gain one frame later.
+	 */
+	ret = ov7251_group_hold_start(ov7251);
+	if (ret)
+		return ret;
+
+	if (ov7251->exposure->is_new) {
+		ret = ov7251_set_exposure(ov7251, ov7251->exposure->val);
+		if (ret)
+			goto launch;
+	}
+
+	if (ov7251->gain->is_new)
+		ret = ov7251_set_gain(ov7251, ov7251->gain->val);
+
+launch:
+	/* the group is closed after an error too, not to hold later writes */
+	launch_ret = ov7251_group_hold_launch(ov7251);
+
+	return ret ? ret : launch_ret;
+}
+
 static int ov7251_pll1_configure(struct ov7251 *ov7251)
 {
 	struct pll1_config *cfg = &pll1_configurations[ov7251->xclk_freq_idx];
@@ -956,7 +1052,7 @@ static int ov7251_sensor_resume(struct device *dev)
 
 	ov7251->power_on = true;
 
-	if (ov7251->streaming) {
+	if (ov7251->streaming && !ov7251->snapshot) {
 		ret = ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
 				       OV7251_SC_MODE_SELECT_STREAMING);
 		if (ret) {
@@ -1052,17 +1148,59 @@ static int ov7251_set_test_pattern(struct ov7251 *ov7251, s32 value)
 static int ov7251_set_vblank(struct ov7251 *ov7251, s32 value)
 {
 	u16 val = ov7251->current_mode->height + value;
-	int ret;
+	int ret, launch_ret;
 
-	ret = ov7251_write_reg(ov7251, OV7251_VTS_REG_HIGH, val >> 8);
+	ret = ov7251_group_hold_start(ov7251);
 	if (ret)
 		return ret;
 
-	ret = ov7251_write_reg(ov7251, OV7251_VTS_REG_LOW, val & 0xff);
+	ret = ov7251_write_reg(ov7251, OV7251_VTS_REG_HIGH, val >> 8);
+	if (!ret)
+		ret = ov7251_write_reg(ov7251, OV7251_VTS_REG_LOW, val & 0xff);
+
+	launch_ret = ov7251_group_hold_launch(ov7251);
+
+	return ret ? ret : launch_ret;
+}
+
+static int ov7251_set_snapshot(struct ov7251 *ov7251, u32 frames)
+{
+	u8 val = ov7251->sc_low_power;
+	int ret;
+
+	if (frames) {
+		ret = ov7251_write_reg(ov7251, OV7251_SC_FRAME_COUNT, frames);
+		if (ret)
+			return ret;
+
+		val |= OV7251_SC_LOW_POWER_CTRL_FRAME_COUNT;
+	} else {
+		val &= ~OV7251_SC_LOW_POWER_CTRL_FRAME_COUNT;
+	}
+
+	return ov7251_write_reg(ov7251, OV7251_SC_LOW_POWER_CTRL, val);
+}
+
+static int ov7251_snapshot_trigger(struct ov7251 *ov7251)
+{
+	int ret;
+
+	if (!ov7251->streaming || !ov7251->snapshot)
+		return -EBUSY;
+
+	/*
+	 * The sensor starts counting on the standby to streaming edge. After
+	 * a burst it is expected to be back in standby with the register
+	 * still reading streaming, so make the edge every time. During a
+	 * burst this restarts it, see the snapshot mode description.
+	 */
+	ret = ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
+			       OV7251_SC_MODE_SELECT_SW_STANDBY);
 	if (ret)
 		return ret;
 
-	return 0;
+	return ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
+				OV7251_SC_MODE_SELECT_STREAMING);
 }
 
 static const char * const ov7251_test_pattern_menu[] = {
@@ -1078,15 +1216,16 @@ static int ov7251_s_ctrl(struct v4l2_ctrl *ctrl)
 
 	/* v4l2_ctrl_lock() locks our mutex */
 
+	if (ctrl->id == V4L2_CID_OV7251_SNAPSHOT_TRIGGER)
+		return ov7251_snapshot_trigger(ov7251);
+
 	if (!ov7251->power_on)
 		return 0;
 
 	switch (ctrl->id) {
 	case V4L2_CID_EXPOSURE:
-		ret = ov7251_set_exposure(ov7251, ctrl->val);
-		break;
-	case V4L2_CID_ANALOGUE_GAIN:
-		ret = ov7251_set_gain(ov7251, ctrl->val);
+		/* exposure is the master of the exposure/gain cluster */
+		ret = ov7251_set_exposure_gain(ov7251);
 		break;
 	case V4L2_CID_TEST_PATTERN:
 		ret = ov7251_set_test_pattern(ov7251, ctrl->val);
@@ -1100,6 +1239,10 @@ static int ov7251_s_ctrl(struct v4l2_ctrl *ctrl)
 	case V4L2_CID_VBLANK:
 		ret = ov7251_set_vblank(ov7251, ctrl->val);
 		break;
+	case V4L2_CID_OV7251_SNAPSHOT_FRAMES:
+		/* applied by ov7251_s_stream() */
+		ret = 0;
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1112,6 +1255,24 @@ static const struct v4l2_ctrl_ops ov7251_ctrl_ops = {
 	.s_ctrl = ov7251_s_ctrl,
 };
 
+static const struct v4l2_ctrl_config ov7251_ctrl_snapshot_frames = {
+	.ops	= &ov7251_ctrl_ops,
+	.id	= V4L2_CID_OV7251_SNAPSHOT_FRAMES,
+	.name	= "Snapshot Frames",
+	.type	= V4L2_CTRL_TYPE_INTEGER,
+	.min	= 0,
+	.max	= OV7251_SNAPSHOT_FRAMES_MAX,
+	.step	= 1,
+	.def	= 0,
+};
+
+static const struct v4l2_ctrl_config ov7251_ctrl_snapshot_trigger = {
+	.ops	= &ov7251_ctrl_ops,
+	.id	= V4L2_CID_OV7251_SNAPSHOT_TRIGGER,
+	.name	= "Snapshot Trigger",
+	.type	= V4L2_CTRL_TYPE_BUTTON,
+};
+
 static int ov7251_enum_mbus_code(struct v4l2_subdev *sd,
 				 struct v4l2_subdev_state *sd_state,
 				 struct v4l2_subdev_mbus_code_enum *code)
@@ -1243,6 +1404,21 @@ ov7251_find_mode_by_ival(struct ov7251 *ov7251, struct v4l2_fract *timeperframe)
 	return &ov7251_mode_info_data[n];
 }
 
+/* The VTS of @mode, which the frame interval of its table relies on */
+static int ov7251_set_mode_vblank(struct ov7251 *ov7251,
+				  const struct ov7251_mode_info *mode)
+{
+	int ret;
+
+	ret = __v4l2_ctrl_modify_range(ov7251->vblank, OV7251_VBLANK_MIN,
+				       OV7251_VBLANK_MAX - mode->height, 1,
+				       mode->vts - mode->height);
+	if (ret < 0)
+		return ret;
+
+	return __v4l2_ctrl_s_ctrl(ov7251->vblank, mode->vts - mode->height);
+}
+
 static int ov7251_set_format(struct v4l2_subdev *sd,
 			     struct v4l2_subdev_state *sd_state,
 			     struct v4l2_subdev_format *format)
@@ -1292,11 +1468,11 @@ static int ov7251_set_format(struct v4l2_subdev *sd,
 		if (ret < 0)
 			goto exit;
 
-		ret = __v4l2_ctrl_modify_range(ov7251->vblank, OV7251_VBLANK_MIN,
-					       OV7251_VBLANK_MAX - ov7251->current_mode->height,
-					       1, ov7251->current_mode->vts - ov7251->current_mode->height);
-
 		ov7251->current_mode = new_mode;
+
+		ret = ov7251_set_mode_vblank(ov7251, new_mode);
+		if (ret < 0)
+			goto exit;
 	}
 
 	__format = __ov7251_get_pad_format(ov7251, sd_state, format->pad,
@@ -1398,11 +1574,29 @@ static int ov7251_s_stream(struct v4l2_subdev *subdev, int enable)
 			dev_err(ov7251->dev, "could not sync v4l2 controls\n");
 			goto exit;
 		}
-		ret = ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
-				       OV7251_SC_MODE_SELECT_STREAMING);
+
+		ret = ov7251_set_snapshot(ov7251,
+					  ov7251->snapshot_frames->val);
+		if (ret < 0) {
+			dev_err(ov7251->dev, "could not set snapshot mode\n");
+			goto exit;
+		}
+
+		/* in snapshot mode, wait in standby for the first trigger */
+		ov7251->snapshot = ov7251->snapshot_frames->val;
+		if (!ov7251->snapshot)
+			ret = ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
+					       OV7251_SC_MODE_SELECT_STREAMING);
+		if (!ret) {
+			ov7251->streaming = true;
+			__v4l2_ctrl_grab(ov7251->snapshot_frames, true);
+		}
 	} else {
 		ret = ov7251_write_reg(ov7251, OV7251_SC_MODE_SELECT,
 				       OV7251_SC_MODE_SELECT_SW_STANDBY);
+		ov7251->streaming = false;
+		ov7251->snapshot = false;
+		__v4l2_ctrl_grab(ov7251->snapshot_frames, false);
 
 		ov7251_sensor_suspend(ov7251->dev);
 	}
@@ -1462,6 +1656,10 @@ static int ov7251_set_frame_interval(struct v4l2_subdev *subdev,
 			goto exit;
 
 		ov7251->current_mode = new_mode;
+
+		ret = ov7251_set_mode_vblank(ov7251, new_mode);
+		if (ret < 0)
+			goto exit;
 	}
 
 	fi->interval = ov7251->current_mode->timeperframe;
@@ -1523,7 +1721,7 @@ static int ov7251_init_controls(struct ov7251 *ov7251)
 	int hblank;
 	int ret;
 
-	v4l2_ctrl_handler_init(&ov7251->ctrls, 9);
+	v4l2_ctrl_handler_init(&ov7251->ctrls, 11);
 	ov7251->ctrls.lock = &ov7251->lock;
 
 	v4l2_ctrl_new_std(&ov7251->ctrls, &ov7251_ctrl_ops,
@@ -1564,6 +1762,15 @@ static int ov7251_init_controls(struct ov7251 *ov7251)
 					   V4L2_CID_VBLANK, OV7251_VBLANK_MIN,
 					   vblank_max, 1, vblank_def);
 
+	ov7251->snapshot_frames =
+		v4l2_ctrl_new_custom(&ov7251->ctrls,
+				     &ov7251_ctrl_snapshot_frames, NULL);
+	v4l2_ctrl_new_custom(&ov7251->ctrls, &ov7251_ctrl_snapshot_trigger,
+			     NULL);
+
+	/* apply exposure and gain updates together */
+	v4l2_ctrl_cluster(2, &ov7251->exposure);
+
 	ov7251->sd.ctrl_handler = &ov7251->ctrls;
 
 	if (ov7251->ctrls.error) {
@@ -1765,6 +1972,14 @@ static int ov7251_probe(struct i2c_client *client)
 		goto power_down;
 	}
 
+	ret = ov7251_read_reg(ov7251, OV7251_SC_LOW_POWER_CTRL,
+			      &ov7251->sc_low_power);
+	if (ret < 0) {
+		dev_err(dev, "could not read low power control value\n");
+		ret = -ENODEV;
+		goto power_down;
+	}
+
 	ov7251_set_power_off(ov7251);
 
 	ret = v4l2_async_register_subdev(&ov7251->sd);
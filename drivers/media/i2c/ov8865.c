@@ -5,9 +5,12 @@
  * Author: Paul Kocialkowski <paul.kocialkowski@bootlin.com>
  */
 
+#include <linux/acpi.h>
 #include <linux/clk.h>
+#include <linux/completion.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/firmware.h>
 #include <linux/i2c.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
@@ -134,6 +137,14 @@
 #define OV8865_SCLK_CTRL_SCLK_PRE_DIV(v)	(((v) << 2) & GENMASK(3, 2))
 #define OV8865_SCLK_CTRL_UNKNOWN		BIT(0)
 
+/* Group Hold */
+
+#define OV8865_GROUP_ACCESS_REG			0x3208
+#define OV8865_GROUP_ACCESS_HOLD_START		(0x0 << 4)
+#define OV8865_GROUP_ACCESS_HOLD_END		(0x1 << 4)
+#define OV8865_GROUP_ACCESS_LAUNCH		(0xa << 4)
+#define OV8865_GROUP_ACCESS_GROUP(v)		((v) & GENMASK(3, 0))
+
 /* Exposure/gain */
 
 #define OV8865_EXPOSURE_CTRL_HH_REG		0x3500
@@ -329,6 +340,9 @@
 #define OV8865_BLC_OFFSET_LIMIT_REG		0x4034
 #define OV8865_BLC_OFFSET_LIMIT(v)		((v) & GENMASK(7, 0))
 
+#define OV8865_BLC_REG_COUNT			\
+	(OV8865_BLC_OFFSET_LIMIT_REG - OV8865_BLC_CTRL0_REG + 1)
+
 /* VFIFO */
 
 #define OV8865_VFIFO_READ_START_H_REG		0x4600
@@ -433,6 +447,11 @@
 #define OV8865_ISP_GAIN_BLUE_L_REG		0x501d
 #define OV8865_ISP_GAIN_BLUE_L(v)		((v) & GENMASK(5, 0))
 
+/* Lens Correction */
+
+#define OV8865_LENC_TABLE_REG			0x5800
+#define OV8865_LENC_TABLE_SIZE_MAX		0x100
+
 /* VarioPixel */
 
 #define OV8865_VAP_CTRL0_REG			0x5900
@@ -462,6 +481,29 @@
 #define OV8865_ACTIVE_WIDTH			3264
 #define OV8865_ACTIVE_HEIGHT			2448
 
+/* Controls */
+
+/*
+ * The base for the ov8865 driver controls.
+ * We reserve 16 controls for this driver.
+ */
+#define V4L2_CID_OV8865_BASE			(V4L2_CID_USER_BASE + 0x1300)
+#define V4L2_CID_OV8865_LENC			(V4L2_CID_OV8865_BASE + 0)
+#define V4L2_CID_OV8865_DPC_BLACK		(V4L2_CID_OV8865_BASE + 1)
+#define V4L2_CID_OV8865_DPC_WHITE		(V4L2_CID_OV8865_BASE + 2)
+#define V4L2_CID_OV8865_BLC_FILTER		(V4L2_CID_OV8865_BASE + 3)
+#define V4L2_CID_OV8865_BLC_OFFSET_TRIGGER	(V4L2_CID_OV8865_BASE + 4)
+#define V4L2_CID_OV8865_BLC_OFFSET_LIMIT	(V4L2_CID_OV8865_BASE + 5)
+
+/* Firmware */
+
+#define OV8865_LENC_FIRMWARE			"ov8865/lenc.bin"
+#define OV8865_LENC_FIRMWARE_SUB		"ov8865/lenc-%s.bin"
+
+/* Input/Output */
+
+#define OV8865_BURST_SIZE			32
+
 /* Macros */
 
 #define ov8865_subdev_sensor(s) \
@@ -679,10 +721,29 @@ struct ov8865_ctrls {
 	struct v4l2_ctrl *hblank;
 	struct v4l2_ctrl *vblank;
 	struct v4l2_ctrl *exposure;
+	struct v4l2_ctrl *analogue_gain;
+	struct v4l2_ctrl *lenc;
+	struct v4l2_ctrl *blc_filter;
+	struct v4l2_ctrl *blc_offset_trigger;
+	struct v4l2_ctrl *blc_offset_limit;
 
 	struct v4l2_ctrl_handler handler;
 };
 
+struct ov8865_blc_cache {
+	u8 values[OV8865_BLC_REG_COUNT];
+	DECLARE_BITMAP(valid, OV8865_BLC_REG_COUNT);
+};
+
+struct ov8865_lenc {
+	const struct firmware *firmware;
+	struct completion loaded;
+	char name[32];
+	bool fallback;
+	/* The table is in the sensor, until the next reset. */
+	bool uploaded;
+};
+
 struct ov8865_sensor {
 	struct device *dev;
 	struct i2c_client *i2c_client;
@@ -704,6 +765,8 @@ struct ov8865_sensor {
 
 	struct ov8865_state state;
 	struct ov8865_ctrls ctrls;
+	struct ov8865_lenc lenc;
+	struct ov8865_blc_cache blc_cache;
 };
 
 /* Static definitions */
@@ -1384,6 +1447,38 @@ static int ov8865_write(struct ov8865_sensor *sensor, u16 address, u8 value)
 	return 0;
 }
 
+static int ov8865_write_burst(struct ov8865_sensor *sensor, u16 address,
+			     const u8 *values, unsigned int count)
+{
+	unsigned char data[2 + OV8865_BURST_SIZE];
+	struct i2c_client *client = sensor->i2c_client;
+	unsigned int size;
+	int ret;
+
+	/* The register address auto-increments on sequential writes. */
+	while (count) {
+		size = min_t(unsigned int, count, OV8865_BURST_SIZE);
+
+		data[0] = address >> 8;
+		data[1] = address & 0xff;
+		memcpy(&data[2], values, size);
+
+		ret = i2c_master_send(client, data, 2 + size);
+		if (ret < 0) {
+			dev_dbg(&client->dev,
+				"i2c burst send error at address %#04x\n",
+				address);
+			return ret;
+		}
+
+		address += size;
+		values += size;
+		count -= size;
+	}
+
+	return 0;
+}
+
 static int ov8865_write_sequence(struct ov8865_sensor *sensor,
 				 const struct ov8865_register_value *sequence,
 				 unsigned int sequence_count)
@@ -1420,10 +1515,45 @@ static int ov8865_update_bits(struct ov8865_sensor *sensor, u16 address,
 	return ov8865_write(sensor, address, value);
 }
 
+static int ov8865_blc_write(struct ov8865_sensor *sensor, u16 address,
+			    u8 value)
+{
+	struct ov8865_blc_cache *cache = &sensor->blc_cache;
+	unsigned int index = address - OV8865_BLC_CTRL0_REG;
+	int ret;
+
+	if (WARN_ON(index >= OV8865_BLC_REG_COUNT))
+		return -EINVAL;
+
+	/* Skip registers that already hold the requested value. */
+	if (test_bit(index, cache->valid) && cache->values[index] == value)
+		return 0;
+
+	ret = ov8865_write(sensor, address, value);
+	if (ret) {
+		clear_bit(index, cache->valid);
+		return ret;
+	}
+
+	cache->values[index] = value;
+	set_bit(index, cache->valid);
+
+	return 0;
+}
+
+static void ov8865_blc_cache_invalidate(struct ov8865_sensor *sensor)
+{
+	bitmap_zero(sensor->blc_cache.valid, OV8865_BLC_REG_COUNT);
+}
+
 /* Sensor */
 
 static int ov8865_sw_reset(struct ov8865_sensor *sensor)
 {
+	/* Registers are back to their default values after reset. */
+	ov8865_blc_cache_invalidate(sensor);
+	sensor->lenc.uploaded = false;
+
 	return ov8865_write(sensor, OV8865_SW_RESET_REG, OV8865_SW_RESET_RESET);
 }
 
@@ -1518,44 +1648,67 @@ static int ov8865_mipi_configure(struct ov8865_sensor *sensor)
 	return ov8865_write(sensor, OV8865_MIPI_PCLK_PERIOD_REG, 0x16);
 }
 
+static int ov8865_black_level_filter_configure(struct ov8865_sensor *sensor,
+					       bool enable)
+{
+	u8 value;
+
+	/* Trigger BLC on relevant events and optionally enable filter. */
+	value = OV8865_BLC_CTRL0_TRIG_RANGE_EN |
+		OV8865_BLC_CTRL0_TRIG_FORMAT_EN |
+		OV8865_BLC_CTRL0_TRIG_GAIN_EN |
+		OV8865_BLC_CTRL0_TRIG_EXPOSURE_EN;
+
+	if (enable)
+		value |= OV8865_BLC_CTRL0_FILTER_EN;
+
+	return ov8865_blc_write(sensor, OV8865_BLC_CTRL0_REG, value);
+}
+
+static int ov8865_black_level_trigger_configure(struct ov8865_sensor *sensor,
+						u32 trigger)
+{
+	return ov8865_blc_write(sensor, OV8865_BLC_CTRLD_REG,
+				OV8865_BLC_CTRLD_OFFSET_TRIGGER(trigger));
+}
+
+static int ov8865_black_level_limit_configure(struct ov8865_sensor *sensor,
+					      u32 limit)
+{
+	return ov8865_blc_write(sensor, OV8865_BLC_OFFSET_LIMIT_REG,
+				OV8865_BLC_OFFSET_LIMIT(limit));
+}
+
 static int ov8865_black_level_configure(struct ov8865_sensor *sensor)
 {
+	struct ov8865_ctrls *ctrls = &sensor->ctrls;
 	int ret;
 
-	/* Trigger BLC on relevant events and enable filter. */
-	ret = ov8865_write(sensor, OV8865_BLC_CTRL0_REG,
-			   OV8865_BLC_CTRL0_TRIG_RANGE_EN |
-			   OV8865_BLC_CTRL0_TRIG_FORMAT_EN |
-			   OV8865_BLC_CTRL0_TRIG_GAIN_EN |
-			   OV8865_BLC_CTRL0_TRIG_EXPOSURE_EN |
-			   OV8865_BLC_CTRL0_FILTER_EN);
+	ret = ov8865_black_level_filter_configure(sensor,
+						  ctrls->blc_filter->val);
 	if (ret)
 		return ret;
 
-	/* Lower BLC offset trigger threshold. */
-	ret = ov8865_write(sensor, OV8865_BLC_CTRLD_REG,
-			   OV8865_BLC_CTRLD_OFFSET_TRIGGER(16));
+	ret = ov8865_black_level_trigger_configure(sensor,
+						   ctrls->blc_offset_trigger->val);
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_CTRL1F_REG, 0);
+	ret = ov8865_blc_write(sensor, OV8865_BLC_CTRL1F_REG, 0);
 	if (ret)
 		return ret;
 
-	/* Increase BLC offset maximum limit. */
-	return ov8865_write(sensor, OV8865_BLC_OFFSET_LIMIT_REG,
-			    OV8865_BLC_OFFSET_LIMIT(63));
+	return ov8865_black_level_limit_configure(sensor,
+						  ctrls->blc_offset_limit->val);
 }
 
 static int ov8865_isp_configure(struct ov8865_sensor *sensor)
 {
 	int ret;
 
-	/* Disable lens correction. */
+	/* Lens and defect pixel correction are enabled with their controls. */
 	ret = ov8865_write(sensor, OV8865_ISP_CTRL0_REG,
-			   OV8865_ISP_CTRL0_WHITE_BALANCE_EN |
-			   OV8865_ISP_CTRL0_DPC_BLACK_EN |
-			   OV8865_ISP_CTRL0_DPC_WHITE_EN);
+			   OV8865_ISP_CTRL0_WHITE_BALANCE_EN);
 	if (ret)
 		return ret;
 
@@ -1811,99 +1964,99 @@ static int ov8865_mode_black_level_configure(struct ov8865_sensor *sensor,
 	int ret;
 
 	/* Note that a zero value for blc_col_shift_mask is the default 256. */
-	ret = ov8865_write(sensor, OV8865_BLC_CTRL1_REG,
-			   mode->blc_col_shift_mask |
-			   OV8865_BLC_CTRL1_OFFSET_LIMIT_EN);
+	ret = ov8865_blc_write(sensor, OV8865_BLC_CTRL1_REG,
+			       mode->blc_col_shift_mask |
+			       OV8865_BLC_CTRL1_OFFSET_LIMIT_EN);
 	if (ret)
 		return ret;
 
 	/* BLC top zero line */
 
-	ret = ov8865_write(sensor, OV8865_BLC_TOP_ZLINE_START_REG,
-			   OV8865_BLC_TOP_ZLINE_START(mode->blc_top_zero_line_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_TOP_ZLINE_START_REG,
+			       OV8865_BLC_TOP_ZLINE_START(mode->blc_top_zero_line_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_TOP_ZLINE_NUM_REG,
-			   OV8865_BLC_TOP_ZLINE_NUM(mode->blc_top_zero_line_num));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_TOP_ZLINE_NUM_REG,
+			       OV8865_BLC_TOP_ZLINE_NUM(mode->blc_top_zero_line_num));
 	if (ret)
 		return ret;
 
 	/* BLC top black line */
 
-	ret = ov8865_write(sensor, OV8865_BLC_TOP_BLKLINE_START_REG,
-			   OV8865_BLC_TOP_BLKLINE_START(mode->blc_top_black_line_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_TOP_BLKLINE_START_REG,
+			       OV8865_BLC_TOP_BLKLINE_START(mode->blc_top_black_line_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_TOP_BLKLINE_NUM_REG,
-			   OV8865_BLC_TOP_BLKLINE_NUM(mode->blc_top_black_line_num));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_TOP_BLKLINE_NUM_REG,
+			       OV8865_BLC_TOP_BLKLINE_NUM(mode->blc_top_black_line_num));
 	if (ret)
 		return ret;
 
 	/* BLC bottom zero line */
 
-	ret = ov8865_write(sensor, OV8865_BLC_BOT_ZLINE_START_REG,
-			   OV8865_BLC_BOT_ZLINE_START(mode->blc_bottom_zero_line_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_BOT_ZLINE_START_REG,
+			       OV8865_BLC_BOT_ZLINE_START(mode->blc_bottom_zero_line_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_BOT_ZLINE_NUM_REG,
-			   OV8865_BLC_BOT_ZLINE_NUM(mode->blc_bottom_zero_line_num));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_BOT_ZLINE_NUM_REG,
+			       OV8865_BLC_BOT_ZLINE_NUM(mode->blc_bottom_zero_line_num));
 	if (ret)
 		return ret;
 
 	/* BLC bottom black line */
 
-	ret = ov8865_write(sensor, OV8865_BLC_BOT_BLKLINE_START_REG,
-			   OV8865_BLC_BOT_BLKLINE_START(mode->blc_bottom_black_line_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_BOT_BLKLINE_START_REG,
+			       OV8865_BLC_BOT_BLKLINE_START(mode->blc_bottom_black_line_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_BOT_BLKLINE_NUM_REG,
-			   OV8865_BLC_BOT_BLKLINE_NUM(mode->blc_bottom_black_line_num));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_BOT_BLKLINE_NUM_REG,
+			       OV8865_BLC_BOT_BLKLINE_NUM(mode->blc_bottom_black_line_num));
 	if (ret)
 		return ret;
 
 	/* BLC anchor */
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_LEFT_START_H_REG,
-			   OV8865_BLC_ANCHOR_LEFT_START_H(mode->blc_anchor_left_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_LEFT_START_H_REG,
+			       OV8865_BLC_ANCHOR_LEFT_START_H(mode->blc_anchor_left_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_LEFT_START_L_REG,
-			   OV8865_BLC_ANCHOR_LEFT_START_L(mode->blc_anchor_left_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_LEFT_START_L_REG,
+			       OV8865_BLC_ANCHOR_LEFT_START_L(mode->blc_anchor_left_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_LEFT_END_H_REG,
-			   OV8865_BLC_ANCHOR_LEFT_END_H(mode->blc_anchor_left_end));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_LEFT_END_H_REG,
+			       OV8865_BLC_ANCHOR_LEFT_END_H(mode->blc_anchor_left_end));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_LEFT_END_L_REG,
-			   OV8865_BLC_ANCHOR_LEFT_END_L(mode->blc_anchor_left_end));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_LEFT_END_L_REG,
+			       OV8865_BLC_ANCHOR_LEFT_END_L(mode->blc_anchor_left_end));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_RIGHT_START_H_REG,
-			   OV8865_BLC_ANCHOR_RIGHT_START_H(mode->blc_anchor_right_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_RIGHT_START_H_REG,
+			       OV8865_BLC_ANCHOR_RIGHT_START_H(mode->blc_anchor_right_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_RIGHT_START_L_REG,
-			   OV8865_BLC_ANCHOR_RIGHT_START_L(mode->blc_anchor_right_start));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_RIGHT_START_L_REG,
+			       OV8865_BLC_ANCHOR_RIGHT_START_L(mode->blc_anchor_right_start));
 	if (ret)
 		return ret;
 
-	ret = ov8865_write(sensor, OV8865_BLC_ANCHOR_RIGHT_END_H_REG,
-			   OV8865_BLC_ANCHOR_RIGHT_END_H(mode->blc_anchor_right_end));
+	ret = ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_RIGHT_END_H_REG,
+			       OV8865_BLC_ANCHOR_RIGHT_END_H(mode->blc_anchor_right_end));
 	if (ret)
 		return ret;
 
-	return ov8865_write(sensor, OV8865_BLC_ANCHOR_RIGHT_END_L_REG,
-			    OV8865_BLC_ANCHOR_RIGHT_END_L(mode->blc_anchor_right_end));
+	return ov8865_blc_write(sensor, OV8865_BLC_ANCHOR_RIGHT_END_L_REG,
+			OV8865_BLC_ANCHOR_RIGHT_END_L(mode->blc_anchor_right_end));
 }
 
 static int ov8865_mode_configure(struct ov8865_sensor *sensor,
@@ -2120,6 +2273,30 @@ static unsigned long ov8865_mode_mipi_clk_rate(struct ov8865_sensor *sensor,
 	return pll1_rate / config->m_div / 2;
 }
 
+/* Group Hold */
+
+static int ov8865_group_hold_start(struct ov8865_sensor *sensor)
+{
+	return ov8865_write(sensor, OV8865_GROUP_ACCESS_REG,
+			    OV8865_GROUP_ACCESS_HOLD_START |
+			    OV8865_GROUP_ACCESS_GROUP(0));
+}
+
+static int ov8865_group_hold_launch(struct ov8865_sensor *sensor)
+{
+	int ret;
+
+	ret = ov8865_write(sensor, OV8865_GROUP_ACCESS_REG,
+			   OV8865_GROUP_ACCESS_HOLD_END |
+			   OV8865_GROUP_ACCESS_GROUP(0));
+	if (ret)
+		return ret;
+
+	return ov8865_write(sensor, OV8865_GROUP_ACCESS_REG,
+			    OV8865_GROUP_ACCESS_LAUNCH |
+			    OV8865_GROUP_ACCESS_GROUP(0));
+}
+
 /* Exposure */
 
 static int ov8865_exposure_configure(struct ov8865_sensor *sensor, u32 exposure)
@@ -2158,6 +2335,47 @@ static int ov8865_analog_gain_configure(struct ov8865_sensor *sensor, u32 gain)
 			    OV8865_GAIN_CTRL_L(gain));
 }
 
+/* Exposure and Gain */
+
+static int ov8865_exposure_gain_configure(struct ov8865_sensor *sensor)
+{
+	struct ov8865_ctrls *ctrls = &sensor->ctrls;
+	bool hold = sensor->state.streaming;
+	int ret = 0, launch_ret;
+
+	/*
+	 * While streaming, write the cluster as a single register group so
+	 * that the sensor applies it at one frame boundary. Exposure then
+	 * takes effect two frames after the launch and gain one frame after,
+	 * which userspace has to account for when pairing stats and settings.
+	 */
+	if (hold) {
+		ret = ov8865_group_hold_start(sensor);
+		if (ret)
+			return ret;
+	}
+
+	if (ctrls->exposure->is_new) {
+		ret = ov8865_exposure_configure(sensor, ctrls->exposure->val);
+		if (ret)
+			goto launch;
+	}
+
+	if (ctrls->analogue_gain->is_new)
+		ret = ov8865_analog_gain_configure(sensor,
+						   ctrls->analogue_gain->val);
+
+launch:
+	/* Close the group after an error too, it would hold later writes. */
+	if (hold) {
+		launch_ret = ov8865_group_hold_launch(sensor);
+		if (!ret)
+			ret = launch_ret;
+	}
+
+	return ret;
+}
+
 /* White Balance */
 
 static int ov8865_red_balance_configure(struct ov8865_sensor *sensor,
@@ -2220,18 +2438,89 @@ static int ov8865_test_pattern_configure(struct ov8865_sensor *sensor,
 			    ov8865_test_pattern_bits[index]);
 }
 
+/* Defect Pixel Correction */
+
+static int ov8865_dpc_configure(struct ov8865_sensor *sensor, u8 bits,
+				bool enable)
+{
+	return ov8865_update_bits(sensor, OV8865_ISP_CTRL0_REG, bits,
+				  enable ? bits : 0);
+}
+
+/* Lens Correction */
+
+static int ov8865_lenc_upload(struct ov8865_sensor *sensor)
+{
+	struct ov8865_lenc *lenc = &sensor->lenc;
+	int ret;
+
+	if (!lenc->firmware || lenc->uploaded)
+		return 0;
+
+	ret = ov8865_write_burst(sensor, OV8865_LENC_TABLE_REG,
+				 lenc->firmware->data, lenc->firmware->size);
+	if (ret)
+		return ret;
+
+	lenc->uploaded = true;
+
+	return 0;
+}
+
+static int ov8865_lenc_configure(struct ov8865_sensor *sensor, bool enable)
+{
+	bool hold = sensor->state.streaming;
+	int ret, launch_ret;
+
+	/* The table is uploaded once per power-on, only toggle it here. */
+	if (!sensor->lenc.uploaded)
+		enable = false;
+
+	if (hold) {
+		ret = ov8865_group_hold_start(sensor);
+		if (ret)
+			return ret;
+	}
+
+	ret = ov8865_update_bits(sensor, OV8865_ISP_CTRL0_REG,
+				 OV8865_ISP_CTRL0_LENC_EN,
+				 enable ? OV8865_ISP_CTRL0_LENC_EN : 0);
+
+	if (hold) {
+		launch_ret = ov8865_group_hold_launch(sensor);
+		if (!ret)
+			ret = launch_ret;
+	}
+
+	return ret;
+}
+
 /* Blanking */
 
 static int ov8865_vts_configure(struct ov8865_sensor *sensor, u32 vblank)
 {
 	u16 vts = sensor->state.mode->output_size_y + vblank;
-	int ret;
+	bool hold = sensor->state.streaming;
+	int ret, launch_ret;
+
+	/* Keep both halves of VTS within the same frame while streaming. */
+	if (hold) {
+		ret = ov8865_group_hold_start(sensor);
+		if (ret)
+			return ret;
+	}
 
 	ret = ov8865_write(sensor, OV8865_VTS_H_REG, OV8865_VTS_H(vts));
-	if (ret)
-		return ret;
+	if (!ret)
+		ret = ov8865_write(sensor, OV8865_VTS_L_REG, OV8865_VTS_L(vts));
 
-	return ov8865_write(sensor, OV8865_VTS_L_REG, OV8865_VTS_L(vts));
+	if (hold) {
+		launch_ret = ov8865_group_hold_launch(sensor);
+		if (!ret)
+			ret = launch_ret;
+	}
+
+	return ret;
 }
 
 /* State */
@@ -2383,6 +2672,12 @@ static int ov8865_sensor_init(struct ov8865_sensor *sensor)
 		return ret;
 	}
 
+	ret = ov8865_lenc_upload(sensor);
+	if (ret) {
+		dev_err(sensor->dev, "failed to upload lens correction table\n");
+		return ret;
+	}
+
 	/* Configure current mode. */
 	ret = ov8865_state_configure(sensor, sensor->state.mode,
 				     sensor->state.mbus_code);
@@ -2450,6 +2745,131 @@ disable:
 	return ret;
 }
 
+/* Firmware */
+
+static void ov8865_lenc_firmware_callback(const struct firmware *firmware,
+					  void *context)
+{
+	struct ov8865_sensor *sensor = context;
+	struct ov8865_lenc *lenc = &sensor->lenc;
+	int ret;
+
+	if (!firmware && !lenc->fallback) {
+		lenc->fallback = true;
+
+		ret = firmware_request_nowait_nowarn(THIS_MODULE,
+						     OV8865_LENC_FIRMWARE,
+						     sensor->dev, GFP_KERNEL,
+						     sensor,
+						     ov8865_lenc_firmware_callback);
+		if (!ret)
+			return;
+	}
+
+	if (!firmware) {
+		dev_dbg(sensor->dev, "no lens correction table available\n");
+		goto complete;
+	}
+
+	if (!firmware->size || firmware->size > OV8865_LENC_TABLE_SIZE_MAX) {
+		dev_err(sensor->dev,
+			"invalid lens correction table size: %zu\n",
+			firmware->size);
+		release_firmware(firmware);
+		goto complete;
+	}
+
+	mutex_lock(&sensor->mutex);
+
+	lenc->firmware = firmware;
+
+	/*
+	 * Apply the table right away if the sensor is already running. The
+	 * correction is off until then, so the upload doesn't show in the
+	 * frames, and enabling it is launched at a frame boundary.
+	 */
+	if (pm_runtime_get_if_in_use(sensor->dev) > 0) {
+		ret = ov8865_lenc_upload(sensor);
+		if (!ret)
+			ret = ov8865_lenc_configure(sensor,
+						    sensor->ctrls.lenc->val);
+		if (ret)
+			dev_err(sensor->dev,
+				"failed to configure lens correction\n");
+
+		pm_runtime_put(sensor->dev);
+	}
+
+	mutex_unlock(&sensor->mutex);
+
+complete:
+	complete(&lenc->loaded);
+}
+
+static void ov8865_lenc_firmware_name(struct ov8865_sensor *sensor)
+{
+	struct ov8865_lenc *lenc = &sensor->lenc;
+#if IS_ENABLED(CONFIG_ACPI)
+	struct acpi_buffer buffer = { ACPI_ALLOCATE_BUFFER, NULL };
+	acpi_handle handle = ACPI_HANDLE(sensor->dev);
+	union acpi_object *object;
+	acpi_status status;
+
+	/* Tables are calibrated per module, which _SUB identifies. */
+	if (handle) {
+		status = acpi_evaluate_object(handle, "_SUB", NULL, &buffer);
+		if (ACPI_SUCCESS(status)) {
+			object = buffer.pointer;
+
+			if (object->type == ACPI_TYPE_STRING) {
+				snprintf(lenc->name, sizeof(lenc->name),
+					 OV8865_LENC_FIRMWARE_SUB,
+					 object->string.pointer);
+				kfree(buffer.pointer);
+				return;
+			}
+
+			kfree(buffer.pointer);
+		}
+	}
+#endif
+
+	strscpy(lenc->name, OV8865_LENC_FIRMWARE, sizeof(lenc->name));
+	lenc->fallback = true;
+}
+
+static int ov8865_lenc_firmware_request(struct ov8865_sensor *sensor)
+{
+	struct ov8865_lenc *lenc = &sensor->lenc;
+	int ret;
+
+	init_completion(&lenc->loaded);
+
+	ov8865_lenc_firmware_name(sensor);
+
+	/*
+	 * Loading is asynchronous so that probe and streaming don't wait,
+	 * and without the sysfs fallback so that a missing table doesn't
+	 * wait for the user helper timeout: the table is optional.
+	 */
+	ret = firmware_request_nowait_nowarn(THIS_MODULE, lenc->name,
+					     sensor->dev, GFP_KERNEL, sensor,
+					     ov8865_lenc_firmware_callback);
+	if (ret)
+		complete(&lenc->loaded);
+
+	return ret;
+}
+
+static void ov8865_lenc_firmware_release(struct ov8865_sensor *sensor)
+{
+	struct ov8865_lenc *lenc = &sensor->lenc;
+
+	wait_for_completion(&lenc->loaded);
+	release_firmware(lenc->firmware);
+	lenc->firmware = NULL;
+}
+
 /* Controls */
 
 static int ov8865_s_ctrl(struct v4l2_ctrl *ctrl)
@@ -2479,12 +2899,8 @@ static int ov8865_s_ctrl(struct v4l2_ctrl *ctrl)
 
 	switch (ctrl->id) {
 	case V4L2_CID_EXPOSURE:
-		ret = ov8865_exposure_configure(sensor, ctrl->val);
-		if (ret)
-			return ret;
-		break;
-	case V4L2_CID_ANALOGUE_GAIN:
-		ret = ov8865_analog_gain_configure(sensor, ctrl->val);
+		/* Exposure is the master of the exposure and gain cluster. */
+		ret = ov8865_exposure_gain_configure(sensor);
 		if (ret)
 			return ret;
 		break;
@@ -2501,6 +2917,23 @@ static int ov8865_s_ctrl(struct v4l2_ctrl *ctrl)
 		return ov8865_test_pattern_configure(sensor, index);
 	case V4L2_CID_VBLANK:
 		return ov8865_vts_configure(sensor, ctrl->val);
+	case V4L2_CID_OV8865_LENC:
+		return ov8865_lenc_configure(sensor, !!ctrl->val);
+	case V4L2_CID_OV8865_DPC_BLACK:
+		return ov8865_dpc_configure(sensor,
+					    OV8865_ISP_CTRL0_DPC_BLACK_EN,
+					    !!ctrl->val);
+	case V4L2_CID_OV8865_DPC_WHITE:
+		return ov8865_dpc_configure(sensor,
+					    OV8865_ISP_CTRL0_DPC_WHITE_EN,
+					    !!ctrl->val);
+	case V4L2_CID_OV8865_BLC_FILTER:
+		return ov8865_black_level_filter_configure(sensor,
+							   !!ctrl->val);
+	case V4L2_CID_OV8865_BLC_OFFSET_TRIGGER:
+		return ov8865_black_level_trigger_configure(sensor, ctrl->val);
+	case V4L2_CID_OV8865_BLC_OFFSET_LIMIT:
+		return ov8865_black_level_limit_configure(sensor, ctrl->val);
 	default:
 		return -EINVAL;
 	}
@@ -2512,6 +2945,74 @@ static const struct v4l2_ctrl_ops ov8865_ctrl_ops = {
 	.s_ctrl			= ov8865_s_ctrl,
 };
 
+static const struct v4l2_ctrl_config ov8865_ctrl_lenc = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_LENC,
+	.name	= "Lens Shading Correction",
+	.type	= V4L2_CTRL_TYPE_BOOLEAN,
+	.min	= 0,
+	.max	= 1,
+	.step	= 1,
+	.def	= 1,
+};
+
+static const struct v4l2_ctrl_config ov8865_ctrl_dpc_black = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_DPC_BLACK,
+	.name	= "Defect Pixel Correction, Black",
+	.type	= V4L2_CTRL_TYPE_BOOLEAN,
+	.min	= 0,
+	.max	= 1,
+	.step	= 1,
+	.def	= 1,
+};
+
+static const struct v4l2_ctrl_config ov8865_ctrl_dpc_white = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_DPC_WHITE,
+	.name	= "Defect Pixel Correction, White",
+	.type	= V4L2_CTRL_TYPE_BOOLEAN,
+	.min	= 0,
+	.max	= 1,
+	.step	= 1,
+	.def	= 1,
+};
+
+static const struct v4l2_ctrl_config ov8865_ctrl_blc_filter = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_BLC_FILTER,
+	.name	= "Black Level Filter",
+	.type	= V4L2_CTRL_TYPE_BOOLEAN,
+	.min	= 0,
+	.max	= 1,
+	.step	= 1,
+	.def	= 1,
+};
+
+/* A lower trigger threshold than the default reacts to smaller drifts. */
+static const struct v4l2_ctrl_config ov8865_ctrl_blc_offset_trigger = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_BLC_OFFSET_TRIGGER,
+	.name	= "Black Level Offset Trigger",
+	.type	= V4L2_CTRL_TYPE_INTEGER,
+	.min	= 0,
+	.max	= 255,
+	.step	= 1,
+	.def	= 16,
+};
+
+/* A higher maximum offset than the default avoids clipping correction. */
+static const struct v4l2_ctrl_config ov8865_ctrl_blc_offset_limit = {
+	.ops	= &ov8865_ctrl_ops,
+	.id	= V4L2_CID_OV8865_BLC_OFFSET_LIMIT,
+	.name	= "Black Level Offset Limit",
+	.type	= V4L2_CTRL_TYPE_INTEGER,
+	.min	= 0,
+	.max	= 255,
+	.step	= 1,
+	.def	= 63,
+};
+
 static int ov8865_ctrls_init(struct ov8865_sensor *sensor)
 {
 	struct ov8865_ctrls *ctrls = &sensor->ctrls;
@@ -2535,8 +3036,9 @@ static int ov8865_ctrls_init(struct ov8865_sensor *sensor)
 
 	/* Gain */
 
-	v4l2_ctrl_new_std(handler, ops, V4L2_CID_ANALOGUE_GAIN, 128, 2048, 128,
-			  128);
+	ctrls->analogue_gain = v4l2_ctrl_new_std(handler, ops,
+						 V4L2_CID_ANALOGUE_GAIN, 128,
+						 2048, 128, 128);
 
 	/* White Balance */
 
@@ -2546,6 +3048,26 @@ static int ov8865_ctrls_init(struct ov8865_sensor *sensor)
 	v4l2_ctrl_new_std(handler, ops, V4L2_CID_BLUE_BALANCE, 1, 32767, 1,
 			  1024);
 
+	/* Lens Correction */
+
+	ctrls->lenc = v4l2_ctrl_new_custom(handler, &ov8865_ctrl_lenc, NULL);
+
+	/* Defect Pixel Correction */
+
+	v4l2_ctrl_new_custom(handler, &ov8865_ctrl_dpc_black, NULL);
+	v4l2_ctrl_new_custom(handler, &ov8865_ctrl_dpc_white, NULL);
+
+	/* Black Level */
+
+	ctrls->blc_filter =
+		v4l2_ctrl_new_custom(handler, &ov8865_ctrl_blc_filter, NULL);
+	ctrls->blc_offset_trigger =
+		v4l2_ctrl_new_custom(handler, &ov8865_ctrl_blc_offset_trigger,
+				     NULL);
+	ctrls->blc_offset_limit =
+		v4l2_ctrl_new_custom(handler, &ov8865_ctrl_blc_offset_limit,
+				     NULL);
+
 	/* Flip */
 
 	v4l2_ctrl_new_std(handler, ops, V4L2_CID_HFLIP, 0, 1, 1, 0);
@@ -2599,6 +3121,9 @@ static int ov8865_ctrls_init(struct ov8865_sensor *sensor)
 	ctrls->link_freq->flags |= V4L2_CTRL_FLAG_READ_ONLY;
 	ctrls->pixel_rate->flags |= V4L2_CTRL_FLAG_READ_ONLY;
 
+	/* Apply exposure and gain updates together. */
+	v4l2_ctrl_cluster(2, &ctrls->exposure);
+
 	sensor->subdev.ctrl_handler = handler;
 
 	return 0;
@@ -3086,6 +3611,12 @@ static int ov8865_probe(struct i2c_client *client)
 	pm_runtime_set_suspended(sensor->dev);
 	pm_runtime_enable(sensor->dev);
 
+	/* Lens Correction */
+
+	ret = ov8865_lenc_firmware_request(sensor);
+	if (ret)
+		dev_warn(dev, "failed to request lens correction table\n");
+
 	/* V4L2 subdev register */
 
 	ret = v4l2_async_register_subdev_sensor(subdev);
@@ -3095,6 +3626,7 @@ static int ov8865_probe(struct i2c_client *client)
 	return 0;
 
 error_pm:
+	ov8865_lenc_firmware_release(sensor);
 	pm_runtime_disable(sensor->dev);
 
 error_ctrls:
@@ -3118,6 +3650,7 @@ static int ov8865_remove(struct i2c_client *client)
 	struct ov8865_sensor *sensor = ov8865_subdev_sensor(subdev);
 
 	v4l2_async_unregister_subdev(subdev);
+	ov8865_lenc_firmware_release(sensor);
 	pm_runtime_disable(sensor->dev);
 	v4l2_ctrl_handler_free(&sensor->ctrls.handler);
 	mutex_destroy(&sensor->mutex);
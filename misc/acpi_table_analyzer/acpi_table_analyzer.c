@@ -0,0 +1,995 @@
+/**
+ * This tool extracts the camera related ACPI data (SSDB, CLDB, _DSM, _CRS,
+ * _PLD, _DEP...) from DSDT/SSDT dumps without loading any kernel module,
+ * which also works on machines locked down against unsigned modules.
+ *
+ * Input can be /sys/firmware/acpi/tables, a directory of binary tables
+ * (as written by `acpidump -b`), an acpidump text file, or a directory
+ * holding one such dump per machine. Machines are analyzed in parallel.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "aml.h"
+#include "ipu_acpi_fields.h"
+
+#define MAX_TABLES	64
+#define MAX_DSM_GUIDS	8
+#define MAX_DSM_FUNCS	32
+#define PATH_BUF_SIZE	4096
+
+/* _DSM GUIDs whose function 1 returns the number of data functions */
+static const char * const counted_dsm_guids[] = {
+	"26257549-9271-4ca4-bb43-c4899d5a4881",	/* I2C devices */
+	"79234640-9e10-4fea-a5c1-b5aa8b19756f",	/* PMIC GPIOs */
+};
+
+/* objects dumped for each device, in this order */
+static const char * const device_objects[] = {
+	"_HID", "_CID", "_UID", "_ADR", "_DDN", "_SUB", "_STA",
+	"_CRS", "_PLD", "SSDB", "CLDB",
+};
+
+struct machine {
+	const char *path;
+	char *path_buf;			/* path, if allocated */
+	struct aml_table tables[MAX_TABLES];
+	int table_count;
+	int device_count;
+	FILE *out;
+	FILE *log;
+	char *out_buf;
+	size_t out_len;
+	char *log_buf;
+	size_t log_len;
+};
+
+static struct machine *machines;
+static int machine_count;
+static int next_machine;
+static int json_output;
+
+/*
+ * Table loading
+ */
+static uint8_t *read_file(const char *path, size_t *len)
+{
+	uint8_t *data = NULL;
+	size_t size = 0;
+	FILE *file;
+	size_t n;
+
+	file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+
+	/* sysfs reports a size of 0 for tables, read until EOF */
+	*len = 0;
+	do {
+		if (*len == size) {
+			uint8_t *tmp;
+
+			size = size ? size * 2 : 65536;
+			tmp = realloc(data, size);
+			if (!tmp) {
+				free(data);
+				fclose(file);
+				return NULL;
+			}
+			data = tmp;
+		}
+		n = fread(data + *len, 1, size - *len, file);
+		*len += n;
+	} while (n);
+
+	fclose(file);
+	return data;
+}
+
+/* Takes ownership of @data */
+static void add_table(struct machine *m, const char *name, uint8_t *data,
+		      size_t len)
+{
+	struct aml_table *table;
+	uint32_t table_len;
+	uint8_t sum = 0;
+	size_t i;
+
+	if (len < AML_TABLE_HEADER_SIZE ||
+	    (memcmp(data, "DSDT", 4) && memcmp(data, "SSDT", 4))) {
+		free(data);
+		return;
+	}
+
+	table_len = data[4] | data[5] << 8 | data[6] << 16 |
+		    (uint32_t)data[7] << 24;
+	if (table_len < AML_TABLE_HEADER_SIZE || table_len > len) {
+		fprintf(m->log, "%s: truncated %.4s, skipping\n", name, data);
+		free(data);
+		return;
+	}
+
+	if (m->table_count == MAX_TABLES) {
+		fprintf(m->log, "%s: too many tables, skipping\n", name);
+		free(data);
+		return;
+	}
+
+	for (i = 0; i < table_len; i++)
+		sum += data[i];
+	if (sum)
+		fprintf(m->log, "%s: bad %.4s checksum, using it anyway\n",
+			name, data);
+
+	table = &m->tables[m->table_count++];
+	table->data = data;
+	table->len = table_len;
+	memcpy(table->signature, data, 4);
+	table->signature[4] = '\0';
+	memcpy(table->oem_table_id, data + 16, 8);
+	table->oem_table_id[8] = '\0';
+}
+
+static int is_binary_table(const uint8_t *data, size_t len)
+{
+	uint32_t table_len;
+
+	if (len < AML_TABLE_HEADER_SIZE)
+		return 0;
+
+	table_len = data[4] | data[5] << 8 | data[6] << 16 |
+		    (uint32_t)data[7] << 24;
+	return table_len >= AML_TABLE_HEADER_SIZE && table_len <= len;
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* " hh" followed by a space or the end of the line */
+static int hex_byte(const char *p, const char *eol)
+{
+	if (eol - p < 3 || p[0] != ' ' ||
+	    hex_value(p[1]) < 0 || hex_value(p[2]) < 0)
+		return -1;
+	if (eol - p > 3 && p[3] != ' ' && p[3] != '\r')
+		return -1;
+
+	return hex_value(p[1]) << 4 | hex_value(p[2]);
+}
+
+/*
+ * acpidump text output: a "DSDT @ 0x..." line followed by lines such as
+ *   0000: 44 53 44 54 ...  DSDT....
+ * where the ASCII column is separated by two spaces.
+ */
+static void load_acpidump_text(struct machine *m, const char *path,
+			       const uint8_t *text, size_t len)
+{
+	const char *p = (const char *)text;
+	const char *end = p + len;
+	uint8_t *data = NULL;
+	size_t data_len = 0;
+	size_t size = 0;
+
+	while (p < end) {
+		const char *eol = memchr(p, '\n', end - p);
+		const char *q = p;
+		int byte;
+
+		if (!eol)
+			eol = end;
+
+		while (q < eol && (*q == ' ' || *q == '\t'))
+			q++;
+		while (q < eol && hex_value(*q) >= 0)
+			q++;
+
+		if (q > p && q < eol && *q == ':' && data) {
+			for (q++; (byte = hex_byte(q, eol)) >= 0; q += 3) {
+				if (data_len == size) {
+					uint8_t *tmp;
+
+					size *= 2;
+					tmp = realloc(data, size);
+					if (!tmp)
+						goto out;
+					data = tmp;
+				}
+				data[data_len++] = byte;
+			}
+		} else if (eol - p > 7 && memmem(p, eol - p, " @ 0x", 5)) {
+			/* start of a new table */
+			if (data)
+				add_table(m, path, data, data_len);
+			size = 65536;
+			data_len = 0;
+			data = malloc(size);
+			if (!data)
+				return;
+		}
+
+		p = eol + 1;
+	}
+
+	if (data) {
+		add_table(m, path, data, data_len);
+		data = NULL;
+	}
+out:
+	free(data);
+}
+
+static void load_file(struct machine *m, const char *path)
+{
+	uint8_t *data;
+	size_t len;
+
+	data = read_file(path, &len);
+	if (!data) {
+		fprintf(m->log, "%s: can't read file\n", path);
+		return;
+	}
+
+	/*
+	 * acpidump text output also starts with the signature, but not with
+	 * a valid table length
+	 */
+	if (!is_binary_table(data, len) &&
+	    memmem(data, len < 4096 ? len : 4096, " @ 0x", 5)) {
+		load_acpidump_text(m, path, data, len);
+		free(data);
+		return;
+	}
+
+	add_table(m, path, data, len);
+}
+
+static int is_dir(const char *path)
+{
+	struct stat st;
+
+	return !stat(path, &st) && S_ISDIR(st.st_mode);
+}
+
+static int has_files(const char *dir)
+{
+	char path[PATH_BUF_SIZE];
+	struct dirent *ent;
+	int found = 0;
+	DIR *d;
+
+	d = opendir(dir);
+	if (!d)
+		return 0;
+
+	while (!found && (ent = readdir(d))) {
+		if (ent->d_name[0] == '.')
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		found = !is_dir(path);
+	}
+
+	closedir(d);
+	return found;
+}
+
+/* Tables of a single machine, SSDTs loaded at runtime are in "dynamic" */
+static void load_dir(struct machine *m, const char *dir)
+{
+	char path[PATH_BUF_SIZE];
+	struct dirent **ents;
+	int n, i;
+
+	n = scandir(dir, &ents, NULL, alphasort);
+	if (n < 0) {
+		fprintf(m->log, "%s: can't open directory\n", dir);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (ents[i]->d_name[0] != '.') {
+			snprintf(path, sizeof(path), "%s/%s", dir,
+				 ents[i]->d_name);
+			if (!is_dir(path))
+				load_file(m, path);
+			else if (!strcmp(ents[i]->d_name, "dynamic"))
+				load_dir(m, path);
+		}
+		free(ents[i]);
+	}
+
+	free(ents);
+}
+
+/*
+ * Output
+ */
+static void print_path(FILE *out, const struct aml_ns *ns, int node)
+{
+	char path[PATH_BUF_SIZE];
+
+	aml_ns_path(ns, node, path, sizeof(path));
+	fputs(path, out);
+}
+
+static void print_guid(FILE *out, const uint8_t *g)
+{
+	fprintf(out, "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+		g[3], g[2], g[1], g[0], g[5], g[4], g[7], g[6],
+		g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15]);
+}
+
+static void json_string(FILE *out, const uint8_t *str, size_t len)
+{
+	size_t i;
+
+	fputc('"', out);
+	for (i = 0; i < len && str[i]; i++) {
+		if (str[i] == '"' || str[i] == '\\')
+			fprintf(out, "\\%c", str[i]);
+		else if (str[i] < 0x20 || str[i] >= 0x7f)
+			fprintf(out, "\\u%04x", str[i]);
+		else
+			fputc(str[i], out);
+	}
+	fputc('"', out);
+}
+
+static void json_path(FILE *out, const struct aml_ns *ns, int node)
+{
+	char path[PATH_BUF_SIZE];
+
+	aml_ns_path(ns, node, path, sizeof(path));
+	json_string(out, (const uint8_t *)path, strlen(path));
+}
+
+/* Integers as numbers, strings as strings and buffers as hex strings */
+static void json_value(FILE *out, const struct aml_ns *ns,
+		       const struct aml_value *val)
+{
+	size_t i;
+
+	switch (val->type) {
+	case AML_INTEGER:
+		fprintf(out, "%llu", (unsigned long long)val->integer);
+		break;
+	case AML_STRING:
+		json_string(out, val->data, val->len);
+		break;
+	case AML_BUFFER:
+		fputc('"', out);
+		for (i = 0; i < val->len; i++)
+			fprintf(out, "%02x", val->data[i]);
+		fputc('"', out);
+		break;
+	case AML_PACKAGE:
+		fputc('[', out);
+		for (i = 0; i < val->count; i++) {
+			if (i)
+				fputs(", ", out);
+			json_value(out, ns, &val->elements[i]);
+		}
+		fputc(']', out);
+		break;
+	case AML_REFERENCE:
+		if (val->node >= 0)
+			json_path(out, ns, val->node);
+		else
+			json_string(out, val->data, val->len);
+		break;
+	default:
+		fputs("null", out);
+		break;
+	}
+}
+
+static void print_hex(FILE *out, const uint8_t *data, size_t len, int indent)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (!(i % 16))
+			fprintf(out, "%*s%04zx:", indent, "", i);
+		fprintf(out, " %02x", data[i]);
+		if (i % 16 == 15 || i == len - 1)
+			fputc('\n', out);
+	}
+}
+
+static void print_value(FILE *out, const struct aml_ns *ns,
+			const struct aml_value *val, int indent)
+{
+	size_t i;
+
+	switch (val->type) {
+	case AML_INTEGER:
+		fprintf(out, "0x%llx\n", (unsigned long long)val->integer);
+		break;
+	case AML_STRING:
+		fprintf(out, "\"%s\"\n", val->data);
+		break;
+	case AML_BUFFER:
+		fprintf(out, "buffer[%zu]\n", val->len);
+		print_hex(out, val->data, val->len, indent + 2);
+		break;
+	case AML_PACKAGE:
+		fprintf(out, "package[%zu]\n", val->count);
+		for (i = 0; i < val->count; i++) {
+			fprintf(out, "%*s[%zu]: ", indent + 2, "", i);
+			print_value(out, ns, &val->elements[i], indent + 2);
+		}
+		break;
+	case AML_REFERENCE:
+		if (val->node >= 0)
+			print_path(out, ns, val->node);
+		else
+			fprintf(out, "%.*s (unresolved)", (int)val->len,
+				val->data);
+		fputc('\n', out);
+		break;
+	default:
+		fputs("none\n", out);
+		break;
+	}
+}
+
+static void print_fields(FILE *out, const struct ipu_field *table,
+			 const struct aml_value *val, int indent)
+{
+	const struct ipu_field *f;
+	const char *name;
+	uint32_t field;
+
+	ipu_for_each_field(f, table, val->len) {
+		if (f->kind == IPU_FIELD_BYTES)
+			continue;
+
+		field = ipu_field_value(f, val->data);
+		fprintf(out, "%*s%s: %u", indent, "", f->name, field);
+		name = ipu_field_value_name(f, field);
+		if (name)
+			fprintf(out, " (%s)", name);
+		if (!ipu_field_valid(f, field))
+			fputs(" (out of range)", out);
+		fputc('\n', out);
+	}
+}
+
+/*
+ * Analysis
+ */
+struct dsm_result {
+	uint8_t guid[AML_GUID_SIZE];
+	uint64_t func;
+	enum aml_status status;
+	struct aml_value val;
+};
+
+struct device_report {
+	int node;
+	struct aml_value objects[sizeof(device_objects) /
+				 sizeof(device_objects[0])];
+	enum aml_status status[sizeof(device_objects) /
+			       sizeof(device_objects[0])];
+	int present[sizeof(device_objects) / sizeof(device_objects[0])];
+	enum aml_status dep_status;
+	struct aml_value dep;
+	struct dsm_result dsm[MAX_DSM_GUIDS * (MAX_DSM_FUNCS + 1)];
+	int dsm_count;
+};
+
+static int is_counted_guid(const uint8_t *guid)
+{
+	char str[40];
+	FILE *f;
+	size_t i;
+
+	f = fmemopen(str, sizeof(str), "w");
+	if (!f)
+		return 0;
+	print_guid(f, guid);
+	fclose(f);
+
+	for (i = 0; i < sizeof(counted_dsm_guids) /
+			sizeof(counted_dsm_guids[0]); i++) {
+		if (!strcmp(str, counted_dsm_guids[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
+static struct dsm_result *eval_dsm(const struct aml_ns *ns, int node,
+				   struct device_report *rep,
+				   const uint8_t *guid, uint64_t func)
+{
+	struct dsm_result *res = &rep->dsm[rep->dsm_count++];
+	uint8_t guid_buf[AML_GUID_SIZE + 1];
+	struct aml_value args[4] = {
+		{ .type = AML_BUFFER, .data = guid_buf, .len = AML_GUID_SIZE,
+		  .node = -1 },
+		{ .type = AML_INTEGER, .integer = 0, .node = -1 },
+		{ .type = AML_INTEGER, .integer = func, .node = -1 },
+		{ .type = AML_PACKAGE, .node = -1 },
+	};
+
+	/* values carry a NUL after the data */
+	memcpy(guid_buf, guid, AML_GUID_SIZE);
+	guid_buf[AML_GUID_SIZE] = '\0';
+
+	memcpy(res->guid, guid, AML_GUID_SIZE);
+	res->func = func;
+	res->status = aml_eval(ns, node, args, 4, &res->val);
+
+	return res;
+}
+
+static void analyze_dsm(const struct aml_ns *ns, int dev,
+			struct device_report *rep)
+{
+	uint8_t guids[MAX_DSM_GUIDS][AML_GUID_SIZE];
+	struct dsm_result *res;
+	uint64_t func;
+	int node;
+	int count;
+	int i;
+
+	node = aml_ns_child(ns, dev, "_DSM");
+	if (node < 0)
+		return;
+
+	count = aml_find_guids(ns, node, guids, MAX_DSM_GUIDS);
+	for (i = 0; i < count; i++) {
+		res = eval_dsm(ns, node, rep, guids[i], 1);
+		if (res->status || !is_counted_guid(guids[i]) ||
+		    res->val.type != AML_INTEGER ||
+		    res->val.integer > MAX_DSM_FUNCS)
+			continue;
+
+		for (func = 2; func <= res->val.integer + 1; func++)
+			eval_dsm(ns, node, rep, guids[i], func);
+	}
+}
+
+static void analyze_device(const struct aml_ns *ns, int dev,
+			   struct device_report *rep)
+{
+	unsigned int i;
+	int node;
+
+	memset(rep, 0, sizeof(*rep));
+	rep->node = dev;
+
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++) {
+		node = aml_ns_child(ns, dev, device_objects[i]);
+		if (node < 0)
+			continue;
+		rep->present[i] = 1;
+		rep->status[i] = aml_eval(ns, node, NULL, 0, &rep->objects[i]);
+	}
+
+	rep->dep_status = AML_ERROR;
+	node = aml_ns_child(ns, dev, "_DEP");
+	if (node >= 0)
+		rep->dep_status = aml_eval(ns, node, NULL, 0, &rep->dep);
+
+	analyze_dsm(ns, dev, rep);
+}
+
+static void free_report(struct device_report *rep)
+{
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++)
+		aml_value_free(&rep->objects[i]);
+	aml_value_free(&rep->dep);
+	for (j = 0; j < rep->dsm_count; j++)
+		aml_value_free(&rep->dsm[j].val);
+}
+
+static int is_object(const struct device_report *rep, const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++) {
+		if (!strcmp(device_objects[i], name))
+			return rep->present[i];
+	}
+
+	return 0;
+}
+
+static void text_report(FILE *out, const struct aml_ns *ns,
+			const struct device_report *rep)
+{
+	const struct aml_value *val;
+	char eisaid[8];
+	unsigned int i;
+	int j;
+
+	print_path(out, ns, rep->node);
+	fprintf(out, " [%s%s%s]\n", is_object(rep, "SSDB") ? "sensor" : "",
+		is_object(rep, "SSDB") && is_object(rep, "CLDB") ? ", " : "",
+		is_object(rep, "CLDB") ? "pmic" : "");
+
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++) {
+		if (!rep->present[i])
+			continue;
+
+		val = &rep->objects[i];
+		fprintf(out, "  %s: ", device_objects[i]);
+		if (rep->status[i]) {
+			fputs(rep->status[i] == AML_DYNAMIC ?
+			      "dynamic\n" : "parse error\n", out);
+			continue;
+		}
+
+		if ((!strcmp(device_objects[i], "_HID") ||
+		     !strcmp(device_objects[i], "_CID")) &&
+		    val->type == AML_INTEGER) {
+			aml_eisaid_to_string(val->integer, eisaid);
+			fprintf(out, "%s\n", eisaid);
+			continue;
+		}
+
+		print_value(out, ns, val, 2);
+		if (val->type != AML_BUFFER)
+			continue;
+		if (!strcmp(device_objects[i], "SSDB"))
+			print_fields(out, intel_ssdb_fields, val, 4);
+		else if (!strcmp(device_objects[i], "CLDB"))
+			print_fields(out, intel_cldb_fields, val, 4);
+	}
+
+	if (rep->dep_status != AML_ERROR || rep->dep.type) {
+		fputs("  _DEP: ", out);
+		if (rep->dep_status == AML_DYNAMIC)
+			fputs("dynamic\n", out);
+		else
+			print_value(out, ns, &rep->dep, 2);
+	}
+
+	for (j = 0; j < rep->dsm_count; j++) {
+		fputs("  _DSM ", out);
+		print_guid(out, rep->dsm[j].guid);
+		fprintf(out, " func %llu: ",
+			(unsigned long long)rep->dsm[j].func);
+		if (rep->dsm[j].status)
+			fputs(rep->dsm[j].status == AML_DYNAMIC ?
+			      "dynamic\n" : "parse error\n", out);
+		else
+			print_value(out, ns, &rep->dsm[j].val, 2);
+	}
+
+	fputc('\n', out);
+}
+
+/* Same layout as devices.json exported by dump_intel_ipu_data */
+static void json_report(FILE *out, const struct aml_ns *ns,
+			const struct device_report *rep)
+{
+	const char *sep = "";
+	char eisaid[8];
+	unsigned int i;
+	size_t k;
+	int j;
+
+	fputs("        {\n          \"acpi_device_name\": \"", out);
+	fprintf(out, "%.4s", (const char *)&ns->nodes[rep->node].seg);
+	fputs("\",\n          \"acpi_path\": ", out);
+	json_path(out, ns, rep->node);
+	fprintf(out, ",\n          \"type\": [%s%s%s]",
+		is_object(rep, "SSDB") ? "\"sensor\"" : "",
+		is_object(rep, "SSDB") && is_object(rep, "CLDB") ? ", " : "",
+		is_object(rep, "CLDB") ? "\"pmic\"" : "");
+
+	fputs(",\n          \"dep\": [", out);
+	if (!rep->dep_status && rep->dep.type == AML_PACKAGE) {
+		for (k = 0; k < rep->dep.count; k++) {
+			fputs(k ? ", " : "", out);
+			json_value(out, ns, &rep->dep.elements[k]);
+		}
+	}
+	fputc(']', out);
+
+	fputs(",\n          \"objects\": {", out);
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++) {
+		if (!rep->present[i] || rep->status[i])
+			continue;
+		fprintf(out, "%s\n            \"%s\": ", sep, device_objects[i]);
+		if ((!strcmp(device_objects[i], "_HID") ||
+		     !strcmp(device_objects[i], "_CID")) &&
+		    rep->objects[i].type == AML_INTEGER) {
+			aml_eisaid_to_string(rep->objects[i].integer, eisaid);
+			fprintf(out, "\"%s\"", eisaid);
+		} else {
+			json_value(out, ns, &rep->objects[i]);
+		}
+		sep = ",";
+	}
+	fputs("\n          }", out);
+
+	fputs(",\n          \"dsm\": [", out);
+	sep = "";
+	for (j = 0; j < rep->dsm_count; j++) {
+		if (rep->dsm[j].status)
+			continue;
+		fprintf(out, "%s\n            {\"guid\": \"", sep);
+		print_guid(out, rep->dsm[j].guid);
+		fprintf(out, "\", \"rev\": 0, \"func\": %llu, \"value\": ",
+			(unsigned long long)rep->dsm[j].func);
+		json_value(out, ns, &rep->dsm[j].val);
+		fputc('}', out);
+		sep = ",";
+	}
+	fputs("\n          ]", out);
+
+	/* objects that need the ACPI interpreter at runtime */
+	fputs(",\n          \"dynamic\": [", out);
+	sep = "";
+	for (i = 0; i < sizeof(device_objects) / sizeof(device_objects[0]);
+	     i++) {
+		if (!rep->present[i] || rep->status[i] != AML_DYNAMIC)
+			continue;
+		fprintf(out, "%s\"%s\"", sep, device_objects[i]);
+		sep = ", ";
+	}
+	if (rep->dep_status == AML_DYNAMIC) {
+		fprintf(out, "%s\"_DEP\"", sep);
+		sep = ", ";
+	}
+	for (j = 0; j < rep->dsm_count; j++) {
+		if (rep->dsm[j].status != AML_DYNAMIC)
+			continue;
+		fprintf(out, "%s\"_DSM ", sep);
+		print_guid(out, rep->dsm[j].guid);
+		fprintf(out, " %llu\"", (unsigned long long)rep->dsm[j].func);
+		sep = ", ";
+	}
+	fputs("]\n        }", out);
+}
+
+static void analyze_machine(struct machine *m)
+{
+	struct device_report *rep;
+	struct aml_ns ns;
+	int i;
+
+	m->out = open_memstream(&m->out_buf, &m->out_len);
+	m->log = open_memstream(&m->log_buf, &m->log_len);
+	if (!m->out || !m->log) {
+		fprintf(stderr, "%s: out of memory\n", m->path);
+		return;
+	}
+
+	if (is_dir(m->path))
+		load_dir(m, m->path);
+	else
+		load_file(m, m->path);
+
+	rep = malloc(sizeof(*rep));
+	if (!rep || aml_ns_init(&ns)) {
+		fprintf(m->log, "%s: out of memory\n", m->path);
+		free(rep);
+		goto out;
+	}
+	aml_ns_load(&ns, m->tables, m->table_count);
+
+	if (json_output) {
+		fputs("    {\n      \"machine\": ", m->out);
+		json_string(m->out, (const uint8_t *)m->path, strlen(m->path));
+		fputs(",\n      \"tables\": [", m->out);
+		for (i = 0; i < m->table_count; i++)
+			fprintf(m->out, "%s\"%s %s\"", i ? ", " : "",
+				m->tables[i].signature,
+				m->tables[i].oem_table_id);
+		fprintf(m->out, "],\n      \"parse_errors\": %u,\n      \"devices\": [",
+			ns.errors);
+	} else {
+		fprintf(m->out, "== %s ==\n", m->path);
+		for (i = 0; i < m->table_count; i++)
+			fprintf(m->out, "%s%s (%s)", i ? ", " : "tables: ",
+				m->tables[i].signature,
+				m->tables[i].oem_table_id);
+		fprintf(m->out, "%s\n", m->table_count ? "\n" : "no tables");
+		if (ns.errors)
+			fprintf(m->out, "%u terms could not be parsed\n\n",
+				ns.errors);
+	}
+
+	for (i = 0; i < ns.count; i++) {
+		if (ns.nodes[i].type != AML_NODE_DEVICE ||
+		    (aml_ns_child(&ns, i, "SSDB") < 0 &&
+		     aml_ns_child(&ns, i, "CLDB") < 0))
+			continue;
+
+		analyze_device(&ns, i, rep);
+		if (json_output) {
+			fputs(m->device_count ? ",\n" : "\n", m->out);
+			json_report(m->out, &ns, rep);
+		} else {
+			text_report(m->out, &ns, rep);
+		}
+		free_report(rep);
+		m->device_count++;
+	}
+
+	if (json_output)
+		fputs("\n      ]\n    }", m->out);
+
+	aml_ns_free(&ns);
+	free(rep);
+out:
+	for (i = 0; i < m->table_count; i++)
+		free((void *)m->tables[i].data);
+	fclose(m->out);
+	fclose(m->log);
+}
+
+static void *worker(void *arg)
+{
+	int i;
+
+	(void)arg;
+
+	while ((i = __atomic_fetch_add(&next_machine, 1, __ATOMIC_RELAXED)) <
+	       machine_count)
+		analyze_machine(&machines[i]);
+
+	return NULL;
+}
+
+static int add_machine(const char *path, char *path_buf)
+{
+	struct machine *tmp;
+
+	tmp = realloc(machines, (machine_count + 1) * sizeof(*machines));
+	if (!tmp)
+		return -1;
+	machines = tmp;
+
+	memset(&machines[machine_count], 0, sizeof(*machines));
+	machines[machine_count].path = path;
+	machines[machine_count++].path_buf = path_buf;
+	return 0;
+}
+
+/* A directory without files holds one sub directory per machine */
+static int add_path(const char *path)
+{
+	struct dirent **ents;
+	char *sub;
+	int n, i;
+
+	if (!is_dir(path) || has_files(path))
+		return add_machine(path, NULL);
+
+	n = scandir(path, &ents, NULL, alphasort);
+	if (n < 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (ents[i]->d_name[0] != '.') {
+			sub = malloc(strlen(path) + strlen(ents[i]->d_name) + 2);
+			if (!sub)
+				return -1;
+			sprintf(sub, "%s/%s", path, ents[i]->d_name);
+			if (!is_dir(sub))
+				free(sub);
+			else if (add_machine(sub, sub))
+				return -1;
+		}
+		free(ents[i]);
+	}
+
+	free(ents);
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-J] [-t <threads>] [path...]\n"
+		"  path defaults to /sys/firmware/acpi/tables\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	struct timespec start, stop;
+	pthread_t *tids;
+	int tables = 0, devices = 0;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "Jt:h")) != -1) {
+		switch (opt) {
+		case 'J':
+			json_output = 1;
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind == argc) {
+		if (add_path("/sys/firmware/acpi/tables"))
+			return 1;
+	}
+	for (i = optind; i < argc; i++) {
+		if (add_path(argv[i])) {
+			fprintf(stderr, "%s: can't open\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (threads < 1)
+		threads = 1;
+	if (threads > machine_count)
+		threads = machine_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	tids = calloc(threads, sizeof(*tids));
+	if (!tids)
+		return 1;
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, worker, NULL);
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	/* print in the order given on the command line */
+	if (json_output)
+		printf("{\n  \"machines\": [\n");
+	for (i = 0; i < machine_count; i++) {
+		if (machines[i].log_len)
+			fputs(machines[i].log_buf, stderr);
+		if (machines[i].out_len) {
+			if (json_output && i)
+				printf(",\n");
+			fputs(machines[i].out_buf, stdout);
+		}
+		tables += machines[i].table_count;
+		devices += machines[i].device_count;
+		free(machines[i].out_buf);
+		free(machines[i].log_buf);
+		free(machines[i].path_buf);
+	}
+	if (json_output)
+		printf("\n  ]\n}\n");
+
+	fprintf(stderr, "%d machines, %d tables, %d devices in %ld ms using %d threads\n",
+		machine_count, tables, devices,
+		(stop.tv_sec - start.tv_sec) * 1000 +
+		(stop.tv_nsec - start.tv_nsec) / 1000000, threads);
+
+	free(tids);
+	free(machines);
+	return 0;
+}
@@ -0,0 +1,1552 @@
+/**
+ * Minimal AML parser and static evaluator.
+ *
+ * The namespace declarations (Scope, Device, Name, Method, External...)
+ * of DSDT/SSDT tables are walked without executing anything. Objects are
+ * then evaluated with a small interpreter that supports constants,
+ * buffers, packages, If/Else, Return, Store to locals, comparisons and
+ * method calls, which is enough for static SSDB/CLDB buffers and the
+ * usual _DSM methods. Anything that depends on runtime state (operation
+ * regions, fields, loops...) is reported as AML_DYNAMIC.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aml.h"
+
+#define AML_HASH_SIZE		(1 << 14)
+#define AML_MAX_DEPTH		16
+#define AML_MAX_BUFFER		(1 << 20)
+#define AML_MAX_LOCAL_NAMES	16
+
+#define AML_ZERO_OP		0x00
+#define AML_ONE_OP		0x01
+#define AML_NAME_OP		0x08
+#define AML_BYTE_PREFIX		0x0a
+#define AML_WORD_PREFIX		0x0b
+#define AML_DWORD_PREFIX	0x0c
+#define AML_STRING_PREFIX	0x0d
+#define AML_QWORD_PREFIX	0x0e
+#define AML_SCOPE_OP		0x10
+#define AML_BUFFER_OP		0x11
+#define AML_PACKAGE_OP		0x12
+#define AML_VAR_PACKAGE_OP	0x13
+#define AML_METHOD_OP		0x14
+#define AML_EXTERNAL_OP		0x15
+#define AML_DUAL_NAME_PREFIX	0x2e
+#define AML_MULTI_NAME_PREFIX	0x2f
+#define AML_EXT_PREFIX		0x5b
+#define AML_ROOT_CHAR		0x5c
+#define AML_PARENT_CHAR		0x5e
+#define AML_LOCAL0_OP		0x60
+#define AML_LOCAL7_OP		0x67
+#define AML_ARG0_OP		0x68
+#define AML_ARG6_OP		0x6e
+#define AML_STORE_OP		0x70
+#define AML_ADD_OP		0x72
+#define AML_SUBTRACT_OP		0x74
+#define AML_MULTIPLY_OP		0x77
+#define AML_SHIFT_LEFT_OP	0x79
+#define AML_SHIFT_RIGHT_OP	0x7a
+#define AML_AND_OP		0x7b
+#define AML_OR_OP		0x7d
+#define AML_XOR_OP		0x7f
+#define AML_NOT_OP		0x80
+#define AML_DEREF_OF_OP		0x83
+#define AML_SIZE_OF_OP		0x87
+#define AML_INDEX_OP		0x88
+#define AML_LAND_OP		0x90
+#define AML_LOR_OP		0x91
+#define AML_LNOT_OP		0x92
+#define AML_LEQUAL_OP		0x93
+#define AML_LGREATER_OP		0x94
+#define AML_LLESS_OP		0x95
+#define AML_IF_OP		0xa0
+#define AML_ELSE_OP		0xa1
+#define AML_WHILE_OP		0xa2
+#define AML_NOOP_OP		0xa3
+#define AML_RETURN_OP		0xa4
+#define AML_ONES_OP		0xff
+
+#define AML_EXT_DEVICE_OP	0x82
+#define AML_EXT_PROCESSOR_OP	0x83
+#define AML_EXT_POWER_RES_OP	0x84
+#define AML_EXT_THERMAL_ZONE_OP	0x85
+
+#define AML_EXTERNAL_METHOD	8
+
+struct aml_name {
+	int root;
+	int prefix;
+	int nsegs;
+	const uint8_t *segs;
+};
+
+/*
+ * Operand encoding of each opcode, used to skip terms without evaluating
+ * them:
+ *   p: PkgLength, the term ends at the end of the package
+ *   N: NameString
+ *   A: TermArg
+ *   S: SuperName
+ *   T: Target
+ *   b/w/d/q: 1/2/4/8 bytes of data
+ *   z: NUL terminated string
+ * NULL means the opcode is invalid.
+ */
+static const char * const aml_ops[256] = {
+	[0x00] = "",		/* Zero */
+	[0x01] = "",		/* One */
+	[0x06] = "NN",		/* Alias */
+	[0x08] = "NA",		/* Name */
+	[0x0a] = "b",		/* BytePrefix */
+	[0x0b] = "w",		/* WordPrefix */
+	[0x0c] = "d",		/* DWordPrefix */
+	[0x0d] = "z",		/* StringPrefix */
+	[0x0e] = "q",		/* QWordPrefix */
+	[0x10] = "p",		/* Scope */
+	[0x11] = "p",		/* Buffer */
+	[0x12] = "p",		/* Package */
+	[0x13] = "p",		/* VarPackage */
+	[0x14] = "p",		/* Method */
+	[0x15] = "Nbb",		/* External */
+	[0x60] = "", [0x61] = "", [0x62] = "", [0x63] = "",	/* Local0-3 */
+	[0x64] = "", [0x65] = "", [0x66] = "", [0x67] = "",	/* Local4-7 */
+	[0x68] = "", [0x69] = "", [0x6a] = "", [0x6b] = "",	/* Arg0-3 */
+	[0x6c] = "", [0x6d] = "", [0x6e] = "",			/* Arg4-6 */
+	[0x70] = "AS",		/* Store */
+	[0x71] = "S",		/* RefOf */
+	[0x72] = "AAT",		/* Add */
+	[0x73] = "AAT",		/* Concatenate */
+	[0x74] = "AAT",		/* Subtract */
+	[0x75] = "S",		/* Increment */
+	[0x76] = "S",		/* Decrement */
+	[0x77] = "AAT",		/* Multiply */
+	[0x78] = "AATT",	/* Divide */
+	[0x79] = "AAT",		/* ShiftLeft */
+	[0x7a] = "AAT",		/* ShiftRight */
+	[0x7b] = "AAT",		/* And */
+	[0x7c] = "AAT",		/* NAnd */
+	[0x7d] = "AAT",		/* Or */
+	[0x7e] = "AAT",		/* NOr */
+	[0x7f] = "AAT",		/* Xor */
+	[0x80] = "AT",		/* Not */
+	[0x81] = "AT",		/* FindSetLeftBit */
+	[0x82] = "AT",		/* FindSetRightBit */
+	[0x83] = "A",		/* DerefOf */
+	[0x84] = "AAT",		/* ConcatenateResTemplate */
+	[0x85] = "AAT",		/* Mod */
+	[0x86] = "SA",		/* Notify */
+	[0x87] = "S",		/* SizeOf */
+	[0x88] = "AAT",		/* Index */
+	[0x89] = "AbAbAA",	/* Match */
+	[0x8a] = "AAN",		/* CreateDWordField */
+	[0x8b] = "AAN",		/* CreateWordField */
+	[0x8c] = "AAN",		/* CreateByteField */
+	[0x8d] = "AAN",		/* CreateBitField */
+	[0x8e] = "S",		/* ObjectType */
+	[0x8f] = "AAN",		/* CreateQWordField */
+	[0x90] = "AA",		/* LAnd */
+	[0x91] = "AA",		/* LOr */
+	[0x92] = "A",		/* LNot */
+	[0x93] = "AA",		/* LEqual */
+	[0x94] = "AA",		/* LGreater */
+	[0x95] = "AA",		/* LLess */
+	[0x96] = "AT",		/* ToBuffer */
+	[0x97] = "AT",		/* ToDecimalString */
+	[0x98] = "AT",		/* ToHexString */
+	[0x99] = "AT",		/* ToInteger */
+	[0x9c] = "AAT",		/* ToString */
+	[0x9d] = "AS",		/* CopyObject */
+	[0x9e] = "AAAT",	/* Mid */
+	[0x9f] = "",		/* Continue */
+	[0xa0] = "p",		/* If */
+	[0xa1] = "p",		/* Else */
+	[0xa2] = "p",		/* While */
+	[0xa3] = "",		/* Noop */
+	[0xa4] = "A",		/* Return */
+	[0xa5] = "",		/* Break */
+	[0xcc] = "",		/* BreakPoint */
+	[0xff] = "",		/* Ones */
+};
+
+/* Opcodes following AML_EXT_PREFIX */
+static const char * const aml_ext_ops[256] = {
+	[0x01] = "Nb",		/* Mutex */
+	[0x02] = "N",		/* Event */
+	[0x12] = "ST",		/* CondRefOf */
+	[0x13] = "AAAN",	/* CreateField */
+	[0x1f] = "AAAAAA",	/* LoadTable */
+	[0x20] = "NT",		/* Load */
+	[0x21] = "A",		/* Stall */
+	[0x22] = "A",		/* Sleep */
+	[0x23] = "Sw",		/* Acquire */
+	[0x24] = "S",		/* Signal */
+	[0x25] = "SA",		/* Wait */
+	[0x26] = "S",		/* Reset */
+	[0x27] = "S",		/* Release */
+	[0x28] = "AT",		/* FromBCD */
+	[0x29] = "AT",		/* ToBCD */
+	[0x2a] = "S",		/* Unload */
+	[0x30] = "",		/* Revision */
+	[0x31] = "",		/* Debug */
+	[0x32] = "bdA",		/* Fatal */
+	[0x33] = "",		/* Timer */
+	[0x80] = "NbAA",	/* OperationRegion */
+	[0x81] = "p",		/* Field */
+	[0x82] = "p",		/* Device */
+	[0x83] = "p",		/* Processor */
+	[0x84] = "p",		/* PowerResource */
+	[0x85] = "p",		/* ThermalZone */
+	[0x86] = "p",		/* IndexField */
+	[0x87] = "p",		/* BankField */
+	[0x88] = "NAAA",	/* DataRegion */
+};
+
+/*
+ * Parsing helpers
+ */
+static const uint8_t *parse_pkglen(const uint8_t *p, const uint8_t *end,
+				   const uint8_t **pkg_end)
+{
+	unsigned int bytes, len, i;
+
+	if (p >= end)
+		return NULL;
+
+	bytes = *p >> 6;
+	if (p + 1 + bytes > end)
+		return NULL;
+
+	if (!bytes) {
+		len = *p & 0x3f;
+	} else {
+		len = *p & 0x0f;
+		for (i = 0; i < bytes; i++)
+			len |= (unsigned int)p[1 + i] << (4 + 8 * i);
+	}
+
+	if (len < bytes + 1 || len > (size_t)(end - p))
+		return NULL;
+
+	*pkg_end = p + len;
+	return p + 1 + bytes;
+}
+
+static int is_lead_name_char(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static int is_name_char(uint8_t c)
+{
+	return is_lead_name_char(c) || (c >= '0' && c <= '9');
+}
+
+static int is_name_start(uint8_t c)
+{
+	return is_lead_name_char(c) || c == AML_ROOT_CHAR ||
+	       c == AML_PARENT_CHAR || c == AML_DUAL_NAME_PREFIX ||
+	       c == AML_MULTI_NAME_PREFIX;
+}
+
+static const uint8_t *parse_name(const uint8_t *p, const uint8_t *end,
+				 struct aml_name *name)
+{
+	int i;
+
+	memset(name, 0, sizeof(*name));
+
+	if (p < end && *p == AML_ROOT_CHAR) {
+		name->root = 1;
+		p++;
+	} else {
+		while (p < end && *p == AML_PARENT_CHAR) {
+			name->prefix++;
+			p++;
+		}
+	}
+
+	if (p >= end)
+		return NULL;
+
+	switch (*p) {
+	case AML_ZERO_OP:		/* NullName */
+		return p + 1;
+	case AML_DUAL_NAME_PREFIX:
+		name->nsegs = 2;
+		p++;
+		break;
+	case AML_MULTI_NAME_PREFIX:
+		if (p + 1 >= end)
+			return NULL;
+		name->nsegs = p[1];
+		p += 2;
+		break;
+	default:
+		name->nsegs = 1;
+		break;
+	}
+
+	if (p + 4 * name->nsegs > end)
+		return NULL;
+
+	for (i = 0; i < 4 * name->nsegs; i++) {
+		if (i % 4 ? !is_name_char(p[i]) : !is_lead_name_char(p[i]))
+			return NULL;
+	}
+
+	name->segs = p;
+	return p + 4 * name->nsegs;
+}
+
+static uint32_t name_seg(const uint8_t *seg)
+{
+	uint32_t val;
+
+	memcpy(&val, seg, sizeof(val));
+	return val;
+}
+
+/*
+ * Namespace
+ */
+static unsigned int ns_hash(int parent, uint32_t seg)
+{
+	return ((seg * 2654435761u) ^ ((unsigned int)parent * 40503u)) &
+	       (AML_HASH_SIZE - 1);
+}
+
+static int ns_child(const struct aml_ns *ns, int parent, uint32_t seg)
+{
+	int i;
+
+	for (i = ns->hash[ns_hash(parent, seg)]; i >= 0; i = ns->next[i]) {
+		if (ns->nodes[i].parent == parent && ns->nodes[i].seg == seg)
+			return i;
+	}
+
+	return -1;
+}
+
+static int ns_add(struct aml_ns *ns, int parent, uint32_t seg,
+		  enum aml_node_type type)
+{
+	struct aml_node *node;
+	unsigned int h;
+
+	if (ns->count == ns->size) {
+		int size = ns->size ? ns->size * 2 : 1024;
+		struct aml_node *nodes;
+		int *next;
+
+		nodes = realloc(ns->nodes, size * sizeof(*nodes));
+		if (!nodes)
+			return -1;
+		ns->nodes = nodes;
+
+		next = realloc(ns->next, size * sizeof(*next));
+		if (!next)
+			return -1;
+		ns->next = next;
+
+		ns->size = size;
+	}
+
+	node = &ns->nodes[ns->count];
+	memset(node, 0, sizeof(*node));
+	node->seg = seg;
+	node->parent = parent;
+	node->type = type;
+	node->argc = -1;
+
+	h = ns_hash(parent, seg);
+	ns->next[ns->count] = ns->hash[h];
+	ns->hash[h] = ns->count;
+
+	return ns->count++;
+}
+
+/* Resolve @name relative to @scope, following the ACPI search rules */
+static int ns_lookup(const struct aml_ns *ns, int scope,
+		     const struct aml_name *name)
+{
+	int cur = name->root ? 0 : scope;
+	int node;
+	int i;
+
+	for (i = 0; i < name->prefix && cur > 0; i++)
+		cur = ns->nodes[cur].parent;
+
+	if (!name->nsegs)
+		return cur;
+
+	/* a single relative NameSeg is searched towards the root */
+	if (!name->root && !name->prefix && name->nsegs == 1) {
+		for (; cur >= 0; cur = ns->nodes[cur].parent) {
+			node = ns_child(ns, cur, name_seg(name->segs));
+			if (node >= 0)
+				return node;
+		}
+		return -1;
+	}
+
+	for (i = 0; i < name->nsegs && cur >= 0; i++)
+		cur = ns_child(ns, cur, name_seg(name->segs + 4 * i));
+
+	return cur;
+}
+
+/*
+ * Create (or find) the node for a declaration of @name in @scope. Missing
+ * parents are created as scopes, an existing node only gets its type
+ * upgraded from a scope or External.
+ */
+static int ns_declare(struct aml_ns *ns, int scope, const struct aml_name *name,
+		      enum aml_node_type type)
+{
+	int cur = name->root ? 0 : scope;
+	uint32_t seg;
+	int node;
+	int i;
+
+	for (i = 0; i < name->prefix && cur > 0; i++)
+		cur = ns->nodes[cur].parent;
+
+	if (!name->nsegs)
+		return cur;
+
+	for (i = 0; i < name->nsegs; i++) {
+		seg = name_seg(name->segs + 4 * i);
+		node = ns_child(ns, cur, seg);
+		if (node < 0)
+			node = ns_add(ns, cur, seg, AML_NODE_SCOPE);
+		if (node < 0)
+			return -1;
+		cur = node;
+	}
+
+	if (ns->nodes[cur].type == AML_NODE_SCOPE ||
+	    (ns->nodes[cur].type == AML_NODE_EXTERNAL &&
+	     type != AML_NODE_SCOPE))
+		ns->nodes[cur].type = type;
+
+	return cur;
+}
+
+int aml_ns_init(struct aml_ns *ns)
+{
+	static const char * const predefined[] = {
+		"_GPE", "_PR_", "_SB_", "_SI_", "_TZ_",
+	};
+	unsigned int i;
+
+	memset(ns, 0, sizeof(*ns));
+
+	ns->hash = malloc(AML_HASH_SIZE * sizeof(*ns->hash));
+	if (!ns->hash)
+		return -1;
+	for (i = 0; i < AML_HASH_SIZE; i++)
+		ns->hash[i] = -1;
+
+	/* root */
+	if (ns_add(ns, -1, name_seg((const uint8_t *)"\\___"),
+		   AML_NODE_SCOPE) < 0)
+		return -1;
+
+	for (i = 0; i < sizeof(predefined) / sizeof(predefined[0]); i++) {
+		if (ns_add(ns, 0, name_seg((const uint8_t *)predefined[i]),
+			   AML_NODE_SCOPE) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+void aml_ns_free(struct aml_ns *ns)
+{
+	free(ns->nodes);
+	free(ns->next);
+	free(ns->hash);
+	memset(ns, 0, sizeof(*ns));
+}
+
+int aml_ns_child(const struct aml_ns *ns, int parent, const char *seg)
+{
+	return ns_child(ns, parent, name_seg((const uint8_t *)seg));
+}
+
+void aml_ns_path(const struct aml_ns *ns, int node, char *buf, size_t size)
+{
+	int segs[256];
+	int depth = 0;
+	size_t len = 0;
+	int i;
+
+	for (; node > 0 && depth < 256; node = ns->nodes[node].parent)
+		segs[depth++] = node;
+
+	len += snprintf(buf, size, "\\");
+	for (i = depth - 1; i >= 0 && len < size; i--)
+		len += snprintf(buf + len, size - len, "%.4s%s",
+				(const char *)&ns->nodes[segs[i]].seg,
+				i ? "." : "");
+}
+
+/*
+ * Skipping terms without evaluation
+ */
+static const uint8_t *skip_term(const struct aml_ns *ns, int scope,
+				const uint8_t *p, const uint8_t *end);
+
+static const uint8_t *skip_super_name(const struct aml_ns *ns, int scope,
+				      const uint8_t *p, const uint8_t *end)
+{
+	struct aml_name name;
+
+	if (p >= end)
+		return NULL;
+
+	/* NullName, SimpleName */
+	if (*p == AML_ZERO_OP)
+		return p + 1;
+	if (is_name_start(*p))
+		return parse_name(p, end, &name);
+
+	return skip_term(ns, scope, p, end);
+}
+
+static const uint8_t *skip_args(const struct aml_ns *ns, int scope,
+				const char *args, const uint8_t *p,
+				const uint8_t *end)
+{
+	const uint8_t *pkg_end;
+	struct aml_name name;
+
+	for (; p && *args; args++) {
+		switch (*args) {
+		case 'p':
+			if (!parse_pkglen(p, end, &pkg_end))
+				return NULL;
+			return pkg_end;
+		case 'N':
+			p = parse_name(p, end, &name);
+			break;
+		case 'A':
+			p = skip_term(ns, scope, p, end);
+			break;
+		case 'S':
+		case 'T':
+			p = skip_super_name(ns, scope, p, end);
+			break;
+		case 'b':
+			p = p + 1 <= end ? p + 1 : NULL;
+			break;
+		case 'w':
+			p = p + 2 <= end ? p + 2 : NULL;
+			break;
+		case 'd':
+			p = p + 4 <= end ? p + 4 : NULL;
+			break;
+		case 'q':
+			p = p + 8 <= end ? p + 8 : NULL;
+			break;
+		case 'z':
+			while (p < end && *p)
+				p++;
+			p = p < end ? p + 1 : NULL;
+			break;
+		}
+	}
+
+	return p;
+}
+
+static const uint8_t *skip_term(const struct aml_ns *ns, int scope,
+				const uint8_t *p, const uint8_t *end)
+{
+	struct aml_name name;
+	const char *args;
+	int node;
+	int i;
+
+	if (!p || p >= end)
+		return NULL;
+
+	/* NameString: object reference or method invocation */
+	if (is_name_start(*p)) {
+		p = parse_name(p, end, &name);
+		if (!p)
+			return NULL;
+
+		node = ns_lookup(ns, scope, &name);
+		if (node < 0)
+			return p;
+
+		for (i = 0; p && i < ns->nodes[node].argc; i++)
+			p = skip_term(ns, scope, p, end);
+		return p;
+	}
+
+	if (*p == AML_EXT_PREFIX) {
+		if (p + 1 >= end)
+			return NULL;
+		args = aml_ext_ops[p[1]];
+		p += 2;
+	} else {
+		args = aml_ops[*p];
+		p++;
+	}
+
+	if (!args)
+		return NULL;
+
+	return skip_args(ns, scope, args, p, end);
+}
+
+/*
+ * Declaration walk
+ */
+static void walk_term_list(struct aml_ns *ns, int scope, const uint8_t *p,
+			   const uint8_t *end);
+
+/* Scope, Device, Processor, PowerResource and ThermalZone */
+static const uint8_t *walk_scope(struct aml_ns *ns, int scope,
+				 const uint8_t *p, const uint8_t *end,
+				 enum aml_node_type type, int skip)
+{
+	const uint8_t *pkg_end;
+	struct aml_name name;
+	int node;
+
+	p = parse_pkglen(p, end, &pkg_end);
+	if (!p)
+		return NULL;
+
+	p = parse_name(p, pkg_end, &name);
+	if (!p || p + skip > pkg_end)
+		return NULL;
+
+	node = ns_declare(ns, scope, &name, type);
+	if (node >= 0)
+		walk_term_list(ns, node, p + skip, pkg_end);
+
+	return pkg_end;
+}
+
+static const uint8_t *walk_term(struct aml_ns *ns, int scope,
+				const uint8_t *p, const uint8_t *end)
+{
+	const uint8_t *pkg_end;
+	struct aml_name name;
+	struct aml_node *n;
+	const uint8_t *q;
+	int node;
+
+	switch (*p) {
+	case AML_SCOPE_OP:
+		return walk_scope(ns, scope, p + 1, end, AML_NODE_SCOPE, 0);
+	case AML_METHOD_OP:
+		q = parse_pkglen(p + 1, end, &pkg_end);
+		if (!q)
+			return NULL;
+		q = parse_name(q, pkg_end, &name);
+		if (!q || q >= pkg_end)
+			return NULL;
+
+		node = ns_declare(ns, scope, &name, AML_NODE_METHOD);
+		if (node >= 0) {
+			n = &ns->nodes[node];
+			n->argc = *q & 0x07;
+			n->start = q + 1;
+			n->end = pkg_end;
+		}
+		return pkg_end;
+	case AML_NAME_OP:
+		q = parse_name(p + 1, end, &name);
+		if (!q)
+			return NULL;
+
+		node = ns_declare(ns, scope, &name, AML_NODE_NAME);
+		p = skip_term(ns, scope, q, end);
+		if (node >= 0 && p) {
+			n = &ns->nodes[node];
+			n->start = q;
+			n->end = p;
+		}
+		return p;
+	case AML_EXTERNAL_OP:
+		q = parse_name(p + 1, end, &name);
+		if (!q || q + 2 > end)
+			return NULL;
+
+		node = ns_declare(ns, scope, &name, AML_NODE_EXTERNAL);
+		if (node >= 0 && q[0] == AML_EXTERNAL_METHOD &&
+		    ns->nodes[node].type == AML_NODE_EXTERNAL)
+			ns->nodes[node].argc = q[1] & 0x07;
+		return q + 2;
+	case AML_IF_OP:
+	case AML_WHILE_OP:
+		/* declarations may be inside conditionals, walk the body */
+		q = parse_pkglen(p + 1, end, &pkg_end);
+		if (!q)
+			return NULL;
+		q = skip_term(ns, scope, q, pkg_end);
+		if (!q) {
+			ns->errors++;
+			return pkg_end;
+		}
+		walk_term_list(ns, scope, q, pkg_end);
+		return pkg_end;
+	case AML_ELSE_OP:
+		q = parse_pkglen(p + 1, end, &pkg_end);
+		if (!q)
+			return NULL;
+		walk_term_list(ns, scope, q, pkg_end);
+		return pkg_end;
+	case AML_EXT_PREFIX:
+		if (p + 1 >= end)
+			return NULL;
+
+		switch (p[1]) {
+		case AML_EXT_DEVICE_OP:
+			return walk_scope(ns, scope, p + 2, end,
+					  AML_NODE_DEVICE, 0);
+		case AML_EXT_PROCESSOR_OP:
+			/* ProcID, PblkAddr, PblkLen */
+			return walk_scope(ns, scope, p + 2, end,
+					  AML_NODE_OTHER, 6);
+		case AML_EXT_POWER_RES_OP:
+			/* SystemLevel, ResourceOrder */
+			return walk_scope(ns, scope, p + 2, end,
+					  AML_NODE_OTHER, 3);
+		case AML_EXT_THERMAL_ZONE_OP:
+			return walk_scope(ns, scope, p + 2, end,
+					  AML_NODE_OTHER, 0);
+		}
+		break;
+	}
+
+	return skip_term(ns, scope, p, end);
+}
+
+/*
+ * Walk a TermList. A term that can't be parsed stops the walk of this
+ * list only, the enclosing package length still bounds the damage.
+ */
+static void walk_term_list(struct aml_ns *ns, int scope, const uint8_t *p,
+			   const uint8_t *end)
+{
+	while (p && p < end)
+		p = walk_term(ns, scope, p, end);
+
+	if (!p)
+		ns->errors++;
+}
+
+/*
+ * Tables are walked twice: method argument counts found in the first pass
+ * (including methods declared later or in other tables) are needed to
+ * parse method invocations correctly in the second.
+ */
+void aml_ns_load(struct aml_ns *ns, const struct aml_table *tables, int count)
+{
+	int pass;
+	int i;
+
+	for (pass = 0; pass < 2; pass++) {
+		ns->errors = 0;
+		for (i = 0; i < count; i++) {
+			if (tables[i].len <= AML_TABLE_HEADER_SIZE)
+				continue;
+			walk_term_list(ns, 0,
+				       tables[i].data + AML_TABLE_HEADER_SIZE,
+				       tables[i].data + tables[i].len);
+		}
+	}
+}
+
+/*
+ * Values
+ */
+void aml_value_free(struct aml_value *val)
+{
+	size_t i;
+
+	for (i = 0; i < val->count; i++)
+		aml_value_free(&val->elements[i]);
+
+	free(val->elements);
+	free(val->data);
+	memset(val, 0, sizeof(*val));
+	val->node = -1;
+}
+
+static int value_copy(struct aml_value *dst, const struct aml_value *src)
+{
+	size_t i;
+
+	*dst = *src;
+	dst->data = NULL;
+	dst->elements = NULL;
+	dst->count = 0;
+
+	if (src->data) {
+		/* strings carry a terminating NUL */
+		dst->data = malloc(src->len + 1);
+		if (!dst->data)
+			return -1;
+		memcpy(dst->data, src->data, src->len + 1);
+	}
+
+	if (src->count) {
+		dst->elements = calloc(src->count, sizeof(*dst->elements));
+		if (!dst->elements)
+			return -1;
+		dst->count = src->count;
+		for (i = 0; i < src->count; i++) {
+			if (value_copy(&dst->elements[i], &src->elements[i]))
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void value_integer(struct aml_value *val, uint64_t integer)
+{
+	memset(val, 0, sizeof(*val));
+	val->type = AML_INTEGER;
+	val->integer = integer;
+	val->node = -1;
+}
+
+static int value_bytes(struct aml_value *val, enum aml_value_type type,
+		       const uint8_t *data, size_t len, size_t size)
+{
+	memset(val, 0, sizeof(*val));
+	val->type = type;
+	val->node = -1;
+
+	/* +1 so that strings are always NUL terminated */
+	val->data = calloc(1, size + 1);
+	if (!val->data)
+		return -1;
+
+	memcpy(val->data, data, len < size ? len : size);
+	val->len = size;
+
+	return 0;
+}
+
+/*
+ * Static evaluation
+ */
+struct aml_local_name {
+	uint32_t seg;
+	const uint8_t *start;
+	const uint8_t *end;
+};
+
+struct aml_ctx {
+	const struct aml_ns *ns;
+	int scope;
+	const struct aml_value *args;
+	int argc;
+	struct aml_value locals[8];
+	struct aml_local_name names[AML_MAX_LOCAL_NAMES];
+	int nnames;
+	int depth;
+};
+
+static enum aml_status eval_term(struct aml_ctx *ctx, const uint8_t **pp,
+				 const uint8_t *end, struct aml_value *val);
+
+static enum aml_status eval_node(const struct aml_ns *ns, int node,
+				 const struct aml_value *args, int argc,
+				 int depth, struct aml_value *val);
+
+static enum aml_status eval_integer(struct aml_ctx *ctx, const uint8_t **pp,
+				    const uint8_t *end, uint64_t *integer)
+{
+	struct aml_value val;
+	enum aml_status ret;
+
+	ret = eval_term(ctx, pp, end, &val);
+	if (ret)
+		return ret;
+
+	if (val.type != AML_INTEGER) {
+		aml_value_free(&val);
+		return AML_DYNAMIC;
+	}
+
+	*integer = val.integer;
+	return AML_OK;
+}
+
+/* Store @val to a Target, only NullName and locals are supported */
+static enum aml_status store_target(struct aml_ctx *ctx, const uint8_t **pp,
+				    const uint8_t *end, struct aml_value *val)
+{
+	const uint8_t *p = *pp;
+
+	if (p >= end) {
+		aml_value_free(val);
+		return AML_ERROR;
+	}
+
+	if (*p == AML_ZERO_OP) {
+		*pp = p + 1;
+		return AML_OK;
+	}
+
+	if (*p >= AML_LOCAL0_OP && *p <= AML_LOCAL7_OP) {
+		struct aml_value *local = &ctx->locals[*p - AML_LOCAL0_OP];
+
+		aml_value_free(local);
+		if (value_copy(local, val))
+			return AML_ERROR;
+		*pp = p + 1;
+		return AML_OK;
+	}
+
+	return AML_DYNAMIC;
+}
+
+static enum aml_status eval_package(struct aml_ctx *ctx, const uint8_t *p,
+				    const uint8_t *end, uint64_t count,
+				    struct aml_value *val)
+{
+	struct aml_value *elem;
+	struct aml_name name;
+	enum aml_status ret;
+	size_t i;
+
+	if (count > AML_MAX_BUFFER)
+		return AML_ERROR;
+
+	memset(val, 0, sizeof(*val));
+	val->type = AML_PACKAGE;
+	val->node = -1;
+	val->elements = calloc(count ? count : 1, sizeof(*val->elements));
+	if (!val->elements)
+		return AML_ERROR;
+	val->count = count;
+
+	for (i = 0; i < count; i++)
+		val->elements[i].node = -1;
+
+	for (i = 0; p < end && i < count; i++) {
+		elem = &val->elements[i];
+
+		/* names in packages are references, not invocations */
+		if (is_name_start(*p)) {
+			const uint8_t *q = parse_name(p, end, &name);
+
+			if (!q)
+				return AML_ERROR;
+			if (value_bytes(elem, AML_REFERENCE, p, q - p, q - p))
+				return AML_ERROR;
+			elem->node = ns_lookup(ctx->ns, ctx->scope, &name);
+			p = q;
+			continue;
+		}
+
+		ret = eval_term(ctx, &p, end, elem);
+		if (ret)
+			return ret;
+	}
+
+	return AML_OK;
+}
+
+static enum aml_status eval_name(struct aml_ctx *ctx, const uint8_t **pp,
+				 const uint8_t *end, struct aml_value *val)
+{
+	struct aml_value args[7];
+	struct aml_name name;
+	enum aml_status ret;
+	int node;
+	int argc;
+	int i;
+
+	*pp = parse_name(*pp, end, &name);
+	if (!*pp)
+		return AML_ERROR;
+
+	/* Name() declared inside the method being executed */
+	if (!name.root && !name.prefix && name.nsegs == 1) {
+		for (i = 0; i < ctx->nnames; i++) {
+			const uint8_t *p = ctx->names[i].start;
+
+			if (ctx->names[i].seg != name_seg(name.segs))
+				continue;
+			return eval_term(ctx, &p, ctx->names[i].end, val);
+		}
+	}
+
+	node = ns_lookup(ctx->ns, ctx->scope, &name);
+	if (node < 0)
+		return AML_DYNAMIC;
+
+	argc = ctx->ns->nodes[node].argc;
+	if (argc < 0)
+		return eval_node(ctx->ns, node, NULL, 0, ctx->depth + 1, val);
+
+	memset(args, 0, sizeof(args));
+	for (i = 0; i < argc; i++) {
+		ret = eval_term(ctx, pp, end, &args[i]);
+		if (ret)
+			goto out;
+	}
+
+	ret = eval_node(ctx->ns, node, args, argc, ctx->depth + 1, val);
+
+out:
+	for (i = 0; i < argc; i++)
+		aml_value_free(&args[i]);
+	return ret;
+}
+
+static int value_compare(const struct aml_value *a, const struct aml_value *b,
+			 int *cmp)
+{
+	size_t len;
+
+	if (a->type == AML_INTEGER && b->type == AML_INTEGER) {
+		*cmp = a->integer < b->integer ? -1 : a->integer > b->integer;
+		return 0;
+	}
+
+	if ((a->type == AML_BUFFER || a->type == AML_STRING) &&
+	    a->type == b->type) {
+		len = a->len < b->len ? a->len : b->len;
+		*cmp = memcmp(a->data, b->data, len);
+		if (!*cmp)
+			*cmp = a->len < b->len ? -1 : a->len > b->len;
+		return 0;
+	}
+
+	return -1;
+}
+
+static enum aml_status eval_binary(struct aml_ctx *ctx, uint8_t op,
+				   const uint8_t **pp, const uint8_t *end,
+				   struct aml_value *val)
+{
+	struct aml_value a, b;
+	enum aml_status ret;
+	uint64_t result;
+	int cmp;
+
+	ret = eval_term(ctx, pp, end, &a);
+	if (ret)
+		return ret;
+	ret = eval_term(ctx, pp, end, &b);
+	if (ret) {
+		aml_value_free(&a);
+		return ret;
+	}
+
+	switch (op) {
+	case AML_LEQUAL_OP:
+	case AML_LGREATER_OP:
+	case AML_LLESS_OP:
+		if (value_compare(&a, &b, &cmp)) {
+			ret = AML_DYNAMIC;
+			break;
+		}
+		result = op == AML_LEQUAL_OP ? cmp == 0 :
+			 op == AML_LGREATER_OP ? cmp > 0 : cmp < 0;
+		value_integer(val, result);
+		break;
+	default:
+		if (a.type != AML_INTEGER || b.type != AML_INTEGER) {
+			ret = AML_DYNAMIC;
+			break;
+		}
+
+		switch (op) {
+		case AML_LAND_OP:
+			result = a.integer && b.integer;
+			break;
+		case AML_LOR_OP:
+			result = a.integer || b.integer;
+			break;
+		case AML_ADD_OP:
+			result = a.integer + b.integer;
+			break;
+		case AML_SUBTRACT_OP:
+			result = a.integer - b.integer;
+			break;
+		case AML_MULTIPLY_OP:
+			result = a.integer * b.integer;
+			break;
+		case AML_SHIFT_LEFT_OP:
+			result = b.integer < 64 ? a.integer << b.integer : 0;
+			break;
+		case AML_SHIFT_RIGHT_OP:
+			result = b.integer < 64 ? a.integer >> b.integer : 0;
+			break;
+		case AML_AND_OP:
+			result = a.integer & b.integer;
+			break;
+		case AML_OR_OP:
+			result = a.integer | b.integer;
+			break;
+		default:
+			result = a.integer ^ b.integer;
+			break;
+		}
+		value_integer(val, result);
+
+		if (op != AML_LAND_OP && op != AML_LOR_OP)
+			ret = store_target(ctx, pp, end, val);
+		break;
+	}
+
+	aml_value_free(&a);
+	aml_value_free(&b);
+	if (ret)
+		aml_value_free(val);
+	return ret;
+}
+
+static enum aml_status eval_index(struct aml_ctx *ctx, const uint8_t **pp,
+				  const uint8_t *end, struct aml_value *val)
+{
+	struct aml_value src;
+	enum aml_status ret;
+	uint64_t index;
+
+	ret = eval_term(ctx, pp, end, &src);
+	if (ret)
+		return ret;
+
+	ret = eval_integer(ctx, pp, end, &index);
+	if (ret)
+		goto out;
+
+	if (src.type == AML_PACKAGE && index < src.count) {
+		if (value_copy(val, &src.elements[index]))
+			ret = AML_ERROR;
+	} else if ((src.type == AML_BUFFER || src.type == AML_STRING) &&
+		   index < src.len) {
+		value_integer(val, src.data[index]);
+	} else {
+		ret = AML_DYNAMIC;
+	}
+
+	if (!ret)
+		ret = store_target(ctx, pp, end, val);
+
+out:
+	aml_value_free(&src);
+	return ret;
+}
+
+static enum aml_status eval_term(struct aml_ctx *ctx, const uint8_t **pp,
+				 const uint8_t *end, struct aml_value *val)
+{
+	const uint8_t *p = *pp;
+	const uint8_t *pkg_end;
+	enum aml_status ret;
+	uint64_t integer;
+	uint8_t op;
+	int i;
+
+	memset(val, 0, sizeof(*val));
+	val->node = -1;
+
+	if (p >= end)
+		return AML_ERROR;
+
+	if (is_name_start(*p))
+		return eval_name(ctx, pp, end, val);
+
+	op = *p++;
+	switch (op) {
+	case AML_ZERO_OP:
+		value_integer(val, 0);
+		break;
+	case AML_ONE_OP:
+		value_integer(val, 1);
+		break;
+	case AML_ONES_OP:
+		value_integer(val, ~0ULL);
+		break;
+	case AML_BYTE_PREFIX:
+	case AML_WORD_PREFIX:
+	case AML_DWORD_PREFIX:
+	case AML_QWORD_PREFIX: {
+		int size = op == AML_BYTE_PREFIX ? 1 :
+			   op == AML_WORD_PREFIX ? 2 :
+			   op == AML_DWORD_PREFIX ? 4 : 8;
+
+		if (p + size > end)
+			return AML_ERROR;
+		integer = 0;
+		for (i = 0; i < size; i++)
+			integer |= (uint64_t)p[i] << (8 * i);
+		value_integer(val, integer);
+		p += size;
+		break;
+	}
+	case AML_STRING_PREFIX: {
+		const uint8_t *s = p;
+
+		while (p < end && *p)
+			p++;
+		if (p >= end)
+			return AML_ERROR;
+		if (value_bytes(val, AML_STRING, s, p - s, p - s))
+			return AML_ERROR;
+		p++;
+		break;
+	}
+	case AML_BUFFER_OP:
+		p = parse_pkglen(p, end, &pkg_end);
+		if (!p)
+			return AML_ERROR;
+		ret = eval_integer(ctx, &p, pkg_end, &integer);
+		if (ret)
+			return ret;
+		if (integer > AML_MAX_BUFFER)
+			return AML_ERROR;
+		if (value_bytes(val, AML_BUFFER, p, pkg_end - p, integer))
+			return AML_ERROR;
+		p = pkg_end;
+		break;
+	case AML_PACKAGE_OP:
+		p = parse_pkglen(p, end, &pkg_end);
+		if (!p || p >= pkg_end)
+			return AML_ERROR;
+		ret = eval_package(ctx, p + 1, pkg_end, *p, val);
+		if (ret) {
+			aml_value_free(val);
+			return ret;
+		}
+		p = pkg_end;
+		break;
+	case AML_VAR_PACKAGE_OP:
+		p = parse_pkglen(p, end, &pkg_end);
+		if (!p)
+			return AML_ERROR;
+		ret = eval_integer(ctx, &p, pkg_end, &integer);
+		if (ret)
+			return ret;
+		ret = eval_package(ctx, p, pkg_end, integer, val);
+		if (ret) {
+			aml_value_free(val);
+			return ret;
+		}
+		p = pkg_end;
+		break;
+	case AML_LOCAL0_OP ... AML_LOCAL7_OP:
+		if (value_copy(val, &ctx->locals[op - AML_LOCAL0_OP]))
+			return AML_ERROR;
+		break;
+	case AML_ARG0_OP ... AML_ARG6_OP:
+		if (op - AML_ARG0_OP >= ctx->argc)
+			return AML_DYNAMIC;
+		if (value_copy(val, &ctx->args[op - AML_ARG0_OP]))
+			return AML_ERROR;
+		break;
+	case AML_LEQUAL_OP:
+	case AML_LGREATER_OP:
+	case AML_LLESS_OP:
+	case AML_LAND_OP:
+	case AML_LOR_OP:
+	case AML_ADD_OP:
+	case AML_SUBTRACT_OP:
+	case AML_MULTIPLY_OP:
+	case AML_SHIFT_LEFT_OP:
+	case AML_SHIFT_RIGHT_OP:
+	case AML_AND_OP:
+	case AML_OR_OP:
+	case AML_XOR_OP:
+		ret = eval_binary(ctx, op, &p, end, val);
+		if (ret)
+			return ret;
+		break;
+	case AML_LNOT_OP:
+	case AML_NOT_OP:
+		ret = eval_integer(ctx, &p, end, &integer);
+		if (ret)
+			return ret;
+		value_integer(val, op == AML_LNOT_OP ? !integer : ~integer);
+		if (op == AML_NOT_OP) {
+			ret = store_target(ctx, &p, end, val);
+			if (ret)
+				return ret;
+		}
+		break;
+	case AML_INDEX_OP:
+		ret = eval_index(ctx, &p, end, val);
+		if (ret)
+			return ret;
+		break;
+	case AML_DEREF_OF_OP:
+		ret = eval_term(ctx, &p, end, val);
+		if (ret)
+			return ret;
+		if (val->type == AML_REFERENCE) {
+			int node = val->node;
+
+			aml_value_free(val);
+			if (node < 0)
+				return AML_DYNAMIC;
+			ret = eval_node(ctx->ns, node, NULL, 0,
+					ctx->depth + 1, val);
+			if (ret)
+				return ret;
+		}
+		break;
+	case AML_SIZE_OF_OP:
+		ret = eval_term(ctx, &p, end, val);
+		if (ret)
+			return ret;
+		integer = val->type == AML_PACKAGE ? val->count : val->len;
+		if (val->type == AML_INTEGER || val->type == AML_REFERENCE) {
+			aml_value_free(val);
+			return AML_DYNAMIC;
+		}
+		aml_value_free(val);
+		value_integer(val, integer);
+		break;
+	default:
+		return AML_DYNAMIC;
+	}
+
+	*pp = p;
+	return AML_OK;
+}
+
+/* Execute a TermList, AML_OK with val->type == AML_NONE means no Return */
+static enum aml_status exec_term_list(struct aml_ctx *ctx, const uint8_t *p,
+				      const uint8_t *end, struct aml_value *val,
+				      int *returned)
+{
+	const uint8_t *pkg_end, *else_start, *else_end;
+	struct aml_value tmp;
+	struct aml_name name;
+	enum aml_status ret;
+	uint64_t predicate;
+	const uint8_t *q;
+
+	*returned = 0;
+
+	while (p < end) {
+		switch (*p) {
+		case AML_IF_OP:
+			q = parse_pkglen(p + 1, end, &pkg_end);
+			if (!q)
+				return AML_ERROR;
+			ret = eval_integer(ctx, &q, pkg_end, &predicate);
+			if (ret)
+				return ret;
+
+			else_start = else_end = pkg_end;
+			if (pkg_end < end && *pkg_end == AML_ELSE_OP) {
+				else_start = parse_pkglen(pkg_end + 1, end,
+							  &else_end);
+				if (!else_start)
+					return AML_ERROR;
+			}
+
+			if (predicate)
+				ret = exec_term_list(ctx, q, pkg_end, val,
+						     returned);
+			else
+				ret = exec_term_list(ctx, else_start, else_end,
+						     val, returned);
+			if (ret || *returned)
+				return ret;
+
+			p = else_end;
+			break;
+		case AML_RETURN_OP:
+			p++;
+			ret = eval_term(ctx, &p, end, val);
+			if (!ret)
+				*returned = 1;
+			return ret;
+		case AML_STORE_OP:
+			p++;
+			ret = eval_term(ctx, &p, end, &tmp);
+			if (ret)
+				return ret;
+			ret = store_target(ctx, &p, end, &tmp);
+			aml_value_free(&tmp);
+			if (ret)
+				return ret;
+			break;
+		case AML_NAME_OP:
+			q = parse_name(p + 1, end, &name);
+			if (!q || name.nsegs != 1 ||
+			    ctx->nnames == AML_MAX_LOCAL_NAMES)
+				return AML_DYNAMIC;
+			p = skip_term(ctx->ns, ctx->scope, q, end);
+			if (!p)
+				return AML_ERROR;
+			ctx->names[ctx->nnames].seg = name_seg(name.segs);
+			ctx->names[ctx->nnames].start = q;
+			ctx->names[ctx->nnames].end = p;
+			ctx->nnames++;
+			break;
+		case AML_NOOP_OP:
+			p++;
+			break;
+		case AML_ELSE_OP:
+		case AML_WHILE_OP:
+			return AML_DYNAMIC;
+		default:
+			/* expressions with a local or no target */
+			ret = eval_term(ctx, &p, end, &tmp);
+			if (ret)
+				return ret;
+			aml_value_free(&tmp);
+			break;
+		}
+	}
+
+	return AML_OK;
+}
+
+static enum aml_status exec_method(const struct aml_ns *ns, int node,
+				   const struct aml_value *args, int argc,
+				   int depth, struct aml_value *val)
+{
+	const struct aml_node *n = &ns->nodes[node];
+	struct aml_ctx ctx = {
+		.ns = ns,
+		.scope = node,
+		.args = args,
+		.argc = argc,
+		.depth = depth,
+	};
+	enum aml_status ret;
+	int returned;
+	int i;
+
+	memset(val, 0, sizeof(*val));
+	val->node = -1;
+
+	/* External methods have no body in this set of tables */
+	if (depth > AML_MAX_DEPTH || !n->start)
+		return AML_DYNAMIC;
+
+	for (i = 0; i < 8; i++)
+		ctx.locals[i].node = -1;
+
+	ret = exec_term_list(&ctx, n->start, n->end, val, &returned);
+	if (ret)
+		aml_value_free(val);
+
+	for (i = 0; i < 8; i++)
+		aml_value_free(&ctx.locals[i]);
+
+	return ret;
+}
+
+static enum aml_status eval_node(const struct aml_ns *ns, int node,
+				 const struct aml_value *args, int argc,
+				 int depth, struct aml_value *val)
+{
+	const struct aml_node *n = &ns->nodes[node];
+	struct aml_ctx ctx = {
+		.ns = ns,
+		.scope = n->parent,
+		.depth = depth,
+	};
+	const uint8_t *p = n->start;
+
+	memset(val, 0, sizeof(*val));
+	val->node = -1;
+
+	if (depth > AML_MAX_DEPTH)
+		return AML_DYNAMIC;
+
+	switch (n->type) {
+	case AML_NODE_NAME:
+		if (!p)
+			return AML_ERROR;
+		return eval_term(&ctx, &p, n->end, val);
+	case AML_NODE_METHOD:
+		return exec_method(ns, node, args, argc, depth, val);
+	default:
+		return AML_DYNAMIC;
+	}
+}
+
+/**
+ * aml_eval - statically evaluate a Name or Method node
+ * @ns: namespace
+ * @node: node to evaluate
+ * @args: method arguments, may be NULL if @argc is 0
+ * @argc: number of @args
+ * @val: pointer to store the result, free it with aml_value_free()
+ *
+ * Return AML_DYNAMIC if the result depends on runtime state.
+ */
+enum aml_status aml_eval(const struct aml_ns *ns, int node,
+			 const struct aml_value *args, int argc,
+			 struct aml_value *val)
+{
+	return eval_node(ns, node, args, argc, 0, val);
+}
+
+/*
+ * Collect ToUUID() buffers compared in a _DSM body. They are encoded as
+ * Buffer (0x10) { ... }: BufferOp, PkgLength 0x13, BytePrefix 0x10.
+ */
+int aml_find_guids(const struct aml_ns *ns, int node,
+		   uint8_t guids[][AML_GUID_SIZE], int max)
+{
+	const struct aml_node *n = &ns->nodes[node];
+	static const uint8_t pattern[] = {
+		AML_BUFFER_OP, 0x13, AML_BYTE_PREFIX, AML_GUID_SIZE,
+	};
+	const uint8_t *p;
+	int count = 0;
+	int i;
+
+	if (n->type != AML_NODE_METHOD || !n->start)
+		return 0;
+
+	for (p = n->start; p + sizeof(pattern) + AML_GUID_SIZE <= n->end;
+	     p++) {
+		if (memcmp(p, pattern, sizeof(pattern)))
+			continue;
+
+		p += sizeof(pattern);
+		for (i = 0; i < count; i++) {
+			if (!memcmp(guids[i], p, AML_GUID_SIZE))
+				break;
+		}
+		if (i == count && count < max)
+			memcpy(guids[count++], p, AML_GUID_SIZE);
+		p += AML_GUID_SIZE - 1;
+	}
+
+	return count;
+}
+
+/* Decode a compressed EISA ID such as EisaId ("PNP0C0A") */
+void aml_eisaid_to_string(uint32_t id, char out[8])
+{
+	static const char hex[] = "0123456789ABCDEF";
+	uint32_t swapped = ((id & 0xff) << 24) | ((id & 0xff00) << 8) |
+			   ((id >> 8) & 0xff00) | (id >> 24);
+
+	out[0] = 0x40 + ((swapped >> 26) & 0x1f);
+	out[1] = 0x40 + ((swapped >> 21) & 0x1f);
+	out[2] = 0x40 + ((swapped >> 16) & 0x1f);
+	out[3] = hex[(swapped >> 12) & 0xf];
+	out[4] = hex[(swapped >> 8) & 0xf];
+	out[5] = hex[(swapped >> 4) & 0xf];
+	out[6] = hex[swapped & 0xf];
+	out[7] = '\0';
+}
@@ -0,0 +1,85 @@
+#ifndef AML_H
+#define AML_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AML_TABLE_HEADER_SIZE	36
+#define AML_GUID_SIZE		16
+
+struct aml_table {
+	const uint8_t *data;		/* whole table including the header */
+	size_t len;
+	char signature[5];
+	char oem_table_id[9];
+};
+
+enum aml_node_type {
+	AML_NODE_SCOPE,			/* Scope() or implicitly created */
+	AML_NODE_EXTERNAL,
+	AML_NODE_DEVICE,
+	AML_NODE_NAME,
+	AML_NODE_METHOD,
+	AML_NODE_OTHER,			/* Processor, ThermalZone, ... */
+};
+
+struct aml_node {
+	uint32_t seg;			/* 4 character NameSeg */
+	int parent;			/* -1 for the root */
+	enum aml_node_type type;
+	int argc;			/* -1 if not a method */
+	const uint8_t *start;		/* Name: data object, Method: body */
+	const uint8_t *end;
+};
+
+struct aml_ns {
+	struct aml_node *nodes;
+	int *next;			/* hash chain, one per node */
+	int count;
+	int size;
+	int *hash;
+	unsigned int errors;		/* terms that couldn't be parsed */
+};
+
+enum aml_value_type {
+	AML_NONE,
+	AML_INTEGER,
+	AML_STRING,
+	AML_BUFFER,
+	AML_PACKAGE,
+	AML_REFERENCE,
+};
+
+struct aml_value {
+	enum aml_value_type type;
+	uint64_t integer;
+	uint8_t *data;			/* string (NUL terminated) or buffer */
+	size_t len;
+	struct aml_value *elements;	/* package */
+	size_t count;
+	int node;			/* reference, -1 if unresolved */
+};
+
+enum aml_status {
+	AML_OK,
+	AML_DYNAMIC,			/* needs runtime state to evaluate */
+	AML_ERROR,
+};
+
+int aml_ns_init(struct aml_ns *ns);
+void aml_ns_free(struct aml_ns *ns);
+void aml_ns_load(struct aml_ns *ns, const struct aml_table *tables, int count);
+
+int aml_ns_child(const struct aml_ns *ns, int parent, const char *seg);
+void aml_ns_path(const struct aml_ns *ns, int node, char *buf, size_t size);
+
+enum aml_status aml_eval(const struct aml_ns *ns, int node,
+			 const struct aml_value *args, int argc,
+			 struct aml_value *val);
+void aml_value_free(struct aml_value *val);
+
+int aml_find_guids(const struct aml_ns *ns, int node,
+		   uint8_t guids[][AML_GUID_SIZE], int max);
+void aml_eisaid_to_string(uint32_t id, char out[8]);
+
+#endif /* AML_H */
@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Auto exposure and gain control, see ae_agc.h.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "ae_agc.h"
+
+/* At most, for how far over the full scale the clipped quads are */
+#define MAX_CLIP_FACTOR		32.0
+/* The zones in the middle half of the frame count this many times more */
+#define CENTRE_WEIGHT		4.0
+/* A frame with more of its quads clipped is guessed from the clipped part */
+#define CLIPPED_FRAME		(2.0 / 3)
+/* Log of the range of lumas in a scene, for the guess above */
+#define SCENE_RANGE		4.0
+
+struct zone_model {
+	double weight;
+	double clipped;			/* part of its quads */
+	double clip_factor;		/* their mean over the full scale */
+	double mean;			/* of the others */
+};
+
+struct frame_model {
+	struct zone_model zones[AE_STATS_MAX_ZONES];
+	unsigned int count;
+	int clipped;			/* over CLIPPED_FRAME */
+};
+
+void ae_agc_default_config(struct ae_agc_config *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->target = 0.18;
+	cfg->tolerance = 0.05;
+	cfg->exposure_delay = 2;
+	cfg->gain_delay = 1;
+}
+
+static struct ae_agc_setting *entry(struct ae_agc *agc, uint32_t sequence)
+{
+	return &agc->history[sequence % AE_AGC_HISTORY];
+}
+
+void ae_agc_init(struct ae_agc *agc, const struct ae_agc_config *cfg,
+		 const struct ae_agc_limits *lim,
+		 const struct ae_agc_setting *current)
+{
+	unsigned int i;
+
+	memset(agc, 0, sizeof(*agc));
+	agc->cfg = *cfg;
+	agc->lim = *lim;
+	if (agc->lim.gain_unity <= 0)
+		agc->lim.gain_unity = lim->gain_min;
+
+	/* a setting requested after frame n is in place from n + 1 at best */
+	if (!agc->cfg.exposure_delay)
+		agc->cfg.exposure_delay = 1;
+	if (!agc->cfg.gain_delay)
+		agc->cfg.gain_delay = 1;
+	if (agc->cfg.exposure_delay >= AE_AGC_HISTORY)
+		agc->cfg.exposure_delay = AE_AGC_HISTORY - 1;
+	if (agc->cfg.gain_delay >= AE_AGC_HISTORY)
+		agc->cfg.gain_delay = AE_AGC_HISTORY - 1;
+
+	for (i = 0; i < AE_AGC_HISTORY; i++)
+		agc->history[i] = *current;
+}
+
+void ae_agc_set_limits(struct ae_agc *agc, const struct ae_agc_limits *lim)
+{
+	int32_t unity = agc->lim.gain_unity;
+
+	agc->lim = *lim;
+	if (agc->lim.gain_unity <= 0)
+		agc->lim.gain_unity = unity;
+}
+
+struct ae_agc_setting ae_agc_applied(const struct ae_agc *agc,
+				     uint32_t sequence)
+{
+	struct ae_agc_setting s;
+
+	s.exposure = agc->history[(sequence - agc->cfg.exposure_delay) %
+				  AE_AGC_HISTORY].exposure;
+	s.gain = agc->history[(sequence - agc->cfg.gain_delay) %
+			      AE_AGC_HISTORY].gain;
+
+	return s;
+}
+
+/*
+ * How far over the full scale the clipped quads of a zone go, guessed from
+ * the quads under the clip: if the density of the log of the luma goes on
+ * the same past it, the clipped quads spread over L = clipped / density
+ * and their mean is (e^L - 1) / L times the full scale.
+ */
+static double clip_factor(uint32_t clipped, uint32_t near)
+{
+	double spread = log(MAX_CLIP_FACTOR);
+
+	if (!clipped)
+		return 1;
+
+	/* the near quads span a factor of 2 */
+	if (near && clipped * M_LN2 / near < spread)
+		spread = clipped * M_LN2 / near;
+
+	return (exp(spread) - 1) / spread;
+}
+
+/*
+ * How far over the full scale the clipped quads go, guessed from the part
+ * of the frame that is clipped, for a frame that has too few quads under
+ * the clip for clip_factor(). The lumas of a scene are taken to spread
+ * evenly over SCENE_RANGE in log, the clipped ones over that part of it.
+ * Return 0 if the frame isn't clipped that much.
+ *
+ * On colour sensors, a quad whose green pixels are clipped and the others
+ * not is under the clip, with its luma just under it: clip_factor() takes
+ * these for how the zone goes on past the clip and guesses too little
+ * when most of the zone is clipped.
+ */
+static double frame_clip_factor(const struct ae_stats *stats)
+{
+	uint32_t clipped = 0;
+	double spread;
+	unsigned int i;
+
+	for (i = AE_STATS_CLIP; i < AE_STATS_BINS; i++)
+		clipped += stats->hist[i];
+	if (!stats->count || clipped <= stats->count * CLIPPED_FRAME)
+		return 0;
+
+	spread = fmin((double)clipped / stats->count * SCENE_RANGE,
+		      log(MAX_CLIP_FACTOR));
+
+	return (exp(spread) - 1) / spread;
+}
+
+static void frame_model(const struct ae_stats *stats, struct frame_model *f)
+{
+	double frame_factor = frame_clip_factor(stats);
+	unsigned int x, y, zone, n, clipped;
+	struct zone_model *m;
+	int centre_x, centre_y;
+
+	f->count = 0;
+	f->clipped = frame_factor > 0;
+
+	for (y = 0; y < stats->zones_y; y++) {
+		centre_y = 4 * y + 2 >= stats->zones_y &&
+			   4 * y + 2 < 3 * stats->zones_y;
+		for (x = 0; x < stats->zones_x; x++) {
+			zone = y * stats->zones_x + x;
+			n = stats->zone_count[zone];
+			clipped = stats->zone_clipped[zone];
+			if (!n)
+				continue;
+
+			centre_x = 4 * x + 2 >= stats->zones_x &&
+				   4 * x + 2 < 3 * stats->zones_x;
+			m = &f->zones[f->count++];
+			m->weight = centre_x && centre_y ? CENTRE_WEIGHT : 1;
+			m->clipped = (double)clipped / n;
+			m->clip_factor = fmax(frame_factor,
+					      clip_factor(clipped,
+							  stats->zone_near[zone]));
+			/* the lumas are rounded down */
+			m->mean = clipped < n ? (double)stats->zone_sum[zone] /
+						(n - clipped) + 0.5 : 0;
+		}
+	}
+}
+
+/*
+ * Metered luma, 0 to 1, if the exposure was @ratio times what it was: the
+ * unclipped quads of a zone are scaled, and its clipped quads stay so
+ * until @ratio takes them under the full scale
+ */
+static double predict(const struct frame_model *f, double ratio)
+{
+	const double full = AE_STATS_BINS - 1;
+	double sum = 0, weights = 0;
+	const struct zone_model *m;
+	unsigned int i;
+
+	for (i = 0; i < f->count; i++) {
+		m = &f->zones[i];
+		sum += m->weight * ((1 - m->clipped) *
+				    fmin(m->mean * ratio, full) +
+				    m->clipped * fmin(m->clip_factor * full *
+						      ratio, full));
+		weights += m->weight;
+	}
+
+	return weights ? sum / weights / full : 0;
+}
+
+double ae_agc_meter(const struct ae_stats *stats)
+{
+	struct frame_model f;
+
+	frame_model(stats, &f);
+	return predict(&f, 1);
+}
+
+/* The ratio that gives the target, by bisection as predict() grows with it */
+static double solve(const struct frame_model *f, double target)
+{
+	double lo = -16, hi = 16, mid;
+	int i;
+
+	for (i = 0; i < 48; i++) {
+		mid = (lo + hi) / 2;
+		if (predict(f, exp2(mid)) < target)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return exp2((lo + hi) / 2);
+}
+
+static double total(const struct ae_agc *agc, const struct ae_agc_setting *s)
+{
+	return (double)s->exposure * s->gain / agc->lim.gain_unity;
+}
+
+static int32_t clamp(int32_t v, int32_t min, int32_t max)
+{
+	return v < min ? min : v > max ? max : v;
+}
+
+static int32_t to_step(double v, int32_t min, int32_t max, int32_t step,
+		       double (*round)(double))
+{
+	if (step <= 0)
+		step = 1;
+
+	return clamp(min + (int32_t)round((v - min) / step) * step, min, max);
+}
+
+/*
+ * Exposure first, up to the limit, then the gain. Either the exposure is
+ * rounded down to whole lines and the gain makes up for it, or the gain
+ * is rounded up to its step and the exposure makes up for it, whichever
+ * is closer: the ov8865 has gain steps of 1x, the ov7251 exposures of a
+ * few lines only.
+ */
+static void split(const struct ae_agc *agc, double want,
+		  struct ae_agc_setting *out)
+{
+	const struct ae_agc_limits *lim = &agc->lim;
+	int32_t cap = lim->exposure_max;
+	struct ae_agc_setting a, b;
+	double exposure;
+
+	if (agc->cfg.exposure_limit > 0 && agc->cfg.exposure_limit < cap)
+		cap = agc->cfg.exposure_limit;
+	if (cap < lim->exposure_min)
+		cap = lim->exposure_min;
+
+	exposure = want < lim->exposure_min ? lim->exposure_min :
+		   want > cap ? cap : want;
+
+	a.exposure = to_step(exposure, lim->exposure_min, cap,
+			     lim->exposure_step, floor);
+	a.gain = to_step(want * lim->gain_unity / a.exposure, lim->gain_min,
+			 lim->gain_max, lim->gain_step, round);
+
+	b.gain = to_step(want * lim->gain_unity / exposure - 1e-6,
+			 lim->gain_min, lim->gain_max, lim->gain_step, ceil);
+	b.exposure = to_step(want * lim->gain_unity / b.gain,
+			     lim->exposure_min, lim->exposure_max,
+			     lim->exposure_step, round);
+
+	*out = fabs(log(total(agc, &a) / want)) <=
+	       fabs(log(total(agc, &b) / want)) ? a : b;
+}
+
+/*
+ * The gain of the setting to write after frame @sequence for a total of
+ * @want. The gain lands before the exposure: it makes up for the exposure
+ * still in place on that frame, so the frame is right already if the gain
+ * can go that far, and it lands with the new exposure on the next one.
+ */
+static int32_t transition_gain(const struct ae_agc *agc, uint32_t sequence,
+			       double want, const struct ae_agc_setting *split)
+{
+	const struct ae_agc_limits *lim = &agc->lim;
+	unsigned int ed = agc->cfg.exposure_delay, gd = agc->cfg.gain_delay;
+	int32_t exposure;
+
+	if (gd >= ed)
+		return split->gain;
+
+	exposure = agc->history[(sequence + gd - ed) % AE_AGC_HISTORY].exposure;
+	return to_step(want * lim->gain_unity / exposure, lim->gain_min,
+		       lim->gain_max, lim->gain_step, round);
+}
+
+int ae_agc_process(struct ae_agc *agc, uint32_t sequence,
+		   const struct ae_stats *stats, struct ae_agc_setting *out)
+{
+	const struct ae_agc_limits *lim = &agc->lim;
+	struct ae_agc_setting applied, *last;
+	struct frame_model f;
+	double want, min, max;
+	uint32_t s;
+
+	/* what was written last stays in place over dropped frames */
+	if (agc->started) {
+		last = entry(agc, agc->sequence);
+		for (s = agc->sequence + 1;
+		     s != sequence + 1 && s - agc->sequence <= AE_AGC_HISTORY;
+		     s++)
+			*entry(agc, s) = *last;
+	}
+	agc->sequence = sequence;
+	agc->started = 1;
+	last = entry(agc, sequence);
+
+	applied = ae_agc_applied(agc, sequence);
+	frame_model(stats, &f);
+	agc->measured = predict(&f, 1);
+
+	want = total(agc, &applied) * solve(&f, agc->cfg.target);
+	min = (double)lim->exposure_min * lim->gain_min / lim->gain_unity;
+	max = (double)lim->exposure_max * lim->gain_max / lim->gain_unity;
+	want = want < min ? min : want > max ? max : want;
+
+	/*
+	 * Keep going for the same total, unless it is off by too much. The
+	 * guess from a mostly clipped frame stands until it lands: the frames
+	 * until then are still clipped, with the gain that makes up for the
+	 * old exposure, and their guesses would undo it.
+	 */
+	if (applied.exposure == last->exposure && applied.gain == last->gain)
+		agc->clip_hold = 0;
+	if (!agc->aim || (!agc->clip_hold &&
+			  fabs(want / agc->aim - 1) >= agc->cfg.tolerance)) {
+		agc->aim = want;
+		agc->clip_hold = f.clipped;
+	}
+
+	split(agc, agc->aim, out);
+	out->gain = transition_gain(agc, sequence, agc->aim, out);
+	if (out->exposure == last->exposure && out->gain == last->gain)
+		return 0;
+
+	*last = *out;
+	return 1;
+}
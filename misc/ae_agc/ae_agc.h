@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Auto exposure and gain control from the statistics of ae_stats.h.
+ *
+ * The sensor drivers apply V4L2_CID_EXPOSURE and V4L2_CID_ANALOGUE_GAIN as
+ * one register group, and exposure takes effect two frames later, gain
+ * one frame later. The controller remembers what it asked for each frame,
+ * so it knows the exposure and gain that a frame was actually taken with.
+ * The light of the scene follows from that and from the frame's
+ * statistics, and so does the exposure and gain that gives the target
+ * luma, in one step. Frames taken before a change takes effect give the
+ * same answer again and don't move the controls any further.
+ */
+#ifndef AE_AGC_H
+#define AE_AGC_H
+
+#include <stdint.h>
+#include "ae_stats.h"
+
+#define AE_AGC_HISTORY		16
+
+/* The ranges of the controls, from VIDIOC_QUERY_EXT_CTRL */
+struct ae_agc_limits {
+	int32_t exposure_min;		/* lines */
+	int32_t exposure_max;
+	int32_t exposure_step;
+	int32_t gain_min;
+	int32_t gain_max;
+	int32_t gain_step;
+	int32_t gain_unity;		/* value of a gain of 1 */
+};
+
+struct ae_agc_config {
+	double target;			/* mean luma, 0 to 1 of the full scale */
+	double tolerance;		/* relative, below it nothing changes */
+	unsigned int exposure_delay;	/* frames */
+	unsigned int gain_delay;
+	int32_t exposure_limit;		/* before raising the gain, 0 for none */
+};
+
+struct ae_agc_setting {
+	int32_t exposure;
+	int32_t gain;
+};
+
+struct ae_agc {
+	struct ae_agc_config cfg;
+	struct ae_agc_limits lim;
+	/* what was requested after each frame, by sequence number */
+	struct ae_agc_setting history[AE_AGC_HISTORY];
+	uint32_t sequence;		/* of the last frame processed */
+	int started;
+	double aim;			/* total exposure aimed at */
+	double measured;		/* metered luma of the last frame */
+	int clip_hold;			/* aim from a clipped frame, in flight */
+};
+
+/* Defaults of ae_agc_config */
+void ae_agc_default_config(struct ae_agc_config *cfg);
+
+/* @current is what the sensor is set to */
+void ae_agc_init(struct ae_agc *agc, const struct ae_agc_config *cfg,
+		 const struct ae_agc_limits *lim,
+		 const struct ae_agc_setting *current);
+
+/* The ranges changed, e.g. the exposure with V4L2_CID_VBLANK */
+void ae_agc_set_limits(struct ae_agc *agc, const struct ae_agc_limits *lim);
+
+/*
+ * Process the statistics of frame @sequence. Return 1 and fill @out if
+ * the controls have to be set before the next frame, 0 if they stay. The
+ * gain of @out may only be for the frame that comes before the exposure
+ * lands, the next calls then set the final one.
+ */
+int ae_agc_process(struct ae_agc *agc, uint32_t sequence,
+		   const struct ae_stats *stats, struct ae_agc_setting *out);
+
+/* The setting frame @sequence was taken with, for the delays */
+struct ae_agc_setting ae_agc_applied(const struct ae_agc *agc,
+				     uint32_t sequence);
+
+/*
+ * Metered luma of @stats, 0 to 1: the mean of the zones weighted towards
+ * the centre, with the clipped quads counted at a few times full scale
+ */
+double ae_agc_meter(const struct ae_stats *stats);
+
+#endif /* AE_AGC_H */
@@ -0,0 +1,1130 @@
+/**
+ * This tool runs the auto exposure and gain control of ae_agc.c on a
+ * camera: it captures IPU3 packed 10-bit frames from the CIO2 video node,
+ * computes the statistics of ae_stats.c on each one, and sets
+ * V4L2_CID_EXPOSURE and V4L2_CID_ANALOGUE_GAIN of the sensor subdev in a
+ * single VIDIOC_S_EXT_CTRLS, within the ranges the driver reports. With
+ * -a it also runs the white balance of ../awb on the same frames and sets
+ * V4L2_CID_RED_BALANCE and V4L2_CID_BLUE_BALANCE (ov8865).
+ *
+ * With -S it runs the same loop on ../sensor_sim instead, the ov8865,
+ * ov5693 or ov7251 driver with its ranges and the delays of ae_agc, on a
+ * synthetic sequence of scenes or on a sequence recorded with -o, and
+ * checks how many frames it takes to converge after each scene change.
+ * The recordings are those of ../raw_record, rawrec's can be replayed too.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include "ae_agc.h"
+#include "ae_stats.h"
+#include "awb.h"
+#include "awb_stats.h"
+#include "ipu3_unpack.h"
+#include "raw_record.h"
+#include "sensor_sim.h"
+
+#define NUM_BUFFERS		4
+#define TIMEOUT_MS		2000
+#define SIM_SCENES		8
+#define SIM_HOLD		8
+#define SIM_MAX_FRAMES		3
+/* a frame is converged when its metered luma is this close to the target */
+#define SIM_CONVERGED		0.1
+/* black level of the ov8865, 10-bit */
+#define AWB_BLACK		64
+
+struct options {
+	struct ae_agc_config agc;
+	struct ae_stats_config stats;
+	int32_t gain_unity;
+	int verbose;
+	int awb;
+	struct awb_config awb_cfg;
+	struct awb_stats_config awb_stats;
+};
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void print_frame(uint32_t sequence, const struct ae_agc_setting *s,
+			const struct ae_stats *stats, const struct ae_agc *agc,
+			const struct ae_agc_setting *req)
+{
+	printf("frame %4u: exposure %5d gain %4d, mean %5.1f metered %.3f",
+	       sequence, s->exposure, s->gain, ae_stats_mean(stats),
+	       agc->measured);
+	if (req)
+		printf(" -> exposure %5d gain %4d", req->exposure, req->gain);
+	printf("\n");
+}
+
+/*
+ * Camera
+ */
+static int query_range(int fd, uint32_t id, int32_t *min, int32_t *max,
+		       int32_t *step)
+{
+	struct v4l2_query_ext_ctrl qc = { .id = id };
+
+	if (xioctl(fd, VIDIOC_QUERY_EXT_CTRL, &qc)) {
+		fprintf(stderr, "VIDIOC_QUERY_EXT_CTRL %#x: %s\n", id,
+			strerror(errno));
+		return -1;
+	}
+
+	*min = qc.minimum;
+	*max = qc.maximum;
+	*step = qc.step;
+	return 0;
+}
+
+static int query_limits(int fd, int32_t unity, struct ae_agc_limits *lim)
+{
+	if (query_range(fd, V4L2_CID_EXPOSURE, &lim->exposure_min,
+			&lim->exposure_max, &lim->exposure_step) ||
+	    query_range(fd, V4L2_CID_ANALOGUE_GAIN, &lim->gain_min,
+			&lim->gain_max, &lim->gain_step))
+		return -1;
+
+	/* the minimum is a gain of 1 for the ov8865, ov5693 and ov7251 */
+	lim->gain_unity = unity ? unity : lim->gain_min;
+	return 0;
+}
+
+static int get_setting(int fd, struct ae_agc_setting *s)
+{
+	struct v4l2_ext_control ctrl[2] = {
+		{ .id = V4L2_CID_EXPOSURE },
+		{ .id = V4L2_CID_ANALOGUE_GAIN },
+	};
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 2,
+		.controls = ctrl,
+	};
+
+	if (xioctl(fd, VIDIOC_G_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_G_EXT_CTRLS");
+		return -1;
+	}
+
+	s->exposure = ctrl[0].value;
+	s->gain = ctrl[1].value;
+	return 0;
+}
+
+/* Both in one call, the drivers write them as one register group */
+static int set_setting(int fd, const struct ae_agc_setting *s)
+{
+	struct v4l2_ext_control ctrl[2] = {
+		{ .id = V4L2_CID_EXPOSURE, .value = s->exposure },
+		{ .id = V4L2_CID_ANALOGUE_GAIN, .value = s->gain },
+	};
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 2,
+		.controls = ctrl,
+	};
+
+	if (xioctl(fd, VIDIOC_S_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_S_EXT_CTRLS");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int get_gains(int fd, struct awb_config *cfg, struct awb_gains *g)
+{
+	struct v4l2_ext_control ctrl[2] = {
+		{ .id = V4L2_CID_RED_BALANCE },
+		{ .id = V4L2_CID_BLUE_BALANCE },
+	};
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 2,
+		.controls = ctrl,
+	};
+	int32_t step;
+
+	if (query_range(fd, V4L2_CID_RED_BALANCE, &cfg->gain_min,
+			&cfg->gain_max, &step))
+		return -1;
+
+	if (xioctl(fd, VIDIOC_G_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_G_EXT_CTRLS");
+		return -1;
+	}
+
+	g->red = ctrl[0].value;
+	g->blue = ctrl[1].value;
+	return 0;
+}
+
+static int set_gains(int fd, const struct awb_gains *g)
+{
+	struct v4l2_ext_control ctrl[2] = {
+		{ .id = V4L2_CID_RED_BALANCE, .value = g->red },
+		{ .id = V4L2_CID_BLUE_BALANCE, .value = g->blue },
+	};
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 2,
+		.controls = ctrl,
+	};
+
+	if (xioctl(fd, VIDIOC_S_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_S_EXT_CTRLS");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The Bayer order of a format, -1 for the monochrome one */
+static int bayer_order(uint32_t fourcc)
+{
+	switch (fourcc) {
+	case V4L2_PIX_FMT_IPU3_SBGGR10:
+		return AWB_STATS_BGGR;
+	case V4L2_PIX_FMT_IPU3_SGBRG10:
+		return AWB_STATS_GBRG;
+	case V4L2_PIX_FMT_IPU3_SGRBG10:
+		return AWB_STATS_GRBG;
+	case V4L2_PIX_FMT_IPU3_SRGGB10:
+		return AWB_STATS_RGGB;
+	default:
+		return -1;
+	}
+}
+
+static int is_ipu3_format(uint32_t fourcc)
+{
+	return fourcc == V4L2_PIX_FMT_IPU3_SBGGR10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SGBRG10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SGRBG10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SRGGB10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_Y10;
+}
+
+/* The frames of -o, with the setting each was taken with */
+static struct rawrec_writer *create_record(const char *path,
+					   const struct ae_stats_config *cfg,
+					   uint32_t fourcc, size_t bpl,
+					   int32_t unity, const char *sensor)
+{
+	struct rawrec_info info = {
+		.width = cfg->width,
+		.height = cfg->height,
+		.fourcc = fourcc,
+		.bytesperline = bpl,
+		.flags = RAWREC_APPLIED,
+		.gain_unity = unity,
+		.sensor = sensor,
+	};
+	struct rawrec_writer *w;
+
+	w = rawrec_create(path, &info, 1);
+	if (!w)
+		perror(path);
+	return w;
+}
+
+static int write_record(struct rawrec_writer *w, uint32_t sequence,
+			uint64_t timestamp_ns, const struct ae_agc_setting *s,
+			const uint8_t *frame)
+{
+	struct rawrec_meta meta = {
+		.sequence = sequence,
+		.timestamp_ns = timestamp_ns,
+		.ctrl_mask = 1U << RAWREC_EXPOSURE |
+			     1U << RAWREC_ANALOGUE_GAIN,
+	};
+
+	meta.ctrls[RAWREC_EXPOSURE] = s->exposure;
+	meta.ctrls[RAWREC_ANALOGUE_GAIN] = s->gain;
+	if (rawrec_append(w, &meta, frame)) {
+		perror("record");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int finish_record(struct rawrec_writer *w, const char *path)
+{
+	if (w && rawrec_finish(w)) {
+		perror(path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int run_camera(struct options *opt, const char *video,
+		      const char *subdev, unsigned int frames,
+		      const char *record)
+{
+	struct v4l2_requestbuffers req = { .count = NUM_BUFFERS };
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+	struct v4l2_format fmt = { 0 };
+	struct v4l2_capability cap = { 0 };
+	struct pollfd pfd = { .events = POLLIN };
+	struct ae_stats_engine *engine = NULL;
+	struct awb_stats_engine *awb_engine = NULL;
+	struct ae_agc_setting current, out;
+	struct awb_gains gains, gains_out;
+	static struct awb_stats awb_stats;
+	struct awb awb;
+	void *map[NUM_BUFFERS] = { NULL };
+	size_t map_len[NUM_BUFFERS] = { 0 };
+	struct ae_agc_limits lim;
+	struct v4l2_buffer buf;
+	struct ae_stats stats;
+	struct ae_agc agc;
+	unsigned int i, n;
+	struct rawrec_writer *rec = NULL;
+	int fd, ctrl_fd, mplane, ret = -1, changed, awb_changed = 0;
+	uint32_t type, fourcc;
+	size_t bpl;
+	double t0, stats_us = 0, awb_us = 0;
+
+	fd = open(video, O_RDWR | O_NONBLOCK);
+	if (fd < 0) {
+		perror(video);
+		return -1;
+	}
+	ctrl_fd = subdev ? open(subdev, O_RDWR) : fd;
+	if (ctrl_fd < 0) {
+		perror(subdev);
+		close(fd);
+		return -1;
+	}
+
+	if (xioctl(fd, VIDIOC_QUERYCAP, &cap)) {
+		perror("VIDIOC_QUERYCAP");
+		goto out;
+	}
+	mplane = !!((cap.capabilities & V4L2_CAP_DEVICE_CAPS ?
+		     cap.device_caps : cap.capabilities) &
+		    V4L2_CAP_VIDEO_CAPTURE_MPLANE);
+	type = mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE :
+			V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	fmt.type = type;
+	if (xioctl(fd, VIDIOC_G_FMT, &fmt)) {
+		perror("VIDIOC_G_FMT");
+		goto out;
+	}
+	opt->stats.width = mplane ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width;
+	opt->stats.height = mplane ? fmt.fmt.pix_mp.height :
+				     fmt.fmt.pix.height;
+	fourcc = mplane ? fmt.fmt.pix_mp.pixelformat : fmt.fmt.pix.pixelformat;
+	bpl = mplane ? fmt.fmt.pix_mp.plane_fmt[0].bytesperline :
+		       fmt.fmt.pix.bytesperline;
+	if (!is_ipu3_format(fourcc) ||
+	    bpl < ipu3_packed_bpl(opt->stats.width)) {
+		fprintf(stderr, "%s: not an IPU3 packed 10-bit format\n",
+			video);
+		goto out;
+	}
+
+	engine = ae_stats_create(&opt->stats);
+	if (!engine) {
+		perror("ae_stats_create");
+		goto out;
+	}
+
+	if (query_limits(ctrl_fd, opt->gain_unity, &lim) ||
+	    get_setting(ctrl_fd, &current))
+		goto out;
+	ae_agc_init(&agc, &opt->agc, &lim, &current);
+
+	if (opt->awb) {
+		if (bayer_order(fourcc) < 0) {
+			fprintf(stderr, "%s: no white balance in monochrome\n",
+				video);
+			goto out;
+		}
+		opt->awb_stats.width = opt->stats.width;
+		opt->awb_stats.height = opt->stats.height;
+		opt->awb_stats.order = bayer_order(fourcc);
+		awb_engine = awb_stats_create(&opt->awb_stats);
+		if (!awb_engine) {
+			perror("awb_stats_create");
+			goto out;
+		}
+		if (get_gains(ctrl_fd, &opt->awb_cfg, &gains))
+			goto out;
+		awb_init(&awb, &opt->awb_cfg, &gains);
+	}
+
+	printf("%ux%u, exposure %d..%d, gain %d..%d (1x = %d), reading %.1f%% of each frame\n",
+	       opt->stats.width, opt->stats.height, lim.exposure_min,
+	       lim.exposure_max, lim.gain_min, lim.gain_max, lim.gain_unity,
+	       100 * ae_stats_read_fraction(engine));
+
+	if (record) {
+		rec = create_record(record, &opt->stats, fourcc, bpl,
+				    lim.gain_unity, NULL);
+		if (!rec)
+			goto out;
+	}
+
+	req.type = type;
+	req.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(fd, VIDIOC_REQBUFS, &req)) {
+		perror("VIDIOC_REQBUFS");
+		goto out;
+	}
+	if (!req.count || req.count > NUM_BUFFERS) {
+		fprintf(stderr, "VIDIOC_REQBUFS: got %u buffers\n", req.count);
+		goto out_free;
+	}
+
+	for (i = 0; i < req.count; i++) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type = type;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (mplane) {
+			buf.m.planes = planes;
+			buf.length = VIDEO_MAX_PLANES;
+		}
+		if (xioctl(fd, VIDIOC_QUERYBUF, &buf)) {
+			perror("VIDIOC_QUERYBUF");
+			goto out_free;
+		}
+		map_len[i] = mplane ? planes[0].length : buf.length;
+		map[i] = mmap(NULL, map_len[i], PROT_READ, MAP_SHARED, fd,
+			      mplane ? planes[0].m.mem_offset : buf.m.offset);
+		if (map[i] == MAP_FAILED) {
+			map[i] = NULL;
+			perror("mmap");
+			goto out_free;
+		}
+		if (xioctl(fd, VIDIOC_QBUF, &buf)) {
+			perror("VIDIOC_QBUF");
+			goto out_free;
+		}
+	}
+
+	if (xioctl(fd, VIDIOC_STREAMON, &type)) {
+		perror("VIDIOC_STREAMON");
+		goto out_free;
+	}
+
+	pfd.fd = fd;
+	for (n = 0; !frames || n < frames; n++) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type = type;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if (mplane) {
+			buf.m.planes = planes;
+			buf.length = VIDEO_MAX_PLANES;
+		}
+		while (xioctl(fd, VIDIOC_DQBUF, &buf)) {
+			if (errno != EAGAIN) {
+				perror("VIDIOC_DQBUF");
+				goto out_stream;
+			}
+			if (poll(&pfd, 1, TIMEOUT_MS) <= 0) {
+				fprintf(stderr, "no frame in %d ms\n",
+					TIMEOUT_MS);
+				goto out_stream;
+			}
+		}
+
+		t0 = now_us();
+		ae_stats_compute(engine, map[buf.index], bpl, &stats);
+		stats_us += now_us() - t0;
+		if (awb_engine) {
+			t0 = now_us();
+			awb_stats_compute(awb_engine, map[buf.index], bpl,
+					  &awb_stats);
+			awb_us += now_us() - t0;
+		}
+
+		current = ae_agc_applied(&agc, buf.sequence);
+		/* from the buffer, its pages take O_DIRECT */
+		if (rec && write_record(rec, buf.sequence,
+					buf.timestamp.tv_sec * 1000000000ULL +
+					buf.timestamp.tv_usec * 1000ULL,
+					&current, map[buf.index]))
+			goto out_stream;
+
+		if (xioctl(fd, VIDIOC_QBUF, &buf)) {
+			perror("VIDIOC_QBUF");
+			goto out_stream;
+		}
+
+		/* the exposure range follows V4L2_CID_VBLANK */
+		if (query_limits(ctrl_fd, opt->gain_unity, &lim))
+			goto out_stream;
+		ae_agc_set_limits(&agc, &lim);
+
+		changed = ae_agc_process(&agc, buf.sequence, &stats, &out);
+		if (changed && set_setting(ctrl_fd, &out))
+			goto out_stream;
+		if (awb_engine) {
+			gains = awb_applied(&awb, buf.sequence);
+			awb_changed = awb_process(&awb, buf.sequence,
+						  &awb_stats, &gains_out);
+			if (awb_changed && set_gains(ctrl_fd, &gains_out))
+				goto out_stream;
+		}
+		if (opt->verbose)
+			print_frame(buf.sequence, &current, &stats, &agc,
+				    changed ? &out : NULL);
+		if (opt->verbose && awb_engine) {
+			printf("            red %5d blue %5d, %u zones",
+			       gains.red, gains.blue, awb.zones_used);
+			if (awb_changed)
+				printf(" -> red %5d blue %5d", gains_out.red,
+				       gains_out.blue);
+			printf("\n");
+		}
+	}
+
+	printf("%u frames, statistics in %.1f us per frame\n", n,
+	       n ? stats_us / n : 0);
+	if (awb_engine)
+		printf("white balance statistics in %.1f us per frame\n",
+		       n ? awb_us / n : 0);
+	ret = 0;
+
+out_stream:
+	xioctl(fd, VIDIOC_STREAMOFF, &type);
+out_free:
+	for (i = 0; i < NUM_BUFFERS; i++)
+		if (map[i])
+			munmap(map[i], map_len[i]);
+	req.count = 0;
+	xioctl(fd, VIDIOC_REQBUFS, &req);
+out:
+	if (finish_record(rec, record))
+		ret = -1;
+	ae_stats_destroy(engine);
+	awb_stats_destroy(awb_engine);
+	if (ctrl_fd != fd)
+		close(ctrl_fd);
+	close(fd);
+	return ret;
+}
+
+/*
+ * Simulation
+ */
+
+/* The size of each sensor, in the mode its driver picks for it */
+struct sensor_size {
+	const char *name;
+	unsigned int width;
+	unsigned int height;
+};
+
+static const struct sensor_size sensor_sizes[] = {
+	{ "ov8865", 1632, 1224 },
+	{ "ov5693", 1296, 972 },
+	{ "ov7251", 640, 480 },
+};
+
+struct scene {
+	double light;
+	/* brighter window in the top right corner, 0 for none */
+	double window;
+};
+
+/*
+ * Lights switched on and off, a window coming into view, stepping outside
+ * and into a room too dark for the sensor
+ */
+static const struct scene sim_scenes[SIM_SCENES] = {
+	{ 1, 0 }, { 0.08, 0 }, { 0.5, 0 }, { 1, 25 },
+	{ 4, 0 }, { 0.002, 0 }, { 0.03, 0 }, { 0.3, 0 },
+};
+
+struct sim {
+	struct sensor_sim *sensor;
+	const char *name;
+	/* the ranges and defaults of the driver in its mode */
+	struct ae_agc_limits lim;
+	struct ae_agc_setting def;
+	int mono;
+	unsigned int width;
+	unsigned int height;
+	size_t bpl;
+	/* pixel values for an exposure of 1 line at 1x, per scene */
+	unsigned int scenes;
+	float **light;
+	double *scene_light;
+};
+
+/*
+ * Patches of random reflectance between 3% and 90%, darker towards the
+ * corners as with a real lens, in the colours of a Bayer pattern, for a
+ * light of 1 that needs a quarter of the maximum exposure at 1x
+ */
+static int make_reflectance(struct sim *sim, float *map)
+{
+	double scale = 1023.0 * 4 / sim->lim.exposure_max;
+	static const double colour[4] = { 0.55, 1, 1, 0.45 };
+	unsigned int x, y, px = 32, bx = (sim->width + px - 1) / px;
+	double *patch, dx, dy, v;
+	uint32_t seed = 1;
+
+	patch = calloc(bx * ((sim->height + px - 1) / px), sizeof(*patch));
+	if (!patch)
+		return -1;
+	for (x = 0; x < bx * ((sim->height + px - 1) / px); x++) {
+		seed = seed * 1664525 + 1013904223;
+		patch[x] = 0.03 * pow(30, (seed >> 8) / 16777216.0);
+	}
+
+	for (y = 0; y < sim->height; y++) {
+		for (x = 0; x < sim->width; x++) {
+			dx = (x - sim->width / 2.0) / sim->width;
+			dy = (y - sim->height / 2.0) / sim->width;
+			v = patch[y / px * bx + x / px] *
+			    (1 - 1.2 * (dx * dx + dy * dy));
+			if (!sim->mono)
+				v *= colour[(y & 1) * 2 + (x & 1)];
+			map[y * sim->width + x] = v * scale;
+		}
+	}
+
+	free(patch);
+	return 0;
+}
+
+static int sim_synthetic(struct sim *sim)
+{
+	unsigned int i, x, y, px = sim->width * sim->height;
+	float *map;
+
+	sim->scenes = SIM_SCENES;
+	sim->light = calloc(SIM_SCENES, sizeof(*sim->light));
+	sim->scene_light = calloc(SIM_SCENES, sizeof(*sim->scene_light));
+	if (!sim->light || !sim->scene_light)
+		return -1;
+
+	for (i = 0; i < SIM_SCENES; i++) {
+		map = malloc(px * sizeof(*map));
+		if (!map)
+			return -1;
+		sim->light[i] = map;
+		sim->scene_light[i] = sim_scenes[i].light;
+		if (!i && make_reflectance(sim, map))
+			return -1;
+		if (i)
+			memcpy(map, sim->light[0], px * sizeof(*map));
+	}
+
+	for (i = 0; i < SIM_SCENES; i++) {
+		for (y = 0; y < sim->height; y++) {
+			for (x = 0; x < sim->width; x++) {
+				map = &sim->light[i][y * sim->width + x];
+				*map *= sim_scenes[i].light;
+				if (sim_scenes[i].window && y < sim->height / 2 &&
+				    x >= sim->width / 2)
+					*map *= sim_scenes[i].window;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * The setting frame @i was taken with. A recording of rawrec has the
+ * controls the driver had when each frame was dequeued, which a control
+ * written after a frame reaches one frame before it applies.
+ */
+static int recorded_setting(const struct rawrec_reader *r, uint64_t i,
+			    const struct ae_agc_config *cfg,
+			    struct ae_agc_setting *s)
+{
+	unsigned int exposure_shift = 0, gain_shift = 0;
+
+	if (!(rawrec_header(r)->flags & RAWREC_APPLIED)) {
+		if (cfg->exposure_delay)
+			exposure_shift = cfg->exposure_delay - 1;
+		if (cfg->gain_delay)
+			gain_shift = cfg->gain_delay - 1;
+	}
+	if (i < exposure_shift || i < gain_shift)
+		return -1;
+
+	s->exposure = rawrec_meta(r, i - exposure_shift)->ctrls[RAWREC_EXPOSURE];
+	s->gain = rawrec_meta(r, i - gain_shift)->ctrls[RAWREC_ANALOGUE_GAIN];
+	return 0;
+}
+
+/* The light of a scene from each recorded frame and its setting */
+static int sim_recorded(struct sim *sim, const char *path,
+			const struct ae_agc_config *cfg)
+{
+	const uint32_t needed = 1U << RAWREC_EXPOSURE |
+				1U << RAWREC_ANALOGUE_GAIN;
+	const struct rawrec_header *h;
+	const struct rawrec_meta *m;
+	struct ae_agc_setting s;
+	struct rawrec_reader *r;
+	uint16_t *line = NULL;
+	const uint8_t *frame;
+	unsigned int x, y;
+	uint64_t i, frames;
+	double total;
+	int ret = -1;
+
+	r = rawrec_open(path);
+	if (!r) {
+		perror(path);
+		return -1;
+	}
+	h = rawrec_header(r);
+	frames = rawrec_frames(r);
+
+	if (!is_ipu3_format(h->fourcc) || h->width % 2 || h->height < 2 ||
+	    h->bytesperline < ipu3_packed_bpl(h->width) ||
+	    h->gain_unity <= 0) {
+		fprintf(stderr, "%s: not IPU3 packed frames with their gain\n",
+			path);
+		goto out;
+	}
+	sim->width = h->width;
+	sim->height = h->height;
+
+	sim->light = calloc(frames, sizeof(*sim->light));
+	line = malloc(h->width * sizeof(*line));
+	if (!sim->light || !line)
+		goto out;
+
+	rawrec_prefetch(r, 0);
+	for (i = 0; i < frames; i++) {
+		rawrec_prefetch(r, i + 1);
+		m = rawrec_meta(r, i);
+		if ((m->ctrl_mask & needed) != needed) {
+			fprintf(stderr, "%s: no exposure and gain in frame %llu\n",
+				path, (unsigned long long)i);
+			goto out;
+		}
+		if (recorded_setting(r, i, cfg, &s))
+			continue;
+		if (s.exposure <= 0 || s.gain <= 0) {
+			fprintf(stderr, "%s: bad setting in frame %llu\n", path,
+				(unsigned long long)i);
+			goto out;
+		}
+
+		sim->light[sim->scenes] = malloc(h->width * h->height *
+						 sizeof(float));
+		if (!sim->light[sim->scenes])
+			goto out;
+
+		frame = rawrec_frame(r, i);
+		total = (double)s.exposure * s.gain / h->gain_unity;
+		for (y = 0; y < h->height; y++) {
+			ipu3_unpack_line16(frame + y * h->bytesperline, line,
+					   h->width);
+			for (x = 0; x < h->width; x++)
+				sim->light[sim->scenes][y * h->width + x] =
+					line[x] / total;
+		}
+		sim->scenes++;
+	}
+
+	if (!sim->scenes) {
+		fprintf(stderr, "%s: no frames\n", path);
+		goto out;
+	}
+	ret = 0;
+
+out:
+	free(line);
+	rawrec_close(r);
+	return ret;
+}
+
+/* The driver of @name in the mode of its size */
+static int sim_open(struct sim *sim, const char *name)
+{
+	struct sensor_sim_config cfg = { .sensor = name, .vblank = -1 };
+	const struct sensor_sim_ctrl *exposure, *gain;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sensor_sizes) / sizeof(sensor_sizes[0]); i++) {
+		if (!strcmp(sensor_sizes[i].name, name)) {
+			cfg.width = sensor_sizes[i].width;
+			cfg.height = sensor_sizes[i].height;
+		}
+	}
+	if (!cfg.width) {
+		fprintf(stderr, "unknown sensor %s\n", name);
+		return -1;
+	}
+
+	sim->sensor = sensor_sim_create(&cfg);
+	if (!sim->sensor) {
+		perror(name);
+		return -1;
+	}
+	sim->name = name;
+	sim->mono = sensor_sim_mono(sim->sensor);
+	sim->width = sensor_sim_mode(sim->sensor)->width;
+	sim->height = sensor_sim_mode(sim->sensor)->height;
+
+	exposure = sensor_sim_ctrl(sim->sensor, SENSOR_SIM_EXPOSURE);
+	gain = sensor_sim_ctrl(sim->sensor, SENSOR_SIM_GAIN);
+	sim->lim = (struct ae_agc_limits) {
+		.exposure_min = exposure->min,
+		.exposure_max = exposure->max,
+		.exposure_step = exposure->step,
+		.gain_min = gain->min,
+		.gain_max = gain->max,
+		.gain_step = gain->step,
+		.gain_unity = gain->min,
+	};
+	sim->def.exposure = exposure->def;
+	sim->def.gain = gain->def;
+	return 0;
+}
+
+static void sim_free(struct sim *sim)
+{
+	unsigned int i;
+
+	for (i = 0; sim->light && i < sim->scenes; i++)
+		free(sim->light[i]);
+	free(sim->light);
+	free(sim->scene_light);
+	if (sim->sensor)
+		sensor_sim_destroy(sim->sensor);
+}
+
+static void sim_write(struct sim *sim, uint32_t sequence,
+		      const struct ae_agc_setting *s)
+{
+	sensor_sim_s_ctrl(sim->sensor, sequence, SENSOR_SIM_EXPOSURE,
+			  s->exposure);
+	sensor_sim_s_ctrl(sim->sensor, sequence, SENSOR_SIM_GAIN, s->gain);
+}
+
+/* Take frame @sequence of @scene with what the sensor has applied */
+static int sim_capture(struct sim *sim, unsigned int scene,
+		       uint32_t sequence, uint8_t *frame,
+		       struct ae_agc_setting *applied)
+{
+	applied->exposure = sensor_sim_g_ctrl(sim->sensor, sequence,
+					      SENSOR_SIM_EXPOSURE);
+	applied->gain = sensor_sim_g_ctrl(sim->sensor, sequence,
+					  SENSOR_SIM_GAIN);
+
+	return sensor_sim_expose(sim->sensor, sequence, sim->light[scene],
+				 sim->width, sim->height, 0, frame, sim->bpl);
+}
+
+static int at_limit(const struct sim *sim, const struct ae_agc_setting *s,
+		    double measured, double target)
+{
+	const struct ae_agc_limits *lim = &sim->lim;
+
+	if (measured > target)
+		return s->exposure == lim->exposure_min &&
+		       s->gain == lim->gain_min;
+
+	return s->exposure == lim->exposure_max && s->gain == lim->gain_max;
+}
+
+static int run_sim(struct options *opt, const char *model_name,
+		   const char *replay, unsigned int hold,
+		   unsigned int max_frames, const char *record)
+{
+	struct sim sim = { 0 };
+	const struct sensor_sim_mode *mode;
+	struct ae_stats_engine *engine = NULL;
+	struct ae_agc_setting applied, out;
+	struct ae_stats stats;
+	struct ae_agc agc;
+	unsigned int i, n, scene, settled, failed = 0;
+	int changed, converged, ret = -1;
+	uint8_t *frame = NULL;
+	struct rawrec_writer *rec = NULL;
+	double t0, stats_us = 0;
+	uint64_t interval_ns;
+
+	if (sim_open(&sim, model_name))
+		goto out;
+	interval_ns = sensor_sim_interval_ns(sim.sensor);
+
+	/* the scene at the top left of the mode */
+	if (opt->stats.width)
+		sim.width = opt->stats.width;
+	if (opt->stats.height)
+		sim.height = opt->stats.height;
+	if (replay ? sim_recorded(&sim, replay, &opt->agc) :
+		     sim_synthetic(&sim)) {
+		fprintf(stderr, "can't set up the scenes\n");
+		goto out;
+	}
+	mode = sensor_sim_mode(sim.sensor);
+	if (sim.width > mode->width || sim.height > mode->height) {
+		fprintf(stderr, "%ux%u doesn't fit in the %ux%u mode\n",
+			sim.width, sim.height, mode->width, mode->height);
+		goto out;
+	}
+	opt->stats.width = sim.width;
+	opt->stats.height = sim.height;
+	sim.bpl = ipu3_packed_bpl(sim.width);
+
+	engine = ae_stats_create(&opt->stats);
+	if (!engine) {
+		perror("ae_stats_create");
+		goto out;
+	}
+
+	frame = calloc(sim.height, sim.bpl);
+	if (!frame)
+		goto out;
+
+	if (record) {
+		rec = create_record(record, &opt->stats, sim.mono ?
+				    V4L2_PIX_FMT_IPU3_Y10 :
+				    V4L2_PIX_FMT_IPU3_SBGGR10,
+				    sim.bpl, sim.lim.gain_unity, sim.name);
+		if (!rec)
+			goto out;
+	}
+
+	ae_agc_init(&agc, &opt->agc, &sim.lim, &sim.def);
+	/* the same delays as the controller, after its checks */
+	sensor_sim_set_delay(sim.sensor, SENSOR_SIM_EXPOSURE,
+			     agc.cfg.exposure_delay);
+	sensor_sim_set_delay(sim.sensor, SENSOR_SIM_GAIN, agc.cfg.gain_delay);
+
+	printf("%s %ux%u, %u scenes of %u frames, reading %.1f%% of each frame\n",
+	       sim.name, sim.width, sim.height, sim.scenes, hold,
+	       100 * ae_stats_read_fraction(engine));
+
+	for (scene = 0; scene < sim.scenes; scene++) {
+		settled = hold;
+		for (i = 0; i < hold; i++) {
+			n = scene * hold + i;
+
+			if (sim_capture(&sim, scene, n, frame, &applied)) {
+				perror(sim.name);
+				goto out;
+			}
+			if (rec && write_record(rec, n, n * interval_ns,
+						&applied, frame))
+				goto out;
+
+			t0 = now_us();
+			ae_stats_compute(engine, frame, sim.bpl, &stats);
+			stats_us += now_us() - t0;
+
+			changed = ae_agc_process(&agc, n, &stats, &out);
+			if (changed)
+				sim_write(&sim, n, &out);
+
+			converged = fabs(agc.measured / opt->agc.target - 1) <=
+					    SIM_CONVERGED ||
+				    at_limit(&sim, &applied, agc.measured,
+					     opt->agc.target);
+			if (!converged)
+				settled = hold;
+			else if (settled == hold)
+				settled = i;
+
+			if (opt->verbose)
+				print_frame(n, &applied, &stats, &agc,
+					    changed ? &out : NULL);
+		}
+
+		if (settled > max_frames)
+			failed++;
+		printf("scene %u", scene);
+		if (sim.scene_light)
+			printf(" (light %g)", sim.scene_light[scene]);
+		printf(": exposure %d gain %d, metered %.3f, ",
+		       applied.exposure, applied.gain, agc.measured);
+		if (settled == hold)
+			printf("not converged\n");
+		else
+			printf("converged in %u frames%s\n", settled,
+			       settled > max_frames ? ", too slow" : "");
+	}
+
+	printf("statistics in %.1f us per frame\n",
+	       stats_us / (sim.scenes * hold));
+	ret = failed ? 1 : 0;
+
+out:
+	if (finish_record(rec, record))
+		ret = -1;
+	free(frame);
+	ae_stats_destroy(engine);
+	sim_free(&sim);
+	return ret;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -d <video node> [-s <subdev>] [-n <frames>] [-o <record>]\n"
+		"          [-a] [-b <black level>]\n"
+		"       %s -S [-m ov8865|ov5693|ov7251] [-r <record>] [-W <width>]\n"
+		"          [-H <height>] [-f <frames per scene>] [-c <max frames>] [-o <record>]\n"
+		"options: [-t <target>] [-T <tolerance>] [-z <zones WxH>] [-x <step x>]\n"
+		"         [-y <step y>] [-D <exposure delay>,<gain delay>]\n"
+		"         [-e <exposure limit>] [-u <gain of 1x>] [-v]\n",
+		argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct options opt = {
+		.stats = {
+			.zones_x = 8,
+			.zones_y = 6,
+		},
+		.awb_stats = {
+			.zones_x = 16,
+			.zones_y = 12,
+			.black = AWB_BLACK,
+			.dark = 16,
+			.saturation = 1000,
+			.isa = AWB_STATS_ISA_AUTO,
+		},
+	};
+	const char *video = NULL, *subdev = NULL, *record = NULL;
+	const char *model = "ov8865", *replay = NULL;
+	unsigned int frames = 0, hold = SIM_HOLD, max_frames = SIM_MAX_FRAMES;
+	int sim = 0, c, ret;
+
+	ae_agc_default_config(&opt.agc);
+	awb_default_config(&opt.awb_cfg);
+
+	while ((c = getopt(argc, argv, "d:s:n:o:ab:Sm:r:W:H:f:c:t:T:z:x:y:D:e:u:v")) != -1) {
+		switch (c) {
+		case 'd':
+			video = optarg;
+			break;
+		case 's':
+			subdev = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			record = optarg;
+			break;
+		case 'a':
+			opt.awb = 1;
+			break;
+		case 'b':
+			opt.awb_stats.black = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			sim = 1;
+			break;
+		case 'm':
+			model = optarg;
+			break;
+		case 'r':
+			replay = optarg;
+			break;
+		case 'W':
+			opt.stats.width = strtoul(optarg, NULL, 0);
+			break;
+		case 'H':
+			opt.stats.height = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			hold = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			max_frames = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			opt.agc.target = strtod(optarg, NULL);
+			break;
+		case 'T':
+			opt.agc.tolerance = strtod(optarg, NULL);
+			break;
+		case 'z':
+			if (sscanf(optarg, "%ux%u", &opt.stats.zones_x,
+				   &opt.stats.zones_y) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'x':
+			opt.stats.step_x = strtoul(optarg, NULL, 0);
+			break;
+		case 'y':
+			opt.stats.step_y = strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			if (sscanf(optarg, "%u,%u", &opt.agc.exposure_delay,
+				   &opt.agc.gain_delay) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'e':
+			opt.agc.exposure_limit = strtol(optarg, NULL, 0);
+			break;
+		case 'u':
+			opt.gain_unity = strtol(optarg, NULL, 0);
+			break;
+		case 'v':
+			opt.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (opt.agc.target <= 0 || opt.agc.target >= 1 || !hold ||
+	    (!sim && !video) || (sim && opt.awb)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (sim)
+		ret = run_sim(&opt, model, replay, hold, max_frames, record);
+	else
+		ret = run_camera(&opt, video, subdev, frames, record);
+
+	return ret < 0 ? 1 : ret;
+}
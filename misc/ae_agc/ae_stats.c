@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The positions of the chunks and the zone of each quad column are worked
+ * out once in ae_stats_create(), ae_stats_compute() then only unpacks the
+ * chunks and adds up their quads.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ae_stats.h"
+#include "ipu3_unpack.h"
+
+#define CHUNK_BYTES	(2 * IPU3_PACKED_BLOCK_BYTES)
+#define CHUNK_PIXELS	(2 * IPU3_PACKED_BLOCK_PIXELS)
+
+struct ae_stats_chunk {
+	size_t offset;			/* in the line */
+	unsigned int pixels;		/* 50, less at the end of the line */
+	const uint8_t *zone;		/* of its quads, in zone_x */
+};
+
+struct ae_stats_pair {
+	unsigned int y;			/* first line */
+	unsigned int zone;		/* first zone of its row */
+	unsigned int chunk;		/* first chunk read */
+};
+
+struct ae_stats_engine {
+	unsigned int zones_x;
+	unsigned int zones_y;
+	size_t frame_bytes;
+	unsigned int step_x;
+	struct ae_stats_chunk *chunks;	/* all of a line */
+	unsigned int num_chunks;
+	struct ae_stats_pair *pairs;
+	unsigned int num_pairs;
+	uint8_t *zone_x;		/* of each quad column */
+};
+
+struct ae_stats_engine *ae_stats_create(const struct ae_stats_config *cfg)
+{
+	unsigned int step_x = cfg->step_x ? cfg->step_x : 4;
+	unsigned int step_y = cfg->step_y ? cfg->step_y : 16;
+	unsigned int quads = cfg->width / 2;
+	struct ae_stats_engine *engine;
+	unsigned int i, x, y;
+
+	if (!cfg->width || cfg->width % 2 || cfg->height < 2 ||
+	    !cfg->zones_x || !cfg->zones_y ||
+	    cfg->zones_x > quads || cfg->zones_y > cfg->height / 2 ||
+	    cfg->zones_x * cfg->zones_y > AE_STATS_MAX_ZONES || step_y % 2) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	engine = calloc(1, sizeof(*engine));
+	if (!engine)
+		return NULL;
+
+	engine->zones_x = cfg->zones_x;
+	engine->zones_y = cfg->zones_y;
+	engine->step_x = step_x;
+	engine->frame_bytes = ipu3_packed_bpl(cfg->width) * cfg->height;
+	engine->chunks = calloc((cfg->width + CHUNK_PIXELS - 1) / CHUNK_PIXELS,
+				sizeof(*engine->chunks));
+	engine->pairs = calloc(cfg->height / 2, sizeof(*engine->pairs));
+	engine->zone_x = malloc(quads);
+	if (!engine->chunks || !engine->pairs || !engine->zone_x) {
+		ae_stats_destroy(engine);
+		return NULL;
+	}
+
+	for (i = 0; i < quads; i++)
+		engine->zone_x[i] = (uint64_t)i * cfg->zones_x / quads;
+
+	for (x = 0; x < cfg->width; x += CHUNK_PIXELS) {
+		struct ae_stats_chunk *c = &engine->chunks[engine->num_chunks++];
+
+		c->offset = x / CHUNK_PIXELS * CHUNK_BYTES;
+		c->pixels = cfg->width - x < CHUNK_PIXELS ? cfg->width - x :
+							     CHUNK_PIXELS;
+		c->zone = engine->zone_x + x / 2;
+	}
+
+	/*
+	 * Start half a step in, so that the samples are centred, and read
+	 * other chunks on each pair so that all the columns are sampled
+	 */
+	for (y = step_y / 2 & ~1U; y + 1 < cfg->height; y += step_y) {
+		struct ae_stats_pair *p = &engine->pairs[engine->num_pairs];
+
+		p->chunk = (step_x / 2 + engine->num_pairs++) % step_x;
+		p->y = y;
+		p->zone = (uint64_t)y * cfg->zones_y / cfg->height *
+			  cfg->zones_x;
+	}
+
+	return engine;
+}
+
+void ae_stats_destroy(struct ae_stats_engine *engine)
+{
+	if (!engine)
+		return;
+
+	free(engine->chunks);
+	free(engine->pairs);
+	free(engine->zone_x);
+	free(engine);
+}
+
+void ae_stats_compute(struct ae_stats_engine *engine, const uint8_t *frame,
+		      size_t stride, struct ae_stats *stats)
+{
+	uint8_t luma[CHUNK_PIXELS / 2];
+	const struct ae_stats_chunk *c;
+	const uint8_t *line;
+	uint32_t *zone_sum, *zone_count, *zone_clipped, *zone_near;
+	unsigned int i, j, q, n, z, v, clip;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->zones_x = engine->zones_x;
+	stats->zones_y = engine->zones_y;
+
+	for (i = 0; i < engine->num_pairs; i++) {
+		line = frame + engine->pairs[i].y * stride;
+		zone_sum = stats->zone_sum + engine->pairs[i].zone;
+		zone_count = stats->zone_count + engine->pairs[i].zone;
+		zone_clipped = stats->zone_clipped + engine->pairs[i].zone;
+		zone_near = stats->zone_near + engine->pairs[i].zone;
+
+		for (j = engine->pairs[i].chunk; j < engine->num_chunks;
+		     j += engine->step_x) {
+			c = &engine->chunks[j];
+			n = c->pixels / 2;
+			ipu3_unpack_preview8(line + c->offset,
+					     line + stride + c->offset, luma,
+					     c->pixels);
+			for (q = 0; q < n; q++) {
+				v = luma[q];
+				z = c->zone[q];
+				clip = v >= AE_STATS_CLIP;
+				stats->hist[v]++;
+				zone_sum[z] += clip ? 0 : v;
+				zone_count[z]++;
+				zone_clipped[z] += clip;
+				zone_near[z] += !clip && v >= AE_STATS_CLIP / 2;
+			}
+			stats->count += n;
+		}
+	}
+}
+
+double ae_stats_read_fraction(const struct ae_stats_engine *engine)
+{
+	const struct ae_stats_chunk *c;
+	size_t bytes = 0;
+	unsigned int i, j;
+
+	/* ipu3_unpack_preview8() reads whole 32-byte blocks, of 2 lines */
+	for (i = 0; i < engine->num_pairs; i++) {
+		for (j = engine->pairs[i].chunk; j < engine->num_chunks;
+		     j += engine->step_x) {
+			c = &engine->chunks[j];
+			bytes += 2 * ((c->pixels + IPU3_PACKED_BLOCK_PIXELS - 1) /
+				      IPU3_PACKED_BLOCK_PIXELS *
+				      IPU3_PACKED_BLOCK_BYTES);
+		}
+	}
+
+	return (double)bytes / engine->frame_bytes;
+}
+
+double ae_stats_zone_mean(const struct ae_stats *stats, unsigned int zone)
+{
+	uint32_t n = stats->zone_count[zone];
+	uint32_t clipped = stats->zone_clipped[zone];
+
+	if (!n)
+		return -1;
+
+	return (stats->zone_sum[zone] + 0.5 * (n - clipped) +
+		(AE_STATS_BINS - 1.0) * clipped) / n;
+}
+
+double ae_stats_mean(const struct ae_stats *stats)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (!stats->count)
+		return 0;
+
+	for (i = 0; i < AE_STATS_BINS; i++)
+		sum += (uint64_t)stats->hist[i] * i;
+
+	return (double)sum / stats->count + 0.5;
+}
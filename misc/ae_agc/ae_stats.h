@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Auto exposure statistics of IPU3 packed 10-bit frames, computed on a
+ * subsample of the frame without unpacking the rest of it.
+ *
+ * Only one 64-byte chunk (50 pixels) out of step_x is read on one pair
+ * of lines out of step_y: with the default 4 and 16, 1/32 of the frame.
+ * Each 2x2 Bayer quad of the chunks gives a luma value, the 8 most
+ * significant bits of the average of its 4 pixels, that goes to the
+ * histogram and to its zone, which counts the clipped quads apart. The
+ * chunks are unpacked with the SIMD functions of ../ipu3_unpack.
+ */
+#ifndef AE_STATS_H
+#define AE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AE_STATS_BINS		256
+#define AE_STATS_MAX_ZONES	256
+/* Quads at or over this luma are taken as clipped */
+#define AE_STATS_CLIP		252
+
+struct ae_stats_config {
+	unsigned int width;		/* even */
+	unsigned int height;
+	unsigned int zones_x;		/* zones_x * zones_y <= MAX_ZONES */
+	unsigned int zones_y;
+	unsigned int step_x;		/* in 64-byte chunks, 0 for 4 */
+	unsigned int step_y;		/* in lines, even, 0 for 16 */
+};
+
+struct ae_stats {
+	uint32_t hist[AE_STATS_BINS];	/* of the quad lumas */
+	uint32_t count;			/* number of quads */
+	uint32_t zone_sum[AE_STATS_MAX_ZONES];	/* of the unclipped quads */
+	uint32_t zone_count[AE_STATS_MAX_ZONES];	/* of all the quads */
+	uint32_t zone_clipped[AE_STATS_MAX_ZONES];
+	/* quads from CLIP / 2 to CLIP, how the zone goes on past the clip */
+	uint32_t zone_near[AE_STATS_MAX_ZONES];
+	unsigned int zones_x;
+	unsigned int zones_y;
+};
+
+struct ae_stats_engine;
+
+/* Return NULL with errno set if @cfg isn't valid or on allocation failure */
+struct ae_stats_engine *ae_stats_create(const struct ae_stats_config *cfg);
+void ae_stats_destroy(struct ae_stats_engine *engine);
+
+/* Compute @stats of a frame, its lines @stride bytes apart */
+void ae_stats_compute(struct ae_stats_engine *engine, const uint8_t *frame,
+		      size_t stride, struct ae_stats *stats);
+
+/* Part of the bytes of the frame that ae_stats_compute() reads */
+double ae_stats_read_fraction(const struct ae_stats_engine *engine);
+
+/*
+ * Mean luma of @zone, 0 to 255, or -1 if it has no samples. The clipped
+ * quads count as 255, and half a step is added back to the others as
+ * their lumas are rounded down.
+ */
+double ae_stats_zone_mean(const struct ae_stats *stats, unsigned int zone);
+
+/* Mean luma of the frame, 0 to 255, from the histogram */
+double ae_stats_mean(const struct ae_stats *stats);
+
+#endif /* AE_STATS_H */
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Grey world white balance, see awb.h.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "awb.h"
+
+/* Rounds of leaving the zones out of the average */
+#define GAMUT_ROUNDS		4
+
+struct zone_colour {
+	double r;			/* before the gains */
+	double g;
+	double b;
+	double log_r;			/* of R / G */
+	double log_b;
+	int used;
+};
+
+void awb_default_config(struct awb_config *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->tolerance = 0.02;
+	cfg->gamut = 1.5;
+	cfg->min_count = 0.25;
+	cfg->delay = 1;
+	cfg->gain_min = 1;
+	cfg->gain_max = 32767;
+}
+
+static struct awb_gains *entry(struct awb *awb, uint32_t sequence)
+{
+	return &awb->history[sequence % AWB_HISTORY];
+}
+
+void awb_init(struct awb *awb, const struct awb_config *cfg,
+	      const struct awb_gains *current)
+{
+	unsigned int i;
+
+	memset(awb, 0, sizeof(*awb));
+	awb->cfg = *cfg;
+	if (!awb->cfg.delay)
+		awb->cfg.delay = 1;
+	if (awb->cfg.delay >= AWB_HISTORY)
+		awb->cfg.delay = AWB_HISTORY - 1;
+	if (awb->cfg.gain_min < 1)
+		awb->cfg.gain_min = 1;
+	awb->red_ratio = 1;
+	awb->blue_ratio = 1;
+
+	for (i = 0; i < AWB_HISTORY; i++)
+		awb->history[i] = *current;
+}
+
+struct awb_gains awb_applied(const struct awb *awb, uint32_t sequence)
+{
+	return awb->history[(sequence - awb->cfg.delay) % AWB_HISTORY];
+}
+
+/* The colour of each zone that has enough quads, with the gains taken out */
+static unsigned int zone_colours(const struct awb *awb,
+				 const struct awb_stats *stats,
+				 const struct awb_gains *applied,
+				 struct zone_colour *zones)
+{
+	unsigned int i, n = 0, count = stats->zones_x * stats->zones_y;
+	const struct awb_zone *z;
+	uint32_t largest = 0;
+	struct zone_colour *c;
+
+	for (i = 0; i < count; i++)
+		if (stats->zones[i].count > largest)
+			largest = stats->zones[i].count;
+
+	for (i = 0; i < count; i++) {
+		z = &stats->zones[i];
+		if (!z->count || z->count < awb->cfg.min_count * largest ||
+		    !z->r || !z->g || !z->b)
+			continue;
+
+		c = &zones[n++];
+		c->r = (double)z->r * AWB_UNITY / applied->red;
+		c->g = z->g / 2.0;
+		c->b = (double)z->b * AWB_UNITY / applied->blue;
+		c->log_r = log(c->r / c->g);
+		c->log_b = log(c->b / c->g);
+	}
+
+	return n;
+}
+
+/*
+ * Average R / G and B / G of the zones in @ratio_r and @ratio_b, again
+ * without the zones too far from it until they are the same ones. Return
+ * the number of zones in the average.
+ */
+static unsigned int grey_world(const struct awb *awb, struct zone_colour *zones,
+			       unsigned int n, double *ratio_r, double *ratio_b)
+{
+	double r, g, b, limit = log(awb->cfg.gamut);
+	unsigned int i, round, used, averaged = 0, changed;
+
+	for (i = 0; i < n; i++)
+		zones[i].used = 1;
+
+	for (round = 0; round <= GAMUT_ROUNDS; round++) {
+		r = g = b = 0;
+		averaged = 0;
+		for (i = 0; i < n; i++) {
+			if (!zones[i].used)
+				continue;
+			r += zones[i].r;
+			g += zones[i].g;
+			b += zones[i].b;
+			averaged++;
+		}
+		*ratio_r = r / g;
+		*ratio_b = b / g;
+
+		changed = 0;
+		used = 0;
+		for (i = 0; i < n; i++) {
+			int in = fabs(zones[i].log_r - log(*ratio_r)) <= limit &&
+				 fabs(zones[i].log_b - log(*ratio_b)) <= limit;
+
+			changed += in != zones[i].used;
+			zones[i].used = in;
+			used += in;
+		}
+		/* keep the last average if they would all be left out */
+		if (!changed || !used)
+			break;
+	}
+
+	return averaged;
+}
+
+static int32_t to_gain(const struct awb *awb, double ratio)
+{
+	double v = round(AWB_UNITY / ratio);
+
+	return v < awb->cfg.gain_min ? awb->cfg.gain_min :
+	       v > awb->cfg.gain_max ? awb->cfg.gain_max : (int32_t)v;
+}
+
+static int close_to(int32_t a, int32_t b, double tolerance)
+{
+	return fabs((double)a / b - 1) < tolerance;
+}
+
+int awb_process(struct awb *awb, uint32_t sequence,
+		const struct awb_stats *stats, struct awb_gains *out)
+{
+	struct zone_colour zones[AWB_STATS_MAX_ZONES];
+	struct awb_gains applied, *last;
+	unsigned int n;
+	uint32_t s;
+
+	/* what was written last stays in place over dropped frames */
+	if (awb->started) {
+		last = entry(awb, awb->sequence);
+		for (s = awb->sequence + 1;
+		     s != sequence + 1 && s - awb->sequence <= AWB_HISTORY; s++)
+			*entry(awb, s) = *last;
+	}
+	awb->sequence = sequence;
+	awb->started = 1;
+	last = entry(awb, sequence);
+
+	applied = awb_applied(awb, sequence);
+	n = zone_colours(awb, stats, &applied, zones);
+	if (!n) {
+		awb->zones_used = 0;
+		return 0;
+	}
+	awb->zones_used = grey_world(awb, zones, n, &awb->red_ratio,
+				     &awb->blue_ratio);
+
+	out->red = to_gain(awb, awb->red_ratio);
+	out->blue = to_gain(awb, awb->blue_ratio);
+	if (close_to(out->red, last->red, awb->cfg.tolerance) &&
+	    close_to(out->blue, last->blue, awb->cfg.tolerance))
+		return 0;
+
+	*last = *out;
+	return 1;
+}
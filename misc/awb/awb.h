@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Grey world white balance from the statistics of awb_stats.h, for the
+ * white balance gains of the sensor: V4L2_CID_RED_BALANCE and
+ * V4L2_CID_BLUE_BALANCE of the ov8865, 1024 for a gain of 1, that its ISP
+ * applies before the frame goes out, so no pixel is touched on the CPU.
+ *
+ * The statistics are of frames the gains were already applied to. As in
+ * ae_agc, the estimator remembers what it wrote after each frame, takes
+ * the gains of a frame back out of its statistics and goes to the gains
+ * of the scene in one step.
+ *
+ * The scene is taken as grey on average, but the zones whose colour is
+ * far from that average, a wall or the sky filling a part of the frame,
+ * are left out and the average is taken again without them.
+ */
+#ifndef AWB_H
+#define AWB_H
+
+#include <stdint.h>
+#include "awb_stats.h"
+
+#define AWB_HISTORY		16
+/* The value of a gain of 1 */
+#define AWB_UNITY		1024
+
+struct awb_config {
+	/* relative change of a gain under which nothing changes */
+	double tolerance;
+	/* zones with a colour over this factor from the average are left out */
+	double gamut;
+	/* zones with fewer quads than this part of the largest are left out */
+	double min_count;
+	unsigned int delay;		/* frames before a gain takes effect */
+	int32_t gain_min;		/* range of the controls */
+	int32_t gain_max;
+};
+
+struct awb_gains {
+	int32_t red;
+	int32_t blue;
+};
+
+struct awb {
+	struct awb_config cfg;
+	/* what was requested after each frame, by sequence number */
+	struct awb_gains history[AWB_HISTORY];
+	uint32_t sequence;		/* of the last frame processed */
+	int started;
+	/* of the scene before the gains, R / G and B / G */
+	double red_ratio;
+	double blue_ratio;
+	unsigned int zones_used;	/* in the last estimate */
+};
+
+/* Defaults of awb_config, for the ov8865 controls */
+void awb_default_config(struct awb_config *cfg);
+
+/* @current is what the sensor is set to */
+void awb_init(struct awb *awb, const struct awb_config *cfg,
+	      const struct awb_gains *current);
+
+/*
+ * Process the statistics of frame @sequence. Return 1 and fill @out if
+ * the gains have to be set before the next frame, 0 if they stay, which
+ * they also do if no zone has enough quads that aren't dark or saturated.
+ */
+int awb_process(struct awb *awb, uint32_t sequence,
+		const struct awb_stats *stats, struct awb_gains *out);
+
+/* The gains frame @sequence was taken with */
+struct awb_gains awb_applied(const struct awb *awb, uint32_t sequence);
+
+#endif /* AWB_H */
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AWB statistics, see awb_stats.h. The quad range of each zone column is
+ * worked out once in awb_stats_create(), awb_stats_compute() unpacks each
+ * pair of lines and calls the kernel once per zone. The AVX2 kernel is in
+ * awb_stats_avx2.c.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "awb_stats_priv.h"
+#include "ipu3_unpack.h"
+
+struct awb_stats_engine {
+	struct awb_stats_config cfg;
+	const struct awb_stats_ops *ops;
+	unsigned int *zone_start;	/* first quad of each zone column */
+	uint16_t *lines[2];
+	uint32_t dark_sum;
+	/* where red and blue are in p[] of the kernels, green is the rest */
+	unsigned int red;
+	unsigned int blue;
+};
+
+static void scalar_sum(const uint16_t *l0, const uint16_t *l1,
+		       unsigned int start, unsigned int end, uint32_t dark_sum,
+		       uint32_t saturation, struct awb_stats_sums *s)
+{
+	uint32_t p0, p1, p2, p3, max;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		p0 = l0[2 * i];
+		p1 = l0[2 * i + 1];
+		p2 = l1[2 * i];
+		p3 = l1[2 * i + 1];
+		max = p0 > p1 ? p0 : p1;
+		max = p2 > max ? p2 : max;
+		max = p3 > max ? p3 : max;
+
+		if (max >= saturation) {
+			s->saturated++;
+		} else if (p0 + p1 + p2 + p3 < dark_sum) {
+			s->dark++;
+		} else {
+			s->p[0] += p0;
+			s->p[1] += p1;
+			s->p[2] += p2;
+			s->p[3] += p3;
+			s->count++;
+		}
+	}
+}
+
+const struct awb_stats_ops awb_stats_ops_scalar = {
+	.sum = scalar_sum,
+};
+
+const char *awb_stats_isa_name(enum awb_stats_isa isa)
+{
+	switch (isa) {
+	case AWB_STATS_SCALAR:
+		return "scalar";
+	case AWB_STATS_AVX2:
+		return "avx2";
+	default:
+		return "auto";
+	}
+}
+
+int awb_stats_isa_supported(enum awb_stats_isa isa)
+{
+	__builtin_cpu_init();
+
+	switch (isa) {
+	case AWB_STATS_SCALAR:
+		return 1;
+	case AWB_STATS_AVX2:
+		return __builtin_cpu_supports("avx2");
+	default:
+		return 0;
+	}
+}
+
+/* Red and blue in the quad for each order, as p[] of the kernels */
+static const struct {
+	unsigned int red;
+	unsigned int blue;
+} order_quad[] = {
+	[AWB_STATS_BGGR] = { 3, 0 },
+	[AWB_STATS_GBRG] = { 2, 1 },
+	[AWB_STATS_GRBG] = { 1, 2 },
+	[AWB_STATS_RGGB] = { 0, 3 },
+};
+
+struct awb_stats_engine *awb_stats_create(const struct awb_stats_config *cfg)
+{
+	unsigned int step_y = cfg->step_y ? cfg->step_y : 2;
+	unsigned int quads = cfg->width / 2;
+	enum awb_stats_isa isa = cfg->isa;
+	struct awb_stats_engine *engine;
+	unsigned int i;
+
+	if (!cfg->width || cfg->width % 2 || cfg->height < 2 ||
+	    cfg->order > AWB_STATS_RGGB || !cfg->zones_x || !cfg->zones_y ||
+	    cfg->zones_x > quads || cfg->zones_y > cfg->height / 2 ||
+	    cfg->zones_x * cfg->zones_y > AWB_STATS_MAX_ZONES ||
+	    step_y % 2 || cfg->black > 1023 || cfg->black + cfg->dark > 1023 ||
+	    cfg->saturation > 1023) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (isa == AWB_STATS_ISA_AUTO)
+		isa = awb_stats_isa_supported(AWB_STATS_AVX2) ? AWB_STATS_AVX2 :
+								AWB_STATS_SCALAR;
+	if (!awb_stats_isa_supported(isa)) {
+		errno = ENOTSUP;
+		return NULL;
+	}
+
+	engine = calloc(1, sizeof(*engine));
+	if (!engine)
+		return NULL;
+
+	engine->cfg = *cfg;
+	engine->cfg.step_y = step_y;
+	engine->cfg.isa = isa;
+	if (!engine->cfg.saturation)
+		engine->cfg.saturation = 1023;
+	engine->ops = isa == AWB_STATS_AVX2 ? &awb_stats_ops_avx2 :
+					      &awb_stats_ops_scalar;
+	engine->dark_sum = 4 * (cfg->black + cfg->dark);
+	engine->red = order_quad[cfg->order].red;
+	engine->blue = order_quad[cfg->order].blue;
+
+	engine->zone_start = calloc(cfg->zones_x + 1,
+				    sizeof(*engine->zone_start));
+	engine->lines[0] = malloc(cfg->width * sizeof(uint16_t));
+	engine->lines[1] = malloc(cfg->width * sizeof(uint16_t));
+	if (!engine->zone_start || !engine->lines[0] || !engine->lines[1]) {
+		awb_stats_destroy(engine);
+		return NULL;
+	}
+
+	for (i = 0; i <= cfg->zones_x; i++)
+		engine->zone_start[i] = (uint64_t)i * quads / cfg->zones_x;
+
+	return engine;
+}
+
+void awb_stats_destroy(struct awb_stats_engine *engine)
+{
+	if (!engine)
+		return;
+
+	free(engine->zone_start);
+	free(engine->lines[0]);
+	free(engine->lines[1]);
+	free(engine);
+}
+
+/* Pixels under the black level are noise, a sum of them can be too */
+static uint64_t less_black(uint64_t sum, unsigned int black, uint32_t count)
+{
+	uint64_t offset = (uint64_t)black * count;
+
+	return sum > offset ? sum - offset : 0;
+}
+
+void awb_stats_compute(struct awb_stats_engine *engine, const uint8_t *frame,
+		       size_t stride, struct awb_stats *stats)
+{
+	const struct awb_stats_config *cfg = &engine->cfg;
+	struct awb_stats_sums s;
+	struct awb_zone *zone;
+	unsigned int x, y, i;
+	uint64_t g;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->zones_x = cfg->zones_x;
+	stats->zones_y = cfg->zones_y;
+
+	/* start half a step in, so that the lines are centred */
+	for (y = cfg->step_y / 2 & ~1U; y + 1 < cfg->height; y += cfg->step_y) {
+		ipu3_unpack_line16(frame + y * stride, engine->lines[0],
+				   cfg->width);
+		ipu3_unpack_line16(frame + (y + 1) * stride, engine->lines[1],
+				   cfg->width);
+		zone = &stats->zones[(uint64_t)y * cfg->zones_y / cfg->height *
+				     cfg->zones_x];
+
+		for (x = 0; x < cfg->zones_x; x++, zone++) {
+			memset(&s, 0, sizeof(s));
+			engine->ops->sum(engine->lines[0], engine->lines[1],
+					 engine->zone_start[x],
+					 engine->zone_start[x + 1],
+					 engine->dark_sum, cfg->saturation, &s);
+
+			g = 0;
+			for (i = 0; i < 4; i++)
+				if (i != engine->red && i != engine->blue)
+					g += s.p[i];
+			zone->r += s.p[engine->red];
+			zone->g += g;
+			zone->b += s.p[engine->blue];
+			zone->count += s.count;
+			stats->dark += s.dark;
+			stats->saturated += s.saturated;
+		}
+	}
+
+	/* the black level, once for all */
+	for (i = 0; i < cfg->zones_x * cfg->zones_y; i++) {
+		zone = &stats->zones[i];
+		zone->r = less_black(zone->r, cfg->black, zone->count);
+		zone->g = less_black(zone->g, 2 * cfg->black, zone->count);
+		zone->b = less_black(zone->b, cfg->black, zone->count);
+	}
+}
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Auto white balance statistics of IPU3 packed 10-bit Bayer frames: the
+ * sums of the red, green and blue pixels of each zone, less the black
+ * level, over the 2x2 quads that are neither too dark nor saturated.
+ *
+ * Each pair of lines is unpacked with ../ipu3_unpack and its quads are
+ * added up by a kernel, scalar or AVX2, that gives the same results.
+ */
+#ifndef AWB_STATS_H
+#define AWB_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AWB_STATS_MAX_ZONES	256
+
+enum awb_stats_order {
+	AWB_STATS_BGGR,
+	AWB_STATS_GBRG,
+	AWB_STATS_GRBG,
+	AWB_STATS_RGGB,
+};
+
+enum awb_stats_isa {
+	AWB_STATS_ISA_AUTO = -1,
+	AWB_STATS_SCALAR,
+	AWB_STATS_AVX2,
+};
+
+struct awb_stats_config {
+	unsigned int width;		/* even */
+	unsigned int height;
+	enum awb_stats_order order;
+	unsigned int zones_x;		/* zones_x * zones_y <= MAX_ZONES */
+	unsigned int zones_y;
+	unsigned int step_y;		/* in lines, even, 0 for 2: all */
+	unsigned int black;		/* black level, 0 to 1023 */
+	/* quads with a mean under black + dark are left out */
+	unsigned int dark;
+	/* quads with a pixel at or over it are left out, 0 for 1023 */
+	unsigned int saturation;
+	enum awb_stats_isa isa;
+};
+
+struct awb_zone {
+	uint64_t r;
+	uint64_t g;			/* of both green pixels */
+	uint64_t b;
+	uint32_t count;			/* quads added up */
+};
+
+struct awb_stats {
+	struct awb_zone zones[AWB_STATS_MAX_ZONES];
+	unsigned int zones_x;
+	unsigned int zones_y;
+	uint32_t dark;			/* quads left out */
+	uint32_t saturated;
+};
+
+struct awb_stats_engine;
+
+/* Return NULL with errno set if @cfg isn't valid or on allocation failure */
+struct awb_stats_engine *awb_stats_create(const struct awb_stats_config *cfg);
+void awb_stats_destroy(struct awb_stats_engine *engine);
+
+/* Compute @stats of a frame, its lines @stride bytes apart. Not reentrant. */
+void awb_stats_compute(struct awb_stats_engine *engine, const uint8_t *frame,
+		       size_t stride, struct awb_stats *stats);
+
+const char *awb_stats_isa_name(enum awb_stats_isa isa);
+int awb_stats_isa_supported(enum awb_stats_isa isa);
+
+#endif /* AWB_STATS_H */
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AVX2 kernel of the AWB statistics, 16 quads at a time in 16-bit lanes:
+ * the 4 pixels of a quad add up to 4092 at most. The sums go to 32-bit
+ * lanes with _mm256_madd_epi16(), the counts stay in 16-bit lanes as a
+ * call doesn't go over a line. Built with -mavx2.
+ */
+
+#include <immintrin.h>
+#include "awb_stats_priv.h"
+
+#define LOAD(p)		_mm256_loadu_si256((const __m256i *)(p))
+
+/* Pixels 2i and 2i + 1 of 16 quads, in the same lane order for all lines */
+static inline void split(const uint16_t *line, __m256i *even, __m256i *odd)
+{
+	const __m256i low = _mm256_set1_epi32(0xffff);
+	__m256i v0 = LOAD(line), v1 = LOAD(line + 16);
+
+	*even = _mm256_packus_epi32(_mm256_and_si256(v0, low),
+				    _mm256_and_si256(v1, low));
+	*odd = _mm256_packus_epi32(_mm256_srli_epi32(v0, 16),
+				   _mm256_srli_epi32(v1, 16));
+}
+
+static inline uint32_t sum32(__m256i v)
+{
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),
+				  _mm256_extracti128_si256(v, 1));
+
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	return _mm_cvtsi128_si32(s);
+}
+
+static inline uint32_t sum16(__m256i v)
+{
+	return sum32(_mm256_madd_epi16(v, _mm256_set1_epi16(1)));
+}
+
+static void avx2_sum(const uint16_t *l0, const uint16_t *l1,
+		     unsigned int start, unsigned int end, uint32_t dark_sum,
+		     uint32_t saturation, struct awb_stats_sums *s)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i sat_min = _mm256_set1_epi16(saturation - 1);
+	const __m256i dark_min = _mm256_set1_epi16(dark_sum);
+	__m256i acc[4], count, dark, saturated;
+	__m256i p[4], max, sum, is_sat, is_dark, keep;
+	unsigned int i, k;
+
+	for (k = 0; k < 4; k++)
+		acc[k] = _mm256_setzero_si256();
+	count = dark = saturated = _mm256_setzero_si256();
+
+	for (i = start; i + 16 <= end; i += 16) {
+		split(l0 + 2 * i, &p[0], &p[1]);
+		split(l1 + 2 * i, &p[2], &p[3]);
+
+		max = _mm256_max_epu16(_mm256_max_epu16(p[0], p[1]),
+				       _mm256_max_epu16(p[2], p[3]));
+		sum = _mm256_add_epi16(_mm256_add_epi16(p[0], p[1]),
+				       _mm256_add_epi16(p[2], p[3]));
+		/* all under 4096, the signed compares work */
+		is_sat = _mm256_cmpgt_epi16(max, sat_min);
+		is_dark = _mm256_andnot_si256(is_sat,
+					      _mm256_cmpgt_epi16(dark_min, sum));
+		keep = _mm256_cmpeq_epi16(_mm256_or_si256(is_sat, is_dark),
+					  _mm256_setzero_si256());
+
+		for (k = 0; k < 4; k++)
+			acc[k] = _mm256_add_epi32(acc[k],
+						  _mm256_madd_epi16(_mm256_and_si256(keep, p[k]),
+								    one));
+		count = _mm256_sub_epi16(count, keep);
+		dark = _mm256_sub_epi16(dark, is_dark);
+		saturated = _mm256_sub_epi16(saturated, is_sat);
+	}
+
+	for (k = 0; k < 4; k++)
+		s->p[k] += sum32(acc[k]);
+	s->count += sum16(count);
+	s->dark += sum16(dark);
+	s->saturated += sum16(saturated);
+
+	if (i < end)
+		awb_stats_ops_scalar.sum(l0, l1, i, end, dark_sum, saturation, s);
+}
+
+const struct awb_stats_ops awb_stats_ops_avx2 = {
+	.sum = avx2_sum,
+};
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The kernels of awb_stats.c. They work on a pair of unpacked lines, quad
+ * i being pixels 2i and 2i + 1 of both, and don't know the Bayer order:
+ * p[0] and p[1] are the sums of the even and odd pixels of the first
+ * line, p[2] and p[3] those of the second one.
+ */
+#ifndef AWB_STATS_PRIV_H
+#define AWB_STATS_PRIV_H
+
+#include "awb_stats.h"
+
+struct awb_stats_sums {
+	uint32_t p[4];
+	uint32_t count;
+	uint32_t dark;
+	uint32_t saturated;
+};
+
+struct awb_stats_ops {
+	/*
+	 * Add quads @start <= i < @end to @s: a quad is saturated if one of
+	 * its pixels is @saturation or more, else dark if its 4 pixels add
+	 * up to less than @dark_sum, else its pixels are added up
+	 */
+	void (*sum)(const uint16_t *l0, const uint16_t *l1, unsigned int start,
+		    unsigned int end, uint32_t dark_sum, uint32_t saturation,
+		    struct awb_stats_sums *s);
+};
+
+extern const struct awb_stats_ops awb_stats_ops_scalar;
+extern const struct awb_stats_ops awb_stats_ops_avx2;
+
+#endif /* AWB_STATS_PRIV_H */
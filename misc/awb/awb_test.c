@@ -0,0 +1,653 @@
+/**
+ * This tool checks the AWB statistics of awb_stats.c and the estimator of
+ * awb.c, and measures how long the statistics of a frame take.
+ *
+ * -T checks the AVX2 kernel against the scalar one on random frames, for
+ * all the Bayer orders, the widths up to 100 pixels and a few real ones,
+ * and that each order gives the colours at the right places. It then runs
+ * the estimator in a loop with the ov8865 of ../sensor_sim at 1632x1224,
+ * which applies the gains it is given as V4L2_CID_RED_BALANCE and
+ * V4L2_CID_BLUE_BALANCE one frame later, under a few illuminants, on a
+ * scene with a large green wall and a few highlights, and checks that the
+ * gains come within a few percent of those of the illuminant in a couple
+ * of frames.
+ *
+ * -B measures the statistics of a 1632x1224 frame with each kernel the
+ * CPU can run, on one core.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "awb.h"
+#include "awb_stats.h"
+#include "ipu3_unpack.h"
+#include "sensor_sim.h"
+
+#define SIM_WIDTH		1632
+#define SIM_HEIGHT		1224
+#define SIM_BLACK		64
+#define SIM_FRAMES		6
+/* frames after a change of illuminant to be within SIM_ACCURACY */
+#define SIM_MAX_FRAMES		2
+#define SIM_ACCURACY		0.05
+#define PATCH			16
+#define DEFAULT_RUNS		200
+
+struct options {
+	struct awb_stats_config stats;
+	struct awb_config awb;
+	unsigned int runs;
+	int verbose;
+};
+
+/* R / G and B / G of a white surface, as seen by the sensor */
+struct illuminant {
+	const char *name;
+	double red;
+	double blue;
+};
+
+static const struct illuminant illuminants[] = {
+	{ "daylight", 0.52, 0.62 },
+	{ "incandescent", 0.95, 0.30 },
+	{ "fluorescent", 0.70, 0.45 },
+	{ "shade", 0.44, 0.78 },
+	{ "led", 0.62, 0.50 },
+};
+
+/* Reflectance of each quad of the scene, R, G and B */
+struct scene {
+	unsigned int width;
+	unsigned int height;
+	float *refl[3];
+};
+
+/* xorshift32, the frames are the same from one run to the other */
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rnd(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static double rnd_unit(void)
+{
+	return (rnd() >> 8) / 16777216.0;
+}
+
+/* Roughly normal */
+static double rnd_normal(void)
+{
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		sum += rnd_unit();
+
+	return (sum - 2) * 1.7320508;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Colour of pixel @x, @y of the order: 0 red, 1 green, 2 blue */
+static unsigned int site_colour(enum awb_stats_order order, unsigned int x,
+				unsigned int y)
+{
+	static const unsigned int sites[][4] = {
+		[AWB_STATS_BGGR] = { 2, 1, 1, 0 },
+		[AWB_STATS_GBRG] = { 1, 2, 0, 1 },
+		[AWB_STATS_GRBG] = { 1, 0, 2, 1 },
+		[AWB_STATS_RGGB] = { 0, 1, 1, 2 },
+	};
+
+	return sites[order][(y & 1) * 2 + (x & 1)];
+}
+
+static void pack_frame(const uint16_t *pixels, uint8_t *frame,
+		       unsigned int width, unsigned int height)
+{
+	unsigned int y;
+
+	for (y = 0; y < height; y++)
+		ipu3_pack_line16(pixels + y * width,
+				 frame + y * ipu3_packed_bpl(width), width);
+}
+
+/*
+ * Kernels
+ */
+static int check_kernels_size(unsigned int width, unsigned int height,
+			      unsigned int zones_x, unsigned int zones_y)
+{
+	struct awb_stats_config cfg = {
+		.width = width,
+		.height = height,
+		.zones_x = zones_x,
+		.zones_y = zones_y,
+		.black = SIM_BLACK,
+		.dark = 16,
+		.saturation = 1000,
+	};
+	struct awb_stats_engine *scalar = NULL, *avx2 = NULL;
+	static struct awb_stats a, b;
+	size_t pixels = (size_t)width * height;
+	uint16_t *values;
+	uint8_t *frame;
+	unsigned int order;
+	int ret = 0;
+	size_t i;
+
+	values = malloc(pixels * sizeof(*values));
+	frame = malloc(ipu3_packed_bpl(width) * height);
+	if (!values || !frame) {
+		ret = -1;
+		goto out;
+	}
+
+	/* with plenty of saturated and dark pixels */
+	for (i = 0; i < pixels; i++) {
+		uint32_t r = rnd();
+
+		values[i] = r % 8 == 0 ? 1023 : r % 8 == 1 ? r % 80 :
+			    (r >> 3) % 1024;
+	}
+	pack_frame(values, frame, width, height);
+
+	for (order = AWB_STATS_BGGR; order <= AWB_STATS_RGGB; order++) {
+		cfg.order = order;
+		cfg.isa = AWB_STATS_SCALAR;
+		scalar = awb_stats_create(&cfg);
+		cfg.isa = AWB_STATS_AVX2;
+		avx2 = awb_stats_create(&cfg);
+		if (!scalar || !avx2) {
+			perror("awb_stats_create");
+			ret = -1;
+			goto out;
+		}
+
+		awb_stats_compute(scalar, frame, ipu3_packed_bpl(width), &a);
+		awb_stats_compute(avx2, frame, ipu3_packed_bpl(width), &b);
+		if (memcmp(&a, &b, sizeof(a))) {
+			fprintf(stderr, "avx2 %ux%u order %u: wrong\n", width,
+				height, order);
+			ret = 1;
+		}
+
+		awb_stats_destroy(scalar);
+		awb_stats_destroy(avx2);
+		scalar = avx2 = NULL;
+	}
+
+out:
+	awb_stats_destroy(scalar);
+	awb_stats_destroy(avx2);
+	free(values);
+	free(frame);
+	return ret;
+}
+
+/* A frame of R 300, G 500, B 700 gives that back in all the orders */
+static int check_order(void)
+{
+	static const uint16_t colour[3] = { 300, 500, 700 };
+	struct awb_stats_config cfg = {
+		.width = 100,
+		.height = 8,
+		.zones_x = 2,
+		.zones_y = 2,
+	};
+	struct awb_stats_engine *engine;
+	static struct awb_stats s;
+	uint16_t values[100 * 8];
+	uint8_t frame[128 * 8];
+	const struct awb_zone *z;
+	unsigned int order, x, y;
+	int ret = 0;
+
+	for (order = AWB_STATS_BGGR; order <= AWB_STATS_RGGB; order++) {
+		for (y = 0; y < cfg.height; y++)
+			for (x = 0; x < cfg.width; x++)
+				values[y * cfg.width + x] =
+					colour[site_colour(order, x, y)];
+		pack_frame(values, frame, cfg.width, cfg.height);
+
+		cfg.order = order;
+		engine = awb_stats_create(&cfg);
+		if (!engine) {
+			perror("awb_stats_create");
+			return -1;
+		}
+		awb_stats_compute(engine, frame, ipu3_packed_bpl(cfg.width), &s);
+		awb_stats_destroy(engine);
+
+		z = &s.zones[3];
+		if (!z->count || z->r != 300ULL * z->count ||
+		    z->g != 1000ULL * z->count || z->b != 700ULL * z->count) {
+			fprintf(stderr, "order %u: wrong colours\n", order);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+static int check_kernels(void)
+{
+	static const unsigned int sizes[][2] = {
+		{ 640, 480 }, { 1296, 972 }, { 1632, 1224 }, { 3264, 2448 },
+	};
+	unsigned int width, i;
+	int ret, failed = 0;
+
+	if (!awb_stats_isa_supported(AWB_STATS_AVX2)) {
+		printf("avx2 not supported, only the scalar kernel is checked\n");
+		return check_order();
+	}
+
+	for (width = 2; width <= 100; width += 2) {
+		ret = check_kernels_size(width, 8, width / 2 < 16 ? width / 2 :
+					 16, 2);
+		if (ret < 0)
+			return -1;
+		failed |= ret;
+	}
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		ret = check_kernels_size(sizes[i][0], sizes[i][1], 16, 12);
+		if (ret < 0)
+			return -1;
+		failed |= ret;
+	}
+
+	ret = check_order();
+	if (ret < 0)
+		return -1;
+	failed |= ret;
+
+	printf("kernels: %s\n", failed ? "wrong" : "ok");
+	return failed;
+}
+
+/*
+ * Simulation
+ */
+
+/*
+ * Patches of random grey levels and colours, grey on average, a green
+ * wall on the left quarter and a few white highlights that clip
+ */
+static int scene_create(struct scene *s, unsigned int width,
+			unsigned int height)
+{
+	unsigned int qw = width / 2, qh = height / 2, x, y, c, px = PATCH / 2;
+	unsigned int bx = (qw + px - 1) / px, by = (qh + px - 1) / px;
+	double grey, sum[3] = { 0 };
+	float *patch;
+
+	s->width = width;
+	s->height = height;
+	patch = malloc(bx * by * 3 * sizeof(*patch));
+	for (c = 0; c < 3; c++)
+		s->refl[c] = malloc(qw * qh * sizeof(float));
+	if (!patch || !s->refl[0] || !s->refl[1] || !s->refl[2]) {
+		free(patch);
+		return -1;
+	}
+
+	for (x = 0; x < bx * by; x++) {
+		grey = 0.04 * pow(15, rnd_unit());
+		if (rnd() % 50 == 0)
+			grey = 3;
+		for (c = 0; c < 3; c++) {
+			patch[x * 3 + c] = grey * exp(0.35 * rnd_normal());
+			sum[c] += patch[x * 3 + c];
+		}
+	}
+	/* exactly grey on average */
+	for (x = 0; x < bx * by; x++)
+		for (c = 0; c < 3; c++)
+			patch[x * 3 + c] *= sum[1] / sum[c];
+
+	for (y = 0; y < qh; y++) {
+		for (x = 0; x < qw; x++) {
+			for (c = 0; c < 3; c++) {
+				static const float wall[3] = { 0.06, 0.3, 0.05 };
+
+				s->refl[c][y * qw + x] = x < qw / 4 ? wall[c] :
+					patch[(y / px * bx + x / px) * 3 + c];
+			}
+		}
+	}
+
+	free(patch);
+	return 0;
+}
+
+static void scene_free(struct scene *s)
+{
+	unsigned int c;
+
+	for (c = 0; c < 3; c++)
+		free(s->refl[c]);
+}
+
+/* The ov8865 in its 1632x1224 mode, taking the scene at its default setting */
+static struct sensor_sim *sim_open(void)
+{
+	const struct sensor_sim_config cfg = {
+		.sensor = "ov8865",
+		.width = SIM_WIDTH,
+		.height = SIM_HEIGHT,
+		.vblank = -1,
+	};
+	struct sensor_sim *sensor;
+
+	sensor = sensor_sim_create(&cfg);
+	if (!sensor)
+		perror("sensor_sim_create");
+	return sensor;
+}
+
+/* The white balance gains, applied by the sensor from the next frame */
+static void sim_write(struct sensor_sim *sensor, uint32_t sequence,
+		      const struct awb_gains *gains)
+{
+	sensor_sim_s_ctrl(sensor, sequence, SENSOR_SIM_RED, gains->red *
+			  sensor_sim_ctrl(sensor, SENSOR_SIM_RED)->def /
+			  AWB_UNITY);
+	sensor_sim_s_ctrl(sensor, sequence, SENSOR_SIM_BLUE, gains->blue *
+			  sensor_sim_ctrl(sensor, SENSOR_SIM_BLUE)->def /
+			  AWB_UNITY);
+}
+
+/*
+ * Frame @sequence of @scene under @illum, taken by the sensor with the
+ * white balance gains it has then, before it clips, and its noise
+ */
+static int sim_frame(struct sensor_sim *sensor, uint32_t sequence,
+		     const struct scene *scene, const struct illuminant *illum,
+		     float *light, uint8_t *frame)
+{
+	const struct sensor_sim_ctrl *exposure, *gain;
+	double colour[3] = { illum->red, 1, illum->blue };
+	unsigned int x, y, c, qw = scene->width / 2;
+	double scale;
+
+	/* 700 for a reflectance of 1 at the default setting */
+	exposure = sensor_sim_ctrl(sensor, SENSOR_SIM_EXPOSURE);
+	gain = sensor_sim_ctrl(sensor, SENSOR_SIM_GAIN);
+	scale = 700.0 * gain->min / ((double)exposure->def * gain->def);
+
+	for (y = 0; y < scene->height; y++) {
+		for (x = 0; x < scene->width; x++) {
+			c = site_colour(AWB_STATS_BGGR, x, y);
+			light[y * scene->width + x] = scale * colour[c] *
+				scene->refl[c][y / 2 * qw + x / 2];
+		}
+	}
+
+	return sensor_sim_expose(sensor, sequence, light, scene->width,
+				 scene->height, SIM_BLACK, frame,
+				 ipu3_packed_bpl(scene->width));
+}
+
+static double gain_error(int32_t gain, double ratio)
+{
+	return gain * ratio / AWB_UNITY - 1;
+}
+
+static int check_sim(const struct options *opt)
+{
+	struct awb_stats_config cfg = opt->stats;
+	struct awb_gains gains = { AWB_UNITY, AWB_UNITY }, out;
+	struct awb_stats_engine *engine;
+	const struct illuminant *illum;
+	static struct awb_stats stats;
+	struct sensor_sim *sensor = NULL;
+	struct scene scene = { 0 };
+	float *light = NULL;
+	uint8_t *frame = NULL;
+	unsigned int i, n, seq = 0, settled, failed = 0;
+	double err_r, err_b, t0, stats_us = 0;
+	struct awb awb;
+
+	cfg.width = SIM_WIDTH;
+	cfg.height = SIM_HEIGHT;
+	cfg.order = AWB_STATS_BGGR;
+	engine = awb_stats_create(&cfg);
+	if (!engine) {
+		perror("awb_stats_create");
+		return -1;
+	}
+
+	sensor = sim_open();
+	light = malloc(SIM_WIDTH * SIM_HEIGHT * sizeof(*light));
+	frame = malloc(ipu3_packed_bpl(SIM_WIDTH) * SIM_HEIGHT);
+	if (!sensor || !light || !frame ||
+	    scene_create(&scene, SIM_WIDTH, SIM_HEIGHT)) {
+		failed = -1;
+		goto out;
+	}
+
+	awb_init(&awb, &opt->awb, &gains);
+
+	for (i = 0; i < sizeof(illuminants) / sizeof(illuminants[0]); i++) {
+		illum = &illuminants[i];
+		settled = SIM_FRAMES;
+
+		for (n = 0; n < SIM_FRAMES; n++, seq++) {
+			if (sim_frame(sensor, seq, &scene, illum, light,
+				      frame)) {
+				perror("sensor_sim_expose");
+				failed = -1;
+				goto out;
+			}
+
+			t0 = now_us();
+			awb_stats_compute(engine, frame,
+					  ipu3_packed_bpl(SIM_WIDTH), &stats);
+			stats_us += now_us() - t0;
+
+			if (awb_process(&awb, seq, &stats, &out))
+				sim_write(sensor, seq, &out);
+			gains = awb_applied(&awb, seq);
+
+			err_r = gain_error(gains.red, illum->red);
+			err_b = gain_error(gains.blue, illum->blue);
+			if (fabs(err_r) > SIM_ACCURACY ||
+			    fabs(err_b) > SIM_ACCURACY)
+				settled = SIM_FRAMES;
+			else if (settled == SIM_FRAMES)
+				settled = n;
+
+			if (opt->verbose)
+				printf("frame %3u: red %5d blue %5d, %u zones, %u dark %u saturated\n",
+				       seq, gains.red, gains.blue,
+				       awb.zones_used, stats.dark,
+				       stats.saturated);
+		}
+
+		if (settled > SIM_MAX_FRAMES)
+			failed = 1;
+		printf("%-12s red %5d (%+5.1f%%) blue %5d (%+5.1f%%), ",
+		       illum->name, gains.red, 100 * err_r, gains.blue,
+		       100 * err_b);
+		if (settled == SIM_FRAMES)
+			printf("not converged\n");
+		else
+			printf("converged in %u frames%s\n", settled,
+			       settled > SIM_MAX_FRAMES ? ", too slow" : "");
+	}
+
+	printf("statistics in %.1f us per frame (%s)\n", stats_us / seq,
+	       awb_stats_isa_name(awb_stats_isa_supported(AWB_STATS_AVX2) &&
+				  cfg.isa != AWB_STATS_SCALAR ?
+				  AWB_STATS_AVX2 : AWB_STATS_SCALAR));
+
+out:
+	scene_free(&scene);
+	free(light);
+	free(frame);
+	if (sensor)
+		sensor_sim_destroy(sensor);
+	awb_stats_destroy(engine);
+	return failed;
+}
+
+/*
+ * Benchmark
+ */
+static int bench(const struct options *opt)
+{
+	struct awb_stats_config cfg = opt->stats;
+	struct awb_stats_engine *engine;
+	static struct awb_stats stats;
+	struct sensor_sim *sensor;
+	struct scene scene = { 0 };
+	float *light;
+	uint8_t *frame;
+	unsigned int i, isa;
+	int ret = -1;
+	double t0;
+
+	cfg.width = SIM_WIDTH;
+	cfg.height = SIM_HEIGHT;
+	sensor = sim_open();
+	light = malloc(SIM_WIDTH * SIM_HEIGHT * sizeof(*light));
+	frame = malloc(ipu3_packed_bpl(SIM_WIDTH) * SIM_HEIGHT);
+	if (!sensor || !light || !frame ||
+	    scene_create(&scene, SIM_WIDTH, SIM_HEIGHT) ||
+	    sim_frame(sensor, 0, &scene, &illuminants[0], light, frame))
+		goto out;
+
+	for (isa = AWB_STATS_SCALAR; isa <= AWB_STATS_AVX2; isa++) {
+		if (!awb_stats_isa_supported(isa))
+			continue;
+		if (opt->stats.isa != AWB_STATS_ISA_AUTO &&
+		    opt->stats.isa != (enum awb_stats_isa)isa)
+			continue;
+
+		cfg.isa = isa;
+		engine = awb_stats_create(&cfg);
+		if (!engine) {
+			perror("awb_stats_create");
+			goto out;
+		}
+
+		/* once to warm up the caches */
+		awb_stats_compute(engine, frame, ipu3_packed_bpl(SIM_WIDTH),
+				  &stats);
+		t0 = now_us();
+		for (i = 0; i < opt->runs; i++)
+			awb_stats_compute(engine, frame,
+					  ipu3_packed_bpl(SIM_WIDTH), &stats);
+		printf("%-6s %dx%d, every %u lines: %7.1f us per frame\n",
+		       awb_stats_isa_name(isa), SIM_WIDTH, SIM_HEIGHT,
+		       cfg.step_y ? cfg.step_y : 2,
+		       (now_us() - t0) / opt->runs);
+		awb_stats_destroy(engine);
+	}
+	ret = 0;
+
+out:
+	scene_free(&scene);
+	free(light);
+	free(frame);
+	if (sensor)
+		sensor_sim_destroy(sensor);
+	return ret;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -T|-B [-z <zones WxH>] [-y <step y>] [-g <gamut>]\n"
+		"          [-i scalar|avx2] [-n <runs>] [-v]\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct options opt = {
+		.stats = {
+			.zones_x = 16,
+			.zones_y = 12,
+			.black = SIM_BLACK,
+			.dark = 16,
+			.saturation = 1000,
+			.isa = AWB_STATS_ISA_AUTO,
+		},
+		.runs = DEFAULT_RUNS,
+	};
+	int test = 0, benchmark = 0, c, ret;
+
+	awb_default_config(&opt.awb);
+
+	while ((c = getopt(argc, argv, "TBz:y:g:i:n:v")) != -1) {
+		switch (c) {
+		case 'T':
+			test = 1;
+			break;
+		case 'B':
+			benchmark = 1;
+			break;
+		case 'z':
+			if (sscanf(optarg, "%ux%u", &opt.stats.zones_x,
+				   &opt.stats.zones_y) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'y':
+			opt.stats.step_y = strtoul(optarg, NULL, 0);
+			break;
+		case 'g':
+			opt.awb.gamut = strtod(optarg, NULL);
+			break;
+		case 'i':
+			if (!strcmp(optarg, "scalar")) {
+				opt.stats.isa = AWB_STATS_SCALAR;
+			} else if (!strcmp(optarg, "avx2")) {
+				opt.stats.isa = AWB_STATS_AVX2;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'n':
+			opt.runs = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			opt.verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (test == benchmark || !opt.runs || opt.awb.gamut <= 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (benchmark)
+		return bench(&opt) ? 1 : 0;
+
+	ret = check_kernels();
+	if (ret >= 0)
+		ret |= check_sim(&opt);
+
+	return ret ? 1 : 0;
+}
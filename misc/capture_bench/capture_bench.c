@@ -0,0 +1,853 @@
+/**
+ * This tool measures the capture path of a V4L2 video node: sustained
+ * frame rate, frame interval jitter, dropped frames, the time taken by
+ * VIDIOC_STREAMON/STREAMOFF (where the sensor drivers' s_stream runs),
+ * the latency from stream on to the first frame, and the CPU time spent
+ * per frame.
+ *
+ * Buffers are either MMAP buffers of the driver or DMABUF buffers
+ * allocated from a dma-buf heap. The frame sizes of the sensor subdev (or
+ * of the video node) can be swept, as well as the buffer counts and the
+ * memory types, one run per combination.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/dma-heap.h>
+#include <linux/v4l2-subdev.h>
+#include <linux/videodev2.h>
+
+#define DEFAULT_HEAP		"/dev/dma_heap/system"
+#define DEFAULT_FRAMES		120
+#define DEFAULT_TIMEOUT_MS	2000
+#define MAX_BUFFERS		32
+#define MAX_SIZES		64
+#define MAX_LIST		8
+
+enum output_format {
+	OUTPUT_TEXT,
+	OUTPUT_CSV,
+};
+
+struct size {
+	uint32_t width;
+	uint32_t height;
+};
+
+struct buffer {
+	void *map[VIDEO_MAX_PLANES];
+	size_t map_len[VIDEO_MAX_PLANES];
+	int dmabuf[VIDEO_MAX_PLANES];
+};
+
+struct run_config {
+	struct size size;		/* 0x0 keeps the current one */
+	enum v4l2_memory memory;
+	unsigned int buffers;
+};
+
+struct run_result {
+	struct v4l2_format fmt;
+	unsigned int buffers;		/* as granted by REQBUFS */
+	unsigned int frames;
+	unsigned int dropped;		/* sequence gaps */
+	unsigned int errors;		/* V4L2_BUF_FLAG_ERROR */
+	double streamon_ms;
+	double first_frame_ms;
+	double streamoff_ms;
+	double fps;
+	double interval_ms;
+	double jitter_ms;		/* standard deviation of the intervals */
+	double max_dev_ms;
+	double cpu_us;			/* user + system per frame */
+};
+
+struct bench {
+	int fd;
+	int subdev_fd;
+	unsigned int pad;
+	uint32_t type;
+	int mplane;
+	uint32_t fourcc;
+	unsigned int frames;
+	int timeout_ms;
+	const char *heap;
+	int heap_fd;
+};
+
+static enum output_format format;
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double cpu_us(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+	       ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static const char *memory_name(enum v4l2_memory memory)
+{
+	return memory == V4L2_MEMORY_DMABUF ? "dmabuf" : "mmap";
+}
+
+static void fourcc_str(uint32_t fourcc, char *str)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		str[i] = (fourcc >> (8 * i)) & 0x7f;
+	str[4] = '\0';
+}
+
+/*
+ * Formats
+ */
+static uint32_t fmt_width(const struct bench *b, const struct v4l2_format *f)
+{
+	return b->mplane ? f->fmt.pix_mp.width : f->fmt.pix.width;
+}
+
+static uint32_t fmt_height(const struct bench *b, const struct v4l2_format *f)
+{
+	return b->mplane ? f->fmt.pix_mp.height : f->fmt.pix.height;
+}
+
+static uint32_t fmt_fourcc(const struct bench *b, const struct v4l2_format *f)
+{
+	return b->mplane ? f->fmt.pix_mp.pixelformat : f->fmt.pix.pixelformat;
+}
+
+static unsigned int fmt_planes(const struct bench *b,
+			       const struct v4l2_format *f)
+{
+	return b->mplane ? f->fmt.pix_mp.num_planes : 1;
+}
+
+static uint32_t fmt_plane_size(const struct bench *b,
+			       const struct v4l2_format *f, unsigned int p)
+{
+	return b->mplane ? f->fmt.pix_mp.plane_fmt[p].sizeimage :
+			   f->fmt.pix.sizeimage;
+}
+
+/* Set the size on the sensor subdev first, then on the video node */
+static int set_format(struct bench *b, const struct size *size,
+		      struct v4l2_format *fmt)
+{
+	struct v4l2_subdev_format sfmt = { 0 };
+
+	memset(fmt, 0, sizeof(*fmt));
+	fmt->type = b->type;
+	if (xioctl(b->fd, VIDIOC_G_FMT, fmt)) {
+		perror("VIDIOC_G_FMT");
+		return -1;
+	}
+
+	if (!size->width && !b->fourcc)
+		return 0;
+
+	if (size->width && b->subdev_fd >= 0) {
+		sfmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		sfmt.pad = b->pad;
+		if (xioctl(b->subdev_fd, VIDIOC_SUBDEV_G_FMT, &sfmt)) {
+			perror("VIDIOC_SUBDEV_G_FMT");
+			return -1;
+		}
+		sfmt.format.width = size->width;
+		sfmt.format.height = size->height;
+		if (xioctl(b->subdev_fd, VIDIOC_SUBDEV_S_FMT, &sfmt)) {
+			perror("VIDIOC_SUBDEV_S_FMT");
+			return -1;
+		}
+	}
+
+	if (b->mplane) {
+		if (size->width) {
+			fmt->fmt.pix_mp.width = size->width;
+			fmt->fmt.pix_mp.height = size->height;
+		}
+		if (b->fourcc)
+			fmt->fmt.pix_mp.pixelformat = b->fourcc;
+	} else {
+		if (size->width) {
+			fmt->fmt.pix.width = size->width;
+			fmt->fmt.pix.height = size->height;
+		}
+		if (b->fourcc)
+			fmt->fmt.pix.pixelformat = b->fourcc;
+		fmt->fmt.pix.bytesperline = 0;
+		fmt->fmt.pix.sizeimage = 0;
+	}
+
+	if (xioctl(b->fd, VIDIOC_S_FMT, fmt)) {
+		perror("VIDIOC_S_FMT");
+		return -1;
+	}
+
+	if (size->width && (fmt_width(b, fmt) != size->width ||
+			    fmt_height(b, fmt) != size->height))
+		fprintf(stderr, "%ux%u adjusted to %ux%u by the driver\n",
+			size->width, size->height, fmt_width(b, fmt),
+			fmt_height(b, fmt));
+
+	return 0;
+}
+
+/*
+ * The sizes to sweep: the discrete sizes of the subdev pad for the
+ * current media bus code, else those of the video node for the pixel
+ * format. Stepwise ranges give their minimum and maximum.
+ */
+static int enum_sizes(struct bench *b, struct size *sizes)
+{
+	struct v4l2_subdev_frame_size_enum fse;
+	struct v4l2_subdev_format sfmt = { 0 };
+	struct v4l2_frmsizeenum fsz;
+	struct v4l2_format fmt = { 0 };
+	int n = 0, i;
+
+	if (b->subdev_fd >= 0) {
+		sfmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		sfmt.pad = b->pad;
+		if (xioctl(b->subdev_fd, VIDIOC_SUBDEV_G_FMT, &sfmt)) {
+			perror("VIDIOC_SUBDEV_G_FMT");
+			return -1;
+		}
+
+		for (i = 0; n < MAX_SIZES; i++) {
+			memset(&fse, 0, sizeof(fse));
+			fse.index = i;
+			fse.pad = b->pad;
+			fse.code = sfmt.format.code;
+			fse.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+			if (xioctl(b->subdev_fd, VIDIOC_SUBDEV_ENUM_FRAME_SIZE,
+				   &fse))
+				break;
+			sizes[n++] = (struct size){ fse.max_width,
+						    fse.max_height };
+			if ((fse.min_width != fse.max_width ||
+			     fse.min_height != fse.max_height) &&
+			    n < MAX_SIZES)
+				sizes[n++] = (struct size){ fse.min_width,
+							    fse.min_height };
+		}
+		return n;
+	}
+
+	fmt.type = b->type;
+	if (xioctl(b->fd, VIDIOC_G_FMT, &fmt)) {
+		perror("VIDIOC_G_FMT");
+		return -1;
+	}
+
+	for (i = 0; n < MAX_SIZES; i++) {
+		memset(&fsz, 0, sizeof(fsz));
+		fsz.index = i;
+		fsz.pixel_format = b->fourcc ? b->fourcc : fmt_fourcc(b, &fmt);
+		if (xioctl(b->fd, VIDIOC_ENUM_FRAMESIZES, &fsz))
+			break;
+		if (fsz.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+			sizes[n++] = (struct size){ fsz.discrete.width,
+						    fsz.discrete.height };
+			continue;
+		}
+		/* a range is a single entry, try both of its ends */
+		sizes[n++] = (struct size){ fsz.stepwise.min_width,
+					    fsz.stepwise.min_height };
+		if (n < MAX_SIZES)
+			sizes[n++] = (struct size){ fsz.stepwise.max_width,
+						    fsz.stepwise.max_height };
+		break;
+	}
+
+	return n;
+}
+
+/*
+ * Buffers
+ */
+static void free_buffers(struct bench *b, struct buffer *bufs,
+			 unsigned int count, enum v4l2_memory memory)
+{
+	struct v4l2_requestbuffers req = { 0 };
+	unsigned int i, p;
+
+	for (i = 0; i < count; i++) {
+		for (p = 0; p < VIDEO_MAX_PLANES; p++) {
+			if (bufs[i].map[p])
+				munmap(bufs[i].map[p], bufs[i].map_len[p]);
+			if (bufs[i].dmabuf[p] >= 0)
+				close(bufs[i].dmabuf[p]);
+		}
+	}
+
+	req.type = b->type;
+	req.memory = memory;
+	xioctl(b->fd, VIDIOC_REQBUFS, &req);
+}
+
+static int dmabuf_alloc(struct bench *b, size_t len)
+{
+	struct dma_heap_allocation_data data = { 0 };
+
+	data.len = len;
+	data.fd_flags = O_RDWR | O_CLOEXEC;
+	if (xioctl(b->heap_fd, DMA_HEAP_IOCTL_ALLOC, &data))
+		return -1;
+
+	return data.fd;
+}
+
+/* Fill @buf with buffer @index, with the planes of @bufs for DMABUF */
+static void init_v4l2_buffer(const struct bench *b, struct v4l2_buffer *buf,
+			     struct v4l2_plane *planes, unsigned int index,
+			     enum v4l2_memory memory)
+{
+	memset(buf, 0, sizeof(*buf));
+	buf->type = b->type;
+	buf->memory = memory;
+	buf->index = index;
+	if (b->mplane) {
+		memset(planes, 0, VIDEO_MAX_PLANES * sizeof(*planes));
+		buf->m.planes = planes;
+		buf->length = VIDEO_MAX_PLANES;
+	}
+}
+
+static int alloc_buffers(struct bench *b, const struct v4l2_format *fmt,
+			 struct buffer *bufs, unsigned int *count,
+			 enum v4l2_memory memory)
+{
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+	struct v4l2_requestbuffers req = { 0 };
+	struct v4l2_buffer buf;
+	unsigned int i, p;
+	size_t len;
+	off_t off;
+
+	req.count = *count;
+	req.type = b->type;
+	req.memory = memory;
+	if (xioctl(b->fd, VIDIOC_REQBUFS, &req)) {
+		perror("VIDIOC_REQBUFS");
+		return -1;
+	}
+	if (!req.count || req.count > MAX_BUFFERS) {
+		fprintf(stderr, "VIDIOC_REQBUFS: got %u buffers\n", req.count);
+		*count = 0;
+		free_buffers(b, bufs, 0, memory);
+		return -1;
+	}
+	*count = req.count;
+
+	for (i = 0; i < req.count; i++) {
+		memset(&bufs[i], 0, sizeof(bufs[i]));
+		for (p = 0; p < VIDEO_MAX_PLANES; p++)
+			bufs[i].dmabuf[p] = -1;
+	}
+
+	for (i = 0; i < req.count; i++) {
+		if (memory == V4L2_MEMORY_DMABUF) {
+			for (p = 0; p < fmt_planes(b, fmt); p++) {
+				len = fmt_plane_size(b, fmt, p);
+				bufs[i].dmabuf[p] = dmabuf_alloc(b, len);
+				if (bufs[i].dmabuf[p] < 0) {
+					perror("DMA_HEAP_IOCTL_ALLOC");
+					goto fail;
+				}
+			}
+			continue;
+		}
+
+		init_v4l2_buffer(b, &buf, planes, i, memory);
+		if (xioctl(b->fd, VIDIOC_QUERYBUF, &buf)) {
+			perror("VIDIOC_QUERYBUF");
+			goto fail;
+		}
+		for (p = 0; p < (b->mplane ? buf.length : 1); p++) {
+			len = b->mplane ? planes[p].length : buf.length;
+			off = b->mplane ? planes[p].m.mem_offset : buf.m.offset;
+			bufs[i].map[p] = mmap(NULL, len, PROT_READ, MAP_SHARED,
+					      b->fd, off);
+			if (bufs[i].map[p] == MAP_FAILED) {
+				bufs[i].map[p] = NULL;
+				perror("mmap");
+				goto fail;
+			}
+			bufs[i].map_len[p] = len;
+		}
+	}
+
+	return 0;
+
+fail:
+	free_buffers(b, bufs, req.count, memory);
+	return -1;
+}
+
+static int queue_buffer(struct bench *b, const struct v4l2_format *fmt,
+			struct buffer *bufs, unsigned int index,
+			enum v4l2_memory memory)
+{
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+	struct v4l2_buffer buf;
+	unsigned int p;
+
+	init_v4l2_buffer(b, &buf, planes, index, memory);
+	if (memory == V4L2_MEMORY_DMABUF) {
+		if (b->mplane) {
+			buf.length = fmt_planes(b, fmt);
+			for (p = 0; p < buf.length; p++) {
+				planes[p].m.fd = bufs[index].dmabuf[p];
+				planes[p].length = fmt_plane_size(b, fmt, p);
+			}
+		} else {
+			buf.m.fd = bufs[index].dmabuf[0];
+			buf.length = fmt_plane_size(b, fmt, 0);
+		}
+	}
+
+	if (xioctl(b->fd, VIDIOC_QBUF, &buf)) {
+		perror("VIDIOC_QBUF");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Runs
+ */
+static double tv_ms(const struct timeval *tv)
+{
+	return tv->tv_sec * 1e3 + tv->tv_usec / 1e3;
+}
+
+/* Wait for and dequeue one buffer. Return -ETIMEDOUT on timeout. */
+static int dequeue(struct bench *b, struct v4l2_buffer *buf,
+		   struct v4l2_plane *planes, enum v4l2_memory memory)
+{
+	struct pollfd pfd = { .fd = b->fd, .events = POLLIN };
+	int ret;
+
+	for (;;) {
+		init_v4l2_buffer(b, buf, planes, 0, memory);
+		if (!xioctl(b->fd, VIDIOC_DQBUF, buf))
+			return 0;
+		if (errno != EAGAIN) {
+			perror("VIDIOC_DQBUF");
+			return -errno;
+		}
+
+		ret = poll(&pfd, 1, b->timeout_ms);
+		if (ret < 0 && errno != EINTR) {
+			perror("poll");
+			return -errno;
+		}
+		if (!ret)
+			return -ETIMEDOUT;
+	}
+}
+
+static void interval_stats(const double *ts, unsigned int n,
+			   struct run_result *r)
+{
+	double sum = 0, sq = 0, d;
+	unsigned int i;
+
+	if (n < 2)
+		return;
+
+	r->fps = (n - 1) * 1e3 / (ts[n - 1] - ts[0]);
+	r->interval_ms = (ts[n - 1] - ts[0]) / (n - 1);
+	for (i = 1; i < n; i++) {
+		d = ts[i] - ts[i - 1] - r->interval_ms;
+		sum += d;
+		sq += d * d;
+		if (fabs(d) > r->max_dev_ms)
+			r->max_dev_ms = fabs(d);
+	}
+	r->jitter_ms = sqrt(sq / (n - 1) - (sum / (n - 1)) * (sum / (n - 1)));
+}
+
+static int run(struct bench *b, const struct run_config *cfg,
+	       struct run_result *r)
+{
+	struct v4l2_plane planes[VIDEO_MAX_PLANES];
+	struct buffer bufs[MAX_BUFFERS];
+	uint32_t type = b->type;
+	struct v4l2_buffer buf;
+	uint32_t last_seq = 0;
+	double *ts, t0, cpu0;
+	unsigned int i;
+	int ret = -1;
+
+	memset(r, 0, sizeof(*r));
+	if (set_format(b, &cfg->size, &r->fmt))
+		return -1;
+
+	ts = calloc(b->frames, sizeof(*ts));
+	if (!ts)
+		return -1;
+
+	r->buffers = cfg->buffers;
+	if (alloc_buffers(b, &r->fmt, bufs, &r->buffers, cfg->memory))
+		goto out;
+
+	for (i = 0; i < r->buffers; i++) {
+		if (queue_buffer(b, &r->fmt, bufs, i, cfg->memory))
+			goto out_free;
+	}
+
+	cpu0 = cpu_us();
+	t0 = now_ms();
+	if (xioctl(b->fd, VIDIOC_STREAMON, &type)) {
+		perror("VIDIOC_STREAMON");
+		goto out_free;
+	}
+	r->streamon_ms = now_ms() - t0;
+
+	for (i = 0; i < b->frames; i++) {
+		ret = dequeue(b, &buf, planes, cfg->memory);
+		if (ret) {
+			if (ret == -ETIMEDOUT)
+				fprintf(stderr, "no frame after %d ms\n",
+					b->timeout_ms);
+			break;
+		}
+
+		if (!i)
+			r->first_frame_ms = now_ms() - t0;
+		/* the driver timestamps, else the dequeue time */
+		if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+		    V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+			ts[i] = tv_ms(&buf.timestamp);
+		else
+			ts[i] = now_ms();
+		if (i && buf.sequence > last_seq + 1)
+			r->dropped += buf.sequence - last_seq - 1;
+		last_seq = buf.sequence;
+		if (buf.flags & V4L2_BUF_FLAG_ERROR)
+			r->errors++;
+		r->frames++;
+
+		ret = queue_buffer(b, &r->fmt, bufs, buf.index, cfg->memory);
+		if (ret)
+			break;
+	}
+	r->cpu_us = r->frames ? (cpu_us() - cpu0) / r->frames : 0;
+
+	t0 = now_ms();
+	if (xioctl(b->fd, VIDIOC_STREAMOFF, &type)) {
+		perror("VIDIOC_STREAMOFF");
+		ret = -1;
+	}
+	r->streamoff_ms = now_ms() - t0;
+
+	interval_stats(ts, r->frames, r);
+
+out_free:
+	free_buffers(b, bufs, r->buffers, cfg->memory);
+out:
+	free(ts);
+	return ret;
+}
+
+static void print_result(const struct bench *b, const struct run_config *cfg,
+			 const struct run_result *r, int failed)
+{
+	char fourcc[5];
+
+	fourcc_str(fmt_fourcc(b, &r->fmt), fourcc);
+
+	if (format == OUTPUT_CSV) {
+		printf("%u,%u,%s,%s,%u,%u,%.3f,%.4f,%.4f,%.4f,%u,%u,%.3f,%.3f,%.3f,%.1f,%s\n",
+		       fmt_width(b, &r->fmt), fmt_height(b, &r->fmt), fourcc,
+		       memory_name(cfg->memory), r->buffers, r->frames, r->fps,
+		       r->interval_ms, r->jitter_ms, r->max_dev_ms, r->dropped,
+		       r->errors, r->streamon_ms, r->first_frame_ms,
+		       r->streamoff_ms, r->cpu_us, failed ? "fail" : "ok");
+		return;
+	}
+
+	printf("%ux%u %s %s x%u: %u frames%s\n", fmt_width(b, &r->fmt),
+	       fmt_height(b, &r->fmt), fourcc, memory_name(cfg->memory),
+	       r->buffers, r->frames, failed ? " (failed)" : "");
+	printf("  %.3f fps, interval %.4f ms, jitter %.4f ms, max deviation %.4f ms\n",
+	       r->fps, r->interval_ms, r->jitter_ms, r->max_dev_ms);
+	printf("  dropped %u, errors %u\n", r->dropped, r->errors);
+	printf("  streamon %.3f ms, first frame %.3f ms, streamoff %.3f ms\n",
+	       r->streamon_ms, r->first_frame_ms, r->streamoff_ms);
+	printf("  cpu %.1f us/frame\n", r->cpu_us);
+}
+
+/*
+ * Command line
+ */
+static int parse_list(const char *arg, unsigned int *list)
+{
+	char *end;
+	int n = 0;
+
+	do {
+		if (n == MAX_LIST)
+			return -1;
+		list[n++] = strtoul(arg, &end, 0);
+		if (end == arg || (*end && *end != ','))
+			return -1;
+		arg = end + 1;
+	} while (*end);
+
+	return n;
+}
+
+static int parse_memory(const char *arg, unsigned int *list)
+{
+	char buf[64], *tok, *save;
+	int n = 0;
+
+	snprintf(buf, sizeof(buf), "%s", arg);
+	for (tok = strtok_r(buf, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (n == MAX_LIST)
+			return -1;
+		if (!strcmp(tok, "mmap"))
+			list[n++] = V4L2_MEMORY_MMAP;
+		else if (!strcmp(tok, "dmabuf"))
+			list[n++] = V4L2_MEMORY_DMABUF;
+		else
+			return -1;
+	}
+
+	return n;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -d <video node> [-s <subdev> [-p <pad>]] [-m mmap,dmabuf]\n"
+		"          [-b <buffers,...>] [-n <frames>] [-F <fourcc>] [-r <WxH> | -S]\n"
+		"          [-i <iterations>] [-f text|csv] [-l <max streamon ms>]\n"
+		"          [-x <max dropped>] [-T <timeout ms>] [-H <dma heap>]\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int memories[MAX_LIST] = { V4L2_MEMORY_MMAP };
+	unsigned int buffers[MAX_LIST] = { 4 };
+	int nbuffers = 1, nmemories = 1, nsizes = 1, iterations = 1;
+	struct bench b = {
+		.subdev_fd = -1,
+		.heap_fd = -1,
+		.frames = DEFAULT_FRAMES,
+		.timeout_ms = DEFAULT_TIMEOUT_MS,
+		.heap = DEFAULT_HEAP,
+	};
+	const char *video = NULL, *subdev = NULL;
+	double max_streamon_ms = 0;
+	long max_dropped = -1;
+	struct size sizes[MAX_SIZES] = { { 0, 0 } };
+	struct v4l2_capability cap = { 0 };
+	struct run_config cfg;
+	struct run_result r;
+	int sweep = 0, failed = 0, runs;
+	int opt, i, m, ret;
+	uint32_t caps;
+
+	while ((opt = getopt(argc, argv, "d:s:p:m:b:n:F:r:Si:f:l:x:T:H:h")) !=
+	       -1) {
+		switch (opt) {
+		case 'd':
+			video = optarg;
+			break;
+		case 's':
+			subdev = optarg;
+			break;
+		case 'p':
+			b.pad = atoi(optarg);
+			break;
+		case 'm':
+			nmemories = parse_memory(optarg, memories);
+			break;
+		case 'b':
+			nbuffers = parse_list(optarg, buffers);
+			break;
+		case 'n':
+			b.frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			if (strlen(optarg) != 4) {
+				usage(argv[0]);
+				return 1;
+			}
+			b.fourcc = v4l2_fourcc(optarg[0], optarg[1],
+					       optarg[2], optarg[3]);
+			break;
+		case 'r':
+			if (sscanf(optarg, "%ux%u", &sizes[0].width,
+				   &sizes[0].height) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'S':
+			sweep = 1;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'f':
+			if (!strcmp(optarg, "csv")) {
+				format = OUTPUT_CSV;
+			} else if (strcmp(optarg, "text")) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'l':
+			max_streamon_ms = atof(optarg);
+			break;
+		case 'x':
+			max_dropped = atol(optarg);
+			break;
+		case 'T':
+			b.timeout_ms = atoi(optarg);
+			break;
+		case 'H':
+			b.heap = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!video || nmemories < 1 || nbuffers < 1 || !b.frames ||
+	    iterations < 1) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	b.fd = open(video, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (b.fd < 0) {
+		perror(video);
+		return 1;
+	}
+	if (xioctl(b.fd, VIDIOC_QUERYCAP, &cap)) {
+		perror("VIDIOC_QUERYCAP");
+		return 1;
+	}
+	caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps :
+							 cap.capabilities;
+	if (caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+		b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+		b.mplane = 1;
+	} else if (caps & V4L2_CAP_VIDEO_CAPTURE) {
+		b.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	} else {
+		fprintf(stderr, "%s: not a video capture node\n", video);
+		return 1;
+	}
+	if (!(caps & V4L2_CAP_STREAMING)) {
+		fprintf(stderr, "%s: no streaming I/O\n", video);
+		return 1;
+	}
+
+	if (subdev) {
+		b.subdev_fd = open(subdev, O_RDWR | O_CLOEXEC);
+		if (b.subdev_fd < 0) {
+			perror(subdev);
+			return 1;
+		}
+	}
+
+	for (m = 0; m < nmemories; m++) {
+		if (memories[m] != V4L2_MEMORY_DMABUF)
+			continue;
+		b.heap_fd = open(b.heap, O_RDONLY | O_CLOEXEC);
+		if (b.heap_fd < 0) {
+			perror(b.heap);
+			return 1;
+		}
+		break;
+	}
+
+	if (sweep) {
+		nsizes = enum_sizes(&b, sizes);
+		if (nsizes <= 0) {
+			fprintf(stderr, "no frame sizes to sweep\n");
+			return 1;
+		}
+	}
+
+	if (format == OUTPUT_CSV)
+		printf("width,height,fourcc,memory,buffers,frames,fps,interval_ms,jitter_ms,max_dev_ms,dropped,errors,streamon_ms,first_frame_ms,streamoff_ms,cpu_us_per_frame,status\n");
+	else
+		printf("%s: %.32s (%.16s)\n", video, cap.card, cap.driver);
+
+	/* every size, memory type and buffer count, @iterations times */
+	runs = nsizes * nmemories * nbuffers * iterations;
+	for (i = 0; i < runs; i++) {
+		cfg.size = sizes[i / (nmemories * nbuffers * iterations)];
+		cfg.memory = memories[i / (nbuffers * iterations) % nmemories];
+		cfg.buffers = buffers[i / iterations % nbuffers];
+
+		ret = run(&b, &cfg, &r);
+		if (!ret && max_streamon_ms &&
+		    r.streamon_ms > max_streamon_ms) {
+			fprintf(stderr, "streamon took %.3f ms, more than %.3f\n",
+				r.streamon_ms, max_streamon_ms);
+			ret = -1;
+		}
+		if (!ret && max_dropped >= 0 &&
+		    (long)r.dropped > max_dropped) {
+			fprintf(stderr, "%u frames dropped, more than %ld\n",
+				r.dropped, max_dropped);
+			ret = -1;
+		}
+		print_result(&b, &cfg, &r, ret);
+		failed += !!ret;
+	}
+
+	if (failed)
+		fprintf(stderr, "%d of %d runs failed\n", failed, runs);
+
+	if (b.heap_fd >= 0)
+		close(b.heap_fd);
+	if (b.subdev_fd >= 0)
+		close(b.subdev_fd);
+	close(b.fd);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,306 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * SSDB and CLDB buffers found in the ACPI tables of Intel IPU camera
+ * sensors and PMICs, with a field table used by every decoder in this
+ * repository (the dump_intel_ipu_data module and the userspace tools).
+ *
+ * Adding a field only means adding it to the struct and to its table.
+ */
+#ifndef IPU_ACPI_FIELDS_H
+#define IPU_ACPI_FIELDS_H
+
+#ifdef __KERNEL__
+#include <linux/stddef.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifndef __packed
+#define __packed __attribute__((__packed__))
+#endif
+#endif
+
+/* From coreboot */
+struct intel_ssdb {
+	uint8_t version;			/* Current version */
+	uint8_t sensor_card_sku;		/* CRD Board type */
+	uint8_t csi2_data_stream_interface[16];	/* CSI2 data stream GUID */
+	uint16_t bdf_value;			/* Bus number of the host
+						 * controller
+						 */
+	uint32_t dphy_link_en_fuses;		/* Host controller's fuses
+						 * information used to verify
+						 * if link is fused out or not
+						 */
+	uint32_t lanes_clock_division;		/* Lanes/clock divisions per
+						 * sensor
+						 */
+	uint8_t link_used;			/* Link used by this sensor
+						 * stream
+						 */
+	uint8_t lanes_used;			/* Number of lanes connected
+						 * for the sensor
+						 */
+	uint32_t csi_rx_dly_cnt_termen_clane;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_settle_clane;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_termen_dlane0;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_settle_dlane0;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_termen_dlane1;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_settle_dlane1;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_termen_dlane2;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_settle_dlane2;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_termen_dlane3;	/* MIPI timing information */
+	uint32_t csi_rx_dly_cnt_settle_dlane3;	/* MIPI timing information */
+	uint32_t max_lane_speed;		/* Maximum lane speed for
+						 * the sensor
+						 */
+	uint8_t sensor_cal_file_idx;		/* Legacy field for sensor
+						 * calibration file index
+						 */
+	uint8_t sensor_cal_file_idx_mbz[3];	/* Legacy field for sensor
+						 * calibration file index
+						 */
+	uint8_t rom_type;			/* NVM type of the camera
+						 * module
+						 */
+	uint8_t vcm_type;			/* VCM type of the camera
+						 * module
+						 */
+	uint8_t platform;			/* Platform information */
+	uint8_t platform_sub;			/* Platform sub-categories */
+	uint8_t flash_support;			/* Enable/disable flash
+						 * support
+						 */
+	uint8_t privacy_led;			/* Privacy LED support */
+	uint8_t degree;				/* Camera Orientation */
+	uint8_t mipi_define;			/* MIPI info defined in ACPI or
+						 * sensor driver
+						 */
+	uint32_t mclk_speed;			/* Clock info for sensor */
+	uint8_t control_logic_id;		/* PMIC device node used for
+						 * the camera sensor
+						 */
+	uint8_t mipi_data_format;		/* MIPI data format */
+	uint8_t silicon_version;		/* Silicon version */
+	uint8_t customer_id;			/* Customer ID */
+	uint8_t mclk_port;
+	uint8_t reserved[13];			/* Pads SSDB out so the binary
+						 * blob in ACPI is the same
+						 * size as seen on other
+						 * firmwares.
+						 */
+} __packed;
+
+/* From old chromiumos ACPI data reading implementation */
+struct intel_cldb {
+	uint8_t version;
+	uint8_t control_logic_type;		/* enum control_logic_type */
+	uint8_t control_logic_id;		/* PMIC device node used for
+						 * the camera sensor
+						 */
+	uint8_t sensor_card_sku;
+	uint8_t reserved[28];
+} __packed;
+
+/*
+ * Returned by the DSMB _DSM (5815c5c8-c47d-477b-9a8d-76173176414b) on
+ * some sensors and PMICs (Surface Go 1 / Go 2, Acer Switch Alpha 12...).
+ * The meaning of the entries is not known yet.
+ */
+struct intel_dsmb {
+	uint32_t entry_count;
+	uint32_t entries[12];
+} __packed;
+
+enum control_logic_type {
+	PMIC_TYPE_UNKNOWN,
+	PMIC_TYPE_DISCRETE,
+	PMIC_TYPE_TPS68470,
+	PMIC_TYPE_UP6641,
+};
+
+static const char * const control_logic_type_list[] = {
+	"0: UNKNOWN",
+	"1: DISCRETE(CRD-D)",
+	"2: PMIC TPS68470",
+	"3: PMIC uP6641",
+	NULL
+};
+
+enum ipu_field_kind {
+	IPU_FIELD_UINT,		/* little endian, up to 4 bytes */
+	IPU_FIELD_ENUM,		/* IPU_FIELD_UINT with names */
+	IPU_FIELD_BYTES,	/* dumped as is */
+};
+
+/* shown in the short summary as well */
+#define IPU_FIELD_SUMMARY	(1 << 0)
+
+struct ipu_field {
+	const char *name;
+	unsigned short offset;
+	unsigned short size;
+	unsigned char kind;		/* enum ipu_field_kind */
+	unsigned char flags;
+	const char * const *names;	/* NULL terminated, IPU_FIELD_ENUM */
+	uint32_t min;			/* valid range if max is not 0 */
+	uint32_t max;
+};
+
+#define IPU_FIELD(type, member, _kind, _flags)				\
+	{								\
+		.name = #member,					\
+		.offset = offsetof(struct type, member),		\
+		.size = sizeof(((struct type *)0)->member),		\
+		.kind = _kind,						\
+		.flags = _flags,					\
+	}
+
+#define IPU_FIELD_NAMES(type, member, _names, _flags)			\
+	{								\
+		.name = #member,					\
+		.offset = offsetof(struct type, member),		\
+		.size = sizeof(((struct type *)0)->member),		\
+		.kind = IPU_FIELD_ENUM,					\
+		.flags = _flags,					\
+		.names = _names,					\
+	}
+
+#define IPU_FIELD_RANGE(type, member, _min, _max, _flags)		\
+	{								\
+		.name = #member,					\
+		.offset = offsetof(struct type, member),		\
+		.size = sizeof(((struct type *)0)->member),		\
+		.kind = IPU_FIELD_UINT,					\
+		.flags = _flags,					\
+		.min = _min,						\
+		.max = _max,						\
+	}
+
+static const struct ipu_field intel_ssdb_fields[] = {
+	IPU_FIELD(intel_ssdb, version, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, sensor_card_sku, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi2_data_stream_interface, IPU_FIELD_BYTES, 0),
+	IPU_FIELD(intel_ssdb, bdf_value, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, dphy_link_en_fuses, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, lanes_clock_division, IPU_FIELD_UINT, 0),
+	IPU_FIELD_RANGE(intel_ssdb, link_used, 0, 7, IPU_FIELD_SUMMARY),
+	IPU_FIELD_RANGE(intel_ssdb, lanes_used, 1, 4, IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_termen_clane, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_settle_clane, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_termen_dlane0, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_settle_dlane0, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_termen_dlane1, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_settle_dlane1, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_termen_dlane2, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_settle_dlane2, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_termen_dlane3, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, csi_rx_dly_cnt_settle_dlane3, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, max_lane_speed, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, sensor_cal_file_idx, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, sensor_cal_file_idx_mbz, IPU_FIELD_BYTES, 0),
+	IPU_FIELD(intel_ssdb, rom_type, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, vcm_type, IPU_FIELD_UINT, IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, platform, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, platform_sub, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, flash_support, IPU_FIELD_UINT, IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, privacy_led, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, degree, IPU_FIELD_UINT, IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, mipi_define, IPU_FIELD_UINT, 0),
+	IPU_FIELD_RANGE(intel_ssdb, mclk_speed, 6000000, 64000000,
+			IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, control_logic_id, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, mipi_data_format, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, silicon_version, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, customer_id, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_ssdb, mclk_port, IPU_FIELD_UINT, IPU_FIELD_SUMMARY),
+	IPU_FIELD(intel_ssdb, reserved, IPU_FIELD_BYTES, 0),
+	{ }
+};
+
+static const struct ipu_field intel_cldb_fields[] = {
+	IPU_FIELD(intel_cldb, version, IPU_FIELD_UINT, 0),
+	IPU_FIELD_NAMES(intel_cldb, control_logic_type,
+			control_logic_type_list, 0),
+	IPU_FIELD(intel_cldb, control_logic_id, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_cldb, sensor_card_sku, IPU_FIELD_UINT, 0),
+	IPU_FIELD(intel_cldb, reserved, IPU_FIELD_BYTES, 0),
+	{ }
+};
+
+static const struct ipu_field intel_dsmb_fields[] = {
+	IPU_FIELD_RANGE(intel_dsmb, entry_count, 0, 12, 0),
+	IPU_FIELD(intel_dsmb, entries, IPU_FIELD_BYTES, 0),
+	{ }
+};
+
+/*
+ * Walk the fields of @table that are inside the first @len bytes of the
+ * buffer, so that short buffers from old firmwares are decoded as far as
+ * they go.
+ */
+#define ipu_for_each_field(f, table, len)				\
+	for ((f) = (table); (f)->name; (f)++)				\
+		if ((unsigned int)(f)->offset + (f)->size > (len)) {}	\
+		else
+
+static inline uint32_t ipu_field_value(const struct ipu_field *f,
+				       const void *buf)
+{
+	const uint8_t *p = (const uint8_t *)buf + f->offset;
+	uint32_t val = 0;
+	unsigned int i;
+
+	for (i = 0; i < f->size && i < sizeof(val); i++)
+		val |= (uint32_t)p[i] << (8 * i);
+
+	return val;
+}
+
+/* Return the name of an IPU_FIELD_ENUM value, NULL if unknown */
+static inline const char *ipu_field_value_name(const struct ipu_field *f,
+					       uint32_t val)
+{
+	uint32_t i;
+
+	if (f->kind != IPU_FIELD_ENUM)
+		return NULL;
+
+	for (i = 0; f->names[i]; i++) {
+		if (i == val)
+			return f->names[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Return 0 if @val is out of the range of @f: an IPU_FIELD_ENUM value
+ * without a name, or a value outside of min..max. Used to flag broken or
+ * unknown firmware data, like 0 lanes or an MCLK of 0.
+ */
+static inline int ipu_field_valid(const struct ipu_field *f, uint32_t val)
+{
+	if (f->kind == IPU_FIELD_ENUM)
+		return ipu_field_value_name(f, val) != NULL;
+	if (f->max)
+		return val >= f->min && val <= f->max;
+	return 1;
+}
+
+/* Length of the longest field name, to align the values when printing */
+static inline int ipu_fields_name_width(const struct ipu_field *table)
+{
+	int width = 0;
+
+	for (; table->name; table++) {
+		if ((int)strlen(table->name) > width)
+			width = strlen(table->name);
+	}
+
+	return width;
+}
+
+#endif /* IPU_ACPI_FIELDS_H */
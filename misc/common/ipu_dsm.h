@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Decoding of the I2C device and discrete PMIC GPIO _DSM values, and of
+ * the _CRS resources they describe. Shared by dump_intel_ipu_data and the
+ * userspace tools, like ipu_acpi_fields.h.
+ */
+#ifndef IPU_DSM_H
+#define IPU_DSM_H
+
+#ifdef __KERNEL__
+#include <linux/stddef.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#endif
+
+/*
+ * I2C device _DSM (26257549-9271-4ca4-bb43-c4899d5a4881), one value per
+ * I2cSerialBus resource in _CRS, in the same order:
+ *   [31:24] I2C controller, N of \_SB.PCI0.I2CN
+ *   [23:16] unknown, always 0 so far
+ *   [15:8]  7-bit address
+ *   [7:0]   device type
+ */
+#define IPU_DSM_I2C_BUS(val)		(((val) >> 24) & 0xff)
+#define IPU_DSM_I2C_ADDR(val)		(((val) >> 8) & 0xff)
+#define IPU_DSM_I2C_TYPE(val)		((val) & 0xff)
+
+/*
+ * Discrete PMIC (INT3472) GPIO _DSM (79234640-9e10-4fea-a5c1-b5aa8b19756f),
+ * one value per GpioIo resource in _CRS, in the same order:
+ *   [31:24] value that activates the function, 0 means active low
+ *   [23:16] unknown, always 0 so far
+ *   [15:8]  pin number, the same as in the GpioIo resource
+ *   [7:0]   function
+ */
+#define IPU_DSM_GPIO_ACTIVE(val)	(((val) >> 24) & 0xff)
+#define IPU_DSM_GPIO_PIN(val)		(((val) >> 8) & 0xff)
+#define IPU_DSM_GPIO_TYPE(val)		((val) & 0xff)
+
+struct ipu_dsm_code {
+	uint8_t min;
+	uint8_t max;
+	const char *name;
+};
+
+/* Same names as the con_id used by the int3472 driver where there is one */
+static const struct ipu_dsm_code ipu_dsm_gpio_types[] = {
+	{ 0x00, 0x00, "reset" },
+	{ 0x01, 0x01, "powerdown" },
+	{ 0x0b, 0x0b, "power-enable" },
+	{ 0x0c, 0x0c, "clk-enable" },
+	{ 0x0d, 0x0d, "privacy-led" },
+	{ }
+};
+
+/* coreboot's mipi_camera and the results so far (EEPROM at 0x50..0x53) */
+static const struct ipu_dsm_code ipu_dsm_i2c_types[] = {
+	{ 0x00, 0x00, "sensor" },
+	{ 0x01, 0x01, "vcm" },
+	{ 0x02, 0x05, "eeprom" },
+	{ 0x0b, 0x0b, "pmic" },
+	{ }
+};
+
+/* Return the name of @code in @table, NULL if unknown */
+static inline const char *ipu_dsm_code_name(const struct ipu_dsm_code *table,
+					    uint32_t code)
+{
+	for (; table->name; table++) {
+		if (code >= table->min && code <= table->max)
+			return table->name;
+	}
+
+	return NULL;
+}
+
+/*
+ * Resources of a _CRS buffer that the _DSM values refer to. Only the
+ * GpioIo and I2cSerialBus resources are kept, in their order.
+ */
+#define IPU_CRS_RES_MAX		16
+#define IPU_CRS_SOURCE_SIZE	32
+
+enum ipu_crs_res_type {
+	IPU_CRS_GPIO_INT,
+	IPU_CRS_GPIO_IO,
+	IPU_CRS_I2C,
+};
+
+struct ipu_crs_res {
+	uint8_t type;				/* enum ipu_crs_res_type */
+	uint16_t value;				/* first pin, or I2C address */
+	uint32_t speed;				/* I2C bus speed in Hz */
+	char source[IPU_CRS_SOURCE_SIZE];	/* GPIO or I2C controller */
+};
+
+struct ipu_crs {
+	struct ipu_crs_res gpio[IPU_CRS_RES_MAX];	/* GpioIo only */
+	int gpio_count;
+	struct ipu_crs_res i2c[IPU_CRS_RES_MAX];
+	int i2c_count;
+};
+
+static inline uint16_t ipu_crs_u16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static inline void ipu_crs_source(char *out, const uint8_t *res,
+				  size_t res_len, size_t offset)
+{
+	size_t i;
+
+	for (i = 0; i < IPU_CRS_SOURCE_SIZE - 1 && offset + i < res_len &&
+		    res[offset + i]; i++)
+		out[i] = res[offset + i];
+	out[i] = '\0';
+}
+
+/*
+ * Collect the GpioIo and I2cSerialBus resources of the resource template
+ * in @buf. Resources past IPU_CRS_RES_MAX are ignored.
+ *
+ * Return 0, or -1 if the template is truncated or malformed.
+ */
+static inline int ipu_crs_parse(const uint8_t *buf, size_t len,
+				struct ipu_crs *crs)
+{
+	struct ipu_crs_res *res;
+	size_t pos = 0, res_len, pins;
+
+	memset(crs, 0, sizeof(*crs));
+
+	while (pos < len) {
+		/* small resource, 0x79 is the end tag */
+		if (!(buf[pos] & 0x80)) {
+			if (buf[pos] == 0x79)
+				return 0;
+			pos += 1 + (buf[pos] & 0x07);
+			continue;
+		}
+
+		if (len - pos < 3)
+			return -1;
+		res_len = 3 + ipu_crs_u16(buf + pos + 1);
+		if (res_len > len - pos)
+			return -1;
+
+		/* GPIO connection, pin table and source name offsets */
+		if (buf[pos] == 0x8c && res_len >= 23) {
+			pins = ipu_crs_u16(buf + pos + 14);
+			if (pins + 2 <= res_len &&
+			    crs->gpio_count < IPU_CRS_RES_MAX &&
+			    buf[pos + 4] == IPU_CRS_GPIO_IO) {
+				res = &crs->gpio[crs->gpio_count++];
+				res->type = IPU_CRS_GPIO_IO;
+				res->value = ipu_crs_u16(buf + pos + pins);
+				ipu_crs_source(res->source, buf + pos, res_len,
+					       ipu_crs_u16(buf + pos + 17));
+			}
+		}
+
+		/* I2C serial bus, source name after the type specific data */
+		if (buf[pos] == 0x8e && res_len >= 18 && buf[pos + 5] == 1 &&
+		    crs->i2c_count < IPU_CRS_RES_MAX) {
+			res = &crs->i2c[crs->i2c_count++];
+			res->type = IPU_CRS_I2C;
+			res->speed = ipu_crs_u16(buf + pos + 12) |
+				     (uint32_t)ipu_crs_u16(buf + pos + 14) << 16;
+			res->value = ipu_crs_u16(buf + pos + 16);
+			ipu_crs_source(res->source, buf + pos, res_len,
+				       12 + ipu_crs_u16(buf + pos + 10));
+		}
+
+		pos += res_len;
+	}
+
+	return -1;
+}
+
+/*
+ * Return the index of the _CRS resource that the @index-th GPIO _DSM
+ * value @val describes: the GpioIo at the same index if the pin matches,
+ * else the first GpioIo with that pin. Return -1 if there is none.
+ */
+static inline int ipu_dsm_gpio_crs_index(const struct ipu_crs *crs,
+					 int index, uint32_t val)
+{
+	int i;
+
+	if (index < crs->gpio_count &&
+	    crs->gpio[index].value == IPU_DSM_GPIO_PIN(val))
+		return index;
+
+	for (i = 0; i < crs->gpio_count; i++) {
+		if (crs->gpio[i].value == IPU_DSM_GPIO_PIN(val))
+			return i;
+	}
+
+	return -1;
+}
+
+/* Same for I2C _DSM values, matched on the address */
+static inline int ipu_dsm_i2c_crs_index(const struct ipu_crs *crs,
+					int index, uint32_t val)
+{
+	int i;
+
+	if (index < crs->i2c_count &&
+	    crs->i2c[index].value == IPU_DSM_I2C_ADDR(val))
+		return index;
+
+	for (i = 0; i < crs->i2c_count; i++) {
+		if (crs->i2c[i].value == IPU_DSM_I2C_ADDR(val))
+			return i;
+	}
+
+	return -1;
+}
+
+#endif /* IPU_DSM_H */
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * The queue of ctrl_queue.h. Settings are kept by the frame they are for
+ * in a ring of CTRLQ_DEPTH entries. On each frame start, every control
+ * gets the value of the last setting queued for the frame it would land
+ * on, and the settings that every control has gone past are folded into
+ * the base setting, which holds until the next one queued.
+ */
+
+#include <string.h>
+#include "ctrl_queue.h"
+
+#define SLOT(seq)		((seq) & (CTRLQ_DEPTH - 1))
+
+/* @a before @b, sequence numbers wrap */
+static int seq_before(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
+
+void ctrlq_default_config(struct ctrlq_config *cfg)
+{
+	cfg->delay[CTRLQ_EXPOSURE] = 2;
+	cfg->delay[CTRLQ_GAIN] = 1;
+	cfg->delay[CTRLQ_VBLANK] = 1;
+}
+
+void ctrlq_init(struct ctrlq *q, const struct ctrlq_config *cfg,
+		const struct ctrlq_setting *current)
+{
+	unsigned int c;
+
+	memset(q, 0, sizeof(*q));
+	q->cfg = *cfg;
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+		/* there is no telling what lands where beyond the ring */
+		if (q->cfg.delay[c] > CTRLQ_DEPTH / 2)
+			q->cfg.delay[c] = CTRLQ_DEPTH / 2;
+		if (q->cfg.delay[c] > q->max_delay)
+			q->max_delay = q->cfg.delay[c];
+	}
+
+	q->base = *current;
+	q->current = *current;
+}
+
+uint32_t ctrlq_earliest(const struct ctrlq *q)
+{
+	if (!q->started)
+		return q->max_delay;
+
+	return q->sequence + 1 + q->max_delay;
+}
+
+int ctrlq_queue(struct ctrlq *q, uint32_t sequence,
+		const struct ctrlq_setting *s)
+{
+	uint32_t next = q->started ? q->sequence + 1 : 0;
+	struct ctrlq_entry *e;
+
+	if (seq_before(sequence, ctrlq_earliest(q)) ||
+	    sequence - next >= CTRLQ_DEPTH)
+		return -1;
+
+	e = &q->queue[SLOT(sequence)];
+	e->sequence = sequence;
+	e->queued = 1;
+	e->s = *s;
+	return 0;
+}
+
+/* The value of control @c for frame @sequence, from what is queued */
+static int32_t lookup(const struct ctrlq *q, unsigned int c,
+		      uint32_t sequence)
+{
+	const struct ctrlq_entry *found = NULL;
+	unsigned int i;
+
+	for (i = 0; i < CTRLQ_DEPTH; i++) {
+		const struct ctrlq_entry *e = &q->queue[i];
+
+		if (!e->queued || seq_before(sequence, e->sequence))
+			continue;
+		if (!found || seq_before(found->sequence, e->sequence))
+			found = e;
+	}
+
+	return found ? found->s.val[c] : q->base.val[c];
+}
+
+/* Fold the settings queued up to frame @sequence into the base one */
+static void dequeue(struct ctrlq *q, uint32_t sequence)
+{
+	const struct ctrlq_entry *last = NULL;
+	unsigned int i;
+
+	for (i = 0; i < CTRLQ_DEPTH; i++) {
+		struct ctrlq_entry *e = &q->queue[i];
+
+		if (!e->queued || seq_before(sequence, e->sequence))
+			continue;
+		if (!last || seq_before(last->sequence, e->sequence))
+			last = e;
+		e->queued = 0;
+	}
+
+	if (last)
+		q->base = last->s;
+}
+
+unsigned int ctrlq_frame_start(struct ctrlq *q, uint32_t sequence,
+			       struct ctrlq_setting *out)
+{
+	const struct ctrlq_config *cfg = &q->cfg;
+	unsigned int min_delay = q->max_delay;
+	struct ctrlq_setting want;
+	int32_t vblank, vblank_cur = q->current.val[CTRLQ_VBLANK];
+	unsigned int c, mask = 0;
+
+	if (!q->started) {
+		/* the frames before the first writes land are as set up */
+		q->started = 1;
+		q->first = sequence;
+		q->sequence = sequence - 1;
+		for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+			q->known[c] = sequence - 1;
+			q->applied[SLOT(sequence - 1)].val[c] = q->current.val[c];
+		}
+	} else if (!seq_before(q->sequence, sequence)) {
+		/* again, or out of order: nothing to do */
+		*out = q->current;
+		return 0;
+	}
+
+	q->skipped += sequence - q->sequence - 1;
+	q->sequence = sequence;
+
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+		if (cfg->delay[c] < min_delay)
+			min_delay = cfg->delay[c];
+		want.val[c] = lookup(q, c, sequence + cfg->delay[c]);
+	}
+
+	/*
+	 * VBLANK has to be long enough for the exposure written with it not
+	 * to be clamped, and is only made shorter once the exposure is
+	 * written.
+	 */
+	vblank = lookup(q, CTRLQ_VBLANK,
+			sequence + cfg->delay[CTRLQ_EXPOSURE]);
+	if (cfg->delay[CTRLQ_VBLANK] < cfg->delay[CTRLQ_EXPOSURE] &&
+	    vblank > want.val[CTRLQ_VBLANK]) {
+		want.val[CTRLQ_VBLANK] = vblank;
+		q->early++;
+	}
+
+	/* every control has gone past these */
+	dequeue(q, sequence + min_delay);
+
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+		uint32_t target = sequence + cfg->delay[c];
+		uint32_t t = q->known[c] + 1;
+		int32_t last = q->applied[SLOT(q->known[c])].val[c];
+
+		if (want.val[c] != q->current.val[c])
+			mask |= 1 << c;
+		q->current.val[c] = want.val[c];
+
+		/*
+		 * Nothing was written in the frames whose start was missed,
+		 * the frames they would have set keep the last value.
+		 */
+		if (target - t > CTRLQ_DEPTH)
+			t = target - CTRLQ_DEPTH;
+		for (; t != target; t++)
+			q->applied[SLOT(t)].val[c] = last;
+		q->applied[SLOT(target)].val[c] = want.val[c];
+		q->known[c] = target;
+	}
+
+	if (mask & 1 << CTRLQ_VBLANK && want.val[CTRLQ_VBLANK] > vblank_cur)
+		mask |= CTRLQ_VBLANK_FIRST;
+
+	*out = want;
+	return mask;
+}
+
+int ctrlq_applied(const struct ctrlq *q, uint32_t sequence,
+		  struct ctrlq_setting *s)
+{
+	unsigned int c;
+
+	if (!q->started || seq_before(sequence, q->first - 1))
+		return -1;
+
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+		if (seq_before(q->known[c], sequence) ||
+		    q->known[c] - sequence >= CTRLQ_DEPTH)
+			return -1;
+		s->val[c] = q->applied[SLOT(sequence)].val[c];
+	}
+
+	return 0;
+}
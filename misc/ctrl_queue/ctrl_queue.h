@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * A queue of exposure, gain and VBLANK settings, each for a given frame.
+ *
+ * The sensor drivers write a control as soon as it is set, and it lands
+ * a fixed number of frames after the frame it was written in: exposure 2
+ * frames later, gain and VBLANK 1 frame later on the ov8865, ov5693 and
+ * ov7251. The queue is told when each frame starts, from the
+ * V4L2_EVENT_FRAME_SYNC of the CIO2 with the sequence number the frame's
+ * buffer gets, and gives the controls to write then, each the one of the
+ * frame it lands on. It also keeps the setting that each frame was
+ * actually taken with, from what was written in which frame, so that
+ * frames whose start was missed and settings queued too late are known.
+ *
+ * The drivers clamp the exposure to the range of the VBLANK they have, so
+ * a longer VBLANK is written with the exposure of the same frame, and
+ * before it, and a shorter one after it. With the delays above, the
+ * frame before one with a longer VBLANK then gets it too.
+ */
+#ifndef CTRL_QUEUE_H
+#define CTRL_QUEUE_H
+
+#include <stdint.h>
+
+/* frames ahead that settings can be queued for, a power of 2 */
+#define CTRLQ_DEPTH		64
+
+enum ctrlq_ctrl {
+	CTRLQ_EXPOSURE,
+	CTRLQ_GAIN,
+	CTRLQ_VBLANK,
+	CTRLQ_NUM_CTRLS,
+};
+
+/* in the mask of ctrlq_frame_start(), VBLANK is to be set before the others */
+#define CTRLQ_VBLANK_FIRST	(1 << CTRLQ_NUM_CTRLS)
+
+struct ctrlq_setting {
+	int32_t val[CTRLQ_NUM_CTRLS];
+};
+
+struct ctrlq_config {
+	/* frames from the frame a control is written in to the one it lands on */
+	unsigned int delay[CTRLQ_NUM_CTRLS];
+};
+
+struct ctrlq_entry {
+	uint32_t sequence;
+	int queued;
+	struct ctrlq_setting s;
+};
+
+struct ctrlq {
+	struct ctrlq_config cfg;
+	unsigned int max_delay;
+	/* queued settings, by sequence */
+	struct ctrlq_entry queue[CTRLQ_DEPTH];
+	/* the setting of the frames after the last one dequeued */
+	struct ctrlq_setting base;
+	/* what each frame is taken with, by sequence */
+	struct ctrlq_setting applied[CTRLQ_DEPTH];
+	/* the last frame each control is known for in applied */
+	uint32_t known[CTRLQ_NUM_CTRLS];
+	/* the values of the controls */
+	struct ctrlq_setting current;
+	uint32_t first;			/* sequence of the first frame start */
+	uint32_t sequence;		/* of the last frame start */
+	int started;
+	unsigned int skipped;		/* frame starts missed */
+	unsigned int early;		/* VBLANK written a frame early */
+};
+
+/* The delays of the three drivers */
+void ctrlq_default_config(struct ctrlq_config *cfg);
+
+/* @current is what the controls are set to, the first frames take it */
+void ctrlq_init(struct ctrlq *q, const struct ctrlq_config *cfg,
+		const struct ctrlq_setting *current);
+
+/* The first frame a setting queued now can be for */
+uint32_t ctrlq_earliest(const struct ctrlq *q);
+
+/*
+ * Queue @s for frame @sequence and the ones after it, until the next
+ * setting queued. Return -1 if @sequence is before ctrlq_earliest() or
+ * CTRLQ_DEPTH frames or more after the last frame start.
+ */
+int ctrlq_queue(struct ctrlq *q, uint32_t sequence,
+		const struct ctrlq_setting *s);
+
+/*
+ * Frame @sequence started. Fill @out with the controls to set now, and
+ * return the mask of those that change, 1 << CTRLQ_*, 0 for none, with
+ * CTRLQ_VBLANK_FIRST if VBLANK goes before the others. Exposure and gain
+ * are to be set in one call, the drivers write them as one register
+ * group.
+ */
+unsigned int ctrlq_frame_start(struct ctrlq *q, uint32_t sequence,
+			       struct ctrlq_setting *out);
+
+/*
+ * The setting frame @sequence is taken with, if it is known: not before
+ * CTRLQ_DEPTH frames ago, and not after the last frame start plus the
+ * delays. Return -1 if it isn't.
+ */
+int ctrlq_applied(const struct ctrlq *q, uint32_t sequence,
+		  struct ctrlq_setting *s);
+
+#endif /* CTRL_QUEUE_H */
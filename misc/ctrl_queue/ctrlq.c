@@ -0,0 +1,656 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * This tool sets V4L2_CID_EXPOSURE, V4L2_CID_ANALOGUE_GAIN and
+ * V4L2_CID_VBLANK of a sensor subdev frame by frame with the queue of
+ * ctrl_queue.c: it takes settings, each for a frame, from a script, and
+ * on the V4L2_EVENT_FRAME_SYNC of each frame from the CIO2 (the ipu3-csi2
+ * subdev) writes the controls that land on the frames the script gives.
+ * It prints the setting each frame was taken with, by the sequence
+ * number its buffer gets, so that the frames captured meanwhile can be
+ * matched with it.
+ *
+ * With -T it runs the queue on a simulated sensor instead, which applies
+ * the controls with the delays of the drivers and clamps the exposure to
+ * the range of its VBLANK as they do, loses some frame starts, and
+ * checks that each setting lands on its frame and that the setting the
+ * queue gives for each frame is the one the sensor took it with.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include "ctrl_queue.h"
+
+#define TIMEOUT_MS		2000
+#define MAX_SCRIPT		4096
+#define EXPOSURE_GAIN		(1 << CTRLQ_EXPOSURE | 1 << CTRLQ_GAIN)
+
+static const uint32_t ctrl_ids[CTRLQ_NUM_CTRLS] = {
+	[CTRLQ_EXPOSURE] = V4L2_CID_EXPOSURE,
+	[CTRLQ_GAIN] = V4L2_CID_ANALOGUE_GAIN,
+	[CTRLQ_VBLANK] = V4L2_CID_VBLANK,
+};
+
+/* A setting for a frame, from the first frame start */
+struct script_entry {
+	uint32_t frame;
+	struct ctrlq_setting s;
+};
+
+struct script {
+	struct script_entry *entries;
+	unsigned int count;
+	unsigned int next;		/* the first one not queued */
+};
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+/*
+ * Script
+ */
+static int read_script(const char *path, struct script *sc)
+{
+	char line[256];
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	sc->entries = calloc(MAX_SCRIPT, sizeof(*sc->entries));
+	if (!sc->entries) {
+		fclose(f);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		struct script_entry *e = &sc->entries[sc->count];
+
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sc->count == MAX_SCRIPT) {
+			fprintf(stderr, "%s: more than %u settings\n", path,
+				MAX_SCRIPT);
+			break;
+		}
+		if (sscanf(line, "%u %d %d %d", &e->frame,
+			   &e->s.val[CTRLQ_EXPOSURE], &e->s.val[CTRLQ_GAIN],
+			   &e->s.val[CTRLQ_VBLANK]) != 4) {
+			fprintf(stderr, "%s: bad line: %s", path, line);
+			continue;
+		}
+		if (sc->count && e->frame <= e[-1].frame) {
+			fprintf(stderr, "%s: frame %u out of order\n", path,
+				e->frame);
+			continue;
+		}
+		sc->count++;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/*
+ * Without a script: the exposure halved, then back, every 8 frames, the
+ * gain and VBLANK as they are
+ */
+static int default_script(struct script *sc, const struct ctrlq_setting *cur,
+			  unsigned int frames)
+{
+	unsigned int i, count = frames / 8 + 1;
+
+	sc->entries = calloc(count, sizeof(*sc->entries));
+	if (!sc->entries)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		struct script_entry *e = &sc->entries[i];
+
+		e->frame = 8 * (i + 1);
+		e->s = *cur;
+		if (!(i & 1))
+			e->s.val[CTRLQ_EXPOSURE] /= 2;
+	}
+
+	sc->count = count;
+	return 0;
+}
+
+/* Queue the settings of @sc that fit, drop the ones too late */
+static void queue_script(struct ctrlq *q, struct script *sc, uint32_t first)
+{
+	while (sc->next < sc->count) {
+		struct script_entry *e = &sc->entries[sc->next];
+		uint32_t sequence = first + e->frame;
+
+		if ((int32_t)(sequence - ctrlq_earliest(q)) < 0) {
+			fprintf(stderr, "frame %u: too late to queue, dropped\n",
+				sequence);
+			sc->next++;
+			continue;
+		}
+		if (ctrlq_queue(q, sequence, &e->s))
+			break;
+		sc->next++;
+	}
+}
+
+/*
+ * Camera
+ */
+static int get_setting(int fd, struct ctrlq_setting *s)
+{
+	struct v4l2_ext_control ctrl[CTRLQ_NUM_CTRLS];
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = CTRLQ_NUM_CTRLS,
+		.controls = ctrl,
+	};
+	unsigned int c;
+
+	memset(ctrl, 0, sizeof(ctrl));
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++)
+		ctrl[c].id = ctrl_ids[c];
+
+	if (xioctl(fd, VIDIOC_G_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_G_EXT_CTRLS");
+		return -1;
+	}
+
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++)
+		s->val[c] = ctrl[c].value;
+	return 0;
+}
+
+/* VBLANK in a call of its own, as it changes the range of the exposure */
+static int set_vblank(int fd, int32_t vblank)
+{
+	struct v4l2_control ctrl = {
+		.id = V4L2_CID_VBLANK,
+		.value = vblank,
+	};
+
+	if (xioctl(fd, VIDIOC_S_CTRL, &ctrl)) {
+		perror("VIDIOC_S_CTRL VBLANK");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Both in one call, the drivers write them as one register group */
+static int set_exposure_gain(int fd, const struct ctrlq_setting *s)
+{
+	struct v4l2_ext_control ctrl[2] = {
+		{ .id = V4L2_CID_EXPOSURE, .value = s->val[CTRLQ_EXPOSURE] },
+		{ .id = V4L2_CID_ANALOGUE_GAIN, .value = s->val[CTRLQ_GAIN] },
+	};
+	struct v4l2_ext_controls ctrls = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = 2,
+		.controls = ctrl,
+	};
+
+	if (xioctl(fd, VIDIOC_S_EXT_CTRLS, &ctrls)) {
+		perror("VIDIOC_S_EXT_CTRLS");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int set_setting(int fd, const struct ctrlq_setting *s,
+		       unsigned int mask)
+{
+	if (mask & CTRLQ_VBLANK_FIRST && set_vblank(fd, s->val[CTRLQ_VBLANK]))
+		return -1;
+
+	if (mask & EXPOSURE_GAIN && set_exposure_gain(fd, s))
+		return -1;
+
+	if (mask & 1 << CTRLQ_VBLANK && !(mask & CTRLQ_VBLANK_FIRST))
+		return set_vblank(fd, s->val[CTRLQ_VBLANK]);
+
+	return 0;
+}
+
+/*
+ * The sequence of the last frame start, after the ones already pending:
+ * if the writes of a frame are late, the next frame's are done at once
+ */
+static int wait_frame_start(int fd, uint32_t *sequence, unsigned int *behind)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLPRI };
+	struct v4l2_event ev;
+	int ret;
+
+	ret = poll(&pfd, 1, TIMEOUT_MS);
+	if (ret <= 0) {
+		fprintf(stderr, "%s\n", ret ? strerror(errno) :
+			"no frame start, is the CIO2 streaming?");
+		return -1;
+	}
+
+	*behind = 0;
+	do {
+		if (xioctl(fd, VIDIOC_DQEVENT, &ev)) {
+			perror("VIDIOC_DQEVENT");
+			return -1;
+		}
+		if (ev.type != V4L2_EVENT_FRAME_SYNC)
+			continue;
+		if (*behind || ev.pending)
+			(*behind)++;
+		*sequence = ev.u.frame_sync.frame_sequence;
+	} while (ev.pending);
+
+	return 0;
+}
+
+/* A frame start already pending: the writes may have missed their frame */
+static int frame_start_pending(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLPRI };
+
+	return poll(&pfd, 1, 0) > 0;
+}
+
+static void print_setting(uint32_t sequence, const struct ctrlq_setting *s)
+{
+	printf("frame %6u: exposure %5d gain %4d vblank %5d", sequence,
+	       s->val[CTRLQ_EXPOSURE], s->val[CTRLQ_GAIN],
+	       s->val[CTRLQ_VBLANK]);
+}
+
+static int run(const char *subdev, const char *events, const char *path,
+	       const struct ctrlq_config *cfg, unsigned int frames,
+	       int verbose)
+{
+	struct v4l2_event_subscription sub = {
+		.type = V4L2_EVENT_FRAME_SYNC,
+	};
+	struct script sc = { 0 };
+	struct ctrlq_setting cur, out, s;
+	unsigned int i, behind, late = 0;
+	uint32_t sequence = 0, first = 0;
+	struct ctrlq q;
+	int sfd, efd, ret = -1;
+
+	sfd = open(subdev, O_RDWR);
+	if (sfd < 0) {
+		perror(subdev);
+		return -1;
+	}
+
+	efd = open(events, O_RDWR | O_NONBLOCK);
+	if (efd < 0) {
+		perror(events);
+		close(sfd);
+		return -1;
+	}
+
+	if (xioctl(efd, VIDIOC_SUBSCRIBE_EVENT, &sub)) {
+		fprintf(stderr, "%s: V4L2_EVENT_FRAME_SYNC: %s\n", events,
+			strerror(errno));
+		goto out;
+	}
+
+	if (get_setting(sfd, &cur))
+		goto out;
+
+	if (path ? read_script(path, &sc) : default_script(&sc, &cur, frames))
+		goto out;
+
+	ctrlq_init(&q, cfg, &cur);
+
+	for (i = 0; !frames || i < frames; i++) {
+		unsigned int mask;
+
+		if (wait_frame_start(efd, &sequence, &behind))
+			goto out;
+		if (!i) {
+			/* the script counts from the first frame start */
+			first = sequence;
+			queue_script(&q, &sc, first);
+		}
+
+		mask = ctrlq_frame_start(&q, sequence, &out);
+		if (mask && set_setting(sfd, &out, mask))
+			goto out;
+		if (mask && frame_start_pending(efd)) {
+			fprintf(stderr,
+				"frame %u: written after the next frame start\n",
+				sequence);
+			late++;
+		}
+
+		queue_script(&q, &sc, first);
+
+		if (ctrlq_applied(&q, sequence, &s))
+			continue;
+		print_setting(sequence, &s);
+		if (verbose && mask) {
+			printf(", set");
+			if (mask & 1 << CTRLQ_VBLANK)
+				printf(" vblank %d", out.val[CTRLQ_VBLANK]);
+			if (mask & EXPOSURE_GAIN)
+				printf(" exposure %d gain %d",
+				       out.val[CTRLQ_EXPOSURE],
+				       out.val[CTRLQ_GAIN]);
+		}
+		if (behind)
+			printf(", %u frame starts behind", behind);
+		printf("\n");
+		fflush(stdout);
+	}
+
+	printf("%u frame starts missed, %u writes late, VBLANK early %u times\n",
+	       q.skipped, late, q.early);
+	ret = 0;
+
+out:
+	free(sc.entries);
+	close(efd);
+	close(sfd);
+	return ret;
+}
+
+/*
+ * Self-test: a sensor whose controls land @delay frames after the frame
+ * they are written in, and a driver which clamps the exposure to the
+ * frame length
+ */
+#define SIM_FRAMES		2000
+#define SIM_HEIGHT		1000
+#define SIM_MARGIN		8
+/* frames are checked this many frames later, once the queue knows them */
+#define SIM_LAG			16
+#define SIM_RUN			(SIM_FRAMES + SIM_LAG)
+
+struct sim {
+	unsigned int delay[CTRLQ_NUM_CTRLS];
+	struct ctrlq_setting ctrl;	/* the controls of the driver */
+	/* what each frame is taken with */
+	struct ctrlq_setting taken[SIM_RUN + CTRLQ_DEPTH];
+	unsigned int clamped;
+};
+
+static int32_t sim_exposure_max(int32_t vblank)
+{
+	return SIM_HEIGHT + vblank - SIM_MARGIN;
+}
+
+static void sim_set_vblank(struct sim *sim, int32_t vblank)
+{
+	int32_t max = sim_exposure_max(vblank);
+
+	sim->ctrl.val[CTRLQ_VBLANK] = vblank;
+	/* __v4l2_ctrl_modify_range() of the exposure */
+	if (sim->ctrl.val[CTRLQ_EXPOSURE] > max) {
+		sim->ctrl.val[CTRLQ_EXPOSURE] = max;
+		sim->clamped++;
+	}
+}
+
+static void sim_set(struct sim *sim, const struct ctrlq_setting *s,
+		    unsigned int mask)
+{
+	if (mask & CTRLQ_VBLANK_FIRST)
+		sim_set_vblank(sim, s->val[CTRLQ_VBLANK]);
+
+	if (mask & EXPOSURE_GAIN) {
+		int32_t max = sim_exposure_max(sim->ctrl.val[CTRLQ_VBLANK]);
+
+		sim->ctrl.val[CTRLQ_EXPOSURE] = s->val[CTRLQ_EXPOSURE];
+		if (s->val[CTRLQ_EXPOSURE] > max) {
+			sim->ctrl.val[CTRLQ_EXPOSURE] = max;
+			sim->clamped++;
+		}
+		sim->ctrl.val[CTRLQ_GAIN] = s->val[CTRLQ_GAIN];
+	}
+
+	if (mask & 1 << CTRLQ_VBLANK && !(mask & CTRLQ_VBLANK_FIRST))
+		sim_set_vblank(sim, s->val[CTRLQ_VBLANK]);
+}
+
+/* Frame @f ends: what is written lands on the frames of the delays */
+static void sim_frame_end(struct sim *sim, unsigned int f)
+{
+	unsigned int c;
+
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++)
+		sim->taken[f + sim->delay[c]].val[c] = sim->ctrl.val[c];
+}
+
+static uint32_t rand_state = 1;
+
+static uint32_t sim_rand(void)
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+/* The last setting queued for frame @f or before it */
+static const struct ctrlq_setting *requested(const struct ctrlq_setting *req,
+					     const int *set, unsigned int f)
+{
+	while (f && !set[f])
+		f--;
+	return &req[f];
+}
+
+struct test {
+	struct ctrlq_setting req[SIM_RUN + 2 * CTRLQ_DEPTH];
+	int set[SIM_RUN + 2 * CTRLQ_DEPTH];
+	int seen[SIM_RUN];
+	unsigned int checked, exact, early, lost, wrong;
+};
+
+/* Frame @f is taken: check it against the sensor and what was queued */
+static void check_frame(struct test *t, const struct ctrlq *q,
+			const struct sim *sim, unsigned int f, int verbose)
+{
+	const struct ctrlq_setting *r = requested(t->req, t->set, f);
+	unsigned int de = q->cfg.delay[CTRLQ_EXPOSURE];
+	unsigned int dv = q->cfg.delay[CTRLQ_VBLANK];
+	struct ctrlq_setting s;
+	int32_t vblank;
+	unsigned int c;
+
+	/* the queue has to know what each frame was taken with */
+	if (ctrlq_applied(q, f, &s))
+		return;
+	t->checked++;
+	if (memcmp(&s, &sim->taken[f], sizeof(s))) {
+		fprintf(stderr, "frame %u: taken with %d %d %d, the queue says %d %d %d\n",
+			f, sim->taken[f].val[0], sim->taken[f].val[1],
+			sim->taken[f].val[2], s.val[0], s.val[1], s.val[2]);
+		t->wrong++;
+		return;
+	}
+
+	/*
+	 * and to land each setting, when the frame starts were seen: a
+	 * frame whose writes were due on a lost frame start keeps the
+	 * controls of the frame before, which the queue knows
+	 */
+	for (c = 0; c < CTRLQ_NUM_CTRLS; c++) {
+		if (f < q->cfg.delay[c] || !t->seen[f - q->cfg.delay[c]]) {
+			t->lost++;
+			return;
+		}
+	}
+
+	/* a longer VBLANK of a later frame comes early */
+	vblank = r->val[CTRLQ_VBLANK];
+	if (dv < de &&
+	    requested(t->req, t->set, f + de - dv)->val[CTRLQ_VBLANK] > vblank) {
+		vblank = requested(t->req, t->set, f + de - dv)->val[CTRLQ_VBLANK];
+		t->early++;
+	}
+
+	if (s.val[CTRLQ_EXPOSURE] != r->val[CTRLQ_EXPOSURE] ||
+	    s.val[CTRLQ_GAIN] != r->val[CTRLQ_GAIN] ||
+	    s.val[CTRLQ_VBLANK] != vblank) {
+		fprintf(stderr, "frame %u: taken with %d %d %d, queued %d %d %d\n",
+			f, s.val[0], s.val[1], s.val[2], r->val[0], r->val[1],
+			vblank);
+		t->wrong++;
+		return;
+	}
+
+	t->exact++;
+	if (verbose) {
+		print_setting(f, &s);
+		printf("\n");
+	}
+}
+
+static int self_test(const struct ctrlq_config *cfg, int verbose)
+{
+	static struct test t;
+	static struct sim sim;
+	const struct ctrlq_setting init = { .val = { 800, 128, 100 } };
+	struct ctrlq_setting out, s;
+	struct ctrlq q;
+	unsigned int f;
+
+	ctrlq_init(&q, cfg, &init);
+	memcpy(sim.delay, q.cfg.delay, sizeof(sim.delay));
+	sim.ctrl = init;
+	for (f = 0; f < CTRLQ_DEPTH; f++)
+		sim.taken[f] = init;
+	t.req[0] = init;
+	t.set[0] = 1;
+
+	for (f = 0; f < SIM_RUN; f++) {
+		unsigned int mask;
+		uint32_t target;
+
+		/* one frame start in 20 is lost, after the first one */
+		t.seen[f] = !f || sim_rand() % 20;
+		if (t.seen[f]) {
+			mask = ctrlq_frame_start(&q, f, &out);
+			sim_set(&sim, &out, mask);
+		}
+
+		/*
+		 * A setting for a frame soon, now and then: the VBLANK up or
+		 * down, and an exposure within its range
+		 */
+		if (sim_rand() % 3 == 0) {
+			target = ctrlq_earliest(&q) + sim_rand() % 4;
+			s.val[CTRLQ_VBLANK] = sim_rand() % 4 ?
+				requested(t.req, t.set, target)->val[CTRLQ_VBLANK] :
+				(int32_t)(sim_rand() % 2000);
+			s.val[CTRLQ_EXPOSURE] = 2 + sim_rand() %
+				(sim_exposure_max(s.val[CTRLQ_VBLANK]) - 1);
+			s.val[CTRLQ_GAIN] = 128 + sim_rand() % 1920;
+			if (!ctrlq_queue(&q, target, &s)) {
+				t.req[target] = s;
+				t.set[target] = 1;
+			}
+		}
+
+		sim_frame_end(&sim, f);
+		if (f >= SIM_LAG)
+			check_frame(&t, &q, &sim, f - SIM_LAG, verbose);
+	}
+
+	printf("%u frames, %u frame starts lost: %u known, %u landed as queued (%u with a VBLANK early), %u due on a lost frame start, %u wrong, %u exposures clamped\n",
+	       SIM_FRAMES, q.skipped, t.checked, t.exact, t.early, t.lost,
+	       t.wrong, sim.clamped);
+
+	/* every frame not due on a lost frame start lands as queued */
+	return t.wrong || sim.clamped || t.checked < SIM_FRAMES ||
+	       t.exact + t.lost != t.checked ? 1 : 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -s <sensor subdev> -e <ipu3-csi2 subdev> [-f <script>]\n"
+		"          [-n <frames>] [-D <exposure>,<gain>,<vblank delays>] [-v]\n"
+		"       %s -T [-D <exposure>,<gain>,<vblank delays>] [-v]\n",
+		argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *subdev = NULL, *events = NULL, *script = NULL;
+	unsigned int frames = 0;
+	struct ctrlq_config cfg;
+	int test = 0, verbose = 0, c;
+
+	ctrlq_default_config(&cfg);
+
+	while ((c = getopt(argc, argv, "s:e:f:n:D:Tv")) != -1) {
+		switch (c) {
+		case 's':
+			subdev = optarg;
+			break;
+		case 'e':
+			events = optarg;
+			break;
+		case 'f':
+			script = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			if (sscanf(optarg, "%u,%u,%u",
+				   &cfg.delay[CTRLQ_EXPOSURE],
+				   &cfg.delay[CTRLQ_GAIN],
+				   &cfg.delay[CTRLQ_VBLANK]) != 3) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'T':
+			test = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (test)
+		return self_test(&cfg, verbose);
+
+	if (!subdev || !events) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* without a script, until the end of the default one */
+	if (!script && !frames)
+		frames = 64;
+
+	return run(subdev, events, script, &cfg, frames, verbose) ? 1 : 0;
+}
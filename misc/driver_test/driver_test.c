@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * This tool runs the sensor drivers of drivers/media/i2c in userspace, on
+ * the simulated I2C bus of kshim.c, and checks the register writes they
+ * make: probe, stream on and off, and the controls, with writes made to
+ * fail to go through the error paths.
+ */
+
+#include <unistd.h>
+#include "driver_test.h"
+
+unsigned int test_checks, test_failed;
+
+static const struct {
+	const char *name;
+	void (*run)(void);
+} tests[] = {
+	{ "ov7251", ov7251_test },
+	{ "ov8865", ov8865_test },
+	{ "ov5693", ov5693_test },
+};
+
+void test_check(bool ok, const char *file, int line, const char *fmt, ...)
+{
+	va_list ap;
+
+	test_checks++;
+	if (ok)
+		return;
+
+	test_failed++;
+	printf("%s:%d: ", file, line);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf("\n");
+}
+
+bool test_writes(unsigned int from, const struct kshim_write *expect,
+		 unsigned int count)
+{
+	unsigned int i;
+
+	if (kshim_bus.num_writes - from == count) {
+		for (i = 0; i < count; i++) {
+			if (kshim_bus.writes[from + i].reg != expect[i].reg ||
+			    kshim_bus.writes[from + i].val != expect[i].val)
+				break;
+		}
+		if (i == count)
+			return true;
+	}
+
+	printf("writes:\n");
+	kshim_print_writes(from);
+	printf("expected:\n");
+	for (i = 0; i < count; i++)
+		printf("         0x%04x = 0x%02x\n", expect[i].reg,
+		       expect[i].val);
+	return false;
+}
+
+unsigned int test_count_writes(u16 reg, unsigned int from)
+{
+	unsigned int n = 0;
+
+	while (kshim_find_write(reg, from, n) >= 0)
+		n++;
+
+	return n;
+}
+
+struct i2c_client *test_client(const char *name)
+{
+	static struct fwnode_handle node;
+	static struct i2c_adapter adapter;
+	struct i2c_client *client = calloc(1, sizeof(*client));
+
+	client->adapter = &adapter;
+	client->addr = 0x36;
+	snprintf(client->name, sizeof(client->name), "%s", name);
+	client->dev.name = client->name;
+	client->dev.fwnode = &node;
+	return client;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-v] [ov7251|ov8865|ov5693]...\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i, checks, failed;
+	int c, j;
+
+	while ((c = getopt(argc, argv, "v")) != -1) {
+		switch (c) {
+		case 'v':
+			kshim_verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	for (j = optind; j < argc; j++) {
+		for (i = 0; i < ARRAY_SIZE(tests); i++)
+			if (!strcmp(argv[j], tests[i].name))
+				break;
+		if (i == ARRAY_SIZE(tests)) {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		for (j = optind; j < argc; j++)
+			if (!strcmp(argv[j], tests[i].name))
+				break;
+		if (optind < argc && j == argc)
+			continue;
+
+		checks = test_checks;
+		failed = test_failed;
+		tests[i].run();
+		printf("%s: %u checks, %u failed\n", tests[i].name,
+		       test_checks - checks, test_failed - failed);
+	}
+
+	return test_failed ? 1 : 0;
+}
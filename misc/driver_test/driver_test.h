@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The tests of driver_test.c, one per driver, each built with the source
+ * of its driver included on the simulated bus of kshim.h.
+ */
+#ifndef DRIVER_TEST_H
+#define DRIVER_TEST_H
+
+#include "kshim.h"
+
+extern unsigned int test_checks, test_failed;
+
+void test_check(bool ok, const char *file, int line, const char *fmt, ...)
+	__attribute__((format(printf, 4, 5)));
+
+#define CHECK(cond, ...)						\
+	test_check(!!(cond), __FILE__, __LINE__, __VA_ARGS__)
+
+/* The writes from @from on are exactly @expect, print them if not */
+bool test_writes(unsigned int from, const struct kshim_write *expect,
+		 unsigned int count);
+
+/* The number of writes of @reg from @from on */
+unsigned int test_count_writes(u16 reg, unsigned int from);
+
+/* A client on the simulated bus, with the firmware node of kshim_fw */
+struct i2c_client *test_client(const char *name);
+
+void ov7251_test(void);
+void ov8865_test(void);
+void ov5693_test(void);
+
+#endif /* DRIVER_TEST_H */
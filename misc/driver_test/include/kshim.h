@@ -0,0 +1,950 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Just enough of the kernel API for the sensor drivers of
+ * drivers/media/i2c to build as userspace programs, with a simulated I2C
+ * bus (kshim.c) behind i2c_master_send(), i2c_master_recv() and
+ * i2c_transfer(). The control framework is a small one with the parts the
+ * drivers rely on: clusters, is_new, grabbing and the handler lock.
+ */
+#ifndef KSHIM_H
+#define KSHIM_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/types.h>
+#include <linux/media-bus-format.h>
+#include <linux/v4l2-subdev.h>
+#include <linux/videodev2.h>
+
+/*
+ * Compiler and helpers
+ */
+#define __init
+#define __exit
+#define __maybe_unused		__attribute__((unused))
+#define __always_unused		__attribute__((unused))
+#define __packed		__attribute__((packed))
+#define fallthrough		__attribute__((fallthrough))
+#define CONFIG_ACPI		1
+#define IS_ENABLED(option)	(option)
+
+#define WARN_ON(cond)		({					\
+	bool __c = !!(cond);						\
+	if (__c)							\
+		fprintf(stderr, "WARN_ON(%s) at %s:%d\n", #cond,	\
+			__FILE__, __LINE__);				\
+	__c;								\
+})
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define BIT(n)			(1UL << (n))
+#define GENMASK(h, l)		(((~0UL) << (l)) & (~0UL >> (63 - (h))))
+#define container_of(ptr, type, member)					\
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define max(a, b)		((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)		((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)		((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define clamp(v, lo, hi)	min(max(v, lo), hi)
+#define clamp_t(t, v, lo, hi)	min_t(t, max_t(t, v, lo), hi)
+#define clamp_val(v, lo, hi)	clamp(v, lo, hi)
+#define abs_diff(a, b)		((a) > (b) ? (a) - (b) : (b) - (a))
+
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define DIV_ROUND_CLOSEST(x, d)	(((x) + ((d) / 2)) / (d))
+#define ALIGN(x, a)		(((x) + (a) - 1) / (a) * (a))
+#define ALIGN_DOWN(x, a)	((x) / (a) * (a))
+#define rounddown(x, y)		((x) - ((x) % (y)))
+#define roundup(x, y)		DIV_ROUND_UP(x, y) * (y)
+
+#define EPROBE_DEFER		517
+
+#define MAX_ERRNO		4095
+#define IS_ERR_VALUE(x)		((unsigned long)(x) >= (unsigned long)-MAX_ERRNO)
+#define ERR_PTR(e)		((void *)(long)(e))
+#define PTR_ERR(p)		((long)(p))
+#define IS_ERR(p)		IS_ERR_VALUE(p)
+#define IS_ERR_OR_NULL(p)	(!(p) || IS_ERR(p))
+
+#define BITS_PER_LONG		64
+#define BITS_TO_LONGS(n)	DIV_ROUND_UP(n, BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits)	unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline void bitmap_zero(unsigned long *map, unsigned int bits)
+{
+	memset(map, 0, BITS_TO_LONGS(bits) * sizeof(unsigned long));
+}
+
+static inline void set_bit(unsigned int nr, unsigned long *map)
+{
+	map[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static inline void clear_bit(unsigned int nr, unsigned long *map)
+{
+	map[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+static inline bool test_bit(unsigned int nr, const unsigned long *map)
+{
+	return map[nr / BITS_PER_LONG] >> (nr % BITS_PER_LONG) & 1;
+}
+
+static inline size_t strscpy(char *dst, const char *src, size_t size)
+{
+	snprintf(dst, size, "%s", src);
+	return strlen(dst);
+}
+
+static inline void put_unaligned_be16(u16 val, void *p)
+{
+	u8 *b = p;
+
+	b[0] = val >> 8;
+	b[1] = val;
+}
+
+static inline u16 get_unaligned_be16(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] << 8 | b[1];
+}
+
+/*
+ * Modules
+ */
+#define MODULE_DEVICE_TABLE(type, name)
+#define MODULE_DESCRIPTION(s)
+#define MODULE_AUTHOR(s)
+#define MODULE_LICENSE(s)
+#define MODULE_FIRMWARE(s)
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+#define module_i2c_driver(drv)						\
+	static struct i2c_driver *kshim_driver __maybe_unused = &(drv)
+
+struct of_device_id {
+	char compatible[128];
+	const void *data;
+};
+
+struct acpi_device_id {
+	char id[16];
+	unsigned long driver_data;
+};
+
+struct i2c_device_id {
+	char name[20];
+	unsigned long driver_data;
+};
+
+/*
+ * Devices, logging
+ */
+struct fwnode_handle {
+	struct fwnode_handle *secondary;
+};
+
+struct device {
+	void *driver_data;
+	struct fwnode_handle *fwnode;
+	const char *name;
+};
+
+/* 1 to print the driver messages */
+extern int kshim_verbose;
+
+void kshim_log(const char *level, const struct device *dev,
+	       const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#define dev_err(dev, ...)	kshim_log("err", dev, __VA_ARGS__)
+#define dev_warn(dev, ...)	kshim_log("warn", dev, __VA_ARGS__)
+#define dev_info(dev, ...)	kshim_log("info", dev, __VA_ARGS__)
+#define dev_dbg(dev, ...)	kshim_log("dbg", dev, __VA_ARGS__)
+#define dev_err_probe(dev, err, ...)					\
+	({ kshim_log("err", dev, __VA_ARGS__); (int)(err); })
+
+static inline void *dev_get_drvdata(const struct device *dev)
+{
+	return dev->driver_data;
+}
+
+static inline struct fwnode_handle *dev_fwnode(struct device *dev)
+{
+	return dev->fwnode;
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, int flags);
+/* Free what devm_*() allocated, after the remove */
+void kshim_devres_release(void);
+#define GFP_KERNEL		0
+#define kzalloc(size, flags)	calloc(1, size)
+#define kmalloc(size, flags)	malloc(size)
+#define kcalloc(n, size, flags)	calloc(n, size)
+#define kfree(p)		free(p)
+
+/*
+ * Locking and sleeping, which returns at once
+ */
+struct mutex {
+	int locked;
+};
+
+static inline void mutex_init(struct mutex *m)
+{
+	m->locked = 0;
+}
+
+void mutex_lock(struct mutex *m);
+void mutex_unlock(struct mutex *m);
+
+static inline void mutex_destroy(struct mutex *m)
+{
+	(void)m;
+}
+
+#define lockdep_assert_held(m)	((void)(m))
+
+struct completion {
+	int done;
+};
+
+static inline void init_completion(struct completion *c)
+{
+	c->done = 0;
+}
+
+static inline void complete(struct completion *c)
+{
+	c->done = 1;
+}
+
+static inline void wait_for_completion(struct completion *c)
+{
+	(void)c;
+}
+
+static inline void usleep_range(unsigned long min_us, unsigned long max_us)
+{
+	(void)min_us;
+	(void)max_us;
+}
+
+static inline void msleep(unsigned int ms)
+{
+	(void)ms;
+}
+
+static inline void udelay(unsigned long us)
+{
+	(void)us;
+}
+
+/*
+ * I2C, on the simulated bus of kshim.c
+ */
+struct i2c_adapter {
+	int nr;
+};
+
+struct i2c_client {
+	struct device dev;
+	struct i2c_adapter *adapter;
+	unsigned short addr;
+	char name[20];
+};
+
+struct i2c_msg {
+	u16 addr;
+	u16 flags;
+	u16 len;
+	u8 *buf;
+};
+
+#define I2C_M_RD		0x0001
+
+int i2c_master_send(const struct i2c_client *client, const char *buf,
+		    int count);
+int i2c_master_recv(const struct i2c_client *client, char *buf, int count);
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num);
+
+#define to_i2c_client(d)	container_of(d, struct i2c_client, dev)
+
+static inline void *i2c_get_clientdata(const struct i2c_client *client)
+{
+	return client->dev.driver_data;
+}
+
+static inline void i2c_set_clientdata(struct i2c_client *client, void *data)
+{
+	client->dev.driver_data = data;
+}
+
+static inline struct i2c_client *i2c_verify_client(struct device *dev)
+{
+	return container_of(dev, struct i2c_client, dev);
+}
+
+struct dev_pm_ops {
+	int (*runtime_suspend)(struct device *dev);
+	int (*runtime_resume)(struct device *dev);
+	int (*runtime_idle)(struct device *dev);
+};
+
+#define SET_RUNTIME_PM_OPS(suspend, resume, idle)			\
+	.runtime_suspend = suspend,					\
+	.runtime_resume = resume,					\
+	.runtime_idle = idle,
+
+struct device_driver {
+	const char *name;
+	const struct of_device_id *of_match_table;
+	const struct acpi_device_id *acpi_match_table;
+	const struct dev_pm_ops *pm;
+};
+
+struct i2c_driver {
+	struct device_driver driver;
+	int (*probe_new)(struct i2c_client *client);
+	int (*remove)(struct i2c_client *client);
+	const struct i2c_device_id *id_table;
+};
+
+/*
+ * Power, clocks, GPIOs and firmware, which always work
+ */
+struct regulator {
+	int unused;
+};
+
+struct regulator_bulk_data {
+	const char *supply;
+	struct regulator *consumer;
+};
+
+struct regulator *devm_regulator_get(struct device *dev, const char *id);
+int devm_regulator_bulk_get(struct device *dev, int num,
+			    struct regulator_bulk_data *consumers);
+
+static inline int regulator_enable(struct regulator *r)
+{
+	(void)r;
+	return 0;
+}
+
+static inline int regulator_disable(struct regulator *r)
+{
+	(void)r;
+	return 0;
+}
+
+static inline int regulator_set_voltage(struct regulator *r, int min_uv,
+					int max_uv)
+{
+	(void)r;
+	(void)min_uv;
+	(void)max_uv;
+	return 0;
+}
+
+static inline int regulator_bulk_enable(int num,
+					struct regulator_bulk_data *consumers)
+{
+	(void)num;
+	(void)consumers;
+	return 0;
+}
+
+static inline int regulator_bulk_disable(int num,
+					 struct regulator_bulk_data *consumers)
+{
+	(void)num;
+	(void)consumers;
+	return 0;
+}
+
+struct clk {
+	unsigned long rate;
+};
+
+struct clk *devm_clk_get(struct device *dev, const char *id);
+struct clk *devm_clk_get_optional(struct device *dev, const char *id);
+
+static inline int clk_prepare_enable(struct clk *clk)
+{
+	(void)clk;
+	return 0;
+}
+
+static inline void clk_disable_unprepare(struct clk *clk)
+{
+	(void)clk;
+}
+
+static inline unsigned long clk_get_rate(struct clk *clk)
+{
+	return clk ? clk->rate : 0;
+}
+
+static inline int clk_set_rate(struct clk *clk, unsigned long rate)
+{
+	if (clk)
+		clk->rate = rate;
+	return 0;
+}
+
+struct gpio_desc {
+	int value;
+};
+
+enum gpiod_flags {
+	GPIOD_ASIS,
+	GPIOD_IN,
+	GPIOD_OUT_LOW,
+	GPIOD_OUT_HIGH,
+};
+
+struct gpio_desc *devm_gpiod_get(struct device *dev, const char *id,
+				 enum gpiod_flags flags);
+struct gpio_desc *devm_gpiod_get_optional(struct device *dev, const char *id,
+					  enum gpiod_flags flags);
+
+static inline void gpiod_set_value_cansleep(struct gpio_desc *desc, int value)
+{
+	if (desc)
+		desc->value = value;
+}
+
+struct firmware {
+	size_t size;
+	const u8 *data;
+};
+
+int request_firmware(const struct firmware **fw, const char *name,
+		     struct device *dev);
+int firmware_request_nowait_nowarn(void *module, const char *name,
+				   struct device *dev, int gfp, void *context,
+				   void (*cont)(const struct firmware *fw,
+						void *context));
+void release_firmware(const struct firmware *fw);
+
+#define THIS_MODULE		NULL
+
+/*
+ * Runtime PM: always enabled, the drivers power the sensor from s_stream
+ * or from the callbacks, which the tests call. The device is active
+ * unless kshim_pm_active is cleared: suspended, as the sensor is until it
+ * streams, the drivers take the controls without writing them
+ * (../sensor_sim).
+ */
+extern int kshim_pm_active;
+
+static inline int pm_runtime_get_sync(struct device *dev)
+{
+	(void)dev;
+	return 0;
+}
+
+static inline int pm_runtime_resume_and_get(struct device *dev)
+{
+	(void)dev;
+	return 0;
+}
+
+static inline int pm_runtime_get_if_in_use(struct device *dev)
+{
+	(void)dev;
+	return kshim_pm_active;
+}
+
+static inline int pm_runtime_suspended(struct device *dev)
+{
+	(void)dev;
+	return !kshim_pm_active;
+}
+
+static inline void pm_runtime_get_noresume(struct device *dev)
+{
+	(void)dev;
+}
+
+#define KSHIM_PM_VOID(name)						\
+	static inline void name(struct device *dev) { (void)dev; }
+#define KSHIM_PM_INT(name)						\
+	static inline int name(struct device *dev) { (void)dev; return 0; }
+
+KSHIM_PM_INT(pm_runtime_put)
+KSHIM_PM_INT(pm_runtime_put_sync)
+KSHIM_PM_INT(pm_runtime_put_autosuspend)
+KSHIM_PM_INT(pm_runtime_set_active)
+KSHIM_PM_INT(pm_runtime_status_suspended)
+KSHIM_PM_VOID(pm_runtime_put_noidle)
+KSHIM_PM_VOID(pm_runtime_enable)
+KSHIM_PM_VOID(pm_runtime_disable)
+KSHIM_PM_VOID(pm_runtime_set_suspended)
+KSHIM_PM_VOID(pm_runtime_use_autosuspend)
+KSHIM_PM_VOID(pm_runtime_dont_use_autosuspend)
+KSHIM_PM_VOID(pm_runtime_mark_last_busy)
+
+static inline bool pm_runtime_enabled(struct device *dev)
+{
+	(void)dev;
+	return true;
+}
+
+static inline void pm_runtime_set_autosuspend_delay(struct device *dev,
+						    int delay)
+{
+	(void)dev;
+	(void)delay;
+}
+
+/*
+ * ACPI, which the tests don't run, and the firmware description: one
+ * device node with one endpoint, as the tests set it in kshim_fw
+ */
+typedef void *acpi_handle;
+typedef u32 acpi_status;
+
+#define ACPI_HANDLE(dev)	((acpi_handle)NULL)
+#define ACPI_FAILURE(s)		((s) != 0)
+#define ACPI_SUCCESS(s)		((s) == 0)
+#define ACPI_ALLOCATE_BUFFER	((size_t)-1)
+#define ACPI_TYPE_STRING	2
+#define ACPI_TYPE_BUFFER	3
+#define ACPI_PTR(p)		(p)
+#define ACPI_FREE(p)		free(p)
+
+union acpi_object {
+	u32 type;
+	struct {
+		u32 type;
+		u32 length;
+		char *pointer;
+	} string;
+	struct {
+		u32 type;
+		u32 length;
+		u8 *pointer;
+	} buffer;
+};
+
+struct acpi_buffer {
+	size_t length;
+	void *pointer;
+};
+
+static inline acpi_status acpi_evaluate_object(acpi_handle handle,
+					       const char *path, void *args,
+					       struct acpi_buffer *buf)
+{
+	(void)handle;
+	(void)path;
+	(void)args;
+	(void)buf;
+	return 1;
+}
+
+struct fwnode_handle *fwnode_graph_get_next_endpoint(
+	const struct fwnode_handle *fwnode, struct fwnode_handle *prev);
+int fwnode_property_read_u32(const struct fwnode_handle *fwnode,
+			     const char *propname, u32 *val);
+
+static inline void fwnode_handle_put(struct fwnode_handle *fwnode)
+{
+	(void)fwnode;
+}
+
+/*
+ * Media controller
+ */
+#define MEDIA_PAD_FL_SINK		BIT(0)
+#define MEDIA_PAD_FL_SOURCE		BIT(1)
+#define MEDIA_ENT_F_CAM_SENSOR		0x00020001
+
+struct media_pad {
+	unsigned long flags;
+};
+
+struct media_entity_operations {
+	int (*link_validate)(void *link);
+};
+
+struct media_entity {
+	u32 function;
+	const struct media_entity_operations *ops;
+	u16 num_pads;
+	struct media_pad *pads;
+};
+
+static inline int media_entity_pads_init(struct media_entity *entity,
+					 u16 num_pads, struct media_pad *pads)
+{
+	entity->num_pads = num_pads;
+	entity->pads = pads;
+	return 0;
+}
+
+static inline void media_entity_cleanup(struct media_entity *entity)
+{
+	(void)entity;
+}
+
+/*
+ * Controls
+ */
+struct v4l2_ctrl;
+struct v4l2_ctrl_handler;
+
+struct v4l2_ctrl_ops {
+	int (*g_volatile_ctrl)(struct v4l2_ctrl *ctrl);
+	int (*try_ctrl)(struct v4l2_ctrl *ctrl);
+	int (*s_ctrl)(struct v4l2_ctrl *ctrl);
+};
+
+struct v4l2_ctrl {
+	struct v4l2_ctrl_handler *handler;
+	struct v4l2_ctrl **cluster;
+	unsigned int ncontrols;
+	unsigned int is_new:1;
+	unsigned int done:1;
+	const struct v4l2_ctrl_ops *ops;
+	u32 id;
+	const char *name;
+	enum v4l2_ctrl_type type;
+	s64 minimum, maximum, default_value;
+	u64 step;
+	u32 flags;
+	const char * const *qmenu;
+	const s64 *qmenu_int;
+	void *priv;
+	union {
+		s32 val;
+		s64 val64;
+	};
+	union {
+		s32 val;
+		s64 val64;
+	} cur;
+	struct v4l2_ctrl *next;
+	struct v4l2_ctrl *self;		/* the cluster of a control alone */
+};
+
+struct v4l2_ctrl_handler {
+	struct mutex _lock;
+	struct mutex *lock;
+	struct v4l2_ctrl *first;
+	int error;
+};
+
+struct v4l2_ctrl_config {
+	const struct v4l2_ctrl_ops *ops;
+	u32 id;
+	const char *name;
+	enum v4l2_ctrl_type type;
+	s64 min;
+	s64 max;
+	u64 step;
+	s64 def;
+	u32 dims[4];
+	u32 elem_size;
+	u32 flags;
+	u64 menu_skip_mask;
+	const char * const *qmenu;
+	const s64 *qmenu_int;
+	unsigned int is_private:1;
+};
+
+struct v4l2_fwnode_device_properties {
+	u32 orientation;
+	u32 rotation;
+};
+
+int v4l2_ctrl_handler_init(struct v4l2_ctrl_handler *hdl,
+			   unsigned int nr_of_controls_hint);
+void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl);
+int v4l2_ctrl_handler_setup(struct v4l2_ctrl_handler *hdl);
+int __v4l2_ctrl_handler_setup(struct v4l2_ctrl_handler *hdl);
+
+struct v4l2_ctrl *v4l2_ctrl_new_std(struct v4l2_ctrl_handler *hdl,
+				    const struct v4l2_ctrl_ops *ops, u32 id,
+				    s64 min, s64 max, u64 step, s64 def);
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu(struct v4l2_ctrl_handler *hdl,
+					 const struct v4l2_ctrl_ops *ops,
+					 u32 id, u8 max, u64 mask, u8 def);
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu_items(struct v4l2_ctrl_handler *hdl,
+					       const struct v4l2_ctrl_ops *ops,
+					       u32 id, u8 max, u64 mask, u8 def,
+					       const char * const *qmenu);
+struct v4l2_ctrl *v4l2_ctrl_new_int_menu(struct v4l2_ctrl_handler *hdl,
+					 const struct v4l2_ctrl_ops *ops,
+					 u32 id, u8 max, u8 def,
+					 const s64 *qmenu_int);
+struct v4l2_ctrl *v4l2_ctrl_new_custom(struct v4l2_ctrl_handler *hdl,
+				       const struct v4l2_ctrl_config *cfg,
+				       void *priv);
+int v4l2_ctrl_new_fwnode_properties(struct v4l2_ctrl_handler *hdl,
+				    const struct v4l2_ctrl_ops *ctrl_ops,
+				    const struct v4l2_fwnode_device_properties *p);
+void v4l2_ctrl_cluster(unsigned int ncontrols, struct v4l2_ctrl **controls);
+struct v4l2_ctrl *v4l2_ctrl_find(struct v4l2_ctrl_handler *hdl, u32 id);
+
+int __v4l2_ctrl_s_ctrl(struct v4l2_ctrl *ctrl, s32 val);
+int __v4l2_ctrl_s_ctrl_int64(struct v4l2_ctrl *ctrl, s64 val);
+int __v4l2_ctrl_modify_range(struct v4l2_ctrl *ctrl, s64 min, s64 max,
+			     u64 step, s64 def);
+void __v4l2_ctrl_grab(struct v4l2_ctrl *ctrl, bool grabbed);
+
+static inline void v4l2_ctrl_lock(struct v4l2_ctrl *ctrl)
+{
+	mutex_lock(ctrl->handler->lock);
+}
+
+static inline void v4l2_ctrl_unlock(struct v4l2_ctrl *ctrl)
+{
+	mutex_unlock(ctrl->handler->lock);
+}
+
+static inline s32 v4l2_ctrl_g_ctrl(struct v4l2_ctrl *ctrl)
+{
+	return ctrl->val;
+}
+
+static inline int v4l2_ctrl_s_ctrl(struct v4l2_ctrl *ctrl, s32 val)
+{
+	int ret;
+
+	v4l2_ctrl_lock(ctrl);
+	ret = __v4l2_ctrl_s_ctrl(ctrl, val);
+	v4l2_ctrl_unlock(ctrl);
+	return ret;
+}
+
+/* VIDIOC_S_CTRL, or VIDIOC_S_EXT_CTRLS with @count controls */
+int kshim_s_ctrls(struct v4l2_ctrl_handler *hdl, unsigned int count,
+		  const u32 *ids, const s32 *vals);
+
+static inline int kshim_s_ctrl(struct v4l2_ctrl_handler *hdl, u32 id, s32 val)
+{
+	return kshim_s_ctrls(hdl, 1, &id, &val);
+}
+
+/*
+ * Subdevs
+ */
+#define V4L2_SUBDEV_FL_HAS_DEVNODE	BIT(2)
+#define V4L2_SUBDEV_FL_HAS_EVENTS	BIT(3)
+
+struct v4l2_subdev;
+
+struct v4l2_subdev_pad_config {
+	struct v4l2_mbus_framefmt try_fmt;
+	struct v4l2_rect try_crop;
+};
+
+struct v4l2_subdev_state {
+	struct v4l2_subdev_pad_config *pads;
+};
+
+struct v4l2_subdev_core_ops {
+	int (*s_power)(struct v4l2_subdev *sd, int on);
+};
+
+struct v4l2_subdev_video_ops {
+	int (*s_stream)(struct v4l2_subdev *sd, int enable);
+	int (*g_frame_interval)(struct v4l2_subdev *sd,
+				struct v4l2_subdev_frame_interval *interval);
+	int (*s_frame_interval)(struct v4l2_subdev *sd,
+				struct v4l2_subdev_frame_interval *interval);
+};
+
+struct v4l2_subdev_pad_ops {
+	int (*init_cfg)(struct v4l2_subdev *sd,
+			struct v4l2_subdev_state *state);
+	int (*enum_mbus_code)(struct v4l2_subdev *sd,
+			      struct v4l2_subdev_state *state,
+			      struct v4l2_subdev_mbus_code_enum *code);
+	int (*enum_frame_size)(struct v4l2_subdev *sd,
+			       struct v4l2_subdev_state *state,
+			       struct v4l2_subdev_frame_size_enum *fse);
+	int (*enum_frame_interval)(struct v4l2_subdev *sd,
+				   struct v4l2_subdev_state *state,
+				   struct v4l2_subdev_frame_interval_enum *fie);
+	int (*get_fmt)(struct v4l2_subdev *sd, struct v4l2_subdev_state *state,
+		       struct v4l2_subdev_format *format);
+	int (*set_fmt)(struct v4l2_subdev *sd, struct v4l2_subdev_state *state,
+		       struct v4l2_subdev_format *format);
+	int (*get_selection)(struct v4l2_subdev *sd,
+			     struct v4l2_subdev_state *state,
+			     struct v4l2_subdev_selection *sel);
+	int (*set_selection)(struct v4l2_subdev *sd,
+			     struct v4l2_subdev_state *state,
+			     struct v4l2_subdev_selection *sel);
+};
+
+struct v4l2_subdev_ops {
+	const struct v4l2_subdev_core_ops *core;
+	const struct v4l2_subdev_video_ops *video;
+	const struct v4l2_subdev_pad_ops *pad;
+};
+
+struct v4l2_subdev_internal_ops {
+	int (*open)(struct v4l2_subdev *sd, void *fh);
+};
+
+struct v4l2_subdev {
+	struct media_entity entity;
+	const struct v4l2_subdev_ops *ops;
+	const struct v4l2_subdev_internal_ops *internal_ops;
+	struct v4l2_ctrl_handler *ctrl_handler;
+	struct device *dev;
+	struct fwnode_handle *fwnode;
+	u32 flags;
+	char name[32];
+};
+
+void v4l2_i2c_subdev_init(struct v4l2_subdev *sd, struct i2c_client *client,
+			  const struct v4l2_subdev_ops *ops);
+
+static inline int v4l2_async_register_subdev(struct v4l2_subdev *sd)
+{
+	(void)sd;
+	return 0;
+}
+
+static inline int v4l2_async_register_subdev_sensor(struct v4l2_subdev *sd)
+{
+	(void)sd;
+	return 0;
+}
+
+static inline void v4l2_async_unregister_subdev(struct v4l2_subdev *sd)
+{
+	(void)sd;
+}
+
+static inline struct v4l2_mbus_framefmt *
+v4l2_subdev_get_try_format(struct v4l2_subdev *sd,
+			   struct v4l2_subdev_state *state, unsigned int pad)
+{
+	(void)sd;
+	return &state->pads[pad].try_fmt;
+}
+
+static inline struct v4l2_rect *
+v4l2_subdev_get_try_crop(struct v4l2_subdev *sd,
+			 struct v4l2_subdev_state *state, unsigned int pad)
+{
+	(void)sd;
+	return &state->pads[pad].try_crop;
+}
+
+#define v4l2_find_nearest_size(array, array_size, width_field,		\
+			       height_field, width, height)		\
+	({								\
+		typeof(&(array)[0]) __nearest = NULL;			\
+		unsigned int __best = UINT_MAX, __err, __i;		\
+		for (__i = 0; __i < (array_size); __i++) {		\
+			__err = abs_diff((array)[__i].width_field,	\
+					 (unsigned int)(width)) +	\
+				abs_diff((array)[__i].height_field,	\
+					 (unsigned int)(height));	\
+			if (__err < __best) {				\
+				__best = __err;				\
+				__nearest = &(array)[__i];		\
+			}						\
+		}							\
+		__nearest;						\
+	})
+
+/*
+ * Firmware description of the endpoint
+ */
+enum v4l2_mbus_type {
+	V4L2_MBUS_UNKNOWN,
+	V4L2_MBUS_PARALLEL,
+	V4L2_MBUS_BT656,
+	V4L2_MBUS_CSI1,
+	V4L2_MBUS_CCP2,
+	V4L2_MBUS_CSI2_DPHY,
+	V4L2_MBUS_CSI2_CPHY,
+};
+
+#define V4L2_MBUS_CSI2_MAX_DATA_LANES	8
+
+struct v4l2_fwnode_bus_mipi_csi2 {
+	unsigned int flags;
+	unsigned char data_lanes[V4L2_MBUS_CSI2_MAX_DATA_LANES];
+	unsigned char clock_lane;
+	unsigned char num_data_lanes;
+};
+
+struct v4l2_fwnode_endpoint {
+	enum v4l2_mbus_type bus_type;
+	struct {
+		struct v4l2_fwnode_bus_mipi_csi2 mipi_csi2;
+	} bus;
+	u64 *link_frequencies;
+	unsigned int nr_of_link_frequencies;
+};
+
+int v4l2_fwnode_endpoint_parse(struct fwnode_handle *fwnode,
+			       struct v4l2_fwnode_endpoint *vep);
+int v4l2_fwnode_endpoint_alloc_parse(struct fwnode_handle *fwnode,
+				     struct v4l2_fwnode_endpoint *vep);
+void v4l2_fwnode_endpoint_free(struct v4l2_fwnode_endpoint *vep);
+int v4l2_fwnode_device_parse(struct device *dev,
+			     struct v4l2_fwnode_device_properties *props);
+
+struct kshim_firmware {
+	enum v4l2_mbus_type bus_type;
+	unsigned int num_data_lanes;
+	u64 link_frequencies[4];
+	unsigned int nr_of_link_frequencies;
+	u32 clock_frequency;		/* the property, 0 for none */
+	unsigned long clk_rate;		/* of the clock before it is set */
+	const struct firmware *file;	/* for any request, NULL for none */
+};
+
+extern struct kshim_firmware kshim_fw;
+
+/*
+ * The simulated bus, of one device with 16-bit register addresses
+ */
+#define KSHIM_MAX_WRITES	65536
+
+struct kshim_write {
+	u16 reg;
+	u8 val;
+};
+
+struct kshim_bus {
+	u8 regs[65536];
+	/* every register written, in order, one per byte */
+	struct kshim_write writes[KSHIM_MAX_WRITES];
+	unsigned int num_writes;
+	/* fail the transfer that would write @fail_reg, 0 for none */
+	u16 fail_reg;
+	unsigned int fail_count;	/* how many times, then succeed */
+	u16 pointer;
+};
+
+extern struct kshim_bus kshim_bus;
+
+void kshim_bus_reset(void);
+/* The index of the @n-th write of @reg after @from, or -1 */
+int kshim_find_write(u16 reg, unsigned int from, unsigned int n);
+void kshim_print_writes(unsigned int from);
+
+#endif /* KSHIM_H */
@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef KSHIM_V4L2_IMAGE_SIZES_H
+#define KSHIM_V4L2_IMAGE_SIZES_H
+
+#define CIF_WIDTH	352
+#define CIF_HEIGHT	288
+#define QCIF_WIDTH	176
+#define QCIF_HEIGHT	144
+#define QVGA_WIDTH	320
+#define QVGA_HEIGHT	240
+#define VGA_WIDTH	640
+#define VGA_HEIGHT	480
+#define SVGA_WIDTH	800
+#define SVGA_HEIGHT	600
+#define XGA_WIDTH	1024
+#define XGA_HEIGHT	768
+#define SXGA_WIDTH	1280
+#define SXGA_HEIGHT	1024
+#define UXGA_WIDTH	1600
+#define UXGA_HEIGHT	1200
+
+#endif /* KSHIM_V4L2_IMAGE_SIZES_H */
@@ -0,0 +1,754 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * The kernel API of kshim.h: a simulated I2C bus with one device of 16-bit
+ * register addresses, which logs every register written, and a small
+ * control framework.
+ */
+#include "kshim.h"
+
+int kshim_verbose;
+int kshim_pm_active = 1;
+struct kshim_bus kshim_bus;
+struct kshim_firmware kshim_fw;
+
+static struct fwnode_handle kshim_endpoint;
+
+void kshim_log(const char *level, const struct device *dev,
+	       const char *fmt, ...)
+{
+	va_list ap;
+
+	(void)dev;
+	if (!kshim_verbose)
+		return;
+
+	fprintf(stderr, "[%s] ", level);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
+
+/*
+ * Memory and locks
+ */
+/* devres, of all the devices at once */
+struct kshim_devres {
+	struct kshim_devres *next;
+	max_align_t data[];
+};
+
+static struct kshim_devres *kshim_devres;
+
+void *devm_kzalloc(struct device *dev, size_t size, int flags)
+{
+	struct kshim_devres *res = calloc(1, sizeof(*res) + size);
+
+	(void)dev;
+	(void)flags;
+	if (!res)
+		return NULL;
+
+	res->next = kshim_devres;
+	kshim_devres = res;
+	return res->data;
+}
+
+void kshim_devres_release(void)
+{
+	struct kshim_devres *res;
+
+	while (kshim_devres) {
+		res = kshim_devres;
+		kshim_devres = res->next;
+		free(res);
+	}
+}
+
+void mutex_lock(struct mutex *m)
+{
+	if (m->locked) {
+		fprintf(stderr, "kshim: mutex %p locked twice\n", (void *)m);
+		abort();
+	}
+	m->locked = 1;
+}
+
+void mutex_unlock(struct mutex *m)
+{
+	if (!m->locked) {
+		fprintf(stderr, "kshim: mutex %p not locked\n", (void *)m);
+		abort();
+	}
+	m->locked = 0;
+}
+
+/*
+ * Clocks, regulators, GPIOs, firmware and firmware nodes
+ */
+struct clk *devm_clk_get(struct device *dev, const char *id)
+{
+	struct clk *clk = devm_kzalloc(dev, sizeof(*clk), GFP_KERNEL);
+
+	(void)id;
+	clk->rate = kshim_fw.clk_rate;
+	return clk;
+}
+
+struct clk *devm_clk_get_optional(struct device *dev, const char *id)
+{
+	return devm_clk_get(dev, id);
+}
+
+struct regulator *devm_regulator_get(struct device *dev, const char *id)
+{
+	(void)id;
+	return devm_kzalloc(dev, sizeof(struct regulator), GFP_KERNEL);
+}
+
+int devm_regulator_bulk_get(struct device *dev, int num,
+			    struct regulator_bulk_data *consumers)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		consumers[i].consumer = devm_regulator_get(dev,
+							   consumers[i].supply);
+	return 0;
+}
+
+struct gpio_desc *devm_gpiod_get(struct device *dev, const char *id,
+				 enum gpiod_flags flags)
+{
+	struct gpio_desc *desc = devm_kzalloc(dev, sizeof(*desc), GFP_KERNEL);
+
+	(void)id;
+	desc->value = flags == GPIOD_OUT_HIGH;
+	return desc;
+}
+
+struct gpio_desc *devm_gpiod_get_optional(struct device *dev, const char *id,
+					  enum gpiod_flags flags)
+{
+	return devm_gpiod_get(dev, id, flags);
+}
+
+int request_firmware(const struct firmware **fw, const char *name,
+		     struct device *dev)
+{
+	(void)name;
+	(void)dev;
+	*fw = NULL;
+	return -ENOENT;
+}
+
+int firmware_request_nowait_nowarn(void *module, const char *name,
+				   struct device *dev, int gfp, void *context,
+				   void (*cont)(const struct firmware *fw,
+						void *context))
+{
+	(void)module;
+	(void)name;
+	(void)dev;
+	(void)gfp;
+	cont(kshim_fw.file, context);
+	return 0;
+}
+
+void release_firmware(const struct firmware *fw)
+{
+	(void)fw;
+}
+
+struct fwnode_handle *fwnode_graph_get_next_endpoint(
+	const struct fwnode_handle *fwnode, struct fwnode_handle *prev)
+{
+	if (!fwnode || fwnode == &kshim_endpoint || prev)
+		return NULL;
+
+	return &kshim_endpoint;
+}
+
+int fwnode_property_read_u32(const struct fwnode_handle *fwnode,
+			     const char *propname, u32 *val)
+{
+	if (!fwnode || strcmp(propname, "clock-frequency") ||
+	    !kshim_fw.clock_frequency)
+		return -EINVAL;
+
+	*val = kshim_fw.clock_frequency;
+	return 0;
+}
+
+int v4l2_fwnode_endpoint_parse(struct fwnode_handle *fwnode,
+			       struct v4l2_fwnode_endpoint *vep)
+{
+	unsigned int i;
+
+	if (fwnode != &kshim_endpoint)
+		return -ENXIO;
+
+	vep->bus_type = kshim_fw.bus_type;
+	vep->bus.mipi_csi2.num_data_lanes = kshim_fw.num_data_lanes;
+	for (i = 0; i < kshim_fw.num_data_lanes; i++)
+		vep->bus.mipi_csi2.data_lanes[i] = i + 1;
+	return 0;
+}
+
+int v4l2_fwnode_endpoint_alloc_parse(struct fwnode_handle *fwnode,
+				     struct v4l2_fwnode_endpoint *vep)
+{
+	int ret = v4l2_fwnode_endpoint_parse(fwnode, vep);
+
+	if (ret)
+		return ret;
+
+	vep->nr_of_link_frequencies = kshim_fw.nr_of_link_frequencies;
+	vep->link_frequencies = kcalloc(kshim_fw.nr_of_link_frequencies + 1,
+					sizeof(u64), GFP_KERNEL);
+	memcpy(vep->link_frequencies, kshim_fw.link_frequencies,
+	       kshim_fw.nr_of_link_frequencies * sizeof(u64));
+	return 0;
+}
+
+void v4l2_fwnode_endpoint_free(struct v4l2_fwnode_endpoint *vep)
+{
+	kfree(vep->link_frequencies);
+	vep->link_frequencies = NULL;
+	vep->nr_of_link_frequencies = 0;
+}
+
+int v4l2_fwnode_device_parse(struct device *dev,
+			     struct v4l2_fwnode_device_properties *props)
+{
+	(void)dev;
+	memset(props, 0, sizeof(*props));
+	return 0;
+}
+
+void v4l2_i2c_subdev_init(struct v4l2_subdev *sd, struct i2c_client *client,
+			  const struct v4l2_subdev_ops *ops)
+{
+	sd->ops = ops;
+	sd->dev = &client->dev;
+	snprintf(sd->name, sizeof(sd->name), "%s", client->name);
+	client->dev.driver_data = sd;
+}
+
+/*
+ * The I2C bus: a write of 2 bytes sets the register pointer, of more
+ * writes from there on, a read reads from the pointer, both increment it
+ */
+void kshim_bus_reset(void)
+{
+	memset(&kshim_bus, 0, sizeof(kshim_bus));
+}
+
+static bool kshim_bus_write(const u8 *buf, int count)
+{
+	u16 reg;
+	int i;
+
+	if (count < 2)
+		return false;
+
+	reg = get_unaligned_be16(buf);
+	for (i = 2; i < count; i++) {
+		if (kshim_bus.fail_count &&
+		    kshim_bus.fail_reg == (u16)(reg + i - 2)) {
+			kshim_bus.fail_count--;
+			return false;
+		}
+	}
+
+	kshim_bus.pointer = reg;
+	for (i = 2; i < count; i++) {
+		kshim_bus.regs[kshim_bus.pointer] = buf[i];
+		if (kshim_bus.num_writes < KSHIM_MAX_WRITES) {
+			kshim_bus.writes[kshim_bus.num_writes].reg =
+				kshim_bus.pointer;
+			kshim_bus.writes[kshim_bus.num_writes].val = buf[i];
+			kshim_bus.num_writes++;
+		}
+		kshim_bus.pointer++;
+	}
+
+	return true;
+}
+
+static void kshim_bus_read(u8 *buf, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		buf[i] = kshim_bus.regs[kshim_bus.pointer++];
+}
+
+int i2c_master_send(const struct i2c_client *client, const char *buf,
+		    int count)
+{
+	(void)client;
+	if (!kshim_bus_write((const u8 *)buf, count))
+		return -EIO;
+
+	return count;
+}
+
+int i2c_master_recv(const struct i2c_client *client, char *buf, int count)
+{
+	(void)client;
+	kshim_bus_read((u8 *)buf, count);
+	return count;
+}
+
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	int i;
+
+	(void)adap;
+	for (i = 0; i < num; i++) {
+		if (msgs[i].flags & I2C_M_RD)
+			kshim_bus_read(msgs[i].buf, msgs[i].len);
+		else if (!kshim_bus_write(msgs[i].buf, msgs[i].len))
+			return -EIO;
+	}
+
+	return num;
+}
+
+int kshim_find_write(u16 reg, unsigned int from, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = from; i < kshim_bus.num_writes; i++) {
+		if (kshim_bus.writes[i].reg != reg)
+			continue;
+		if (!n--)
+			return i;
+	}
+
+	return -1;
+}
+
+void kshim_print_writes(unsigned int from)
+{
+	unsigned int i;
+
+	for (i = from; i < kshim_bus.num_writes; i++)
+		fprintf(stderr, "  %5u: 0x%04x = 0x%02x\n", i,
+			kshim_bus.writes[i].reg, kshim_bus.writes[i].val);
+}
+
+/*
+ * Controls
+ */
+int v4l2_ctrl_handler_init(struct v4l2_ctrl_handler *hdl,
+			   unsigned int nr_of_controls_hint)
+{
+	(void)nr_of_controls_hint;
+	memset(hdl, 0, sizeof(*hdl));
+	mutex_init(&hdl->_lock);
+	hdl->lock = &hdl->_lock;
+	return 0;
+}
+
+void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl)
+{
+	struct v4l2_ctrl *ctrl, *next;
+
+	for (ctrl = hdl->first; ctrl; ctrl = next) {
+		next = ctrl->next;
+		free(ctrl);
+	}
+	hdl->first = NULL;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_find(struct v4l2_ctrl_handler *hdl, u32 id)
+{
+	struct v4l2_ctrl *ctrl;
+
+	for (ctrl = hdl->first; ctrl; ctrl = ctrl->next)
+		if (ctrl->id == id)
+			return ctrl;
+
+	return NULL;
+}
+
+static struct v4l2_ctrl *kshim_ctrl_new(struct v4l2_ctrl_handler *hdl,
+					const struct v4l2_ctrl_ops *ops,
+					u32 id, enum v4l2_ctrl_type type,
+					s64 min, s64 max, u64 step, s64 def,
+					u32 flags)
+{
+	struct v4l2_ctrl *ctrl, **tail;
+
+	if (hdl->error)
+		return NULL;
+
+	if (min > max || def < min || def > max) {
+		hdl->error = -ERANGE;
+		return NULL;
+	}
+
+	ctrl = calloc(1, sizeof(*ctrl));
+	if (!ctrl) {
+		hdl->error = -ENOMEM;
+		return NULL;
+	}
+
+	ctrl->handler = hdl;
+	ctrl->ops = ops;
+	ctrl->id = id;
+	ctrl->type = type;
+	ctrl->minimum = min;
+	ctrl->maximum = max;
+	ctrl->step = step;
+	ctrl->default_value = def;
+	ctrl->flags = flags;
+	if (type == V4L2_CTRL_TYPE_BUTTON)
+		ctrl->flags |= V4L2_CTRL_FLAG_WRITE_ONLY |
+			       V4L2_CTRL_FLAG_EXECUTE_ON_WRITE;
+	ctrl->val64 = def;
+	ctrl->cur.val64 = def;
+	ctrl->self = ctrl;
+	ctrl->cluster = &ctrl->self;
+	ctrl->ncontrols = 1;
+
+	for (tail = &hdl->first; *tail; tail = &(*tail)->next)
+		;
+	*tail = ctrl;
+
+	return ctrl;
+}
+
+static void kshim_std_ctrl(u32 id, enum v4l2_ctrl_type *type, u32 *flags)
+{
+	*type = V4L2_CTRL_TYPE_INTEGER;
+	*flags = 0;
+
+	switch (id) {
+	case V4L2_CID_PIXEL_RATE:
+		*type = V4L2_CTRL_TYPE_INTEGER64;
+		*flags = V4L2_CTRL_FLAG_READ_ONLY;
+		break;
+	case V4L2_CID_LINK_FREQ:
+		*type = V4L2_CTRL_TYPE_INTEGER_MENU;
+		*flags = V4L2_CTRL_FLAG_READ_ONLY;
+		break;
+	case V4L2_CID_TEST_PATTERN:
+	case V4L2_CID_EXPOSURE_AUTO:
+	case V4L2_CID_POWER_LINE_FREQUENCY:
+		*type = V4L2_CTRL_TYPE_MENU;
+		break;
+	case V4L2_CID_HFLIP:
+	case V4L2_CID_VFLIP:
+	case V4L2_CID_AUTOGAIN:
+	case V4L2_CID_AUTO_WHITE_BALANCE:
+		*type = V4L2_CTRL_TYPE_BOOLEAN;
+		break;
+	case V4L2_CID_CAMERA_ORIENTATION:
+		*type = V4L2_CTRL_TYPE_MENU;
+		*flags = V4L2_CTRL_FLAG_READ_ONLY;
+		break;
+	case V4L2_CID_CAMERA_SENSOR_ROTATION:
+		*flags = V4L2_CTRL_FLAG_READ_ONLY;
+		break;
+	}
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_std(struct v4l2_ctrl_handler *hdl,
+				    const struct v4l2_ctrl_ops *ops, u32 id,
+				    s64 min, s64 max, u64 step, s64 def)
+{
+	enum v4l2_ctrl_type type;
+	u32 flags;
+
+	kshim_std_ctrl(id, &type, &flags);
+	return kshim_ctrl_new(hdl, ops, id, type, min, max, step, def, flags);
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu(struct v4l2_ctrl_handler *hdl,
+					 const struct v4l2_ctrl_ops *ops,
+					 u32 id, u8 max, u64 mask, u8 def)
+{
+	enum v4l2_ctrl_type type;
+	u32 flags;
+
+	(void)mask;
+	kshim_std_ctrl(id, &type, &flags);
+	return kshim_ctrl_new(hdl, ops, id, V4L2_CTRL_TYPE_MENU, 0, max, 1,
+			      def, flags);
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu_items(struct v4l2_ctrl_handler *hdl,
+					       const struct v4l2_ctrl_ops *ops,
+					       u32 id, u8 max, u64 mask, u8 def,
+					       const char * const *qmenu)
+{
+	struct v4l2_ctrl *ctrl = v4l2_ctrl_new_std_menu(hdl, ops, id, max,
+							mask, def);
+
+	if (ctrl)
+		ctrl->qmenu = qmenu;
+	return ctrl;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_int_menu(struct v4l2_ctrl_handler *hdl,
+					 const struct v4l2_ctrl_ops *ops,
+					 u32 id, u8 max, u8 def,
+					 const s64 *qmenu_int)
+{
+	struct v4l2_ctrl *ctrl;
+	enum v4l2_ctrl_type type;
+	u32 flags;
+
+	kshim_std_ctrl(id, &type, &flags);
+	ctrl = kshim_ctrl_new(hdl, ops, id, V4L2_CTRL_TYPE_INTEGER_MENU, 0,
+			      max, 1, def, flags);
+	if (ctrl)
+		ctrl->qmenu_int = qmenu_int;
+	return ctrl;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_custom(struct v4l2_ctrl_handler *hdl,
+				       const struct v4l2_ctrl_config *cfg,
+				       void *priv)
+{
+	struct v4l2_ctrl *ctrl;
+
+	ctrl = kshim_ctrl_new(hdl, cfg->ops, cfg->id, cfg->type, cfg->min,
+			      cfg->max, cfg->step, cfg->def, cfg->flags);
+	if (ctrl) {
+		ctrl->name = cfg->name;
+		ctrl->qmenu = cfg->qmenu;
+		ctrl->qmenu_int = cfg->qmenu_int;
+		ctrl->priv = priv;
+	}
+	return ctrl;
+}
+
+int v4l2_ctrl_new_fwnode_properties(struct v4l2_ctrl_handler *hdl,
+				    const struct v4l2_ctrl_ops *ctrl_ops,
+				    const struct v4l2_fwnode_device_properties *p)
+{
+	v4l2_ctrl_new_std_menu(hdl, ctrl_ops, V4L2_CID_CAMERA_ORIENTATION,
+			       V4L2_CAMERA_ORIENTATION_EXTERNAL, 0,
+			       p->orientation);
+	v4l2_ctrl_new_std(hdl, ctrl_ops, V4L2_CID_CAMERA_SENSOR_ROTATION,
+			  p->rotation, p->rotation, 1, p->rotation);
+	return hdl->error;
+}
+
+void v4l2_ctrl_cluster(unsigned int ncontrols, struct v4l2_ctrl **controls)
+{
+	unsigned int i;
+
+	for (i = 0; i < ncontrols; i++) {
+		if (!controls[i])
+			continue;
+		controls[i]->cluster = controls;
+		controls[i]->ncontrols = ncontrols;
+	}
+}
+
+static bool kshim_ctrl_valid(const struct v4l2_ctrl *ctrl, s64 val)
+{
+	if (ctrl->type == V4L2_CTRL_TYPE_BUTTON)
+		return true;
+
+	return val >= ctrl->minimum && val <= ctrl->maximum;
+}
+
+/*
+ * Set the new values of the cluster of @master, as try_or_set_cluster():
+ * the controls not set take their current value, s_ctrl() runs when one
+ * of them changes or is a button, and the new values become current if
+ * it succeeds
+ */
+static int kshim_set_cluster(struct v4l2_ctrl *master)
+{
+	bool changed = false;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < master->ncontrols; i++) {
+		struct v4l2_ctrl *ctrl = master->cluster[i];
+
+		if (!ctrl)
+			continue;
+		if (!ctrl->is_new) {
+			ctrl->val64 = ctrl->cur.val64;
+			continue;
+		}
+		if (ctrl->flags & V4L2_CTRL_FLAG_EXECUTE_ON_WRITE ||
+		    ctrl->val64 != ctrl->cur.val64)
+			changed = true;
+	}
+
+	if (changed && master->ops && master->ops->s_ctrl)
+		ret = master->ops->s_ctrl(master);
+
+	for (i = 0; i < master->ncontrols; i++) {
+		struct v4l2_ctrl *ctrl = master->cluster[i];
+
+		if (!ctrl)
+			continue;
+		if (ret)
+			ctrl->val64 = ctrl->cur.val64;
+		else if (ctrl->is_new)
+			ctrl->cur.val64 = ctrl->val64;
+		ctrl->is_new = 0;
+	}
+
+	return ret;
+}
+
+static void kshim_clear_cluster(struct v4l2_ctrl *master)
+{
+	unsigned int i;
+
+	for (i = 0; i < master->ncontrols; i++)
+		if (master->cluster[i])
+			master->cluster[i]->is_new = 0;
+}
+
+int __v4l2_ctrl_s_ctrl_int64(struct v4l2_ctrl *ctrl, s64 val)
+{
+	if (!kshim_ctrl_valid(ctrl, val))
+		return -ERANGE;
+
+	kshim_clear_cluster(ctrl->cluster[0]);
+	if (ctrl->type == V4L2_CTRL_TYPE_INTEGER64)
+		ctrl->val64 = val;
+	else
+		ctrl->val = val;
+	ctrl->is_new = 1;
+	return kshim_set_cluster(ctrl->cluster[0]);
+}
+
+int __v4l2_ctrl_s_ctrl(struct v4l2_ctrl *ctrl, s32 val)
+{
+	return __v4l2_ctrl_s_ctrl_int64(ctrl, val);
+}
+
+int __v4l2_ctrl_modify_range(struct v4l2_ctrl *ctrl, s64 min, s64 max,
+			     u64 step, s64 def)
+{
+	s64 val = ctrl->cur.val64;
+
+	if (ctrl->type != V4L2_CTRL_TYPE_INTEGER64)
+		val = ctrl->cur.val;
+	if (min > max || def < min || def > max)
+		return -ERANGE;
+
+	ctrl->minimum = min;
+	ctrl->maximum = max;
+	ctrl->step = step;
+	ctrl->default_value = def;
+
+	/* the value is clamped to the new range, and set if it changes */
+	if (val < min || val > max)
+		return __v4l2_ctrl_s_ctrl_int64(ctrl, clamp(val, min, max));
+
+	return 0;
+}
+
+void __v4l2_ctrl_grab(struct v4l2_ctrl *ctrl, bool grabbed)
+{
+	if (grabbed)
+		ctrl->flags |= V4L2_CTRL_FLAG_GRABBED;
+	else
+		ctrl->flags &= ~V4L2_CTRL_FLAG_GRABBED;
+}
+
+int __v4l2_ctrl_handler_setup(struct v4l2_ctrl_handler *hdl)
+{
+	struct v4l2_ctrl *ctrl;
+	unsigned int i;
+	int ret;
+
+	for (ctrl = hdl->first; ctrl; ctrl = ctrl->next)
+		ctrl->done = 0;
+
+	for (ctrl = hdl->first; ctrl; ctrl = ctrl->next) {
+		struct v4l2_ctrl *master = ctrl->cluster[0];
+
+		if (ctrl->done || ctrl->type == V4L2_CTRL_TYPE_BUTTON ||
+		    ctrl->flags & V4L2_CTRL_FLAG_READ_ONLY)
+			continue;
+
+		for (i = 0; i < master->ncontrols; i++) {
+			if (!master->cluster[i])
+				continue;
+			master->cluster[i]->val64 = master->cluster[i]->cur.val64;
+			master->cluster[i]->is_new = 1;
+			master->cluster[i]->done = 1;
+		}
+
+		ret = master->ops && master->ops->s_ctrl ?
+		      master->ops->s_ctrl(master) : 0;
+		kshim_clear_cluster(master);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int v4l2_ctrl_handler_setup(struct v4l2_ctrl_handler *hdl)
+{
+	int ret;
+
+	mutex_lock(hdl->lock);
+	ret = __v4l2_ctrl_handler_setup(hdl);
+	mutex_unlock(hdl->lock);
+	return ret;
+}
+
+int kshim_s_ctrls(struct v4l2_ctrl_handler *hdl, unsigned int count,
+		  const u32 *ids, const s32 *vals)
+{
+	struct v4l2_ctrl *ctrls[16];
+	unsigned int i, j;
+	int ret = 0;
+
+	if (count > ARRAY_SIZE(ctrls))
+		return -E2BIG;
+
+	for (i = 0; i < count; i++) {
+		ctrls[i] = v4l2_ctrl_find(hdl, ids[i]);
+		if (!ctrls[i])
+			return -EINVAL;
+		if (ctrls[i]->flags & V4L2_CTRL_FLAG_READ_ONLY)
+			return -EACCES;
+		if (ctrls[i]->flags & V4L2_CTRL_FLAG_GRABBED)
+			return -EBUSY;
+		if (!kshim_ctrl_valid(ctrls[i], vals[i]))
+			return -ERANGE;
+	}
+
+	mutex_lock(hdl->lock);
+
+	/* a cluster is set once with all of its controls in the request */
+	for (i = 0; i < count; i++)
+		kshim_clear_cluster(ctrls[i]->cluster[0]);
+	for (i = 0; i < count; i++) {
+		ctrls[i]->val = vals[i];
+		ctrls[i]->is_new = 1;
+	}
+
+	for (i = 0; i < count && !ret; i++) {
+		struct v4l2_ctrl *master = ctrls[i]->cluster[0];
+
+		for (j = 0; j < i; j++)
+			if (ctrls[j]->cluster[0] == master)
+				break;
+		if (j < i)
+			continue;
+
+		ret = kshim_set_cluster(master);
+	}
+
+	mutex_unlock(hdl->lock);
+
+	return ret;
+}
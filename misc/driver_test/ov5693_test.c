@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * The ov5693 driver on the simulated bus: exposure and gain in one
+ * register group while streaming, closed when a write in it fails, and
+ * no group while stopped.
+ */
+
+#include "driver_test.h"
+#include "../../drivers/media/i2c/ov5693.c"
+
+#define W(r, v)		{ .reg = (r), .val = (v) }
+
+static struct ov5693_device *test_probe(struct i2c_client *client)
+{
+	int ret;
+
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = 2;
+	kshim_fw.clk_rate = OV5693_XVCLK_FREQ;
+
+	kshim_bus.regs[OV5693_REG_CHIP_ID_H] = OV5693_CHIP_ID >> 8;
+	kshim_bus.regs[OV5693_REG_CHIP_ID_L] = OV5693_CHIP_ID & 0xff;
+
+	ret = ov5693_probe(client);
+	CHECK(!ret, "probe failed: %d", ret);
+	if (ret)
+		return NULL;
+
+	return to_ov5693_sensor(i2c_get_clientdata(client));
+}
+
+static int test_exposure_gain(struct ov5693_device *ov5693, s32 exposure,
+			      s32 gain)
+{
+	static const u32 ids[] = { V4L2_CID_EXPOSURE, V4L2_CID_ANALOGUE_GAIN };
+	s32 vals[] = { exposure, gain };
+
+	return kshim_s_ctrls(&ov5693->ctrls.handler, 2, ids, vals);
+}
+
+static void test_streaming(struct ov5693_device *ov5693)
+{
+	/* exposure 1000 lines, gain 40, both with 4 fractional bits */
+	static const struct kshim_write group[] = {
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_HOLD_START),
+		W(OV5693_EXPOSURE_L_CTRL_HH_REG, 0x00),
+		W(OV5693_EXPOSURE_L_CTRL_H_REG, 0x3e),
+		W(OV5693_EXPOSURE_L_CTRL_L_REG, 0x80),
+		W(OV5693_GAIN_CTRL_L_REG, 0x80),
+		W(OV5693_GAIN_CTRL_H_REG, 0x02),
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_HOLD_END),
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_LAUNCH),
+	};
+	static const struct kshim_write failed[] = {
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_HOLD_START),
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_HOLD_END),
+		W(OV5693_GROUP_ACCESS_REG, OV5693_GROUP_ACCESS_LAUNCH),
+	};
+	unsigned int from;
+	int ret;
+
+	/* runtime PM is left to the test, the shim doesn't call back */
+	ret = ov5693_sensor_resume(ov5693->dev);
+	CHECK(!ret, "resume: %d", ret);
+
+	from = kshim_bus.num_writes;
+	ret = ov5693_s_stream(&ov5693->sd, 1);
+	CHECK(!ret, "stream on: %d", ret);
+	CHECK(kshim_bus.regs[OV5693_SW_STREAM_REG] == OV5693_START_STREAMING,
+	      "not streaming");
+	CHECK(!test_count_writes(OV5693_GROUP_ACCESS_REG, from),
+	      "group hold while starting");
+
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(ov5693, 1000, 40);
+	CHECK(!ret && test_writes(from, group, ARRAY_SIZE(group)),
+	      "exposure and gain not in one group: %d", ret);
+
+	/* the exposure doesn't go through, the group is closed anyway */
+	from = kshim_bus.num_writes;
+	kshim_bus.fail_reg = OV5693_EXPOSURE_L_CTRL_HH_REG;
+	kshim_bus.fail_count = 1;
+	ret = test_exposure_gain(ov5693, 1001, 41);
+	CHECK(ret == -EIO, "failed exposure write returned %d", ret);
+	CHECK(test_writes(from, failed, ARRAY_SIZE(failed)),
+	      "group not closed after a failed write");
+
+	/* no group hold while stopped */
+	ret = ov5693_s_stream(&ov5693->sd, 0);
+	CHECK(!ret && kshim_bus.regs[OV5693_SW_STREAM_REG] ==
+	      OV5693_STOP_STREAMING, "stream off: %d", ret);
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(ov5693, 1002, 42);
+	CHECK(!ret && !test_count_writes(OV5693_GROUP_ACCESS_REG, from),
+	      "group hold while stopped: %d", ret);
+}
+
+void ov5693_test(void)
+{
+	struct i2c_client *client = test_client("ov5693");
+	struct ov5693_device *ov5693 = test_probe(client);
+
+	if (!ov5693) {
+		kshim_devres_release();
+		free(client);
+		return;
+	}
+
+	test_streaming(ov5693);
+
+	ov5693_remove(client);
+	kshim_devres_release();
+	free(client);
+}
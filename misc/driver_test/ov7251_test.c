@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * The ov7251 driver on the simulated bus: exposure and gain in one
+ * register group while streaming, closed when a write in it fails, and
+ * the snapshot mode, with the frame count of the sensor and a standby to
+ * streaming edge on each trigger. The VTS of the mode a frame interval or
+ * a format picks.
+ */
+
+#include "driver_test.h"
+#include "../../drivers/media/i2c/ov7251.c"
+
+#define W(r, v)		{ .reg = (r), .val = (v) }
+
+/* not what the driver writes, to tell that it keeps the other bits */
+#define TEST_LOW_POWER	0x03
+
+static struct ov7251 *test_probe(struct i2c_client *client)
+{
+	int ret;
+
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = 1;
+	kshim_fw.clock_frequency = 24000000;
+	kshim_fw.clk_rate = 24000000;
+
+	kshim_bus.regs[OV7251_CHIP_ID_HIGH] = OV7251_CHIP_ID_HIGH_BYTE;
+	kshim_bus.regs[OV7251_CHIP_ID_LOW] = OV7251_CHIP_ID_LOW_BYTE;
+	kshim_bus.regs[OV7251_SC_GP_IO_IN1] = 0x60;
+	kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL] = TEST_LOW_POWER;
+
+	ret = ov7251_probe(client);
+	CHECK(!ret, "probe failed: %d", ret);
+	if (ret)
+		return NULL;
+
+	return to_ov7251(i2c_get_clientdata(client));
+}
+
+static int test_s_stream(struct ov7251 *ov7251, int enable)
+{
+	return ov7251->sd.ops->video->s_stream(&ov7251->sd, enable);
+}
+
+static int test_exposure_gain(struct ov7251 *ov7251, s32 exposure, s32 gain)
+{
+	static const u32 ids[] = { V4L2_CID_EXPOSURE, V4L2_CID_ANALOGUE_GAIN };
+	s32 vals[] = { exposure, gain };
+
+	return kshim_s_ctrls(&ov7251->ctrls, 2, ids, vals);
+}
+
+static void test_streaming(struct ov7251 *ov7251)
+{
+	/* exposure 20 lines is 0x140 in 1/16 lines, gain 100 */
+	static const struct kshim_write group[] = {
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_HOLD_START),
+		W(OV7251_AEC_EXPO_0, 0x00),
+		W(OV7251_AEC_EXPO_1, 0x01),
+		W(OV7251_AEC_EXPO_2, 0x40),
+		W(OV7251_AEC_AGC_ADJ_0, 0x00),
+		W(OV7251_AEC_AGC_ADJ_1, 100),
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_HOLD_END),
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_LAUNCH),
+	};
+	static const struct kshim_write failed[] = {
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_HOLD_START),
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_HOLD_END),
+		W(OV7251_GROUP_ACCESS, OV7251_GROUP_ACCESS_LAUNCH),
+	};
+	unsigned int from = kshim_bus.num_writes;
+	int ret;
+
+	ret = test_s_stream(ov7251, 1);
+	CHECK(!ret, "stream on: %d", ret);
+	CHECK(kshim_bus.regs[OV7251_SC_MODE_SELECT] ==
+	      OV7251_SC_MODE_SELECT_STREAMING, "not streaming");
+	CHECK(!test_count_writes(OV7251_GROUP_ACCESS, from),
+	      "group hold while starting");
+
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(ov7251, 20, 100);
+	CHECK(!ret && test_writes(from, group, ARRAY_SIZE(group)),
+	      "exposure and gain not in one group: %d", ret);
+
+	/* the exposure doesn't go through, the group is closed anyway */
+	from = kshim_bus.num_writes;
+	kshim_bus.fail_reg = OV7251_AEC_EXPO_0;
+	kshim_bus.fail_count = 1;
+	ret = test_exposure_gain(ov7251, 21, 101);
+	CHECK(ret == -EIO, "failed exposure write returned %d", ret);
+	CHECK(test_writes(from, failed, ARRAY_SIZE(failed)),
+	      "group not closed after a failed write");
+
+	ret = test_s_stream(ov7251, 0);
+	CHECK(!ret, "stream off: %d", ret);
+	CHECK(kshim_bus.regs[OV7251_SC_MODE_SELECT] ==
+	      OV7251_SC_MODE_SELECT_SW_STANDBY, "still streaming");
+}
+
+static void test_snapshot(struct ov7251 *ov7251)
+{
+	static const struct kshim_write trigger[] = {
+		W(OV7251_SC_MODE_SELECT, OV7251_SC_MODE_SELECT_SW_STANDBY),
+		W(OV7251_SC_MODE_SELECT, OV7251_SC_MODE_SELECT_STREAMING),
+	};
+	/* straight to the registers, the sensor may be in standby */
+	static const struct kshim_write direct[] = {
+		W(OV7251_AEC_EXPO_0, 0x00),
+		W(OV7251_AEC_EXPO_1, 0x01),
+		W(OV7251_AEC_EXPO_2, 0xe0),
+		W(OV7251_AEC_AGC_ADJ_0, 0x00),
+		W(OV7251_AEC_AGC_ADJ_1, 200),
+	};
+	unsigned int from;
+	int ret;
+
+	/* the trigger is for the snapshot mode only */
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(ret == -EBUSY, "trigger while stopped returned %d", ret);
+	ret = test_s_stream(ov7251, 1);
+	CHECK(!ret, "stream on: %d", ret);
+	CHECK(kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL] == TEST_LOW_POWER,
+	      "frame count mode set without snapshot frames: 0x%02x",
+	      kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL]);
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(ret == -EBUSY, "trigger while free running returned %d", ret);
+	test_s_stream(ov7251, 0);
+
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_FRAMES, 3);
+	CHECK(!ret, "snapshot frames: %d", ret);
+
+	from = kshim_bus.num_writes;
+	ret = test_s_stream(ov7251, 1);
+	CHECK(!ret, "stream on: %d", ret);
+	CHECK(kshim_find_write(OV7251_SC_FRAME_COUNT, from, 0) >= 0 &&
+	      kshim_bus.regs[OV7251_SC_FRAME_COUNT] == 3,
+	      "frame count not set: %u", kshim_bus.regs[OV7251_SC_FRAME_COUNT]);
+	CHECK(kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL] ==
+	      (TEST_LOW_POWER | OV7251_SC_LOW_POWER_CTRL_FRAME_COUNT),
+	      "frame count mode not set: 0x%02x",
+	      kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL]);
+	CHECK(kshim_bus.regs[OV7251_SC_MODE_SELECT] ==
+	      OV7251_SC_MODE_SELECT_SW_STANDBY,
+	      "streaming before the first trigger");
+
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_FRAMES, 5);
+	CHECK(ret == -EBUSY, "snapshot frames changed while streaming: %d",
+	      ret);
+
+	/* every trigger makes an edge, during a burst too, restarting it */
+	from = kshim_bus.num_writes;
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(!ret && test_writes(from, trigger, ARRAY_SIZE(trigger)),
+	      "first trigger: %d", ret);
+	from = kshim_bus.num_writes;
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(!ret && test_writes(from, trigger, ARRAY_SIZE(trigger)),
+	      "second trigger: %d", ret);
+
+	/* the standby write fails: no edge, and the error is returned */
+	from = kshim_bus.num_writes;
+	kshim_bus.fail_reg = OV7251_SC_MODE_SELECT;
+	kshim_bus.fail_count = 1;
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(ret == -EIO && test_writes(from, NULL, 0),
+	      "failed trigger returned %d", ret);
+
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(ov7251, 30, 200);
+	CHECK(!ret && test_writes(from, direct, ARRAY_SIZE(direct)),
+	      "exposure and gain in snapshot mode: %d", ret);
+
+	ret = test_s_stream(ov7251, 0);
+	CHECK(!ret, "stream off: %d", ret);
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_TRIGGER, 0);
+	CHECK(ret == -EBUSY, "trigger after stream off returned %d", ret);
+
+	/* back to free running */
+	ret = kshim_s_ctrl(&ov7251->ctrls, V4L2_CID_OV7251_SNAPSHOT_FRAMES, 0);
+	CHECK(!ret, "snapshot frames: %d", ret);
+	ret = test_s_stream(ov7251, 1);
+	CHECK(!ret && kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL] ==
+	      TEST_LOW_POWER, "frame count mode left set: 0x%02x",
+	      kshim_bus.regs[OV7251_SC_LOW_POWER_CTRL]);
+	CHECK(kshim_bus.regs[OV7251_SC_MODE_SELECT] ==
+	      OV7251_SC_MODE_SELECT_STREAMING, "not streaming");
+	test_s_stream(ov7251, 0);
+}
+
+static void test_frame_interval(struct ov7251 *ov7251)
+{
+	struct v4l2_subdev_frame_interval fi = { .interval = { 1, 60 } };
+	struct v4l2_subdev_format fmt = {
+		.which = V4L2_SUBDEV_FORMAT_ACTIVE,
+		.format = { .width = 640, .height = 480 },
+	};
+	int ret;
+
+	/* the 60 fps mode, with its VTS of 860 */
+	ret = ov7251->sd.ops->video->s_frame_interval(&ov7251->sd, &fi);
+	CHECK(!ret && fi.interval.denominator == 6014,
+	      "60 fps gave %u/%u: %d", fi.interval.numerator,
+	      fi.interval.denominator, ret);
+	CHECK(ov7251->vblank->val == 860 - 480 &&
+	      ov7251->vblank->default_value == 860 - 480,
+	      "VBLANK %d, default %lld for 60 fps", ov7251->vblank->val,
+	      (long long)ov7251->vblank->default_value);
+	ret = test_s_stream(ov7251, 1);
+	CHECK(!ret && (kshim_bus.regs[OV7251_VTS_REG_HIGH] << 8 |
+		       kshim_bus.regs[OV7251_VTS_REG_LOW]) == 860,
+	      "VTS not written: %d", ret);
+	test_s_stream(ov7251, 0);
+
+	/* the format picks the first mode of the size, at 30 fps */
+	ret = ov7251->sd.ops->pad->set_fmt(&ov7251->sd, NULL, &fmt);
+	CHECK(!ret && ov7251->vblank->val == 1724 - 480,
+	      "VBLANK %d after the format: %d", ov7251->vblank->val, ret);
+}
+
+void ov7251_test(void)
+{
+	struct i2c_client *client = test_client("ov7251");
+	struct ov7251 *ov7251 = test_probe(client);
+
+	if (!ov7251) {
+		kshim_devres_release();
+		free(client);
+		return;
+	}
+
+	test_streaming(ov7251);
+	test_snapshot(ov7251);
+	test_frame_interval(ov7251);
+
+	ov7251_remove(client);
+	kshim_devres_release();
+	free(client);
+}
@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0
+/**
+ * The ov8865 driver on the simulated bus: exposure and gain in one
+ * register group while streaming, closed when a write in it fails, and
+ * no group while stopped. The lens correction table uploaded once per
+ * power-on, and the correction toggled in a group while streaming.
+ */
+
+#include "driver_test.h"
+#include "../../drivers/media/i2c/ov8865.c"
+
+#define W(r, v)		{ .reg = (r), .val = (v) }
+
+static struct ov8865_sensor *test_probe(struct i2c_client *client,
+				       const struct firmware *lenc)
+{
+	int ret;
+
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = 4;
+	kshim_fw.link_frequencies[0] = ov8865_link_freq_menu[0];
+	kshim_fw.nr_of_link_frequencies = 1;
+	kshim_fw.clk_rate = 19200000;
+	kshim_fw.file = lenc;
+
+	kshim_bus.regs[OV8865_CHIP_ID_HH_REG] = OV8865_CHIP_ID_HH_VALUE;
+	kshim_bus.regs[OV8865_CHIP_ID_H_REG] = OV8865_CHIP_ID_H_VALUE;
+	kshim_bus.regs[OV8865_CHIP_ID_L_REG] = OV8865_CHIP_ID_L_VALUE;
+
+	ret = ov8865_probe(client);
+	CHECK(!ret, "probe failed: %d", ret);
+	if (ret)
+		return NULL;
+
+	return ov8865_subdev_sensor(i2c_get_clientdata(client));
+}
+
+static int test_exposure_gain(struct ov8865_sensor *sensor, s32 exposure,
+			      s32 gain)
+{
+	static const u32 ids[] = { V4L2_CID_EXPOSURE, V4L2_CID_ANALOGUE_GAIN };
+	s32 vals[] = { exposure, gain };
+
+	return kshim_s_ctrls(&sensor->ctrls.handler, 2, ids, vals);
+}
+
+static void test_streaming(struct ov8865_sensor *sensor)
+{
+	/* exposure 100 lines is 0x640 in 1/16 lines, gain 256 */
+	static const struct kshim_write group[] = {
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_START),
+		W(OV8865_EXPOSURE_CTRL_HH_REG, 0x00),
+		W(OV8865_EXPOSURE_CTRL_H_REG, 0x06),
+		W(OV8865_EXPOSURE_CTRL_L_REG, 0x40),
+		W(OV8865_GAIN_CTRL_H_REG, 0x01),
+		W(OV8865_GAIN_CTRL_L_REG, 0x00),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_END),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_LAUNCH),
+	};
+	static const struct kshim_write failed[] = {
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_START),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_END),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_LAUNCH),
+	};
+	unsigned int from;
+	int ret;
+
+	/* runtime PM is left to the test, the shim doesn't call back */
+	ret = ov8865_resume(sensor->dev);
+	CHECK(!ret, "resume: %d", ret);
+
+	from = kshim_bus.num_writes;
+	ret = ov8865_s_stream(&sensor->subdev, 1);
+	CHECK(!ret, "stream on: %d", ret);
+	CHECK(kshim_bus.regs[OV8865_SW_STANDBY_REG] ==
+	      OV8865_SW_STANDBY_STREAM_ON, "not streaming");
+	CHECK(!test_count_writes(OV8865_GROUP_ACCESS_REG, from),
+	      "group hold while starting");
+
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(sensor, 100, 256);
+	CHECK(!ret && test_writes(from, group, ARRAY_SIZE(group)),
+	      "exposure and gain not in one group: %d", ret);
+
+	/* the exposure doesn't go through, the group is closed anyway */
+	from = kshim_bus.num_writes;
+	kshim_bus.fail_reg = OV8865_EXPOSURE_CTRL_HH_REG;
+	kshim_bus.fail_count = 1;
+	ret = test_exposure_gain(sensor, 101, 384);
+	CHECK(ret == -EIO, "failed exposure write returned %d", ret);
+	CHECK(test_writes(from, failed, ARRAY_SIZE(failed)),
+	      "group not closed after a failed write");
+
+	/* no group hold while stopped */
+	ret = ov8865_s_stream(&sensor->subdev, 0);
+	CHECK(!ret && !kshim_bus.regs[OV8865_SW_STANDBY_REG],
+	      "stream off: %d", ret);
+	from = kshim_bus.num_writes;
+	ret = test_exposure_gain(sensor, 102, 512);
+	CHECK(!ret && !test_count_writes(OV8865_GROUP_ACCESS_REG, from),
+	      "group hold while stopped: %d", ret);
+}
+
+static void test_lenc(struct ov8865_sensor *sensor, bool table)
+{
+	static const struct kshim_write toggle[] = {
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_START),
+		W(OV8865_ISP_CTRL0_REG, 0),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_HOLD_END),
+		W(OV8865_GROUP_ACCESS_REG, OV8865_GROUP_ACCESS_LAUNCH),
+	};
+	struct kshim_write expect[ARRAY_SIZE(toggle)];
+	unsigned int from = kshim_bus.num_writes;
+	u8 isp;
+	int ret;
+
+	/* the control handler setup at power-on doesn't send it again */
+	ret = ov8865_resume(sensor->dev);
+	CHECK(!ret, "resume: %d", ret);
+	CHECK(test_count_writes(OV8865_LENC_TABLE_REG, from) == table,
+	      "lens correction table uploaded %u times",
+	      test_count_writes(OV8865_LENC_TABLE_REG, from));
+	CHECK(!!(kshim_bus.regs[OV8865_ISP_CTRL0_REG] &
+		 OV8865_ISP_CTRL0_LENC_EN) == table,
+	      "lens correction %s", table ? "off" : "on without a table");
+
+	ret = ov8865_s_stream(&sensor->subdev, 1);
+	CHECK(!ret, "stream on: %d", ret);
+
+	/* only the enable bit, in a group */
+	memcpy(expect, toggle, sizeof(expect));
+	isp = kshim_bus.regs[OV8865_ISP_CTRL0_REG];
+	from = kshim_bus.num_writes;
+	ret = kshim_s_ctrl(&sensor->ctrls.handler, V4L2_CID_OV8865_LENC, 0);
+	expect[1].val = isp & ~OV8865_ISP_CTRL0_LENC_EN;
+	CHECK(!ret && test_writes(from, expect, ARRAY_SIZE(expect)),
+	      "lens correction not disabled in a group: %d", ret);
+
+	from = kshim_bus.num_writes;
+	ret = kshim_s_ctrl(&sensor->ctrls.handler, V4L2_CID_OV8865_LENC, 1);
+	expect[1].val = isp & ~OV8865_ISP_CTRL0_LENC_EN;
+	if (table)
+		expect[1].val |= OV8865_ISP_CTRL0_LENC_EN;
+	CHECK(!ret && test_writes(from, expect, ARRAY_SIZE(expect)),
+	      "lens correction not %s in a group: %d",
+	      table ? "enabled" : "left off", ret);
+	CHECK(!test_count_writes(OV8865_LENC_TABLE_REG, from),
+	      "lens correction table sent again by the control");
+
+	ret = ov8865_s_stream(&sensor->subdev, 0);
+	CHECK(!ret, "stream off: %d", ret);
+}
+
+static void test_run(bool table)
+{
+	static const u8 data[] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60 };
+	static const struct firmware firmware = {
+		.size = sizeof(data),
+		.data = data,
+	};
+	struct i2c_client *client = test_client("ov8865");
+	struct ov8865_sensor *sensor;
+
+	sensor = test_probe(client, table ? &firmware : NULL);
+	if (sensor) {
+		if (!table)
+			test_streaming(sensor);
+		test_lenc(sensor, table);
+		ov8865_remove(client);
+	}
+
+	kshim_devres_release();
+	free(client);
+}
+
+void ov8865_test(void)
+{
+	test_run(false);
+	test_run(true);
+}
@@ -1,76 +1,176 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #include <linux/acpi.h>
+#include <linux/debugfs.h>
 #include <linux/i2c.h>
-
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "ipu_acpi_fields.h"
+#include "ipu_dsm.h"
 #include "dump_intel_ipu_data.h"
 
 #define DRV_NAME	"dump_intel_ipu_data"
-#define DRV_VERSION	"1.1"
+#define DRV_VERSION	"1.2"
+
+static bool full_scan;
+module_param(full_scan, bool, 0444);
+MODULE_PARM_DESC(full_scan,
+		 "Walk every ACPI device instead of matching known _HIDs only (default: false)");
+
+static bool text_output = true;
+module_param(text_output, bool, 0444);
+MODULE_PARM_DESC(text_output,
+		 "Print the dump to the kernel log as well as debugfs (default: true)");
+
+#define dump_info(fmt, ...)					\
+	do {							\
+		if (text_output)				\
+			pr_info(fmt, ##__VA_ARGS__);		\
+	} while (0)
+
+static void dump_hex(const void *buf, size_t len)
+{
+	if (text_output)
+		print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
+			       buf, len, true);
+}
+
+static struct acpi_eval_stats eval_stats;
+static LIST_HEAD(record_list);
 
 /**
- * get_acpi_buf - wrapper for acpi_evaluate_object()
- * @adev: ACPI device
+ * acpi_eval_cache_get - evaluate @path once and return the cached object
+ * @cache: per-device evaluation cache
  * @path: ACPI object path
- * @out: pointer to point returned buffer from @path
- * @size: buffer size of @out
+ * @obj: pointer to point the cached object for @path
  *
- * Return negative values on failure.
- * Return length of @out on success.
+ * The first call for @path runs acpi_has_method() and
+ * acpi_evaluate_object(). Later calls return the stored result, including
+ * missing entries and evaluation failures. The returned object is owned by
+ * @cache and stays valid until acpi_eval_cache_free().
+ *
+ * Return -ENOENT if @path doesn't exist.
+ * Return other negative values on failure.
+ * Return 0 on success.
  */
-static int get_acpi_buf(struct acpi_device *adev, const char *path,
-			void *out, u32 size)
+static int acpi_eval_cache_get(struct acpi_eval_cache *cache,
+			       const char *path, union acpi_object **obj)
 {
 	struct acpi_buffer buffer = { ACPI_ALLOCATE_BUFFER, NULL };
-	struct acpi_handle *handle = adev->handle;
-	union acpi_object *obj;
+	struct acpi_handle *handle = cache->adev->handle;
+	struct acpi_eval_entry *entry;
 	acpi_status status;
-	int ret;
+	int i;
+
+	for (i = 0; i < cache->count; i++) {
+		entry = &cache->entries[i];
+		if (strcmp(entry->path, path))
+			continue;
+
+		eval_stats.saved++;
+		*obj = entry->obj;
+		return entry->ret;
+	}
+
+	if (cache->count >= ARRAY_SIZE(cache->entries)) {
+		pr_err("%s: ACPI eval cache is full\n", path);
+		return -ENOMEM;
+	}
+
+	entry = &cache->entries[cache->count++];
+	entry->path = path;
+	entry->obj = NULL;
+	entry->ret = 0;
 
 	if (!acpi_has_method(handle, (acpi_string)path)) {
-		/* Some entries may not exist, use info loglevel. */
-		pr_info("ACPI %s: Entry not found\n", path);
-		return -ENODEV;
+		entry->ret = -ENOENT;
+		goto out;
 	}
 
 	status = acpi_evaluate_object(handle, (acpi_string)path, NULL,
 				      &buffer);
+	eval_stats.evaluated++;
 	if (ACPI_FAILURE(status)) {
 		pr_err("%s: Evaluation failed\n", path);
-		return -ENODEV;
+		entry->ret = -ENODEV;
+		goto out;
 	}
 
-	obj = buffer.pointer;
-	if (!obj) {
+	entry->obj = buffer.pointer;
+	if (!entry->obj) {
 		pr_err("%s: Couldn't locate ACPI buffer\n", path);
+		entry->ret = -ENODEV;
+	}
+
+out:
+	*obj = entry->obj;
+	return entry->ret;
+}
+
+static void acpi_eval_cache_free(struct acpi_eval_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < cache->count; i++)
+		kfree(cache->entries[i].obj);
+
+	cache->count = 0;
+}
+
+/**
+ * get_acpi_buf - copy the cached buffer object for @path
+ * @cache: per-device evaluation cache
+ * @path: ACPI object path
+ * @out: pointer to point returned buffer from @path
+ * @size: buffer size of @out
+ *
+ * A buffer longer than @size is truncated to @size with a warning.
+ *
+ * Return negative values on failure.
+ * Return length of @out on success.
+ */
+static int get_acpi_buf(struct acpi_eval_cache *cache, const char *path,
+			void *out, u32 size)
+{
+	union acpi_object *obj;
+	int ret;
+
+	ret = acpi_eval_cache_get(cache, path, &obj);
+	if (ret == -ENOENT) {
+		/* Some entries may not exist, use info loglevel. */
+		dump_info("ACPI %s: Entry not found\n", path);
 		return -ENODEV;
 	}
+	if (ret)
+		return ret;
 
 	if (obj->type != ACPI_TYPE_BUFFER) {
 		pr_err("%s: Couldn't read ACPI buffer\n", path);
-		ret = -ENODEV;
-		goto err_free_buf;
+		return -ENODEV;
 	}
 
+	/* Fields missing from a short buffer read as 0 */
+	memset(out, 0, size);
+
 	if (obj->buffer.length > size) {
-		pr_err("%s: Given buffer is too small\n", path);
-		ret = -ENODEV;
-		goto err_free_buf;
+		pr_warn("%s: %u bytes, only the first %u are decoded\n", path,
+			obj->buffer.length, size);
+		memcpy(out, obj->buffer.pointer, size);
+		return size;
 	}
 
 	memcpy(out, obj->buffer.pointer, obj->buffer.length);
-	kfree(buffer.pointer);
 
 	return obj->buffer.length;
-
-err_free_buf:
-	kfree(buffer.pointer);
-	return ret;
 }
 
 /**
  * print_acpi_entry - Print entry for @path
- * @adev: ACPI device
+ * @cache: per-device evaluation cache
  * @path: ACPI object path to print
  *
  * The type of some entry may be vary depending on devices. For example,
@@ -82,68 +182,49 @@ err_free_buf:
  * - ACPI_TYPE_STRING
  * - ACPI_TYPE_BUFFER
  */
-static int print_acpi_entry(struct acpi_device *adev, const char *path)
+static int print_acpi_entry(struct acpi_eval_cache *cache, const char *path)
 {
-	struct acpi_handle *handle = adev->handle;
-	struct acpi_buffer buffer = { ACPI_ALLOCATE_BUFFER, NULL };
 	union acpi_object *obj;
-	acpi_status status;
-	int ret = 0;
+	int ret;
 
-	if (!acpi_has_method(handle, (acpi_string)path)) {
+	ret = acpi_eval_cache_get(cache, path, &obj);
+	if (ret == -ENOENT) {
 		/* Some entries may not exist, use info loglevel. */
-		pr_info("ACPI %s: Entry not found\n", path);
-		return -ENODEV;
-	}
-
-	status = acpi_evaluate_object(handle, (acpi_string)path, NULL,
-				      &buffer);
-	if (ACPI_FAILURE(status)) {
-		pr_err("%s: Evaluation failed\n", path);
-		return -ENODEV;
-	}
-
-	obj = buffer.pointer;
-	if (!obj) {
-		pr_err("ACPI %s: Couldn't locate ACPI buffer\n", path);
+		dump_info("ACPI %s: Entry not found\n", path);
 		return -ENODEV;
 	}
+	if (ret)
+		return ret;
 
 	switch (obj->type) {
 	case ACPI_TYPE_INTEGER:
-		pr_info("ACPI %s: %llu\n", path, obj->integer.value);
-		goto out_free_buff;
+		dump_info("ACPI %s: %llu\n", path, obj->integer.value);
+		return 0;
 	case ACPI_TYPE_STRING:
-		pr_info("ACPI %s: %s\n", path, obj->buffer.pointer);
-		goto out_free_buff;
+		dump_info("ACPI %s: %s\n", path, obj->string.pointer);
+		return 0;
 	case ACPI_TYPE_BUFFER:
-		pr_info("ACPI %s: Full raw output:\n", path);
-		print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-			       obj->buffer.pointer, obj->buffer.length, true);
-		goto out_free_buff;
+		dump_info("ACPI %s: Full raw output:\n", path);
+		dump_hex(obj->buffer.pointer, obj->buffer.length);
+		return 0;
 	default:
 		pr_err("ACPI %s: Couldn't read ACPI buffer\n", path);
-		ret = -ENODEV;
-		goto out_free_buff;
+		return -ENODEV;
 	}
-
-out_free_buff:
-	kfree(buffer.pointer);
-	return ret;
 }
 
-static void print_acpi_fullpath(struct acpi_device *adev)
+static void print_acpi_fullpath(struct ipu_dev_record *rec)
 {
-	struct acpi_handle *handle = adev->handle;
-	char acpi_method_name[255] = { 0 };
-	struct acpi_buffer buffer = {sizeof(acpi_method_name), acpi_method_name};
+	struct acpi_handle *handle = rec->cache.adev->handle;
+	struct acpi_buffer buffer = {sizeof(rec->acpi_path), rec->acpi_path};
 
 	acpi_get_name(handle, ACPI_FULL_PATHNAME, &buffer);
-	pr_info("ACPI path: %s\n", acpi_method_name);
+	dump_info("ACPI path: %s\n", rec->acpi_path);
 }
 
-static int print_sensor_i2c_dev_name(struct acpi_device *adev)
+static int print_sensor_i2c_dev_name(struct ipu_dev_record *rec)
 {
+	struct acpi_device *adev = rec->cache.adev;
 	struct device *i2c_dev;
 
 	i2c_dev = bus_find_device_by_acpi_dev(&i2c_bus_type, adev);
@@ -157,14 +238,17 @@ static int print_sensor_i2c_dev_name(struct acpi_device *adev)
 		return -ENODEV;
 	}
 
-	pr_info("i2c device name: %s\n", dev_name(i2c_dev));
+	strscpy(rec->i2c_dev_name, dev_name(i2c_dev),
+		sizeof(rec->i2c_dev_name));
+	dump_info("i2c device name: %s\n", rec->i2c_dev_name);
 	put_device(i2c_dev);
 
 	return 0;
 }
 
-static int print_pmic_i2c_dev_name(struct acpi_device *adev, int pmic_type)
+static int print_pmic_i2c_dev_name(struct ipu_dev_record *rec, int pmic_type)
 {
+	struct acpi_device *adev = rec->cache.adev;
 	struct device *i2c_dev;
 
 	i2c_dev = bus_find_device_by_acpi_dev(&i2c_bus_type, adev);
@@ -173,8 +257,8 @@ static int print_pmic_i2c_dev_name(struct acpi_device *adev, int pmic_type)
 			__func__);
 		return -ENODEV;
 	} else if (!i2c_dev) {
-		pr_info("%s(): (i2c dev not found as expected (DISCRETE))\n",
-			__func__);
+		dump_info("%s(): (i2c dev not found as expected (DISCRETE))\n",
+			  __func__);
 		return 0;
 	}
 
@@ -185,23 +269,27 @@ static int print_pmic_i2c_dev_name(struct acpi_device *adev, int pmic_type)
 		return 0;
 	}
 
-	pr_info("i2c device name: %s\n", dev_name(i2c_dev));
+	strscpy(rec->i2c_dev_name, dev_name(i2c_dev),
+		sizeof(rec->i2c_dev_name));
+	dump_info("i2c device name: %s\n", rec->i2c_dev_name);
 	put_device(i2c_dev);
 
 	return 0;
 }
 
-static int print_dep_acpi_paths(struct acpi_device *adev)
+static int print_dep_acpi_paths(struct ipu_dev_record *rec)
 {
-	struct acpi_handle *handle = adev->handle;
+	struct acpi_handle *handle = rec->cache.adev->handle;
 	struct acpi_handle_list dep_devices;
 	const char *path = "_DEP";
 	int ret;
 	int i;
 
+	rec->dep_count = 0;
+
 	if (!acpi_has_method(handle, (acpi_string)path)) {
 		/* Some entries may not exist, use info loglevel. */
-		pr_info("ACPI %s: Entry not found\n", path);
+		dump_info("ACPI %s: Entry not found\n", path);
 		return -ENODEV;
 	}
 
@@ -213,175 +301,186 @@ static int print_dep_acpi_paths(struct acpi_device *adev)
 	}
 
 	for (i = 0; i < dep_devices.count; i++) {
-		char acpi_method_name[255] = { 0 };
+		char acpi_method_name[ACPI_PATH_BUF_SIZE] = { 0 };
 		struct acpi_buffer buffer = {sizeof(acpi_method_name),
 					     acpi_method_name};
 
 		acpi_get_name(dep_devices.handles[i], ACPI_FULL_PATHNAME,
 			      &buffer);
-		pr_info("ACPI %s (%d of %d): %s\n",
-			path, i + 1, dep_devices.count, acpi_method_name);
+		dump_info("ACPI %s (%d of %d): %s\n",
+			  path, i + 1, dep_devices.count, acpi_method_name);
+
+		if (rec->dep_count < DEP_MAX)
+			strscpy(rec->dep[rec->dep_count++], acpi_method_name,
+				ACPI_PATH_BUF_SIZE);
 	}
 
 	if (!dep_devices.count)
-		pr_info("ACPI %s: No dependent device found\n", path);
+		dump_info("ACPI %s: No dependent device found\n", path);
 
 	return 0;
 }
 
-static int dump_pld(struct acpi_device *adev)
+/* Return the name of @val in a NULL terminated @list */
+static const char *pld_str(const char * const *list, unsigned int val)
+{
+	unsigned int i;
+
+	for (i = 0; list[i]; i++) {
+		if (i == val)
+			return list[i];
+	}
+
+	return "(out of range)";
+}
+
+static int dump_pld(struct ipu_dev_record *rec)
 {
 	struct acpi_pld_info *pld;
-	struct acpi_handle *handle = adev->handle;
+	union acpi_object *obj;
+	union acpi_object *elem;
 	acpi_status status;
 	const char *path = "_PLD";
+	int ret;
 
-	pr_info("ACPI %s: ---------- %s() ----------\n", path, __func__);
+	dump_info("ACPI %s: ---------- %s() ----------\n", path, __func__);
 
-	if (!acpi_has_method(handle, (acpi_string)path)) {
+	/* Go through the cache so that the raw buffer is kept for export */
+	ret = acpi_eval_cache_get(&rec->cache, path, &obj);
+	if (ret == -ENOENT) {
 		/* Some entries may not exist, use info loglevel. */
-		pr_info("ACPI %s: Entry not found\n", path);
+		dump_info("ACPI %s: Entry not found\n", path);
 		return -ENODEV;
 	}
+	if (ret)
+		return ret;
 
-	status = acpi_get_physical_device_location(handle, &pld);
-	if (ACPI_FAILURE(status)) {
-		pr_err("ACPI %s: Evaluation failed\n", path);
+	if (obj->type != ACPI_TYPE_PACKAGE || !obj->package.count ||
+	    obj->package.elements[0].type != ACPI_TYPE_BUFFER) {
+		pr_err("ACPI %s: Couldn't read ACPI buffer\n", path);
 		return -ENODEV;
 	}
 
-	pr_info("revision:            %d\n", pld->revision);
-	pr_info("ignore_color:        %d\n", pld->ignore_color);
-	pr_info("red:                 %d\n", pld->red);
-	pr_info("green:               %d\n", pld->green);
-	pr_info("blue:                %d\n", pld->blue);
-	pr_info("width:               %d\n", pld->width);
-	pr_info("height:              %d\n", pld->height);
-	pr_info("user_visible:        %d\n", pld->user_visible);
-	pr_info("dock:                %d\n", pld->dock);
-	pr_info("lid:                 %d\n", pld->lid);
-	pr_info("panel:               %d\n", pld->panel);
-	pr_info("vertical_position:   %d\n", pld->vertical_position);
-	pr_info("horizontal_position: %d\n", pld->horizontal_position);
-	pr_info("shape:               %d\n", pld->shape);
-	pr_info("group_orientation:   %d\n", pld->group_orientation);
-	pr_info("group_token:         %d\n", pld->group_token);
-	pr_info("group_position:      %d\n", pld->group_position);
-	pr_info("bay:                 %d\n", pld->bay);
-	pr_info("ejectable:           %d\n", pld->ejectable);
-	pr_info("ospm_eject_required: %d\n", pld->ospm_eject_required);
-	pr_info("cabinet_number:      %d\n", pld->cabinet_number);
-	pr_info("card_cage_number:    %d\n", pld->card_cage_number);
-	pr_info("reference:           %d\n", pld->reference);
-	pr_info("rotation:            %d\n", pld->rotation);
-	pr_info("order:               %d\n", pld->order);
-	pr_info("reserved:            %d\n", pld->reserved);
-	pr_info("vertical_offset:     %d\n", pld->vertical_offset);
-	pr_info("horizontal_offset:   %d\n", pld->horizontal_offset);
-
-	pr_info("----- in string -----\n");
-	pr_info("PLD_Panel: %s\n", pld_panel_list[pld->panel]);
-	pr_info("PLD_VerticalPosition: %s\n",
-		pld_vertical_position_list[pld->vertical_position]);
-	pr_info("PLD_HorizontalPosition: %s\n",
-		pld_horizontal_position_list[pld->horizontal_position]);
-	pr_info("PLD_Shape: %s\n", pld_shape_list[pld->shape]);
+	elem = &obj->package.elements[0];
+	status = acpi_decode_pld_buffer(elem->buffer.pointer,
+					elem->buffer.length, &pld);
+	if (ACPI_FAILURE(status)) {
+		pr_err("ACPI %s: Decoding failed\n", path);
+		return -ENODEV;
+	}
+	ACPI_FREE(rec->pld);
+	rec->pld = pld;
+
+	dump_info("revision:            %d\n", pld->revision);
+	dump_info("ignore_color:        %d\n", pld->ignore_color);
+	dump_info("red:                 %d\n", pld->red);
+	dump_info("green:               %d\n", pld->green);
+	dump_info("blue:                %d\n", pld->blue);
+	dump_info("width:               %d\n", pld->width);
+	dump_info("height:              %d\n", pld->height);
+	dump_info("user_visible:        %d\n", pld->user_visible);
+	dump_info("dock:                %d\n", pld->dock);
+	dump_info("lid:                 %d\n", pld->lid);
+	dump_info("panel:               %d\n", pld->panel);
+	dump_info("vertical_position:   %d\n", pld->vertical_position);
+	dump_info("horizontal_position: %d\n", pld->horizontal_position);
+	dump_info("shape:               %d\n", pld->shape);
+	dump_info("group_orientation:   %d\n", pld->group_orientation);
+	dump_info("group_token:         %d\n", pld->group_token);
+	dump_info("group_position:      %d\n", pld->group_position);
+	dump_info("bay:                 %d\n", pld->bay);
+	dump_info("ejectable:           %d\n", pld->ejectable);
+	dump_info("ospm_eject_required: %d\n", pld->ospm_eject_required);
+	dump_info("cabinet_number:      %d\n", pld->cabinet_number);
+	dump_info("card_cage_number:    %d\n", pld->card_cage_number);
+	dump_info("reference:           %d\n", pld->reference);
+	dump_info("rotation:            %d\n", pld->rotation);
+	dump_info("order:               %d\n", pld->order);
+	dump_info("reserved:            %d\n", pld->reserved);
+	dump_info("vertical_offset:     %d\n", pld->vertical_offset);
+	dump_info("horizontal_offset:   %d\n", pld->horizontal_offset);
+
+	dump_info("----- in string -----\n");
+	dump_info("PLD_Panel: %s\n", pld_str(pld_panel_list, pld->panel));
+	dump_info("PLD_VerticalPosition: %s\n",
+		  pld_str(pld_vertical_position_list, pld->vertical_position));
+	dump_info("PLD_HorizontalPosition: %s\n",
+		  pld_str(pld_horizontal_position_list,
+			  pld->horizontal_position));
+	dump_info("PLD_Shape: %s\n", pld_str(pld_shape_list, pld->shape));
 
 	return 0;
 }
 
-static int dump_crs(struct acpi_device *adev)
+static int dump_crs(struct acpi_eval_cache *cache)
 {
 	const char *path = "_CRS";
 
-	pr_info("ACPI %s: ---------- %s() ----------\n", path, __func__);
-	return print_acpi_entry(adev, path);
+	dump_info("ACPI %s: ---------- %s() ----------\n", path, __func__);
+	return print_acpi_entry(cache, path);
 }
 
-static void dump_ssdb(struct acpi_device *adev, struct intel_ssdb *ssdb,
+/**
+ * dump_fields - print the fields of an SSDB/CLDB buffer
+ * @table: field table from ipu_acpi_fields.h
+ * @buf: buffer to decode
+ * @len: length of @buf, fields past it are not printed
+ * @mask: only print the fields with one of these flags, 0 for all
+ */
+static void dump_fields(const struct ipu_field *table, const void *buf,
+			int len, unsigned int mask)
+{
+	int width = ipu_fields_name_width(table) + 1;
+	const struct ipu_field *f;
+	u32 val;
+
+	ipu_for_each_field(f, table, len) {
+		if (mask && !(f->flags & mask))
+			continue;
+
+		if (f->kind == IPU_FIELD_BYTES) {
+			dump_info("%s:\n", f->name);
+			dump_hex(buf + f->offset, f->size);
+			continue;
+		}
+
+		val = ipu_field_value(f, buf);
+		dump_info("%s:%*s%u\n", f->name,
+			  (int)(width - strlen(f->name)), "", val);
+		if (!mask && !ipu_field_valid(f, val))
+			pr_warn("%s: %u is out of range\n", f->name, val);
+	}
+}
+
+static void dump_ssdb(struct acpi_eval_cache *cache, struct intel_ssdb *ssdb,
 		      int ssdb_len)
 {
-	pr_info("ACPI SSDB: ---------- %s() ----------\n", __func__);
-
-	print_acpi_entry(adev, "SSDB");
-
-	pr_info("version:                      %d\n", ssdb->version);
-	pr_info("sensor_card_sku:              %d\n", ssdb->sensor_card_sku);
-	pr_info("csi2_data_stream_interface:\n");
-	print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-		       ssdb->csi2_data_stream_interface,
-		       sizeof(ssdb->csi2_data_stream_interface), true);
-	pr_info("bdf_value:                    %d\n", ssdb->bdf_value);
-	pr_info("dphy_link_en_fuses:           %d\n", ssdb->dphy_link_en_fuses);
-	pr_info("lanes_clock_division:         %d\n", ssdb->lanes_clock_division);
-	pr_info("link_used:                    %d\n", ssdb->link_used);
-	pr_info("lanes_used:                   %d\n", ssdb->lanes_used);
-	pr_info("csi_rx_dly_cnt_termen_clane:  %d\n", ssdb->csi_rx_dly_cnt_termen_clane);
-	pr_info("csi_rx_dly_cnt_settle_clane:  %d\n", ssdb->csi_rx_dly_cnt_settle_clane);
-	pr_info("csi_rx_dly_cnt_termen_dlane0: %d\n", ssdb->csi_rx_dly_cnt_termen_dlane0);
-	pr_info("csi_rx_dly_cnt_settle_dlane0: %d\n", ssdb->csi_rx_dly_cnt_settle_dlane0);
-	pr_info("csi_rx_dly_cnt_termen_dlane1: %d\n", ssdb->csi_rx_dly_cnt_termen_dlane1);
-	pr_info("csi_rx_dly_cnt_settle_dlane1: %d\n", ssdb->csi_rx_dly_cnt_settle_dlane1);
-	pr_info("csi_rx_dly_cnt_termen_dlane2: %d\n", ssdb->csi_rx_dly_cnt_termen_dlane2);
-	pr_info("csi_rx_dly_cnt_settle_dlane2: %d\n", ssdb->csi_rx_dly_cnt_settle_dlane2);
-	pr_info("csi_rx_dly_cnt_termen_dlane3: %d\n", ssdb->csi_rx_dly_cnt_termen_dlane3);
-	pr_info("csi_rx_dly_cnt_settle_dlane3: %d\n", ssdb->csi_rx_dly_cnt_settle_dlane3);
-	pr_info("max_lane_speed:               %d\n", ssdb->max_lane_speed);
-	pr_info("sensor_cal_file_idx:          %d\n", ssdb->sensor_cal_file_idx);
-	pr_info("sensor_cal_file_idx_mbz:\n");
-	print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-		       ssdb->sensor_cal_file_idx_mbz,
-		       sizeof(ssdb->sensor_cal_file_idx_mbz), true);
-	pr_info("rom_type:                     %d\n", ssdb->rom_type);
-	pr_info("vcm_type:                     %d\n", ssdb->vcm_type);
-	pr_info("platform:                     %d\n", ssdb->platform);
-	pr_info("platform_sub:                 %d\n", ssdb->platform_sub);
-	pr_info("flash_support:                %d\n", ssdb->flash_support);
-	pr_info("privacy_led:                  %d\n", ssdb->privacy_led);
-	pr_info("degree:                       %d\n", ssdb->degree);
-	pr_info("mipi_define:                  %d\n", ssdb->mipi_define);
-	pr_info("mclk_speed:                   %d\n", ssdb->mclk_speed);
-	pr_info("control_logic_id:             %d\n", ssdb->control_logic_id);
-	pr_info("mipi_data_format:             %d\n", ssdb->mipi_data_format);
-	pr_info("silicon_version:              %d\n", ssdb->silicon_version);
-	pr_info("customer_id:                  %d\n", ssdb->customer_id);
-	pr_info("mclk_port:                    %d\n", ssdb->mclk_port);
-	pr_info("reserved:\n");
-	print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-		       ssdb->reserved, sizeof(ssdb->reserved), true);
-
-	pr_info("----- excerpt -----\n");
-	pr_info("link_used:     %d\n", ssdb->link_used);
-	pr_info("lanes_used:    %d\n", ssdb->lanes_used);
-	pr_info("vcm_type:      %d\n", ssdb->vcm_type);
-	pr_info("flash_support: %d\n", ssdb->flash_support);
-	pr_info("degree:        %d\n", ssdb->degree);
-	pr_info("mclk_speed:    %d\n", ssdb->mclk_speed);
-	pr_info("mclk_port:     %d\n", ssdb->mclk_port);
-}
-
-static void dump_cldb(struct acpi_device *adev, struct intel_cldb *cldb,
+	dump_info("ACPI SSDB: ---------- %s() ----------\n", __func__);
+
+	print_acpi_entry(cache, "SSDB");
+
+	dump_fields(intel_ssdb_fields, ssdb, ssdb_len, 0);
+
+	dump_info("----- excerpt -----\n");
+	dump_fields(intel_ssdb_fields, ssdb, ssdb_len, IPU_FIELD_SUMMARY);
+}
+
+static void dump_cldb(struct acpi_eval_cache *cache, struct intel_cldb *cldb,
 		      int cldb_len)
 {
-	pr_info("ACPI CLDB: ---------- %s() ----------\n", __func__);
+	dump_info("ACPI CLDB: ---------- %s() ----------\n", __func__);
 
-	print_acpi_entry(adev, "CLDB");
+	print_acpi_entry(cache, "CLDB");
 
-	pr_info("version:            %d\n", cldb->version);
-	pr_info("control_logic_type: %d\n", cldb->control_logic_type);
-	pr_info("control_logic_id:   %d\n", cldb->control_logic_id);
-	pr_info("sensor_card_sku:    %d\n", cldb->sensor_card_sku);
-	pr_info("reserved:\n");
-	print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-		       cldb->reserved, sizeof(cldb->reserved), true);
+	dump_fields(intel_cldb_fields, cldb, cldb_len, 0);
 }
 
 static void print_pmic_type(struct acpi_device *adev, struct intel_cldb *data)
 {
 	switch (data->control_logic_type) {
 	case PMIC_TYPE_DISCRETE:
-		pr_info("ACPI CLDB: PMIC type is %s\n",
-			control_logic_type_list[data->control_logic_type]);
+		dump_info("ACPI CLDB: PMIC type is %s\n",
+			  control_logic_type_list[data->control_logic_type]);
 		break;
 	case PMIC_TYPE_UNKNOWN:
 	case PMIC_TYPE_TPS68470:
@@ -396,8 +495,60 @@ static void print_pmic_type(struct acpi_device *adev, struct intel_cldb *data)
 }
 
 /**
- * get_dsm_data_string - wrapper for acpi_evaluate_dsm()
- * @adev: ACPI device
+ * dsm_get - evaluate _DSM once per device and keep the result
+ * @rec: device record to store the result in
+ * @guid: GUID of requested functions, should be 16 bytes
+ * @dsm_rev: revision number of requested function
+ * @dsm_func: requested function number
+ * @type: expected ACPI object type
+ *
+ * The returned object is owned by @rec, don't free it.
+ *
+ * Return NULL on failure.
+ */
+static union acpi_object *dsm_get(struct ipu_dev_record *rec,
+				  const guid_t *guid, int dsm_rev, int dsm_func,
+				  acpi_object_type type)
+{
+	struct dsm_result *res;
+	union acpi_object *obj;
+	int i;
+
+	for (i = 0; i < rec->dsm_count; i++) {
+		res = &rec->dsm[i];
+		if (res->guid != guid || res->rev != dsm_rev ||
+		    res->func != dsm_func)
+			continue;
+
+		eval_stats.saved++;
+		return res->obj->type == type ? res->obj : NULL;
+	}
+
+	obj = acpi_evaluate_dsm_typed(rec->cache.adev->handle, guid, dsm_rev,
+				      dsm_func, NULL, type);
+	eval_stats.evaluated++;
+	if (!obj)
+		return NULL;
+
+	if (rec->dsm_count >= ARRAY_SIZE(rec->dsm)) {
+		pr_err("%s(): Too many _DSM results, dropping func %d\n",
+		       __func__, dsm_func);
+		ACPI_FREE(obj);
+		return NULL;
+	}
+
+	res = &rec->dsm[rec->dsm_count++];
+	res->guid = guid;
+	res->rev = dsm_rev;
+	res->func = dsm_func;
+	res->obj = obj;
+
+	return obj;
+}
+
+/**
+ * get_dsm_data_string - wrapper for dsm_get()
+ * @rec: device record to store the result in
  * @guid: GUID of requested functions, should be 16 bytes
  * @dsm_rev: revision number of requested function
  * @dsm_func: requested function number
@@ -407,16 +558,13 @@ static void print_pmic_type(struct acpi_device *adev, struct intel_cldb *data)
  * Return negative values for errors.
  * Return 0 for success.
  */
-static int get_dsm_data_string(struct acpi_device *adev, const guid_t *guid,
+static int get_dsm_data_string(struct ipu_dev_record *rec, const guid_t *guid,
 			       int dsm_rev, int dsm_func,
 			       char *out, unsigned int size)
 {
-	struct acpi_handle *handle = adev->handle;
 	union acpi_object *obj;
-	int ret = 0;
 
-	obj = acpi_evaluate_dsm_typed(handle, guid, dsm_rev, dsm_func,
-				      NULL, ACPI_TYPE_STRING);
+	obj = dsm_get(rec, guid, dsm_rev, dsm_func, ACPI_TYPE_STRING);
 	if (!obj) {
 		pr_debug("%s(): _DSM execution failed. GUID not exist?\n",
 			 __func__);
@@ -426,8 +574,7 @@ static int get_dsm_data_string(struct acpi_device *adev, const guid_t *guid,
 	if (!obj->string.pointer) {
 		pr_err("%s(): Couldn't locate ACPI string pointer\n",
 		       __func__);
-		ret = -ENODEV;
-		goto free_obj;
+		return -ENODEV;
 	}
 
 	/* The length string.length field does not include the terminating
@@ -439,14 +586,12 @@ static int get_dsm_data_string(struct acpi_device *adev, const guid_t *guid,
 	strlcpy(out, obj->string.pointer,
 		min(obj->string.length + 1, size));
 
-free_obj:
-	ACPI_FREE(obj);
-	return ret;
+	return 0;
 }
 
 /**
- * get_dsm_data_integer - wrapper for acpi_evaluate_dsm()
- * @adev: ACPI device
+ * get_dsm_data_integer - wrapper for dsm_get()
+ * @rec: device record to store the result in
  * @guid: GUID of requested functions, should be 16 bytes
  * @dsm_rev: revision number of requested function
  * @dsm_func: requested function number
@@ -455,14 +600,12 @@ free_obj:
  * Return negative values for errors.
  * Return 0 for success.
  */
-static int get_dsm_data_integer(struct acpi_device *adev, const guid_t *guid,
+static int get_dsm_data_integer(struct ipu_dev_record *rec, const guid_t *guid,
 				int dsm_rev, int dsm_func, u64 *out)
 {
-	struct acpi_handle *handle = adev->handle;
 	union acpi_object *obj;
 
-	obj = acpi_evaluate_dsm_typed(handle, guid, dsm_rev, dsm_func,
-				      NULL, ACPI_TYPE_INTEGER);
+	obj = dsm_get(rec, guid, dsm_rev, dsm_func, ACPI_TYPE_INTEGER);
 	if (!obj) {
 		pr_debug("%s(): _DSM execution failed. GUID not exist?\n",
 			 __func__);
@@ -476,57 +619,55 @@ static int get_dsm_data_integer(struct acpi_device *adev, const guid_t *guid,
 	 */
 	*out = obj->integer.value;
 
-	ACPI_FREE(obj);
 	return 0;
 }
 
-static int __dump_subsys_id_dsm(struct acpi_device *adev)
+static int __dump_subsys_id_dsm(struct ipu_dev_record *rec)
 {
 	char id[DSM_STR_BUF_SIZE];
 	int ret;
 
-	ret = get_dsm_data_string(adev, &subsys_id_dsm_guid,
+	ret = get_dsm_data_string(rec, &subsys_id_dsm_guid,
 				  SUBSYS_ID_DSM_REV,
 				  SUBSYS_ID_DSM_RETURN_ID_FUNC,
 				  id, DSM_STR_BUF_SIZE);
 	if (ret) {
-		pr_info("%s(): Couldn't get Subsystem ID. GUID not exist?\n",
-			__func__);
+		dump_info("%s(): Couldn't get Subsystem ID. GUID not exist?\n",
+			  __func__);
 		return 0;
 	}
 
-	pr_info("%s(): Subsystem ID: %s\n", __func__, id);
+	dump_info("%s(): Subsystem ID: %s\n", __func__, id);
 
 	return 0;
 }
 
-static int __dump_i2c_dev_dsm(struct acpi_device *adev)
+static int __dump_i2c_dev_dsm(struct ipu_dev_record *rec,
+			      const struct ipu_crs *crs)
 {
 	u64 dev_amount;
 	int ret;
 	int i;
 
-	ret = get_dsm_data_integer(adev, &i2c_dev_dsm_guid,
+	ret = get_dsm_data_integer(rec, &i2c_dev_dsm_guid,
 				   I2C_DEV_DSM_REV,
 				   I2C_DEV_DSM_DEV_AMOUNT_FUNC,
 				   &dev_amount);
 	if (ret) {
-		pr_info("%s(): Couldn't get i2c dev amount. GUID not exist?\n",
-			__func__);
+		dump_info("%s(): Couldn't get i2c dev amount. GUID not exist?\n",
+			  __func__);
 		return 0;
 	}
 
-	pr_info("%s(): i2c device amount: %llu\n", __func__, dev_amount);
+	dump_info("%s(): i2c device amount: %llu\n", __func__, dev_amount);
 
 	/* dump _DSM data for each device */
 	for (i = 1; i <= dev_amount; i++) {
+		const char *type_name;
 		u64 dev_dsm_data;
-		u16 i2c_bus;
-		u16 i2c_second_byte;
-		u16 i2c_addr;
-		u16 i2c_dev_type;
+		int crs_index;
 
-		ret = get_dsm_data_integer(adev, &i2c_dev_dsm_guid,
+		ret = get_dsm_data_integer(rec, &i2c_dev_dsm_guid,
 					   I2C_DEV_DSM_REV,
 					   I2C_DEV_DSM_DEV_AMOUNT_FUNC + i,
 					   &dev_dsm_data);
@@ -536,54 +677,65 @@ static int __dump_i2c_dev_dsm(struct acpi_device *adev)
 			return -EIO;
 		}
 
-		/* TODO: The original ipu4-acpi subtracts 1 from i2c_bus. Why?
-		 * Not substracting here.
+		/* The bus is N of \_SB.PCI0.I2CN, the I2cSerialBus resource
+		 * source in _CRS, on all the results so far. The original
+		 * ipu4-acpi subtracts 1 from it, probably to get its own
+		 * adapter number, so don't do that here.
 		 * https://github.com/intel/linux-intel-lts/blob/8e69644ab5b84be1400874ac1dbcb4389aa2412c/drivers/media/platform/intel/ipu4-acpi.c#L337
-		 */
-		i2c_bus = (dev_dsm_data >> 24) & 0xff;
-		i2c_second_byte = (dev_dsm_data >> 16) & 0xff;
-		i2c_addr = (dev_dsm_data >> 8) & 0xff;
-		/* The last byte is i2c device type
+		 *
+		 * The device types are the ones of coreboot
 		 * https://github.com/coreboot/coreboot/blob/b38d6bbe1c74309f078915c2d467475bb4144943/src/drivers/intel/mipi_camera/chip.h#L27
-		 * https://github.com/coreboot/coreboot/blob/b38d6bbe1c74309f078915c2d467475bb4144943/src/drivers/intel/mipi_camera/camera.c#L196
 		 */
-		i2c_dev_type = dev_dsm_data & 0xff;
-
-		pr_info("%s(): i2c device _DSM data (%d of %llu): 0x%08llx, bus: 0x%02x, second_byte: 0x%02x, addr: 0x%02x, dev_type: 0x%02x\n",
-			__func__, i, dev_amount, dev_dsm_data,
-			i2c_bus, i2c_second_byte, i2c_addr, i2c_dev_type);
+		type_name = ipu_dsm_code_name(ipu_dsm_i2c_types,
+					      IPU_DSM_I2C_TYPE(dev_dsm_data));
+		crs_index = crs ? ipu_dsm_i2c_crs_index(crs, i - 1,
+							dev_dsm_data) : -1;
+
+		dump_info("%s(): i2c device _DSM data (%d of %llu): 0x%08llx, bus: I2C%llu, addr: 0x%02llx, type: 0x%02llx (%s), _CRS I2cSerialBus: %d\n",
+			  __func__, i, dev_amount, dev_dsm_data,
+			  IPU_DSM_I2C_BUS(dev_dsm_data),
+			  IPU_DSM_I2C_ADDR(dev_dsm_data),
+			  IPU_DSM_I2C_TYPE(dev_dsm_data),
+			  type_name ? type_name : "unknown", crs_index);
+
+		if (crs && crs_index < 0)
+			pr_warn("%s(): i2c device %d: address 0x%02llx is not in _CRS\n",
+				__func__, i, IPU_DSM_I2C_ADDR(dev_dsm_data));
+		else if (crs && crs_index != i - 1)
+			pr_warn("%s(): i2c device %d: address 0x%02llx is I2cSerialBus %d in _CRS, not %d\n",
+				__func__, i, IPU_DSM_I2C_ADDR(dev_dsm_data),
+				crs_index, i - 1);
 	}
 
 	return 0;
 }
 
-static int __dump_discrete_pmic_dsm(struct acpi_device *adev)
+static int __dump_discrete_pmic_dsm(struct ipu_dev_record *rec,
+				    const struct ipu_crs *crs)
 {
 	u64 gpio_pin_amount;
 	int ret;
 	int i;
 
-	ret = get_dsm_data_integer(adev, &pmic_dsm_guid,
+	ret = get_dsm_data_integer(rec, &pmic_dsm_guid,
 				   DISCRETE_PMIC_DSM_REV,
 				   DISCRETE_PMIC_DSM_GPIO_AMOUNT_FUNC,
 				   &gpio_pin_amount);
 	if (ret) {
-		pr_info("%s(): Couldn't get GPIO pin amount func. GUID not exist?\n",
-			__func__);
+		dump_info("%s(): Couldn't get GPIO pin amount func. GUID not exist?\n",
+			  __func__);
 		return 0;
 	}
 
-	pr_info("%s(): GPIO pin amount: %llu\n", __func__, gpio_pin_amount);
+	dump_info("%s(): GPIO pin amount: %llu\n", __func__, gpio_pin_amount);
 
 	/* dump _DSM data for each GPIO pin */
 	for (i = 1; i <= gpio_pin_amount; i++) {
+		const char *type_name;
 		u64 gpio_dsm_data;
-		u16 gpio_first_byte;
-		u16 gpio_second_byte;
-		u16 gpio_pin_num;
-		u16 gpio_last_byte;
+		int crs_index;
 
-		ret = get_dsm_data_integer(adev, &pmic_dsm_guid,
+		ret = get_dsm_data_integer(rec, &pmic_dsm_guid,
 					   DISCRETE_PMIC_DSM_REV,
 					   DISCRETE_PMIC_DSM_GPIO_AMOUNT_FUNC + i,
 					   &gpio_dsm_data);
@@ -593,123 +745,166 @@ static int __dump_discrete_pmic_dsm(struct acpi_device *adev)
 			return -EIO;
 		}
 
-		gpio_first_byte = (gpio_dsm_data >> 24) & 0xff;
-		gpio_second_byte = (gpio_dsm_data >> 16) & 0xff;
-		gpio_pin_num = (gpio_dsm_data >> 8) & 0xff;
-		gpio_last_byte = gpio_dsm_data & 0xff;
-
-		pr_info("%s(): GPIO pin _DSM data (%d of %llu): 0x%08llx, first_byte: 0x%02x, second_byte: 0x%02x, pin_num: 0x%02x, last_byte: 0x%02x\n",
-			__func__, i, gpio_pin_amount, gpio_dsm_data,
-			gpio_first_byte, gpio_second_byte,
-			gpio_pin_num, gpio_last_byte);
+		/* Each value describes the GpioIo at the same index in
+		 * _CRS, like the int3472 driver expects.
+		 */
+		type_name = ipu_dsm_code_name(ipu_dsm_gpio_types,
+					      IPU_DSM_GPIO_TYPE(gpio_dsm_data));
+		crs_index = crs ? ipu_dsm_gpio_crs_index(crs, i - 1,
+							 gpio_dsm_data) : -1;
+
+		dump_info("%s(): GPIO pin _DSM data (%d of %llu): 0x%08llx, pin: 0x%02llx, type: 0x%02llx (%s), active: %s, _CRS GpioIo: %d\n",
+			  __func__, i, gpio_pin_amount, gpio_dsm_data,
+			  IPU_DSM_GPIO_PIN(gpio_dsm_data),
+			  IPU_DSM_GPIO_TYPE(gpio_dsm_data),
+			  type_name ? type_name : "unknown",
+			  IPU_DSM_GPIO_ACTIVE(gpio_dsm_data) ? "high" : "low",
+			  crs_index);
+
+		if (crs && crs_index < 0)
+			pr_warn("%s(): GPIO pin %d: pin 0x%02llx is not in _CRS\n",
+				__func__, i, IPU_DSM_GPIO_PIN(gpio_dsm_data));
+		else if (crs && crs_index != i - 1)
+			pr_warn("%s(): GPIO pin %d: pin 0x%02llx is GpioIo %d in _CRS, not %d\n",
+				__func__, i, IPU_DSM_GPIO_PIN(gpio_dsm_data),
+				crs_index, i - 1);
 	}
 
 	return 0;
 }
 
-static int __dump_dsmb_dsm(struct acpi_device *adev)
+static int __dump_dsmb_dsm(struct ipu_dev_record *rec)
 {
-	struct acpi_handle *handle = adev->handle;
 	union acpi_object *obj;
 
 	/* TODO: abstract this like the other get_dsm_data_{string,integer}?
 	 * but we don't know how much buffer size we should prepare.
 	 */
-	obj = acpi_evaluate_dsm_typed(handle, &dsmb_dsm_guid,
-				      DSMB_DSM_REV,
-				      DSMB_DSM_RETURN_BUF_FUNC,
-				      NULL, ACPI_TYPE_BUFFER);
+	obj = dsm_get(rec, &dsmb_dsm_guid, DSMB_DSM_REV,
+		      DSMB_DSM_RETURN_BUF_FUNC, ACPI_TYPE_BUFFER);
 	if (!obj) {
-		pr_info("%s(): _DSM failed for getting DSMB buffer func. GUID not exist?\n",
-			__func__);
+		dump_info("%s(): _DSM failed for getting DSMB buffer func. GUID not exist?\n",
+			  __func__);
 		return 0;
 	}
 
-	pr_info("%s(): Full raw output of DSMB:\n", __func__);
-	print_hex_dump(KERN_INFO, "", DUMP_PREFIX_OFFSET, 16, 1,
-		       obj->buffer.pointer, obj->buffer.length, true);
-
-	ACPI_FREE(obj);
+	dump_info("%s(): Full raw output of DSMB:\n", __func__);
+	dump_hex(obj->buffer.pointer, obj->buffer.length);
 
 	return 0;
 }
 
-static void dump_dsm(struct acpi_device *adev)
+/**
+ * get_crs - decode the GpioIo and I2cSerialBus resources of _CRS
+ * @cache: per-device evaluation cache
+ *
+ * Return the resources to be freed with kfree(), or NULL if _CRS is
+ * missing or can't be decoded.
+ */
+static struct ipu_crs *get_crs(struct acpi_eval_cache *cache)
+{
+	union acpi_object *obj;
+	struct ipu_crs *crs;
+
+	if (acpi_eval_cache_get(cache, "_CRS", &obj) ||
+	    obj->type != ACPI_TYPE_BUFFER)
+		return NULL;
+
+	crs = kzalloc(sizeof(*crs), GFP_KERNEL);
+	if (!crs)
+		return NULL;
+
+	if (ipu_crs_parse(obj->buffer.pointer, obj->buffer.length, crs)) {
+		pr_warn("_CRS: Couldn't decode the resource template\n");
+		kfree(crs);
+		return NULL;
+	}
+
+	return crs;
+}
+
+static void dump_dsm(struct ipu_dev_record *rec)
 {
+	struct ipu_crs *crs = get_crs(&rec->cache);
+
 	/* Some GUIDs for _DSM may not exist. So, not checking return
 	 * values.
 	 */
-	__dump_subsys_id_dsm(adev);
-	__dump_i2c_dev_dsm(adev);
-	__dump_discrete_pmic_dsm(adev);
-	__dump_dsmb_dsm(adev);
+	__dump_subsys_id_dsm(rec);
+	__dump_i2c_dev_dsm(rec, crs);
+	__dump_discrete_pmic_dsm(rec, crs);
+	__dump_dsmb_dsm(rec);
+
+	kfree(crs);
 }
 
-static int get_acpi_sensor_data(struct acpi_device *adev)
+static int get_acpi_sensor_data(struct ipu_dev_record *rec)
 {
+	struct acpi_eval_cache *cache = &rec->cache;
 	struct intel_ssdb sensor_data;
 	int ssdb_len;
 
-	pr_info("%s(): ==================== %s (Sensor) ====================\n",
-		__func__, dev_name(&adev->dev));
+	dump_info("%s(): ==================== %s (Sensor) ====================\n",
+		  __func__, rec->acpi_dev_name);
 
-	ssdb_len = get_acpi_buf(adev, "SSDB", &sensor_data, sizeof(sensor_data));
+	ssdb_len = get_acpi_buf(cache, "SSDB", &sensor_data, sizeof(sensor_data));
 	if (ssdb_len < 0) {
-		pr_info("%s(): Reading SSDB failed\n", __func__);
+		dump_info("%s(): Reading SSDB failed\n", __func__);
 		return ssdb_len;
 	}
 
-	print_acpi_entry(adev, "_ADR");
-	print_acpi_entry(adev, "_HID");
-	print_acpi_entry(adev, "_CID");
-	print_acpi_entry(adev, "_DDN");
-	print_acpi_entry(adev, "_SUB");
-	print_acpi_entry(adev, "_UID");
+	print_acpi_entry(cache, "_ADR");
+	print_acpi_entry(cache, "_HID");
+	print_acpi_entry(cache, "_CID");
+	print_acpi_entry(cache, "_DDN");
+	print_acpi_entry(cache, "_SUB");
+	print_acpi_entry(cache, "_UID");
 
-	print_acpi_fullpath(adev);
-	pr_info("ACPI device name: %s\n", dev_name(&adev->dev));
-	print_sensor_i2c_dev_name(adev);
-	print_dep_acpi_paths(adev);
+	print_acpi_fullpath(rec);
+	dump_info("ACPI device name: %s\n", rec->acpi_dev_name);
+	print_sensor_i2c_dev_name(rec);
+	print_dep_acpi_paths(rec);
 
-	dump_pld(adev);
-	dump_crs(adev);
-	dump_ssdb(adev, &sensor_data, ssdb_len);
-	dump_dsm(adev);
+	dump_pld(rec);
+	dump_crs(cache);
+	dump_ssdb(cache, &sensor_data, ssdb_len);
+	dump_dsm(rec);
 
 	return 0;
 }
 
-static int get_acpi_pmic_data(struct acpi_device *adev)
+static int get_acpi_pmic_data(struct ipu_dev_record *rec)
 {
+	struct acpi_eval_cache *cache = &rec->cache;
 	struct intel_cldb pmic_data;
 	int cldb_len;
 
-	pr_info("%s(): ==================== %s (PMIC) ====================\n",
-		__func__, dev_name(&adev->dev));
+	dump_info("%s(): ==================== %s (PMIC) ====================\n",
+		  __func__, rec->acpi_dev_name);
 
-	cldb_len = get_acpi_buf(adev, "CLDB", &pmic_data, sizeof(pmic_data));
+	cldb_len = get_acpi_buf(cache, "CLDB", &pmic_data, sizeof(pmic_data));
 	if (cldb_len < 0) {
-		pr_info("%s(): Reading CLDB failed\n", __func__);
+		dump_info("%s(): Reading CLDB failed\n", __func__);
 		return cldb_len;
 	}
 
-	print_acpi_entry(adev, "_ADR");
-	print_acpi_entry(adev, "_HID");
-	print_acpi_entry(adev, "_CID");
-	print_acpi_entry(adev, "_DDN");
-	print_acpi_entry(adev, "_SUB");
-	print_acpi_entry(adev, "_UID");
+	print_acpi_entry(cache, "_ADR");
+	print_acpi_entry(cache, "_HID");
+	print_acpi_entry(cache, "_CID");
+	print_acpi_entry(cache, "_DDN");
+	print_acpi_entry(cache, "_SUB");
+	print_acpi_entry(cache, "_UID");
 
-	print_acpi_fullpath(adev);
-	pr_info("ACPI device name: %s\n", dev_name(&adev->dev));
-	print_pmic_i2c_dev_name(adev, pmic_data.control_logic_type);
-	print_dep_acpi_paths(adev);
+	print_acpi_fullpath(rec);
+	dump_info("ACPI device name: %s\n", rec->acpi_dev_name);
+	print_pmic_i2c_dev_name(rec, pmic_data.control_logic_type);
+	print_dep_acpi_paths(rec);
 
-	dump_pld(adev);
-	dump_crs(adev);
-	dump_cldb(adev, &pmic_data, cldb_len);
-	print_pmic_type(adev, &pmic_data);
-	dump_dsm(adev);
+	dump_pld(rec);
+	dump_crs(cache);
+	dump_cldb(cache, &pmic_data, cldb_len);
+	print_pmic_type(cache->adev, &pmic_data);
+	dump_dsm(rec);
 
 	return 0;
 }
@@ -720,32 +915,48 @@ static struct acpi_driver dump_intel_ipu_data_driver = {
 	.class = DRV_NAME,
 };
 
-static bool is_supported_sensor(struct acpi_device *adev)
+static bool is_supported_sensor(struct acpi_eval_cache *cache)
 {
-	/* check if SSDB is present */
-	if (!acpi_has_method(adev->handle, "SSDB")) {
-		dev_dbg(&adev->dev, "SSDB not found\n");
+	union acpi_object *obj;
+
+	/* check if SSDB is present, the result is reused for decoding */
+	if (acpi_eval_cache_get(cache, "SSDB", &obj) == -ENOENT) {
+		dev_dbg(&cache->adev->dev, "SSDB not found\n");
 		return false;
 	}
 
 	return true;
 }
 
-static bool is_supported_pmic(struct acpi_device *adev)
+static bool is_supported_pmic(struct acpi_eval_cache *cache)
 {
-	/* check if CLDB is present */
-	if (!acpi_has_method(adev->handle, "CLDB")) {
-		dev_dbg(&adev->dev, "CLDB not found\n");
+	union acpi_object *obj;
+
+	/* check if CLDB is present, the result is reused for decoding */
+	if (acpi_eval_cache_get(cache, "CLDB", &obj) == -ENOENT) {
+		dev_dbg(&cache->adev->dev, "CLDB not found\n");
 		return false;
 	}
 
 	return true;
 }
 
+static void free_record(struct ipu_dev_record *rec)
+{
+	int i;
+
+	acpi_eval_cache_free(&rec->cache);
+	ACPI_FREE(rec->pld);
+	for (i = 0; i < rec->dsm_count; i++)
+		ACPI_FREE(rec->dsm[i].obj);
+	kfree(rec);
+}
+
 static int acpi_dev_match_cb(struct device *dev, void *data)
 {
 	struct acpi_device *adev = to_acpi_device(dev);
 	struct device_count *dev_cnt = data;
+	struct ipu_dev_record *rec;
 	int ret;
 
 	/* check if the device really exists */
@@ -759,24 +970,495 @@ static int acpi_dev_match_cb(struct device *dev, void *data)
 		return 0;
 	}
 
-	if (is_supported_sensor(adev)) {
+	rec = kzalloc(sizeof(*rec), GFP_KERNEL);
+	if (!rec)
+		return -ENOMEM;
+
+	rec->cache.adev = adev;
+	strscpy(rec->acpi_dev_name, dev_name(dev), sizeof(rec->acpi_dev_name));
+
+	if (is_supported_sensor(&rec->cache)) {
+		rec->type |= IPU_DEV_SENSOR;
 		dev_cnt->sensor++;
-		get_acpi_sensor_data(adev);
-		pr_info("\n");
+		get_acpi_sensor_data(rec);
+		dump_info("\n");
 	}
 
-	if (is_supported_pmic(adev)) {
+	if (is_supported_pmic(&rec->cache)) {
+		rec->type |= IPU_DEV_PMIC;
 		dev_cnt->pmic++;
-		get_acpi_pmic_data(adev);
-		pr_info("\n");
+		get_acpi_pmic_data(rec);
+		dump_info("\n");
+	}
+
+	if (!rec->type) {
+		free_record(rec);
+		return 0;
+	}
+
+	list_add_tail(&rec->list, &record_list);
+
+	return 0;
+}
+
+static int acpi_dev_match_prefix_cb(struct device *dev, void *data)
+{
+	const char *hid = acpi_device_hid(to_acpi_device(dev));
+	int i;
+
+	for (i = 0; supported_hid_prefix_list[i]; i++) {
+		if (!strncmp(hid, supported_hid_prefix_list[i],
+			     strlen(supported_hid_prefix_list[i])))
+			return acpi_dev_match_cb(dev, data);
+	}
+
+	return 0;
+}
+
+/**
+ * match_supported_hids - call acpi_dev_match_cb() for known _HIDs only
+ * @dev_cnt: device counter passed to acpi_dev_match_cb()
+ *
+ * Matching _HID doesn't run any AML, so only the matched devices get their
+ * _STA, SSDB and CLDB evaluated. The prefixes are compared against the _HID
+ * that the ACPI core read at enumeration, without evaluating anything either.
+ */
+static void match_supported_hids(struct device_count *dev_cnt)
+{
+	struct acpi_device *adev;
+	int i;
+
+	for (i = 0; supported_hid_list[i]; i++) {
+		for_each_acpi_dev_match(adev, supported_hid_list[i], NULL, -1)
+			acpi_dev_match_cb(&adev->dev, dev_cnt);
+	}
+
+	bus_for_each_dev(dump_intel_ipu_data_driver.drv.bus, NULL, dev_cnt,
+			 acpi_dev_match_prefix_cb);
+}
+
+/*
+ * debugfs export
+ */
+struct dump_buf {
+	char *data;
+	size_t len;
+	size_t size;
+	int err;
+};
+
+static struct dentry *debugfs_dir;
+static struct dump_buf json_buf;
+static struct dump_buf bin_buf;
+static struct debugfs_blob_wrapper json_blob;
+static struct debugfs_blob_wrapper bin_blob;
+
+static char *dump_buf_reserve(struct dump_buf *b, size_t len)
+{
+	size_t size;
+	char *data;
+
+	if (b->err)
+		return NULL;
+
+	if (b->len + len > b->size) {
+		size = max_t(size_t, b->size * 2, b->len + len);
+		size = max_t(size_t, size, PAGE_SIZE);
+		data = krealloc(b->data, size, GFP_KERNEL);
+		if (!data) {
+			b->err = -ENOMEM;
+			return NULL;
+		}
+		b->data = data;
+		b->size = size;
+	}
+
+	return b->data + b->len;
+}
+
+static void dump_buf_append(struct dump_buf *b, const void *data, size_t len)
+{
+	char *p;
+
+	if (!len)
+		return;
+
+	p = dump_buf_reserve(b, len);
+	if (!p)
+		return;
+
+	memcpy(p, data, len);
+	b->len += len;
+}
+
+static __printf(2, 3) void dump_buf_printf(struct dump_buf *b,
+					   const char *fmt, ...)
+{
+	va_list args;
+	char *p;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	/* +1 for the terminating NULL written by vsnprintf() */
+	p = dump_buf_reserve(b, len + 1);
+	if (!p)
+		return;
+
+	va_start(args, fmt);
+	vsnprintf(p, len + 1, fmt, args);
+	va_end(args);
+	b->len += len;
+}
+
+static void dump_buf_free(struct dump_buf *b)
+{
+	kfree(b->data);
+	memset(b, 0, sizeof(*b));
+}
+
+/**
+ * acpi_obj_data - get the exportable data of an evaluated object
+ * @obj: ACPI object
+ * @type: pointer to store the ACPI type of the returned data
+ * @len: pointer to store the length of the returned data
+ *
+ * _PLD returns a package with a single buffer, the buffer is returned for
+ * it. Integers are returned as u64 in CPU byte order.
+ *
+ * Return NULL if @obj has no exportable data.
+ */
+static const void *acpi_obj_data(const union acpi_object *obj,
+				 acpi_object_type *type, size_t *len)
+{
+	if (obj->type == ACPI_TYPE_PACKAGE && obj->package.count == 1)
+		obj = &obj->package.elements[0];
+
+	*type = obj->type;
+	switch (obj->type) {
+	case ACPI_TYPE_INTEGER:
+		*len = sizeof(obj->integer.value);
+		return &obj->integer.value;
+	case ACPI_TYPE_STRING:
+		*len = obj->string.length;
+		return obj->string.pointer;
+	case ACPI_TYPE_BUFFER:
+		*len = obj->buffer.length;
+		return obj->buffer.pointer;
+	default:
+		return NULL;
+	}
+}
+
+static void json_string(struct dump_buf *b, const char *str, size_t len)
+{
+	size_t i;
+
+	dump_buf_append(b, "\"", 1);
+	for (i = 0; i < len && str[i]; i++) {
+		unsigned char c = str[i];
+
+		if (c == '"' || c == '\\')
+			dump_buf_printf(b, "\\%c", c);
+		else if (c < 0x20 || c >= 0x7f)
+			dump_buf_printf(b, "\\u%04x", c);
+		else
+			dump_buf_append(b, &c, 1);
+	}
+	dump_buf_append(b, "\"", 1);
+}
+
+static void json_hex(struct dump_buf *b, const u8 *data, size_t len)
+{
+	char *p;
+
+	dump_buf_append(b, "\"", 1);
+	p = dump_buf_reserve(b, len * 2);
+	if (p) {
+		bin2hex(p, data, len);
+		b->len += len * 2;
+	}
+	dump_buf_append(b, "\"", 1);
+}
+
+/* Integers as numbers, strings as strings and buffers as hex strings */
+static void json_acpi_obj(struct dump_buf *b, const union acpi_object *obj)
+{
+	acpi_object_type type;
+	const void *data;
+	size_t len;
+
+	data = acpi_obj_data(obj, &type, &len);
+	if (!data) {
+		dump_buf_printf(b, "null");
+		return;
+	}
+
+	switch (type) {
+	case ACPI_TYPE_INTEGER:
+		dump_buf_printf(b, "%llu", *(const u64 *)data);
+		break;
+	case ACPI_TYPE_STRING:
+		json_string(b, data, len);
+		break;
+	default:
+		json_hex(b, data, len);
+		break;
+	}
+}
+
+static void json_pld(struct dump_buf *b, const struct acpi_pld_info *pld)
+{
+	dump_buf_printf(b, "{\"revision\": %u, \"ignore_color\": %u, \"red\": %u, \"green\": %u, \"blue\": %u, \"width\": %u, \"height\": %u, ",
+			pld->revision, pld->ignore_color, pld->red,
+			pld->green, pld->blue, pld->width, pld->height);
+	dump_buf_printf(b, "\"user_visible\": %u, \"dock\": %u, \"lid\": %u, \"panel\": %u, \"vertical_position\": %u, \"horizontal_position\": %u, \"shape\": %u, ",
+			pld->user_visible, pld->dock, pld->lid, pld->panel,
+			pld->vertical_position, pld->horizontal_position,
+			pld->shape);
+	dump_buf_printf(b, "\"group_orientation\": %u, \"group_token\": %u, \"group_position\": %u, \"bay\": %u, \"ejectable\": %u, \"ospm_eject_required\": %u, ",
+			pld->group_orientation, pld->group_token,
+			pld->group_position, pld->bay, pld->ejectable,
+			pld->ospm_eject_required);
+	dump_buf_printf(b, "\"cabinet_number\": %u, \"card_cage_number\": %u, \"reference\": %u, \"rotation\": %u, \"order\": %u, \"vertical_offset\": %u, \"horizontal_offset\": %u}",
+			pld->cabinet_number, pld->card_cage_number,
+			pld->reference, pld->rotation, pld->order,
+			pld->vertical_offset, pld->horizontal_offset);
+}
+
+static void json_record(struct dump_buf *b, const struct ipu_dev_record *rec)
+{
+	const struct acpi_eval_entry *entry;
+	const struct dsm_result *res;
+	int i;
+
+	dump_buf_printf(b, "    {\n      \"acpi_device_name\": ");
+	json_string(b, rec->acpi_dev_name, sizeof(rec->acpi_dev_name));
+	dump_buf_printf(b, ",\n      \"acpi_path\": ");
+	json_string(b, rec->acpi_path, sizeof(rec->acpi_path));
+	dump_buf_printf(b, ",\n      \"type\": [%s%s%s]",
+			rec->type & IPU_DEV_SENSOR ? "\"sensor\"" : "",
+			rec->type == (IPU_DEV_SENSOR | IPU_DEV_PMIC) ? ", " : "",
+			rec->type & IPU_DEV_PMIC ? "\"pmic\"" : "");
+	dump_buf_printf(b, ",\n      \"i2c_device_name\": ");
+	if (rec->i2c_dev_name[0])
+		json_string(b, rec->i2c_dev_name, sizeof(rec->i2c_dev_name));
+	else
+		dump_buf_printf(b, "null");
+
+	dump_buf_printf(b, ",\n      \"dep\": [");
+	for (i = 0; i < rec->dep_count; i++) {
+		if (i)
+			dump_buf_printf(b, ", ");
+		json_string(b, rec->dep[i], ACPI_PATH_BUF_SIZE);
+	}
+	dump_buf_printf(b, "]");
+
+	/* SSDB, CLDB, _CRS, _PLD, _HID... missing entries are omitted */
+	dump_buf_printf(b, ",\n      \"objects\": {");
+	for (i = 0; i < rec->cache.count; i++) {
+		entry = &rec->cache.entries[i];
+		if (!entry->obj)
+			continue;
+
+		dump_buf_printf(b, "\n        \"%s\": ", entry->path);
+		json_acpi_obj(b, entry->obj);
+		dump_buf_printf(b, ",");
+	}
+	/* drop the trailing comma, if any */
+	if (b->data && b->data[b->len - 1] == ',')
+		b->len--;
+	dump_buf_printf(b, "\n      }");
+
+	dump_buf_printf(b, ",\n      \"pld\": ");
+	if (rec->pld)
+		json_pld(b, rec->pld);
+	else
+		dump_buf_printf(b, "null");
+
+	dump_buf_printf(b, ",\n      \"dsm\": [");
+	for (i = 0; i < rec->dsm_count; i++) {
+		res = &rec->dsm[i];
+		dump_buf_printf(b, "%s\n        {\"guid\": \"%pUl\", \"rev\": %llu, \"func\": %llu, \"value\": ",
+				i ? "," : "", res->guid, res->rev, res->func);
+		json_acpi_obj(b, res->obj);
+		dump_buf_printf(b, "}");
+	}
+	dump_buf_printf(b, "\n      ]\n    }");
+}
+
+static void build_json(struct dump_buf *b)
+{
+	struct ipu_dev_record *rec;
+	bool first = true;
+
+	dump_buf_printf(b, "{\n  \"format_version\": %d,\n  \"driver_version\": \"%s\",\n  \"devices\": [\n",
+			IPU_DUMP_VERSION, DRV_VERSION);
+	list_for_each_entry(rec, &record_list, list) {
+		if (!first)
+			dump_buf_printf(b, ",\n");
+		json_record(b, rec);
+		first = false;
+	}
+	dump_buf_printf(b, "\n  ]\n}\n");
+}
+
+static void bin_tlv(struct dump_buf *b, u16 tag, const void *hdr,
+		    size_t hdr_len, const void *data, size_t len)
+{
+	static const u8 pad[4];
+	struct ipu_dump_tlv tlv = {
+		.tag = cpu_to_le16(tag),
+		.length = cpu_to_le32(hdr_len + len),
+	};
+
+	dump_buf_append(b, &tlv, sizeof(tlv));
+	dump_buf_append(b, hdr, hdr_len);
+	dump_buf_append(b, data, len);
+	dump_buf_append(b, pad, ALIGN(hdr_len + len, 4) - (hdr_len + len));
+}
+
+static void bin_string(struct dump_buf *b, u16 tag, const char *str,
+		       size_t size)
+{
+	bin_tlv(b, tag, NULL, 0, str, strnlen(str, size));
+}
+
+/* Integers are stored as __le64, everything else as raw bytes */
+static void bin_acpi_data(struct dump_buf *b, u16 tag, const void *hdr,
+			  size_t hdr_len, acpi_object_type type,
+			  const void *data, size_t len)
+{
+	__le64 value;
+
+	if (type == ACPI_TYPE_INTEGER) {
+		value = cpu_to_le64(*(const u64 *)data);
+		data = &value;
+	}
+
+	bin_tlv(b, tag, hdr, hdr_len, data, len);
+}
+
+static void bin_record(struct dump_buf *b, const struct ipu_dev_record *rec)
+{
+	const struct acpi_eval_entry *entry;
+	const struct dsm_result *res;
+	__le32 dev_type = cpu_to_le32(rec->type);
+	acpi_object_type type;
+	const void *data;
+	size_t len;
+	int i;
+
+	bin_tlv(b, IPU_DUMP_TAG_DEVICE, NULL, 0, &dev_type, sizeof(dev_type));
+	bin_string(b, IPU_DUMP_TAG_ACPI_DEV_NAME, rec->acpi_dev_name,
+		   sizeof(rec->acpi_dev_name));
+	bin_string(b, IPU_DUMP_TAG_ACPI_PATH, rec->acpi_path,
+		   sizeof(rec->acpi_path));
+	if (rec->i2c_dev_name[0])
+		bin_string(b, IPU_DUMP_TAG_I2C_DEV_NAME, rec->i2c_dev_name,
+			   sizeof(rec->i2c_dev_name));
+	for (i = 0; i < rec->dep_count; i++)
+		bin_string(b, IPU_DUMP_TAG_DEP, rec->dep[i],
+			   ACPI_PATH_BUF_SIZE);
+
+	for (i = 0; i < rec->cache.count; i++) {
+		struct ipu_dump_object hdr = { 0 };
+
+		entry = &rec->cache.entries[i];
+		if (!entry->obj)
+			continue;
+
+		data = acpi_obj_data(entry->obj, &type, &len);
+		if (!data)
+			continue;
+
+		memcpy(hdr.name, entry->path,
+		       min(strlen(entry->path), sizeof(hdr.name)));
+		hdr.type = cpu_to_le32(type);
+		bin_acpi_data(b, IPU_DUMP_TAG_OBJECT, &hdr, sizeof(hdr),
+			      type, data, len);
+	}
+
+	for (i = 0; i < rec->dsm_count; i++) {
+		struct ipu_dump_dsm hdr = { 0 };
+
+		res = &rec->dsm[i];
+		data = acpi_obj_data(res->obj, &type, &len);
+		if (!data)
+			continue;
+
+		memcpy(hdr.guid, res->guid, sizeof(hdr.guid));
+		hdr.rev = cpu_to_le32(res->rev);
+		hdr.func = cpu_to_le32(res->func);
+		hdr.type = cpu_to_le32(type);
+		bin_acpi_data(b, IPU_DUMP_TAG_DSM, &hdr, sizeof(hdr),
+			      type, data, len);
+	}
+}
+
+static void build_bin(struct dump_buf *b)
+{
+	struct ipu_dump_header hdr = {
+		.magic = cpu_to_le32(IPU_DUMP_MAGIC),
+		.version = cpu_to_le32(IPU_DUMP_VERSION),
+	};
+	struct ipu_dev_record *rec;
+	u32 count = 0;
+
+	/* the header is filled in after all the records are appended */
+	dump_buf_append(b, &hdr, sizeof(hdr));
+	list_for_each_entry(rec, &record_list, list) {
+		bin_record(b, rec);
+		count++;
+	}
+
+	if (b->err)
+		return;
+
+	hdr.device_count = cpu_to_le32(count);
+	hdr.size = cpu_to_le32(b->len);
+	memcpy(b->data, &hdr, sizeof(hdr));
+}
+
+static int export_records(void)
+{
+	build_json(&json_buf);
+	build_bin(&bin_buf);
+	if (json_buf.err || bin_buf.err) {
+		pr_err(DRV_NAME ": Failed building debugfs export\n");
+		dump_buf_free(&json_buf);
+		dump_buf_free(&bin_buf);
+		return -ENOMEM;
 	}
 
+	json_blob.data = json_buf.data;
+	json_blob.size = json_buf.len;
+	bin_blob.data = bin_buf.data;
+	bin_blob.size = bin_buf.len;
+
+	debugfs_dir = debugfs_create_dir(DRV_NAME, NULL);
+	debugfs_create_blob("devices.json", 0444, debugfs_dir, &json_blob);
+	debugfs_create_blob("devices.bin", 0444, debugfs_dir, &bin_blob);
+
 	return 0;
 }
 
+static void free_records(void)
+{
+	struct ipu_dev_record *rec, *tmp;
+
+	list_for_each_entry_safe(rec, tmp, &record_list, list) {
+		list_del(&rec->list);
+		free_record(rec);
+	}
+}
+
 static int __init dump_intel_ipu_data_init(void)
 {
 	struct device_count dev_cnt = { 0 };
+	ktime_t start;
 	int ret;
 
 	pr_info(DRV_NAME ": Version %s init\n", DRV_VERSION);
@@ -787,18 +1469,39 @@ static int __init dump_intel_ipu_data_init(void)
 		return ret;
 	}
 
-	/* iterate over all ACPI devices */
-	bus_for_each_dev(dump_intel_ipu_data_driver.drv.bus, NULL, &dev_cnt,
-			 acpi_dev_match_cb);
+	start = ktime_get();
+	if (full_scan) {
+		/* iterate over all ACPI devices */
+		bus_for_each_dev(dump_intel_ipu_data_driver.drv.bus, NULL,
+				 &dev_cnt, acpi_dev_match_cb);
+		pr_info(DRV_NAME ": Full scan took %lld us\n",
+			ktime_us_delta(ktime_get(), start));
+	} else {
+		match_supported_hids(&dev_cnt);
+		pr_info(DRV_NAME ": _HID match took %lld us\n",
+			ktime_us_delta(ktime_get(), start));
+	}
 
 	pr_info(DRV_NAME ": Found %d supported sensor(s)\n", dev_cnt.sensor);
 	pr_info(DRV_NAME ": Found %d supported PMIC(s)\n", dev_cnt.pmic);
+	if (!full_scan && !(dev_cnt.sensor + dev_cnt.pmic))
+		pr_info(DRV_NAME ": Nothing found, try again with full_scan=1\n");
+	pr_info(DRV_NAME ": Evaluated %u ACPI object(s), %u evaluation(s) saved by cache\n",
+		eval_stats.evaluated, eval_stats.saved);
+
+	/* Keep loading even without the export, the log is still useful */
+	if (!export_records())
+		pr_info(DRV_NAME ": Exported to debugfs %s/\n", DRV_NAME);
 
 	return 0;
 }
 
 static void __exit dump_intel_ipu_data_exit(void)
 {
+	debugfs_remove_recursive(debugfs_dir);
+	dump_buf_free(&json_buf);
+	dump_buf_free(&bin_buf);
+	free_records();
 	acpi_bus_unregister_driver(&dump_intel_ipu_data_driver);
 }
 
@@ -5,111 +5,140 @@ struct device_count {
 	int pmic;
 };
 
-/* From coreboot */
-struct intel_ssdb {
-	u8 version;				/* Current version */
-	u8 sensor_card_sku;			/* CRD Board type */
-	u8 csi2_data_stream_interface[16];	/* CSI2 data stream GUID */
-	u16 bdf_value;				/* Bus number of the host
-						 * controller
-						 */
-	u32 dphy_link_en_fuses;			/* Host controller's fuses
-						 * information used to verify
-						 * if link is fused out or not
-						 */
-	u32 lanes_clock_division;		/* Lanes/clock divisions per
-						 * sensor
-						 */
-	u8 link_used;				/* Link used by this sensor
-						 * stream
-						 */
-	u8 lanes_used;				/* Number of lanes connected
-						 * for the sensor
-						 */
-	u32 csi_rx_dly_cnt_termen_clane;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_settle_clane;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_termen_dlane0;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_settle_dlane0;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_termen_dlane1;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_settle_dlane1;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_termen_dlane2;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_settle_dlane2;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_termen_dlane3;	/* MIPI timing information */
-	u32 csi_rx_dly_cnt_settle_dlane3;	/* MIPI timing information */
-	u32 max_lane_speed;			/* Maximum lane speed for
-						 * the sensor
-						 */
-	u8 sensor_cal_file_idx;			/* Legacy field for sensor
-						 * calibration file index
-						 */
-	u8 sensor_cal_file_idx_mbz[3];		/* Legacy field for sensor
-						 * calibration file index
-						 */
-	u8 rom_type;				/* NVM type of the camera
-						 * module
-						 */
-	u8 vcm_type;				/* VCM type of the camera
-						 * module
-						 */
-	u8 platform;				/* Platform information */
-	u8 platform_sub;			/* Platform sub-categories */
-	u8 flash_support;			/* Enable/disable flash
-						 * support
-						 */
-	u8 privacy_led;				/* Privacy LED support */
-	u8 degree;				/* Camera Orientation */
-	u8 mipi_define;				/* MIPI info defined in ACPI or
-						 * sensor driver
-						 */
-	u32 mclk_speed;				/* Clock info for sensor */
-	u8 control_logic_id;			/* PMIC device node used for
-						 * the camera sensor
-						 */
-	u8 mipi_data_format;			/* MIPI data format */
-	u8 silicon_version;			/* Silicon version */
-	u8 customer_id;				/* Customer ID */
-	u8 mclk_port;
-	u8 reserved[13];			/* Pads SSDB out so the binary
-						 * blob in ACPI is the same
-						 * size as seen on other
-						 * firmwares.
-						 */
+/* Distinct ACPI objects evaluated per device (SSDB, CLDB, _ADR, _CRS...) */
+#define ACPI_EVAL_CACHE_SIZE 16
+
+struct acpi_eval_entry {
+	const char *path;
+	union acpi_object *obj;	/* NULL if not found or evaluation failed */
+	int ret;
+};
+
+/* Per-device cache so that each ACPI object is evaluated only once */
+struct acpi_eval_cache {
+	struct acpi_device *adev;
+	struct acpi_eval_entry entries[ACPI_EVAL_CACHE_SIZE];
+	int count;
+};
+
+struct acpi_eval_stats {
+	unsigned int evaluated;
+	unsigned int saved;
+};
+
+#define ACPI_PATH_BUF_SIZE	255
+#define DEV_NAME_BUF_SIZE	32
+#define DEP_MAX			10
+#define DSM_RESULT_MAX		32
+
+enum ipu_dev_type {
+	IPU_DEV_SENSOR = BIT(0),
+	IPU_DEV_PMIC = BIT(1),
+};
+
+struct dsm_result {
+	const guid_t *guid;
+	u64 rev;
+	u64 func;
+	union acpi_object *obj;
+};
+
+/* Everything dumped for one ACPI device, exported through debugfs */
+struct ipu_dev_record {
+	struct list_head list;
+	/* Owns the evaluated objects. cache.adev is only used while scanning. */
+	struct acpi_eval_cache cache;
+	unsigned int type;			/* enum ipu_dev_type flags */
+	char acpi_dev_name[DEV_NAME_BUF_SIZE];
+	char acpi_path[ACPI_PATH_BUF_SIZE];
+	char i2c_dev_name[DEV_NAME_BUF_SIZE];
+	char dep[DEP_MAX][ACPI_PATH_BUF_SIZE];
+	int dep_count;
+	struct acpi_pld_info *pld;
+	struct dsm_result dsm[DSM_RESULT_MAX];
+	int dsm_count;
+};
+
+/*
+ * Binary export (debugfs "devices.bin"): struct ipu_dump_header followed
+ * by TLV entries. Each entry is struct ipu_dump_tlv followed by @length
+ * bytes of payload, padded to 4 bytes. IPU_DUMP_TAG_DEVICE starts a new
+ * device and all the following entries belong to it. Strings are not NUL
+ * terminated. All values are little endian.
+ */
+#define IPU_DUMP_MAGIC		0x44555049	/* "IPUD" */
+#define IPU_DUMP_VERSION	1
+
+struct ipu_dump_header {
+	__le32 magic;
+	__le32 version;
+	__le32 device_count;
+	__le32 size;			/* including this header */
 } __packed;
 
-/* From old chromiumos ACPI data reading implementation */
-struct intel_cldb {
-	u8 version;
-	/* control logic type
-	 * 0: UNKNOWN
-	 * 1: DISCRETE(CRD-D)
-	 * 2: PMIC TPS68470
-	 * 3: PMIC uP6641
-	 */
-	u8 control_logic_type;
-	u8 control_logic_id; /* PMIC device node used for the camera sensor */
-	u8 sensor_card_sku;
-	u8 reserved[28];
+struct ipu_dump_tlv {
+	__le16 tag;
+	__le16 reserved;
+	__le32 length;			/* payload length without padding */
 } __packed;
 
-enum control_logic_type {
-	PMIC_TYPE_UNKNOWN,
-	PMIC_TYPE_DISCRETE,
-	PMIC_TYPE_TPS68470,
-	PMIC_TYPE_UP6641,
+enum ipu_dump_tag {
+	IPU_DUMP_TAG_DEVICE = 1,	/* __le32 enum ipu_dev_type flags */
+	IPU_DUMP_TAG_ACPI_DEV_NAME,	/* string */
+	IPU_DUMP_TAG_ACPI_PATH,		/* string */
+	IPU_DUMP_TAG_I2C_DEV_NAME,	/* string */
+	IPU_DUMP_TAG_DEP,		/* string, one entry per dependency */
+	IPU_DUMP_TAG_OBJECT,		/* struct ipu_dump_object + data */
+	IPU_DUMP_TAG_DSM,		/* struct ipu_dump_dsm + data */
 };
 
-const char *control_logic_type_list[] = {
-	"0: UNKNOWN",
-	"1: DISCRETE(CRD-D)",
-	"2: PMIC TPS68470",
-	"3: PMIC uP6641",
+/*
+ * Data following the object and _DSM headers is __le64 for
+ * ACPI_TYPE_INTEGER and raw bytes for ACPI_TYPE_STRING/ACPI_TYPE_BUFFER.
+ * _PLD is stored as the buffer inside its package.
+ */
+struct ipu_dump_object {
+	char name[4];			/* "SSDB", "_CRS", ... */
+	__le32 type;
+} __packed;
+
+struct ipu_dump_dsm {
+	u8 guid[16];
+	__le32 rev;
+	__le32 func;
+	__le32 type;
+} __packed;
+
+/*
+ * Known _HID of camera sensors and PMICs found on Intel IPU systems. Used
+ * for the fast path that doesn't walk every ACPI device.
+ */
+static const char * const supported_hid_list[] = {
+	/* sensors */
+	"INT33BE",	/* OV5693 */
+	"INT3479",	/* OV5670 */
+	"INT347A",	/* OV8865 */
+	"INT347E",	/* OV7251 */
+	"INT346F",
+	/* PMICs */
+	"INT3472",
+	NULL
+};
+
+/*
+ * _HID prefixes of sensor vendors that name every sensor after the part,
+ * such as OVTI2680 for the OV2680 or OVTI2740 for the OV2740.
+ */
+static const char * const supported_hid_prefix_list[] = {
+	"OVTI",
+	NULL
 };
 
 /*
  * PLD (Physical Device Location) int to string conversion.
  * From drivers/acpi/acpica/utglobal.c
  */
-const char *pld_panel_list[] = {
+static const char * const pld_panel_list[] = {
 	"TOP",
 	"BOTTOM",
 	"LEFT",
@@ -120,21 +149,21 @@ const char *pld_panel_list[] = {
 	NULL
 };
 
-const char *pld_vertical_position_list[] = {
+static const char * const pld_vertical_position_list[] = {
 	"UPPER",
 	"CENTER",
 	"LOWER",
 	NULL
 };
 
-const char *pld_horizontal_position_list[] = {
+static const char * const pld_horizontal_position_list[] = {
 	"LEFT",
 	"CENTER",
 	"RIGHT",
 	NULL
 };
 
-const char *pld_shape_list[] = {
+static const char * const pld_shape_list[] = {
 	"ROUND",
 	"OVAL",
 	"SQUARE",
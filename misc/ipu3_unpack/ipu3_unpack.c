@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Scalar reference, dispatch and the line and frame functions of
+ * ipu3_unpack.h. The SIMD versions are in ipu3_unpack_<isa>.c, each built
+ * with the flags of its instruction set.
+ */
+
+#include <string.h>
+#include "ipu3_unpack_priv.h"
+
+/* Pixels of the preview done at a time, 8 blocks so that it stays in L1 */
+#define PREVIEW_CHUNK	(8 * IPU3_PACKED_BLOCK_PIXELS)
+
+/* 4 pixels are stored in 5 bytes, and a block is 6 of these and one more */
+static void scalar_group(const uint8_t *p, uint16_t *dst)
+{
+	dst[0] = (p[0] | p[1] << 8) & 0x3ff;
+	dst[1] = (p[1] >> 2 | p[2] << 6) & 0x3ff;
+	dst[2] = (p[2] >> 4 | p[3] << 4) & 0x3ff;
+	dst[3] = (p[3] >> 6 | p[4] << 2) & 0x3ff;
+}
+
+static void scalar_blocks16(const uint8_t *src, uint16_t *dst,
+			    unsigned int blocks)
+{
+	unsigned int i;
+
+	for (; blocks; blocks--) {
+		for (i = 0; i < 6; i++)
+			scalar_group(src + 5 * i, dst + 4 * i);
+		dst[24] = ipu3_block_last(src);
+
+		src += IPU3_PACKED_BLOCK_BYTES;
+		dst += IPU3_PACKED_BLOCK_PIXELS;
+	}
+}
+
+static void scalar_blocks8(const uint8_t *src, uint8_t *dst,
+			   unsigned int blocks, unsigned int shift)
+{
+	uint16_t tmp[IPU3_PACKED_BLOCK_PIXELS];
+	unsigned int i, v;
+
+	for (; blocks; blocks--) {
+		scalar_blocks16(src, tmp, 1);
+		for (i = 0; i < IPU3_PACKED_BLOCK_PIXELS; i++) {
+			v = tmp[i] >> shift;
+			dst[i] = v > 255 ? 255 : v;
+		}
+
+		src += IPU3_PACKED_BLOCK_BYTES;
+		dst += IPU3_PACKED_BLOCK_PIXELS;
+	}
+}
+
+static void scalar_bin2x2(const uint16_t *a, const uint16_t *b, uint8_t *dst,
+			  unsigned int count)
+{
+	ipu3_bin2x2_tail(a, b, dst, 0, count);
+}
+
+const struct ipu3_unpack_ops ipu3_unpack_ops_scalar = {
+	.blocks16 = scalar_blocks16,
+	.blocks8 = scalar_blocks8,
+	.bin2x2 = scalar_bin2x2,
+};
+
+static const struct {
+	const char *name;
+	const struct ipu3_unpack_ops *ops;
+} isas[IPU3_UNPACK_ISA_COUNT] = {
+	[IPU3_UNPACK_SCALAR] = { "scalar", &ipu3_unpack_ops_scalar },
+	[IPU3_UNPACK_SSE41] = { "sse4.1", &ipu3_unpack_ops_sse41 },
+	[IPU3_UNPACK_AVX2] = { "avx2", &ipu3_unpack_ops_avx2 },
+	[IPU3_UNPACK_AVX512] = { "avx512", &ipu3_unpack_ops_avx512 },
+};
+
+/* Set on first use, or by ipu3_unpack_set_isa() */
+static int current_isa = -1;
+
+const char *ipu3_unpack_isa_name(enum ipu3_unpack_isa isa)
+{
+	return isa < IPU3_UNPACK_ISA_COUNT ? isas[isa].name : "unknown";
+}
+
+int ipu3_unpack_isa_supported(enum ipu3_unpack_isa isa)
+{
+	__builtin_cpu_init();
+
+	switch (isa) {
+	case IPU3_UNPACK_SCALAR:
+		return 1;
+	case IPU3_UNPACK_SSE41:
+		return __builtin_cpu_supports("sse4.1");
+	case IPU3_UNPACK_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case IPU3_UNPACK_AVX512:
+		/* vpermb is what makes the AVX-512 version worth it */
+		return __builtin_cpu_supports("avx512f") &&
+		       __builtin_cpu_supports("avx512bw") &&
+		       __builtin_cpu_supports("avx512vbmi");
+	default:
+		return 0;
+	}
+}
+
+enum ipu3_unpack_isa ipu3_unpack_best_isa(void)
+{
+	int isa;
+
+	for (isa = IPU3_UNPACK_ISA_COUNT - 1; isa > IPU3_UNPACK_SCALAR; isa--) {
+		if (ipu3_unpack_isa_supported(isa))
+			break;
+	}
+
+	return isa;
+}
+
+int ipu3_unpack_set_isa(enum ipu3_unpack_isa isa)
+{
+	if (!ipu3_unpack_isa_supported(isa))
+		return -1;
+
+	__atomic_store_n(&current_isa, isa, __ATOMIC_RELAXED);
+	return 0;
+}
+
+enum ipu3_unpack_isa ipu3_unpack_get_isa(void)
+{
+	int isa = __atomic_load_n(&current_isa, __ATOMIC_RELAXED);
+
+	if (isa < 0) {
+		isa = ipu3_unpack_best_isa();
+		__atomic_store_n(&current_isa, isa, __ATOMIC_RELAXED);
+	}
+
+	return isa;
+}
+
+static const struct ipu3_unpack_ops *get_ops(void)
+{
+	return isas[ipu3_unpack_get_isa()].ops;
+}
+
+static void line16(const struct ipu3_unpack_ops *ops, const uint8_t *src,
+		   uint16_t *dst, unsigned int width)
+{
+	unsigned int blocks = width / IPU3_PACKED_BLOCK_PIXELS;
+	unsigned int rest = width % IPU3_PACKED_BLOCK_PIXELS;
+	uint16_t tmp[IPU3_PACKED_BLOCK_PIXELS];
+
+	ops->blocks16(src, dst, blocks);
+	if (rest) {
+		ops->blocks16(src + blocks * IPU3_PACKED_BLOCK_BYTES, tmp, 1);
+		memcpy(dst + blocks * IPU3_PACKED_BLOCK_PIXELS, tmp,
+		       rest * sizeof(*tmp));
+	}
+}
+
+static void line8(const struct ipu3_unpack_ops *ops, const uint8_t *src,
+		  uint8_t *dst, unsigned int width, unsigned int shift)
+{
+	unsigned int blocks = width / IPU3_PACKED_BLOCK_PIXELS;
+	unsigned int rest = width % IPU3_PACKED_BLOCK_PIXELS;
+	uint8_t tmp[IPU3_PACKED_BLOCK_PIXELS];
+
+	if (shift > 10)
+		shift = 10;
+
+	ops->blocks8(src, dst, blocks, shift);
+	if (rest) {
+		ops->blocks8(src + blocks * IPU3_PACKED_BLOCK_BYTES, tmp, 1,
+			     shift);
+		memcpy(dst + blocks * IPU3_PACKED_BLOCK_PIXELS, tmp, rest);
+	}
+}
+
+static void preview8(const struct ipu3_unpack_ops *ops, const uint8_t *src0,
+		     const uint8_t *src1, uint8_t *dst, unsigned int width)
+{
+	uint16_t a[PREVIEW_CHUNK], b[PREVIEW_CHUNK];
+	size_t offset;
+	unsigned int x, n;
+
+	for (x = 0; x < width; x += n) {
+		n = width - x < PREVIEW_CHUNK ? width - x : PREVIEW_CHUNK;
+		offset = x / IPU3_PACKED_BLOCK_PIXELS * IPU3_PACKED_BLOCK_BYTES;
+		line16(ops, src0 + offset, a, n);
+		line16(ops, src1 + offset, b, n);
+		ops->bin2x2(a, b, dst + x / 2, n / 2);
+	}
+}
+
+void ipu3_unpack_line16(const uint8_t *src, uint16_t *dst, unsigned int width)
+{
+	line16(get_ops(), src, dst, width);
+}
+
+void ipu3_unpack_line8(const uint8_t *src, uint8_t *dst, unsigned int width,
+		       unsigned int shift)
+{
+	line8(get_ops(), src, dst, width, shift);
+}
+
+void ipu3_unpack_preview8(const uint8_t *src0, const uint8_t *src1,
+			  uint8_t *dst, unsigned int width)
+{
+	preview8(get_ops(), src0, src1, dst, width);
+}
+
+void ipu3_unpack_frame16(const uint8_t *src, size_t src_stride,
+			 uint16_t *dst, size_t dst_stride,
+			 unsigned int width, unsigned int height)
+{
+	const struct ipu3_unpack_ops *ops = get_ops();
+	unsigned int y;
+
+	for (y = 0; y < height; y++)
+		line16(ops, src + y * src_stride,
+		       (uint16_t *)((uint8_t *)dst + y * dst_stride), width);
+}
+
+void ipu3_unpack_frame8(const uint8_t *src, size_t src_stride,
+			uint8_t *dst, size_t dst_stride,
+			unsigned int width, unsigned int height,
+			unsigned int shift)
+{
+	const struct ipu3_unpack_ops *ops = get_ops();
+	unsigned int y;
+
+	for (y = 0; y < height; y++)
+		line8(ops, src + y * src_stride, dst + y * dst_stride, width,
+		      shift);
+}
+
+void ipu3_unpack_preview8_frame(const uint8_t *src, size_t src_stride,
+				uint8_t *dst, size_t dst_stride,
+				unsigned int width, unsigned int height)
+{
+	const struct ipu3_unpack_ops *ops = get_ops();
+	unsigned int y;
+
+	for (y = 0; y + 1 < height; y += 2)
+		preview8(ops, src + y * src_stride,
+			 src + (y + 1) * src_stride, dst + y / 2 * dst_stride,
+			 width);
+}
+
+void ipu3_pack_line16(const uint16_t *src, uint8_t *dst, unsigned int width)
+{
+	unsigned int x, bit;
+	uint16_t v;
+
+	memset(dst, 0, (width + IPU3_PACKED_BLOCK_PIXELS - 1) /
+		       IPU3_PACKED_BLOCK_PIXELS * IPU3_PACKED_BLOCK_BYTES);
+
+	for (x = 0; x < width; x++) {
+		bit = x / IPU3_PACKED_BLOCK_PIXELS * 256 +
+		      x % IPU3_PACKED_BLOCK_PIXELS * 10;
+		v = src[x] & 0x3ff;
+		dst[bit / 8] |= v << bit % 8;
+		dst[bit / 8 + 1] |= v >> (8 - bit % 8);
+	}
+}
@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Unpacking of the IPU3 packed 10-bit Bayer format that the CIO2 writes
+ * for the 10-bit media bus formats (V4L2_PIX_FMT_IPU3_SBGGR10 and the
+ * other orders, "ip3b", "ip3g", "ip3G" and "ip3r"):
+ *
+ * 25 pixels are stored in each 32-byte block, pixel i at bits
+ * [10 * i + 9 : 10 * i] of the little-endian 256-bit block, and the last
+ * 6 bits are unused. A line is padded to a multiple of 64 bytes.
+ *
+ * There is a scalar version and SSE4.1, AVX2 and AVX-512 ones of each
+ * function, the best one for the CPU is used unless ipu3_unpack_set_isa()
+ * says otherwise. All give the same results.
+ */
+#ifndef IPU3_UNPACK_H
+#define IPU3_UNPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IPU3_PACKED_BLOCK_BYTES		32
+#define IPU3_PACKED_BLOCK_PIXELS	25
+
+enum ipu3_unpack_isa {
+	IPU3_UNPACK_SCALAR,
+	IPU3_UNPACK_SSE41,
+	IPU3_UNPACK_AVX2,
+	IPU3_UNPACK_AVX512,
+	IPU3_UNPACK_ISA_COUNT,
+};
+
+/* Bytes per line of the CIO2 for @width pixels, the same as the driver */
+static inline size_t ipu3_packed_bpl(unsigned int width)
+{
+	return (width + 49) / 50 * 64;
+}
+
+const char *ipu3_unpack_isa_name(enum ipu3_unpack_isa isa);
+
+/* Return 1 if @isa can run on this CPU */
+int ipu3_unpack_isa_supported(enum ipu3_unpack_isa isa);
+
+/* The best supported one */
+enum ipu3_unpack_isa ipu3_unpack_best_isa(void);
+
+/*
+ * Use @isa for the following calls, in all threads. Return -1 if the CPU
+ * doesn't support it.
+ */
+int ipu3_unpack_set_isa(enum ipu3_unpack_isa isa);
+enum ipu3_unpack_isa ipu3_unpack_get_isa(void);
+
+/*
+ * Unpack a line of @width pixels to 16-bit values (0..1023). The first
+ * DIV_ROUND_UP(@width, 25) * 32 bytes of @src are read.
+ */
+void ipu3_unpack_line16(const uint8_t *src, uint16_t *dst,
+			unsigned int width);
+
+/*
+ * Same to 8-bit values, each pixel shifted right by @shift (2 keeps the 8
+ * most significant bits). Values that don't fit are clamped to 255.
+ */
+void ipu3_unpack_line8(const uint8_t *src, uint8_t *dst, unsigned int width,
+		       unsigned int shift);
+
+/*
+ * 8-bit grey preview at half the size: each 2x2 Bayer quad of the lines
+ * @src0 and @src1 gives one pixel, the sum of its 4 pixels divided by 16.
+ * @width is the width of the source lines, @width / 2 pixels are written.
+ */
+void ipu3_unpack_preview8(const uint8_t *src0, const uint8_t *src1,
+			  uint8_t *dst, unsigned int width);
+
+/* The same for whole frames, strides in bytes */
+void ipu3_unpack_frame16(const uint8_t *src, size_t src_stride,
+			 uint16_t *dst, size_t dst_stride,
+			 unsigned int width, unsigned int height);
+void ipu3_unpack_frame8(const uint8_t *src, size_t src_stride,
+			uint8_t *dst, size_t dst_stride,
+			unsigned int width, unsigned int height,
+			unsigned int shift);
+/* @dst is @width / 2 x @height / 2 */
+void ipu3_unpack_preview8_frame(const uint8_t *src, size_t src_stride,
+				uint8_t *dst, size_t dst_stride,
+				unsigned int width, unsigned int height);
+
+/* Pack 16-bit values back, for tests and synthetic frames */
+void ipu3_pack_line16(const uint16_t *src, uint8_t *dst, unsigned int width);
+
+#endif /* IPU3_UNPACK_H */
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AVX2 version, the same as the SSE4.1 one with two groups of 8 pixels per
+ * register. Two blocks are done at a time so that no lane is wasted: their
+ * 6 groups fill 3 registers and the last pixel of each is done on its own.
+ * Built with -mavx2.
+ */
+
+#include <immintrin.h>
+#include "ipu3_unpack_priv.h"
+
+#define GROUP_SHUFFLE(o) \
+	(o) + 0, (o) + 1, (o) + 1, (o) + 2, (o) + 2, (o) + 3, (o) + 3, \
+	(o) + 4, (o) + 5, (o) + 6, (o) + 6, (o) + 7, (o) + 7, (o) + 8, \
+	(o) + 8, (o) + 9
+
+#define GROUP_MUL \
+	_mm256_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1, \
+			  64, 16, 4, 1, 64, 16, 4, 1)
+
+/* Groups at @lo and @hi, each read as 16 bytes */
+static inline __m256i load2(const uint8_t *lo, const uint8_t *hi)
+{
+	return _mm256_inserti128_si256(
+		_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo)),
+		_mm_loadu_si128((const __m128i *)hi), 1);
+}
+
+static inline __m256i unpack(__m256i v, __m256i shuffle)
+{
+	v = _mm256_shuffle_epi8(v, shuffle);
+	return _mm256_srli_epi16(_mm256_mullo_epi16(v, GROUP_MUL), 6);
+}
+
+/*
+ * Pixels 0-15 of block @a, 16-23 of @a and 0-7 of @b, and 8-23 of @b. The
+ * third group of a block is read from byte 16 so as not to read past it.
+ */
+static inline void unpack_pair(const uint8_t *a, const uint8_t *b,
+			       __m256i *v)
+{
+	const __m256i s00 = _mm256_setr_epi8(GROUP_SHUFFLE(0),
+					     GROUP_SHUFFLE(0));
+	const __m256i s40 = _mm256_setr_epi8(GROUP_SHUFFLE(4),
+					     GROUP_SHUFFLE(0));
+	const __m256i s04 = _mm256_setr_epi8(GROUP_SHUFFLE(0),
+					     GROUP_SHUFFLE(4));
+
+	v[0] = unpack(load2(a, a + 10), s00);
+	v[1] = unpack(load2(a + 16, b), s40);
+	v[2] = unpack(load2(b + 10, b + 16), s04);
+}
+
+/* Pixels 0-15 and 16-23 of a single block */
+static inline void unpack_one(const uint8_t *a, __m256i *v)
+{
+	const __m256i s40 = _mm256_setr_epi8(GROUP_SHUFFLE(4),
+					     GROUP_SHUFFLE(0));
+
+	v[0] = unpack(load2(a, a + 10), _mm256_setr_epi8(GROUP_SHUFFLE(0),
+							 GROUP_SHUFFLE(0)));
+	v[1] = unpack(_mm256_castsi128_si256(
+			      _mm_loadu_si128((const __m128i *)(a + 16))), s40);
+}
+
+static void avx2_blocks16(const uint8_t *src, uint16_t *dst,
+			  unsigned int blocks)
+{
+	__m256i v[3];
+
+	for (; blocks >= 2; blocks -= 2) {
+		unpack_pair(src, src + 32, v);
+		_mm256_storeu_si256((__m256i *)dst, v[0]);
+		_mm_storeu_si128((__m128i *)(dst + 16),
+				 _mm256_castsi256_si128(v[1]));
+		dst[24] = ipu3_block_last(src);
+		_mm_storeu_si128((__m128i *)(dst + 25),
+				 _mm256_extracti128_si256(v[1], 1));
+		_mm256_storeu_si256((__m256i *)(dst + 33), v[2]);
+		dst[49] = ipu3_block_last(src + 32);
+
+		src += 2 * IPU3_PACKED_BLOCK_BYTES;
+		dst += 2 * IPU3_PACKED_BLOCK_PIXELS;
+	}
+
+	if (blocks) {
+		unpack_one(src, v);
+		_mm256_storeu_si256((__m256i *)dst, v[0]);
+		_mm_storeu_si128((__m128i *)(dst + 16),
+				 _mm256_castsi256_si128(v[1]));
+		dst[24] = ipu3_block_last(src);
+	}
+}
+
+/* The 16 pixels of @v shifted right by @count, clamped to 8 bits */
+static inline __m128i pack8(__m256i v, __m128i count)
+{
+	v = _mm256_srl_epi16(v, count);
+	return _mm_packus_epi16(_mm256_castsi256_si128(v),
+				_mm256_extracti128_si256(v, 1));
+}
+
+static inline uint8_t last8(const uint8_t *block, unsigned int shift)
+{
+	unsigned int v = ipu3_block_last(block) >> shift;
+
+	return v > 255 ? 255 : v;
+}
+
+static void avx2_blocks8(const uint8_t *src, uint8_t *dst,
+			 unsigned int blocks, unsigned int shift)
+{
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	__m256i v[3];
+	__m128i p;
+
+	for (; blocks >= 2; blocks -= 2) {
+		unpack_pair(src, src + 32, v);
+		_mm_storeu_si128((__m128i *)dst, pack8(v[0], count));
+		p = pack8(v[1], count);
+		_mm_storel_epi64((__m128i *)(dst + 16), p);
+		dst[24] = last8(src, shift);
+		_mm_storel_epi64((__m128i *)(dst + 25), _mm_srli_si128(p, 8));
+		_mm_storeu_si128((__m128i *)(dst + 33), pack8(v[2], count));
+		dst[49] = last8(src + 32, shift);
+
+		src += 2 * IPU3_PACKED_BLOCK_BYTES;
+		dst += 2 * IPU3_PACKED_BLOCK_PIXELS;
+	}
+
+	if (blocks) {
+		unpack_one(src, v);
+		_mm_storeu_si128((__m128i *)dst, pack8(v[0], count));
+		_mm_storel_epi64((__m128i *)(dst + 16), pack8(v[1], count));
+		dst[24] = last8(src, shift);
+	}
+}
+
+static inline __m256i sum2(const uint16_t *a, const uint16_t *b)
+{
+	return _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)a),
+				_mm256_loadu_si256((const __m256i *)b));
+}
+
+static void avx2_bin2x2(const uint16_t *a, const uint16_t *b, uint8_t *dst,
+			unsigned int count)
+{
+	__m256i s0, s1, s2, s3;
+	unsigned int i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		s0 = sum2(a + 2 * i, b + 2 * i);
+		s1 = sum2(a + 2 * i + 16, b + 2 * i + 16);
+		s2 = sum2(a + 2 * i + 32, b + 2 * i + 32);
+		s3 = sum2(a + 2 * i + 48, b + 2 * i + 48);
+		/* hadd and packus work within each 128-bit lane */
+		s0 = _mm256_permute4x64_epi64(_mm256_hadd_epi16(s0, s1), 0xd8);
+		s2 = _mm256_permute4x64_epi64(_mm256_hadd_epi16(s2, s3), 0xd8);
+		s0 = _mm256_packus_epi16(_mm256_srli_epi16(s0, 4),
+					 _mm256_srli_epi16(s2, 4));
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_permute4x64_epi64(s0, 0xd8));
+	}
+
+	ipu3_bin2x2_tail(a, b, dst, i, count);
+}
+
+const struct ipu3_unpack_ops ipu3_unpack_ops_avx2 = {
+	.blocks16 = avx2_blocks16,
+	.blocks8 = avx2_blocks8,
+	.bin2x2 = avx2_bin2x2,
+};
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AVX-512 version, for CPUs with AVX512BW and AVX512VBMI (Ice Lake and
+ * later). Two blocks (64 bytes, 50 pixels) are loaded in one register and
+ * vpermb gathers the 2 bytes of each pixel in its 16-bit lane, across the
+ * whole register, then vpsrlvw shifts each lane by its own amount: pixels
+ * 0-31 in one register, 32-49 in another one and no pixel on its own.
+ * Built with -mavx512f -mavx512bw -mavx512vbmi.
+ */
+
+#include <immintrin.h>
+#include "ipu3_unpack_priv.h"
+
+/* Pixel @j of 2 blocks: the bytes that hold it and its bit in them */
+#define PIX_BYTE(j)	(32 * ((j) / 25) + 10 * ((j) % 25) / 8)
+#define PIX(j)		PIX_BYTE(j), PIX_BYTE(j) + 1
+#define PIX_SHIFT(j)	(2 * ((j) % 25 % 4))
+
+#define PIX4(j)		PIX(j), PIX(j + 1), PIX(j + 2), PIX(j + 3)
+#define PIX_SHIFT4(j)	PIX_SHIFT(j), PIX_SHIFT(j + 1), PIX_SHIFT(j + 2), \
+			PIX_SHIFT(j + 3)
+
+/* The lanes past pixel 49 in the second register are unused */
+static const uint8_t perm_lo[64] __attribute__((aligned(64))) = {
+	PIX4(0), PIX4(4), PIX4(8), PIX4(12),
+	PIX4(16), PIX4(20), PIX4(24), PIX4(28),
+};
+static const uint8_t perm_hi[64] __attribute__((aligned(64))) = {
+	PIX4(32), PIX4(36), PIX4(40), PIX4(44), PIX(48), PIX(49),
+};
+static const uint16_t shift_lo[32] __attribute__((aligned(64))) = {
+	PIX_SHIFT4(0), PIX_SHIFT4(4), PIX_SHIFT4(8), PIX_SHIFT4(12),
+	PIX_SHIFT4(16), PIX_SHIFT4(20), PIX_SHIFT4(24), PIX_SHIFT4(28),
+};
+static const uint16_t shift_hi[32] __attribute__((aligned(64))) = {
+	PIX_SHIFT4(32), PIX_SHIFT4(36), PIX_SHIFT4(40), PIX_SHIFT4(44),
+	PIX_SHIFT(48), PIX_SHIFT(49),
+};
+
+#define PAIR_MASK_HI	((__mmask32)0x3ffff)		/* pixels 32-49 */
+#define ONE_MASK	((__mmask32)0x1ffffff)		/* pixels 0-24 */
+
+static inline __m512i unpack(__m512i src, const uint8_t *perm,
+			     const uint16_t *shift)
+{
+	__m512i v;
+
+	v = _mm512_permutexvar_epi8(_mm512_load_si512(perm), src);
+	v = _mm512_srlv_epi16(v, _mm512_load_si512(shift));
+	return _mm512_and_si512(v, _mm512_set1_epi16(0x3ff));
+}
+
+static void avx512_blocks16(const uint8_t *src, uint16_t *dst,
+			    unsigned int blocks)
+{
+	__m512i in;
+
+	for (; blocks >= 2; blocks -= 2) {
+		in = _mm512_loadu_si512(src);
+		_mm512_storeu_si512(dst, unpack(in, perm_lo, shift_lo));
+		_mm512_mask_storeu_epi16(dst + 32, PAIR_MASK_HI,
+					 unpack(in, perm_hi, shift_hi));
+
+		src += 2 * IPU3_PACKED_BLOCK_BYTES;
+		dst += 2 * IPU3_PACKED_BLOCK_PIXELS;
+	}
+
+	/* the second block reads as zeroes */
+	if (blocks) {
+		in = _mm512_maskz_loadu_epi8(0xffffffffULL, src);
+		_mm512_mask_storeu_epi16(dst, ONE_MASK,
+					 unpack(in, perm_lo, shift_lo));
+	}
+}
+
+static void avx512_blocks8(const uint8_t *src, uint8_t *dst,
+			   unsigned int blocks, unsigned int shift)
+{
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	__m512i in, v;
+
+	for (; blocks >= 2; blocks -= 2) {
+		in = _mm512_loadu_si512(src);
+		v = _mm512_srl_epi16(unpack(in, perm_lo, shift_lo), count);
+		/* saturating, anything over 255 is clamped */
+		_mm256_storeu_si256((__m256i *)dst, _mm512_cvtusepi16_epi8(v));
+		v = _mm512_srl_epi16(unpack(in, perm_hi, shift_hi), count);
+		_mm512_mask_cvtusepi16_storeu_epi8(dst + 32, PAIR_MASK_HI, v);
+
+		src += 2 * IPU3_PACKED_BLOCK_BYTES;
+		dst += 2 * IPU3_PACKED_BLOCK_PIXELS;
+	}
+
+	if (blocks) {
+		in = _mm512_maskz_loadu_epi8(0xffffffffULL, src);
+		v = _mm512_srl_epi16(unpack(in, perm_lo, shift_lo), count);
+		_mm512_mask_cvtusepi16_storeu_epi8(dst, ONE_MASK, v);
+	}
+}
+
+static void avx512_bin2x2(const uint16_t *a, const uint16_t *b, uint8_t *dst,
+			  unsigned int count)
+{
+	const __m512i ones = _mm512_set1_epi16(1);
+	__m512i s0, s1;
+	unsigned int i;
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		s0 = _mm512_add_epi16(_mm512_loadu_si512(a + 2 * i),
+				      _mm512_loadu_si512(b + 2 * i));
+		s1 = _mm512_add_epi16(_mm512_loadu_si512(a + 2 * i + 32),
+				      _mm512_loadu_si512(b + 2 * i + 32));
+		/* sums of adjacent pairs as 32-bit values */
+		s0 = _mm512_srli_epi32(_mm512_madd_epi16(s0, ones), 4);
+		s1 = _mm512_srli_epi32(_mm512_madd_epi16(s1, ones), 4);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm512_cvtepi32_epi8(s0));
+		_mm_storeu_si128((__m128i *)(dst + i + 16),
+				 _mm512_cvtepi32_epi8(s1));
+	}
+
+	ipu3_bin2x2_tail(a, b, dst, i, count);
+}
+
+const struct ipu3_unpack_ops ipu3_unpack_ops_avx512 = {
+	.blocks16 = avx512_blocks16,
+	.blocks8 = avx512_blocks8,
+	.bin2x2 = avx512_bin2x2,
+};
@@ -0,0 +1,344 @@
+/**
+ * This tool checks every version of ipu3_unpack that the CPU can run
+ * against the scalar one and the packing, then measures how fast each one
+ * unpacks a frame to 16-bit, to 8-bit and to the half size preview.
+ *
+ * The throughput is given in GB/s of packed input, and as the time per
+ * frame, 3264x2448 by default (the full size of the OV8865).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ipu3_unpack.h"
+
+#define DEFAULT_WIDTH		3264
+#define DEFAULT_HEIGHT		2448
+#define DEFAULT_RUNS		50
+
+enum op {
+	OP_UNPACK16,
+	OP_UNPACK8,
+	OP_PREVIEW8,
+	OP_COUNT,
+};
+
+static const char *const op_names[OP_COUNT] = {
+	[OP_UNPACK16] = "unpack16",
+	[OP_UNPACK8] = "unpack8",
+	[OP_PREVIEW8] = "preview8",
+};
+
+struct frame {
+	unsigned int width;
+	unsigned int height;
+	size_t stride;			/* of the packed frame */
+	uint8_t *packed;
+	uint16_t *pixels;		/* what was packed */
+	uint16_t *out16;
+	uint8_t *out8;
+};
+
+/* xorshift32, the frames are the same from one run to the other */
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rnd(void)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int frame_alloc(struct frame *f, unsigned int width,
+		       unsigned int height)
+{
+	size_t pixels = (size_t)width * height;
+	unsigned int y;
+	size_t i;
+
+	f->width = width;
+	f->height = height;
+	f->stride = ipu3_packed_bpl(width);
+	f->packed = malloc(f->stride * height);
+	f->pixels = malloc(pixels * sizeof(*f->pixels));
+	f->out16 = malloc(pixels * sizeof(*f->out16));
+	f->out8 = malloc(pixels);
+	if (!f->packed || !f->pixels || !f->out16 || !f->out8)
+		return -1;
+
+	for (i = 0; i < pixels; i++)
+		f->pixels[i] = rnd() & 0x3ff;
+	/* the end of the lines has to be ignored, fill it with garbage */
+	for (i = 0; i < f->stride * height; i++)
+		f->packed[i] = rnd();
+	for (y = 0; y < height; y++)
+		ipu3_pack_line16(f->pixels + (size_t)y * width,
+				 f->packed + y * f->stride, width);
+
+	return 0;
+}
+
+static void frame_free(struct frame *f)
+{
+	free(f->packed);
+	free(f->pixels);
+	free(f->out16);
+	free(f->out8);
+}
+
+static void run_op(struct frame *f, enum op op, unsigned int shift)
+{
+	switch (op) {
+	case OP_UNPACK16:
+		ipu3_unpack_frame16(f->packed, f->stride, f->out16,
+				    f->width * sizeof(*f->out16), f->width,
+				    f->height);
+		break;
+	case OP_UNPACK8:
+		ipu3_unpack_frame8(f->packed, f->stride, f->out8, f->width,
+				   f->width, f->height, shift);
+		break;
+	default:
+		ipu3_unpack_preview8_frame(f->packed, f->stride, f->out8,
+					   f->width / 2, f->width, f->height);
+		break;
+	}
+}
+
+/* What the output of @op must be at pixel @x, @y */
+static unsigned int expected(const struct frame *f, enum op op,
+			     unsigned int shift, unsigned int x,
+			     unsigned int y)
+{
+	const uint16_t *p = f->pixels;
+	size_t w = f->width;
+	unsigned int v;
+
+	switch (op) {
+	case OP_UNPACK16:
+		return p[y * w + x];
+	case OP_UNPACK8:
+		v = shift > 10 ? 0 : p[y * w + x] >> shift;
+		return v > 255 ? 255 : v;
+	default:
+		x *= 2;
+		y *= 2;
+		return (p[y * w + x] + p[y * w + x + 1] + p[(y + 1) * w + x] +
+			p[(y + 1) * w + x + 1]) >> 4;
+	}
+}
+
+static int check_op(struct frame *f, enum op op, unsigned int shift)
+{
+	unsigned int width = f->width, height = f->height;
+	unsigned int x, y, got, want;
+
+	if (op == OP_PREVIEW8) {
+		width /= 2;
+		height /= 2;
+	}
+
+	memset(f->out16, 0xff, (size_t)f->width * f->height * 2);
+	memset(f->out8, 0xff, (size_t)f->width * f->height);
+	run_op(f, op, shift);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			got = op == OP_UNPACK16 ? f->out16[y * width + x] :
+						  f->out8[y * width + x];
+			want = expected(f, op, shift, x, y);
+			if (got == want)
+				continue;
+			fprintf(stderr,
+				"%s %s %ux%u shift %u: pixel %u,%u is %u, not %u\n",
+				ipu3_unpack_isa_name(ipu3_unpack_get_isa()),
+				op_names[op], f->width, f->height, shift, x, y,
+				got, want);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Every width up to 4 blocks and a few larger ones, so that every mix of
+ * whole blocks, block pairs and partial blocks is done, with all shifts.
+ */
+static int check_isa(void)
+{
+	static const unsigned int widths[] = { 1000, 1024, 1296, 3264 };
+	unsigned int width, shift, i;
+	struct frame f;
+	int ret = 0;
+	enum op op;
+
+	for (i = 1; i <= 100 + sizeof(widths) / sizeof(widths[0]); i++) {
+		width = i <= 100 ? i : widths[i - 101];
+		if (frame_alloc(&f, width, 4)) {
+			frame_free(&f);
+			return -1;
+		}
+		for (op = 0; op < OP_COUNT && !ret; op++) {
+			for (shift = 0; shift <= 12 && !ret; shift++) {
+				if (op != OP_UNPACK8 && shift)
+					break;
+				ret = check_op(&f, op, shift);
+			}
+		}
+		frame_free(&f);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static double bench_op(struct frame *f, enum op op, unsigned int shift,
+		       unsigned int runs)
+{
+	double start, best = 0, t;
+	unsigned int i;
+
+	/* warm up the caches and the page tables of the outputs */
+	run_op(f, op, shift);
+
+	for (i = 0; i < runs; i++) {
+		start = now_s();
+		run_op(f, op, shift);
+		t = now_s() - start;
+		if (!i || t < best)
+			best = t;
+	}
+
+	return best;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-w <width>] [-h <height>] [-n <runs>] [-s <shift>]\n"
+		"          [-i scalar|sse4.1|avx2|avx512] [-c]\n"
+		"  -i  only this version, can be repeated\n"
+		"  -c  only check the results, don't measure\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+	unsigned int runs = DEFAULT_RUNS, shift = 2;
+	double times[IPU3_UNPACK_ISA_COUNT][OP_COUNT];
+	int selected[IPU3_UNPACK_ISA_COUNT] = { 0 };
+	int only = 0, check_only = 0, failed = 0;
+	enum ipu3_unpack_isa isa;
+	struct frame f;
+	double gbs;
+	enum op op;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "w:h:n:s:i:c")) != -1) {
+		switch (opt) {
+		case 'w':
+			width = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			height = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			shift = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			for (isa = 0; isa < IPU3_UNPACK_ISA_COUNT; isa++) {
+				if (!strcmp(optarg, ipu3_unpack_isa_name(isa)))
+					break;
+			}
+			if (isa == IPU3_UNPACK_ISA_COUNT) {
+				usage(argv[0]);
+				return 1;
+			}
+			selected[isa] = 1;
+			only = 1;
+			break;
+		case 'c':
+			check_only = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!width || !height || !runs) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("best version for this CPU: %s\n",
+	       ipu3_unpack_isa_name(ipu3_unpack_best_isa()));
+
+	for (isa = 0; isa < IPU3_UNPACK_ISA_COUNT; isa++) {
+		if (only && !selected[isa])
+			continue;
+		if (ipu3_unpack_set_isa(isa)) {
+			printf("%-8s not supported\n",
+			       ipu3_unpack_isa_name(isa));
+			selected[isa] = 0;
+			continue;
+		}
+		selected[isa] = 1;
+		if (check_isa()) {
+			failed = 1;
+			selected[isa] = 0;
+			continue;
+		}
+		printf("%-8s results ok\n", ipu3_unpack_isa_name(isa));
+	}
+
+	if (check_only || failed)
+		return failed;
+
+	if (frame_alloc(&f, width, height)) {
+		fprintf(stderr, "can't allocate a %ux%u frame\n", width,
+			height);
+		frame_free(&f);
+		return 1;
+	}
+
+	printf("\n%ux%u, %zu bytes per line, best of %u runs\n", width,
+	       height, f.stride, runs);
+	printf("%-8s %-9s %10s %10s %8s\n", "isa", "op", "ms/frame", "GB/s",
+	       "speedup");
+	for (isa = 0; isa < IPU3_UNPACK_ISA_COUNT; isa++) {
+		if (!selected[isa])
+			continue;
+		ipu3_unpack_set_isa(isa);
+		for (op = 0; op < OP_COUNT; op++) {
+			times[isa][op] = bench_op(&f, op, shift, runs);
+			gbs = (double)f.stride * height / times[isa][op] / 1e9;
+			printf("%-8s %-9s %10.3f %10.2f", ipu3_unpack_isa_name(isa),
+			       op_names[op], times[isa][op] * 1e3, gbs);
+			if (selected[IPU3_UNPACK_SCALAR])
+				printf(" %7.2fx", times[IPU3_UNPACK_SCALAR][op] /
+						  times[isa][op]);
+			printf("\n");
+		}
+	}
+
+	frame_free(&f);
+	return 0;
+}
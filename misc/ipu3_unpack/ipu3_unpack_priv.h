@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * What each instruction set provides to ipu3_unpack.c. All functions work
+ * on whole 32-byte blocks and write exactly 25 values per block.
+ */
+#ifndef IPU3_UNPACK_PRIV_H
+#define IPU3_UNPACK_PRIV_H
+
+#include "ipu3_unpack.h"
+
+struct ipu3_unpack_ops {
+	void (*blocks16)(const uint8_t *src, uint16_t *dst,
+			 unsigned int blocks);
+	/* @shift is at most 10 */
+	void (*blocks8)(const uint8_t *src, uint8_t *dst, unsigned int blocks,
+			unsigned int shift);
+	/* dst[i] = (a[2i] + a[2i + 1] + b[2i] + b[2i + 1]) >> 4, i < @count */
+	void (*bin2x2)(const uint16_t *a, const uint16_t *b, uint8_t *dst,
+		       unsigned int count);
+};
+
+extern const struct ipu3_unpack_ops ipu3_unpack_ops_scalar;
+extern const struct ipu3_unpack_ops ipu3_unpack_ops_sse41;
+extern const struct ipu3_unpack_ops ipu3_unpack_ops_avx2;
+extern const struct ipu3_unpack_ops ipu3_unpack_ops_avx512;
+
+/*
+ * The last pixel of a block, at bits [249:240]. The SIMD versions handle
+ * the 24 others in groups of 8 (10 bytes) and this one on its own.
+ */
+static inline uint16_t ipu3_block_last(const uint8_t *block)
+{
+	return (block[30] | block[31] << 8) & 0x3ff;
+}
+
+static inline void ipu3_bin2x2_tail(const uint16_t *a, const uint16_t *b,
+				    uint8_t *dst, unsigned int i,
+				    unsigned int count)
+{
+	for (; i < count; i++)
+		dst[i] = (a[2 * i] + a[2 * i + 1] + b[2 * i] +
+			  b[2 * i + 1]) >> 4;
+}
+
+#endif /* IPU3_UNPACK_PRIV_H */
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * SSE4.1 version: each group of 8 pixels (10 bytes) is unpacked by one
+ * pshufb that puts the 2 bytes holding each pixel in its 16-bit lane, a
+ * multiply that shifts the pixel to the top of the lane and a right shift
+ * by 6. Built with -msse4.1.
+ */
+
+#include <immintrin.h>
+#include "ipu3_unpack_priv.h"
+
+/* The bytes that hold the 8 pixels of a group, starting at byte @o */
+#define GROUP_SHUFFLE(o) \
+	_mm_setr_epi8((o) + 0, (o) + 1, (o) + 1, (o) + 2, (o) + 2, (o) + 3, \
+		      (o) + 3, (o) + 4, (o) + 5, (o) + 6, (o) + 6, (o) + 7, \
+		      (o) + 7, (o) + 8, (o) + 8, (o) + 9)
+
+/* Pixel i of a group is at bit 2 * (i % 4) of its lane, move it to bit 6 */
+#define GROUP_MUL	_mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1)
+
+struct block {
+	__m128i g0, g1, g2;		/* pixels 0-7, 8-15 and 16-23 */
+};
+
+static inline void unpack_block(const uint8_t *src, struct block *b)
+{
+	const __m128i lo = _mm_loadu_si128((const __m128i *)src);
+	const __m128i hi = _mm_loadu_si128((const __m128i *)(src + 16));
+	const __m128i mul = GROUP_MUL;
+
+	b->g0 = _mm_shuffle_epi8(lo, GROUP_SHUFFLE(0));
+	b->g1 = _mm_shuffle_epi8(_mm_alignr_epi8(hi, lo, 10),
+				 GROUP_SHUFFLE(0));
+	b->g2 = _mm_shuffle_epi8(hi, GROUP_SHUFFLE(4));
+
+	b->g0 = _mm_srli_epi16(_mm_mullo_epi16(b->g0, mul), 6);
+	b->g1 = _mm_srli_epi16(_mm_mullo_epi16(b->g1, mul), 6);
+	b->g2 = _mm_srli_epi16(_mm_mullo_epi16(b->g2, mul), 6);
+}
+
+static void sse41_blocks16(const uint8_t *src, uint16_t *dst,
+			   unsigned int blocks)
+{
+	struct block b;
+
+	for (; blocks; blocks--) {
+		unpack_block(src, &b);
+		_mm_storeu_si128((__m128i *)dst, b.g0);
+		_mm_storeu_si128((__m128i *)(dst + 8), b.g1);
+		_mm_storeu_si128((__m128i *)(dst + 16), b.g2);
+		dst[24] = ipu3_block_last(src);
+
+		src += IPU3_PACKED_BLOCK_BYTES;
+		dst += IPU3_PACKED_BLOCK_PIXELS;
+	}
+}
+
+static void sse41_blocks8(const uint8_t *src, uint8_t *dst,
+			  unsigned int blocks, unsigned int shift)
+{
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	unsigned int last;
+	struct block b;
+
+	for (; blocks; blocks--) {
+		unpack_block(src, &b);
+		b.g0 = _mm_srl_epi16(b.g0, count);
+		b.g1 = _mm_srl_epi16(b.g1, count);
+		b.g2 = _mm_srl_epi16(b.g2, count);
+		/* the values are positive, packus clamps them to 255 */
+		_mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(b.g0, b.g1));
+		_mm_storel_epi64((__m128i *)(dst + 16),
+				 _mm_packus_epi16(b.g2, b.g2));
+		last = ipu3_block_last(src) >> shift;
+		dst[24] = last > 255 ? 255 : last;
+
+		src += IPU3_PACKED_BLOCK_BYTES;
+		dst += IPU3_PACKED_BLOCK_PIXELS;
+	}
+}
+
+static void sse41_bin2x2(const uint16_t *a, const uint16_t *b, uint8_t *dst,
+			 unsigned int count)
+{
+	__m128i s0, s1, s2, s3;
+	unsigned int i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		s0 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(a + 2 * i)),
+				   _mm_loadu_si128((const __m128i *)(b + 2 * i)));
+		s1 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(a + 2 * i + 8)),
+				   _mm_loadu_si128((const __m128i *)(b + 2 * i + 8)));
+		s2 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(a + 2 * i + 16)),
+				   _mm_loadu_si128((const __m128i *)(b + 2 * i + 16)));
+		s3 = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(a + 2 * i + 24)),
+				   _mm_loadu_si128((const __m128i *)(b + 2 * i + 24)));
+		/* at most 4 * 1023, no overflow */
+		s0 = _mm_srli_epi16(_mm_hadd_epi16(s0, s1), 4);
+		s2 = _mm_srli_epi16(_mm_hadd_epi16(s2, s3), 4);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(s0, s2));
+	}
+
+	ipu3_bin2x2_tail(a, b, dst, i, count);
+}
+
+const struct ipu3_unpack_ops ipu3_unpack_ops_sse41 = {
+	.blocks16 = sse41_blocks16,
+	.blocks8 = sse41_blocks8,
+	.bin2x2 = sse41_bin2x2,
+};
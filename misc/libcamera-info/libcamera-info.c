@@ -0,0 +1,1345 @@
+/**
+ * This tool dumps the media graphs, V4L2 subdevices and video devices of
+ * the machine as JSON, like libcamera-info.sh but in one process and
+ * without media-ctl.
+ *
+ * Every /dev/media*, /dev/v4l-subdev* and /dev/video* node is opened by a
+ * pool of threads and queried directly:
+ * - media devices: MEDIA_IOC_DEVICE_INFO and MEDIA_IOC_G_TOPOLOGY
+ *   (entities, interfaces, pads and links)
+ * - subdevices: the active format, media bus codes, frame sizes and
+ *   intervals of each pad, and the controls
+ * - video devices: the capabilities, current and supported formats,
+ *   frame sizes, and the controls
+ *
+ * The nodes are printed in order once all are done. The vimc and vivid
+ * drivers provide all of them without any hardware.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include <linux/media.h>
+#include <linux/v4l2-subdev.h>
+#include <linux/videodev2.h>
+
+#define DEV_DIR			"/dev"
+#define MAX_THREADS		64
+#define MAX_PADS		64
+/* bound the enumerations, in case a driver never returns EINVAL */
+#define MAX_ENUM		256
+#define JSON_DEPTH_MAX		16
+#define TOPOLOGY_RETRIES	5
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+/* MEDIA_LNK_FL_LINK_TYPE, which shifts a signed int into the sign bit */
+#define LINK_TYPE_MASK		0xf0000000U
+
+/* Linux 5.18 */
+#ifndef MEDIA_LNK_FL_ANCILLARY_LINK
+#define MEDIA_LNK_FL_ANCILLARY_LINK	(2 << 28)
+#endif
+
+enum node_kind {
+	NODE_MEDIA,
+	NODE_SUBDEV,
+	NODE_VIDEO,
+	NODE_KIND_COUNT,
+};
+
+static const struct {
+	const char *prefix;
+	const char *json_key;
+} node_kinds[NODE_KIND_COUNT] = {
+	[NODE_MEDIA] = { "media", "media_devices" },
+	[NODE_SUBDEV] = { "v4l-subdev", "subdevs" },
+	[NODE_VIDEO] = { "video", "video_devices" },
+};
+
+struct job {
+	char *path;
+	enum node_kind kind;
+	int number;
+	char *out_buf;
+	size_t out_len;
+	int failed;
+};
+
+static struct job *jobs;
+static int job_count;
+static int next_job;
+static int no_controls;
+
+/*
+ * JSON output
+ */
+struct json {
+	FILE *out;
+	int depth;
+	int first[JSON_DEPTH_MAX];
+};
+
+static void json_sep(struct json *j, const char *key)
+{
+	fputs(j->first[j->depth] ? "\n" : ",\n", j->out);
+	j->first[j->depth] = 0;
+	fprintf(j->out, "%*s", 2 * j->depth, "");
+	if (key)
+		fprintf(j->out, "\"%s\": ", key);
+}
+
+static void json_open(struct json *j, const char *key, char c)
+{
+	json_sep(j, key);
+	fputc(c, j->out);
+	if (j->depth < JSON_DEPTH_MAX - 1)
+		j->depth++;
+	j->first[j->depth] = 1;
+}
+
+static void json_close(struct json *j, char c)
+{
+	if (!j->first[j->depth])
+		fprintf(j->out, "\n%*s", 2 * (j->depth - 1), "");
+	j->depth--;
+	fputc(c, j->out);
+}
+
+/* @str is not always terminated in the kernel structs, stop at @len */
+static void json_strn(struct json *j, const char *key, const void *str,
+		      size_t len)
+{
+	const unsigned char *s = str;
+	size_t i;
+
+	json_sep(j, key);
+	fputc('"', j->out);
+	for (i = 0; i < len && s[i]; i++) {
+		if (s[i] == '"' || s[i] == '\\')
+			fprintf(j->out, "\\%c", s[i]);
+		else if (s[i] < 0x20)
+			fprintf(j->out, "\\u%04x", s[i]);
+		else
+			fputc(s[i], j->out);
+	}
+	fputc('"', j->out);
+}
+
+static void json_str(struct json *j, const char *key, const char *str)
+{
+	json_strn(j, key, str, strlen(str));
+}
+
+static void json_int(struct json *j, const char *key, long long val)
+{
+	json_sep(j, key);
+	fprintf(j->out, "%lld", val);
+}
+
+static void json_bool(struct json *j, const char *key, int val)
+{
+	json_sep(j, key);
+	fputs(val ? "true" : "false", j->out);
+}
+
+static void json_error(struct json *j, const char *what, int err)
+{
+	char msg[128];
+
+	snprintf(msg, sizeof(msg), "%s: %s", what, strerror(err));
+	json_str(j, "error", msg);
+}
+
+/*
+ * Names
+ */
+struct name {
+	uint32_t val;
+	const char *name;
+};
+
+#define NAME(prefix, x)		{ prefix##x, #x }
+
+static const struct name entity_functions[] = {
+	NAME(MEDIA_ENT_F_, UNKNOWN),
+	NAME(MEDIA_ENT_F_, V4L2_SUBDEV_UNKNOWN),
+	NAME(MEDIA_ENT_F_, IO_V4L),
+	NAME(MEDIA_ENT_F_, IO_VBI),
+	NAME(MEDIA_ENT_F_, IO_SWRADIO),
+	NAME(MEDIA_ENT_F_, CAM_SENSOR),
+	NAME(MEDIA_ENT_F_, FLASH),
+	NAME(MEDIA_ENT_F_, LENS),
+	NAME(MEDIA_ENT_F_, TUNER),
+	NAME(MEDIA_ENT_F_, ATV_DECODER),
+	NAME(MEDIA_ENT_F_, IF_VID_DECODER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_COMPOSER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_PIXEL_FORMATTER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_PIXEL_ENC_CONV),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_LUT),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_SCALER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_STATISTICS),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_ENCODER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_DECODER),
+	NAME(MEDIA_ENT_F_, PROC_VIDEO_ISP),
+	NAME(MEDIA_ENT_F_, VID_MUX),
+	NAME(MEDIA_ENT_F_, VID_IF_BRIDGE),
+	NAME(MEDIA_ENT_F_, DV_DECODER),
+	NAME(MEDIA_ENT_F_, DV_ENCODER),
+	{ }
+};
+
+static const struct name interface_types[] = {
+	NAME(MEDIA_INTF_T_, V4L_VIDEO),
+	NAME(MEDIA_INTF_T_, V4L_VBI),
+	NAME(MEDIA_INTF_T_, V4L_RADIO),
+	NAME(MEDIA_INTF_T_, V4L_SUBDEV),
+	NAME(MEDIA_INTF_T_, V4L_SWRADIO),
+	NAME(MEDIA_INTF_T_, V4L_TOUCH),
+	NAME(MEDIA_INTF_T_, ALSA_PCM_CAPTURE),
+	NAME(MEDIA_INTF_T_, ALSA_PCM_PLAYBACK),
+	NAME(MEDIA_INTF_T_, ALSA_CONTROL),
+	{ }
+};
+
+static const struct name mbus_codes[] = {
+	NAME(MEDIA_BUS_FMT_, FIXED),
+	NAME(MEDIA_BUS_FMT_, RGB565_1X16),
+	NAME(MEDIA_BUS_FMT_, RGB888_1X24),
+	NAME(MEDIA_BUS_FMT_, ARGB8888_1X32),
+	NAME(MEDIA_BUS_FMT_, UYVY8_2X8),
+	NAME(MEDIA_BUS_FMT_, YUYV8_2X8),
+	NAME(MEDIA_BUS_FMT_, UYVY8_1X16),
+	NAME(MEDIA_BUS_FMT_, VYUY8_1X16),
+	NAME(MEDIA_BUS_FMT_, YUYV8_1X16),
+	NAME(MEDIA_BUS_FMT_, YVYU8_1X16),
+	NAME(MEDIA_BUS_FMT_, YUV8_1X24),
+	NAME(MEDIA_BUS_FMT_, Y8_1X8),
+	NAME(MEDIA_BUS_FMT_, Y10_1X10),
+	NAME(MEDIA_BUS_FMT_, Y12_1X12),
+	NAME(MEDIA_BUS_FMT_, SBGGR8_1X8),
+	NAME(MEDIA_BUS_FMT_, SGBRG8_1X8),
+	NAME(MEDIA_BUS_FMT_, SGRBG8_1X8),
+	NAME(MEDIA_BUS_FMT_, SRGGB8_1X8),
+	NAME(MEDIA_BUS_FMT_, SBGGR10_1X10),
+	NAME(MEDIA_BUS_FMT_, SGBRG10_1X10),
+	NAME(MEDIA_BUS_FMT_, SGRBG10_1X10),
+	NAME(MEDIA_BUS_FMT_, SRGGB10_1X10),
+	NAME(MEDIA_BUS_FMT_, SBGGR12_1X12),
+	NAME(MEDIA_BUS_FMT_, SGBRG12_1X12),
+	NAME(MEDIA_BUS_FMT_, SGRBG12_1X12),
+	NAME(MEDIA_BUS_FMT_, SRGGB12_1X12),
+	NAME(MEDIA_BUS_FMT_, SBGGR16_1X16),
+	NAME(MEDIA_BUS_FMT_, SGBRG16_1X16),
+	NAME(MEDIA_BUS_FMT_, SGRBG16_1X16),
+	NAME(MEDIA_BUS_FMT_, SRGGB16_1X16),
+	NAME(MEDIA_BUS_FMT_, JPEG_1X8),
+	{ }
+};
+
+static const struct name ctrl_types[] = {
+	NAME(V4L2_CTRL_TYPE_, INTEGER),
+	NAME(V4L2_CTRL_TYPE_, BOOLEAN),
+	NAME(V4L2_CTRL_TYPE_, MENU),
+	NAME(V4L2_CTRL_TYPE_, BUTTON),
+	NAME(V4L2_CTRL_TYPE_, INTEGER64),
+	NAME(V4L2_CTRL_TYPE_, CTRL_CLASS),
+	NAME(V4L2_CTRL_TYPE_, STRING),
+	NAME(V4L2_CTRL_TYPE_, BITMASK),
+	NAME(V4L2_CTRL_TYPE_, INTEGER_MENU),
+	NAME(V4L2_CTRL_TYPE_, U8),
+	NAME(V4L2_CTRL_TYPE_, U16),
+	NAME(V4L2_CTRL_TYPE_, U32),
+	{ }
+};
+
+/* flag names of bit masks, printed as an array of strings */
+static const struct name ctrl_flags[] = {
+	NAME(V4L2_CTRL_FLAG_, DISABLED),
+	NAME(V4L2_CTRL_FLAG_, GRABBED),
+	NAME(V4L2_CTRL_FLAG_, READ_ONLY),
+	NAME(V4L2_CTRL_FLAG_, UPDATE),
+	NAME(V4L2_CTRL_FLAG_, INACTIVE),
+	NAME(V4L2_CTRL_FLAG_, SLIDER),
+	NAME(V4L2_CTRL_FLAG_, WRITE_ONLY),
+	NAME(V4L2_CTRL_FLAG_, VOLATILE),
+	NAME(V4L2_CTRL_FLAG_, HAS_PAYLOAD),
+	NAME(V4L2_CTRL_FLAG_, EXECUTE_ON_WRITE),
+	NAME(V4L2_CTRL_FLAG_, MODIFY_LAYOUT),
+	{ }
+};
+
+static const struct name device_caps[] = {
+	NAME(V4L2_CAP_, VIDEO_CAPTURE),
+	NAME(V4L2_CAP_, VIDEO_OUTPUT),
+	NAME(V4L2_CAP_, VIDEO_OVERLAY),
+	NAME(V4L2_CAP_, VBI_CAPTURE),
+	NAME(V4L2_CAP_, VBI_OUTPUT),
+	NAME(V4L2_CAP_, SLICED_VBI_CAPTURE),
+	NAME(V4L2_CAP_, SLICED_VBI_OUTPUT),
+	NAME(V4L2_CAP_, VIDEO_OUTPUT_OVERLAY),
+	NAME(V4L2_CAP_, VIDEO_CAPTURE_MPLANE),
+	NAME(V4L2_CAP_, VIDEO_OUTPUT_MPLANE),
+	NAME(V4L2_CAP_, VIDEO_M2M_MPLANE),
+	NAME(V4L2_CAP_, VIDEO_M2M),
+	NAME(V4L2_CAP_, TUNER),
+	NAME(V4L2_CAP_, AUDIO),
+	NAME(V4L2_CAP_, RADIO),
+	NAME(V4L2_CAP_, MODULATOR),
+	NAME(V4L2_CAP_, SDR_CAPTURE),
+	NAME(V4L2_CAP_, EXT_PIX_FORMAT),
+	NAME(V4L2_CAP_, SDR_OUTPUT),
+	NAME(V4L2_CAP_, META_CAPTURE),
+	NAME(V4L2_CAP_, READWRITE),
+	NAME(V4L2_CAP_, STREAMING),
+	NAME(V4L2_CAP_, META_OUTPUT),
+	NAME(V4L2_CAP_, TOUCH),
+	NAME(V4L2_CAP_, IO_MC),
+	NAME(V4L2_CAP_, DEVICE_CAPS),
+	{ }
+};
+
+static const struct name link_flags[] = {
+	NAME(MEDIA_LNK_FL_, ENABLED),
+	NAME(MEDIA_LNK_FL_, IMMUTABLE),
+	NAME(MEDIA_LNK_FL_, DYNAMIC),
+	{ }
+};
+
+static const char *name_of(const struct name *table, uint32_t val)
+{
+	for (; table->name; table++) {
+		if (table->val == val)
+			return table->name;
+	}
+
+	return NULL;
+}
+
+/* The name of @val, or its hex value */
+static void json_name(struct json *j, const char *key,
+		      const struct name *table, uint32_t val)
+{
+	const char *name = name_of(table, val);
+	char hex[16];
+
+	if (!name) {
+		snprintf(hex, sizeof(hex), "0x%08x", val);
+		name = hex;
+	}
+	json_str(j, key, name);
+}
+
+static void json_flags(struct json *j, const char *key,
+		       const struct name *table, uint32_t flags)
+{
+	char hex[16];
+
+	json_open(j, key, '[');
+	for (; table->name; table++) {
+		if (flags & table->val) {
+			json_str(j, NULL, table->name);
+			flags &= ~table->val;
+		}
+	}
+	if (flags) {
+		snprintf(hex, sizeof(hex), "0x%08x", flags);
+		json_str(j, NULL, hex);
+	}
+	json_close(j, ']');
+}
+
+static void json_fourcc(struct json *j, const char *key, uint32_t fourcc)
+{
+	uint32_t chars = fourcc & ~(1U << 31);
+	char str[8];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		str[i] = (chars >> (8 * i)) & 0xff;
+		if (str[i] < 0x20 || str[i] > 0x7e)
+			str[i] = '.';
+	}
+	str[4] = '\0';
+	if (fourcc & (1U << 31))
+		strcat(str, "-BE");
+	json_str(j, key, str);
+}
+
+static void json_version(struct json *j, const char *key, uint32_t version)
+{
+	char str[16];
+
+	snprintf(str, sizeof(str), "%u.%u.%u", version >> 16,
+		 (version >> 8) & 0xff, version & 0xff);
+	json_str(j, key, str);
+}
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+/* The /dev node of a character device, from its uevent in sysfs */
+static void json_devnode(struct json *j, const char *key, uint32_t major,
+			 uint32_t minor)
+{
+	char path[64], line[256], node[256] = "";
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/sys/dev/char/%u:%u/uevent", major,
+		 minor);
+	f = fopen(path, "r");
+	if (f) {
+		while (fgets(line, sizeof(line), f)) {
+			if (strncmp(line, "DEVNAME=", 8))
+				continue;
+			line[strcspn(line, "\n")] = '\0';
+			snprintf(node, sizeof(node), DEV_DIR "/%s", line + 8);
+			break;
+		}
+		fclose(f);
+	}
+	if (node[0])
+		json_str(j, key, node);
+}
+
+/*
+ * Controls, of subdevices and video devices
+ */
+static void dump_ctrl_value(struct json *j, int fd,
+			    const struct v4l2_query_ext_ctrl *qc)
+{
+	struct v4l2_ext_controls ctrls = { 0 };
+	struct v4l2_ext_control ctrl = { 0 };
+	char *str = NULL;
+
+	if (qc->flags & (V4L2_CTRL_FLAG_WRITE_ONLY | V4L2_CTRL_FLAG_DISABLED))
+		return;
+
+	switch (qc->type) {
+	case V4L2_CTRL_TYPE_INTEGER:
+	case V4L2_CTRL_TYPE_BOOLEAN:
+	case V4L2_CTRL_TYPE_MENU:
+	case V4L2_CTRL_TYPE_INTEGER_MENU:
+	case V4L2_CTRL_TYPE_BITMASK:
+	case V4L2_CTRL_TYPE_INTEGER64:
+		if (qc->nr_of_dims)
+			return;
+		break;
+	case V4L2_CTRL_TYPE_STRING:
+		str = calloc(1, qc->elem_size + 1);
+		if (!str)
+			return;
+		ctrl.string = str;
+		ctrl.size = qc->elem_size;
+		break;
+	default:
+		return;
+	}
+
+	ctrl.id = qc->id;
+	ctrls.which = V4L2_CTRL_WHICH_CUR_VAL;
+	ctrls.count = 1;
+	ctrls.controls = &ctrl;
+	if (xioctl(fd, VIDIOC_G_EXT_CTRLS, &ctrls)) {
+		free(str);
+		return;
+	}
+
+	if (str)
+		json_str(j, "value", str);
+	else if (qc->type == V4L2_CTRL_TYPE_INTEGER64)
+		json_int(j, "value", ctrl.value64);
+	else
+		json_int(j, "value", ctrl.value);
+	free(str);
+}
+
+static void dump_ctrl_menu(struct json *j, int fd,
+			   const struct v4l2_query_ext_ctrl *qc)
+{
+	struct v4l2_querymenu menu;
+	long long i;
+
+	json_open(j, "menu", '[');
+	for (i = qc->minimum; i <= qc->maximum && i - qc->minimum < MAX_ENUM;
+	     i++) {
+		memset(&menu, 0, sizeof(menu));
+		menu.id = qc->id;
+		menu.index = i;
+		/* skipped menu items are not an error */
+		if (xioctl(fd, VIDIOC_QUERYMENU, &menu))
+			continue;
+
+		json_open(j, NULL, '{');
+		json_int(j, "index", i);
+		if (qc->type == V4L2_CTRL_TYPE_MENU)
+			json_strn(j, "name", menu.name, sizeof(menu.name));
+		else
+			json_int(j, "value", menu.value);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_controls(struct json *j, int fd)
+{
+	struct v4l2_query_ext_ctrl qc = { 0 };
+	int n;
+
+	if (no_controls)
+		return;
+
+	json_open(j, "controls", '[');
+	qc.id = V4L2_CTRL_FLAG_NEXT_CTRL | V4L2_CTRL_FLAG_NEXT_COMPOUND;
+	for (n = 0; n < MAX_ENUM && !xioctl(fd, VIDIOC_QUERY_EXT_CTRL, &qc);
+	     n++) {
+		if (qc.type == V4L2_CTRL_TYPE_CTRL_CLASS)
+			goto next;
+
+		json_open(j, NULL, '{');
+		json_int(j, "id", qc.id);
+		json_strn(j, "name", qc.name, sizeof(qc.name));
+		json_name(j, "type", ctrl_types, qc.type);
+		json_int(j, "minimum", qc.minimum);
+		json_int(j, "maximum", qc.maximum);
+		json_int(j, "step", qc.step);
+		json_int(j, "default", qc.default_value);
+		json_flags(j, "flags", ctrl_flags, qc.flags);
+		if (qc.nr_of_dims)
+			json_int(j, "elems", qc.elems);
+		dump_ctrl_value(j, fd, &qc);
+		if (qc.type == V4L2_CTRL_TYPE_MENU ||
+		    qc.type == V4L2_CTRL_TYPE_INTEGER_MENU)
+			dump_ctrl_menu(j, fd, &qc);
+		json_close(j, '}');
+next:
+		qc.id |= V4L2_CTRL_FLAG_NEXT_CTRL |
+			 V4L2_CTRL_FLAG_NEXT_COMPOUND;
+	}
+	json_close(j, ']');
+}
+
+/*
+ * Media devices
+ */
+static void free_topology(struct media_v2_topology *topo)
+{
+	free((void *)(uintptr_t)topo->ptr_entities);
+	free((void *)(uintptr_t)topo->ptr_interfaces);
+	free((void *)(uintptr_t)topo->ptr_pads);
+	free((void *)(uintptr_t)topo->ptr_links);
+	memset(topo, 0, sizeof(*topo));
+}
+
+static void *alloc_array(uint32_t count, size_t size)
+{
+	return calloc(count ? count : 1, size);
+}
+
+/*
+ * Get the counts, then the arrays. The graph can change in between, so
+ * try again until the version stays the same.
+ */
+static int get_topology(int fd, struct media_v2_topology *topo)
+{
+	struct media_v2_topology counts;
+	int i;
+
+	for (i = 0; i < TOPOLOGY_RETRIES; i++) {
+		memset(&counts, 0, sizeof(counts));
+		if (xioctl(fd, MEDIA_IOC_G_TOPOLOGY, &counts))
+			return -errno;
+
+		memset(topo, 0, sizeof(*topo));
+		topo->num_entities = counts.num_entities;
+		topo->num_interfaces = counts.num_interfaces;
+		topo->num_pads = counts.num_pads;
+		topo->num_links = counts.num_links;
+		topo->ptr_entities = (uintptr_t)alloc_array(
+			counts.num_entities, sizeof(struct media_v2_entity));
+		topo->ptr_interfaces = (uintptr_t)alloc_array(
+			counts.num_interfaces,
+			sizeof(struct media_v2_interface));
+		topo->ptr_pads = (uintptr_t)alloc_array(
+			counts.num_pads, sizeof(struct media_v2_pad));
+		topo->ptr_links = (uintptr_t)alloc_array(
+			counts.num_links, sizeof(struct media_v2_link));
+		if (!topo->ptr_entities || !topo->ptr_interfaces ||
+		    !topo->ptr_pads || !topo->ptr_links) {
+			free_topology(topo);
+			return -ENOMEM;
+		}
+
+		if (xioctl(fd, MEDIA_IOC_G_TOPOLOGY, topo)) {
+			/* ENOSPC: the graph grew in between */
+			i = errno == ENOSPC ? i : TOPOLOGY_RETRIES;
+			free_topology(topo);
+			if (i == TOPOLOGY_RETRIES)
+				return -errno;
+			continue;
+		}
+
+		if (topo->topology_version == counts.topology_version)
+			return 0;
+		free_topology(topo);
+	}
+
+	return -EAGAIN;
+}
+
+static const struct media_v2_pad *find_pad(
+	const struct media_v2_topology *topo, uint32_t id)
+{
+	const struct media_v2_pad *pads =
+		(void *)(uintptr_t)topo->ptr_pads;
+	uint32_t i;
+
+	for (i = 0; i < topo->num_pads; i++) {
+		if (pads[i].id == id)
+			return &pads[i];
+	}
+
+	return NULL;
+}
+
+static void dump_pad_end(struct json *j, const char *key,
+			 const struct media_v2_topology *topo, uint32_t id,
+			 int has_index)
+{
+	const struct media_v2_pad *pad = find_pad(topo, id);
+
+	json_open(j, key, '{');
+	json_int(j, "pad_id", id);
+	if (pad) {
+		json_int(j, "entity", pad->entity_id);
+		if (has_index)
+			json_int(j, "pad", pad->index);
+	}
+	json_close(j, '}');
+}
+
+static void dump_entities(struct json *j,
+			  const struct media_v2_topology *topo,
+			  uint32_t media_version)
+{
+	const struct media_v2_entity *ents =
+		(void *)(uintptr_t)topo->ptr_entities;
+	const struct media_v2_pad *pads = (void *)(uintptr_t)topo->ptr_pads;
+	uint32_t i, k;
+
+	json_open(j, "entities", '[');
+	for (i = 0; i < topo->num_entities; i++) {
+		json_open(j, NULL, '{');
+		json_int(j, "id", ents[i].id);
+		json_strn(j, "name", ents[i].name, sizeof(ents[i].name));
+		json_name(j, "function", entity_functions,
+			  ents[i].function);
+		if (MEDIA_V2_ENTITY_HAS_FLAGS(media_version))
+			json_int(j, "flags", ents[i].flags);
+
+		json_open(j, "pads", '[');
+		for (k = 0; k < topo->num_pads; k++) {
+			if (pads[k].entity_id != ents[i].id)
+				continue;
+			json_open(j, NULL, '{');
+			json_int(j, "id", pads[k].id);
+			if (MEDIA_V2_PAD_HAS_INDEX(media_version))
+				json_int(j, "index", pads[k].index);
+			json_str(j, "direction",
+				 pads[k].flags & MEDIA_PAD_FL_SINK ? "sink" :
+				 pads[k].flags & MEDIA_PAD_FL_SOURCE ?
+				 "source" : "none");
+			if (pads[k].flags & MEDIA_PAD_FL_MUST_CONNECT)
+				json_bool(j, "must_connect", 1);
+			json_close(j, '}');
+		}
+		json_close(j, ']');
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_interfaces(struct json *j,
+			    const struct media_v2_topology *topo)
+{
+	const struct media_v2_interface *intfs =
+		(void *)(uintptr_t)topo->ptr_interfaces;
+	uint32_t i;
+
+	json_open(j, "interfaces", '[');
+	for (i = 0; i < topo->num_interfaces; i++) {
+		json_open(j, NULL, '{');
+		json_int(j, "id", intfs[i].id);
+		json_name(j, "type", interface_types, intfs[i].intf_type);
+		json_int(j, "major", intfs[i].devnode.major);
+		json_int(j, "minor", intfs[i].devnode.minor);
+		json_devnode(j, "devnode", intfs[i].devnode.major,
+			     intfs[i].devnode.minor);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_links(struct json *j, const struct media_v2_topology *topo,
+		       uint32_t media_version)
+{
+	const struct media_v2_link *links =
+		(void *)(uintptr_t)topo->ptr_links;
+	int has_index = MEDIA_V2_PAD_HAS_INDEX(media_version);
+	uint32_t i, type;
+
+	json_open(j, "links", '[');
+	for (i = 0; i < topo->num_links; i++) {
+		type = links[i].flags & LINK_TYPE_MASK;
+
+		json_open(j, NULL, '{');
+		json_int(j, "id", links[i].id);
+		if (type == MEDIA_LNK_FL_INTERFACE_LINK) {
+			json_str(j, "type", "interface");
+			json_int(j, "interface", links[i].source_id);
+			json_int(j, "entity", links[i].sink_id);
+		} else if (type == MEDIA_LNK_FL_DATA_LINK) {
+			json_str(j, "type", "data");
+			dump_pad_end(j, "source", topo, links[i].source_id,
+				     has_index);
+			dump_pad_end(j, "sink", topo, links[i].sink_id,
+				     has_index);
+		} else {
+			/* ancillary links are between entities */
+			json_str(j, "type", type == MEDIA_LNK_FL_ANCILLARY_LINK ?
+				 "ancillary" : "unknown");
+			json_int(j, "source", links[i].source_id);
+			json_int(j, "sink", links[i].sink_id);
+		}
+		json_flags(j, "flags", link_flags,
+			   links[i].flags & ~LINK_TYPE_MASK);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static int dump_media(struct json *j, int fd)
+{
+	struct media_device_info info = { 0 };
+	struct media_v2_topology topo;
+	int ret;
+
+	if (xioctl(fd, MEDIA_IOC_DEVICE_INFO, &info)) {
+		json_error(j, "MEDIA_IOC_DEVICE_INFO", errno);
+		return -1;
+	}
+
+	json_strn(j, "driver", info.driver, sizeof(info.driver));
+	json_strn(j, "model", info.model, sizeof(info.model));
+	json_strn(j, "serial", info.serial, sizeof(info.serial));
+	json_strn(j, "bus_info", info.bus_info, sizeof(info.bus_info));
+	json_int(j, "hw_revision", info.hw_revision);
+	json_version(j, "driver_version", info.driver_version);
+	json_version(j, "media_version", info.media_version);
+
+	ret = get_topology(fd, &topo);
+	if (ret) {
+		json_error(j, "MEDIA_IOC_G_TOPOLOGY", -ret);
+		return -1;
+	}
+
+	json_int(j, "topology_version", topo.topology_version);
+	dump_entities(j, &topo, info.media_version);
+	dump_interfaces(j, &topo);
+	dump_links(j, &topo, info.media_version);
+	free_topology(&topo);
+
+	return 0;
+}
+
+/*
+ * Subdevices
+ */
+static void json_mbus_code(struct json *j, uint32_t code)
+{
+	json_int(j, "code", code);
+	json_name(j, "code_name", mbus_codes, code);
+}
+
+static void dump_mbus_format(struct json *j, const char *key,
+			     const struct v4l2_mbus_framefmt *fmt)
+{
+	json_open(j, key, '{');
+	json_mbus_code(j, fmt->code);
+	json_int(j, "width", fmt->width);
+	json_int(j, "height", fmt->height);
+	json_int(j, "field", fmt->field);
+	json_int(j, "colorspace", fmt->colorspace);
+	json_close(j, '}');
+}
+
+static void dump_frame_intervals(struct json *j, int fd, uint32_t pad,
+				 uint32_t code, uint32_t width,
+				 uint32_t height)
+{
+	struct v4l2_subdev_frame_interval_enum fie;
+	int n;
+
+	json_open(j, "intervals", '[');
+	for (n = 0; n < MAX_ENUM; n++) {
+		memset(&fie, 0, sizeof(fie));
+		fie.index = n;
+		fie.pad = pad;
+		fie.code = code;
+		fie.width = width;
+		fie.height = height;
+		fie.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		if (xioctl(fd, VIDIOC_SUBDEV_ENUM_FRAME_INTERVAL, &fie))
+			break;
+
+		json_open(j, NULL, '{');
+		json_int(j, "numerator", fie.interval.numerator);
+		json_int(j, "denominator", fie.interval.denominator);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_frame_sizes(struct json *j, int fd, uint32_t pad,
+			     uint32_t code)
+{
+	struct v4l2_subdev_frame_size_enum fse;
+	int n;
+
+	json_open(j, "sizes", '[');
+	for (n = 0; n < MAX_ENUM; n++) {
+		memset(&fse, 0, sizeof(fse));
+		fse.index = n;
+		fse.pad = pad;
+		fse.code = code;
+		fse.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		if (xioctl(fd, VIDIOC_SUBDEV_ENUM_FRAME_SIZE, &fse))
+			break;
+
+		json_open(j, NULL, '{');
+		json_int(j, "min_width", fse.min_width);
+		json_int(j, "max_width", fse.max_width);
+		json_int(j, "min_height", fse.min_height);
+		json_int(j, "max_height", fse.max_height);
+		if (fse.min_width == fse.max_width &&
+		    fse.min_height == fse.max_height)
+			dump_frame_intervals(j, fd, pad, code, fse.max_width,
+					     fse.max_height);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_mbus_codes(struct json *j, int fd, uint32_t pad)
+{
+	struct v4l2_subdev_mbus_code_enum mce;
+	int n;
+
+	json_open(j, "codes", '[');
+	for (n = 0; n < MAX_ENUM; n++) {
+		memset(&mce, 0, sizeof(mce));
+		mce.index = n;
+		mce.pad = pad;
+		mce.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		if (xioctl(fd, VIDIOC_SUBDEV_ENUM_MBUS_CODE, &mce))
+			break;
+
+		json_open(j, NULL, '{');
+		json_mbus_code(j, mce.code);
+		dump_frame_sizes(j, fd, pad, mce.code);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static void dump_selection(struct json *j, int fd, uint32_t pad,
+			   const char *key, uint32_t target)
+{
+	struct v4l2_subdev_selection sel = { 0 };
+
+	sel.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+	sel.pad = pad;
+	sel.target = target;
+	if (xioctl(fd, VIDIOC_SUBDEV_G_SELECTION, &sel))
+		return;
+
+	json_open(j, key, '{');
+	json_int(j, "left", sel.r.left);
+	json_int(j, "top", sel.r.top);
+	json_int(j, "width", sel.r.width);
+	json_int(j, "height", sel.r.height);
+	json_close(j, '}');
+}
+
+/*
+ * A subdev node doesn't tell its number of pads, so get the format of
+ * each one until the pad number is refused.
+ */
+static int dump_subdev(struct json *j, int fd)
+{
+	struct v4l2_subdev_capability cap = { 0 };
+	struct v4l2_subdev_format fmt;
+	uint32_t pad;
+
+	if (!xioctl(fd, VIDIOC_SUBDEV_QUERYCAP, &cap)) {
+		json_version(j, "version", cap.version);
+		json_bool(j, "read_only",
+			  cap.capabilities & V4L2_SUBDEV_CAP_RO_SUBDEV);
+	}
+
+	json_open(j, "pads", '[');
+	for (pad = 0; pad < MAX_PADS; pad++) {
+		memset(&fmt, 0, sizeof(fmt));
+		fmt.which = V4L2_SUBDEV_FORMAT_ACTIVE;
+		fmt.pad = pad;
+		if (xioctl(fd, VIDIOC_SUBDEV_G_FMT, &fmt))
+			break;
+
+		json_open(j, NULL, '{');
+		json_int(j, "index", pad);
+		dump_mbus_format(j, "format", &fmt.format);
+		dump_selection(j, fd, pad, "crop", V4L2_SEL_TGT_CROP);
+		dump_selection(j, fd, pad, "crop_bounds",
+			       V4L2_SEL_TGT_CROP_BOUNDS);
+		dump_selection(j, fd, pad, "compose", V4L2_SEL_TGT_COMPOSE);
+		dump_mbus_codes(j, fd, pad);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+
+	dump_controls(j, fd);
+	return 0;
+}
+
+/*
+ * Video devices
+ */
+static const struct {
+	uint32_t cap;
+	uint32_t type;
+	const char *name;
+} buf_types[] = {
+	{ V4L2_CAP_VIDEO_CAPTURE, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+	  "video_capture" },
+	{ V4L2_CAP_VIDEO_CAPTURE_MPLANE, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+	  "video_capture_mplane" },
+	{ V4L2_CAP_VIDEO_OUTPUT, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+	  "video_output" },
+	{ V4L2_CAP_VIDEO_OUTPUT_MPLANE, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+	  "video_output_mplane" },
+	{ V4L2_CAP_META_CAPTURE, V4L2_BUF_TYPE_META_CAPTURE,
+	  "meta_capture" },
+	{ V4L2_CAP_META_OUTPUT, V4L2_BUF_TYPE_META_OUTPUT, "meta_output" },
+};
+
+static void dump_video_format(struct json *j, int fd, uint32_t type)
+{
+	struct v4l2_format fmt = { 0 };
+	uint32_t i;
+
+	fmt.type = type;
+	if (xioctl(fd, VIDIOC_G_FMT, &fmt))
+		return;
+
+	json_open(j, "format", '{');
+	switch (type) {
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE:
+	case V4L2_BUF_TYPE_VIDEO_OUTPUT:
+		json_fourcc(j, "fourcc", fmt.fmt.pix.pixelformat);
+		json_int(j, "width", fmt.fmt.pix.width);
+		json_int(j, "height", fmt.fmt.pix.height);
+		json_int(j, "field", fmt.fmt.pix.field);
+		json_int(j, "bytesperline", fmt.fmt.pix.bytesperline);
+		json_int(j, "sizeimage", fmt.fmt.pix.sizeimage);
+		json_int(j, "colorspace", fmt.fmt.pix.colorspace);
+		break;
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE:
+	case V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE:
+		json_fourcc(j, "fourcc", fmt.fmt.pix_mp.pixelformat);
+		json_int(j, "width", fmt.fmt.pix_mp.width);
+		json_int(j, "height", fmt.fmt.pix_mp.height);
+		json_int(j, "field", fmt.fmt.pix_mp.field);
+		json_int(j, "colorspace", fmt.fmt.pix_mp.colorspace);
+		json_open(j, "planes", '[');
+		for (i = 0; i < fmt.fmt.pix_mp.num_planes &&
+			    i < VIDEO_MAX_PLANES; i++) {
+			json_open(j, NULL, '{');
+			json_int(j, "bytesperline",
+				 fmt.fmt.pix_mp.plane_fmt[i].bytesperline);
+			json_int(j, "sizeimage",
+				 fmt.fmt.pix_mp.plane_fmt[i].sizeimage);
+			json_close(j, '}');
+		}
+		json_close(j, ']');
+		break;
+	default:
+		json_fourcc(j, "fourcc", fmt.fmt.meta.dataformat);
+		json_int(j, "buffersize", fmt.fmt.meta.buffersize);
+		break;
+	}
+	json_close(j, '}');
+}
+
+static void dump_frame_sizes_video(struct json *j, int fd, uint32_t fourcc)
+{
+	struct v4l2_frmsizeenum fse;
+	int n;
+
+	json_open(j, "sizes", '[');
+	for (n = 0; n < MAX_ENUM; n++) {
+		memset(&fse, 0, sizeof(fse));
+		fse.index = n;
+		fse.pixel_format = fourcc;
+		if (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fse))
+			break;
+
+		json_open(j, NULL, '{');
+		if (fse.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+			json_int(j, "width", fse.discrete.width);
+			json_int(j, "height", fse.discrete.height);
+		} else {
+			json_int(j, "min_width", fse.stepwise.min_width);
+			json_int(j, "max_width", fse.stepwise.max_width);
+			json_int(j, "step_width", fse.stepwise.step_width);
+			json_int(j, "min_height", fse.stepwise.min_height);
+			json_int(j, "max_height", fse.stepwise.max_height);
+			json_int(j, "step_height", fse.stepwise.step_height);
+		}
+		json_close(j, '}');
+
+		/* stepwise and continuous sizes have a single entry */
+		if (fse.type != V4L2_FRMSIZE_TYPE_DISCRETE)
+			break;
+	}
+	json_close(j, ']');
+}
+
+static void dump_video_formats(struct json *j, int fd, uint32_t type)
+{
+	struct v4l2_fmtdesc desc;
+	int n;
+
+	json_open(j, "formats", '[');
+	for (n = 0; n < MAX_ENUM; n++) {
+		memset(&desc, 0, sizeof(desc));
+		desc.index = n;
+		desc.type = type;
+		if (xioctl(fd, VIDIOC_ENUM_FMT, &desc))
+			break;
+
+		json_open(j, NULL, '{');
+		json_fourcc(j, "fourcc", desc.pixelformat);
+		json_strn(j, "description", desc.description,
+			  sizeof(desc.description));
+		json_int(j, "flags", desc.flags);
+		if (desc.mbus_code)
+			json_mbus_code(j, desc.mbus_code);
+		dump_frame_sizes_video(j, fd, desc.pixelformat);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+}
+
+static int dump_video(struct json *j, int fd)
+{
+	struct v4l2_capability cap = { 0 };
+	uint32_t caps;
+	size_t i;
+
+	if (xioctl(fd, VIDIOC_QUERYCAP, &cap)) {
+		json_error(j, "VIDIOC_QUERYCAP", errno);
+		return -1;
+	}
+
+	caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps :
+							 cap.capabilities;
+	json_strn(j, "driver", cap.driver, sizeof(cap.driver));
+	json_strn(j, "card", cap.card, sizeof(cap.card));
+	json_strn(j, "bus_info", cap.bus_info, sizeof(cap.bus_info));
+	json_version(j, "version", cap.version);
+	json_flags(j, "device_caps", device_caps, caps);
+
+	json_open(j, "buffer_types", '[');
+	for (i = 0; i < ARRAY_SIZE(buf_types); i++) {
+		if (!(caps & buf_types[i].cap))
+			continue;
+
+		json_open(j, NULL, '{');
+		json_str(j, "type", buf_types[i].name);
+		dump_video_format(j, fd, buf_types[i].type);
+		dump_video_formats(j, fd, buf_types[i].type);
+		json_close(j, '}');
+	}
+	json_close(j, ']');
+
+	dump_controls(j, fd);
+	return 0;
+}
+
+/*
+ * Jobs
+ */
+static int open_node(const char *path)
+{
+	int fd;
+
+	fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0 && (errno == EACCES || errno == EPERM || errno == EROFS))
+		fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+	return fd;
+}
+
+static void run_job(struct job *job)
+{
+	struct json j = { 0 };
+	struct stat st;
+	int fd;
+
+	j.out = open_memstream(&job->out_buf, &job->out_len);
+	if (!j.out) {
+		fprintf(stderr, "%s: out of memory\n", job->path);
+		job->failed = 1;
+		return;
+	}
+
+	/* inside the array of the node kind in the top level object */
+	j.depth = 2;
+	j.first[2] = 1;
+	json_open(&j, NULL, '{');
+	json_str(&j, "node", job->path);
+
+	fd = open_node(job->path);
+	if (fd < 0) {
+		json_error(&j, "open", errno);
+		job->failed = 1;
+		goto out;
+	}
+
+	if (!fstat(fd, &st)) {
+		json_int(&j, "major", major(st.st_rdev));
+		json_int(&j, "minor", minor(st.st_rdev));
+	}
+
+	switch (job->kind) {
+	case NODE_MEDIA:
+		job->failed = dump_media(&j, fd) < 0;
+		break;
+	case NODE_SUBDEV:
+		job->failed = dump_subdev(&j, fd) < 0;
+		break;
+	default:
+		job->failed = dump_video(&j, fd) < 0;
+		break;
+	}
+	close(fd);
+out:
+	json_close(&j, '}');
+	fclose(j.out);
+}
+
+static void *worker(void *arg)
+{
+	int i;
+
+	(void)arg;
+
+	while ((i = __atomic_fetch_add(&next_job, 1, __ATOMIC_RELAXED)) <
+	       job_count)
+		run_job(&jobs[i]);
+
+	return NULL;
+}
+
+/* "media1" -> NODE_MEDIA, 1. Return -1 if @name isn't a node we dump. */
+static int node_kind(const char *name, int *number)
+{
+	const char *p;
+	char *end;
+	int k;
+
+	for (k = 0; k < NODE_KIND_COUNT; k++) {
+		if (strncmp(name, node_kinds[k].prefix,
+			    strlen(node_kinds[k].prefix)))
+			continue;
+		p = name + strlen(node_kinds[k].prefix);
+		if (*p < '0' || *p > '9')
+			continue;
+		*number = strtol(p, &end, 10);
+		if (*end)
+			continue;
+		return k;
+	}
+
+	return -1;
+}
+
+static int add_job(const char *path)
+{
+	const char *name = strrchr(path, '/');
+	char real[PATH_MAX];
+	struct job *tmp;
+	int kind, number;
+
+	kind = node_kind(name ? name + 1 : path, &number);
+	/* /dev/v4l/by-path/... and other links to a node */
+	if (kind < 0 && realpath(path, real)) {
+		name = strrchr(real, '/');
+		kind = node_kind(name ? name + 1 : real, &number);
+	}
+	if (kind < 0) {
+		fprintf(stderr, "%s: not a media, v4l-subdev or video node\n",
+			path);
+		return -1;
+	}
+
+	tmp = realloc(jobs, (job_count + 1) * sizeof(*jobs));
+	if (!tmp)
+		return -1;
+	jobs = tmp;
+	memset(&jobs[job_count], 0, sizeof(*jobs));
+	jobs[job_count].path = strdup(path);
+	if (!jobs[job_count].path)
+		return -1;
+	jobs[job_count].kind = kind;
+	jobs[job_count].number = number;
+	job_count++;
+
+	return 0;
+}
+
+static int scan_dev_dir(void)
+{
+	char path[PATH_MAX];
+	struct dirent *d;
+	DIR *dir;
+	int number;
+
+	dir = opendir(DEV_DIR);
+	if (!dir) {
+		perror(DEV_DIR);
+		return -1;
+	}
+
+	while ((d = readdir(dir))) {
+		if (node_kind(d->d_name, &number) < 0)
+			continue;
+		snprintf(path, sizeof(path), DEV_DIR "/%s", d->d_name);
+		if (add_job(path)) {
+			closedir(dir);
+			return -1;
+		}
+	}
+	closedir(dir);
+
+	return 0;
+}
+
+static int compare_jobs(const void *a, const void *b)
+{
+	const struct job *ja = a, *jb = b;
+
+	if (ja->kind != jb->kind)
+		return ja->kind - jb->kind;
+	return ja->number - jb->number;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-C] [-t <threads>] [node...]\n"
+		"  without nodes, dump all the " DEV_DIR "/media*, v4l-subdev* and video* nodes\n"
+		"  -C  don't dump the controls\n"
+		"  -t  number of threads, one per node by default\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	int threads = MAX_THREADS;
+	int i, opt, kind, first, failed = 0;
+	pthread_t *tids;
+
+	while ((opt = getopt(argc, argv, "Ct:h")) != -1) {
+		switch (opt) {
+		case 'C':
+			no_controls = 1;
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind < argc) {
+		for (; optind < argc; optind++) {
+			if (add_job(argv[optind]))
+				return 1;
+		}
+	} else if (scan_dev_dir()) {
+		return 1;
+	}
+
+	qsort(jobs, job_count, sizeof(*jobs), compare_jobs);
+
+	if (threads < 1)
+		threads = 1;
+	if (threads > job_count)
+		threads = job_count;
+
+	tids = calloc(threads ? threads : 1, sizeof(*tids));
+	if (!tids)
+		return 1;
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, worker, NULL);
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	/* every node kind has its array, even when empty */
+	printf("{");
+	for (kind = 0, i = 0; kind < NODE_KIND_COUNT; kind++) {
+		printf("%s\n  \"%s\": [", kind ? "," : "",
+		       node_kinds[kind].json_key);
+		for (first = 1; i < job_count && (int)jobs[i].kind == kind;
+		     i++) {
+			if (!first)
+				printf(",");
+			first = 0;
+			fwrite(jobs[i].out_buf, 1, jobs[i].out_len, stdout);
+			failed += jobs[i].failed;
+			free(jobs[i].out_buf);
+			free(jobs[i].path);
+		}
+		printf("\n  ]");
+	}
+	printf("\n}\n");
+
+	if (failed)
+		fprintf(stderr, "%d of %d nodes could not be read\n", failed,
+			job_count);
+
+	free(tids);
+	free(jobs);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,424 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Writer and reader of the recordings of raw_record.h.
+ *
+ * With O_DIRECT, the frames don't go through the page cache: a recording
+ * of a few GB at sensor rate would otherwise push everything else out of
+ * it, and be written back in bursts that stall the recorder. Each slot is
+ * one pwritev() of the metadata block and of the frame, from the capture
+ * buffer itself when it can be (the pages of a V4L2 buffer are), or from
+ * an aligned bounce buffer when O_DIRECT can't take it (the mappings of
+ * some dma-buf heaps are not pages). Buffered, the slots are written back
+ * one at a time and dropped from the page cache behind the writer.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "raw_record.h"
+
+#define ALIGN_UP(x)	(((x) + RAWREC_ALIGN - 1) / RAWREC_ALIGN * RAWREC_ALIGN)
+
+_Static_assert(sizeof(struct rawrec_header) == RAWREC_ALIGN,
+	       "the header is one block");
+_Static_assert(sizeof(struct rawrec_meta) == 128,
+	       "the metadata records have a fixed size");
+
+struct rawrec_writer {
+	int fd;
+	int direct;
+	/* 0 once the capture buffers turned out not to take O_DIRECT */
+	int in_place;
+	struct rawrec_header *header;
+	/* the metadata block of a slot, then the bounce buffer */
+	uint8_t *slot;
+	struct rawrec_meta *index;
+	uint64_t frames;
+	uint64_t index_size;
+	uint64_t offset;
+};
+
+struct rawrec_reader {
+	const uint8_t *map;
+	size_t size;
+	const struct rawrec_header *header;
+	/* NULL for a recording that wasn't finished */
+	const struct rawrec_meta *index;
+	uint64_t frames;
+};
+
+static void *alloc_aligned(size_t size)
+{
+	void *p;
+
+	if (posix_memalign(&p, RAWREC_ALIGN, size)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	memset(p, 0, size);
+	return p;
+}
+
+/* Write all of @iov at @offset, short writes included */
+static int write_full(int fd, struct iovec *iov, int count, off_t offset)
+{
+	ssize_t n;
+
+	while (count) {
+		n = pwritev(fd, iov, count, offset);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!n) {
+			errno = EIO;
+			return -1;
+		}
+		offset += n;
+		while (count && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count) {
+			iov->iov_base = (uint8_t *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+static int write_block(struct rawrec_writer *w, const void *data,
+		       size_t size, off_t offset)
+{
+	struct iovec iov = { (void *)data, size };
+
+	return write_full(w->fd, &iov, 1, offset);
+}
+
+struct rawrec_writer *rawrec_create(const char *path,
+				    const struct rawrec_info *info,
+				    int direct)
+{
+	struct rawrec_writer *w;
+	struct rawrec_header *h;
+	uint64_t frame_size;
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	frame_size = (uint64_t)info->bytesperline * info->height;
+	if (!info->width || !info->height || !frame_size ||
+	    frame_size > UINT32_MAX - 2 * RAWREC_ALIGN) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		return NULL;
+	w->fd = -1;
+
+	w->header = h = alloc_aligned(sizeof(*h));
+	if (!h)
+		goto err;
+	memcpy(h->magic, RAWREC_MAGIC, sizeof(h->magic));
+	h->version = RAWREC_VERSION;
+	h->flags = info->flags;
+	h->width = info->width;
+	h->height = info->height;
+	h->fourcc = info->fourcc;
+	h->bytesperline = info->bytesperline;
+	h->frame_size = frame_size;
+	h->slot_size = RAWREC_ALIGN + ALIGN_UP(frame_size);
+	h->gain_unity = info->gain_unity;
+	if (info->sensor)
+		strncpy(h->sensor, info->sensor, sizeof(h->sensor) - 1);
+
+	w->slot = alloc_aligned(h->slot_size);
+	if (!w->slot)
+		goto err;
+
+	if (direct) {
+		w->fd = open(path, flags | O_DIRECT, 0644);
+		/* tmpfs and a few others don't have it */
+		if (w->fd >= 0)
+			w->direct = w->in_place = 1;
+		else if (errno != EINVAL)
+			goto err;
+	}
+	if (w->fd < 0) {
+		w->fd = open(path, flags, 0644);
+		if (w->fd < 0)
+			goto err;
+	}
+
+	/* found by its magic if the recorder doesn't get to finish it */
+	if (write_block(w, h, sizeof(*h), 0))
+		goto err;
+	w->offset = sizeof(*h);
+	return w;
+
+err:
+	if (w->fd >= 0)
+		close(w->fd);
+	free(w->slot);
+	free(w->header);
+	free(w);
+	return NULL;
+}
+
+int rawrec_direct(const struct rawrec_writer *w)
+{
+	return w->direct;
+}
+
+/* Start the write-back of the slot at @offset, wait for the previous one */
+static void write_behind(struct rawrec_writer *w, off_t offset)
+{
+	const struct rawrec_header *h = w->header;
+
+	sync_file_range(w->fd, offset, h->slot_size, SYNC_FILE_RANGE_WRITE);
+	if (offset < (off_t)(sizeof(*h) + h->slot_size))
+		return;
+
+	offset -= h->slot_size;
+	sync_file_range(w->fd, offset, h->slot_size,
+			SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+			SYNC_FILE_RANGE_WAIT_AFTER);
+	posix_fadvise(w->fd, offset, h->slot_size, POSIX_FADV_DONTNEED);
+}
+
+int rawrec_append(struct rawrec_writer *w, struct rawrec_meta *meta,
+		  const uint8_t *frame)
+{
+	const struct rawrec_header *h = w->header;
+	size_t frame_len = h->slot_size - RAWREC_ALIGN;
+	struct rawrec_meta *index;
+	struct iovec iov[3];
+	int count = 2;
+
+	if (w->frames == w->index_size) {
+		index = realloc(w->index, (w->index_size * 2 + 64) *
+				sizeof(*index));
+		if (!index)
+			return -1;
+		w->index = index;
+		w->index_size = w->index_size * 2 + 64;
+	}
+
+	meta->magic = RAWREC_META_MAGIC;
+	meta->offset = w->offset + RAWREC_ALIGN;
+	memcpy(w->slot, meta, sizeof(*meta));
+
+	iov[0].iov_base = w->slot;
+	iov[0].iov_len = RAWREC_ALIGN;
+	iov[1].iov_base = (void *)frame;
+	iov[1].iov_len = h->frame_size;
+
+	if (!w->direct) {
+		if (frame_len > h->frame_size) {
+			/* zeroes, the bounce buffer isn't used buffered */
+			iov[2].iov_base = w->slot + RAWREC_ALIGN;
+			iov[2].iov_len = frame_len - h->frame_size;
+			count = 3;
+		}
+		if (write_full(w->fd, iov, count, w->offset))
+			return -1;
+		write_behind(w, w->offset);
+		goto done;
+	}
+
+	if (w->in_place && !((uintptr_t)frame % RAWREC_ALIGN)) {
+		iov[1].iov_len = frame_len;
+		if (!write_full(w->fd, iov, 2, w->offset))
+			goto done;
+		/* pages that can't be pinned, fall back to copying them */
+		if (errno != EFAULT && errno != EINVAL)
+			return -1;
+		w->in_place = 0;
+	}
+
+	memcpy(w->slot + RAWREC_ALIGN, frame, h->frame_size);
+	iov[0].iov_len = h->slot_size;
+	if (write_full(w->fd, iov, 1, w->offset))
+		return -1;
+
+done:
+	w->index[w->frames++] = *meta;
+	w->offset += h->slot_size;
+	return 0;
+}
+
+int rawrec_finish(struct rawrec_writer *w)
+{
+	struct rawrec_header *h = w->header;
+	size_t size = ALIGN_UP(w->frames * sizeof(*w->index));
+	uint8_t *index = NULL;
+	int ret = -1;
+
+	if (w->frames) {
+		index = alloc_aligned(size);
+		if (!index)
+			goto out;
+		memcpy(index, w->index, w->frames * sizeof(*w->index));
+		if (write_block(w, index, size, w->offset))
+			goto out;
+		h->index_offset = w->offset;
+		h->frame_count = w->frames;
+	}
+
+	/* the index is on the disk before the header says where it is */
+	if (fdatasync(w->fd) || write_block(w, h, sizeof(*h), 0) ||
+	    fdatasync(w->fd))
+		goto out;
+	ret = 0;
+
+out:
+	if (close(w->fd))
+		ret = -1;
+	free(index);
+	free(w->index);
+	free(w->slot);
+	free(w->header);
+	free(w);
+	return ret;
+}
+
+static const struct rawrec_meta *slot_meta(const struct rawrec_reader *r,
+					   uint64_t i)
+{
+	return (const void *)(r->map + RAWREC_ALIGN +
+			      i * r->header->slot_size);
+}
+
+static int meta_valid(const struct rawrec_reader *r,
+		      const struct rawrec_meta *m, uint64_t i)
+{
+	const struct rawrec_header *h = r->header;
+
+	return m->magic == RAWREC_META_MAGIC &&
+	       m->offset == RAWREC_ALIGN + i * h->slot_size + RAWREC_ALIGN &&
+	       m->bytesused <= h->frame_size;
+}
+
+static int header_valid(const struct rawrec_header *h)
+{
+	return !memcmp(h->magic, RAWREC_MAGIC, sizeof(h->magic)) &&
+	       h->version == RAWREC_VERSION && h->width && h->height &&
+	       h->frame_size &&
+	       h->frame_size == (uint64_t)h->bytesperline * h->height &&
+	       h->slot_size == RAWREC_ALIGN + ALIGN_UP((uint64_t)h->frame_size);
+}
+
+struct rawrec_reader *rawrec_open(const char *path)
+{
+	const struct rawrec_header *h;
+	struct rawrec_reader *r;
+	uint64_t i, frames;
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return NULL;
+	}
+	if (st.st_size < RAWREC_ALIGN) {
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	r = calloc(1, sizeof(*r));
+	if (!r) {
+		munmap(map, st.st_size);
+		return NULL;
+	}
+	r->map = map;
+	r->size = st.st_size;
+	r->header = h = map;
+	if (!header_valid(h))
+		goto err;
+
+	frames = (r->size - RAWREC_ALIGN) / h->slot_size;
+	if (h->index_offset && h->frame_count <= frames &&
+	    h->index_offset == RAWREC_ALIGN + h->frame_count * h->slot_size &&
+	    h->index_offset + h->frame_count * sizeof(*r->index) <= r->size) {
+		r->index = (const void *)(r->map + h->index_offset);
+		r->frames = h->frame_count;
+		for (i = 0; i < r->frames; i++)
+			if (!meta_valid(r, &r->index[i], i))
+				goto err;
+		return r;
+	}
+
+	/* not finished, or cut short: the complete slots that look right */
+	for (i = 0; i < frames && meta_valid(r, slot_meta(r, i), i); i++)
+		;
+	r->frames = i;
+	return r;
+
+err:
+	rawrec_close(r);
+	errno = EINVAL;
+	return NULL;
+}
+
+void rawrec_close(struct rawrec_reader *r)
+{
+	if (!r)
+		return;
+	munmap((void *)r->map, r->size);
+	free(r);
+}
+
+const struct rawrec_header *rawrec_header(const struct rawrec_reader *r)
+{
+	return r->header;
+}
+
+uint64_t rawrec_frames(const struct rawrec_reader *r)
+{
+	return r->frames;
+}
+
+int rawrec_recovered(const struct rawrec_reader *r)
+{
+	return !r->index;
+}
+
+const struct rawrec_meta *rawrec_meta(const struct rawrec_reader *r,
+				      uint64_t i)
+{
+	return r->index ? &r->index[i] : slot_meta(r, i);
+}
+
+const uint8_t *rawrec_frame(const struct rawrec_reader *r, uint64_t i)
+{
+	return r->map + rawrec_meta(r, i)->offset;
+}
+
+void rawrec_prefetch(const struct rawrec_reader *r, uint64_t i)
+{
+	uintptr_t start;
+
+	if (i >= r->frames)
+		return;
+	start = (uintptr_t)r->map + rawrec_meta(r, i)->offset;
+	madvise((void *)start, r->header->frame_size, MADV_WILLNEED);
+}
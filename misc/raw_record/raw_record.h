@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Recordings of raw frames with the sensor controls of each frame, for
+ * replaying AE and AWB offline.
+ *
+ * A recording is written once, front to back, and read through mmap:
+ *
+ *   header	RAWREC_ALIGN bytes, struct rawrec_header
+ *   slot 0	RAWREC_ALIGN bytes of struct rawrec_meta, then the frame,
+ *		padded to RAWREC_ALIGN
+ *   slot 1	...
+ *   index	the rawrec_meta of all the frames, padded to RAWREC_ALIGN
+ *
+ * All the slots have the same size, so frame i is at a fixed offset and
+ * the index is only there to go through the metadata without touching
+ * the frames. The header gets the frame count and the index offset when
+ * the recording is finished. A recording that wasn't (the recorder was
+ * killed) has neither, and its frames are found from the size of the
+ * file and the metadata of the slots. Everything is aligned for O_DIRECT.
+ * The values are little endian, as on the hosts of the IPU3.
+ */
+#ifndef RAW_RECORD_H
+#define RAW_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RAWREC_MAGIC		"IPU3RAW1"
+#define RAWREC_META_MAGIC	0x314d5246	/* "FRM1" */
+#define RAWREC_VERSION		1
+#define RAWREC_ALIGN		4096
+
+/* Header flags */
+/*
+ * The controls of the metadata are the ones the frame was taken with.
+ * Without it, they are the values the driver had when the frame was
+ * dequeued, and a control applied N frames late (exposure 2 and gain 1
+ * on our sensors) went into frame i + N - 1.
+ */
+#define RAWREC_APPLIED		(1U << 0)
+
+/* Which controls of rawrec_meta are there, the sensor may not have some */
+enum rawrec_ctrl {
+	RAWREC_EXPOSURE,
+	RAWREC_ANALOGUE_GAIN,
+	RAWREC_DIGITAL_GAIN,
+	RAWREC_VBLANK,
+	RAWREC_HBLANK,
+	RAWREC_TEST_PATTERN,
+	RAWREC_HFLIP,
+	RAWREC_VFLIP,
+	RAWREC_RED_BALANCE,
+	RAWREC_BLUE_BALANCE,
+	RAWREC_NUM_CTRLS,
+};
+
+struct rawrec_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;		/* V4L2 pixel format */
+	uint32_t bytesperline;
+	uint32_t frame_size;		/* bytesperline * height */
+	uint32_t slot_size;		/* metadata and frame, aligned */
+	uint64_t frame_count;		/* 0 until finished */
+	uint64_t index_offset;		/* 0 until finished */
+	int32_t gain_unity;		/* analogue gain of 1x, 0 if unknown */
+	char sensor[32];
+	uint8_t reserved[RAWREC_ALIGN - 92];
+};
+
+struct rawrec_meta {
+	uint32_t magic;
+	uint32_t sequence;		/* of the V4L2 buffer */
+	uint64_t timestamp_ns;
+	uint64_t offset;		/* of the frame in the file */
+	uint32_t bytesused;
+	uint32_t ctrl_mask;		/* bit i for enum rawrec_ctrl i */
+	int32_t ctrls[RAWREC_NUM_CTRLS];
+	uint8_t reserved[56];
+};
+
+/* What rawrec_create() needs to know, the rest of the header follows */
+struct rawrec_info {
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;
+	uint32_t bytesperline;
+	uint32_t flags;
+	int32_t gain_unity;
+	const char *sensor;
+};
+
+struct rawrec_writer;
+struct rawrec_reader;
+
+/*
+ * Create a recording at @path. With @direct, it is written with O_DIRECT,
+ * or buffered if the filesystem doesn't support it (rawrec_direct() says
+ * which). Return NULL with errno set on failure.
+ */
+struct rawrec_writer *rawrec_create(const char *path,
+				    const struct rawrec_info *info,
+				    int direct);
+int rawrec_direct(const struct rawrec_writer *w);
+
+/*
+ * Append a frame of frame_size bytes and its metadata, of which offset and
+ * magic are filled in. @frame may be page aligned memory of at least
+ * frame_size rounded up to the page (a V4L2 buffer), it is then written
+ * from there. Return -1 with errno set on failure.
+ */
+int rawrec_append(struct rawrec_writer *w, struct rawrec_meta *meta,
+		  const uint8_t *frame);
+
+/* Write the index and the header, and close. Return -1 on failure. */
+int rawrec_finish(struct rawrec_writer *w);
+
+/* Return NULL with errno set if @path isn't a recording */
+struct rawrec_reader *rawrec_open(const char *path);
+void rawrec_close(struct rawrec_reader *r);
+
+const struct rawrec_header *rawrec_header(const struct rawrec_reader *r);
+uint64_t rawrec_frames(const struct rawrec_reader *r);
+/* 1 if the recording wasn't finished and its frames were found */
+int rawrec_recovered(const struct rawrec_reader *r);
+
+/* Frame @i and its metadata, @i < rawrec_frames() */
+const struct rawrec_meta *rawrec_meta(const struct rawrec_reader *r,
+				      uint64_t i);
+const uint8_t *rawrec_frame(const struct rawrec_reader *r, uint64_t i);
+/* Start reading frame @i from the disk, if it is there */
+void rawrec_prefetch(const struct rawrec_reader *r, uint64_t i);
+
+#endif /* RAW_RECORD_H */
@@ -0,0 +1,714 @@
+/**
+ * This tool records the raw frames of a camera in the format of
+ * raw_record.h, with the controls the sensor driver had for each frame:
+ * exposure, gains, blanking, test pattern, flips and white balance, the
+ * ones the driver has. The frames come from ../zc_capture and a writer
+ * thread writes them with O_DIRECT straight from the capture buffers,
+ * while the capture thread reads the controls of the next frame.
+ *
+ * -i prints what a recording holds, and with -p reads all its frames
+ * through the mapping, as a replay does. -T writes, reads back and checks
+ * synthetic recordings, without a camera.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include "raw_record.h"
+#include "zc_capture.h"
+#include "zc_ring.h"
+
+#define TEST_WIDTH		1632
+#define TEST_HEIGHT		1224
+#define TEST_FRAMES		48
+/* the frame test_check() cuts the recording in */
+#define TEST_CUT		29
+
+static const struct {
+	uint32_t id;
+	const char *name;
+} ctrls[RAWREC_NUM_CTRLS] = {
+	[RAWREC_EXPOSURE] = { V4L2_CID_EXPOSURE, "exposure" },
+	[RAWREC_ANALOGUE_GAIN] = { V4L2_CID_ANALOGUE_GAIN, "again" },
+	[RAWREC_DIGITAL_GAIN] = { V4L2_CID_DIGITAL_GAIN, "dgain" },
+	[RAWREC_VBLANK] = { V4L2_CID_VBLANK, "vblank" },
+	[RAWREC_HBLANK] = { V4L2_CID_HBLANK, "hblank" },
+	[RAWREC_TEST_PATTERN] = { V4L2_CID_TEST_PATTERN, "pattern" },
+	[RAWREC_HFLIP] = { V4L2_CID_HFLIP, "hflip" },
+	[RAWREC_VFLIP] = { V4L2_CID_VFLIP, "vflip" },
+	[RAWREC_RED_BALANCE] = { V4L2_CID_RED_BALANCE, "red" },
+	[RAWREC_BLUE_BALANCE] = { V4L2_CID_BLUE_BALANCE, "blue" },
+};
+
+struct recorder {
+	struct zc_capture *cap;
+	const struct zc_format *fmt;
+	struct rawrec_writer *writer;
+	pthread_t thread;
+	struct zc_ring ring;
+	sem_t ready;
+	atomic_int stop;
+	atomic_int failed;
+	/* of each buffer, filled in when it is dequeued */
+	struct rawrec_meta meta[ZC_MAX_BUFFERS];
+	/* the controls the driver has */
+	int ctrl_fd;
+	struct v4l2_ext_control ctrl[RAWREC_NUM_CTRLS];
+	unsigned int ctrl_index[RAWREC_NUM_CTRLS];
+	unsigned int num_ctrls;
+	uint32_t ctrl_mask;
+	/* of the writer thread */
+	unsigned int written;
+	double write_us;
+	double write_max_us;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void fourcc_str(uint32_t fourcc, char *str)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		str[i] = (fourcc >> (8 * i)) & 0x7f;
+	str[4] = '\0';
+}
+
+/*
+ * Record
+ */
+static void *writer_thread(void *arg)
+{
+	struct recorder *rec = arg;
+	struct zc_frame *frame;
+	void *value;
+	double t0, t;
+
+	for (;;) {
+		while (sem_wait(&rec->ready) && errno == EINTR)
+			;
+		if (zc_ring_pop(&rec->ring, &value)) {
+			if (atomic_load(&rec->stop))
+				break;
+			continue;
+		}
+
+		frame = value;
+		t0 = now_us();
+		if (!atomic_load(&rec->failed) &&
+		    rawrec_append(rec->writer, &rec->meta[frame->index],
+				  frame->data)) {
+			perror("write");
+			atomic_store(&rec->failed, 1);
+		}
+		t = now_us() - t0;
+		rec->write_us += t;
+		if (t > rec->write_max_us)
+			rec->write_max_us = t;
+		rec->written++;
+		zc_frame_put(frame);
+	}
+
+	return NULL;
+}
+
+/* Which of the controls the driver has, the others aren't recorded */
+static void find_ctrls(struct recorder *rec)
+{
+	struct v4l2_query_ext_ctrl qc;
+	unsigned int i;
+
+	for (i = 0; i < RAWREC_NUM_CTRLS; i++) {
+		memset(&qc, 0, sizeof(qc));
+		qc.id = ctrls[i].id;
+		if (xioctl(rec->ctrl_fd, VIDIOC_QUERY_EXT_CTRL, &qc) ||
+		    (qc.flags & V4L2_CTRL_FLAG_DISABLED))
+			continue;
+		rec->ctrl[rec->num_ctrls].id = ctrls[i].id;
+		rec->ctrl_index[rec->num_ctrls++] = i;
+		rec->ctrl_mask |= 1U << i;
+	}
+}
+
+static int read_ctrls(struct recorder *rec, struct rawrec_meta *meta)
+{
+	struct v4l2_ext_controls c = {
+		.which = V4L2_CTRL_WHICH_CUR_VAL,
+		.count = rec->num_ctrls,
+		.controls = rec->ctrl,
+	};
+	unsigned int i;
+
+	meta->ctrl_mask = rec->ctrl_mask;
+	if (!rec->num_ctrls)
+		return 0;
+	if (xioctl(rec->ctrl_fd, VIDIOC_G_EXT_CTRLS, &c)) {
+		perror("VIDIOC_G_EXT_CTRLS");
+		return -1;
+	}
+	for (i = 0; i < rec->num_ctrls; i++)
+		meta->ctrls[rec->ctrl_index[i]] = rec->ctrl[i].value;
+
+	return 0;
+}
+
+/* The name of the subdev, the sensor and its I2C address */
+static void subdev_name(const char *path, char *name, size_t size)
+{
+	char real[PATH_MAX], sysfs[PATH_MAX + 64];
+	FILE *f;
+
+	name[0] = '\0';
+	if (!realpath(path, real))
+		return;
+	snprintf(sysfs, sizeof(sysfs), "/sys/class/video4linux/%s/name",
+		 basename(real));
+	f = fopen(sysfs, "r");
+	if (!f)
+		return;
+	if (fgets(name, size, f))
+		name[strcspn(name, "\n")] = '\0';
+	fclose(f);
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	interrupted = 1;
+}
+
+static int record(const struct zc_capture_config *cfg, const char *subdev,
+		  const char *output, unsigned int frames, int direct,
+		  int32_t gain_unity)
+{
+	struct sigaction sa = { .sa_handler = on_signal };
+	static struct recorder rec;
+	struct rawrec_info info = { 0 };
+	struct v4l2_query_ext_ctrl qc = { .id = V4L2_CID_ANALOGUE_GAIN };
+	struct rawrec_meta *meta;
+	struct zc_frame *frame;
+	unsigned int n, dropped = 0, started = 0;
+	uint32_t last_seq = 0;
+	char fourcc[5], sensor[32];
+	double t0, t1 = 0;
+	int ret = -1;
+
+	rec.ctrl_fd = open(subdev ? subdev : cfg->device, O_RDWR);
+	if (rec.ctrl_fd < 0) {
+		perror(subdev ? subdev : cfg->device);
+		return -1;
+	}
+	find_ctrls(&rec);
+
+	rec.cap = zc_capture_open(cfg);
+	if (!rec.cap)
+		goto out;
+	rec.fmt = zc_capture_format(rec.cap);
+
+	/* the minimum is a gain of 1 for the ov8865, ov5693 and ov7251 */
+	if (!gain_unity && (rec.ctrl_mask & (1U << RAWREC_ANALOGUE_GAIN)) &&
+	    !xioctl(rec.ctrl_fd, VIDIOC_QUERY_EXT_CTRL, &qc))
+		gain_unity = qc.minimum;
+	subdev_name(subdev ? subdev : cfg->device, sensor, sizeof(sensor));
+
+	info.width = rec.fmt->width;
+	info.height = rec.fmt->height;
+	info.fourcc = rec.fmt->fourcc;
+	info.bytesperline = rec.fmt->bytesperline;
+	info.gain_unity = gain_unity;
+	info.sensor = sensor;
+	rec.writer = rawrec_create(output, &info, direct);
+	if (!rec.writer) {
+		perror(output);
+		goto out;
+	}
+
+	fourcc_str(rec.fmt->fourcc, fourcc);
+	printf("%ux%u %s, %u buffers, %u controls of %s, writing %s\n",
+	       rec.fmt->width, rec.fmt->height, fourcc,
+	       zc_capture_buffers(rec.cap), rec.num_ctrls,
+	       sensor[0] ? sensor : "the sensor",
+	       rawrec_direct(rec.writer) ? "with O_DIRECT" : "buffered");
+
+	zc_ring_init(&rec.ring);
+	if (sem_init(&rec.ready, 0, 0))
+		goto out;
+	if (pthread_create(&rec.thread, NULL, writer_thread, &rec))
+		goto out_sem;
+	started = 1;
+
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (zc_capture_start(rec.cap))
+		goto out_stream;
+
+	t0 = now_us();
+	for (n = 0; (!frames || n < frames) && !interrupted &&
+		    !atomic_load(&rec.failed); n++) {
+		frame = zc_capture_next(rec.cap, 1);
+		if (!frame) {
+			if (errno == ETIMEDOUT)
+				fprintf(stderr, "no frame in time\n");
+			goto out_stream;
+		}
+		if (n && frame->sequence != last_seq + 1)
+			dropped += frame->sequence - last_seq - 1;
+		last_seq = frame->sequence;
+
+		/* the buffer isn't dequeued again before the writer is done */
+		meta = &rec.meta[frame->index];
+		memset(meta, 0, sizeof(*meta));
+		meta->sequence = frame->sequence;
+		meta->timestamp_ns = frame->timestamp_ns;
+		meta->bytesused = frame->bytesused;
+		if (read_ctrls(&rec, meta)) {
+			zc_frame_put(frame);
+			goto out_stream;
+		}
+
+		/* the ring holds more than all the buffers */
+		zc_ring_push(&rec.ring, frame);
+		sem_post(&rec.ready);
+	}
+	t1 = now_us();
+	ret = 0;
+
+out_stream:
+	/* the writer writes what it has left, then stops */
+	atomic_store(&rec.stop, 1);
+	sem_post(&rec.ready);
+	if (started)
+		pthread_join(rec.thread, NULL);
+	zc_capture_stop(rec.cap);
+	if (atomic_load(&rec.failed))
+		ret = -1;
+
+	if (!ret) {
+		printf("%u frames, %.1f fps, %u dropped, %u waits for a buffer\n",
+		       rec.written, n > 1 ? (n - 1) * 1e6 / (t1 - t0) : 0,
+		       dropped, zc_capture_starved(rec.cap));
+		printf("write %.1f us per frame, %.1f at most, %.1f MB/s\n",
+		       rec.written ? rec.write_us / rec.written : 0,
+		       rec.write_max_us, rec.write_us ?
+		       (double)rec.written * rec.fmt->bytesperline *
+		       rec.fmt->height / rec.write_us : 0);
+	}
+out_sem:
+	sem_destroy(&rec.ready);
+out:
+	if (rec.writer && rawrec_finish(rec.writer)) {
+		perror(output);
+		ret = -1;
+	}
+	zc_capture_close(rec.cap);
+	close(rec.ctrl_fd);
+	return ret;
+}
+
+/*
+ * Info and playback
+ */
+static void print_meta(uint64_t i, const struct rawrec_meta *m)
+{
+	unsigned int c;
+
+	printf("frame %4llu: sequence %6u %12.6f s", (unsigned long long)i,
+	       m->sequence, m->timestamp_ns / 1e9);
+	for (c = 0; c < RAWREC_NUM_CTRLS; c++)
+		if (m->ctrl_mask & (1U << c))
+			printf(" %s %d", ctrls[c].name, m->ctrls[c]);
+	printf("\n");
+}
+
+/* Read every frame through the mapping, one cache line a word */
+static uint64_t play(const struct rawrec_reader *r)
+{
+	const struct rawrec_header *h = rawrec_header(r);
+	const uint64_t *p;
+	uint64_t i, sum = 0;
+	size_t j;
+
+	rawrec_prefetch(r, 0);
+	for (i = 0; i < rawrec_frames(r); i++) {
+		rawrec_prefetch(r, i + 1);
+		p = (const uint64_t *)rawrec_frame(r, i);
+		for (j = 0; j < h->frame_size / sizeof(*p); j += 8)
+			sum += p[j];
+	}
+
+	return sum;
+}
+
+static int info(const char *path, int verbose, int playback)
+{
+	const struct rawrec_header *h;
+	const struct rawrec_meta *m;
+	struct rawrec_reader *r;
+	uint64_t i, frames, dropped = 0;
+	char fourcc[5];
+	double t0, dt, span = 0;
+	unsigned int c;
+
+	r = rawrec_open(path);
+	if (!r) {
+		perror(path);
+		return -1;
+	}
+	h = rawrec_header(r);
+	frames = rawrec_frames(r);
+
+	for (i = 1; i < frames; i++)
+		dropped += rawrec_meta(r, i)->sequence -
+			   rawrec_meta(r, i - 1)->sequence - 1;
+	if (frames > 1)
+		span = (rawrec_meta(r, frames - 1)->timestamp_ns -
+			rawrec_meta(r, 0)->timestamp_ns) / 1e9;
+
+	fourcc_str(h->fourcc, fourcc);
+	printf("%s: %ux%u %s, %u bytes per line, sensor %s, 1x gain %d\n",
+	       path, h->width, h->height, fourcc, h->bytesperline,
+	       h->sensor[0] ? h->sensor : "unknown", h->gain_unity);
+	printf("%llu frames%s, %llu dropped, %.2f s, %.1f fps, controls %s\n",
+	       (unsigned long long)frames,
+	       rawrec_recovered(r) ? " (not finished)" : "",
+	       (unsigned long long)dropped, span,
+	       span > 0 ? (frames - 1) / span : 0,
+	       h->flags & RAWREC_APPLIED ? "as applied" : "when dequeued");
+	if (frames) {
+		m = rawrec_meta(r, 0);
+		printf("controls:");
+		for (c = 0; c < RAWREC_NUM_CTRLS; c++)
+			if (m->ctrl_mask & (1U << c))
+				printf(" %s", ctrls[c].name);
+		printf("\n");
+	}
+
+	for (i = 0; verbose && i < frames; i++)
+		print_meta(i, rawrec_meta(r, i));
+
+	if (playback && frames) {
+		t0 = now_us();
+		/* printed so that it isn't optimized out */
+		printf("checksum %016llx", (unsigned long long)play(r));
+		dt = now_us() - t0;
+		printf(", read %.1f MB in %.1f ms, %.1f MB/s\n",
+		       frames * h->frame_size / 1e6, dt / 1e3,
+		       frames * h->frame_size / dt);
+	}
+
+	rawrec_close(r);
+	return 0;
+}
+
+/*
+ * Test, on synthetic frames
+ */
+static void test_frame(uint8_t *frame, size_t size, uint64_t i)
+{
+	uint32_t *p = (uint32_t *)frame;
+	size_t j;
+
+	for (j = 0; j < size / sizeof(*p); j++)
+		p[j] = (uint32_t)(i * 2654435761U) ^ (uint32_t)j;
+}
+
+static void test_meta(struct rawrec_meta *m, uint64_t i)
+{
+	unsigned int c;
+
+	memset(m, 0, sizeof(*m));
+	/* with a dropped frame */
+	m->sequence = 100 + i + (i >= 10);
+	m->timestamp_ns = 1000000000ULL + i * 33333333ULL;
+	m->bytesused = TEST_HEIGHT * ((TEST_WIDTH + 49) / 50 * 64);
+	/* as a sensor without digital gain */
+	m->ctrl_mask = ((1U << RAWREC_NUM_CTRLS) - 1) &
+		       ~(1U << RAWREC_DIGITAL_GAIN);
+	for (c = 0; c < RAWREC_NUM_CTRLS; c++)
+		if (m->ctrl_mask & (1U << c))
+			m->ctrls[c] = (int32_t)(i * 31 + c * 1000);
+}
+
+static int test_write(const char *path, const struct rawrec_info *info,
+		      uint8_t *frame, size_t size, int direct, double *mb_s)
+{
+	struct rawrec_writer *w;
+	struct rawrec_meta m;
+	uint64_t i;
+	double t0, busy = 0;
+
+	w = rawrec_create(path, info, direct);
+	if (!w) {
+		perror(path);
+		return -1;
+	}
+	if (direct && !rawrec_direct(w))
+		printf("%s: no O_DIRECT here, buffered\n", path);
+
+	for (i = 0; i < TEST_FRAMES; i++) {
+		test_frame(frame, size, i);
+		test_meta(&m, i);
+		t0 = now_us();
+		if (rawrec_append(w, &m, frame)) {
+			perror(path);
+			rawrec_finish(w);
+			return -1;
+		}
+		busy += now_us() - t0;
+	}
+	t0 = now_us();
+	if (rawrec_finish(w)) {
+		perror(path);
+		return -1;
+	}
+	busy += now_us() - t0;
+
+	*mb_s = TEST_FRAMES * size / busy;
+	return 0;
+}
+
+/* Check the first @frames frames, and that there are that many */
+static int test_check(const char *path, uint8_t *expected, size_t size,
+		      uint64_t frames, int recovered)
+{
+	struct rawrec_reader *r;
+	struct rawrec_meta m;
+	const struct rawrec_meta *rm;
+	uint64_t i;
+	int failed = 0;
+
+	r = rawrec_open(path);
+	if (!r) {
+		perror(path);
+		return 1;
+	}
+
+	failed |= rawrec_frames(r) != frames ||
+		  rawrec_recovered(r) != recovered ||
+		  rawrec_header(r)->frame_size != size ||
+		  rawrec_header(r)->gain_unity != 128 ||
+		  strcmp(rawrec_header(r)->sensor, "ov8865 test");
+	for (i = 0; !failed && i < frames; i++) {
+		test_meta(&m, i);
+		rm = rawrec_meta(r, i);
+		failed |= rm->sequence != m.sequence ||
+			  rm->timestamp_ns != m.timestamp_ns ||
+			  rm->bytesused != m.bytesused ||
+			  rm->ctrl_mask != m.ctrl_mask ||
+			  memcmp(rm->ctrls, m.ctrls, sizeof(m.ctrls));
+		test_frame(expected, size, i);
+		failed |= memcmp(rawrec_frame(r, i), expected, size) != 0;
+	}
+
+	rawrec_close(r);
+	return failed;
+}
+
+static int test(const char *dir)
+{
+	struct rawrec_info info = {
+		.width = TEST_WIDTH,
+		.height = TEST_HEIGHT,
+		.fourcc = V4L2_PIX_FMT_IPU3_SGRBG10,
+		.bytesperline = (TEST_WIDTH + 49) / 50 * 64,
+		.gain_unity = 128,
+		.sensor = "ov8865 test",
+	};
+	size_t size = (size_t)info.bytesperline * info.height;
+	size_t len = (size + RAWREC_ALIGN - 1) / RAWREC_ALIGN * RAWREC_ALIGN;
+	char path[PATH_MAX];
+	uint8_t *buffer, *expected;
+	struct rawrec_reader *r;
+	double mb_s, t0;
+	int fd, failed = 0, ret;
+
+	/* page aligned, as a capture buffer */
+	buffer = mmap(NULL, len + RAWREC_ALIGN, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	expected = malloc(size);
+	if (buffer == MAP_FAILED || !expected) {
+		perror("test");
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s/rawrec-test-%d.raw", dir, getpid());
+
+	/* from the buffer with O_DIRECT, then through the bounce buffer */
+	ret = test_write(path, &info, buffer, size, 1, &mb_s);
+	if (!ret) {
+		ret = test_check(path, expected, size, TEST_FRAMES, 0);
+		printf("%u frames of %zu bytes, in place: written at %.0f MB/s, %s\n",
+		       TEST_FRAMES, size, mb_s, ret ? "wrong" : "ok");
+	}
+	failed |= ret;
+
+	ret = test_write(path, &info, buffer + 64, size, 1, &mb_s);
+	if (!ret) {
+		ret = test_check(path, expected, size, TEST_FRAMES, 0);
+		printf("%u frames, unaligned: written at %.0f MB/s, %s\n",
+		       TEST_FRAMES, mb_s, ret ? "wrong" : "ok");
+	}
+	failed |= ret;
+
+	/* read back from the disk, not from the page cache */
+	r = rawrec_open(path);
+	if (r) {
+		fd = open(path, O_RDONLY);
+		if (fd >= 0) {
+			fdatasync(fd);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+			close(fd);
+		}
+		t0 = now_us();
+		play(r);
+		printf("played back at %.0f MB/s\n",
+		       TEST_FRAMES * size / (now_us() - t0));
+		rawrec_close(r);
+	}
+
+	ret = test_write(path, &info, buffer, size, 0, &mb_s);
+	if (!ret) {
+		ret = test_check(path, expected, size, TEST_FRAMES, 0);
+		printf("%u frames, buffered: written at %.0f MB/s, %s\n",
+		       TEST_FRAMES, mb_s, ret ? "wrong" : "ok");
+	}
+	failed |= ret;
+
+	/* as if the recorder was killed in the middle of a frame */
+	ret = truncate(path, RAWREC_ALIGN + TEST_CUT *
+		       (RAWREC_ALIGN + (off_t)len) + RAWREC_ALIGN + size / 2);
+	if (!ret) {
+		ret = test_check(path, expected, size, TEST_CUT, 1);
+		printf("cut in frame %u: %s\n", TEST_CUT, ret ? "wrong" : "ok");
+	} else {
+		perror(path);
+	}
+	failed |= ret;
+
+	unlink(path);
+	munmap(buffer, len + RAWREC_ALIGN);
+	free(expected);
+	return failed;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -d <video node> [-s <subdev>] -o <file> [-n <frames>]\n"
+		"          [-b <buffers>] [-m mmap|dmabuf] [-H <dma heap>] [-B]\n"
+		"          [-u <gain of 1x>]\n"
+		"       %s -i <file> [-v] [-p]\n"
+		"       %s -T [-t <directory>]\n", argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct zc_capture_config cfg = { 0 };
+	const char *subdev = NULL, *output = NULL, *input = NULL;
+	const char *dir = ".";
+	unsigned int frames = 0;
+	int direct = 1, verbose = 0, playback = 0, test_mode = 0, c;
+	int32_t gain_unity = 0;
+
+	while ((c = getopt(argc, argv, "d:s:o:n:b:m:H:Bu:i:vpTt:")) != -1) {
+		switch (c) {
+		case 'd':
+			cfg.device = optarg;
+			break;
+		case 's':
+			subdev = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			cfg.buffers = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			if (!strcmp(optarg, "mmap")) {
+				cfg.memory = ZC_MEMORY_MMAP;
+			} else if (!strcmp(optarg, "dmabuf")) {
+				cfg.memory = ZC_MEMORY_DMABUF;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'H':
+			cfg.heap = optarg;
+			break;
+		case 'B':
+			direct = 0;
+			break;
+		case 'u':
+			gain_unity = strtol(optarg, NULL, 0);
+			break;
+		case 'i':
+			input = optarg;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'p':
+			playback = 1;
+			break;
+		case 'T':
+			test_mode = 1;
+			break;
+		case 't':
+			dir = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (test_mode)
+		return test(dir) ? 1 : 0;
+	if (input)
+		return info(input, verbose, playback) ? 1 : 0;
+
+	if (!cfg.device || !output || cfg.buffers > ZC_MAX_BUFFERS) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	return record(&cfg, subdev, output, frames, direct, gain_unity) ? 1 : 0;
+}
@@ -0,0 +1,660 @@
+/**
+ * This tool compares the camera configuration of machines in the
+ * dump_intel_ipu_data results, either field by field for two machines
+ * (e.g. two SKUs or firmware versions of the same model) or by grouping a
+ * whole corpus into clusters of similar configurations.
+ *
+ * Clustering parses one result file at a time and only keeps a compact
+ * signature (hashes of the configuration fields) per machine.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "results_parser.h"
+
+#define DEFAULT_RESULTS_DIR	"../dump_intel_ipu_data/results"
+#define DEFAULT_THRESHOLD	0.6
+#define KEY_BUF_SIZE		128
+#define VALUE_BUF_SIZE		1024
+
+/* fields that describe the hardware configuration */
+static const char * const config_prefixes[] = {
+	"hid", "ddn", "sub", "subsys_id", "pmic_type", "dep.pmic_type",
+	"ssdb.", "cldb.", "dep.cldb.", "dsm.", "pld.panel_str",
+	"pld.rotation",
+};
+
+/* per instance or raw fields, only compared with -a */
+static const char * const noisy_fields[] = {
+	"ssdb.raw", "ssdb.reserved", "ssdb.sensor_cal_file_idx_mbz",
+	"ssdb.csi2_data_stream_interface", "cldb.raw", "cldb.reserved",
+	"dsm.gpio", "dsm.i2c",
+};
+
+/* machine wide fields shown in the diff header */
+static const char * const machine_fields[] = {
+	"dmi.product_sku", "dmi.bios_version", "dmi.bios_date",
+	"driver_version",
+};
+
+static int all_fields;
+
+static int starts_with(const char *s, const char *prefix)
+{
+	return !strncmp(s, prefix, strlen(prefix));
+}
+
+static int is_config_field(const char *key)
+{
+	unsigned int i;
+
+	if (all_fields)
+		return 1;
+
+	for (i = 0; i < sizeof(noisy_fields) / sizeof(noisy_fields[0]); i++) {
+		if (!strcmp(key, noisy_fields[i]))
+			return 0;
+	}
+
+	for (i = 0; i < sizeof(config_prefixes) / sizeof(config_prefixes[0]);
+	     i++) {
+		if (starts_with(key, config_prefixes[i]))
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Normalized fields of a device: multi-valued keys are joined, and the
+ * _DSM GPIO entries are split per pin so that a changed function or
+ * polarity shows up on its own line.
+ */
+static int normalize(const struct result_fields *dev, struct result_fields *out)
+{
+	char key[KEY_BUF_SIZE], value[VALUE_BUF_SIZE];
+	const char *k, *v;
+	unsigned long gpio;
+	size_t len;
+	int i, j;
+
+	memset(out, 0, sizeof(*out));
+
+	for (i = 0; i < dev->count; i++) {
+		k = dev->kv[i].key;
+		v = dev->kv[i].value;
+
+		if (!strcmp(k, "dsm.gpio")) {
+			/* 0x0100540c: active value, pin 0x54, function 0x0c */
+			gpio = strtoul(v, NULL, 16);
+			snprintf(key, sizeof(key), "dsm.gpio[pin 0x%02lx]",
+				 (gpio >> 8) & 0xff);
+			snprintf(value, sizeof(value),
+				 "function 0x%02lx, active 0x%02lx",
+				 gpio & 0xff, gpio >> 24);
+			if (result_add(out, key, value))
+				return -1;
+		}
+
+		if (!is_config_field(k) || result_get(out, k))
+			continue;
+
+		/* join all values of the key, in order */
+		value[0] = '\0';
+		for (j = i, len = 0; j < dev->count; j++) {
+			if (strcmp(dev->kv[j].key, k))
+				continue;
+			len += snprintf(value + len, sizeof(value) - len, "%s%s",
+					len ? ", " : "", dev->kv[j].value);
+			if (len >= sizeof(value))
+				break;
+		}
+		if (result_add(out, k, value))
+			return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Diff
+ */
+static const char *field(const struct result_fields *dev, const char *key)
+{
+	const char *value = result_get(dev, key);
+
+	return value ? value : "-";
+}
+
+/*
+ * Pair the devices of two machines: same _HID and ACPI path first, then
+ * same _HID, then same type, in order.
+ */
+static int match_device(const struct result_file *a, int i,
+			const struct result_file *b, const int *used,
+			int pass)
+{
+	const struct result_fields *da = &a->devices[i];
+	const struct result_fields *db;
+	int j;
+
+	for (j = 0; j < b->device_count; j++) {
+		db = &b->devices[j];
+		if (used[j] ||
+		    strcmp(field(da, "type"), field(db, "type")))
+			continue;
+		if (pass < 2 && strcmp(field(da, "hid"), field(db, "hid")))
+			continue;
+		if (pass < 1 &&
+		    strcmp(field(da, "acpi_path"), field(db, "acpi_path")))
+			continue;
+		return j;
+	}
+
+	return -1;
+}
+
+static void print_device(const struct result_fields *dev)
+{
+	printf("%s %s %s", field(dev, "type"), field(dev, "hid"),
+	       field(dev, "acpi_path"));
+}
+
+/* Print the fields that differ, with the device header before the first */
+static int diff_fields(const struct result_fields *a,
+		       const struct result_fields *b)
+{
+	struct result_fields na, nb;
+	const char *va, *vb;
+	int diffs = 0;
+	int i;
+
+	if (normalize(a, &na) || normalize(b, &nb)) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0; i < na.count + nb.count; i++) {
+		const struct result_kv *kv = i < na.count ?
+			&na.kv[i] : &nb.kv[i - na.count];
+
+		va = result_get(&na, kv->key);
+		vb = result_get(&nb, kv->key);
+		if (va && vb && !strcmp(va, vb))
+			continue;
+		/* keys in both were printed in the first pass */
+		if (i >= na.count && va)
+			continue;
+
+		if (!diffs++) {
+			printf("\n");
+			print_device(a);
+			if (strcmp(field(a, "acpi_path"), field(b, "acpi_path")) ||
+			    strcmp(field(a, "hid"), field(b, "hid"))) {
+				printf(" -> ");
+				print_device(b);
+			}
+			printf("\n");
+		}
+		printf("  %s: %s -> %s\n", kv->key, va ? va : "(none)",
+		       vb ? vb : "(none)");
+	}
+
+	result_fields_free(&na);
+	result_fields_free(&nb);
+	return diffs;
+}
+
+static int diff_machines(const struct result_file *a,
+			 const struct result_file *b)
+{
+	int *pair, *used;
+	int diffs = 0, same = 0;
+	unsigned int k;
+	int pass, i;
+
+	printf("--- %s (%s)\n+++ %s (%s)\n", field(&a->info, "machine"),
+	       a->path, field(&b->info, "machine"), b->path);
+
+	for (k = 0; k < sizeof(machine_fields) / sizeof(machine_fields[0]);
+	     k++) {
+		if (strcmp(field(&a->info, machine_fields[k]),
+			   field(&b->info, machine_fields[k])))
+			printf("%s: %s -> %s\n", machine_fields[k],
+			       field(&a->info, machine_fields[k]),
+			       field(&b->info, machine_fields[k]));
+	}
+
+	pair = malloc((a->device_count + 1) * sizeof(*pair));
+	used = calloc(b->device_count + 1, sizeof(*used));
+	if (!pair || !used) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0; i < a->device_count; i++)
+		pair[i] = -1;
+	for (pass = 0; pass < 3; pass++) {
+		for (i = 0; i < a->device_count; i++) {
+			if (pair[i] >= 0)
+				continue;
+			pair[i] = match_device(a, i, b, used, pass);
+			if (pair[i] >= 0)
+				used[pair[i]] = 1;
+		}
+	}
+
+	for (i = 0; i < a->device_count; i++) {
+		if (pair[i] >= 0) {
+			if (diff_fields(&a->devices[i], &b->devices[pair[i]]))
+				diffs++;
+			else
+				same++;
+			continue;
+		}
+
+		printf("\n");
+		print_device(&a->devices[i]);
+		printf(": only in %s\n", field(&a->info, "machine"));
+		diffs++;
+	}
+
+	for (i = 0; i < b->device_count; i++) {
+		if (used[i])
+			continue;
+		printf("\n");
+		print_device(&b->devices[i]);
+		printf(": only in %s\n", field(&b->info, "machine"));
+		diffs++;
+	}
+
+	printf("\n%d devices differ, %d are identical\n", diffs, same);
+
+	free(pair);
+	free(used);
+	return diffs;
+}
+
+/*
+ * Find a result file: an existing path, or a unique substring of a file
+ * name in the results directory ("1901", "Surface_Book_2").
+ */
+static char *find_result(const char *dir, const char *name)
+{
+	char **paths = NULL;
+	char *found = NULL;
+	struct stat st;
+	int count = 0;
+	int matches = 0;
+	int i;
+
+	if (!stat(name, &st) && S_ISREG(st.st_mode))
+		return strdup(name);
+
+	if (results_list(dir, &paths, &count)) {
+		fprintf(stderr, "%s: can't list result files\n", dir);
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		const char *base = strrchr(paths[i], '/');
+
+		if (!strstr(base ? base + 1 : paths[i], name))
+			continue;
+		if (!matches++)
+			found = strdup(paths[i]);
+		else
+			fprintf(stderr, "%s: also matches %s\n", name,
+				paths[i]);
+	}
+
+	results_list_free(paths, count);
+
+	if (matches != 1) {
+		if (!matches)
+			fprintf(stderr, "%s: no result file found in %s\n",
+				name, dir);
+		free(found);
+		return NULL;
+	}
+
+	return found;
+}
+
+static int cmd_diff(const char *dir, const char *name_a, const char *name_b)
+{
+	struct result_file a, b;
+	char *path_a, *path_b;
+	int ret = -1;
+
+	path_a = find_result(dir, name_a);
+	path_b = find_result(dir, name_b);
+	if (!path_a || !path_b)
+		goto out;
+
+	if (results_parse(path_a, &a)) {
+		fprintf(stderr, "%s: can't parse\n", path_a);
+		goto out;
+	}
+	if (results_parse(path_b, &b)) {
+		fprintf(stderr, "%s: can't parse\n", path_b);
+		results_free(&a);
+		goto out;
+	}
+
+	diff_machines(&a, &b);
+	ret = 0;
+
+	results_free(&a);
+	results_free(&b);
+out:
+	free(path_a);
+	free(path_b);
+	return ret;
+}
+
+/*
+ * Clustering
+ */
+struct signature {
+	char *machine;
+	char *path;
+	uint64_t *hashes;		/* sorted and unique */
+	int count;
+};
+
+struct corpus {
+	struct signature *sigs;
+	int count;
+};
+
+static uint64_t fnv1a(uint64_t h, const char *s)
+{
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * A machine is the set of "type hid key=value" configuration fields of
+ * its devices. The ACPI path is left out so that the same hardware behind
+ * different ACPI names still compares equal.
+ */
+static int add_signature(const struct result_file *file, void *priv)
+{
+	struct corpus *corpus = priv;
+	struct result_fields norm;
+	struct signature *sig;
+	uint64_t h, *hashes;
+	int i, j, n = 0;
+
+	sig = realloc(corpus->sigs, (corpus->count + 1) * sizeof(*sig));
+	if (!sig)
+		return -1;
+	corpus->sigs = sig;
+	sig = &corpus->sigs[corpus->count];
+	memset(sig, 0, sizeof(*sig));
+
+	for (i = 0; i < file->device_count; i++) {
+		if (normalize(&file->devices[i], &norm))
+			return -1;
+
+		hashes = realloc(sig->hashes, (n + norm.count) * sizeof(*hashes));
+		if (!hashes) {
+			result_fields_free(&norm);
+			return -1;
+		}
+		sig->hashes = hashes;
+
+		h = fnv1a(0xcbf29ce484222325ULL, field(&file->devices[i], "type"));
+		h = fnv1a(h, field(&file->devices[i], "hid"));
+		for (j = 0; j < norm.count; j++) {
+			sig->hashes[n] = fnv1a(h, norm.kv[j].key);
+			sig->hashes[n] = fnv1a(sig->hashes[n], "=");
+			sig->hashes[n] = fnv1a(sig->hashes[n], norm.kv[j].value);
+			n++;
+		}
+
+		result_fields_free(&norm);
+	}
+
+	qsort(sig->hashes, n, sizeof(*sig->hashes), compare_u64);
+	for (i = 0, j = 0; i < n; i++) {
+		if (!j || sig->hashes[j - 1] != sig->hashes[i])
+			sig->hashes[j++] = sig->hashes[i];
+	}
+	sig->count = j;
+
+	sig->machine = strdup(field(&file->info, "machine"));
+	sig->path = strdup(file->path);
+	if (!sig->machine || !sig->path)
+		return -1;
+
+	corpus->count++;
+	return 0;
+}
+
+/* Jaccard similarity of two sorted sets */
+static double similarity(const struct signature *a, const struct signature *b)
+{
+	int i = 0, j = 0, common = 0;
+
+	if (!a->count && !b->count)
+		return 1.0;
+
+	while (i < a->count && j < b->count) {
+		if (a->hashes[i] == b->hashes[j]) {
+			common++;
+			i++;
+			j++;
+		} else if (a->hashes[i] < b->hashes[j]) {
+			i++;
+		} else {
+			j++;
+		}
+	}
+
+	return (double)common / (a->count + b->count - common);
+}
+
+/*
+ * Average linkage agglomerative clustering: merge the two most similar
+ * clusters until no pair is above @threshold.
+ */
+static int cluster(const struct corpus *corpus, double threshold,
+		   int *cluster_of)
+{
+	int n = corpus->count;
+	double *sim, best;
+	int *size;
+	int a, b, i, j;
+	int clusters = n;
+
+	sim = malloc((size_t)n * n * sizeof(*sim) + 1);
+	size = malloc(n * sizeof(*size) + 1);
+	if (!sim || !size) {
+		free(sim);
+		free(size);
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		cluster_of[i] = i;
+		size[i] = 1;
+		for (j = 0; j < n; j++)
+			sim[i * n + j] = similarity(&corpus->sigs[i],
+						    &corpus->sigs[j]);
+	}
+
+	while (clusters > 1) {
+		best = -1;
+		a = b = -1;
+		for (i = 0; i < n; i++) {
+			for (j = i + 1; j < n; j++) {
+				if (!size[i] || !size[j] ||
+				    sim[i * n + j] <= best)
+					continue;
+				best = sim[i * n + j];
+				a = i;
+				b = j;
+			}
+		}
+
+		if (best < threshold)
+			break;
+
+		/* merge b into a, similarities weighted by cluster size */
+		for (i = 0; i < n; i++) {
+			if (!size[i] || i == a || i == b)
+				continue;
+			sim[a * n + i] = (sim[a * n + i] * size[a] +
+					  sim[b * n + i] * size[b]) /
+					 (size[a] + size[b]);
+			sim[i * n + a] = sim[a * n + i];
+		}
+		size[a] += size[b];
+		size[b] = 0;
+		for (i = 0; i < n; i++) {
+			if (cluster_of[i] == b)
+				cluster_of[i] = a;
+		}
+		clusters--;
+	}
+
+	free(sim);
+	free(size);
+	return clusters;
+}
+
+static int cmd_cluster(char **args, int nargs, double threshold, int matrix)
+{
+	struct corpus corpus = { 0 };
+	char **paths = NULL;
+	int *cluster_of;
+	int count = 0;
+	int ret = -1;
+	int c, i, j, n;
+
+	for (i = 0; i < nargs; i++) {
+		if (results_list(args[i], &paths, &count)) {
+			fprintf(stderr, "%s: can't list result files\n",
+				args[i]);
+			goto out;
+		}
+	}
+
+	if (results_for_each(paths, count, add_signature, &corpus)) {
+		fprintf(stderr, "can't read result files\n");
+		goto out;
+	}
+
+	cluster_of = malloc(corpus.count * sizeof(*cluster_of) + 1);
+	if (!cluster_of)
+		goto out;
+
+	n = cluster(&corpus, threshold, cluster_of);
+	printf("%d machines in %d clusters (similarity >= %.2f)\n",
+	       corpus.count, n, threshold);
+
+	for (c = 0, n = 0; c < corpus.count; c++) {
+		for (i = 0, j = 0; i < corpus.count; i++) {
+			if (cluster_of[i] != c)
+				continue;
+			if (!j++)
+				printf("\ncluster %d:\n", ++n);
+			printf("  %-40s %s\n", corpus.sigs[i].machine,
+			       corpus.sigs[i].path);
+		}
+	}
+
+	if (matrix) {
+		printf("\n");
+		for (i = 0; i < corpus.count; i++) {
+			printf("%3d", i);
+			for (j = 0; j < corpus.count; j++)
+				printf(" %4.2f", similarity(&corpus.sigs[i],
+							    &corpus.sigs[j]));
+			printf("  %s\n", corpus.sigs[i].machine);
+		}
+	}
+
+	free(cluster_of);
+	ret = 0;
+out:
+	for (i = 0; i < corpus.count; i++) {
+		free(corpus.sigs[i].machine);
+		free(corpus.sigs[i].path);
+		free(corpus.sigs[i].hashes);
+	}
+	free(corpus.sigs);
+	results_list_free(paths, count);
+	return ret;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-a] [-d <results dir>] diff <result A> <result B>\n"
+		"       %s [-a] [-t <threshold>] [-m] cluster [results dir or file]...\n"
+		"  results can be given as a path or as a part of the file name\n",
+		argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = DEFAULT_RESULTS_DIR;
+	double threshold = DEFAULT_THRESHOLD;
+	char *default_args[] = { (char *)dir };
+	int matrix = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ad:t:m")) != -1) {
+		switch (opt) {
+		case 'a':
+			all_fields = 1;
+			break;
+		case 'd':
+			dir = optarg;
+			default_args[0] = optarg;
+			break;
+		case 't':
+			threshold = atof(optarg);
+			break;
+		case 'm':
+			matrix = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind < argc && !strcmp(argv[optind], "diff") &&
+	    argc - optind == 3)
+		return !!cmd_diff(dir, argv[optind + 1], argv[optind + 2]);
+
+	if (optind < argc && !strcmp(argv[optind], "cluster")) {
+		if (argc - optind == 1)
+			return !!cmd_cluster(default_args, 1, threshold,
+					     matrix);
+		return !!cmd_cluster(argv + optind + 1, argc - optind - 1,
+				     threshold, matrix);
+	}
+
+	usage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,911 @@
+/**
+ * This tool builds an index of the result files of dump_intel_ipu_data and
+ * answers field queries on it, such as "which sensors depend on a
+ * discrete PMIC and use a 19.2 MHz MCLK on link 1":
+ *
+ *   results_index update ../dump_intel_ipu_data/results
+ *   results_index query dep.cldb.control_logic_type=1 \
+ *           ssdb.mclk_speed=19200000 ssdb.link_used=1
+ *
+ * Updating an existing index only parses files that are new or changed
+ * since the last update, the records of the other files are copied over.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "results_parser.h"
+
+#define INDEX_MAGIC		"RIDX"
+#define INDEX_VERSION		1
+#define DEFAULT_INDEX		"results.idx"
+#define STRING_HASH_SIZE	(1 << 14)
+
+/*
+ * On-disk layout, native byte order, every section 4 byte aligned:
+ *   struct index_header
+ *   struct index_file     files[file_count]
+ *   struct index_record   records[record_count]
+ *   struct index_kv       kvs[kv_count]
+ *   struct index_posting  postings[posting_count]
+ *   char                  strings[string_size]
+ *
+ * Strings are referenced by offset and stored once. The postings hold one
+ * entry per record and field (machine wide fields are repeated for each
+ * record of the file), sorted by key then value, so that a query is a
+ * binary search per term.
+ */
+struct index_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t file_count;
+	uint32_t record_count;
+	uint32_t kv_count;
+	uint32_t posting_count;
+	uint32_t string_size;
+	uint32_t reserved;
+};
+
+struct index_file {
+	int64_t mtime;			/* in nanoseconds */
+	uint64_t size;
+	uint32_t path;
+	uint32_t info_first;		/* machine wide fields */
+	uint32_t info_count;
+	uint32_t record_first;
+	uint32_t record_count;
+	uint32_t reserved;
+};
+
+struct index_record {
+	uint32_t file;
+	uint32_t kv_first;
+	uint32_t kv_count;
+};
+
+struct index_kv {
+	uint32_t key;
+	uint32_t value;
+};
+
+struct index_posting {
+	uint32_t kv;
+	uint32_t record;
+};
+
+struct index {
+	void *map;
+	size_t map_size;
+	const struct index_header *hdr;
+	const struct index_file *files;
+	const struct index_record *records;
+	const struct index_kv *kvs;
+	const struct index_posting *postings;
+	const char *strings;
+};
+
+struct builder {
+	struct index_header hdr;
+	struct index_file *files;
+	struct index_record *records;
+	struct index_kv *kvs;
+	struct index_posting *postings;
+	char *strings;
+	size_t strings_size;
+	int *hash;
+	int *hash_next;
+	uint32_t *string_offsets;
+	int string_count;
+	int string_alloc;
+};
+
+/*
+ * Loading
+ */
+static int index_open(struct index *idx, const char *path)
+{
+	const struct index_header *hdr;
+	struct stat st;
+	size_t size;
+	int fd;
+
+	memset(idx, 0, sizeof(*idx));
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*hdr)) {
+		close(fd);
+		return -1;
+	}
+
+	idx->map_size = st.st_size;
+	idx->map = mmap(NULL, idx->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (idx->map == MAP_FAILED)
+		return -1;
+
+	hdr = idx->map;
+	size = sizeof(*hdr) +
+	       (size_t)hdr->file_count * sizeof(struct index_file) +
+	       (size_t)hdr->record_count * sizeof(struct index_record) +
+	       (size_t)hdr->kv_count * sizeof(struct index_kv) +
+	       (size_t)hdr->posting_count * sizeof(struct index_posting) +
+	       hdr->string_size;
+	if (memcmp(hdr->magic, INDEX_MAGIC, 4) ||
+	    hdr->version != INDEX_VERSION || size != idx->map_size) {
+		fprintf(stderr, "%s: not an index or wrong version\n", path);
+		munmap(idx->map, idx->map_size);
+		return -1;
+	}
+
+	idx->hdr = hdr;
+	idx->files = (const void *)(hdr + 1);
+	idx->records = (const void *)(idx->files + hdr->file_count);
+	idx->kvs = (const void *)(idx->records + hdr->record_count);
+	idx->postings = (const void *)(idx->kvs + hdr->kv_count);
+	idx->strings = (const char *)(idx->postings + hdr->posting_count);
+
+	return 0;
+}
+
+static void index_close(struct index *idx)
+{
+	if (idx->map)
+		munmap(idx->map, idx->map_size);
+	memset(idx, 0, sizeof(*idx));
+}
+
+/*
+ * Building
+ */
+/* Arrays hold a power of two number of elements, grow them when full */
+static void *grow(void *array, uint32_t count, size_t elem_size)
+{
+	void *tmp;
+
+	if (count & (count - 1))
+		return array;
+
+	tmp = realloc(array, (count ? 2 * count : 1) * elem_size);
+	if (!tmp)
+		free(array);
+	return tmp;
+}
+
+static unsigned int string_hash(const char *s)
+{
+	unsigned int h = 5381;
+
+	while (*s)
+		h = h * 33 + (unsigned char)*s++;
+
+	return h & (STRING_HASH_SIZE - 1);
+}
+
+static int builder_init(struct builder *b)
+{
+	int i;
+
+	memset(b, 0, sizeof(*b));
+	memcpy(b->hdr.magic, INDEX_MAGIC, 4);
+	b->hdr.version = INDEX_VERSION;
+
+	b->hash = malloc(STRING_HASH_SIZE * sizeof(*b->hash));
+	if (!b->hash)
+		return -1;
+	for (i = 0; i < STRING_HASH_SIZE; i++)
+		b->hash[i] = -1;
+
+	return 0;
+}
+
+static void builder_free(struct builder *b)
+{
+	free(b->files);
+	free(b->records);
+	free(b->kvs);
+	free(b->postings);
+	free(b->strings);
+	free(b->hash);
+	free(b->hash_next);
+	free(b->string_offsets);
+}
+
+/* Return the offset of @s in the string table, adding it if needed */
+static int64_t intern(struct builder *b, const char *s)
+{
+	unsigned int h = string_hash(s);
+	size_t len = strlen(s) + 1;
+	char *strings;
+	void *tmp;
+	int i;
+
+	for (i = b->hash[h]; i >= 0; i = b->hash_next[i]) {
+		if (!strcmp(b->strings + b->string_offsets[i], s))
+			return b->string_offsets[i];
+	}
+
+	if (b->string_count == b->string_alloc) {
+		b->string_alloc = b->string_alloc ? b->string_alloc * 2 : 1024;
+		tmp = realloc(b->hash_next,
+			      b->string_alloc * sizeof(*b->hash_next));
+		if (!tmp)
+			return -1;
+		b->hash_next = tmp;
+		tmp = realloc(b->string_offsets,
+			      b->string_alloc * sizeof(*b->string_offsets));
+		if (!tmp)
+			return -1;
+		b->string_offsets = tmp;
+	}
+
+	strings = realloc(b->strings, b->strings_size + len);
+	if (!strings)
+		return -1;
+	b->strings = strings;
+	memcpy(b->strings + b->strings_size, s, len);
+
+	b->string_offsets[b->string_count] = b->strings_size;
+	b->hash_next[b->string_count] = b->hash[h];
+	b->hash[h] = b->string_count++;
+	b->strings_size += len;
+
+	return b->string_offsets[b->string_count - 1];
+}
+
+static int add_kv(struct builder *b, const char *key, const char *value)
+{
+	int64_t k, v;
+
+	k = intern(b, key);
+	v = intern(b, value);
+	if (k < 0 || v < 0)
+		return -1;
+
+	b->kvs = grow(b->kvs, b->hdr.kv_count, sizeof(*b->kvs));
+	if (!b->kvs)
+		return -1;
+
+	b->kvs[b->hdr.kv_count].key = k;
+	b->kvs[b->hdr.kv_count++].value = v;
+	return 0;
+}
+
+static int64_t file_mtime(const struct stat *st)
+{
+	return (int64_t)st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static struct index_file *add_file(struct builder *b, const char *path,
+				   const struct stat *st)
+{
+	struct index_file *file;
+	int64_t p;
+
+	p = intern(b, path);
+	if (p < 0)
+		return NULL;
+
+	b->files = grow(b->files, b->hdr.file_count, sizeof(*b->files));
+	if (!b->files)
+		return NULL;
+
+	file = &b->files[b->hdr.file_count++];
+	memset(file, 0, sizeof(*file));
+	file->path = p;
+	file->mtime = file_mtime(st);
+	file->size = st->st_size;
+	file->info_first = b->hdr.kv_count;
+	file->record_first = b->hdr.record_count;
+
+	return file;
+}
+
+static struct index_record *add_record(struct builder *b)
+{
+	struct index_record *rec;
+
+	b->records = grow(b->records, b->hdr.record_count, sizeof(*b->records));
+	if (!b->records)
+		return NULL;
+
+	rec = &b->records[b->hdr.record_count++];
+	rec->file = b->hdr.file_count - 1;
+	rec->kv_first = b->hdr.kv_count;
+	rec->kv_count = 0;
+
+	return rec;
+}
+
+static int add_fields(struct builder *b, const struct result_fields *fields)
+{
+	int i;
+
+	for (i = 0; i < fields->count; i++) {
+		if (add_kv(b, fields->kv[i].key, fields->kv[i].value))
+			return -1;
+	}
+
+	return 0;
+}
+
+static int add_parsed_file(struct builder *b, const char *path,
+			   const struct stat *st)
+{
+	struct result_file result;
+	struct index_file *file;
+	struct index_record *rec;
+	int ret = -1;
+	int i;
+
+	if (results_parse(path, &result)) {
+		fprintf(stderr, "%s: can't parse\n", path);
+		return -1;
+	}
+
+	file = add_file(b, path, st);
+	if (!file || add_fields(b, &result.info))
+		goto out;
+	file = &b->files[b->hdr.file_count - 1];
+	file->info_count = b->hdr.kv_count - file->info_first;
+
+	for (i = 0; i < result.device_count; i++) {
+		rec = add_record(b);
+		if (!rec || add_fields(b, &result.devices[i]))
+			goto out;
+		rec = &b->records[b->hdr.record_count - 1];
+		rec->kv_count = b->hdr.kv_count - rec->kv_first;
+	}
+
+	b->files[b->hdr.file_count - 1].record_count = result.device_count;
+	ret = 0;
+out:
+	results_free(&result);
+	return ret;
+}
+
+static int copy_kvs(struct builder *b, const struct index *idx,
+		    uint32_t first, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = first; i < first + count; i++) {
+		if (add_kv(b, idx->strings + idx->kvs[i].key,
+			   idx->strings + idx->kvs[i].value))
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Copy the records of an unchanged file from the previous index */
+static int add_indexed_file(struct builder *b, const struct index *idx,
+			    const struct index_file *old, const char *path,
+			    const struct stat *st)
+{
+	const struct index_record *old_rec;
+	struct index_record *rec;
+	struct index_file *file;
+	uint32_t i;
+
+	file = add_file(b, path, st);
+	if (!file || copy_kvs(b, idx, old->info_first, old->info_count))
+		return -1;
+	file = &b->files[b->hdr.file_count - 1];
+	file->info_count = old->info_count;
+	file->record_count = old->record_count;
+
+	for (i = 0; i < old->record_count; i++) {
+		old_rec = &idx->records[old->record_first + i];
+		rec = add_record(b);
+		if (!rec || copy_kvs(b, idx, old_rec->kv_first,
+				     old_rec->kv_count))
+			return -1;
+		b->records[b->hdr.record_count - 1].kv_count = old_rec->kv_count;
+	}
+
+	return 0;
+}
+
+static const struct builder *sort_builder;
+
+static int compare_postings(const void *a, const void *b)
+{
+	const struct index_posting *pa = a, *pb = b;
+	const struct index_kv *ka = &sort_builder->kvs[pa->kv];
+	const struct index_kv *kb = &sort_builder->kvs[pb->kv];
+	const char *s = sort_builder->strings;
+	int ret;
+
+	ret = strcmp(s + ka->key, s + kb->key);
+	if (!ret)
+		ret = strcmp(s + ka->value, s + kb->value);
+	if (!ret)
+		ret = (pa->record > pb->record) - (pa->record < pb->record);
+	return ret;
+}
+
+static int build_postings(struct builder *b)
+{
+	const struct index_file *file;
+	const struct index_record *rec;
+	uint32_t f, r, k, count = 0;
+
+	for (r = 0; r < b->hdr.record_count; r++) {
+		rec = &b->records[r];
+		count += rec->kv_count + b->files[rec->file].info_count;
+	}
+
+	b->postings = malloc((count ? count : 1) * sizeof(*b->postings));
+	if (!b->postings)
+		return -1;
+
+	for (f = 0; f < b->hdr.file_count; f++) {
+		file = &b->files[f];
+		for (r = file->record_first;
+		     r < file->record_first + file->record_count; r++) {
+			rec = &b->records[r];
+			for (k = 0; k < file->info_count; k++)
+				b->postings[b->hdr.posting_count++] =
+					(struct index_posting){
+						file->info_first + k, r };
+			for (k = 0; k < rec->kv_count; k++)
+				b->postings[b->hdr.posting_count++] =
+					(struct index_posting){
+						rec->kv_first + k, r };
+		}
+	}
+
+	sort_builder = b;
+	qsort(b->postings, b->hdr.posting_count, sizeof(*b->postings),
+	      compare_postings);
+
+	return 0;
+}
+
+static int write_section(FILE *f, const void *data, size_t size)
+{
+	return size && fwrite(data, size, 1, f) != 1 ? -1 : 0;
+}
+
+static int builder_write(struct builder *b, const char *path)
+{
+	char tmp[4096];
+	int ret = 0;
+	FILE *f;
+
+	/* keep the string table size 4 byte aligned */
+	while (b->strings_size % 4) {
+		char *strings = realloc(b->strings, b->strings_size + 1);
+
+		if (!strings)
+			return -1;
+		b->strings = strings;
+		b->strings[b->strings_size++] = '\0';
+	}
+	b->hdr.string_size = b->strings_size;
+
+	/* write a new file and rename it, readers never see a partial index */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	f = fopen(tmp, "wb");
+	if (!f)
+		return -1;
+
+	ret |= write_section(f, &b->hdr, sizeof(b->hdr));
+	ret |= write_section(f, b->files,
+			     b->hdr.file_count * sizeof(*b->files));
+	ret |= write_section(f, b->records,
+			     b->hdr.record_count * sizeof(*b->records));
+	ret |= write_section(f, b->kvs, b->hdr.kv_count * sizeof(*b->kvs));
+	ret |= write_section(f, b->postings,
+			     b->hdr.posting_count * sizeof(*b->postings));
+	ret |= write_section(f, b->strings, b->strings_size);
+
+	if (fclose(f) || ret || rename(tmp, path)) {
+		unlink(tmp);
+		return -1;
+	}
+
+	return 0;
+}
+
+static const struct index_file *find_file(const struct index *idx,
+					  const char *path)
+{
+	uint32_t i;
+
+	if (!idx->hdr)
+		return NULL;
+
+	for (i = 0; i < idx->hdr->file_count; i++) {
+		if (!strcmp(idx->strings + idx->files[i].path, path))
+			return &idx->files[i];
+	}
+
+	return NULL;
+}
+
+static int cmd_update(const char *index_path, int full, char **args,
+		      int nargs)
+{
+	const struct index_file *old;
+	int parsed = 0, reused = 0;
+	struct builder b;
+	struct index idx;
+	char **paths = NULL;
+	struct stat st;
+	int count = 0;
+	int ret = -1;
+	int i;
+
+	for (i = 0; i < nargs; i++) {
+		if (results_list(args[i], &paths, &count)) {
+			fprintf(stderr, "%s: can't list result files\n",
+				args[i]);
+			results_list_free(paths, count);
+			return -1;
+		}
+	}
+
+	if (full || index_open(&idx, index_path))
+		memset(&idx, 0, sizeof(idx));
+
+	if (builder_init(&b))
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		if (stat(paths[i], &st)) {
+			fprintf(stderr, "%s: can't stat\n", paths[i]);
+			goto out;
+		}
+
+		old = find_file(&idx, paths[i]);
+		if (old && old->mtime == file_mtime(&st) &&
+		    old->size == (uint64_t)st.st_size) {
+			if (add_indexed_file(&b, &idx, old, paths[i], &st))
+				goto out;
+			reused++;
+		} else {
+			if (add_parsed_file(&b, paths[i], &st))
+				goto out;
+			parsed++;
+		}
+	}
+
+	if (build_postings(&b) || builder_write(&b, index_path)) {
+		fprintf(stderr, "%s: can't write index\n", index_path);
+		goto out;
+	}
+
+	printf("%s: %u files (%d parsed, %d unchanged), %u records, %u bytes of strings\n",
+	       index_path, b.hdr.file_count, parsed, reused,
+	       b.hdr.record_count, b.hdr.string_size);
+	ret = 0;
+out:
+	builder_free(&b);
+	index_close(&idx);
+	results_list_free(paths, count);
+	return ret;
+}
+
+/*
+ * Queries
+ */
+enum query_op {
+	QUERY_EXISTS,
+	QUERY_EQ,
+	QUERY_NE,
+	QUERY_LT,
+	QUERY_GT,
+	QUERY_CONTAINS,
+};
+
+struct query_term {
+	char key[128];
+	const char *value;
+	enum query_op op;
+};
+
+static int parse_term(const char *arg, struct query_term *term)
+{
+	static const struct {
+		const char *str;
+		enum query_op op;
+	} ops[] = {
+		/* two character operators first */
+		{ "!=", QUERY_NE },
+		{ "=", QUERY_EQ },
+		{ "<", QUERY_LT },
+		{ ">", QUERY_GT },
+		{ "~", QUERY_CONTAINS },
+	};
+	size_t len = strcspn(arg, "!=<>~");
+	unsigned int i;
+
+	if (!len || len >= sizeof(term->key))
+		return -1;
+
+	memcpy(term->key, arg, len);
+	term->key[len] = '\0';
+	term->op = QUERY_EXISTS;
+	term->value = NULL;
+
+	if (!arg[len])
+		return 0;
+
+	for (i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		if (!strncmp(arg + len, ops[i].str, strlen(ops[i].str))) {
+			term->op = ops[i].op;
+			term->value = arg + len + strlen(ops[i].str);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int match_value(const struct query_term *term, const char *value)
+{
+	long long a, b;
+	char *end;
+
+	switch (term->op) {
+	case QUERY_EXISTS:
+		return 1;
+	case QUERY_EQ:
+		return !strcmp(value, term->value);
+	case QUERY_NE:
+		return strcmp(value, term->value);
+	case QUERY_CONTAINS:
+		return !!strstr(value, term->value);
+	default:
+		a = strtoll(value, &end, 0);
+		if (end == value || *end)
+			return 0;
+		b = strtoll(term->value, &end, 0);
+		if (end == term->value || *end)
+			return 0;
+		return term->op == QUERY_LT ? a < b : a > b;
+	}
+}
+
+/* First posting with key >= @key (and value >= @value if not NULL) */
+static uint32_t lower_bound(const struct index *idx, const char *key,
+			    const char *value)
+{
+	uint32_t lo = 0, hi = idx->hdr->posting_count;
+	const struct index_kv *kv;
+	uint32_t mid;
+	int cmp;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		kv = &idx->kvs[idx->postings[mid].kv];
+		cmp = strcmp(idx->strings + kv->key, key);
+		if (!cmp && value)
+			cmp = strcmp(idx->strings + kv->value, value);
+		if (cmp < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Count the terms matched by each record */
+static void query_term(const struct index *idx, const struct query_term *term,
+		       uint8_t *matched, uint8_t *hits)
+{
+	const struct index_posting *p;
+	const struct index_kv *kv;
+	uint32_t i;
+
+	memset(matched, 0, idx->hdr->record_count);
+
+	i = lower_bound(idx, term->key,
+			term->op == QUERY_EQ ? term->value : NULL);
+	for (; i < idx->hdr->posting_count; i++) {
+		p = &idx->postings[i];
+		kv = &idx->kvs[p->kv];
+		if (strcmp(idx->strings + kv->key, term->key))
+			break;
+		if (term->op == QUERY_EQ &&
+		    strcmp(idx->strings + kv->value, term->value))
+			break;
+		if (match_value(term, idx->strings + kv->value))
+			matched[p->record] = 1;
+	}
+
+	for (i = 0; i < idx->hdr->record_count; i++)
+		hits[i] += matched[i];
+}
+
+static void print_kvs(const struct index *idx, uint32_t first, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = first; i < first + count; i++)
+		printf("    %s: %s\n", idx->strings + idx->kvs[i].key,
+		       idx->strings + idx->kvs[i].value);
+}
+
+static const char *record_get(const struct index *idx, uint32_t first,
+			      uint32_t count, const char *key)
+{
+	uint32_t i;
+
+	for (i = first; i < first + count; i++) {
+		if (!strcmp(idx->strings + idx->kvs[i].key, key))
+			return idx->strings + idx->kvs[i].value;
+	}
+
+	return "-";
+}
+
+static int cmd_query(const char *index_path, int verbose, char **args,
+		     int nargs)
+{
+	const struct index_record *rec;
+	const struct index_file *file;
+	struct query_term term;
+	uint8_t *matched, *hits;
+	struct index idx;
+	int found = 0;
+	uint32_t r;
+	int i;
+
+	if (index_open(&idx, index_path)) {
+		fprintf(stderr, "%s: can't open index, run update first\n",
+			index_path);
+		return -1;
+	}
+
+	matched = malloc(idx.hdr->record_count + 1);
+	hits = calloc(idx.hdr->record_count + 1, 1);
+	if (!matched || !hits)
+		goto out;
+
+	for (i = 0; i < nargs; i++) {
+		if (parse_term(args[i], &term)) {
+			fprintf(stderr, "%s: invalid term\n", args[i]);
+			goto out;
+		}
+		query_term(&idx, &term, matched, hits);
+	}
+
+	for (r = 0; r < idx.hdr->record_count; r++) {
+		if (hits[r] != nargs)
+			continue;
+
+		rec = &idx.records[r];
+		file = &idx.files[rec->file];
+		printf("%s: %s %s (%s)\n",
+		       record_get(&idx, file->info_first, file->info_count,
+				  "machine"),
+		       record_get(&idx, rec->kv_first, rec->kv_count,
+				  "acpi_path"),
+		       record_get(&idx, rec->kv_first, rec->kv_count, "hid"),
+		       record_get(&idx, rec->kv_first, rec->kv_count, "type"));
+		if (verbose) {
+			printf("    file: %s\n", idx.strings + file->path);
+			print_kvs(&idx, file->info_first, file->info_count);
+			print_kvs(&idx, rec->kv_first, rec->kv_count);
+		}
+		found++;
+	}
+
+	fprintf(stderr, "%d of %u records matched\n", found,
+		idx.hdr->record_count);
+out:
+	free(matched);
+	free(hits);
+	index_close(&idx);
+	return 0;
+}
+
+/* List the keys and how many distinct values each one has */
+static int cmd_keys(const char *index_path)
+{
+	const struct index_kv *kv, *prev = NULL;
+	int values = 0, records = 0;
+	struct index idx;
+	uint32_t i;
+
+	if (index_open(&idx, index_path)) {
+		fprintf(stderr, "%s: can't open index, run update first\n",
+			index_path);
+		return -1;
+	}
+
+	for (i = 0; i <= idx.hdr->posting_count; i++) {
+		kv = i < idx.hdr->posting_count ?
+		     &idx.kvs[idx.postings[i].kv] : NULL;
+
+		if (prev && (!kv || strcmp(idx.strings + kv->key,
+					   idx.strings + prev->key))) {
+			printf("%-40s %4d records %4d values\n",
+			       idx.strings + prev->key, records, values);
+			values = records = 0;
+			prev = NULL;
+		}
+		if (!kv)
+			break;
+
+		if (!prev || strcmp(idx.strings + kv->value,
+				    idx.strings + prev->value))
+			values++;
+		records++;
+		prev = kv;
+	}
+
+	index_close(&idx);
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-i <index>] update [-f] <results dir or file>...\n"
+		"       %s [-i <index>] query [-v] [key[=|!=|<|>|~]value]...\n"
+		"       %s [-i <index>] keys\n", argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	const char *index_path = DEFAULT_INDEX;
+	int verbose = 0, full = 0;
+	const char *cmd;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "+i:")) != -1) {
+		switch (opt) {
+		case 'i':
+			index_path = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	cmd = argv[optind];
+	optind++;
+
+	while ((opt = getopt(argc, argv, "fv")) != -1) {
+		switch (opt) {
+		case 'f':
+			full = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!strcmp(cmd, "update") && optind < argc)
+		return !!cmd_update(index_path, full, argv + optind,
+				    argc - optind);
+	if (!strcmp(cmd, "query"))
+		return !!cmd_query(index_path, verbose, argv + optind,
+				   argc - optind);
+	if (!strcmp(cmd, "keys"))
+		return !!cmd_keys(index_path);
+
+	usage(argv[0]);
+	return 1;
+}
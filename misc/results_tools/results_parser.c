@@ -0,0 +1,617 @@
+/**
+ * Parser for the dmesg formatted output of dump_intel_ipu_data, as saved
+ * in misc/dump_intel_ipu_data/results.
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "results_parser.h"
+
+#define LINE_BUF_SIZE	4096
+#define KEY_BUF_SIZE	128
+
+/* sections of dump_intel_ipu_data output holding "name: value" lines */
+enum section {
+	SECTION_NONE,
+	SECTION_PLD,
+	SECTION_CRS,
+	SECTION_SSDB,
+	SECTION_CLDB,
+	SECTION_DSMB,
+};
+
+static const char * const section_names[] = {
+	[SECTION_NONE]	= NULL,
+	[SECTION_PLD]	= "pld",
+	[SECTION_CRS]	= "crs",
+	[SECTION_SSDB]	= "ssdb",
+	[SECTION_CLDB]	= "cldb",
+	[SECTION_DSMB]	= "dsmb",
+};
+
+struct parser {
+	struct result_file *file;
+	struct result_fields *dev;
+	enum section section;
+	/* key the following hex dump lines are appended to */
+	char hex_key[KEY_BUF_SIZE];
+	char *hex;
+	size_t hex_len;
+};
+
+int result_add(struct result_fields *fields, const char *key,
+	       const char *value)
+{
+	struct result_kv *kv;
+
+	if (fields->count == fields->size) {
+		int size = fields->size ? fields->size * 2 : 32;
+
+		kv = realloc(fields->kv, size * sizeof(*kv));
+		if (!kv)
+			return -1;
+		fields->kv = kv;
+		fields->size = size;
+	}
+
+	kv = &fields->kv[fields->count];
+	kv->key = strdup(key);
+	kv->value = strdup(value);
+	if (!kv->key || !kv->value) {
+		free(kv->key);
+		free(kv->value);
+		return -1;
+	}
+
+	fields->count++;
+	return 0;
+}
+
+const char *result_get(const struct result_fields *fields, const char *key)
+{
+	int i;
+
+	for (i = 0; i < fields->count; i++) {
+		if (!strcmp(fields->kv[i].key, key))
+			return fields->kv[i].value;
+	}
+
+	return NULL;
+}
+
+void result_fields_free(struct result_fields *fields)
+{
+	int i;
+
+	for (i = 0; i < fields->count; i++) {
+		free(fields->kv[i].key);
+		free(fields->kv[i].value);
+	}
+	free(fields->kv);
+	memset(fields, 0, sizeof(*fields));
+}
+
+void results_free(struct result_file *file)
+{
+	int i;
+
+	result_fields_free(&file->info);
+	for (i = 0; i < file->device_count; i++)
+		result_fields_free(&file->devices[i]);
+	free(file->devices);
+	memset(file, 0, sizeof(*file));
+}
+
+static char *trim(char *s)
+{
+	char *end;
+
+	while (isspace((unsigned char)*s))
+		s++;
+
+	end = s + strlen(s);
+	while (end > s && isspace((unsigned char)end[-1]))
+		*--end = '\0';
+
+	return s;
+}
+
+static int starts_with(const char *s, const char *prefix)
+{
+	return !strncmp(s, prefix, strlen(prefix));
+}
+
+/* Strip the "kern  :info  : [   97.612626] " prefix of dmesg -x output */
+static char *kernel_message(char *line)
+{
+	char *p;
+
+	if (!starts_with(line, "kern"))
+		return NULL;
+
+	p = strchr(line, ']');
+	if (!p)
+		return NULL;
+
+	return p[1] == ' ' ? p + 2 : p + 1;
+}
+
+static int flush_hex(struct parser *ps)
+{
+	int ret = 0;
+
+	if (ps->hex_len && ps->dev)
+		ret = result_add(ps->dev, ps->hex_key, ps->hex);
+
+	ps->hex_key[0] = '\0';
+	ps->hex_len = 0;
+	return ret;
+}
+
+/* "00000010: 00 00 01 02 ...  ........" */
+static int is_hex_line(const char *msg)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		if (!isxdigit((unsigned char)msg[i]))
+			return 0;
+	}
+
+	return msg[8] == ':';
+}
+
+static int add_hex_line(struct parser *ps, const char *msg)
+{
+	const char *p = msg + 9;
+	char *hex;
+
+	/* bytes are " hh", the ASCII column is after two spaces */
+	while (p[0] == ' ' && isxdigit((unsigned char)p[1]) &&
+	       isxdigit((unsigned char)p[2]) &&
+	       (p[3] == ' ' || p[3] == '\0')) {
+		hex = realloc(ps->hex, ps->hex_len + 3);
+		if (!hex)
+			return -1;
+		ps->hex = hex;
+		ps->hex[ps->hex_len++] = tolower((unsigned char)p[1]);
+		ps->hex[ps->hex_len++] = tolower((unsigned char)p[2]);
+		ps->hex[ps->hex_len] = '\0';
+		p += 3;
+	}
+
+	return 0;
+}
+
+static int start_hex(struct parser *ps, const char *name)
+{
+	if (flush_hex(ps))
+		return -1;
+
+	snprintf(ps->hex_key, sizeof(ps->hex_key), "%s%s%s",
+		 section_names[ps->section] ? section_names[ps->section] : "",
+		 section_names[ps->section] ? "." : "", name);
+	return 0;
+}
+
+static int new_device(struct parser *ps, const char *msg)
+{
+	struct result_file *file = ps->file;
+	struct result_fields *devices;
+	char name[64];
+
+	devices = realloc(file->devices,
+			  (file->device_count + 1) * sizeof(*devices));
+	if (!devices)
+		return -1;
+	file->devices = devices;
+
+	ps->dev = &devices[file->device_count++];
+	memset(ps->dev, 0, sizeof(*ps->dev));
+	ps->section = SECTION_NONE;
+
+	if (sscanf(strstr(msg, "= ") + 2, "%63s", name) != 1)
+		return 0;
+
+	if (result_add(ps->dev, "type", strstr(msg, "(Sensor)") ?
+		       "sensor" : "pmic") ||
+	    result_add(ps->dev, "acpi_device_name", name))
+		return -1;
+
+	return 0;
+}
+
+/* "ACPI _HID: INT33BE" and friends */
+static int parse_acpi_object(struct parser *ps, char *msg)
+{
+	static const struct {
+		const char *prefix;
+		const char *key;
+	} objects[] = {
+		{ "ACPI _ADR: ", "adr" },
+		{ "ACPI _HID: ", "hid" },
+		{ "ACPI _CID: ", "cid" },
+		{ "ACPI _DDN: ", "ddn" },
+		{ "ACPI _SUB: ", "sub" },
+		{ "ACPI _UID: ", "uid" },
+		{ "ACPI path: ", "acpi_path" },
+		{ "i2c device name: ", "i2c_device_name" },
+	};
+	unsigned int i;
+	char *value;
+
+	for (i = 0; i < sizeof(objects) / sizeof(objects[0]); i++) {
+		if (!starts_with(msg, objects[i].prefix))
+			continue;
+
+		value = trim(msg + strlen(objects[i].prefix));
+		if (!strcmp(value, "Entry not found"))
+			return 0;
+		return result_add(ps->dev, objects[i].key, value);
+	}
+
+	/* "ACPI _DEP (1 of 2): \_SB_.PCI0.I2C2.SKC1" */
+	if (starts_with(msg, "ACPI _DEP (")) {
+		value = strstr(msg, "): ");
+		if (value)
+			return result_add(ps->dev, "dep", trim(value + 3));
+	}
+
+	return 0;
+}
+
+/* "__dump_i2c_dev_dsm(): i2c device _DSM data (1 of 1): 0x02003600, ..." */
+static int parse_dsm(struct parser *ps, char *msg)
+{
+	char *p;
+
+	if ((p = strstr(msg, "Subsystem ID: ")))
+		return result_add(ps->dev, "subsys_id", trim(p + 14));
+	if ((p = strstr(msg, "i2c device amount: ")))
+		return result_add(ps->dev, "dsm.i2c_count", trim(p + 19));
+	if ((p = strstr(msg, "GPIO pin amount: ")))
+		return result_add(ps->dev, "dsm.gpio_count", trim(p + 17));
+
+	if (!(p = strstr(msg, "_DSM data (")) || !(p = strstr(p, "): ")))
+		return 0;
+
+	p += 3;
+	p[strcspn(p, ",")] = '\0';
+	return result_add(ps->dev, strstr(msg, "__dump_i2c_dev_dsm") ?
+			  "dsm.i2c" : "dsm.gpio", p);
+}
+
+static int parse_section_field(struct parser *ps, char *msg)
+{
+	char key[KEY_BUF_SIZE];
+	char *value;
+
+	value = strchr(msg, ':');
+	if (!value || !section_names[ps->section])
+		return 0;
+	*value++ = '\0';
+
+	/* "----- in string -----" part of _PLD: "PLD_Panel: FRONT" */
+	if (starts_with(msg, "PLD_"))
+		snprintf(key, sizeof(key), "pld.%s_str", msg + 4);
+	else
+		snprintf(key, sizeof(key), "%s.%s", section_names[ps->section],
+			 trim(msg));
+
+	value = trim(value);
+	for (msg = key; *msg; msg++)
+		*msg = tolower((unsigned char)*msg);
+
+	/* "reserved:" and friends are followed by a hex dump */
+	if (!*value)
+		return start_hex(ps, key + strlen(section_names[ps->section]) +
+				     1);
+
+	return result_add(ps->dev, key, value);
+}
+
+static int parse_kernel_message(struct parser *ps, char *msg)
+{
+	struct result_file *file = ps->file;
+	char *p;
+
+	if (is_hex_line(msg)) {
+		if (ps->hex_key[0])
+			return add_hex_line(ps, msg);
+		return 0;
+	}
+
+	if (flush_hex(ps))
+		return -1;
+
+	if ((p = strstr(msg, "dump_intel_ipu_data: Version "))) {
+		p += strlen("dump_intel_ipu_data: Version ");
+		p[strcspn(p, " ")] = '\0';
+		return result_add(&file->info, "driver_version", p);
+	}
+
+	if (strstr(msg, "====================") &&
+	    (strstr(msg, "(Sensor)") || strstr(msg, "(PMIC)")))
+		return new_device(ps, msg);
+
+	if (!ps->dev)
+		return 0;
+
+	if (strstr(msg, "---------- dump_pld()")) {
+		ps->section = SECTION_PLD;
+		return 0;
+	}
+	if (strstr(msg, "---------- dump_crs()")) {
+		ps->section = SECTION_CRS;
+		return 0;
+	}
+	if (strstr(msg, "---------- dump_ssdb()")) {
+		ps->section = SECTION_SSDB;
+		return 0;
+	}
+	if (strstr(msg, "---------- dump_cldb()")) {
+		ps->section = SECTION_CLDB;
+		return 0;
+	}
+
+	if (strstr(msg, "Full raw output of DSMB:")) {
+		ps->section = SECTION_DSMB;
+		return start_hex(ps, "raw");
+	}
+	if (strstr(msg, "Full raw output:"))
+		return start_hex(ps, "raw");
+
+	/* the excerpt repeats SSDB fields */
+	if (strstr(msg, "----- excerpt -----")) {
+		ps->section = SECTION_NONE;
+		return 0;
+	}
+	if (strstr(msg, "----- in string -----"))
+		return 0;
+
+	if ((p = strstr(msg, "PMIC type is "))) {
+		p = strstr(p, ": ");
+		return p ? result_add(ps->dev, "pmic_type", trim(p + 2)) : 0;
+	}
+
+	if (starts_with(msg, "ACPI ") || starts_with(msg, "i2c device name")) {
+		ps->section = SECTION_NONE;
+		return parse_acpi_object(ps, msg);
+	}
+
+	if (starts_with(msg, "__dump_")) {
+		ps->section = SECTION_NONE;
+		return parse_dsm(ps, msg);
+	}
+
+	return parse_section_field(ps, msg);
+}
+
+/* Lines before the dmesg output: DMI, CPU, os-release and uname */
+static int parse_info_line(struct parser *ps, char *line)
+{
+	struct result_fields *info = &ps->file->info;
+	char key[KEY_BUF_SIZE];
+	char *p;
+
+	line = trim(line);
+
+	if (starts_with(line, "Result on "))
+		return result_add(info, "machine", line + 10);
+
+	if (starts_with(line, "/sys/class/dmi/id/")) {
+		p = strchr(line, ':');
+		if (!p)
+			return 0;
+		*p++ = '\0';
+		line += strlen("/sys/class/dmi/id/");
+		if (!strcmp(line, "modalias") || !strcmp(line, "uevent"))
+			return 0;
+		snprintf(key, sizeof(key), "dmi.%s", line);
+		return result_add(info, key, trim(p));
+	}
+
+	if (starts_with(line, "PRETTY_NAME=")) {
+		p = line + 12;
+		if (*p == '"') {
+			p++;
+			p[strcspn(p, "\"")] = '\0';
+		}
+		return result_add(info, "os", p);
+	}
+
+	if (starts_with(line, "uname -r: "))
+		return result_add(info, "kernel", trim(line + 10));
+
+	if (strstr(line, "CPU") && !strchr(line, '=') && !strchr(line, ':'))
+		return result_add(info, "cpu", line);
+
+	return 0;
+}
+
+static int is_dep_key(const char *key)
+{
+	return !strcmp(key, "pmic_type") ||
+	       (starts_with(key, "cldb.") && strcmp(key, "cldb.raw") &&
+		strcmp(key, "cldb.reserved"));
+}
+
+/* Copy the CLDB of the PMICs a sensor depends on as dep.cldb.* */
+static int link_deps(struct result_file *file)
+{
+	const struct result_fields *pmic;
+	struct result_fields *dev;
+	char key[KEY_BUF_SIZE];
+	const char *path;
+	int i, j, k, l;
+
+	for (i = 0; i < file->device_count; i++) {
+		dev = &file->devices[i];
+
+		for (j = 0; j < dev->count; j++) {
+			if (strcmp(dev->kv[j].key, "dep"))
+				continue;
+
+			for (k = 0; k < file->device_count; k++) {
+				pmic = &file->devices[k];
+				path = result_get(pmic, "acpi_path");
+				if (k == i || !path ||
+				    strcmp(path, dev->kv[j].value))
+					continue;
+
+				for (l = 0; l < pmic->count; l++) {
+					if (!is_dep_key(pmic->kv[l].key))
+						continue;
+					snprintf(key, sizeof(key), "dep.%s",
+						 pmic->kv[l].key);
+					if (result_add(dev, key,
+						       pmic->kv[l].value))
+						return -1;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * results_parse - parse a result file
+ * @path: path of the file
+ * @file: filled with the parsed fields, free with results_free()
+ *
+ * Return 0 on success, -1 if the file can't be read or on allocation
+ * failure.
+ */
+int results_parse(const char *path, struct result_file *file)
+{
+	struct parser ps = { .file = file };
+	char line[LINE_BUF_SIZE];
+	FILE *f;
+	char *msg;
+	int ret = 0;
+
+	memset(file, 0, sizeof(*file));
+	file->path = path;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+
+	while (!ret && fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		msg = kernel_message(line);
+		if (msg)
+			ret = parse_kernel_message(&ps, msg);
+		else if (!file->device_count)
+			ret = parse_info_line(&ps, line);
+	}
+
+	if (!ret)
+		ret = flush_hex(&ps);
+	if (!ret)
+		ret = link_deps(file);
+
+	free(ps.hex);
+	fclose(f);
+
+	if (ret)
+		results_free(file);
+	return ret;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static int add_path(char ***paths, int *count, const char *path)
+{
+	char **tmp;
+
+	tmp = realloc(*paths, (*count + 1) * sizeof(*tmp));
+	if (!tmp)
+		return -1;
+	*paths = tmp;
+
+	tmp[*count] = strdup(path);
+	if (!tmp[*count])
+		return -1;
+	(*count)++;
+
+	return 0;
+}
+
+/**
+ * results_list - list result files
+ * @path: a result file, or a directory holding result_*.md files
+ * @paths: array of paths appended to, free with results_list_free()
+ * @count: number of entries in @paths
+ */
+int results_list(const char *path, char ***paths, int *count)
+{
+	char buf[LINE_BUF_SIZE];
+	struct dirent *ent;
+	int first = *count;
+	struct stat st;
+	int ret = 0;
+	DIR *dir;
+
+	if (stat(path, &st))
+		return -1;
+
+	if (!S_ISDIR(st.st_mode))
+		return add_path(paths, count, path);
+
+	dir = opendir(path);
+	if (!dir)
+		return -1;
+
+	while (!ret && (ent = readdir(dir))) {
+		size_t len = strlen(ent->d_name);
+
+		if (!starts_with(ent->d_name, "result_") || len < 3 ||
+		    strcmp(ent->d_name + len - 3, ".md"))
+			continue;
+		snprintf(buf, sizeof(buf), "%s/%s", path, ent->d_name);
+		ret = add_path(paths, count, buf);
+	}
+
+	closedir(dir);
+	qsort(*paths + first, *count - first, sizeof(**paths), compare_paths);
+	return ret;
+}
+
+void results_list_free(char **paths, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		free(paths[i]);
+	free(paths);
+}
+
+int results_for_each(char * const *paths, int count,
+		     int (*fn)(const struct result_file *file, void *priv),
+		     void *priv)
+{
+	struct result_file file;
+	int ret = 0;
+	int i;
+
+	for (i = 0; !ret && i < count; i++) {
+		if (results_parse(paths[i], &file)) {
+			fprintf(stderr, "%s: can't parse\n", paths[i]);
+			return -1;
+		}
+		ret = fn(&file, priv);
+		results_free(&file);
+	}
+
+	return ret;
+}
@@ -0,0 +1,49 @@
+#ifndef RESULTS_PARSER_H
+#define RESULTS_PARSER_H
+
+#include <stddef.h>
+
+/*
+ * A result file (misc/dump_intel_ipu_data/results/result_*.md) is parsed
+ * into key/value fields: machine wide ones (dmi.product_name, kernel...)
+ * and one set per sensor or PMIC (hid, ssdb.link_used, cldb.*, dsm.gpio,
+ * dep...). A key may appear more than once (dep, dsm.i2c, dsm.gpio).
+ */
+struct result_kv {
+	char *key;
+	char *value;
+};
+
+struct result_fields {
+	struct result_kv *kv;
+	int count;
+	int size;
+};
+
+struct result_file {
+	const char *path;
+	struct result_fields info;
+	struct result_fields *devices;
+	int device_count;
+};
+
+int results_parse(const char *path, struct result_file *file);
+void results_free(struct result_file *file);
+
+int result_add(struct result_fields *fields, const char *key,
+	       const char *value);
+const char *result_get(const struct result_fields *fields, const char *key);
+void result_fields_free(struct result_fields *fields);
+
+int results_list(const char *path, char ***paths, int *count);
+void results_list_free(char **paths, int count);
+
+/*
+ * Parse the files one at a time and pass each one to @fn, so that only a
+ * single machine is held in memory. Stops at the first non-zero return.
+ */
+int results_for_each(char * const *paths, int count,
+		     int (*fn)(const struct result_file *file, void *priv),
+		     void *priv);
+
+#endif /* RESULTS_PARSER_H */
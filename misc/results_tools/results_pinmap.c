@@ -0,0 +1,338 @@
+/**
+ * This tool prints the GPIO and I2C pin map of every sensor and PMIC in
+ * the dump_intel_ipu_data results: the discrete PMIC GPIO _DSM and the I2C
+ * device _DSM values decoded with ipu_dsm.h, each one matched to the
+ * GpioIo or I2cSerialBus resource of _CRS that it describes.
+ *
+ * A _DSM value whose pin, address or bus isn't the one of the resource at the
+ * same index in _CRS, or whose type isn't known, is marked so that new
+ * machines stand out.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ipu_dsm.h"
+#include "results_parser.h"
+
+#define DEFAULT_RESULTS_DIR	"../dump_intel_ipu_data/results"
+
+struct pinmap_stats {
+	int devices;
+	int gpio;
+	int i2c;
+	int unknown;
+	int mismatch;
+};
+
+static int csv;
+
+static const char *field(const struct result_fields *dev, const char *key)
+{
+	const char *value = result_get(dev, key);
+
+	return value ? value : "-";
+}
+
+static int hex_nibble(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c = tolower(c);
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+/* crs.raw is stored as a string of hex digits */
+static int parse_crs(const struct result_fields *dev, struct ipu_crs *crs)
+{
+	const char *hex = result_get(dev, "crs.raw");
+	uint8_t *buf;
+	size_t len, i;
+	int hi, lo, ret;
+
+	if (!hex)
+		return -1;
+
+	len = strlen(hex) / 2;
+	buf = malloc(len + 1);
+	if (!buf)
+		return -1;
+	for (i = 0; i < len; i++) {
+		hi = hex_nibble(hex[2 * i]);
+		lo = hex_nibble(hex[2 * i + 1]);
+		if (hi < 0 || lo < 0) {
+			free(buf);
+			return -1;
+		}
+		buf[i] = hi << 4 | lo;
+	}
+
+	ret = ipu_crs_parse(buf, len, crs);
+	free(buf);
+	return ret;
+}
+
+/* The sensors that depend on @pmic, separated by spaces */
+static void users_of(const struct result_file *file,
+		     const struct result_fields *pmic, char *out, size_t size)
+{
+	const char *path = result_get(pmic, "acpi_path");
+	const struct result_fields *dev;
+	size_t len = 0;
+	int i, j;
+
+	out[0] = '\0';
+	if (!path)
+		return;
+
+	for (i = 0; i < file->device_count; i++) {
+		dev = &file->devices[i];
+		for (j = 0; j < dev->count; j++) {
+			if (strcmp(dev->kv[j].key, "dep") ||
+			    strcmp(dev->kv[j].value, path))
+				continue;
+			len += snprintf(out + len, len < size ? size - len : 0,
+					"%s%s", len ? " " : "",
+					field(dev, "acpi_path"));
+			break;
+		}
+	}
+}
+
+static void print_header(const struct result_file *file,
+			 const struct result_fields *dev)
+{
+	char users[256];
+
+	users_of(file, dev, users, sizeof(users));
+	printf("  %s %s %s", field(dev, "type"), field(dev, "hid"),
+	       field(dev, "acpi_path"));
+	if (users[0])
+		printf(" (for %s)", users);
+	printf("\n");
+}
+
+/*
+ * Describe the problem with the @index-th _DSM value that maps to
+ * resource @crs_index, NULL if there is none.
+ */
+static const char *check(int index, int crs_index, const char *name,
+			 int crs_ok, struct pinmap_stats *stats)
+{
+	if (crs_ok && crs_index < 0) {
+		stats->mismatch++;
+		return "not in _CRS";
+	}
+	if (crs_ok && crs_index != index) {
+		stats->mismatch++;
+		return "_CRS index differs";
+	}
+	if (!name) {
+		stats->unknown++;
+		return "unknown type";
+	}
+	return NULL;
+}
+
+/* The I2C _DSM bus N is the \_SB.PCI0.I2CN resource source of _CRS */
+static int bus_matches(const char *source, unsigned int bus)
+{
+	char suffix[16];
+	size_t len, n;
+
+	n = snprintf(suffix, sizeof(suffix), "I2C%u", bus);
+	len = strlen(source);
+	return len >= n && !strcmp(source + len - n, suffix);
+}
+
+static void print_gpio(const struct result_file *file,
+		       const struct result_fields *dev,
+		       const struct ipu_crs *crs, int crs_ok,
+		       struct pinmap_stats *stats)
+{
+	const struct ipu_crs_res *res;
+	const char *name, *problem;
+	int index = 0, crs_index, i;
+	uint32_t val;
+
+	for (i = 0; i < dev->count; i++) {
+		if (strcmp(dev->kv[i].key, "dsm.gpio"))
+			continue;
+
+		val = strtoul(dev->kv[i].value, NULL, 16);
+		name = ipu_dsm_code_name(ipu_dsm_gpio_types,
+					 IPU_DSM_GPIO_TYPE(val));
+		crs_index = crs_ok ? ipu_dsm_gpio_crs_index(crs, index, val) :
+				     -1;
+		res = crs_index >= 0 ? &crs->gpio[crs_index] : NULL;
+		problem = check(index, crs_index, name, crs_ok, stats);
+		stats->gpio++;
+
+		if (csv) {
+			printf("%s,%s,%s,gpio,%d,0x%08x,%d,%s,0x%02x,%s,%s,%s\n",
+			       file->path, field(dev, "hid"),
+			       field(dev, "acpi_path"), index, val, crs_index,
+			       res ? res->source : "",
+			       IPU_DSM_GPIO_PIN(val), name ? name : "",
+			       IPU_DSM_GPIO_ACTIVE(val) ? "high" : "low",
+			       problem ? problem : "");
+		} else {
+			printf("    gpio %d: 0x%08x  GpioIo %-2d %-16s pin 0x%02x  %-12s active %-4s%s%s\n",
+			       index, val, crs_index,
+			       res ? res->source : "-", IPU_DSM_GPIO_PIN(val),
+			       name ? name : "-",
+			       IPU_DSM_GPIO_ACTIVE(val) ? "high" : "low",
+			       problem ? "  !! " : "",
+			       problem ? problem : "");
+		}
+		index++;
+	}
+}
+
+static void print_i2c(const struct result_file *file,
+		      const struct result_fields *dev,
+		      const struct ipu_crs *crs, int crs_ok,
+		      struct pinmap_stats *stats)
+{
+	const struct ipu_crs_res *res;
+	const char *name, *problem;
+	int index = 0, crs_index, i;
+	char speed[16] = "";
+	uint32_t val;
+
+	for (i = 0; i < dev->count; i++) {
+		if (strcmp(dev->kv[i].key, "dsm.i2c"))
+			continue;
+
+		val = strtoul(dev->kv[i].value, NULL, 16);
+		name = ipu_dsm_code_name(ipu_dsm_i2c_types,
+					 IPU_DSM_I2C_TYPE(val));
+		crs_index = crs_ok ? ipu_dsm_i2c_crs_index(crs, index, val) :
+				     -1;
+		res = crs_index >= 0 ? &crs->i2c[crs_index] : NULL;
+		if (res)
+			snprintf(speed, sizeof(speed), "%u", res->speed);
+		problem = check(index, crs_index, name, crs_ok, stats);
+		if (!problem && res &&
+		    !bus_matches(res->source, IPU_DSM_I2C_BUS(val))) {
+			stats->mismatch++;
+			problem = "bus differs from _CRS";
+		}
+		stats->i2c++;
+
+		if (csv) {
+			printf("%s,%s,%s,i2c,%d,0x%08x,%d,%s,0x%02x,%s,I2C%u %s,%s\n",
+			       file->path, field(dev, "hid"),
+			       field(dev, "acpi_path"), index, val, crs_index,
+			       res ? res->source : "",
+			       IPU_DSM_I2C_ADDR(val), name ? name : "",
+			       IPU_DSM_I2C_BUS(val), res ? speed : "",
+			       problem ? problem : "");
+		} else {
+			printf("    i2c  %d: 0x%08x  I2cSerialBus %-2d %-16s addr 0x%02x  %-12s bus I2C%u %s Hz%s%s\n",
+			       index, val, crs_index,
+			       res ? res->source : "-", IPU_DSM_I2C_ADDR(val),
+			       name ? name : "-", IPU_DSM_I2C_BUS(val),
+			       res ? speed : "-", problem ? "  !! " : "",
+			       problem ? problem : "");
+		}
+		index++;
+	}
+}
+
+static int print_pinmap(const struct result_file *file, void *priv)
+{
+	struct pinmap_stats *stats = priv;
+	const struct result_fields *dev;
+	struct ipu_crs crs;
+	int header = 0;
+	int crs_ok;
+	int i;
+
+	for (i = 0; i < file->device_count; i++) {
+		dev = &file->devices[i];
+		if (!result_get(dev, "dsm.gpio") && !result_get(dev, "dsm.i2c"))
+			continue;
+
+		if (!csv && !header++)
+			printf("%s (%s)\n", field(&file->info, "machine"),
+			       file->path);
+		if (!csv)
+			print_header(file, dev);
+
+		crs_ok = !parse_crs(dev, &crs);
+		if (!crs_ok && !csv)
+			printf("    no usable _CRS, resources not matched\n");
+
+		stats->devices++;
+		print_gpio(file, dev, &crs, crs_ok, stats);
+		print_i2c(file, dev, &crs, crs_ok, stats);
+	}
+
+	if (header)
+		printf("\n");
+
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-c] [results dir or file]...\n"
+		"  -c  print CSV, one line per _DSM value\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	char *default_args[] = { DEFAULT_RESULTS_DIR };
+	struct pinmap_stats stats = { 0 };
+	char **paths = NULL, **args;
+	int count = 0, nargs;
+	int ret = 1;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "c")) != -1) {
+		switch (opt) {
+		case 'c':
+			csv = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	args = optind < argc ? argv + optind : default_args;
+	nargs = optind < argc ? argc - optind : 1;
+	for (i = 0; i < nargs; i++) {
+		if (results_list(args[i], &paths, &count)) {
+			fprintf(stderr, "%s: can't list result files\n",
+				args[i]);
+			goto out;
+		}
+	}
+
+	if (csv)
+		printf("file,hid,acpi_path,dsm,index,value,crs_index,source,pin_or_addr,type,polarity_or_bus,problem\n");
+
+	if (results_for_each(paths, count, print_pinmap, &stats)) {
+		fprintf(stderr, "can't read result files\n");
+		goto out;
+	}
+
+	fprintf(stderr,
+		"%d devices: %d GPIO and %d I2C _DSM values, %d unknown types, %d not matching _CRS\n",
+		stats.devices, stats.gpio, stats.i2c, stats.unknown,
+		stats.mismatch);
+	ret = 0;
+out:
+	results_list_free(paths, count);
+	return ret;
+}
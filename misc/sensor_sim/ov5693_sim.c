@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The ov5693 driver behind sensor_sim, probed as ov5693_test.c of
+ * ../driver_test probes it: 2 lanes and the clock the driver wants.
+ */
+
+#include "kshim.h"
+#include "sensor_sim_driver.h"
+#include "../../drivers/media/i2c/ov5693.c"
+
+static int ov5693_sim_probe(struct i2c_client *client, unsigned int lanes)
+{
+	/* the driver runs 2 lanes whatever the board has */
+	(void)lanes;
+
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = 2;
+	kshim_fw.clk_rate = OV5693_XVCLK_FREQ;
+
+	kshim_bus.regs[OV5693_REG_CHIP_ID_H] = OV5693_CHIP_ID >> 8;
+	kshim_bus.regs[OV5693_REG_CHIP_ID_L] = OV5693_CHIP_ID & 0xff;
+
+	return ov5693_probe(client);
+}
+
+const struct sensor_sim_driver ov5693_sim_driver = {
+	.name = "ov5693",
+	.probe = ov5693_sim_probe,
+	.remove = ov5693_remove,
+	.menu = ov5693_test_pattern_menu,
+	.menu_size = ARRAY_SIZE(ov5693_test_pattern_menu),
+};
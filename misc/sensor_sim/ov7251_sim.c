@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The ov7251 driver behind sensor_sim, probed as ov7251_test.c of
+ * ../driver_test probes it: 1 lane and a 24 MHz clock.
+ */
+
+#include "kshim.h"
+#include "sensor_sim_driver.h"
+#include "../../drivers/media/i2c/ov7251.c"
+
+static int ov7251_sim_probe(struct i2c_client *client, unsigned int lanes)
+{
+	/* the driver runs 1 lane whatever the board has */
+	(void)lanes;
+
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = 1;
+	kshim_fw.clock_frequency = 24000000;
+	kshim_fw.clk_rate = 24000000;
+
+	kshim_bus.regs[OV7251_CHIP_ID_HIGH] = OV7251_CHIP_ID_HIGH_BYTE;
+	kshim_bus.regs[OV7251_CHIP_ID_LOW] = OV7251_CHIP_ID_LOW_BYTE;
+	kshim_bus.regs[OV7251_SC_GP_IO_IN1] = 0x60;
+
+	return ov7251_probe(client);
+}
+
+const struct sensor_sim_driver ov7251_sim_driver = {
+	.name = "ov7251",
+	.probe = ov7251_sim_probe,
+	.remove = ov7251_remove,
+	.menu = ov7251_test_pattern_menu,
+	.menu_size = ARRAY_SIZE(ov7251_test_pattern_menu),
+};
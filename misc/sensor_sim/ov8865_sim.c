@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The ov8865 driver behind sensor_sim, probed as ov8865_test.c of
+ * ../driver_test probes it: 4 lanes by default at its first link
+ * frequency, with a 19.2 MHz clock.
+ */
+
+#include "kshim.h"
+#include "sensor_sim_driver.h"
+#include "../../drivers/media/i2c/ov8865.c"
+
+static int ov8865_sim_probe(struct i2c_client *client, unsigned int lanes)
+{
+	kshim_bus_reset();
+	memset(&kshim_fw, 0, sizeof(kshim_fw));
+	kshim_fw.bus_type = V4L2_MBUS_CSI2_DPHY;
+	kshim_fw.num_data_lanes = lanes ? lanes : 4;
+	kshim_fw.link_frequencies[0] = ov8865_link_freq_menu[0];
+	kshim_fw.nr_of_link_frequencies = 1;
+	kshim_fw.clk_rate = 19200000;
+
+	kshim_bus.regs[OV8865_CHIP_ID_HH_REG] = OV8865_CHIP_ID_HH_VALUE;
+	kshim_bus.regs[OV8865_CHIP_ID_H_REG] = OV8865_CHIP_ID_H_VALUE;
+	kshim_bus.regs[OV8865_CHIP_ID_L_REG] = OV8865_CHIP_ID_L_VALUE;
+
+	return ov8865_probe(client);
+}
+
+const struct sensor_sim_driver ov8865_sim_driver = {
+	.name = "ov8865",
+	.probe = ov8865_sim_probe,
+	.remove = ov8865_remove,
+	.menu = ov8865_test_pattern_menu,
+	.menu_size = ARRAY_SIZE(ov8865_test_pattern_menu),
+};
@@ -0,0 +1,601 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Simulated sensors, see sensor_sim.h. What the driver gives for a
+ * configuration is taken from it once at creation (sensor_sim_driver.c),
+ * the frames only need the numbers. The test patterns are drawn a line
+ * at a time and packed with ipu3_pack_line16(). Most lines of the bars
+ * and squares are the same as one drawn a little above with the same
+ * Bayer phase, and are copied from it instead, and the scene is drawn once
+ * and copied to all the frames. The random data is random
+ * bits in the packed line, which are as good 10-bit values as any.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/videodev2.h>
+#include "ipu3_unpack.h"
+#include "sensor_sim.h"
+#include "sensor_sim_driver.h"
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+#define PACKED_BLOCK_PIXELS	25
+#define PACKED_BLOCK_BYTES	32
+
+/* the writes of each control kept, for delays up to that */
+#define SIM_WRITES		8
+#define SIM_MAX_MODES		16
+
+struct sensor_desc {
+	const struct sensor_sim_driver *driver;
+	/* what each entry of the menu of the driver draws */
+	const enum sensor_sim_pattern *patterns;
+	unsigned int num_patterns;
+	int mono;
+};
+
+struct sim_write {
+	uint32_t sequence;
+	int32_t value;
+};
+
+struct sim_ctrl {
+	struct sensor_sim_ctrl range;
+	unsigned int delay;
+	/* the last SIM_WRITES writes, the last one at @count - 1 */
+	struct sim_write writes[SIM_WRITES];
+	unsigned int count;
+};
+
+struct sensor_sim {
+	const struct sensor_desc *desc;
+	struct sensor_sim_mode mode;
+	int vblank;
+	unsigned int driver_num;
+	unsigned int driver_den;
+	struct sim_ctrl ctrls[SENSOR_SIM_CTRLS];
+	uint32_t noise;
+	enum sensor_sim_pattern pattern;
+	size_t bpl;
+	uint16_t *line;
+	/* the scene, packed once, it doesn't move */
+	uint8_t *scene;
+};
+
+static const enum sensor_sim_pattern ov8865_patterns[] = {
+	SENSOR_SIM_SCENE,
+	SENSOR_SIM_RANDOM,
+	SENSOR_SIM_BARS,
+	SENSOR_SIM_BARS_ROLLING,
+	SENSOR_SIM_SQUARES,
+	SENSOR_SIM_SQUARES_ROLLING,
+};
+
+static const enum sensor_sim_pattern ov5693_patterns[] = {
+	SENSOR_SIM_SCENE,
+	SENSOR_SIM_RANDOM,
+	SENSOR_SIM_BARS,
+	SENSOR_SIM_BARS_ROLLING,
+};
+
+static const enum sensor_sim_pattern ov7251_patterns[] = {
+	SENSOR_SIM_SCENE,
+	SENSOR_SIM_GREY_BARS,
+};
+
+static const struct sensor_desc sensors[] = {
+	{
+		.driver = &ov8865_sim_driver,
+		.patterns = ov8865_patterns,
+		.num_patterns = ARRAY_SIZE(ov8865_patterns),
+	}, {
+		.driver = &ov5693_sim_driver,
+		.patterns = ov5693_patterns,
+		.num_patterns = ARRAY_SIZE(ov5693_patterns),
+	}, {
+		/* the driver says SBGGR10, but there is no colour filter */
+		.driver = &ov7251_sim_driver,
+		.patterns = ov7251_patterns,
+		.num_patterns = ARRAY_SIZE(ov7251_patterns),
+		.mono = 1,
+	},
+};
+
+/* White, yellow, cyan, green, magenta, red, blue and black, as RGB bits */
+static const uint8_t bar_colours[8] = { 7, 6, 3, 2, 5, 4, 1, 0 };
+
+static const struct sensor_desc *find_sensor(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; name && i < ARRAY_SIZE(sensors); i++)
+		if (!strcmp(sensors[i].driver->name, name))
+			return &sensors[i];
+
+	return NULL;
+}
+
+const char *sensor_sim_sensor_name(unsigned int i)
+{
+	return i < ARRAY_SIZE(sensors) ? sensors[i].driver->name : NULL;
+}
+
+/* The modes of the last sensor asked for, the driver is slow to list */
+static struct {
+	const struct sensor_desc *desc;
+	unsigned int lanes;
+	int count;
+	struct sensor_sim_mode modes[SIM_MAX_MODES];
+} mode_list;
+
+const struct sensor_sim_mode *sensor_sim_enum_mode(const char *sensor,
+						   unsigned int lanes,
+						   unsigned int i)
+{
+	const struct sensor_desc *desc = find_sensor(sensor);
+
+	if (!desc)
+		return NULL;
+
+	if (mode_list.desc != desc || mode_list.lanes != lanes) {
+		mode_list.desc = desc;
+		mode_list.lanes = lanes;
+		mode_list.count = sensor_sim_driver_modes(desc->driver, lanes,
+							  mode_list.modes,
+							  SIM_MAX_MODES);
+	}
+
+	return (int)i < mode_list.count && i < SIM_MAX_MODES ?
+	       &mode_list.modes[i] : NULL;
+}
+
+/* The entries the driver has and that are drawn */
+static unsigned int num_patterns(const struct sensor_desc *desc)
+{
+	return desc->driver->menu_size < desc->num_patterns ?
+	       desc->driver->menu_size : desc->num_patterns;
+}
+
+const char *sensor_sim_pattern_name(const char *sensor, unsigned int i)
+{
+	const struct sensor_desc *desc = find_sensor(sensor);
+
+	return desc && i < num_patterns(desc) ? desc->driver->menu[i] : NULL;
+}
+
+static void draw_frame(struct sensor_sim *sim, uint32_t sequence,
+		       uint8_t *dst, size_t stride);
+
+struct sensor_sim *sensor_sim_create(const struct sensor_sim_config *cfg)
+{
+	const struct sensor_desc *desc = find_sensor(cfg->sensor);
+	struct sensor_sim_setup setup;
+	struct sensor_sim *sim;
+	unsigned int i;
+	int ret;
+
+	if (!desc || cfg->pattern >= num_patterns(desc)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ret = sensor_sim_driver_setup(desc->driver, cfg, &setup);
+	if (ret) {
+		errno = -ret;
+		return NULL;
+	}
+
+	sim = calloc(1, sizeof(*sim));
+	if (!sim)
+		return NULL;
+	sim->desc = desc;
+	sim->mode = setup.mode;
+	sim->vblank = setup.vblank;
+	sim->driver_num = setup.num;
+	sim->driver_den = setup.den;
+	for (i = 0; i < SENSOR_SIM_CTRLS; i++) {
+		sim->ctrls[i].range = setup.ctrls[i];
+		sim->ctrls[i].delay = i == SENSOR_SIM_EXPOSURE ? 2 : 1;
+	}
+	sim->noise = 1;
+	sim->pattern = desc->patterns[cfg->pattern];
+	sim->bpl = ipu3_packed_bpl(sim->mode.width);
+	sim->line = malloc(sim->mode.width * sizeof(*sim->line));
+	if (sim->line && sim->pattern == SENSOR_SIM_SCENE) {
+		sim->scene = malloc(sim->bpl * sim->mode.height);
+		if (sim->scene)
+			draw_frame(sim, 0, sim->scene, sim->bpl);
+	}
+	if (!sim->line || (sim->pattern == SENSOR_SIM_SCENE && !sim->scene)) {
+		sensor_sim_destroy(sim);
+		return NULL;
+	}
+
+	return sim;
+}
+
+void sensor_sim_destroy(struct sensor_sim *sim)
+{
+	if (!sim)
+		return;
+	free(sim->line);
+	free(sim->scene);
+	free(sim);
+}
+
+const struct sensor_sim_mode *sensor_sim_mode(const struct sensor_sim *sim)
+{
+	return &sim->mode;
+}
+
+uint32_t sensor_sim_fourcc(const struct sensor_sim *sim)
+{
+	(void)sim;
+	/* MEDIA_BUS_FMT_SBGGR10_1X10 on the CIO2, for all three */
+	return V4L2_PIX_FMT_IPU3_SBGGR10;
+}
+
+int sensor_sim_mono(const struct sensor_sim *sim)
+{
+	return sim->desc->mono;
+}
+
+size_t sensor_sim_bytesperline(const struct sensor_sim *sim)
+{
+	return sim->bpl;
+}
+
+int sensor_sim_vblank(const struct sensor_sim *sim)
+{
+	return sim->vblank;
+}
+
+enum sensor_sim_pattern sensor_sim_pattern(const struct sensor_sim *sim)
+{
+	return sim->pattern;
+}
+
+uint64_t sensor_sim_interval_ns(const struct sensor_sim *sim)
+{
+	uint64_t clocks = (uint64_t)sim->mode.hts *
+			  (sim->mode.height + sim->vblank);
+
+	return (clocks * 1000000000ULL + sim->mode.pixel_rate / 2) /
+	       sim->mode.pixel_rate;
+}
+
+void sensor_sim_driver_interval(const struct sensor_sim *sim,
+				unsigned int *num, unsigned int *den)
+{
+	*num = sim->driver_num;
+	*den = sim->driver_den;
+}
+
+/*
+ * Drawing
+ */
+
+/* BGGR: blue on even lines and columns, red on odd ones */
+static unsigned int bayer_channel(unsigned int x, unsigned int y)
+{
+	if ((x ^ y) & 1)
+		return 1;
+	return y & 1 ? 0 : 2;
+}
+
+static uint16_t bar_value(const struct sensor_sim *sim, unsigned int colour,
+			  unsigned int x, unsigned int y)
+{
+	if (sim->desc->mono)
+		return 1023 - colour * 1023 / 7;
+	/* RGB bits, red first */
+	return bar_colours[colour] & (4 >> bayer_channel(x, y)) ? 1023 : 0;
+}
+
+/* The bar rolls down 8 lines a frame, with the Bayer phase kept */
+static int in_rolling_bar(const struct sensor_sim *sim, uint32_t sequence,
+			  unsigned int y)
+{
+	unsigned int height = sim->mode.height;
+	unsigned int bar = (height / 16) & ~1U;
+	unsigned int top = (uint64_t)sequence * 8 % (height & ~1U);
+
+	if (sim->pattern != SENSOR_SIM_BARS_ROLLING &&
+	    sim->pattern != SENSOR_SIM_SQUARES_ROLLING)
+		return 0;
+
+	return (y + height - top) % height < (bar ? bar : 2);
+}
+
+static unsigned int square_size(const struct sensor_sim *sim)
+{
+	unsigned int size = (sim->mode.height / 8) & ~1U;
+
+	return size ? size : 2;
+}
+
+/*
+ * Lines with the same key are the same. -1 for one that has to be drawn:
+ * the random data and the scene, which change along the frame.
+ */
+static long line_key(const struct sensor_sim *sim, uint32_t sequence,
+		     unsigned int y)
+{
+	long key = (y & 1) | in_rolling_bar(sim, sequence, y) << 1;
+
+	switch (sim->pattern) {
+	case SENSOR_SIM_BARS:
+	case SENSOR_SIM_BARS_ROLLING:
+	case SENSOR_SIM_GREY_BARS:
+		return key;
+	case SENSOR_SIM_SQUARES:
+	case SENSOR_SIM_SQUARES_ROLLING:
+		return key | (long)(y / square_size(sim)) << 2;
+	default:
+		return -1;
+	}
+}
+
+static void draw_line(const struct sensor_sim *sim, uint32_t sequence,
+		      unsigned int y, uint16_t *line)
+{
+	unsigned int width = sim->mode.width, height = sim->mode.height;
+	unsigned int bar = (width / 8) & ~1U, size = square_size(sim), x;
+	/* a grey card under daylight: red, green and blue */
+	static const float scene_gain[3] = { 0.5, 1, 0.6 };
+	int rolling = in_rolling_bar(sim, sequence, y);
+	float bright = (0.25f + 0.75f * y / height) * (1023 - 64) / width;
+	float scale[2] = { bright, bright };
+
+	if (!bar)
+		bar = 2;
+	/* brighter to the right and to the bottom */
+	if (!sim->desc->mono) {
+		scale[0] *= scene_gain[bayer_channel(0, y)];
+		scale[1] *= scene_gain[bayer_channel(1, y)];
+	}
+
+	for (x = 0; x < width; x++) {
+		switch (sim->pattern) {
+		case SENSOR_SIM_BARS:
+		case SENSOR_SIM_BARS_ROLLING:
+		case SENSOR_SIM_GREY_BARS:
+			line[x] = bar_value(sim, x / bar < 8 ? x / bar : 7,
+					    x, y);
+			break;
+		case SENSOR_SIM_SQUARES:
+		case SENSOR_SIM_SQUARES_ROLLING:
+			line[x] = bar_value(sim, (x / size + y / size) % 8,
+					    x, y);
+			break;
+		default:
+			line[x] = 64 + x * scale[x & 1];
+			break;
+		}
+		if (rolling)
+			line[x] = 1023 - line[x];
+	}
+}
+
+static uint64_t xorshift64(uint64_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 7;
+	*s ^= *s << 17;
+	return *s;
+}
+
+/*
+ * Random bits, with the unused ones of each block and past @width clear.
+ * Each line has its own seed, so that sensor_sim_line() finds it again.
+ */
+static void random_line(uint8_t *dst, unsigned int width, uint32_t sequence,
+			unsigned int y)
+{
+	unsigned int blocks = (width + PACKED_BLOCK_PIXELS - 1) /
+			      PACKED_BLOCK_PIXELS;
+	unsigned int i, bit, last = width % PACKED_BLOCK_PIXELS;
+	uint64_t seed = ((uint64_t)sequence << 32 | y) * 0x9e3779b97f4a7c15ULL +
+			1;
+	uint64_t v;
+	uint8_t *block;
+
+	for (i = 0; i < blocks * PACKED_BLOCK_BYTES; i += sizeof(v)) {
+		v = xorshift64(&seed);
+		memcpy(dst + i, &v, sizeof(v));
+	}
+	for (i = 0; i < blocks; i++)
+		dst[i * PACKED_BLOCK_BYTES + PACKED_BLOCK_BYTES - 1] &= 0x03;
+
+	if (!last)
+		return;
+	block = dst + (blocks - 1) * PACKED_BLOCK_BYTES;
+	bit = last * 10;
+	block[bit / 8] &= (1U << bit % 8) - 1;
+	memset(block + bit / 8 + 1, 0, PACKED_BLOCK_BYTES - bit / 8 - 1);
+}
+
+static void draw_frame(struct sensor_sim *sim, uint32_t sequence,
+		       uint8_t *dst, size_t stride)
+{
+	unsigned int width = sim->mode.width, y;
+	size_t packed = (width + PACKED_BLOCK_PIXELS - 1) /
+			PACKED_BLOCK_PIXELS * PACKED_BLOCK_BYTES;
+	/* the last line drawn with each Bayer phase */
+	const uint8_t *last[2] = { NULL, NULL };
+	long last_key[2] = { -1, -1 }, key;
+	uint8_t *row;
+
+	for (y = 0; y < sim->mode.height; y++) {
+		row = dst + y * stride;
+
+		if (sim->pattern == SENSOR_SIM_RANDOM) {
+			random_line(row, width, sequence, y);
+		} else {
+			key = line_key(sim, sequence, y);
+			if (key >= 0 && key == last_key[y & 1]) {
+				memcpy(row, last[y & 1], packed);
+			} else {
+				draw_line(sim, sequence, y, sim->line);
+				ipu3_pack_line16(sim->line, row, width);
+				last[y & 1] = row;
+				last_key[y & 1] = key;
+			}
+		}
+		memset(row + packed, 0, sim->bpl - packed);
+	}
+}
+
+void sensor_sim_frame(struct sensor_sim *sim, uint32_t sequence,
+		      uint8_t *dst, size_t stride)
+{
+	size_t size = sim->bpl * sim->mode.height;
+	unsigned int y;
+
+	if (sim->pattern != SENSOR_SIM_SCENE) {
+		draw_frame(sim, sequence, dst, stride);
+		return;
+	}
+
+	if (stride == sim->bpl) {
+		memcpy(dst, sim->scene, size);
+		return;
+	}
+	for (y = 0; y < sim->mode.height; y++)
+		memcpy(dst + y * stride, sim->scene + y * sim->bpl, sim->bpl);
+}
+
+void sensor_sim_line(struct sensor_sim *sim, uint32_t sequence,
+		     unsigned int y, uint16_t *line)
+{
+	uint8_t *packed;
+
+	if (sim->pattern != SENSOR_SIM_RANDOM) {
+		draw_line(sim, sequence, y, line);
+		return;
+	}
+
+	packed = malloc(sim->bpl);
+	if (!packed)
+		abort();
+	random_line(packed, sim->mode.width, sequence, y);
+	ipu3_unpack_line16(packed, line, sim->mode.width);
+	free(packed);
+}
+
+/*
+ * Controls and exposure
+ */
+const struct sensor_sim_ctrl *sensor_sim_ctrl(const struct sensor_sim *sim,
+					      enum sensor_sim_ctrl_id id)
+{
+	return &sim->ctrls[id].range;
+}
+
+void sensor_sim_s_ctrl(struct sensor_sim *sim, uint32_t sequence,
+		       enum sensor_sim_ctrl_id id, int32_t value)
+{
+	struct sim_ctrl *c = &sim->ctrls[id];
+	const struct sensor_sim_ctrl *r = &c->range;
+	struct sim_write *w;
+
+	if (!r->step)
+		return;
+
+	value = value < r->min ? r->min : value > r->max ? r->max : value;
+	value = r->min + (value - r->min + r->step / 2) / r->step * r->step;
+
+	/* a second write after the same frame replaces the first */
+	w = &c->writes[(c->count - 1) % SIM_WRITES];
+	if (!c->count || w->sequence != sequence)
+		w = &c->writes[c->count++ % SIM_WRITES];
+	w->sequence = sequence;
+	w->value = value;
+}
+
+void sensor_sim_set_delay(struct sensor_sim *sim, enum sensor_sim_ctrl_id id,
+			  unsigned int delay)
+{
+	sim->ctrls[id].delay = delay;
+}
+
+int32_t sensor_sim_g_ctrl(const struct sensor_sim *sim, uint32_t sequence,
+			  enum sensor_sim_ctrl_id id)
+{
+	const struct sim_ctrl *c = &sim->ctrls[id];
+	const struct sim_write *w;
+	unsigned int i;
+
+	for (i = 0; i < c->count && i < SIM_WRITES; i++) {
+		w = &c->writes[(c->count - 1 - i) % SIM_WRITES];
+		if ((uint64_t)w->sequence + c->delay <= sequence)
+			return w->value;
+	}
+
+	return c->range.def;
+}
+
+/* Roughly normal */
+static double noise(struct sensor_sim *sim)
+{
+	double sum = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		sim->noise = sim->noise * 1664525 + 1013904223;
+		sum += (sim->noise >> 8) / 16777216.0;
+	}
+
+	return (sum - 2) * 1.7320508;
+}
+
+/* @value over 1x, 1 for a control the driver hasn't got */
+static double ctrl_scale(const struct sensor_sim *sim, uint32_t sequence,
+			 enum sensor_sim_ctrl_id id, int32_t unity)
+{
+	if (!sim->ctrls[id].range.step || unity <= 0)
+		return 1;
+
+	return (double)sensor_sim_g_ctrl(sim, sequence, id) / unity;
+}
+
+int sensor_sim_expose(struct sensor_sim *sim, uint32_t sequence,
+		      const float *light, unsigned int width,
+		      unsigned int height, unsigned int black, uint8_t *dst,
+		      size_t stride)
+{
+	const struct sim_ctrl *c = sim->ctrls;
+	double scale, channel[3], v, white = 1023.0 - black;
+	unsigned int x, y;
+
+	if (width > sim->mode.width || height > sim->mode.height) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* the exposure in lines times the gain over its minimum */
+	scale = sensor_sim_g_ctrl(sim, sequence, SENSOR_SIM_EXPOSURE) *
+		ctrl_scale(sim, sequence, SENSOR_SIM_GAIN,
+			   c[SENSOR_SIM_GAIN].range.min);
+	channel[0] = scale * ctrl_scale(sim, sequence, SENSOR_SIM_RED,
+					c[SENSOR_SIM_RED].range.def);
+	channel[1] = scale;
+	channel[2] = scale * ctrl_scale(sim, sequence, SENSOR_SIM_BLUE,
+					c[SENSOR_SIM_BLUE].range.def);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			v = light[y * width + x] *
+			    channel[sim->desc->mono ? 1 : bayer_channel(x, y)];
+			/* shot noise of 4 electrons a code, and read noise */
+			v += noise(sim) * sqrt((v > 0 ? v : 0) / 4 + 2);
+			v = (v > white ? white : v) + black;
+			sim->line[x] = v < 0 ? 0 : v > 1023 ? 1023 : lround(v);
+		}
+		ipu3_pack_line16(sim->line, dst + y * stride, width);
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * A simulated ov8865, ov5693 or ov7251, for running the capture and
+ * processing tools without the hardware. Each sensor is its driver of
+ * drivers/media/i2c, built on the simulated bus of ../driver_test
+ * (sensor_sim_driver.h): the modes are those it lists and picks for a
+ * format and a frame interval, with its HBLANK, VBLANK and pixel rate, and
+ * the frame interval is the one it reports. A frame lasts HTS x (height +
+ * VBLANK) pixel clocks at that pixel rate, and holds the test pattern of
+ * the driver's menu index, or a scene exposed with the driver's controls,
+ * packed as the CIO2 packs it (../ipu3_unpack).
+ *
+ * The patterns are drawn the way OmniVision sensors draw them, but aren't
+ * bit exact copies of what the hardware outputs.
+ */
+#ifndef SENSOR_SIM_H
+#define SENSOR_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum sensor_sim_pattern {
+	/* a still scene: ramps in the colours of a grey card */
+	SENSOR_SIM_SCENE,
+	SENSOR_SIM_RANDOM,
+	SENSOR_SIM_BARS,
+	SENSOR_SIM_BARS_ROLLING,
+	SENSOR_SIM_SQUARES,
+	SENSOR_SIM_SQUARES_ROLLING,
+	/* grey bars, of the monochrome ov7251 */
+	SENSOR_SIM_GREY_BARS,
+};
+
+struct sensor_sim_config {
+	const char *sensor;		/* "ov8865", "ov5693" or "ov7251" */
+	/* the nearest mode the driver would pick, 0 for its default */
+	unsigned int width;
+	unsigned int height;
+	/* ov7251: the mode of the nearest frame rate, 0 for the default */
+	unsigned int fps;
+	/* ov8865: the data lanes, the pixel rate follows, 0 for 4 */
+	unsigned int lanes;
+	/* V4L2_CID_VBLANK, -1 for the default of the mode */
+	int vblank;
+	/* V4L2_CID_TEST_PATTERN, an index in the menu of the driver */
+	unsigned int pattern;
+};
+
+struct sensor_sim_mode {
+	unsigned int width;
+	unsigned int height;
+	unsigned int hts;
+	unsigned int vts;		/* the default, height + VBLANK */
+	uint64_t pixel_rate;
+	/* the ov7251: the frame interval of the mode, 0 for the others */
+	unsigned int interval_num;
+	unsigned int interval_den;
+};
+
+/* The controls the frames of sensor_sim_expose() are taken with */
+enum sensor_sim_ctrl_id {
+	SENSOR_SIM_EXPOSURE,		/* V4L2_CID_EXPOSURE, in lines */
+	SENSOR_SIM_GAIN,		/* V4L2_CID_ANALOGUE_GAIN, 1x at min */
+	SENSOR_SIM_RED,			/* V4L2_CID_RED_BALANCE, 1x at def */
+	SENSOR_SIM_BLUE,		/* V4L2_CID_BLUE_BALANCE, 1x at def */
+	SENSOR_SIM_CTRLS,
+};
+
+/* The range of a control in the mode, all 0 if the driver hasn't got it */
+struct sensor_sim_ctrl {
+	int32_t min;
+	int32_t max;
+	int32_t step;
+	int32_t def;
+};
+
+struct sensor_sim;
+
+/*
+ * The sensors, their modes and the menus of their test patterns. Return
+ * NULL past the end.
+ */
+const char *sensor_sim_sensor_name(unsigned int i);
+const struct sensor_sim_mode *sensor_sim_enum_mode(const char *sensor,
+						   unsigned int lanes,
+						   unsigned int i);
+const char *sensor_sim_pattern_name(const char *sensor, unsigned int i);
+
+/*
+ * Return NULL with errno set for an unknown sensor, a bad control or a
+ * driver that fails
+ */
+struct sensor_sim *sensor_sim_create(const struct sensor_sim_config *cfg);
+void sensor_sim_destroy(struct sensor_sim *sim);
+
+const struct sensor_sim_mode *sensor_sim_mode(const struct sensor_sim *sim);
+/* The V4L2 pixel format the CIO2 captures it in, and its line */
+uint32_t sensor_sim_fourcc(const struct sensor_sim *sim);
+/* The ov7251, which has no colour filter whatever its format says */
+int sensor_sim_mono(const struct sensor_sim *sim);
+size_t sensor_sim_bytesperline(const struct sensor_sim *sim);
+int sensor_sim_vblank(const struct sensor_sim *sim);
+enum sensor_sim_pattern sensor_sim_pattern(const struct sensor_sim *sim);
+
+/* A frame from start to start, exactly */
+uint64_t sensor_sim_interval_ns(const struct sensor_sim *sim);
+/* What VIDIOC_SUBDEV_G_FRAME_INTERVAL returns, rounded as the driver does */
+void sensor_sim_driver_interval(const struct sensor_sim *sim,
+				unsigned int *num, unsigned int *den);
+
+/*
+ * Draw frame @sequence: the rolling bars move and the random data changes
+ * from one frame to the next. @dst is bytesperline x height.
+ */
+void sensor_sim_frame(struct sensor_sim *sim, uint32_t sequence,
+		      uint8_t *dst, size_t stride);
+
+/* Line @y of frame @sequence unpacked, as a reference for the tests */
+void sensor_sim_line(struct sensor_sim *sim, uint32_t sequence,
+		     unsigned int y, uint16_t *line);
+
+/*
+ * Controls
+ */
+const struct sensor_sim_ctrl *sensor_sim_ctrl(const struct sensor_sim *sim,
+					      enum sensor_sim_ctrl_id id);
+
+/*
+ * Write control @id after frame @sequence, clamped and rounded to its step
+ * as the V4L2 core does. Frame @sequence + the delay of the control is the
+ * first taken with it: 2 for the exposure and 1 for the others by default,
+ * as the drivers write them in a register group. The writes come in the
+ * order of their frames, a control the driver hasn't got is left alone.
+ */
+void sensor_sim_s_ctrl(struct sensor_sim *sim, uint32_t sequence,
+		       enum sensor_sim_ctrl_id id, int32_t value);
+void sensor_sim_set_delay(struct sensor_sim *sim, enum sensor_sim_ctrl_id id,
+			  unsigned int delay);
+/* The value frame @sequence is taken with, the default before any write */
+int32_t sensor_sim_g_ctrl(const struct sensor_sim *sim, uint32_t sequence,
+			  enum sensor_sim_ctrl_id id);
+
+/*
+ * Take frame @sequence of a scene with the controls it has: @light is what
+ * each pixel collects in a line of exposure at 1x, @width x @height of
+ * them at the top left of the mode. The sensor scales it by the exposure
+ * and the gain, and the red and blue pixels by their balance, adds shot
+ * and read noise, clips it at 1023 less @black and adds @black, packed
+ * in @height lines of @stride bytes. Return -1 with errno set for a window
+ * larger than the mode.
+ */
+int sensor_sim_expose(struct sensor_sim *sim, uint32_t sequence,
+		      const float *light, unsigned int width,
+		      unsigned int height, unsigned int black, uint8_t *dst,
+		      size_t stride);
+
+#endif /* SENSOR_SIM_H */
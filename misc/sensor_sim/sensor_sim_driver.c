@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * The drivers behind sensor_sim.c, see sensor_sim_driver.h. A driver is
+ * probed for each query and removed after it, with what it allocated: the
+ * simulated bus and the devres of kshim.c are of one device at a time.
+ * The sensor is suspended, as it is until it streams, so that the drivers
+ * take the controls without writing them.
+ */
+
+#include "kshim.h"
+#include "sensor_sim_driver.h"
+
+#define SIM_MAX_MODES		16
+
+static const u32 sim_ctrl_ids[SENSOR_SIM_CTRLS] = {
+	[SENSOR_SIM_EXPOSURE] = V4L2_CID_EXPOSURE,
+	[SENSOR_SIM_GAIN] = V4L2_CID_ANALOGUE_GAIN,
+	[SENSOR_SIM_RED] = V4L2_CID_RED_BALANCE,
+	[SENSOR_SIM_BLUE] = V4L2_CID_BLUE_BALANCE,
+};
+
+/* As test_client() of ../driver_test */
+static struct fwnode_handle sim_node;
+static struct i2c_adapter sim_adapter;
+static struct i2c_client sim_client;
+
+static struct v4l2_subdev *sim_probe(const struct sensor_sim_driver *drv,
+				     unsigned int lanes, int *ret)
+{
+	memset(&sim_client, 0, sizeof(sim_client));
+	sim_client.adapter = &sim_adapter;
+	sim_client.addr = 0x36;
+	snprintf(sim_client.name, sizeof(sim_client.name), "%s", drv->name);
+	sim_client.dev.name = sim_client.name;
+	sim_client.dev.fwnode = &sim_node;
+	kshim_pm_active = 0;
+
+	*ret = drv->probe(&sim_client, lanes);
+	if (*ret) {
+		kshim_devres_release();
+		return NULL;
+	}
+
+	return i2c_get_clientdata(&sim_client);
+}
+
+static void sim_remove(const struct sensor_sim_driver *drv)
+{
+	drv->remove(&sim_client);
+	kshim_devres_release();
+}
+
+static void sim_ctrl_range(struct v4l2_subdev *sd, u32 id,
+			   struct sensor_sim_ctrl *c)
+{
+	struct v4l2_ctrl *ctrl = v4l2_ctrl_find(sd->ctrl_handler, id);
+
+	memset(c, 0, sizeof(*c));
+	if (!ctrl)
+		return;
+
+	c->min = ctrl->minimum;
+	c->max = ctrl->maximum;
+	c->step = ctrl->step;
+	c->def = ctrl->default_value;
+}
+
+int sensor_sim_driver_setup(const struct sensor_sim_driver *drv,
+			    const struct sensor_sim_config *cfg,
+			    struct sensor_sim_setup *setup)
+{
+	struct v4l2_subdev_format fmt = {
+		.which = V4L2_SUBDEV_FORMAT_ACTIVE,
+		.format = { .width = cfg->width, .height = cfg->height },
+	};
+	struct v4l2_subdev_frame_interval fi = {
+		.interval = { 1, cfg->fps },
+	};
+	struct v4l2_ctrl *hblank, *vblank, *pixel_rate;
+	struct v4l2_subdev *sd;
+	unsigned int i;
+	int ret;
+
+	sd = sim_probe(drv, cfg->lanes, &ret);
+	if (!sd)
+		return ret;
+
+	memset(setup, 0, sizeof(*setup));
+	hblank = v4l2_ctrl_find(sd->ctrl_handler, V4L2_CID_HBLANK);
+	vblank = v4l2_ctrl_find(sd->ctrl_handler, V4L2_CID_VBLANK);
+	pixel_rate = v4l2_ctrl_find(sd->ctrl_handler, V4L2_CID_PIXEL_RATE);
+	if (!hblank || !vblank || !pixel_rate) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* the mode the driver starts in for a size of 0 */
+	if (cfg->width && cfg->height)
+		ret = sd->ops->pad->set_fmt(sd, NULL, &fmt);
+	else
+		ret = sd->ops->pad->get_fmt(sd, NULL, &fmt);
+	if (!ret && cfg->fps && sd->ops->video->s_frame_interval)
+		ret = sd->ops->video->s_frame_interval(sd, &fi);
+	if (ret)
+		goto out;
+
+	setup->mode.width = fmt.format.width;
+	setup->mode.height = fmt.format.height;
+	setup->mode.hts = fmt.format.width + hblank->val;
+	setup->mode.vts = fmt.format.height + vblank->default_value;
+	setup->mode.pixel_rate = pixel_rate->val64;
+	/* a driver with a frame interval per mode, whatever VBLANK is */
+	if (sd->ops->pad->enum_frame_interval) {
+		ret = sd->ops->video->g_frame_interval(sd, &fi);
+		if (ret)
+			goto out;
+		setup->mode.interval_num = fi.interval.numerator;
+		setup->mode.interval_den = fi.interval.denominator;
+	}
+
+	/* a format keeps the VBLANK of the last mode if it is in range */
+	ret = kshim_s_ctrl(sd->ctrl_handler, V4L2_CID_VBLANK,
+			   cfg->vblank >= 0 ? cfg->vblank :
+					      vblank->default_value);
+	if (ret)
+		goto out;
+	setup->vblank = vblank->val;
+
+	ret = sd->ops->video->g_frame_interval(sd, &fi);
+	if (ret)
+		goto out;
+	setup->num = fi.interval.numerator;
+	setup->den = fi.interval.denominator;
+
+	/* the exposure range follows VBLANK */
+	for (i = 0; i < SENSOR_SIM_CTRLS; i++)
+		sim_ctrl_range(sd, sim_ctrl_ids[i], &setup->ctrls[i]);
+
+out:
+	sim_remove(drv);
+	return ret;
+}
+
+int sensor_sim_driver_modes(const struct sensor_sim_driver *drv,
+			    unsigned int lanes, struct sensor_sim_mode *modes,
+			    unsigned int max)
+{
+	struct v4l2_subdev_format fmt = { .which = V4L2_SUBDEV_FORMAT_ACTIVE };
+	struct v4l2_subdev_frame_size_enum fse = {
+		.which = V4L2_SUBDEV_FORMAT_ACTIVE,
+	};
+	struct v4l2_subdev_frame_interval_enum fie = {
+		.which = V4L2_SUBDEV_FORMAT_ACTIVE,
+	};
+	struct sensor_sim_config cfg = {
+		.sensor = drv->name,
+		.lanes = lanes,
+		.vblank = -1,
+	};
+	struct sensor_sim_config list[SIM_MAX_MODES];
+	struct sensor_sim_setup setup;
+	const struct v4l2_subdev_pad_ops *pad;
+	unsigned int i, n = 0;
+	struct v4l2_subdev *sd;
+	int ret;
+
+	sd = sim_probe(drv, lanes, &ret);
+	if (!sd)
+		return ret;
+	pad = sd->ops->pad;
+
+	ret = pad->get_fmt(sd, NULL, &fmt);
+	fse.code = fmt.format.code;
+	for (; !ret && !pad->enum_frame_size(sd, NULL, &fse); fse.index++) {
+		/* the ov7251 lists its size once per frame interval */
+		for (i = 0; i < n; i++)
+			if (list[i].width == fse.max_width &&
+			    list[i].height == fse.max_height)
+				break;
+		if (i < n)
+			continue;
+
+		cfg.width = fse.max_width;
+		cfg.height = fse.max_height;
+		if (!pad->enum_frame_interval) {
+			if (n < SIM_MAX_MODES)
+				list[n++] = cfg;
+			continue;
+		}
+
+		fie.code = fse.code;
+		fie.width = cfg.width;
+		fie.height = cfg.height;
+		for (fie.index = 0;
+		     !pad->enum_frame_interval(sd, NULL, &fie) &&
+		     n < SIM_MAX_MODES; fie.index++) {
+			/* as ov7251_find_mode_by_ival() rounds it */
+			cfg.fps = (fie.interval.denominator +
+				   fie.interval.numerator / 2) /
+				  fie.interval.numerator;
+			list[n++] = cfg;
+		}
+	}
+	sim_remove(drv);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < n && i < max; i++) {
+		ret = sensor_sim_driver_setup(drv, &list[i], &setup);
+		if (ret)
+			return ret;
+		modes[i] = setup.mode;
+	}
+
+	return n;
+}
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The drivers behind sensor_sim.c. Each driver source of drivers/media/i2c
+ * is built as it is on the simulated bus of ../driver_test (kshim.h), in a
+ * file of its own, and probed for what a configuration of sensor_sim
+ * gives: the mode its formats and frame intervals pick, the timing and the
+ * ranges of its controls. The driver is removed again before the frames,
+ * which only need the numbers.
+ */
+#ifndef SENSOR_SIM_DRIVER_H
+#define SENSOR_SIM_DRIVER_H
+
+#include "sensor_sim.h"
+
+struct i2c_client;
+
+struct sensor_sim_driver {
+	const char *name;
+	/*
+	 * On the board of the tests of ../driver_test, 0 lanes for theirs.
+	 * The subdev is the client data, as v4l2_i2c_subdev_init() sets it.
+	 */
+	int (*probe)(struct i2c_client *client, unsigned int lanes);
+	int (*remove)(struct i2c_client *client);
+	/* V4L2_CID_TEST_PATTERN */
+	const char *const *menu;
+	unsigned int menu_size;
+};
+
+extern const struct sensor_sim_driver ov8865_sim_driver;
+extern const struct sensor_sim_driver ov5693_sim_driver;
+extern const struct sensor_sim_driver ov7251_sim_driver;
+
+/* What the driver sets up for a configuration */
+struct sensor_sim_setup {
+	struct sensor_sim_mode mode;
+	int vblank;
+	/* VIDIOC_SUBDEV_G_FRAME_INTERVAL with that VBLANK */
+	unsigned int num;
+	unsigned int den;
+	/* the controls of sensor_sim_ctrl(), in the order of its ids */
+	struct sensor_sim_ctrl ctrls[SENSOR_SIM_CTRLS];
+};
+
+/*
+ * Set @cfg up on the driver, with sensor_sim_ctrl() ids. Return 0, or
+ * -ERANGE for a VBLANK out of its range and another -errno if the driver
+ * fails.
+ */
+int sensor_sim_driver_setup(const struct sensor_sim_driver *drv,
+			    const struct sensor_sim_config *cfg,
+			    struct sensor_sim_setup *setup);
+
+/*
+ * The modes the driver lists, a size of VIDIOC_SUBDEV_ENUM_FRAME_SIZE
+ * with each of its VIDIOC_SUBDEV_ENUM_FRAME_INTERVAL for a driver that has
+ * them. Fill @modes up to @max and return how many there are, or -errno.
+ */
+int sensor_sim_driver_modes(const struct sensor_sim_driver *drv,
+			    unsigned int lanes, struct sensor_sim_mode *modes,
+			    unsigned int max);
+
+#endif /* SENSOR_SIM_DRIVER_H */
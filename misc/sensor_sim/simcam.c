@@ -0,0 +1,678 @@
+/**
+ * This tool runs a simulated sensor of sensor_sim.h: it draws the test
+ * pattern of the driver's menu, packed as the CIO2 captures it, once a
+ * frame interval of the mode, and with -o writes the frames to a recording
+ * of ../raw_record for the tools that replay one. The frames start on an
+ * absolute schedule, as a sensor runs whether or not the host keeps up: a
+ * frame that can't be drawn before the next one starts is dropped and its
+ * sequence number skipped, as the CIO2 would.
+ *
+ * -l lists the sensors, their modes with the exact frame interval and the
+ * one the driver reports, and their test patterns. -T checks the modes and
+ * intervals the drivers pick and report, every pattern against its
+ * unpacked reference, the controls of the exposed frames, and the
+ * schedule.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "ipu3_unpack.h"
+#include "raw_record.h"
+#include "sensor_sim.h"
+
+/* frames of the schedule test, at 90 fps */
+#define TEST_FRAMES		45
+
+struct run_stats {
+	unsigned int frames;
+	unsigned int dropped;
+	uint32_t last_sequence;
+	double fps;
+	double draw_us;
+	double draw_max_us;
+	double late_max_us;
+	double write_us;
+	double write_max_us;
+};
+
+static volatile sig_atomic_t interrupted;
+
+static void on_sigint(int sig)
+{
+	(void)sig;
+	interrupted = 1;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t t)
+{
+	struct timespec ts = {
+		.tv_sec = t / 1000000000ULL,
+		.tv_nsec = t % 1000000000ULL,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR && !interrupted)
+		;
+}
+
+static struct rawrec_writer *create_record(struct sensor_sim *sim,
+					   const char *sensor,
+					   const char *path, int direct)
+{
+	const struct sensor_sim_mode *mode = sensor_sim_mode(sim);
+	struct rawrec_info info = {
+		.width = mode->width,
+		.height = mode->height,
+		.fourcc = sensor_sim_fourcc(sim),
+		.bytesperline = sensor_sim_bytesperline(sim),
+		/* the controls never change, so they are the applied ones */
+		.flags = RAWREC_APPLIED,
+		.sensor = sensor,
+	};
+	struct rawrec_writer *w;
+
+	w = rawrec_create(path, &info, direct);
+	if (!w)
+		perror(path);
+	else if (direct && !rawrec_direct(w))
+		fprintf(stderr, "%s: no O_DIRECT here, buffered\n", path);
+
+	return w;
+}
+
+static void fill_meta(struct sensor_sim *sim, unsigned int pattern,
+		      uint32_t sequence, uint64_t timestamp,
+		      struct rawrec_meta *m)
+{
+	const struct sensor_sim_mode *mode = sensor_sim_mode(sim);
+
+	memset(m, 0, sizeof(*m));
+	m->sequence = sequence;
+	m->timestamp_ns = timestamp;
+	m->bytesused = sensor_sim_bytesperline(sim) * mode->height;
+	m->ctrl_mask = 1U << RAWREC_VBLANK | 1U << RAWREC_HBLANK |
+		       1U << RAWREC_TEST_PATTERN;
+	m->ctrls[RAWREC_VBLANK] = sensor_sim_vblank(sim);
+	m->ctrls[RAWREC_HBLANK] = mode->hts - mode->width;
+	m->ctrls[RAWREC_TEST_PATTERN] = pattern;
+}
+
+/*
+ * Run @frames frames (until SIGINT for 0) on the schedule of the mode, or
+ * as fast as they are drawn with @free_run, into @w if there is one.
+ */
+static int run(struct sensor_sim *sim, unsigned int pattern,
+	       unsigned int frames, int free_run, struct rawrec_writer *w,
+	       struct run_stats *st)
+{
+	const struct sensor_sim_mode *mode = sensor_sim_mode(sim);
+	size_t bpl = sensor_sim_bytesperline(sim);
+	size_t len = (bpl * mode->height + RAWREC_ALIGN - 1) /
+		     RAWREC_ALIGN * RAWREC_ALIGN;
+	uint64_t interval = sensor_sim_interval_ns(sim);
+	uint64_t start, first = 0, frame_start, t, dt;
+	struct rawrec_meta m;
+	uint32_t sequence;
+	uint8_t *buffer;
+	int ret = 0;
+
+	memset(st, 0, sizeof(*st));
+	/* page aligned, so that the recording writes from it */
+	buffer = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer == MAP_FAILED) {
+		perror("mmap");
+		return -1;
+	}
+
+	start = now_ns();
+	for (sequence = 0; (!frames || st->frames < frames) && !interrupted;
+	     sequence++) {
+		if (free_run) {
+			frame_start = now_ns();
+		} else {
+			frame_start = start + sequence * interval;
+			/* the next frame has started, this one is gone */
+			if (now_ns() >= frame_start + interval) {
+				st->dropped++;
+				continue;
+			}
+			sleep_until(frame_start);
+			dt = now_ns() - frame_start;
+			if (dt / 1e3 > st->late_max_us)
+				st->late_max_us = dt / 1e3;
+		}
+
+		t = now_ns();
+		sensor_sim_frame(sim, sequence, buffer, bpl);
+		dt = now_ns() - t;
+		st->draw_us += dt / 1e3;
+		if (dt / 1e3 > st->draw_max_us)
+			st->draw_max_us = dt / 1e3;
+
+		if (w) {
+			fill_meta(sim, pattern, sequence, frame_start, &m);
+			t = now_ns();
+			if (rawrec_append(w, &m, buffer)) {
+				perror("write");
+				ret = -1;
+				break;
+			}
+			dt = now_ns() - t;
+			st->write_us += dt / 1e3;
+			if (dt / 1e3 > st->write_max_us)
+				st->write_max_us = dt / 1e3;
+		}
+
+		if (!st->frames)
+			first = frame_start;
+		st->frames++;
+		st->last_sequence = sequence;
+		if (sequence)
+			st->fps = sequence * 1e9 / (frame_start - first);
+	}
+
+	if (st->frames) {
+		st->draw_us /= st->frames;
+		st->write_us /= st->frames;
+	}
+	munmap(buffer, len);
+	return ret;
+}
+
+static void print_stats(struct sensor_sim *sim, const struct run_stats *st,
+			int free_run, int recording)
+{
+	printf("%u frames, %u dropped, %.2f fps", st->frames, st->dropped,
+	       st->fps);
+	if (!free_run)
+		printf(" (%.2f), woken up %.0f us late at most",
+		       1e9 / sensor_sim_interval_ns(sim), st->late_max_us);
+	printf("\ndrawn in %.2f ms, %.2f ms at most\n", st->draw_us / 1e3,
+	       st->draw_max_us / 1e3);
+	if (recording)
+		printf("written in %.2f ms, %.2f ms at most\n",
+		       st->write_us / 1e3, st->write_max_us / 1e3);
+}
+
+static void list(unsigned int lanes)
+{
+	struct sensor_sim_config cfg = { .lanes = lanes };
+	const struct sensor_sim_mode *mode;
+	struct sensor_sim *sim;
+	unsigned int i, j, num, den;
+	const char *name;
+
+	for (i = 0; (cfg.sensor = sensor_sim_sensor_name(i)); i++) {
+		printf("%s\n", cfg.sensor);
+		for (j = 0; (mode = sensor_sim_enum_mode(cfg.sensor, lanes, j));
+		     j++) {
+			cfg.width = mode->width;
+			cfg.height = mode->height;
+			cfg.fps = mode->interval_num ?
+				  mode->interval_den / mode->interval_num : 0;
+			cfg.vblank = -1;
+			sim = sensor_sim_create(&cfg);
+			if (!sim)
+				continue;
+			sensor_sim_driver_interval(sim, &num, &den);
+			printf("  %ux%u, HTS %u VTS %u at %.1f MHz: %.3f ms, driver %u/%u\n",
+			       mode->width, mode->height, mode->hts, mode->vts,
+			       mode->pixel_rate / 1e6,
+			       sensor_sim_interval_ns(sim) / 1e6, num, den);
+			sensor_sim_destroy(sim);
+		}
+		for (j = 0; (name = sensor_sim_pattern_name(cfg.sensor, j));
+		     j++)
+			printf("  pattern %u: %s\n", j, name);
+	}
+}
+
+/*
+ * Test
+ */
+static const struct {
+	const char *sensor;
+	unsigned int width, height, fps;
+	int vblank;
+	/* what the driver picks and reports */
+	unsigned int mode_width, mode_height;
+	unsigned int num, den;
+} test_modes[] = {
+	{ "ov8865", 0, 0, 0, -1, 3264, 2448, 1, 30 },
+	{ "ov8865", 3200, 1800, 0, -1, 3264, 1836, 1, 30 },
+	{ "ov8865", 1600, 1200, 0, -1, 1632, 1224, 1, 120 },
+	{ "ov8865", 3264, 2448, 0, 2492, 3264, 2448, 1, 15 },
+	{ "ov5693", 0, 0, 0, -1, 2592, 1944, 1, 30 },
+	{ "ov5693", 2000, 1900, 0, -1, 2592, 1944, 1, 30 },
+	{ "ov5693", 1300, 980, 0, -1, 1296, 972, 1, 60 },
+	{ "ov5693", 1296, 1944, 0, -1, 1296, 1944, 1, 30 },
+	{ "ov7251", 0, 0, 0, -1, 640, 480, 100, 3000 },
+	{ "ov7251", 0, 0, 60, -1, 640, 480, 100, 6014 },
+	{ "ov7251", 0, 0, 100, -1, 640, 480, 100, 9043 },
+	/* whatever VBLANK is */
+	{ "ov7251", 0, 0, 30, 100, 640, 480, 100, 3000 },
+};
+
+static int test_intervals(void)
+{
+	struct sensor_sim_config cfg;
+	const struct sensor_sim_mode *mode;
+	struct sensor_sim *sim;
+	unsigned int i, num, den;
+	double exact, driver;
+	int failed = 0, wrong;
+
+	for (i = 0; i < sizeof(test_modes) / sizeof(test_modes[0]); i++) {
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.sensor = test_modes[i].sensor;
+		cfg.width = test_modes[i].width;
+		cfg.height = test_modes[i].height;
+		cfg.fps = test_modes[i].fps;
+		cfg.vblank = test_modes[i].vblank;
+		sim = sensor_sim_create(&cfg);
+		if (!sim) {
+			perror(cfg.sensor);
+			failed = 1;
+			continue;
+		}
+		mode = sensor_sim_mode(sim);
+		sensor_sim_driver_interval(sim, &num, &den);
+		exact = sensor_sim_interval_ns(sim) / 1e9;
+		driver = (double)num / den;
+		wrong = mode->width != test_modes[i].mode_width ||
+			mode->height != test_modes[i].mode_height ||
+			num != test_modes[i].num || den != test_modes[i].den;
+		/* the table of the ov7251 holds only for the default VBLANK */
+		if (cfg.vblank < 0 || !mode->interval_num)
+			wrong |= exact < driver * 0.99 || exact > driver * 1.01;
+		printf("%s %ux%u: %ux%u, %u/%u, %.3f ms: %s\n", cfg.sensor,
+		       cfg.width, cfg.height, mode->width, mode->height, num,
+		       den, exact * 1e3, wrong ? "wrong" : "ok");
+		failed |= wrong;
+		sensor_sim_destroy(sim);
+	}
+
+	/* out of the range of V4L2_CID_VBLANK */
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.sensor = "ov8865";
+	cfg.vblank = 3;
+	sim = sensor_sim_create(&cfg);
+	wrong = sim || errno != ERANGE;
+	sensor_sim_destroy(sim);
+	cfg.vblank = 0xffff - 2448 + 1;
+	sim = sensor_sim_create(&cfg);
+	wrong |= sim || errno != ERANGE;
+	sensor_sim_destroy(sim);
+	cfg.vblank = -1;
+	cfg.pattern = 6;
+	sim = sensor_sim_create(&cfg);
+	wrong |= sim || errno != EINVAL;
+	sensor_sim_destroy(sim);
+	printf("bad controls: %s\n", wrong ? "wrong" : "ok");
+
+	return failed | wrong;
+}
+
+/* Unpack @frame and check it against the reference and its own packing */
+static int check_frame(struct sensor_sim *sim, uint32_t sequence,
+		       const uint8_t *frame, uint16_t *line, uint16_t *ref,
+		       uint8_t *packed)
+{
+	const struct sensor_sim_mode *mode = sensor_sim_mode(sim);
+	size_t bpl = sensor_sim_bytesperline(sim);
+	size_t used = (mode->width + 24) / 25 * 32;
+	const uint8_t *row;
+	unsigned int x, y;
+
+	for (y = 0; y < mode->height; y++) {
+		row = frame + y * bpl;
+		ipu3_unpack_line16(row, line, mode->width);
+		sensor_sim_line(sim, sequence, y, ref);
+		if (memcmp(line, ref, mode->width * sizeof(*line)))
+			return -1;
+		for (x = 0; x < mode->width; x++)
+			if (line[x] > 1023)
+				return -1;
+		/* nothing in the unused bits, past the width and after */
+		ipu3_pack_line16(line, packed, mode->width);
+		if (memcmp(packed, row, used))
+			return -1;
+		for (x = used; x < bpl; x++)
+			if (row[x])
+				return -1;
+	}
+
+	return 0;
+}
+
+/* White at the left and black at the right, in all the Bayer channels */
+static int check_bars(struct sensor_sim *sim, const uint8_t *frame,
+		      uint16_t *line)
+{
+	const struct sensor_sim_mode *mode = sensor_sim_mode(sim);
+	unsigned int w = mode->width, y;
+
+	for (y = 0; y < 2; y++) {
+		ipu3_unpack_line16(frame + y * sensor_sim_bytesperline(sim),
+				   line, w);
+		if (line[0] != 1023 || line[1] != 1023 || line[w - 2] ||
+		    line[w - 1])
+			return -1;
+	}
+
+	return 0;
+}
+
+static int test_patterns(void)
+{
+	struct sensor_sim_config cfg = { .vblank = -1 };
+	const struct sensor_sim_mode *mode;
+	enum sensor_sim_pattern pattern;
+	struct sensor_sim *sim;
+	unsigned int i, j, n;
+	uint8_t *frame[2], *packed;
+	uint16_t *line, *ref;
+	size_t size;
+	int failed = 0, wrong, moved;
+
+	for (i = 0; (cfg.sensor = sensor_sim_sensor_name(i)); i++) {
+		/* the smallest mode, with a partial last block but the ov8865 */
+		for (n = 0; sensor_sim_enum_mode(cfg.sensor, 0, n); n++)
+			;
+		mode = sensor_sim_enum_mode(cfg.sensor, 0, n - 1);
+		cfg.width = mode->width;
+		cfg.height = mode->height;
+		cfg.fps = mode->interval_num ?
+			  mode->interval_den / mode->interval_num : 0;
+
+		for (j = 0; sensor_sim_pattern_name(cfg.sensor, j); j++) {
+			cfg.pattern = j;
+			sim = sensor_sim_create(&cfg);
+			if (!sim) {
+				perror(cfg.sensor);
+				return -1;
+			}
+			mode = sensor_sim_mode(sim);
+			pattern = sensor_sim_pattern(sim);
+			size = sensor_sim_bytesperline(sim) * mode->height;
+			frame[0] = malloc(size);
+			frame[1] = malloc(size);
+			packed = malloc(sensor_sim_bytesperline(sim));
+			line = malloc(mode->width * sizeof(*line));
+			ref = malloc(mode->width * sizeof(*ref));
+			if (!frame[0] || !frame[1] || !packed || !line || !ref) {
+				perror("test");
+				return -1;
+			}
+
+			/* over garbage, which has to be gone */
+			memset(frame[0], 0xff, size);
+			memset(frame[1], 0xa5, size);
+			sensor_sim_frame(sim, 0, frame[0], sensor_sim_bytesperline(sim));
+			sensor_sim_frame(sim, 1, frame[1], sensor_sim_bytesperline(sim));
+			wrong = check_frame(sim, 0, frame[0], line, ref, packed) ||
+				check_frame(sim, 1, frame[1], line, ref, packed);
+
+			moved = memcmp(frame[0], frame[1], size) != 0;
+			wrong |= moved != (pattern == SENSOR_SIM_RANDOM ||
+					   pattern == SENSOR_SIM_BARS_ROLLING ||
+					   pattern == SENSOR_SIM_SQUARES_ROLLING);
+			if (pattern == SENSOR_SIM_BARS ||
+			    pattern == SENSOR_SIM_GREY_BARS)
+				wrong |= check_bars(sim, frame[0], line);
+
+			printf("%s %ux%u, %s: %s\n", cfg.sensor, mode->width,
+			       mode->height, sensor_sim_pattern_name(cfg.sensor, j),
+			       wrong ? "wrong" : "ok");
+			failed |= wrong;
+
+			free(frame[0]);
+			free(frame[1]);
+			free(packed);
+			free(line);
+			free(ref);
+			sensor_sim_destroy(sim);
+		}
+	}
+
+	return failed;
+}
+
+static int test_schedule(void)
+{
+	struct sensor_sim_config cfg = {
+		.sensor = "ov7251",
+		.fps = 90,
+		.vblank = -1,
+		.pattern = 1,
+	};
+	struct sensor_sim *sim = sensor_sim_create(&cfg);
+	struct run_stats st;
+	double fps;
+	int wrong;
+
+	if (!sim || run(sim, cfg.pattern, TEST_FRAMES, 0, NULL, &st)) {
+		perror("schedule");
+		sensor_sim_destroy(sim);
+		return -1;
+	}
+
+	/* frames may be dropped on a busy machine, but not the rate */
+	fps = 1e9 / sensor_sim_interval_ns(sim);
+	wrong = st.frames != TEST_FRAMES || st.fps < fps * 0.99 ||
+		st.fps > fps * 1.01 ||
+		st.last_sequence != TEST_FRAMES - 1 + st.dropped;
+	printf("%u frames on the schedule of %.2f fps, %u dropped: %.2f fps, %s\n",
+	       st.frames, fps, st.dropped, st.fps, wrong ? "wrong" : "ok");
+
+	sensor_sim_destroy(sim);
+	return wrong;
+}
+
+/*
+ * The controls written after frame 0 reach frame 1, the exposure frame 2,
+ * and scale a flat light of 2 in the green and red pixels
+ */
+static int test_exposure(void)
+{
+	static const struct {
+		int32_t exposure, gain, red;
+		/* means, less the black level */
+		double green, red_mean;
+	} frames[] = {
+		{ 32, 128, 1024, 64, 64 },
+		{ 32, 256, 2048, 128, 256 },
+		{ 128, 256, 2048, 512, 959 },
+	};
+	struct sensor_sim_config cfg = {
+		.sensor = "ov8865",
+		.width = 1632,
+		.height = 1224,
+		.vblank = -1,
+	};
+	unsigned int i, x, y, n[2];
+	struct sensor_sim *sim;
+	size_t bpl = ipu3_packed_bpl(64);
+	uint8_t packed[128 * 64];
+	uint16_t line[64];
+	float light[64 * 64];
+	double sum[2];
+	int wrong = 0;
+
+	sim = sensor_sim_create(&cfg);
+	if (!sim) {
+		perror(cfg.sensor);
+		return -1;
+	}
+	for (i = 0; i < 64 * 64; i++)
+		light[i] = 2;
+
+	sensor_sim_s_ctrl(sim, 0, SENSOR_SIM_EXPOSURE, 128);
+	sensor_sim_s_ctrl(sim, 0, SENSOR_SIM_GAIN, 256);
+	sensor_sim_s_ctrl(sim, 0, SENSOR_SIM_RED, 2048);
+	for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		wrong |= sensor_sim_g_ctrl(sim, i, SENSOR_SIM_EXPOSURE) !=
+				 frames[i].exposure ||
+			 sensor_sim_g_ctrl(sim, i, SENSOR_SIM_GAIN) !=
+				 frames[i].gain ||
+			 sensor_sim_g_ctrl(sim, i, SENSOR_SIM_RED) !=
+				 frames[i].red;
+		if (sensor_sim_expose(sim, i, light, 64, 64, 64, packed, bpl)) {
+			wrong = 1;
+			break;
+		}
+
+		/* BGGR: green on the even lines at odd x, red at odd x, y */
+		sum[0] = sum[1] = 0;
+		n[0] = n[1] = 0;
+		for (y = 0; y < 64; y++) {
+			ipu3_unpack_line16(packed + y * bpl, line, 64);
+			for (x = 1; x < 64; x += 2) {
+				sum[y & 1] += line[x] - 64;
+				n[y & 1]++;
+			}
+		}
+		wrong |= fabs(sum[0] / n[0] / frames[i].green - 1) > 0.02 ||
+			 fabs(sum[1] / n[1] / frames[i].red_mean - 1) > 0.02;
+	}
+
+	/* clamped to the range, and no window larger than the mode */
+	sensor_sim_s_ctrl(sim, 2, SENSOR_SIM_EXPOSURE, 100000);
+	wrong |= sensor_sim_g_ctrl(sim, 4, SENSOR_SIM_EXPOSURE) !=
+		 sensor_sim_ctrl(sim, SENSOR_SIM_EXPOSURE)->max;
+	wrong |= !sensor_sim_expose(sim, 3, light, 1634, 2, 64, packed, bpl) ||
+		 errno != EINVAL;
+	printf("exposure, gain and balance: %s\n", wrong ? "wrong" : "ok");
+
+	sensor_sim_destroy(sim);
+	return wrong;
+}
+
+static int test(void)
+{
+	int failed = 0;
+
+	failed |= test_intervals();
+	failed |= test_patterns();
+	failed |= test_exposure();
+	failed |= test_schedule();
+
+	return failed;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [-m ov8865|ov5693|ov7251] [-s <width>x<height>] [-r <fps>]\n"
+		"          [-L <lanes>] [-V <vblank>] [-p <pattern>] [-n <frames>]\n"
+		"          [-F] [-o <file>] [-B]\n"
+		"       %s -l [-L <lanes>]\n"
+		"       %s -T\n", argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct sensor_sim_config cfg = { .sensor = "ov8865", .vblank = -1 };
+	const struct sensor_sim_mode *mode;
+	struct rawrec_writer *w = NULL;
+	struct sensor_sim *sim;
+	struct run_stats st;
+	const char *output = NULL;
+	unsigned int frames = 0, num, den;
+	int free_run = 0, direct = 1, ret, c;
+
+	while ((c = getopt(argc, argv, "m:s:r:L:V:p:n:Fo:BlT")) != -1) {
+		switch (c) {
+		case 'm':
+			cfg.sensor = optarg;
+			break;
+		case 's':
+			if (sscanf(optarg, "%ux%u", &cfg.width,
+				   &cfg.height) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'r':
+			cfg.fps = strtoul(optarg, NULL, 0);
+			break;
+		case 'L':
+			cfg.lanes = strtoul(optarg, NULL, 0);
+			break;
+		case 'V':
+			cfg.vblank = strtol(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg.pattern = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			free_run = 1;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'B':
+			direct = 0;
+			break;
+		case 'l':
+			list(cfg.lanes);
+			return 0;
+		case 'T':
+			return test() ? 1 : 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	sim = sensor_sim_create(&cfg);
+	if (!sim) {
+		perror(cfg.sensor);
+		return 1;
+	}
+	mode = sensor_sim_mode(sim);
+	sensor_sim_driver_interval(sim, &num, &den);
+	printf("%s %ux%u, VBLANK %d, %s: %.3f ms a frame, driver %u/%u\n",
+	       cfg.sensor, mode->width, mode->height, sensor_sim_vblank(sim),
+	       sensor_sim_pattern_name(cfg.sensor, cfg.pattern),
+	       sensor_sim_interval_ns(sim) / 1e6, num, den);
+
+	if (output) {
+		w = create_record(sim, cfg.sensor, output, direct);
+		if (!w) {
+			sensor_sim_destroy(sim);
+			return 1;
+		}
+	}
+
+	signal(SIGINT, on_sigint);
+	ret = run(sim, cfg.pattern, frames, free_run, w, &st);
+	if (w && rawrec_finish(w)) {
+		perror(output);
+		ret = -1;
+	}
+	print_stats(sim, &st, free_run, !!w);
+
+	sensor_sim_destroy(sim);
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,554 @@
+/**
+ * This tool converts raw IPU3 packed 10-bit Bayer frames, as captured
+ * from the CIO2 video nodes, to PPM images with the software ISP, at full
+ * size or downscaled by 2 or 4.
+ *
+ * It also checks the software ISP against golden images of a synthetic
+ * scene (-T), and measures its throughput with 1, 2, 4 and 8 threads
+ * (-B).
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ipu3_unpack.h"
+#include "soft_isp.h"
+
+#define BENCH_WIDTH		3264
+#define BENCH_HEIGHT		2448
+#define BENCH_RUNS		20
+
+static const char *const order_names[] = {
+	[SOFT_ISP_BGGR] = "BGGR",
+	[SOFT_ISP_GBRG] = "GBRG",
+	[SOFT_ISP_GRBG] = "GRBG",
+	[SOFT_ISP_RGGB] = "RGGB",
+};
+
+static const char *const method_names[] = {
+	[SOFT_ISP_BILINEAR] = "bilinear",
+	[SOFT_ISP_EDGE] = "edge",
+};
+
+struct image {
+	unsigned int width;
+	unsigned int height;
+	size_t stride;
+	uint8_t *data;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int image_alloc(struct image *img, unsigned int width,
+		       unsigned int height, size_t stride)
+{
+	img->width = width;
+	img->height = height;
+	img->stride = stride;
+	img->data = malloc(stride * height);
+	return img->data ? 0 : -1;
+}
+
+/*
+ * Synthetic scene, 10-bit: smooth gradients, a disc with a sharp edge and
+ * thin diagonal lines, integers only so that the golden images don't
+ * depend on the floating point unit.
+ */
+static void scene_pixel(unsigned int x, unsigned int y, unsigned int width,
+			unsigned int height, uint16_t rgb[3])
+{
+	int dx = (int)x - (int)width / 2, dy = (int)y - (int)height / 2;
+	int r = height / 4;
+
+	if (dx * dx + dy * dy < r * r) {
+		rgb[0] = 900;
+		rgb[1] = 200 + 400 * y / height;
+		rgb[2] = 150;
+		return;
+	}
+
+	if ((x + y) % 40 < 2) {
+		rgb[0] = rgb[1] = rgb[2] = 60;
+		return;
+	}
+
+	rgb[0] = 200 + 600 * x / width;
+	rgb[1] = 300 + 500 * y / height;
+	rgb[2] = 800 - 600 * (x + y) / (width + height);
+}
+
+/* The colour of the pixel at @x, @y for each order: 0 red, 1 green, 2 blue */
+static int bayer_colour(enum soft_isp_order order, unsigned int x,
+			unsigned int y)
+{
+	static const int colours[][4] = {
+		[SOFT_ISP_BGGR] = { 2, 1, 1, 0 },
+		[SOFT_ISP_GBRG] = { 1, 2, 0, 1 },
+		[SOFT_ISP_GRBG] = { 1, 0, 2, 1 },
+		[SOFT_ISP_RGGB] = { 0, 1, 1, 2 },
+	};
+
+	return colours[order][(y & 1) * 2 + (x & 1)];
+}
+
+/* The scene as a packed Bayer frame */
+static int make_raw(struct image *raw, enum soft_isp_order order,
+		    unsigned int width, unsigned int height)
+{
+	uint16_t *line, rgb[3];
+	unsigned int x, y;
+
+	if (image_alloc(raw, width, height, ipu3_packed_bpl(width)))
+		return -1;
+	line = malloc(width * sizeof(*line));
+	if (!line) {
+		free(raw->data);
+		raw->data = NULL;
+		return -1;
+	}
+
+	memset(raw->data, 0, raw->stride * height);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			scene_pixel(x, y, width, height, rgb);
+			line[x] = rgb[bayer_colour(order, x, y)];
+		}
+		ipu3_pack_line16(line, raw->data + y * raw->stride, width);
+	}
+
+	free(line);
+	return 0;
+}
+
+/* PSNR of @img against the scene averaged over @scale x @scale pixels */
+static double scene_psnr(const struct image *img, unsigned int width,
+			 unsigned int height, unsigned int scale)
+{
+	unsigned int x, y, i, j, k, sum[3];
+	double se = 0, d;
+	uint16_t rgb[3];
+
+	for (y = 0; y < img->height; y++) {
+		for (x = 0; x < img->width; x++) {
+			sum[0] = sum[1] = sum[2] = 0;
+			for (j = 0; j < scale; j++) {
+				for (i = 0; i < scale; i++) {
+					scene_pixel(x * scale + i, y * scale + j,
+						    width, height, rgb);
+					for (k = 0; k < 3; k++)
+						sum[k] += rgb[k];
+				}
+			}
+			for (k = 0; k < 3; k++) {
+				d = img->data[y * img->stride + 3 * x + k] -
+				    sum[k] / 4.0 / (scale * scale);
+				se += d * d;
+			}
+		}
+	}
+
+	se /= 3.0 * img->width * img->height;
+	return se ? 10 * log10(255.0 * 255.0 / se) : 99;
+}
+
+/* FNV-1a of the pixels */
+static uint32_t image_hash(const struct image *img)
+{
+	uint32_t hash = 2166136261u;
+	unsigned int x, y;
+
+	for (y = 0; y < img->height; y++) {
+		for (x = 0; x < img->width * 3; x++) {
+			hash ^= img->data[y * img->stride + x];
+			hash *= 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+static int run_isp(const struct soft_isp_config *cfg, const struct image *raw,
+		   struct image *out)
+{
+	struct soft_isp *isp;
+	unsigned int w, h;
+
+	isp = soft_isp_create(cfg);
+	if (!isp) {
+		perror("soft_isp_create");
+		return -1;
+	}
+
+	soft_isp_output_size(isp, &w, &h);
+	if (image_alloc(out, w, h, 3 * w)) {
+		soft_isp_destroy(isp);
+		return -1;
+	}
+	soft_isp_process(isp, raw->data, raw->stride, out->data, out->stride);
+	soft_isp_destroy(isp);
+
+	return 0;
+}
+
+/*
+ * The golden images are those of the scalar version, with one thread, on
+ * a 250x300 scene: 3 bands, and planes of 125 values so that the SIMD
+ * versions have a tail. Each hash covers the 4 Bayer orders in turn.
+ */
+#define GOLDEN_WIDTH	250
+#define GOLDEN_HEIGHT	300
+
+static const uint32_t golden[2][3] = {
+	[SOFT_ISP_BILINEAR] = { 0x9d7738cd, 0xe604da52, 0x456bd6e0 },
+	[SOFT_ISP_EDGE] = { 0x12594d2a, 0x65329b1e, 0xd2847914 },
+};
+
+/*
+ * Least PSNR against the scene, at each scale, a bit under what the golden
+ * images get: a change of the golden images must not make them worse
+ */
+static const double min_psnr[2][3] = {
+	[SOFT_ISP_BILINEAR] = { 25.0, 29.5, 37.5 },
+	[SOFT_ISP_EDGE] = { 28.5, 33.0, 38.5 },
+};
+
+/* Return the number of failed checks of @cfg against the golden image */
+static int check_golden(struct soft_isp_config *cfg, const struct image *raw,
+			int verbose)
+{
+	unsigned int s = cfg->scale >> 1;
+	double psnr = 99, p;
+	uint32_t hash = 2166136261u;
+	struct image out;
+	int failed = 0;
+
+	for (cfg->order = 0; cfg->order < 4; cfg->order++) {
+		if (run_isp(cfg, &raw[cfg->order], &out))
+			return 1;
+		hash = (hash ^ image_hash(&out)) * 16777619u;
+		p = scene_psnr(&out, cfg->width, cfg->height, cfg->scale);
+		if (p < psnr)
+			psnr = p;
+		free(out.data);
+	}
+
+	if (hash != golden[cfg->method][s])
+		failed++;
+	if (psnr < min_psnr[cfg->method][s])
+		failed++;
+	if (!verbose && !failed)
+		return 0;
+
+	printf("%-8s scale %u %-6s %u threads: hash 0x%08x, PSNR %.2f dB\n",
+	       method_names[cfg->method], cfg->scale,
+	       soft_isp_isa_name(cfg->isa), cfg->threads, hash, psnr);
+	if (hash != golden[cfg->method][s])
+		printf("  not the golden image 0x%08x\n", golden[cfg->method][s]);
+	if (psnr < min_psnr[cfg->method][s])
+		printf("  PSNR under %.2f dB\n", min_psnr[cfg->method][s]);
+
+	return failed;
+}
+
+static int selftest(int verbose)
+{
+	static const unsigned int threads[] = { 1, 3 };
+	static const unsigned int scales[] = { 1, 2, 4 };
+	struct soft_isp_config cfg = {
+		.width = GOLDEN_WIDTH,
+		.height = GOLDEN_HEIGHT,
+	};
+	struct image raw[4] = { { 0 } };
+	unsigned int m, s, t, i;
+	int failed = 0, isa;
+
+	for (i = 0; i < 4; i++) {
+		if (make_raw(&raw[i], i, cfg.width, cfg.height)) {
+			failed = 1;
+			goto out;
+		}
+	}
+
+	/* every version and thread count must give the golden images */
+	for (isa = SOFT_ISP_SCALAR; isa <= SOFT_ISP_AVX2; isa++) {
+		if (!soft_isp_isa_supported(isa)) {
+			printf("%s not supported, not checked\n",
+			       soft_isp_isa_name(isa));
+			continue;
+		}
+		for (m = SOFT_ISP_BILINEAR; m <= SOFT_ISP_EDGE; m++) {
+			for (s = 0; s < 3; s++) {
+				for (t = 0; t < 2; t++) {
+					cfg.isa = isa;
+					cfg.method = m;
+					cfg.scale = scales[s];
+					cfg.threads = threads[t];
+					failed += check_golden(&cfg, raw,
+							       verbose);
+				}
+			}
+		}
+	}
+
+	printf("%s\n", failed ? "FAILED" : "all results ok");
+out:
+	for (i = 0; i < 4; i++)
+		free(raw[i].data);
+	return failed;
+}
+
+static int bench(struct soft_isp_config cfg, unsigned int runs, int only_isa)
+{
+	static const unsigned int threads[] = { 1, 2, 4, 8 };
+	double start, t, best, total;
+	struct soft_isp *isp;
+	unsigned int w, h, i, n;
+	struct image raw, out;
+	int isa;
+
+	if (make_raw(&raw, cfg.order, cfg.width, cfg.height))
+		return -1;
+
+	printf("%ux%u %s, %s, scale %u, best and mean of %u frames, %ld CPUs\n",
+	       cfg.width, cfg.height, order_names[cfg.order],
+	       method_names[cfg.method], cfg.scale, runs,
+	       sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-8s %7s %10s %10s %8s %10s %8s\n", "isa", "threads",
+	       "ms/frame", "mean", "fps", "Mpixel/s", "GB/s");
+
+	for (isa = SOFT_ISP_SCALAR; isa <= SOFT_ISP_AVX2; isa++) {
+		if (only_isa >= 0 && isa != only_isa)
+			continue;
+		if (!soft_isp_isa_supported(isa)) {
+			printf("%-8s not supported\n", soft_isp_isa_name(isa));
+			continue;
+		}
+		/* the unpacking is part of it, scalar means scalar there too */
+		ipu3_unpack_set_isa(isa == SOFT_ISP_SCALAR ?
+				    IPU3_UNPACK_SCALAR : ipu3_unpack_best_isa());
+
+		for (n = 0; n < sizeof(threads) / sizeof(threads[0]); n++) {
+			cfg.isa = isa;
+			cfg.threads = threads[n];
+			isp = soft_isp_create(&cfg);
+			if (!isp) {
+				perror("soft_isp_create");
+				free(raw.data);
+				return -1;
+			}
+			soft_isp_output_size(isp, &w, &h);
+			if (image_alloc(&out, w, h, 3 * w)) {
+				soft_isp_destroy(isp);
+				free(raw.data);
+				return -1;
+			}
+
+			/* warm up the threads and the output pages */
+			soft_isp_process(isp, raw.data, raw.stride, out.data,
+					 out.stride);
+			best = total = 0;
+			for (i = 0; i < runs; i++) {
+				start = now_s();
+				soft_isp_process(isp, raw.data, raw.stride,
+						 out.data, out.stride);
+				t = now_s() - start;
+				total += t;
+				if (!i || t < best)
+					best = t;
+			}
+
+			printf("%-8s %7u %10.3f %10.3f %8.1f %10.1f %8.2f\n",
+			       soft_isp_isa_name(isa), cfg.threads, best * 1e3,
+			       total / runs * 1e3, 1 / best,
+			       (double)cfg.width * cfg.height / best / 1e6,
+			       (double)raw.stride * cfg.height / best / 1e9);
+
+			free(out.data);
+			soft_isp_destroy(isp);
+		}
+	}
+
+	free(raw.data);
+	return 0;
+}
+
+static int convert(const struct soft_isp_config *cfg, size_t stride,
+		   const char *in, const char *out_path)
+{
+	struct image raw = { 0 }, out = { 0 };
+	FILE *f;
+	int ret = -1;
+	unsigned int y;
+
+	if (image_alloc(&raw, cfg->width, cfg->height, stride))
+		return -1;
+
+	f = fopen(in, "rb");
+	if (!f) {
+		perror(in);
+		goto out;
+	}
+	if (fread(raw.data, stride, cfg->height, f) != cfg->height) {
+		fprintf(stderr, "%s: less than %zu bytes\n", in,
+			stride * cfg->height);
+		fclose(f);
+		goto out;
+	}
+	fclose(f);
+
+	if (run_isp(cfg, &raw, &out))
+		goto out;
+
+	f = fopen(out_path, "wb");
+	if (!f) {
+		perror(out_path);
+		goto out;
+	}
+	fprintf(f, "P6\n%u %u\n255\n", out.width, out.height);
+	for (y = 0; y < out.height; y++)
+		fwrite(out.data + y * out.stride, 3, out.width, f);
+	if (fclose(f)) {
+		perror(out_path);
+		goto out;
+	}
+	ret = 0;
+out:
+	free(raw.data);
+	free(out.data);
+	return ret;
+}
+
+static int lookup(const char *const *names, int count, const char *name)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!strcasecmp(names[i], name))
+			return i;
+	}
+
+	return -1;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -w <width> -h <height> [-b <bytesperline>] [options] <raw> <ppm>\n"
+		"       %s -T [-v]\n"
+		"       %s -B [-w <width>] [-h <height>] [-n <frames>] [options]\n"
+		"options:\n"
+		"  -o BGGR|GBRG|GRBG|RGGB  Bayer order (BGGR)\n"
+		"  -m bilinear|edge        demosaic method (edge)\n"
+		"  -s 1|2|4                downscale (1, 2 with -B)\n"
+		"  -t <threads>            0 for one per CPU (0)\n"
+		"  -i scalar|avx2          kernels (the best one)\n",
+		argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct soft_isp_config cfg = {
+		.order = SOFT_ISP_BGGR,
+		.method = SOFT_ISP_EDGE,
+		.isa = SOFT_ISP_ISA_AUTO,
+	};
+	unsigned int runs = BENCH_RUNS;
+	int test = 0, do_bench = 0, verbose = 0, opt, v;
+	size_t stride = 0;
+
+	while ((opt = getopt(argc, argv, "w:h:b:o:m:s:t:i:n:TBv")) != -1) {
+		switch (opt) {
+		case 'w':
+			cfg.width = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+			cfg.height = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			stride = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			v = lookup(order_names, 4, optarg);
+			if (v < 0)
+				goto usage;
+			cfg.order = v;
+			break;
+		case 'm':
+			v = lookup(method_names, 2, optarg);
+			if (v < 0)
+				goto usage;
+			cfg.method = v;
+			break;
+		case 's':
+			cfg.scale = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg.threads = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			if (!strcmp(optarg, "scalar"))
+				cfg.isa = SOFT_ISP_SCALAR;
+			else if (!strcmp(optarg, "avx2"))
+				cfg.isa = SOFT_ISP_AVX2;
+			else
+				goto usage;
+			break;
+		case 'n':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		case 'T':
+			test = 1;
+			break;
+		case 'B':
+			do_bench = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (test)
+		return selftest(verbose) ? 1 : 0;
+
+	if (do_bench) {
+		if (!cfg.width)
+			cfg.width = BENCH_WIDTH;
+		if (!cfg.height)
+			cfg.height = BENCH_HEIGHT;
+		if (!cfg.scale)
+			cfg.scale = 2;
+		if (!runs)
+			goto usage;
+		return bench(cfg, runs, cfg.isa) ? 1 : 0;
+	}
+
+	if (argc - optind != 2 || !cfg.width || !cfg.height)
+		goto usage;
+	if (!cfg.scale)
+		cfg.scale = 1;
+	if (!stride)
+		stride = ipu3_packed_bpl(cfg.width);
+	if (stride < ipu3_packed_bpl(cfg.width)) {
+		fprintf(stderr, "%zu bytes per line is too short for %u pixels\n",
+			stride, cfg.width);
+		return 1;
+	}
+
+	return convert(&cfg, stride, argv[optind], argv[optind + 1]) ? 1 : 0;
+
+usage:
+	usage(argv[0]);
+	return 1;
+}
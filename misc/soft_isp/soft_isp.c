@@ -0,0 +1,528 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Scalar kernels, line pipeline and thread pool of the software ISP. The
+ * AVX2 kernels are in soft_isp_avx2.c and give the same results.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ipu3_unpack.h"
+#include "soft_isp_priv.h"
+
+/* Input lines per band, a multiple of all scales */
+#define BAND_LINES	128
+/* Lines y - 3 to y + 3 are needed for line y, a power of 2 */
+#define RAW_LINES	8
+#define GREEN_LINES	4
+/* Reflected pixels on each side of an unpacked line */
+#define LINE_PAD	4
+
+struct worker {
+	struct soft_isp *isp;
+	pthread_t thread;
+	unsigned int generation;
+	void *mem;
+	uint16_t *line;			/* column -LINE_PAD onwards */
+	int16_t *c[RAW_LINES];
+	int16_t *g[RAW_LINES];
+	int16_t *h[GREEN_LINES];
+	struct soft_isp_rb rb;
+	uint16_t *acc[3];
+};
+
+struct soft_isp {
+	struct soft_isp_config cfg;
+	const struct soft_isp_ops *ops;
+	unsigned int half;		/* values per plane */
+	unsigned int out_width;
+	unsigned int out_height;
+	unsigned int bands;
+	int red0;			/* line 0 has red pixels */
+	int p0;				/* and they are at odd columns */
+
+	/* the frame being processed */
+	const uint8_t *src;
+	size_t src_stride;
+	uint8_t *dst;
+	size_t dst_stride;
+	unsigned int next_band;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned int generation;
+	unsigned int busy;
+	int quit;
+	unsigned int workers_started;
+	struct worker *workers;		/* the first one is the caller */
+};
+
+static inline int clamp10(int v)
+{
+	return v < 0 ? 0 : v > 1023 ? 1023 : v;
+}
+
+static void scalar_split(const uint16_t *line, int16_t *even, int16_t *odd,
+			 int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		even[i] = line[2 * i];
+		odd[i] = line[2 * i + 1];
+	}
+}
+
+static void scalar_green(const struct soft_isp_rows *r, int16_t *h, int start,
+			 int end, enum soft_isp_method method)
+{
+	const int16_t *c = r->c[2], *nn = r->c[0], *ss = r->c[4];
+	const int16_t *w = r->g[2] + r->p - 1, *e = r->g[2] + r->p;
+	const int16_t *n = r->g[1], *s = r->g[3];
+	int lh, lv, gh, gv, dh, dv, i;
+
+	for (i = start; i < end; i++) {
+		if (method == SOFT_ISP_BILINEAR) {
+			h[i] = (w[i] + e[i] + n[i] + s[i] + 2) >> 2;
+			continue;
+		}
+
+		/* half the second derivative of c corrects the average */
+		lh = 2 * c[i] - c[i - 1] - c[i + 1];
+		lv = 2 * c[i] - nn[i] - ss[i];
+		gh = (2 * (w[i] + e[i]) + lh + 2) >> 2;
+		gv = (2 * (n[i] + s[i]) + lv + 2) >> 2;
+		dh = abs(w[i] - e[i]) + abs(lh);
+		dv = abs(n[i] - s[i]) + abs(lv);
+
+		h[i] = clamp10(dh < dv ? gh : dv < dh ? gv : (gh + gv + 1) >> 1);
+	}
+}
+
+static void scalar_rb(const struct soft_isp_rows *r,
+		      const struct soft_isp_rb *out, int start, int end,
+		      enum soft_isp_method method)
+{
+	const int16_t *c = r->c[2], *g = r->g[2], *h = r->h[1];
+	const int16_t *cm = r->c[1], *cp = r->c[3];
+	const int16_t *hm = r->h[0], *hp = r->h[2];
+	/* diagonals of c[i] at d and d + 1, sides of g[i] at k and k + 1 */
+	int d = r->p - 1, k = -r->p;
+	int i, j;
+
+	for (i = start; i < end; i++) {
+		j = i + d;
+		if (method == SOFT_ISP_BILINEAR) {
+			out->cy[i] = (cm[j] + cm[j + 1] + cp[j] + cp[j + 1] +
+				      2) >> 2;
+			out->gx[i] = (c[i + k] + c[i + k + 1] + 1) >> 1;
+			out->gy[i] = (cm[i] + cp[i] + 1) >> 1;
+			continue;
+		}
+
+		out->cy[i] = clamp10(h[i] + ((cm[j] - hm[j] + cm[j + 1] -
+					      hm[j + 1] + cp[j] - hp[j] +
+					      cp[j + 1] - hp[j + 1] + 2) >> 2));
+		out->gx[i] = clamp10(g[i] + ((c[i + k] - h[i + k] +
+					      c[i + k + 1] - h[i + k + 1] +
+					      1) >> 1));
+		out->gy[i] = clamp10(g[i] + ((cm[i] - hm[i] + cp[i] - hp[i] +
+					      1) >> 1));
+	}
+}
+
+static void scalar_accumulate(uint16_t *const acc[3],
+			      const int16_t *const even[3],
+			      const int16_t *const odd[3], int count)
+{
+	int i, k;
+
+	for (k = 0; k < 3; k++) {
+		for (i = 0; i < count; i++)
+			acc[k][i] += even[k][i] + odd[k][i];
+	}
+}
+
+static void scalar_interleave(uint8_t *dst, const int16_t *const even[3],
+			      const int16_t *const odd[3], int count)
+{
+	int i, k;
+
+	for (i = 0; i < count; i++) {
+		for (k = 0; k < 3; k++) {
+			dst[6 * i + k] = even[k][i] >> 2;
+			dst[6 * i + 3 + k] = odd[k][i] >> 2;
+		}
+	}
+}
+
+const struct soft_isp_ops soft_isp_ops_scalar = {
+	.split = scalar_split,
+	.green = scalar_green,
+	.rb = scalar_rb,
+	.accumulate = scalar_accumulate,
+	.interleave = scalar_interleave,
+};
+
+const char *soft_isp_isa_name(enum soft_isp_isa isa)
+{
+	switch (isa) {
+	case SOFT_ISP_SCALAR:
+		return "scalar";
+	case SOFT_ISP_AVX2:
+		return "avx2";
+	default:
+		return "auto";
+	}
+}
+
+int soft_isp_isa_supported(enum soft_isp_isa isa)
+{
+	__builtin_cpu_init();
+
+	switch (isa) {
+	case SOFT_ISP_SCALAR:
+		return 1;
+	case SOFT_ISP_AVX2:
+		return __builtin_cpu_supports("avx2");
+	default:
+		return 0;
+	}
+}
+
+/* Lines past the edges are reflected, keeping their colours */
+static int reflect(int y, int height)
+{
+	if (y < 0)
+		return -y;
+	if (y >= height)
+		return 2 * (height - 1) - y;
+	return y;
+}
+
+static void load_line(struct worker *w, int y)
+{
+	const struct soft_isp *isp = w->isp;
+	int width = isp->cfg.width;
+	int p = isp->p0 ^ (y & 1);
+	int slot = y & (RAW_LINES - 1);
+	uint16_t *line = w->line + LINE_PAD;
+	int k;
+
+	ipu3_unpack_line16(isp->src + reflect(y, isp->cfg.height) *
+			   isp->src_stride, line, width);
+	for (k = 1; k <= LINE_PAD; k++) {
+		line[-k] = line[k];
+		line[width - 1 + k] = line[width - 1 - k];
+	}
+
+	/* pairs from column -LINE_PAD, that is plane index -LINE_PAD / 2 */
+	isp->ops->split(w->line, (p ? w->g[slot] : w->c[slot]) - LINE_PAD / 2,
+			(p ? w->c[slot] : w->g[slot]) - LINE_PAD / 2,
+			isp->half + LINE_PAD);
+}
+
+static void get_rows(const struct worker *w, int y, struct soft_isp_rows *r)
+{
+	int k;
+
+	for (k = 0; k < 5; k++) {
+		r->c[k] = w->c[(y - 2 + k) & (RAW_LINES - 1)];
+		r->g[k] = w->g[(y - 2 + k) & (RAW_LINES - 1)];
+	}
+	for (k = 0; k < 3; k++)
+		r->h[k] = w->h[(y - 1 + k) & (GREEN_LINES - 1)];
+	r->p = w->isp->p0 ^ (y & 1);
+}
+
+/* The red and blue of line y read the green of the c sites around them */
+static void green_line(struct worker *w, int y)
+{
+	const struct soft_isp *isp = w->isp;
+	struct soft_isp_rows r;
+
+	get_rows(w, y, &r);
+	isp->ops->green(&r, w->h[y & (GREEN_LINES - 1)], -1, isp->half + 1,
+			isp->cfg.method);
+}
+
+static void finish_line(const struct soft_isp *isp, struct worker *w,
+			uint8_t *dst)
+{
+	unsigned int i, k;
+
+	/* sums of 4 or 16 10-bit values */
+	if (isp->cfg.scale == 2) {
+		for (i = 0; i < isp->out_width; i++) {
+			for (k = 0; k < 3; k++)
+				dst[3 * i + k] = w->acc[k][i] >> 4;
+		}
+		return;
+	}
+
+	for (i = 0; i < isp->out_width; i++) {
+		for (k = 0; k < 3; k++)
+			dst[3 * i + k] = (w->acc[k][2 * i] +
+					  w->acc[k][2 * i + 1]) >> 6;
+	}
+}
+
+static void output_line(struct worker *w, int y, int y0)
+{
+	const struct soft_isp *isp = w->isp;
+	unsigned int scale = isp->cfg.scale;
+	const int16_t *cs[3], *gs[3];
+	struct soft_isp_rows r;
+	int red, k;
+
+	get_rows(w, y, &r);
+	isp->ops->rb(&r, &w->rb, 0, isp->half, isp->cfg.method);
+
+	red = isp->red0 ^ (y & 1);
+	cs[0] = red ? r.c[2] : w->rb.cy;
+	cs[1] = r.h[1];
+	cs[2] = red ? w->rb.cy : r.c[2];
+	gs[0] = red ? w->rb.gx : w->rb.gy;
+	gs[1] = r.g[2];
+	gs[2] = red ? w->rb.gy : w->rb.gx;
+
+	if (scale == 1) {
+		isp->ops->interleave(isp->dst + y * isp->dst_stride,
+				     r.p ? gs : cs, r.p ? cs : gs, isp->half);
+		return;
+	}
+
+	if ((y - y0) % scale == 0) {
+		for (k = 0; k < 3; k++)
+			memset(w->acc[k], 0, isp->half * sizeof(*w->acc[k]));
+	}
+	isp->ops->accumulate(w->acc, r.p ? gs : cs, r.p ? cs : gs, isp->half);
+	if ((y - y0) % scale == scale - 1)
+		finish_line(isp, w, isp->dst + y / scale * isp->dst_stride);
+}
+
+static void process_band(struct worker *w, unsigned int band)
+{
+	const struct soft_isp *isp = w->isp;
+	int y0 = band * BAND_LINES;
+	int y1 = y0 + BAND_LINES;
+	int y;
+
+	if (y1 > (int)(isp->out_height * isp->cfg.scale))
+		y1 = isp->out_height * isp->cfg.scale;
+
+	for (y = y0 - 3; y < y0 + 3; y++)
+		load_line(w, y);
+	for (y = y0 - 1; y <= y0; y++)
+		green_line(w, y);
+
+	for (y = y0; y < y1; y++) {
+		load_line(w, y + 3);
+		green_line(w, y + 1);
+		output_line(w, y, y0);
+	}
+}
+
+static void run_bands(struct worker *w)
+{
+	struct soft_isp *isp = w->isp;
+	unsigned int band;
+
+	while ((band = __atomic_fetch_add(&isp->next_band, 1,
+					  __ATOMIC_RELAXED)) < isp->bands)
+		process_band(w, band);
+}
+
+static void *worker_thread(void *arg)
+{
+	struct worker *w = arg;
+	struct soft_isp *isp = w->isp;
+
+	for (;;) {
+		pthread_mutex_lock(&isp->lock);
+		while (w->generation == isp->generation && !isp->quit)
+			pthread_cond_wait(&isp->start, &isp->lock);
+		w->generation = isp->generation;
+		if (isp->quit) {
+			pthread_mutex_unlock(&isp->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&isp->lock);
+
+		run_bands(w);
+
+		pthread_mutex_lock(&isp->lock);
+		if (!--isp->busy)
+			pthread_cond_signal(&isp->done);
+		pthread_mutex_unlock(&isp->lock);
+	}
+}
+
+static int worker_init(struct soft_isp *isp, struct worker *w)
+{
+	/* planes: c and g of each raw line, h, cy, gx, gy and acc */
+	size_t planes = 2 * RAW_LINES + GREEN_LINES + 3 + 3;
+	size_t plane = (isp->half + 3 * SOFT_ISP_PAD + 31) & ~31UL;
+	size_t line = isp->cfg.width + 2 * LINE_PAD + 2 * SOFT_ISP_PAD;
+	size_t size = (SOFT_ISP_PAD + planes * plane + line) * 2;
+	int16_t *p;
+	int i;
+
+	w->isp = isp;
+	if (posix_memalign(&w->mem, 64, size))
+		return -1;
+	memset(w->mem, 0, size);
+
+	p = (int16_t *)w->mem + SOFT_ISP_PAD;
+	for (i = 0; i < RAW_LINES; i++, p += 2 * plane) {
+		w->c[i] = p;
+		w->g[i] = p + plane;
+	}
+	for (i = 0; i < GREEN_LINES; i++, p += plane)
+		w->h[i] = p;
+	w->rb.cy = p;
+	w->rb.gx = p + plane;
+	w->rb.gy = p + 2 * plane;
+	p += 3 * plane;
+	for (i = 0; i < 3; i++, p += plane)
+		w->acc[i] = (uint16_t *)p;
+	w->line = (uint16_t *)p;
+
+	return 0;
+}
+
+static const struct {
+	int red;
+	int p;
+} order_line0[] = {
+	[SOFT_ISP_BGGR] = { 0, 0 },
+	[SOFT_ISP_GBRG] = { 0, 1 },
+	[SOFT_ISP_GRBG] = { 1, 1 },
+	[SOFT_ISP_RGGB] = { 1, 0 },
+};
+
+struct soft_isp *soft_isp_create(const struct soft_isp_config *cfg)
+{
+	enum soft_isp_isa isa = cfg->isa;
+	struct soft_isp *isp;
+	unsigned int i;
+	long cpus;
+
+	if (cfg->width < 8 || cfg->width % 2 || cfg->height < 4 ||
+	    cfg->width > 16384 || cfg->height > 16384 || cfg->threads > 256 ||
+	    (cfg->scale != 1 && cfg->scale != 2 && cfg->scale != 4) ||
+	    cfg->order > SOFT_ISP_RGGB || cfg->method > SOFT_ISP_EDGE) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (isa == SOFT_ISP_ISA_AUTO)
+		isa = soft_isp_isa_supported(SOFT_ISP_AVX2) ? SOFT_ISP_AVX2 :
+							      SOFT_ISP_SCALAR;
+	if (!soft_isp_isa_supported(isa)) {
+		errno = ENOTSUP;
+		return NULL;
+	}
+
+	isp = calloc(1, sizeof(*isp));
+	if (!isp)
+		return NULL;
+
+	isp->cfg = *cfg;
+	isp->cfg.isa = isa;
+	isp->ops = isa == SOFT_ISP_AVX2 ? &soft_isp_ops_avx2 :
+					  &soft_isp_ops_scalar;
+	if (!isp->cfg.threads) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		isp->cfg.threads = cpus > 0 ? cpus : 1;
+	}
+	isp->half = cfg->width / 2;
+	isp->out_width = cfg->width / cfg->scale;
+	isp->out_height = cfg->height / cfg->scale;
+	isp->bands = (isp->out_height * cfg->scale + BAND_LINES - 1) /
+		     BAND_LINES;
+	isp->red0 = order_line0[cfg->order].red;
+	isp->p0 = order_line0[cfg->order].p;
+
+	pthread_mutex_init(&isp->lock, NULL);
+	pthread_cond_init(&isp->start, NULL);
+	pthread_cond_init(&isp->done, NULL);
+
+	isp->workers = calloc(isp->cfg.threads, sizeof(*isp->workers));
+	if (!isp->workers)
+		goto err;
+	for (i = 0; i < isp->cfg.threads; i++) {
+		if (worker_init(isp, &isp->workers[i]))
+			goto err;
+	}
+	for (i = 1; i < isp->cfg.threads; i++) {
+		if (pthread_create(&isp->workers[i].thread, NULL, worker_thread,
+				   &isp->workers[i]))
+			goto err;
+		isp->workers_started++;
+	}
+
+	return isp;
+
+err:
+	soft_isp_destroy(isp);
+	errno = ENOMEM;
+	return NULL;
+}
+
+void soft_isp_destroy(struct soft_isp *isp)
+{
+	unsigned int i;
+
+	if (!isp)
+		return;
+
+	pthread_mutex_lock(&isp->lock);
+	isp->quit = 1;
+	pthread_cond_broadcast(&isp->start);
+	pthread_mutex_unlock(&isp->lock);
+	for (i = 0; i < isp->workers_started; i++)
+		pthread_join(isp->workers[i + 1].thread, NULL);
+
+	if (isp->workers) {
+		for (i = 0; i < isp->cfg.threads; i++)
+			free(isp->workers[i].mem);
+		free(isp->workers);
+	}
+	pthread_cond_destroy(&isp->done);
+	pthread_cond_destroy(&isp->start);
+	pthread_mutex_destroy(&isp->lock);
+	free(isp);
+}
+
+void soft_isp_output_size(const struct soft_isp *isp, unsigned int *width,
+			  unsigned int *height)
+{
+	*width = isp->out_width;
+	*height = isp->out_height;
+}
+
+void soft_isp_process(struct soft_isp *isp, const uint8_t *src,
+		      size_t src_stride, uint8_t *dst, size_t dst_stride)
+{
+	pthread_mutex_lock(&isp->lock);
+	isp->src = src;
+	isp->src_stride = src_stride;
+	isp->dst = dst;
+	isp->dst_stride = dst_stride;
+	isp->next_band = 0;
+	isp->busy = isp->cfg.threads - 1;
+	isp->generation++;
+	pthread_cond_broadcast(&isp->start);
+	pthread_mutex_unlock(&isp->lock);
+
+	run_bands(&isp->workers[0]);
+
+	pthread_mutex_lock(&isp->lock);
+	while (isp->busy)
+		pthread_cond_wait(&isp->done, &isp->lock);
+	pthread_mutex_unlock(&isp->lock);
+}
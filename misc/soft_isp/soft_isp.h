@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Software ISP for previews without the ImgU: demosaics the IPU3 packed
+ * 10-bit Bayer frames of the CIO2 to RGB24, optionally downscaled by 2 or
+ * 4, in one pass over the frame.
+ *
+ * The frame is split in bands of lines that the threads take in turn.
+ * Each line is unpacked once into a few lines of planes that stay in the
+ * caches, where it is demosaiced and, when downscaling, averaged into the
+ * output line. The output is linear: no black level, white balance or
+ * gamma.
+ */
+#ifndef SOFT_ISP_H
+#define SOFT_ISP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum soft_isp_order {
+	SOFT_ISP_BGGR,
+	SOFT_ISP_GBRG,
+	SOFT_ISP_GRBG,
+	SOFT_ISP_RGGB,
+};
+
+enum soft_isp_method {
+	/* average of the nearest pixels of each colour */
+	SOFT_ISP_BILINEAR,
+	/*
+	 * green along the direction with the smaller gradient
+	 * (Hamilton-Adams), red and blue from their difference with green
+	 */
+	SOFT_ISP_EDGE,
+};
+
+enum soft_isp_isa {
+	SOFT_ISP_ISA_AUTO = -1,
+	SOFT_ISP_SCALAR,
+	SOFT_ISP_AVX2,
+};
+
+struct soft_isp_config {
+	unsigned int width;		/* even */
+	unsigned int height;
+	enum soft_isp_order order;
+	enum soft_isp_method method;
+	unsigned int scale;		/* 1, 2 or 4 */
+	unsigned int threads;		/* 0 for one per CPU */
+	enum soft_isp_isa isa;
+};
+
+struct soft_isp;
+
+/* Return NULL with errno set if @cfg isn't valid or on allocation failure */
+struct soft_isp *soft_isp_create(const struct soft_isp_config *cfg);
+void soft_isp_destroy(struct soft_isp *isp);
+
+/* Size of the output, @width / scale x @height / scale */
+void soft_isp_output_size(const struct soft_isp *isp, unsigned int *width,
+			  unsigned int *height);
+
+/*
+ * Process a frame of @src (packed lines, @src_stride apart) to @dst (RGB24
+ * lines, @dst_stride apart), using all the threads. Not reentrant.
+ */
+void soft_isp_process(struct soft_isp *isp, const uint8_t *src,
+		      size_t src_stride, uint8_t *dst, size_t dst_stride);
+
+const char *soft_isp_isa_name(enum soft_isp_isa isa);
+int soft_isp_isa_supported(enum soft_isp_isa isa);
+
+#endif /* SOFT_ISP_H */
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * AVX2 kernels of the software ISP, 16 values of a plane at a time. They
+ * do the same 16-bit integer operations as the scalar ones in soft_isp.c,
+ * so the results are the same. Built with -mavx2.
+ */
+
+#include <immintrin.h>
+#include "soft_isp_priv.h"
+
+#define LOAD(p)		_mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p, v)	_mm256_storeu_si256((__m256i *)(p), (v))
+
+static inline __m256i clamp10(__m256i v)
+{
+	return _mm256_min_epi16(_mm256_max_epi16(v, _mm256_setzero_si256()),
+				_mm256_set1_epi16(1023));
+}
+
+/* (a + b + 1) >> 1 and (a + b + c + d + 2) >> 2, signed */
+static inline __m256i avg2(__m256i a, __m256i b)
+{
+	return _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b),
+						  _mm256_set1_epi16(1)), 1);
+}
+
+static inline __m256i avg4(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+	return _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(a, b),
+						  _mm256_add_epi16(_mm256_add_epi16(c, d),
+								   _mm256_set1_epi16(2))), 2);
+}
+
+static void avx2_split(const uint16_t *line, int16_t *even, int16_t *odd,
+		       int count)
+{
+	const __m256i low = _mm256_set1_epi32(0xffff);
+	__m256i v0, v1;
+	int i;
+
+	/* packus works within each 128-bit lane, the permute puts them back */
+	for (i = 0; i < count; i += 16) {
+		v0 = LOAD(line + 2 * i);
+		v1 = LOAD(line + 2 * i + 16);
+		STORE(even + i, _mm256_permute4x64_epi64(
+			_mm256_packus_epi32(_mm256_and_si256(v0, low),
+					    _mm256_and_si256(v1, low)), 0xd8));
+		STORE(odd + i, _mm256_permute4x64_epi64(
+			_mm256_packus_epi32(_mm256_srli_epi32(v0, 16),
+					    _mm256_srli_epi32(v1, 16)), 0xd8));
+	}
+}
+
+static void avx2_green(const struct soft_isp_rows *r, int16_t *h, int start,
+		       int end, enum soft_isp_method method)
+{
+	const int16_t *c = r->c[2], *nn = r->c[0], *ss = r->c[4];
+	const int16_t *w = r->g[2] + r->p - 1, *e = r->g[2] + r->p;
+	const int16_t *n = r->g[1], *s = r->g[3];
+	const __m256i two = _mm256_set1_epi16(2);
+	__m256i vc, vw, ve, vn, vs, c2, lh, lv, gh, gv, dh, dv, res;
+	int i;
+
+	if (method == SOFT_ISP_BILINEAR) {
+		for (i = start; i < end; i += 16)
+			STORE(h + i, avg4(LOAD(w + i), LOAD(e + i),
+					  LOAD(n + i), LOAD(s + i)));
+		return;
+	}
+
+	for (i = start; i < end; i += 16) {
+		vc = LOAD(c + i);
+		vw = LOAD(w + i);
+		ve = LOAD(e + i);
+		vn = LOAD(n + i);
+		vs = LOAD(s + i);
+
+		c2 = _mm256_add_epi16(vc, vc);
+		lh = _mm256_sub_epi16(_mm256_sub_epi16(c2, LOAD(c + i - 1)),
+				      LOAD(c + i + 1));
+		lv = _mm256_sub_epi16(_mm256_sub_epi16(c2, LOAD(nn + i)),
+				      LOAD(ss + i));
+		gh = _mm256_slli_epi16(_mm256_add_epi16(vw, ve), 1);
+		gh = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(gh, lh),
+							two), 2);
+		gv = _mm256_slli_epi16(_mm256_add_epi16(vn, vs), 1);
+		gv = _mm256_srai_epi16(_mm256_add_epi16(_mm256_add_epi16(gv, lv),
+							two), 2);
+		dh = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(vw, ve)),
+				      _mm256_abs_epi16(lh));
+		dv = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(vn, vs)),
+				      _mm256_abs_epi16(lv));
+
+		/* the average, else gv where dv < dh, else gh where dh < dv */
+		res = _mm256_blendv_epi8(avg2(gh, gv), gv,
+					 _mm256_cmpgt_epi16(dh, dv));
+		res = _mm256_blendv_epi8(res, gh, _mm256_cmpgt_epi16(dv, dh));
+		STORE(h + i, clamp10(res));
+	}
+}
+
+/* The differences between colour and green of @x and @y */
+static inline __m256i diff2(const int16_t *cx, const int16_t *hx,
+			    const int16_t *cy, const int16_t *hy)
+{
+	return _mm256_add_epi16(_mm256_sub_epi16(LOAD(cx), LOAD(hx)),
+				_mm256_sub_epi16(LOAD(cy), LOAD(hy)));
+}
+
+static void avx2_rb(const struct soft_isp_rows *r,
+		    const struct soft_isp_rb *out, int start, int end,
+		    enum soft_isp_method method)
+{
+	const int16_t *c = r->c[2], *g = r->g[2], *h = r->h[1];
+	const int16_t *cm = r->c[1], *cp = r->c[3];
+	const int16_t *hm = r->h[0], *hp = r->h[2];
+	const __m256i one = _mm256_set1_epi16(1);
+	const __m256i two = _mm256_set1_epi16(2);
+	int d = r->p - 1, k = -r->p;
+	__m256i v;
+	int i, j;
+
+	if (method == SOFT_ISP_BILINEAR) {
+		for (i = start; i < end; i += 16) {
+			j = i + d;
+			STORE(out->cy + i, avg4(LOAD(cm + j), LOAD(cm + j + 1),
+						LOAD(cp + j), LOAD(cp + j + 1)));
+			STORE(out->gx + i, avg2(LOAD(c + i + k),
+						LOAD(c + i + k + 1)));
+			STORE(out->gy + i, avg2(LOAD(cm + i), LOAD(cp + i)));
+		}
+		return;
+	}
+
+	for (i = start; i < end; i += 16) {
+		j = i + d;
+		v = _mm256_add_epi16(diff2(cm + j, hm + j, cm + j + 1,
+					   hm + j + 1),
+				     diff2(cp + j, hp + j, cp + j + 1,
+					   hp + j + 1));
+		v = _mm256_srai_epi16(_mm256_add_epi16(v, two), 2);
+		STORE(out->cy + i, clamp10(_mm256_add_epi16(LOAD(h + i), v)));
+
+		v = diff2(c + i + k, h + i + k, c + i + k + 1, h + i + k + 1);
+		v = _mm256_srai_epi16(_mm256_add_epi16(v, one), 1);
+		STORE(out->gx + i, clamp10(_mm256_add_epi16(LOAD(g + i), v)));
+
+		v = diff2(cm + i, hm + i, cp + i, hp + i);
+		v = _mm256_srai_epi16(_mm256_add_epi16(v, one), 1);
+		STORE(out->gy + i, clamp10(_mm256_add_epi16(LOAD(g + i), v)));
+	}
+}
+
+static void avx2_accumulate(uint16_t *const acc[3],
+			    const int16_t *const even[3],
+			    const int16_t *const odd[3], int count)
+{
+	int i, k;
+
+	for (k = 0; k < 3; k++) {
+		for (i = 0; i < count; i += 16)
+			STORE(acc[k] + i, _mm256_add_epi16(LOAD(acc[k] + i),
+				_mm256_add_epi16(LOAD(even[k] + i),
+						 LOAD(odd[k] + i))));
+	}
+}
+
+/*
+ * Where the bytes of RGB24 output block b (16 bytes) come from in the
+ * red, green and blue of 16 pixels, in both lanes
+ */
+#define NO -1
+#define RGB24_SHUFFLE(...)	_mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+static void avx2_interleave(uint8_t *dst, const int16_t *const even[3],
+			    const int16_t *const odd[3], int count)
+{
+	const __m256i shuffle[3][3] = {
+		{
+			RGB24_SHUFFLE(0, NO, NO, 1, NO, NO, 2, NO, NO, 3, NO, NO, 4, NO, NO, 5),
+			RGB24_SHUFFLE(NO, 0, NO, NO, 1, NO, NO, 2, NO, NO, 3, NO, NO, 4, NO, NO),
+			RGB24_SHUFFLE(NO, NO, 0, NO, NO, 1, NO, NO, 2, NO, NO, 3, NO, NO, 4, NO),
+		}, {
+			RGB24_SHUFFLE(NO, NO, 6, NO, NO, 7, NO, NO, 8, NO, NO, 9, NO, NO, 10, NO),
+			RGB24_SHUFFLE(5, NO, NO, 6, NO, NO, 7, NO, NO, 8, NO, NO, 9, NO, NO, 10),
+			RGB24_SHUFFLE(NO, 5, NO, NO, 6, NO, NO, 7, NO, NO, 8, NO, NO, 9, NO, NO),
+		}, {
+			RGB24_SHUFFLE(NO, 11, NO, NO, 12, NO, NO, 13, NO, NO, 14, NO, NO, 15, NO, NO),
+			RGB24_SHUFFLE(NO, NO, 11, NO, NO, 12, NO, NO, 13, NO, NO, 14, NO, NO, 15, NO),
+			RGB24_SHUFFLE(10, NO, NO, 11, NO, NO, 12, NO, NO, 13, NO, NO, 14, NO, NO, 15),
+		},
+	};
+	__m256i ch[3], e, o, out;
+	int i, b, k;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		/*
+		 * 8 bits of the 32 pixels of each colour, in order: pixels
+		 * 0-15 in the low lane and 16-31 in the high one
+		 */
+		for (k = 0; k < 3; k++) {
+			e = _mm256_srli_epi16(LOAD(even[k] + i), 2);
+			o = _mm256_srli_epi16(LOAD(odd[k] + i), 2);
+			ch[k] = _mm256_packus_epi16(_mm256_unpacklo_epi16(e, o),
+						    _mm256_unpackhi_epi16(e, o));
+		}
+
+		for (b = 0; b < 3; b++) {
+			out = _mm256_or_si256(
+				_mm256_or_si256(_mm256_shuffle_epi8(ch[0], shuffle[b][0]),
+						_mm256_shuffle_epi8(ch[1], shuffle[b][1])),
+				_mm256_shuffle_epi8(ch[2], shuffle[b][2]));
+			_mm_storeu_si128((__m128i *)(dst + 6 * i + 16 * b),
+					 _mm256_castsi256_si128(out));
+			_mm_storeu_si128((__m128i *)(dst + 6 * i + 48 + 16 * b),
+					 _mm256_extracti128_si256(out, 1));
+		}
+	}
+
+	/* the output line has no room past its end */
+	for (; i < count; i++) {
+		for (k = 0; k < 3; k++) {
+			dst[6 * i + k] = even[k][i] >> 2;
+			dst[6 * i + 3 + k] = odd[k][i] >> 2;
+		}
+	}
+}
+
+#undef NO
+
+const struct soft_isp_ops soft_isp_ops_avx2 = {
+	.split = avx2_split,
+	.green = avx2_green,
+	.rb = avx2_rb,
+	.accumulate = avx2_accumulate,
+	.interleave = avx2_interleave,
+};
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * The per-line kernels of soft_isp.c and what they work on.
+ *
+ * A Bayer line is split in two planes of width / 2 values: the sites of
+ * its red or blue pixels ("c") and those of its green pixels ("g"). Pair i
+ * of a line is the pixels at columns 2i and 2i + 1, and p says which one
+ * is c. The lines above and below have the other colour at the other
+ * columns, so their g[i] and c[i] are right above c[i] and g[i] of this
+ * line, and a kernel only has to offset its reads by p.
+ */
+#ifndef SOFT_ISP_PRIV_H
+#define SOFT_ISP_PRIV_H
+
+#include "soft_isp.h"
+
+/*
+ * The SIMD kernels work on 16 values at a time and may compute up to 15
+ * values past @end. The planes have room for this and for the reads
+ * around it, up to SOFT_ISP_PAD values before and after.
+ */
+#define SOFT_ISP_PAD	32
+
+struct soft_isp_rows {
+	const int16_t *c[5];	/* c planes of the lines y - 2 to y + 2 */
+	const int16_t *g[5];	/* g planes */
+	const int16_t *h[3];	/* green at the c sites, y - 1 to y + 1 */
+	int p;			/* 1 if the c sites of line y are odd */
+};
+
+/* Demosaiced values of line y that aren't in its planes */
+struct soft_isp_rb {
+	int16_t *cy;		/* other colour at the c sites */
+	int16_t *gx;		/* colour of the line at the g sites */
+	int16_t *gy;		/* other colour at the g sites */
+};
+
+struct soft_isp_ops {
+	/* pixel 2i of @line to @even[i], 2i + 1 to @odd[i], i < @count */
+	void (*split)(const uint16_t *line, int16_t *even, int16_t *odd,
+		      int count);
+	/* h[1][i] from the c and g planes, @start <= i < @end */
+	void (*green)(const struct soft_isp_rows *r, int16_t *h, int start,
+		      int end, enum soft_isp_method method);
+	void (*rb)(const struct soft_isp_rows *r, const struct soft_isp_rb *out,
+		   int start, int end, enum soft_isp_method method);
+	/* acc[k][i] += even[k][i] + odd[k][i], for R, G and B */
+	void (*accumulate)(uint16_t *const acc[3], const int16_t *const even[3],
+			   const int16_t *const odd[3], int count);
+	/* RGB24 of pixels 2i and 2i + 1, 8 most significant bits */
+	void (*interleave)(uint8_t *dst, const int16_t *const even[3],
+			   const int16_t *const odd[3], int count);
+};
+
+extern const struct soft_isp_ops soft_isp_ops_scalar;
+extern const struct soft_isp_ops soft_isp_ops_avx2;
+
+#endif /* SOFT_ISP_PRIV_H */
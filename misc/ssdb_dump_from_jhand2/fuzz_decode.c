@@ -0,0 +1,287 @@
+/**
+ * libFuzzer harness for the SSDB/CLDB/DSMB decoders: the field tables and
+ * range checks of ipu_acpi_fields.h, shared with dump_intel_ipu_data and
+ * acpi_table_analyzer, and the hex dump parsing, type detection, checking
+ * and printing of ssdb_dump.
+ *
+ * Built with clang (`make fuzz_decode`), this is a regular libFuzzer
+ * target. Without clang, `make fuzz_decode_standalone` builds the same
+ * entry point with a small driver that throws random, mutated and
+ * truncated blobs at it.
+ */
+
+#define SSDB_DUMP_NO_MAIN
+#include "ssdb_dump.c"
+
+static FILE *null_out;
+static volatile uint32_t sink;
+
+static void walk_fields(const struct ipu_field *table, const uint8_t *data,
+			size_t len) {
+	const struct ipu_field *f;
+	uint32_t val;
+
+	ipu_for_each_field(f, table, len) {
+		if (f->kind == IPU_FIELD_BYTES) {
+			sink += data[f->offset + f->size - 1];
+			continue;
+		}
+
+		val = ipu_field_value(f, data);
+		sink += ipu_field_valid(f, val);
+		if (ipu_field_value_name(f, val))
+			sink++;
+	}
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	static uint8_t text_blob[TEXT_BLOB_MAX];
+	const struct blob_type *t;
+	const uint8_t *blob = data;
+	size_t len = size;
+
+	/* every table on the input as is, whatever its length */
+	for (t = blob_types; t->name; t++) {
+		walk_fields(t->fields, data, size);
+		sink += check_blob(NULL, t, data, size);
+	}
+
+	/* what ssdb_dump does with a file */
+	t = load_blob(NULL, &blob, &len, text_blob);
+	if (!t)
+		return 0;
+	sink += check_blob(NULL, t, blob, len);
+
+	/* printing is slow, only do it for some inputs */
+	if (size % 8 == 0) {
+		if (!null_out)
+			null_out = fopen("/dev/null", "w");
+		format = size / 8 % 3;
+		if (null_out)
+			print_blob(null_out, "fuzz", t, blob, len);
+	}
+
+	return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+#include <time.h>
+
+#define INPUT_MAX	1024
+
+/* DSMB of the Surface Go 2 LNK1 */
+static uint8_t sgo2_lnk1_dsmb[] = {
+	0x01, 0x00, 0x00, 0x00, 0x0b, 0x4d, 0x00, 0x02,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00,
+};
+
+static const struct {
+	const uint8_t *data;
+	size_t len;
+} seeds[] = {
+	{ sb2_camr_ssdb, sizeof(sb2_camr_ssdb) },
+	{ sb2_cam3_ssdb, sizeof(sb2_cam3_ssdb) },
+	{ sgo2_lnk0_ssdb, sizeof(sgo2_lnk0_ssdb) },
+	{ sgo2_lnk2_ssdb, sizeof(sgo2_lnk2_ssdb) },
+	{ sb2_camr_skc0_cldb, sizeof(sb2_camr_skc0_cldb) },
+	{ sgo2_lnk0_lnk2_clp0_cldb, sizeof(sgo2_lnk0_lnk2_clp0_cldb) },
+	{ sgo2_lnk1_dsmb, sizeof(sgo2_lnk1_dsmb) },
+};
+
+#define SEED_COUNT (sizeof(seeds) / sizeof(seeds[0]))
+
+/* xorshift64, so that a run can be repeated with -s */
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rnd(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static char *put_hex(char *p, uint32_t val, int digits) {
+	static const char hex[] = "0123456789abcdef";
+
+	while (digits--)
+		*p++ = hex[(val >> (4 * digits)) & 0xf];
+	return p;
+}
+
+/*
+ * Write @data as a hex dump in the iasl or print_hex_dump() format. @out
+ * must hold 8 bytes per input byte plus 32.
+ */
+static size_t to_text(char *out, const uint8_t *data, size_t len) {
+	int iasl = rnd() & 1;
+	char *p = out;
+	size_t i;
+
+	if (iasl) {
+		memcpy(p, "Buffer (0x", 10);
+		p = put_hex(p + 10, len, 2);
+		memcpy(p, ")\n{", 3);
+		p += 3;
+	}
+	for (i = 0; i < len; i++) {
+		if (i % 16 == 0) {
+			*p++ = '\n';
+			if (iasl) {
+				memcpy(p, "/* ", 3);
+				p = put_hex(p + 3, i, 4);
+				memcpy(p, " */", 3);
+				p += 3;
+			} else {
+				p = put_hex(p, i, 8);
+				*p++ = ':';
+			}
+		}
+		*p++ = ' ';
+		if (iasl) {
+			*p++ = '0';
+			*p++ = 'x';
+		}
+		p = put_hex(p, data[i], 2);
+		if (iasl)
+			*p++ = ',';
+	}
+	if (iasl) {
+		memcpy(p, "\n}\n", 3);
+		p += 3;
+	}
+
+	return p - out;
+}
+
+static size_t make_input(uint8_t *buf) {
+	static const uint32_t interesting[] = {
+		0, 1, 2, 3, 4, 5, 0x7f, 0x80, 0xff, 0xffff, 0xffffffff,
+	};
+	const uint8_t *seed;
+	uint32_t val;
+	size_t len, i, n;
+
+	i = rnd() % SEED_COUNT;
+	seed = seeds[i].data;
+	len = seeds[i].len;
+
+	switch (rnd() % 5) {
+	case 0:
+		/* random bytes, mostly around the known sizes */
+		len = rnd() % 160;
+		for (i = 0; i < len; i++)
+			buf[i] = rnd();
+		return len;
+	case 1:
+		/* a few flipped bytes */
+		memcpy(buf, seed, len);
+		for (n = rnd() % 4 + 1; n; n--)
+			buf[rnd() % len] = rnd();
+		return len;
+	case 2:
+		/* truncated */
+		memcpy(buf, seed, len);
+		return rnd() % len;
+	case 3:
+		/* boundary values at random offsets */
+		memcpy(buf, seed, len);
+		for (n = rnd() % 3 + 1; n; n--) {
+			val = interesting[rnd() %
+					  (sizeof(interesting) /
+					   sizeof(interesting[0]))];
+			i = rnd() % len;
+			memcpy(buf + i, &val, len - i < 4 ? len - i : 4);
+		}
+		return len;
+	default:
+		/* hex dump, truncated or with a broken character */
+		n = to_text((char *)buf, seed, len);
+		if (rnd() & 1)
+			buf[rnd() % n] = rnd() % 0x5f + 0x20;
+		if (rnd() & 1)
+			n = rnd() % n;
+		return n;
+	}
+}
+
+static int run_file(const char *path) {
+	uint8_t *data;
+	size_t len;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	data = malloc(INPUT_MAX * 64);
+	if (!data) {
+		fclose(f);
+		return -1;
+	}
+	len = fread(data, 1, INPUT_MAX * 64, f);
+	fclose(f);
+
+	LLVMFuzzerTestOneInput(data, len);
+	free(data);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	unsigned long long runs = 10000000, i;
+	uint8_t buf[INPUT_MAX], *data;
+	struct timespec start, stop;
+	double secs;
+	size_t len;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = strtoull(optarg, NULL, 0);
+			break;
+		case 's':
+			rng_state = strtoull(optarg, NULL, 0) | 1;
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-n <runs>] [-s <seed>] [file...]\n"
+				"  files are run once each, to reproduce a crash\n",
+				argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind < argc) {
+		for (; optind < argc; optind++) {
+			if (run_file(argv[optind]))
+				return 1;
+		}
+		return 0;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < runs; i++) {
+		len = make_input(buf);
+		/* exact size, so that the sanitizers see any over-read */
+		data = malloc(len ? len : 1);
+		if (!data)
+			return 1;
+		memcpy(data, buf, len);
+		LLVMFuzzerTestOneInput(data, len);
+		free(data);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	secs = stop.tv_sec - start.tv_sec +
+	       (stop.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "%llu inputs in %.2f s (%.0f/s)\n", runs, secs,
+		runs / secs);
+	return 0;
+}
+#endif /* FUZZ_STANDALONE */
@@ -1,84 +1,721 @@
 /**
- * This tool parses the SSDB fields and dumps many of the fields.
+ * This tool parses the SSDB, CLDB and DSMB fields and dumps them.
+ *
+ * Without arguments, it dumps the samples hardcoded in ssdb_dump.h.
+ * Otherwise it decodes blob files (raw binary, or a hex dump as printed by
+ * iasl, acpiexec or print_hex_dump()), directories of them or stdin, and
+ * prints them as text, CSV or JSON. Files are decoded in parallel.
  */
 
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ipu_acpi_fields.h"
 #include "ssdb_dump.h"
 
-void dump_ssdb(uint8_t *data) {
-	struct intel_ssdb *d =
-		(struct intel_ssdb *)data;
+/* Largest blob accepted from a hex dump */
+#define TEXT_BLOB_MAX	4096
 
-	printf("========== %s() ==========\n", __func__);
+enum output_format {
+	OUTPUT_TEXT,
+	OUTPUT_CSV,
+	OUTPUT_JSON,
+};
 
-	printf("lanes_clock_division: %d\n", d->lanes_clock_division);
-	printf("link_used: %d\n", d->link_used);
-	printf("lanes_used: %d\n", d->lanes_used);
-	printf("vcm_type: %d\n", d->vcm_type);
-	printf("flash_support: %d\n", d->flash_support);
-	printf("degree: %d\n", d->degree);
-	printf("mclk_port: %d\n", d->mclk_port);
-	printf("mclk_speed: %d\n", d->mclk_speed);
-
-	printf("/* Additional data */\n");
-	printf("lanes_clock_division: %d\n", d->lanes_clock_division);
-	printf("rom_type: %d\n", d->rom_type);
-	printf("privacy_led: %d\n", d->privacy_led);
-	printf("mipi_define: %d\n", d->mipi_define);
-	printf("control_logic_id: %d\n", d->control_logic_id);
+struct blob_type {
+	const char *name;
+	const struct ipu_field *fields;
+	size_t size;
+	/* check the header once the length matched */
+	int (*match)(const uint8_t *data);
+};
 
-	printf("\n");
+static int match_ssdb(const uint8_t *data) {
+	const struct intel_ssdb *d = (const struct intel_ssdb *)data;
+
+	return d->version <= 1;
 }
 
-void dump_cldb(uint8_t *data) {
-	struct intel_cldb *d =
-		(struct intel_cldb *)data;
+static int match_cldb(const uint8_t *data) {
+	const struct intel_cldb *d = (const struct intel_cldb *)data;
 
-	printf("========== %s() ==========\n", __func__);
+	return d->version <= 1 && d->control_logic_type <= PMIC_TYPE_UP6641;
+}
+
+static int match_dsmb(const uint8_t *data) {
+	const struct intel_dsmb *d = (const struct intel_dsmb *)data;
+
+	return d->entry_count <=
+	       sizeof(d->entries) / sizeof(d->entries[0]);
+}
+
+static const struct blob_type blob_types[] = {
+	{ "SSDB", intel_ssdb_fields, sizeof(struct intel_ssdb), match_ssdb },
+	{ "CLDB", intel_cldb_fields, sizeof(struct intel_cldb), match_cldb },
+	{ "DSMB", intel_dsmb_fields, sizeof(struct intel_dsmb), match_dsmb },
+	{ NULL },
+};
+
+static enum output_format format = OUTPUT_TEXT;
+static const struct blob_type *forced_type;
+
+static void print_hex(FILE *out, const uint8_t *data, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		fprintf(out, "%02x", data[i]);
+}
+
+void dump_fields(FILE *out, const struct ipu_field *table, const uint8_t *data,
+		 size_t len) {
+	const struct ipu_field *f;
+	const char *name;
+	uint32_t val;
+
+	ipu_for_each_field(f, table, len) {
+		if (f->kind == IPU_FIELD_BYTES) {
+			fprintf(out, "%s: ", f->name);
+			print_hex(out, data + f->offset, f->size);
+			fprintf(out, "\n");
+			continue;
+		}
+
+		val = ipu_field_value(f, data);
+		fprintf(out, "%s: %u", f->name, val);
+		name = ipu_field_value_name(f, val);
+		if (name)
+			fprintf(out, " (%s)", name);
+		if (!ipu_field_valid(f, val))
+			fprintf(out, " (out of range)");
+		fprintf(out, "\n");
+	}
+}
 
-	printf("version: %d\n", d->version);
-	printf("control_logic_type: %d\n", d->control_logic_type);
-	printf("control_logic_id: %d\n", d->control_logic_id);
-	printf("sensor_card_sku: %d\n", d->sensor_card_sku);
+void dump_ssdb(uint8_t *data, size_t len) {
+	printf("========== %s() ==========\n", __func__);
+	dump_fields(stdout, intel_ssdb_fields, data, len);
+	printf("\n");
+}
 
+void dump_cldb(uint8_t *data, size_t len) {
+	printf("========== %s() ==========\n", __func__);
+	dump_fields(stdout, intel_cldb_fields, data, len);
 	printf("\n");
 }
 
-int main() {
+/* Dump the blobs hardcoded in ssdb_dump.h */
+void dump_samples(void) {
 	/* SB2 */
 	printf("-------------------- SB2 CAMR --------------------\n");
-	dump_ssdb(sb2_camr_ssdb);
-	dump_cldb(sb2_camr_skc0_cldb);
+	dump_ssdb(sb2_camr_ssdb, sizeof(sb2_camr_ssdb));
+	dump_cldb(sb2_camr_skc0_cldb, sizeof(sb2_camr_skc0_cldb));
 	printf("-------------------- SB2 CAMF --------------------\n");
-	dump_ssdb(sb2_camf_ssdb);
-	dump_cldb(sb2_camf_skc1_cldb);
+	dump_ssdb(sb2_camf_ssdb, sizeof(sb2_camf_ssdb));
+	dump_cldb(sb2_camf_skc1_cldb, sizeof(sb2_camf_skc1_cldb));
 	printf("-------------------- SB2 CAM3 --------------------\n");
-	dump_ssdb(sb2_cam3_ssdb);
-	dump_cldb(sb2_cam3_skc2_cldb);
+	dump_ssdb(sb2_cam3_ssdb, sizeof(sb2_cam3_ssdb));
+	dump_cldb(sb2_cam3_skc2_cldb, sizeof(sb2_cam3_skc2_cldb));
 
 	/* SB1 */
 	printf("-------------------- SB1 CAMR --------------------\n");
-	dump_ssdb(sb1_camr_ssdb);
-	dump_cldb(sb1_camr_skc0_cldb);
+	dump_ssdb(sb1_camr_ssdb, sizeof(sb1_camr_ssdb));
+	dump_cldb(sb1_camr_skc0_cldb, sizeof(sb1_camr_skc0_cldb));
 	printf("-------------------- SB1 CAMF --------------------\n");
-	dump_ssdb(sb1_camf_ssdb);
-	dump_cldb(sb1_camf_skc1_cldb);
+	dump_ssdb(sb1_camf_ssdb, sizeof(sb1_camf_ssdb));
+	dump_cldb(sb1_camf_skc1_cldb, sizeof(sb1_camf_skc1_cldb));
 	printf("-------------------- SB1 CAM3 --------------------\n");
-	dump_ssdb(sb1_cam3_ssdb);
-	dump_cldb(sb1_cam3_skc2_cldb);
+	dump_ssdb(sb1_cam3_ssdb, sizeof(sb1_cam3_ssdb));
+	dump_cldb(sb1_cam3_skc2_cldb, sizeof(sb1_cam3_skc2_cldb));
 
 	/* SGO2 */
 	printf("-------------------- SGO2 LNK0 --------------------\n");
-	dump_ssdb(sgo2_lnk0_ssdb);
+	dump_ssdb(sgo2_lnk0_ssdb, sizeof(sgo2_lnk0_ssdb));
 	printf("-------------------- SGO2 LNK1 --------------------\n");
-	dump_ssdb(sgo2_lnk1_ssdb);
+	dump_ssdb(sgo2_lnk1_ssdb, sizeof(sgo2_lnk1_ssdb));
 	printf("-------------------- SGO2 LNK2 --------------------\n");
-	dump_ssdb(sgo2_lnk2_ssdb);
+	dump_ssdb(sgo2_lnk2_ssdb, sizeof(sgo2_lnk2_ssdb));
 	printf("-------------------- SGO2 LNK0/LNK2 CLDB --------------------\n");
-	dump_cldb(sgo2_lnk0_lnk2_clp0_cldb);
+	dump_cldb(sgo2_lnk0_lnk2_clp0_cldb, sizeof(sgo2_lnk0_lnk2_clp0_cldb));
 	printf("-------------------- SGO2 LNK1 CLDB --------------------\n");
-	dump_cldb(sgo2_lnk1_dsc1_cldb);
+	dump_cldb(sgo2_lnk1_dsc1_cldb, sizeof(sgo2_lnk1_dsc1_cldb));
+
+}
+
+static const struct blob_type *detect_type(const uint8_t *data, size_t len) {
+	const struct blob_type *t;
+
+	if (forced_type)
+		return forced_type;
+
+	for (t = blob_types; t->name; t++) {
+		if (len == t->size && t->match(data))
+			return t;
+	}
+
+	return NULL;
+}
+
+/* Binary blobs always have control characters (at least a zero byte) */
+static int is_text(const uint8_t *data, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (data[i] < 0x20 && !isspace(data[i]))
+			return 0;
+		if (data[i] >= 0x7f)
+			return 0;
+	}
+
+	return len > 0;
+}
+
+static int hex_digit(char c) {
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	c = tolower(c);
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+static int is_hex(const char *s, size_t len) {
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (hex_digit(s[i]) < 0)
+			return 0;
+	}
+
+	return len > 0;
+}
+
+/*
+ * Collect the bytes of a hex dump:
+ * - "0x00, 0x20, ..." as in iasl output or ssdb_dump.h, only inside the
+ *   first { } if there is one, to skip "Buffer (0x6C)"
+ * - "00000010: 00 20 ..." as printed by print_hex_dump() or acpiexec,
+ *   where the ASCII column after the bytes is ignored
+ * Comments are skipped.
+ *
+ * Return the number of bytes, or -1 if it doesn't fit in @size.
+ */
+static int parse_hex_text(const char *p, size_t len, uint8_t *out,
+			  size_t size) {
+	const char *end = p + len, *brace, *tok;
+	int in_dump = 0;
+	size_t n = 0, tok_len;
+
+	brace = memchr(p, '{', len);
+	if (brace) {
+		p = brace + 1;
+		brace = memchr(p, '}', end - p);
+		if (brace)
+			end = brace;
+	}
+
+	while (p < end) {
+		if (*p == '\n') {
+			in_dump = 0;
+			p++;
+			continue;
+		}
+		if (isspace(*p) || *p == ',') {
+			p++;
+			continue;
+		}
+		if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+			while (p < end && *p != '\n')
+				p++;
+			continue;
+		}
+		if (end - p >= 2 && p[0] == '/' && p[1] == '*') {
+			tok = memmem(p + 2, end - p - 2, "*/", 2);
+			p = tok ? tok + 2 : end;
+			continue;
+		}
+
+		tok = p;
+		while (p < end && !isspace(*p) && *p != ',')
+			p++;
+		tok_len = p - tok;
+
+		if (tok_len >= 3 && tok[tok_len - 1] == ':' &&
+		    is_hex(tok, tok_len - 1)) {
+			/* offset of a hex dump line */
+			in_dump = 1;
+			continue;
+		}
+
+		if (tok_len >= 3 && tok_len <= 4 && tok[0] == '0' &&
+		    (tok[1] == 'x' || tok[1] == 'X') &&
+		    is_hex(tok + 2, tok_len - 2)) {
+			tok += 2;
+			tok_len -= 2;
+		} else if (tok_len != 2 || !is_hex(tok, 2)) {
+			/* ASCII column, or anything else around the dump */
+			if (in_dump) {
+				while (p < end && *p != '\n')
+					p++;
+			}
+			continue;
+		}
+
+		if (n == size)
+			return -1;
+		out[n] = hex_digit(tok[0]);
+		if (tok_len == 2)
+			out[n] = out[n] << 4 | hex_digit(tok[1]);
+		n++;
+	}
+
+	return n;
+}
+
+static void csv_string(FILE *out, const char *str) {
+	if (!strpbrk(str, ",\"\n")) {
+		fputs(str, out);
+		return;
+	}
+
+	fputc('"', out);
+	for (; *str; str++) {
+		if (*str == '"')
+			fputc('"', out);
+		fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+static void json_string(FILE *out, const char *str) {
+	fputc('"', out);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(out, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(out, "\\u%04x", *str);
+		else
+			fputc(*str, out);
+	}
+	fputc('"', out);
+}
+
+static void print_blob(FILE *out, const char *path,
+		       const struct blob_type *t, const uint8_t *data,
+		       size_t len) {
+	const struct ipu_field *f;
+	int first = 1;
+
+	switch (format) {
+	case OUTPUT_TEXT:
+		fprintf(out, "========== %s: %s (%zu bytes) ==========\n",
+			path, t->name, len);
+		dump_fields(out, t->fields, data, len);
+		fprintf(out, "\n");
+		return;
+	case OUTPUT_CSV:
+		ipu_for_each_field(f, t->fields, len) {
+			csv_string(out, path);
+			fprintf(out, ",%s,%s,", t->name, f->name);
+			if (f->kind == IPU_FIELD_BYTES)
+				print_hex(out, data + f->offset, f->size);
+			else
+				fprintf(out, "%u", ipu_field_value(f, data));
+			fputc('\n', out);
+		}
+		return;
+	case OUTPUT_JSON:
+		fprintf(out, "    {\n      \"file\": ");
+		json_string(out, path);
+		fprintf(out, ",\n      \"type\": \"%s\",\n"
+			"      \"length\": %zu,\n      \"fields\": {",
+			t->name, len);
+		ipu_for_each_field(f, t->fields, len) {
+			fprintf(out, "%s\n        \"%s\": ",
+				first ? "" : ",", f->name);
+			if (f->kind == IPU_FIELD_BYTES) {
+				fputc('"', out);
+				print_hex(out, data + f->offset, f->size);
+				fputc('"', out);
+			} else {
+				fprintf(out, "%u", ipu_field_value(f, data));
+			}
+			first = 0;
+		}
+		fprintf(out, "\n      }\n    }");
+		return;
+	}
+}
+
+/*
+ * Convert a hex dump to binary into @text_blob and detect the type of the
+ * blob. @data and @len are updated to point to the binary blob.
+ */
+static const struct blob_type *load_blob(const char *path,
+					 const uint8_t **data, size_t *len,
+					 uint8_t *text_blob) {
+	const struct blob_type *t;
+	int n;
+
+	if (is_text(*data, *len)) {
+		n = parse_hex_text((const char *)*data, *len, text_blob,
+				   TEXT_BLOB_MAX);
+		if (n <= 0) {
+			if (path)
+				fprintf(stderr, "%s: no hex dump found\n", path);
+			return NULL;
+		}
+		*data = text_blob;
+		*len = n;
+	}
+
+	t = detect_type(*data, *len);
+	if (!t && path)
+		fprintf(stderr, "%s: unknown blob (%zu bytes), use -T\n", path,
+			*len);
+
+	return t;
+}
+
+/*
+ * Report the fields that are missing from a truncated blob or out of
+ * range. Return the number of problems found.
+ */
+static int check_blob(const char *path, const struct blob_type *t,
+		      const uint8_t *data, size_t len) {
+	const struct ipu_field *f;
+	int problems = 0;
+	uint32_t val;
+
+	if (len < t->size) {
+		if (path)
+			fprintf(stderr, "%s: %s truncated to %zu of %zu bytes\n",
+				path, t->name, len, t->size);
+		problems++;
+	}
+
+	ipu_for_each_field(f, t->fields, len) {
+		if (f->kind == IPU_FIELD_BYTES)
+			continue;
+
+		val = ipu_field_value(f, data);
+		if (ipu_field_valid(f, val))
+			continue;
+		if (path)
+			fprintf(stderr, "%s: %s %s: %u is out of range\n", path,
+				t->name, f->name, val);
+		problems++;
+	}
+
+	return problems;
+}
+
+/* Everything below is the command line tool, left out by fuzz_decode.c */
+#ifndef SSDB_DUMP_NO_MAIN
+struct job {
+	const char *path;
+	char *path_buf;			/* path, if allocated */
+	char *out_buf;
+	size_t out_len;
+	int failed;
+	int done;
+};
+
+static struct job *jobs;
+static int job_count;
+static int next_job;
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static int check_only;
+
+static int decode(FILE *out, const char *path, const uint8_t *data,
+		  size_t len) {
+	static __thread uint8_t text_blob[TEXT_BLOB_MAX];
+	const struct blob_type *t;
+	int problems;
+
+	t = load_blob(path, &data, &len, text_blob);
+	if (!t)
+		return -1;
+
+	problems = check_blob(path, t, data, len);
+	if (!check_only)
+		print_blob(out, path, t, data, len);
+
+	return check_only && problems ? -1 : 0;
+}
+
+static int decode_stdin(FILE *out) {
+	size_t len = 0, size = 0;
+	uint8_t *data = NULL, *tmp;
+	size_t n;
+	int ret;
+
+	do {
+		if (len == size) {
+			size = size ? size * 2 : 65536;
+			tmp = realloc(data, size);
+			if (!tmp) {
+				free(data);
+				return -1;
+			}
+			data = tmp;
+		}
+		n = fread(data + len, 1, size - len, stdin);
+		len += n;
+	} while (n);
+
+	ret = decode(out, "-", data, len);
+	free(data);
+	return ret;
+}
+
+static int decode_file(FILE *out, const char *path) {
+	struct stat st;
+	void *data;
+	int fd, ret;
+
+	if (!strcmp(path, "-"))
+		return decode_stdin(out);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	if (!st.st_size) {
+		fprintf(stderr, "%s: empty file\n", path);
+		close(fd);
+		return -1;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror(path);
+		return -1;
+	}
+
+	ret = decode(out, path, data, st.st_size);
+	munmap(data, st.st_size);
+	return ret;
+}
+
+static void run_job(struct job *j) {
+	FILE *out;
+
+	out = open_memstream(&j->out_buf, &j->out_len);
+	if (!out) {
+		fprintf(stderr, "%s: out of memory\n", j->path);
+		j->failed = 1;
+	} else {
+		j->failed = decode_file(out, j->path) < 0;
+		fclose(out);
+	}
+
+	pthread_mutex_lock(&done_lock);
+	j->done = 1;
+	pthread_cond_signal(&done_cond);
+	pthread_mutex_unlock(&done_lock);
+}
+
+static void *worker(void *arg) {
+	int i;
+
+	(void)arg;
+
+	while ((i = __atomic_fetch_add(&next_job, 1, __ATOMIC_RELAXED)) <
+	       job_count)
+		run_job(&jobs[i]);
+
+	return NULL;
+}
+
+static int add_job(const char *path, char *path_buf) {
+	struct job *tmp;
+
+	tmp = realloc(jobs, (job_count + 1) * sizeof(*jobs));
+	if (!tmp)
+		return -1;
+	jobs = tmp;
+
+	memset(&jobs[job_count], 0, sizeof(*jobs));
+	jobs[job_count].path = path;
+	jobs[job_count++].path_buf = path_buf;
+	return 0;
+}
+
+static int add_path(const char *path);
+
+static int add_dir_entry(const char *dir, const char *name) {
+	struct stat st;
+	char *sub;
+	int ret;
+
+	sub = malloc(strlen(dir) + strlen(name) + 2);
+	if (!sub)
+		return -1;
+	sprintf(sub, "%s/%s", dir, name);
+
+	if (!stat(sub, &st) && S_ISDIR(st.st_mode)) {
+		ret = add_path(sub);
+		free(sub);
+		return ret;
+	}
+
+	if (add_job(sub, sub)) {
+		free(sub);
+		return -1;
+	}
 
 	return 0;
 }
+
+/* Add @path, or every file below it if it is a directory */
+static int add_path(const char *path) {
+	struct dirent **ents;
+	struct stat st;
+	int n, i, ret = 0;
+
+	if (!strcmp(path, "-") || stat(path, &st) || !S_ISDIR(st.st_mode))
+		return add_job(path, NULL);
+
+	n = scandir(path, &ents, NULL, alphasort);
+	if (n < 0)
+		return -1;
+
+	for (i = 0; i < n; i++) {
+		if (!ret && ents[i]->d_name[0] != '.')
+			ret = add_dir_entry(path, ents[i]->d_name);
+		free(ents[i]);
+	}
+
+	free(ents);
+	return ret;
+}
+
+static void usage(const char *argv0) {
+	fprintf(stderr,
+		"usage: %s [-c] [-f text|csv|json] [-T ssdb|cldb|dsmb] [-t <threads>] [path...]\n"
+		"  path is a blob file, a directory of them or - for stdin\n"
+		"  -c only reports truncated blobs and out of range fields\n"
+		"  without path, dump the samples in ssdb_dump.h\n", argv0);
+}
+
+int main(int argc, char **argv) {
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const struct blob_type *t;
+	pthread_t *tids;
+	int opt, i, printed = 0, failed = 0;
+
+	while ((opt = getopt(argc, argv, "cf:T:t:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			check_only = 1;
+			break;
+		case 'f':
+			if (!strcmp(optarg, "text")) {
+				format = OUTPUT_TEXT;
+			} else if (!strcmp(optarg, "csv")) {
+				format = OUTPUT_CSV;
+			} else if (!strcmp(optarg, "json")) {
+				format = OUTPUT_JSON;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'T':
+			for (t = blob_types; t->name; t++) {
+				if (!strcasecmp(optarg, t->name))
+					forced_type = t;
+			}
+			if (!forced_type) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 't':
+			threads = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind == argc) {
+		dump_samples();
+		return 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (add_path(argv[i])) {
+			fprintf(stderr, "%s: can't open\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!job_count)
+		return 1;
+
+	if (threads < 1)
+		threads = 1;
+	if (threads > job_count)
+		threads = job_count;
+
+	tids = calloc(threads, sizeof(*tids));
+	if (!tids)
+		return 1;
+	for (i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, worker, NULL);
+
+	/*
+	 * Print in the order given on the command line, as soon as each job
+	 * is done, so that only the jobs in flight hold their output.
+	 */
+	if (format == OUTPUT_CSV)
+		printf("file,type,field,value\n");
+	else if (format == OUTPUT_JSON)
+		printf("{\n  \"blobs\": [\n");
+	for (i = 0; i < job_count; i++) {
+		pthread_mutex_lock(&done_lock);
+		while (!jobs[i].done)
+			pthread_cond_wait(&done_cond, &done_lock);
+		pthread_mutex_unlock(&done_lock);
+
+		if (jobs[i].failed) {
+			failed++;
+		} else if (jobs[i].out_len) {
+			if (format == OUTPUT_JSON && printed++)
+				printf(",\n");
+			fwrite(jobs[i].out_buf, 1, jobs[i].out_len, stdout);
+		}
+		free(jobs[i].out_buf);
+		free(jobs[i].path_buf);
+	}
+	if (format == OUTPUT_JSON)
+		printf("\n  ]\n}\n");
+
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	if (failed)
+		fprintf(stderr, "%d of %d files %s\n", failed, job_count,
+			check_only ? "have problems" : "could not be decoded");
+
+	free(tids);
+	free(jobs);
+	return failed ? 1 : 0;
+}
+#endif /* SSDB_DUMP_NO_MAIN */
@@ -0,0 +1,483 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Zero-copy capture, see zc_capture.h.
+ *
+ * The buffers are mapped through their dma-buf, in both modes, and the
+ * CPU accesses are bracketed with DMA_BUF_IOCTL_SYNC: from the dequeue to
+ * the queue again. The released buffers come back through a zc_ring, and
+ * an eventfd wakes up the capture thread if it is waiting for them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/videodev2.h>
+#include "zc_capture.h"
+#include "zc_ring.h"
+
+#define DEFAULT_BUFFERS		4
+#define DEFAULT_HEAP		"/dev/dma_heap/system"
+#define DEFAULT_TIMEOUT_MS	2000
+
+struct zc_capture {
+	struct zc_capture_config cfg;
+	int fd;
+	int heap_fd;
+	int event_fd;
+	int mplane;
+	uint32_t type;
+	enum v4l2_memory memory;
+	struct zc_format fmt;
+	unsigned int count;
+	struct zc_frame frames[ZC_MAX_BUFFERS];
+	unsigned int queued;		/* with the driver */
+	int streaming;
+	unsigned int starved;
+	struct zc_ring returned;
+};
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, req, arg);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+static int sync_dmabuf(const struct zc_frame *frame, uint64_t flags)
+{
+	struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_READ };
+
+	return xioctl(frame->dmabuf, DMA_BUF_IOCTL_SYNC, &sync);
+}
+
+static void init_v4l2_buffer(const struct zc_capture *cap,
+			     struct v4l2_buffer *buf, struct v4l2_plane *plane,
+			     unsigned int index)
+{
+	memset(buf, 0, sizeof(*buf));
+	memset(plane, 0, sizeof(*plane));
+	buf->type = cap->type;
+	buf->memory = cap->memory;
+	buf->index = index;
+	if (cap->mplane) {
+		buf->m.planes = plane;
+		buf->length = 1;
+	}
+}
+
+static int get_format(struct zc_capture *cap)
+{
+	struct v4l2_format fmt = { .type = cap->type };
+
+	if (xioctl(cap->fd, VIDIOC_G_FMT, &fmt)) {
+		perror("VIDIOC_G_FMT");
+		return -1;
+	}
+
+	if (cap->mplane) {
+		if (fmt.fmt.pix_mp.num_planes != 1) {
+			fprintf(stderr, "%s: %u planes, only 1 is supported\n",
+				cap->cfg.device, fmt.fmt.pix_mp.num_planes);
+			errno = ENOTSUP;
+			return -1;
+		}
+		cap->fmt.width = fmt.fmt.pix_mp.width;
+		cap->fmt.height = fmt.fmt.pix_mp.height;
+		cap->fmt.fourcc = fmt.fmt.pix_mp.pixelformat;
+		cap->fmt.bytesperline = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+		cap->fmt.sizeimage = fmt.fmt.pix_mp.plane_fmt[0].sizeimage;
+	} else {
+		cap->fmt.width = fmt.fmt.pix.width;
+		cap->fmt.height = fmt.fmt.pix.height;
+		cap->fmt.fourcc = fmt.fmt.pix.pixelformat;
+		cap->fmt.bytesperline = fmt.fmt.pix.bytesperline;
+		cap->fmt.sizeimage = fmt.fmt.pix.sizeimage;
+	}
+
+	return 0;
+}
+
+/* The dma-buf of buffer @index, exported or allocated */
+static int buffer_dmabuf(struct zc_capture *cap, unsigned int index,
+			 size_t *length)
+{
+	struct dma_heap_allocation_data alloc = {
+		.len = cap->fmt.sizeimage,
+		.fd_flags = O_RDWR | O_CLOEXEC,
+	};
+	struct v4l2_exportbuffer exp = {
+		.type = cap->type,
+		.index = index,
+		.flags = O_RDONLY | O_CLOEXEC,
+	};
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	if (cap->memory == V4L2_MEMORY_DMABUF) {
+		if (xioctl(cap->heap_fd, DMA_HEAP_IOCTL_ALLOC, &alloc)) {
+			perror("DMA_HEAP_IOCTL_ALLOC");
+			return -1;
+		}
+		*length = alloc.len;
+		return alloc.fd;
+	}
+
+	init_v4l2_buffer(cap, &buf, &plane, index);
+	if (xioctl(cap->fd, VIDIOC_QUERYBUF, &buf)) {
+		perror("VIDIOC_QUERYBUF");
+		return -1;
+	}
+	*length = cap->mplane ? plane.length : buf.length;
+
+	if (xioctl(cap->fd, VIDIOC_EXPBUF, &exp)) {
+		perror("VIDIOC_EXPBUF");
+		return -1;
+	}
+
+	return exp.fd;
+}
+
+static int alloc_buffers(struct zc_capture *cap)
+{
+	struct v4l2_requestbuffers req = {
+		.count = cap->cfg.buffers,
+		.type = cap->type,
+		.memory = cap->memory,
+	};
+	struct zc_frame *frame;
+	void *map;
+	unsigned int i;
+
+	if (xioctl(cap->fd, VIDIOC_REQBUFS, &req)) {
+		perror("VIDIOC_REQBUFS");
+		return -1;
+	}
+	if (!req.count || req.count > ZC_MAX_BUFFERS) {
+		fprintf(stderr, "VIDIOC_REQBUFS: got %u buffers\n", req.count);
+		errno = ENOMEM;
+		return -1;
+	}
+	cap->count = req.count;
+
+	for (i = 0; i < cap->count; i++)
+		cap->frames[i].dmabuf = -1;
+
+	for (i = 0; i < cap->count; i++) {
+		frame = &cap->frames[i];
+		frame->cap = cap;
+		frame->index = i;
+		frame->dmabuf = buffer_dmabuf(cap, i, &frame->length);
+		if (frame->dmabuf < 0)
+			return -1;
+
+		/* once, for as long as the capture is open */
+		map = mmap(NULL, frame->length, PROT_READ, MAP_SHARED,
+			   frame->dmabuf, 0);
+		if (map == MAP_FAILED) {
+			perror("mmap");
+			return -1;
+		}
+		frame->data = map;
+	}
+
+	return 0;
+}
+
+static int queue(struct zc_capture *cap, struct zc_frame *frame)
+{
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+
+	init_v4l2_buffer(cap, &buf, &plane, frame->index);
+	if (cap->memory == V4L2_MEMORY_DMABUF) {
+		if (cap->mplane) {
+			plane.m.fd = frame->dmabuf;
+			plane.length = frame->length;
+		} else {
+			buf.m.fd = frame->dmabuf;
+			buf.length = frame->length;
+		}
+	}
+
+	if (xioctl(cap->fd, VIDIOC_QBUF, &buf)) {
+		perror("VIDIOC_QBUF");
+		return -1;
+	}
+
+	cap->queued++;
+	return 0;
+}
+
+struct zc_capture *zc_capture_open(const struct zc_capture_config *cfg)
+{
+	struct v4l2_capability caps = { 0 };
+	struct zc_capture *cap;
+	uint32_t dev_caps;
+	int err;
+
+	cap = calloc(1, sizeof(*cap));
+	if (!cap)
+		return NULL;
+
+	cap->cfg = *cfg;
+	if (!cap->cfg.buffers)
+		cap->cfg.buffers = DEFAULT_BUFFERS;
+	if (!cap->cfg.heap)
+		cap->cfg.heap = DEFAULT_HEAP;
+	if (!cap->cfg.timeout_ms)
+		cap->cfg.timeout_ms = DEFAULT_TIMEOUT_MS;
+	cap->memory = cfg->memory == ZC_MEMORY_DMABUF ? V4L2_MEMORY_DMABUF :
+							 V4L2_MEMORY_MMAP;
+	cap->heap_fd = -1;
+	cap->event_fd = -1;
+	zc_ring_init(&cap->returned);
+
+	cap->fd = open(cfg->device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (cap->fd < 0) {
+		perror(cfg->device);
+		goto err;
+	}
+
+	if (xioctl(cap->fd, VIDIOC_QUERYCAP, &caps)) {
+		perror("VIDIOC_QUERYCAP");
+		goto err;
+	}
+	dev_caps = caps.capabilities & V4L2_CAP_DEVICE_CAPS ? caps.device_caps :
+							      caps.capabilities;
+	if (!(dev_caps & V4L2_CAP_STREAMING) ||
+	    !(dev_caps & (V4L2_CAP_VIDEO_CAPTURE |
+			  V4L2_CAP_VIDEO_CAPTURE_MPLANE))) {
+		fprintf(stderr, "%s: not a streaming capture device\n",
+			cfg->device);
+		errno = ENODEV;
+		goto err;
+	}
+	cap->mplane = !(dev_caps & V4L2_CAP_VIDEO_CAPTURE);
+	cap->type = cap->mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE :
+				  V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	if (get_format(cap))
+		goto err;
+
+	if (cap->memory == V4L2_MEMORY_DMABUF) {
+		cap->heap_fd = open(cap->cfg.heap, O_RDONLY | O_CLOEXEC);
+		if (cap->heap_fd < 0) {
+			perror(cap->cfg.heap);
+			goto err;
+		}
+	}
+
+	cap->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (cap->event_fd < 0) {
+		perror("eventfd");
+		goto err;
+	}
+
+	if (alloc_buffers(cap))
+		goto err;
+
+	return cap;
+
+err:
+	err = errno;
+	zc_capture_close(cap);
+	errno = err;
+	return NULL;
+}
+
+void zc_capture_close(struct zc_capture *cap)
+{
+	struct v4l2_requestbuffers req = { 0 };
+	struct zc_frame *frame;
+	unsigned int i;
+
+	if (!cap)
+		return;
+
+	if (cap->streaming)
+		zc_capture_stop(cap);
+
+	for (i = 0; i < cap->count; i++) {
+		frame = &cap->frames[i];
+		if (frame->data)
+			munmap((void *)frame->data, frame->length);
+		if (frame->dmabuf >= 0)
+			close(frame->dmabuf);
+	}
+
+	if (cap->fd >= 0) {
+		req.type = cap->type;
+		req.memory = cap->memory;
+		xioctl(cap->fd, VIDIOC_REQBUFS, &req);
+		close(cap->fd);
+	}
+	if (cap->heap_fd >= 0)
+		close(cap->heap_fd);
+	if (cap->event_fd >= 0)
+		close(cap->event_fd);
+	free(cap);
+}
+
+const struct zc_format *zc_capture_format(const struct zc_capture *cap)
+{
+	return &cap->fmt;
+}
+
+unsigned int zc_capture_buffers(const struct zc_capture *cap)
+{
+	return cap->count;
+}
+
+unsigned int zc_capture_starved(const struct zc_capture *cap)
+{
+	return cap->starved;
+}
+
+int zc_capture_start(struct zc_capture *cap)
+{
+	unsigned int i;
+
+	for (i = 0; i < cap->count; i++) {
+		atomic_init(&cap->frames[i].refs, 0);
+		if (queue(cap, &cap->frames[i]))
+			return -1;
+	}
+
+	if (xioctl(cap->fd, VIDIOC_STREAMON, &cap->type)) {
+		perror("VIDIOC_STREAMON");
+		return -1;
+	}
+
+	cap->streaming = 1;
+	return 0;
+}
+
+int zc_capture_stop(struct zc_capture *cap)
+{
+	void *frame;
+	uint64_t n;
+	int ret = 0;
+
+	if (xioctl(cap->fd, VIDIOC_STREAMOFF, &cap->type)) {
+		perror("VIDIOC_STREAMOFF");
+		ret = -1;
+	}
+
+	/* all the buffers are back, and the released ones stay so */
+	cap->streaming = 0;
+	cap->queued = 0;
+	while (!zc_ring_pop(&cap->returned, &frame))
+		;
+	if (read(cap->event_fd, &n, sizeof(n)) < 0 && errno != EAGAIN)
+		perror("eventfd");
+
+	return ret;
+}
+
+void zc_frame_put(struct zc_frame *frame)
+{
+	struct zc_capture *cap = frame->cap;
+	uint64_t one = 1;
+
+	if (atomic_fetch_sub_explicit(&frame->refs, 1,
+				      memory_order_acq_rel) != 1)
+		return;
+
+	/* there is room for all the buffers, it can't be full */
+	zc_ring_push(&cap->returned, frame);
+	if (write(cap->event_fd, &one, sizeof(one)) < 0)
+		perror("eventfd");
+}
+
+/* Queue the released buffers again */
+static int requeue(struct zc_capture *cap)
+{
+	void *frame;
+
+	while (!zc_ring_pop(&cap->returned, &frame)) {
+		if (sync_dmabuf(frame, DMA_BUF_SYNC_END)) {
+			perror("DMA_BUF_IOCTL_SYNC");
+			return -1;
+		}
+		if (queue(cap, frame))
+			return -1;
+	}
+
+	return 0;
+}
+
+struct zc_frame *zc_capture_next(struct zc_capture *cap, unsigned int refs)
+{
+	struct pollfd pfd[2] = {
+		{ .fd = cap->fd, .events = POLLIN },
+		{ .fd = cap->event_fd, .events = POLLIN },
+	};
+	struct zc_frame *frame;
+	struct v4l2_plane plane;
+	struct v4l2_buffer buf;
+	int ret, waiting = 0;
+	uint64_t n;
+
+	for (;;) {
+		if (requeue(cap))
+			return NULL;
+
+		init_v4l2_buffer(cap, &buf, &plane, 0);
+		if (!xioctl(cap->fd, VIDIOC_DQBUF, &buf))
+			break;
+		if (errno != EAGAIN) {
+			perror("VIDIOC_DQBUF");
+			return NULL;
+		}
+
+		/* once per wait, the consumers hold all the buffers */
+		if (!cap->queued && !waiting) {
+			cap->starved++;
+			waiting = 1;
+		}
+
+		/* the driver may not poll without a buffer, wait for one */
+		ret = poll(cap->queued ? pfd : &pfd[1], cap->queued ? 2 : 1,
+			   cap->cfg.timeout_ms);
+		if (ret < 0 && errno != EINTR) {
+			perror("poll");
+			return NULL;
+		}
+		if (!ret) {
+			errno = ETIMEDOUT;
+			return NULL;
+		}
+		if (read(cap->event_fd, &n, sizeof(n)) < 0 && errno != EAGAIN) {
+			perror("eventfd");
+			return NULL;
+		}
+	}
+
+	cap->queued--;
+	frame = &cap->frames[buf.index];
+	frame->bytesused = cap->mplane ? plane.bytesused : buf.bytesused;
+	frame->sequence = buf.sequence;
+	frame->timestamp_ns = buf.timestamp.tv_sec * 1000000000ULL +
+			      buf.timestamp.tv_usec * 1000ULL;
+	atomic_store_explicit(&frame->refs, refs, memory_order_relaxed);
+
+	if (sync_dmabuf(frame, DMA_BUF_SYNC_START)) {
+		perror("DMA_BUF_IOCTL_SYNC");
+		return NULL;
+	}
+
+	return frame;
+}
@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Zero-copy capture from a V4L2 video node: each buffer is a dma-buf,
+ * exported from the driver with VIDIOC_EXPBUF or allocated from a dma-buf
+ * heap and imported, and is mapped once when the capture is opened. A
+ * dequeued frame is handed to the consumers as it is, with one reference
+ * for each. The last one to drop its reference, in whatever thread,
+ * returns the buffer through a lock-free ring, and the capture thread
+ * queues it again before it waits for the next frame.
+ *
+ * The consumers read the frame in place through @data, or pass @dmabuf to
+ * another device. Nothing is copied.
+ */
+#ifndef ZC_CAPTURE_H
+#define ZC_CAPTURE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZC_MAX_BUFFERS		32
+
+enum zc_memory {
+	/* buffers of the driver, exported with VIDIOC_EXPBUF */
+	ZC_MEMORY_MMAP,
+	/* buffers from a dma-buf heap, imported with V4L2_MEMORY_DMABUF */
+	ZC_MEMORY_DMABUF,
+};
+
+struct zc_capture_config {
+	const char *device;
+	unsigned int buffers;		/* 0 for 4 */
+	enum zc_memory memory;
+	const char *heap;		/* NULL for /dev/dma_heap/system */
+	int timeout_ms;			/* 0 for 2000 */
+};
+
+/* The current format of the video node, one plane only */
+struct zc_format {
+	uint32_t width;
+	uint32_t height;
+	uint32_t fourcc;
+	uint32_t bytesperline;
+	uint32_t sizeimage;
+};
+
+struct zc_capture;
+
+struct zc_frame {
+	struct zc_capture *cap;
+	unsigned int index;		/* of the V4L2 buffer */
+	int dmabuf;
+	const uint8_t *data;		/* mapped for the CPU */
+	size_t length;			/* of the buffer */
+	size_t bytesused;
+	uint32_t sequence;
+	uint64_t timestamp_ns;
+	atomic_uint refs;
+};
+
+/* Return NULL with errno set on failure, after printing why */
+struct zc_capture *zc_capture_open(const struct zc_capture_config *cfg);
+/* All the frames have to be released */
+void zc_capture_close(struct zc_capture *cap);
+
+const struct zc_format *zc_capture_format(const struct zc_capture *cap);
+unsigned int zc_capture_buffers(const struct zc_capture *cap);
+
+int zc_capture_start(struct zc_capture *cap);
+int zc_capture_stop(struct zc_capture *cap);
+
+/*
+ * Queue the buffers released since the last call, wait for the next frame
+ * and return it with @refs references. Return NULL with errno set on
+ * failure, ETIMEDOUT if no frame came. Only one thread may call it.
+ */
+struct zc_frame *zc_capture_next(struct zc_capture *cap, unsigned int refs);
+
+/* Times all the buffers were held by the consumers when a frame was due */
+unsigned int zc_capture_starved(const struct zc_capture *cap);
+
+static inline void zc_frame_get(struct zc_frame *frame)
+{
+	atomic_fetch_add_explicit(&frame->refs, 1, memory_order_relaxed);
+}
+
+/* Drop a reference, from any thread */
+void zc_frame_put(struct zc_frame *frame);
+
+#endif /* ZC_CAPTURE_H */
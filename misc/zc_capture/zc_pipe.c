@@ -0,0 +1,541 @@
+/**
+ * This tool runs a capture pipeline on zc_capture: each frame goes, as it
+ * was dequeued, to an unpack stage (the half size 8-bit preview of
+ * ../ipu3_unpack), a statistics stage (the white balance statistics of
+ * ../awb) and a write stage, which stands in for an encoder and writes
+ * the frame to a file with -o. Each stage is a thread with a lock-free
+ * ring of frames, and holds a reference to the frame until it is done.
+ *
+ * With -c, the frames are copied out of the capture buffers first, as a
+ * pipeline without zc_capture does, to compare the time and memory
+ * traffic. -T checks zc_ring with several producer and consumer threads,
+ * without a video node.
+ *
+ * Frames in another format than the IPU3 packed ones, from vivid for
+ * example, are processed as if they were, over the bytes of their lines.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include "awb_stats.h"
+#include "ipu3_unpack.h"
+#include "zc_capture.h"
+#include "zc_ring.h"
+
+#define DEFAULT_FRAMES		300
+#define MAX_STAGES		3
+#define TEST_THREADS		4
+#define TEST_ITEMS		1000000
+
+struct pipe;
+
+struct stage {
+	const char *name;
+	struct pipe *pipe;
+	pthread_t thread;
+	struct zc_ring ring;
+	sem_t ready;
+	int (*process)(struct stage *stage, const uint8_t *data,
+		       const struct zc_frame *frame);
+	unsigned int frames;
+	double busy_us;
+	/* what the stage works on */
+	uint8_t *preview;
+	struct awb_stats_engine *stats;
+	struct awb_stats *awb_stats;
+	int out_fd;
+};
+
+struct pipe {
+	struct zc_capture *cap;
+	const struct zc_format *fmt;
+	/* the packed frame the stages see: the lines as IPU3 packed ones */
+	unsigned int width;
+	unsigned int height;
+	struct stage stages[MAX_STAGES];
+	unsigned int num_stages;
+	atomic_int stop;
+	/* with -c, a copy of each buffer */
+	uint8_t *copies[ZC_MAX_BUFFERS];
+	double copy_us;
+	uint64_t copied;
+};
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void fourcc_str(uint32_t fourcc, char *str)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		str[i] = (fourcc >> (8 * i)) & 0x7f;
+	str[4] = '\0';
+}
+
+static int is_ipu3_format(uint32_t fourcc)
+{
+	return fourcc == V4L2_PIX_FMT_IPU3_SBGGR10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SGBRG10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SGRBG10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_SRGGB10 ||
+	       fourcc == V4L2_PIX_FMT_IPU3_Y10;
+}
+
+/*
+ * Stages
+ */
+static int unpack_process(struct stage *stage, const uint8_t *data,
+			  const struct zc_frame *frame)
+{
+	const struct pipe *pipe = stage->pipe;
+
+	(void)frame;
+	ipu3_unpack_preview8_frame(data, pipe->fmt->bytesperline,
+				   stage->preview, pipe->width / 2,
+				   pipe->width, pipe->height);
+	return 0;
+}
+
+static int stats_process(struct stage *stage, const uint8_t *data,
+			 const struct zc_frame *frame)
+{
+	(void)frame;
+	awb_stats_compute(stage->stats, data, stage->pipe->fmt->bytesperline,
+			  stage->awb_stats);
+	return 0;
+}
+
+/* Straight from the buffer, as an encoder reading the dma-buf would */
+static int write_process(struct stage *stage, const uint8_t *data,
+			 const struct zc_frame *frame)
+{
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < frame->bytesused) {
+		ret = write(stage->out_fd, data + done,
+			    frame->bytesused - done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			perror("write");
+			return -1;
+		}
+		done += ret;
+	}
+
+	return 0;
+}
+
+static const uint8_t *frame_data(const struct pipe *pipe,
+				 const struct zc_frame *frame)
+{
+	return pipe->copies[frame->index] ? pipe->copies[frame->index] :
+					     frame->data;
+}
+
+static void *stage_thread(void *arg)
+{
+	struct stage *stage = arg;
+	struct pipe *pipe = stage->pipe;
+	void *frame;
+	double t0;
+
+	for (;;) {
+		while (sem_wait(&stage->ready) && errno == EINTR)
+			;
+		if (zc_ring_pop(&stage->ring, &frame)) {
+			if (atomic_load(&pipe->stop))
+				break;
+			continue;
+		}
+
+		t0 = now_us();
+		if (stage->process(stage, frame_data(pipe, frame), frame))
+			atomic_store(&pipe->stop, 1);
+		stage->busy_us += now_us() - t0;
+		stage->frames++;
+		zc_frame_put(frame);
+	}
+
+	return NULL;
+}
+
+static int add_stage(struct pipe *pipe, const char *name,
+		     int (*process)(struct stage *, const uint8_t *,
+				    const struct zc_frame *))
+{
+	struct stage *stage = &pipe->stages[pipe->num_stages++];
+
+	stage->name = name;
+	stage->pipe = pipe;
+	stage->process = process;
+	stage->out_fd = -1;
+	zc_ring_init(&stage->ring);
+	return sem_init(&stage->ready, 0, 0);
+}
+
+static void free_stages(struct pipe *pipe)
+{
+	struct stage *stage;
+	unsigned int i;
+
+	for (i = 0; i < pipe->num_stages; i++) {
+		stage = &pipe->stages[i];
+		free(stage->preview);
+		awb_stats_destroy(stage->stats);
+		free(stage->awb_stats);
+		if (stage->out_fd >= 0)
+			close(stage->out_fd);
+		sem_destroy(&stage->ready);
+	}
+}
+
+static int setup_stages(struct pipe *pipe, const char *output)
+{
+	struct awb_stats_config cfg = {
+		.width = pipe->width,
+		.height = pipe->height,
+		.zones_x = 16,
+		.zones_y = 12,
+		.black = 64,
+		.dark = 16,
+		.isa = AWB_STATS_ISA_AUTO,
+	};
+	struct stage *stage;
+
+	if (add_stage(pipe, "unpack", unpack_process))
+		return -1;
+	stage = &pipe->stages[pipe->num_stages - 1];
+	stage->preview = malloc((size_t)pipe->width / 2 * (pipe->height / 2));
+	if (!stage->preview)
+		return -1;
+
+	if (add_stage(pipe, "stats", stats_process))
+		return -1;
+	stage = &pipe->stages[pipe->num_stages - 1];
+	stage->stats = awb_stats_create(&cfg);
+	stage->awb_stats = malloc(sizeof(*stage->awb_stats));
+	if (!stage->stats || !stage->awb_stats) {
+		perror("awb_stats_create");
+		return -1;
+	}
+
+	if (output) {
+		if (add_stage(pipe, "write", write_process))
+			return -1;
+		stage = &pipe->stages[pipe->num_stages - 1];
+		stage->out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (stage->out_fd < 0) {
+			perror(output);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Run
+ */
+static int run(const struct zc_capture_config *cfg, unsigned int frames,
+	       const char *output, int copy)
+{
+	struct pipe pipe = { 0 };
+	struct zc_frame *frame;
+	unsigned int i, n, started = 0, dropped = 0;
+	uint32_t last_seq = 0;
+	char fourcc[5];
+	double t0, t1 = 0, copy_t0;
+	int ret = -1;
+
+	pipe.cap = zc_capture_open(cfg);
+	if (!pipe.cap)
+		return -1;
+	pipe.fmt = zc_capture_format(pipe.cap);
+
+	fourcc_str(pipe.fmt->fourcc, fourcc);
+	if (is_ipu3_format(pipe.fmt->fourcc)) {
+		pipe.width = pipe.fmt->width & ~1U;
+	} else {
+		pipe.width = pipe.fmt->bytesperline / 64 * 50;
+		printf("%s isn't an IPU3 packed format, processing its lines as %u pixels\n",
+		       fourcc, pipe.width);
+	}
+	pipe.height = pipe.fmt->height & ~1U;
+	if (pipe.width < 2 || pipe.height < 2 ||
+	    pipe.fmt->bytesperline < ipu3_packed_bpl(pipe.width)) {
+		fprintf(stderr, "%ux%u %s: too small\n", pipe.fmt->width,
+			pipe.fmt->height, fourcc);
+		goto out;
+	}
+
+	if (setup_stages(&pipe, output))
+		goto out;
+
+	if (copy) {
+		for (i = 0; i < zc_capture_buffers(pipe.cap); i++) {
+			pipe.copies[i] = malloc(pipe.fmt->sizeimage);
+			if (!pipe.copies[i])
+				goto out;
+		}
+	}
+
+	printf("%ux%u %s, %u buffers (%s), stages:", pipe.fmt->width,
+	       pipe.fmt->height, fourcc, zc_capture_buffers(pipe.cap),
+	       cfg->memory == ZC_MEMORY_DMABUF ? "dma-buf heap" : "exported");
+	for (i = 0; i < pipe.num_stages; i++)
+		printf(" %s", pipe.stages[i].name);
+	printf("%s\n", copy ? ", copying the frames" : "");
+
+	for (i = 0; i < pipe.num_stages; i++) {
+		if (pthread_create(&pipe.stages[i].thread, NULL, stage_thread,
+				   &pipe.stages[i]))
+			goto out_threads;
+		started++;
+	}
+
+	if (zc_capture_start(pipe.cap))
+		goto out_threads;
+
+	t0 = now_us();
+	for (n = 0; n < frames && !atomic_load(&pipe.stop); n++) {
+		frame = zc_capture_next(pipe.cap, pipe.num_stages);
+		if (!frame) {
+			if (errno == ETIMEDOUT)
+				fprintf(stderr, "no frame in time\n");
+			goto out_stream;
+		}
+		if (n && frame->sequence != last_seq + 1)
+			dropped += frame->sequence - last_seq - 1;
+		last_seq = frame->sequence;
+
+		if (copy) {
+			copy_t0 = now_us();
+			memcpy(pipe.copies[frame->index], frame->data,
+			       frame->bytesused);
+			pipe.copy_us += now_us() - copy_t0;
+			pipe.copied += frame->bytesused;
+		}
+
+		for (i = 0; i < pipe.num_stages; i++) {
+			/* a ring holds more than all the buffers */
+			zc_ring_push(&pipe.stages[i].ring, frame);
+			sem_post(&pipe.stages[i].ready);
+		}
+	}
+	t1 = now_us();
+	ret = atomic_load(&pipe.stop) ? -1 : 0;
+
+out_stream:
+	/* let the stages finish the frames they have, then stop them */
+	atomic_store(&pipe.stop, 1);
+	for (i = 0; i < started; i++)
+		sem_post(&pipe.stages[i].ready);
+	for (i = 0; i < started; i++)
+		pthread_join(pipe.stages[i].thread, NULL);
+	started = 0;
+	zc_capture_stop(pipe.cap);
+
+	if (!ret) {
+		printf("%u frames, %.1f fps, %u dropped, %u waits for a buffer\n",
+		       n, n > 1 ? (n - 1) * 1e6 / (t1 - t0) : 0, dropped,
+		       zc_capture_starved(pipe.cap));
+		for (i = 0; i < pipe.num_stages; i++)
+			printf("%-8s %8.1f us per frame\n", pipe.stages[i].name,
+			       pipe.stages[i].frames ?
+			       pipe.stages[i].busy_us / pipe.stages[i].frames :
+			       0);
+		printf("copied %.1f MB", pipe.copied / 1e6);
+		if (copy)
+			printf(", %.1f us per frame", n ? pipe.copy_us / n : 0);
+		printf("\n");
+	}
+
+out_threads:
+	atomic_store(&pipe.stop, 1);
+	for (i = 0; i < started; i++)
+		sem_post(&pipe.stages[i].ready);
+	for (i = 0; i < started; i++)
+		pthread_join(pipe.stages[i].thread, NULL);
+out:
+	free_stages(&pipe);
+	for (i = 0; i < ZC_MAX_BUFFERS; i++)
+		free(pipe.copies[i]);
+	zc_capture_close(pipe.cap);
+	return ret;
+}
+
+/*
+ * Test of zc_ring
+ */
+struct ring_test {
+	struct zc_ring ring;
+	atomic_uint pushed;
+	atomic_uint popped;
+	atomic_ullong sum;
+	_Atomic(unsigned char) *seen;
+	atomic_int twice;
+};
+
+static void *test_producer(void *arg)
+{
+	struct ring_test *t = arg;
+	unsigned int i;
+
+	for (;;) {
+		i = atomic_fetch_add(&t->pushed, 1);
+		if (i >= TEST_ITEMS)
+			break;
+		/* values from 1, NULL isn't one */
+		while (zc_ring_push(&t->ring, (void *)(uintptr_t)(i + 1)))
+			sched_yield();
+	}
+
+	return NULL;
+}
+
+static void *test_consumer(void *arg)
+{
+	struct ring_test *t = arg;
+	uintptr_t v;
+	void *value;
+
+	while (atomic_load(&t->popped) < TEST_ITEMS) {
+		if (zc_ring_pop(&t->ring, &value)) {
+			sched_yield();
+			continue;
+		}
+		v = (uintptr_t)value;
+		if (!v || v > TEST_ITEMS || atomic_exchange(&t->seen[v - 1], 1))
+			atomic_store(&t->twice, 1);
+		atomic_fetch_add(&t->sum, v);
+		atomic_fetch_add(&t->popped, 1);
+	}
+
+	return NULL;
+}
+
+static int test_ring(void)
+{
+	pthread_t threads[2 * TEST_THREADS];
+	static struct ring_test t;
+	unsigned long long expected = (unsigned long long)TEST_ITEMS *
+				      (TEST_ITEMS + 1) / 2;
+	void *value = NULL;
+	unsigned int i;
+	int failed = 0;
+
+	/* full and empty */
+	zc_ring_init(&t.ring);
+	for (i = 0; i < ZC_RING_SIZE; i++)
+		failed |= zc_ring_push(&t.ring, &t) != 0;
+	failed |= zc_ring_push(&t.ring, &t) != -1;
+	for (i = 0; i < ZC_RING_SIZE; i++)
+		failed |= zc_ring_pop(&t.ring, &value) != 0 || value != &t;
+	failed |= zc_ring_pop(&t.ring, &value) != -1;
+
+	zc_ring_init(&t.ring);
+	t.seen = calloc(TEST_ITEMS, sizeof(*t.seen));
+	if (!t.seen)
+		return -1;
+	for (i = 0; i < TEST_THREADS; i++) {
+		if (pthread_create(&threads[i], NULL, test_producer, &t) ||
+		    pthread_create(&threads[TEST_THREADS + i], NULL,
+				   test_consumer, &t)) {
+			fprintf(stderr, "pthread_create failed\n");
+			exit(1);
+		}
+	}
+	for (i = 0; i < 2 * TEST_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	failed |= atomic_load(&t.popped) != TEST_ITEMS ||
+		  atomic_load(&t.sum) != expected || atomic_load(&t.twice);
+	free(t.seen);
+
+	printf("ring, %u producers and %u consumers, %u values: %s\n",
+	       TEST_THREADS, TEST_THREADS, TEST_ITEMS, failed ? "wrong" : "ok");
+	return failed;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s -d <video node> [-n <frames>] [-b <buffers>]\n"
+		"          [-m mmap|dmabuf] [-H <dma heap>] [-o <file>] [-c]\n"
+		"       %s -T\n", argv0, argv0);
+}
+
+int main(int argc, char **argv)
+{
+	struct zc_capture_config cfg = { 0 };
+	unsigned int frames = DEFAULT_FRAMES;
+	const char *output = NULL;
+	int copy = 0, test = 0, c;
+
+	while ((c = getopt(argc, argv, "d:n:b:m:H:o:cT")) != -1) {
+		switch (c) {
+		case 'd':
+			cfg.device = optarg;
+			break;
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			cfg.buffers = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			if (!strcmp(optarg, "mmap")) {
+				cfg.memory = ZC_MEMORY_MMAP;
+			} else if (!strcmp(optarg, "dmabuf")) {
+				cfg.memory = ZC_MEMORY_DMABUF;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'H':
+			cfg.heap = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'c':
+			copy = 1;
+			break;
+		case 'T':
+			test = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (test)
+		return test_ring() ? 1 : 0;
+
+	if (!cfg.device || !frames || cfg.buffers > ZC_MAX_BUFFERS) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	return run(&cfg, frames, output, copy) ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Bounded lock-free ring of pointers, for any number of producer and
+ * consumer threads (Dmitry Vyukov's bounded MPMC queue): each slot has a
+ * sequence number that says whether it is free for the push of position
+ * pos (seq == pos) or holds the value for the pop of pos (seq == pos + 1).
+ * A push or pop claims its position with a compare and swap and never
+ * waits for another thread.
+ */
+#ifndef ZC_RING_H
+#define ZC_RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* A power of 2 */
+#define ZC_RING_SIZE		64
+
+struct zc_ring_slot {
+	atomic_uint seq;
+	void *value;
+};
+
+struct zc_ring {
+	struct zc_ring_slot slots[ZC_RING_SIZE];
+	/* apart, so that producers and consumers don't share a cache line */
+	_Alignas(64) atomic_uint head;		/* next push */
+	_Alignas(64) atomic_uint tail;		/* next pop */
+};
+
+static inline void zc_ring_init(struct zc_ring *r)
+{
+	unsigned int i;
+
+	for (i = 0; i < ZC_RING_SIZE; i++) {
+		atomic_init(&r->slots[i].seq, i);
+		r->slots[i].value = NULL;
+	}
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+}
+
+/* Return -1 if the ring is full */
+static inline int zc_ring_push(struct zc_ring *r, void *value)
+{
+	unsigned int pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+	struct zc_ring_slot *slot;
+	int diff;
+
+	for (;;) {
+		slot = &r->slots[pos % ZC_RING_SIZE];
+		diff = (int)(atomic_load_explicit(&slot->seq,
+						  memory_order_acquire) - pos);
+		if (!diff) {
+			if (atomic_compare_exchange_weak_explicit(&r->head,
+								  &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = atomic_load_explicit(&r->head,
+						   memory_order_relaxed);
+		}
+	}
+
+	slot->value = value;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+	return 0;
+}
+
+/* Return -1 if the ring is empty */
+static inline int zc_ring_pop(struct zc_ring *r, void **value)
+{
+	unsigned int pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	struct zc_ring_slot *slot;
+	int diff;
+
+	for (;;) {
+		slot = &r->slots[pos % ZC_RING_SIZE];
+		diff = (int)(atomic_load_explicit(&slot->seq,
+						  memory_order_acquire) -
+			     (pos + 1));
+		if (!diff) {
+			if (atomic_compare_exchange_weak_explicit(&r->tail,
+								  &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			pos = atomic_load_explicit(&r->tail,
+						   memory_order_relaxed);
+		}
+	}
+
+	*value = slot->value;
+	atomic_store_explicit(&slot->seq, pos + ZC_RING_SIZE,
+			      memory_order_release);
+	return 0;
+}
+
+#endif /* ZC_RING_H */